@@ -0,0 +1,576 @@
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "AcqDaemon.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#include "EccLibrary.h"
+#include "TechniqueCache.h"
+
+#ifdef _WIN32
+typedef SOCKET TSocket_t;
+#define DMN_NO_SOCKET       INVALID_SOCKET
+#define s_closeSocket       closesocket
+#else
+typedef int TSocket_t;
+#define DMN_NO_SOCKET       (-1)
+#define s_closeSocket       close
+#endif
+
+#define DMN_SELECT_MS       (100)    /* longest wait of the daemon for a connection */
+#define DMN_COMMAND_SIZE    (256)    /* longest command read */
+#define DMN_COMMAND_MS      (1000)   /* longest wait for a command */
+#define DMN_FLUSH_SECONDS   (10)     /* the points gathered are written at least this often */
+
+/* a client which resets its connection must not end the daemon with SIGPIPE */
+#ifdef MSG_NOSIGNAL
+#define DMN_SEND_FLAGS      MSG_NOSIGNAL
+#else
+#define DMN_SEND_FLAGS      0
+#endif
+
+static long long s_clockNs(){
+    return (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+/* resident memory of the process */
+static long long s_memoryBytes(){
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if( !GetProcessMemoryInfo( GetCurrentProcess(), &counters, sizeof(counters) ) ) return -1;
+    return (long long)counters.WorkingSetSize;
+#elif defined(__linux__)
+    FILE* f = fopen( "/proc/self/statm", "r" );
+    if( !f ) return -1;
+    long long size = 0, resident = -1;
+    if( fscanf( f, "%lld %lld", &size, &resident ) != 2 ) resident = -1;
+    fclose( f );
+    return resident < 0 ? -1 : resident * (long long)sysconf( _SC_PAGESIZE );
+#else
+    return -1;
+#endif
+}
+
+/* CPU time of the process, all threads */
+static double s_cpuSeconds(){
+#ifdef _WIN32
+    FILETIME created, exited, kernel, user;
+    if( !GetProcessTimes( GetCurrentProcess(), &created, &exited, &kernel, &user ) ) return 0.0;
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel.dwLowDateTime; k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;   u.HighPart = user.dwHighDateTime;
+    return ( k.QuadPart + u.QuadPart ) * 1e-7;
+#else
+    struct rusage usage;
+    if( getrusage( RUSAGE_SELF, &usage ) != 0 ) return 0.0;
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + ( usage.ru_utime.tv_usec + usage.ru_stime.tv_usec ) * 1e-6;
+#endif
+}
+
+/* waits until the socket can be read, false at the time-out */
+static bool s_readable( TSocket_t s, long long until ){
+    long long left = until - s_clockNs();
+    if( left <= 0 ) return false;
+    fd_set ready;
+    FD_ZERO( &ready );
+    FD_SET( s, &ready );
+    struct timeval tv;
+    tv.tv_sec  = (long)( left / 1000000000LL );
+    tv.tv_usec = (long)( left % 1000000000LL / 1000 );
+    return select( (int)s + 1, &ready, 0, 0, &tv ) > 0;
+}
+
+static void s_noSigpipe( TSocket_t s ){
+#ifdef SO_NOSIGPIPE
+    int yes = 1;
+    setsockopt( s, SOL_SOCKET, SO_NOSIGPIPE, &yes, sizeof(yes) );
+#else
+    (void)s;
+#endif
+}
+
+static void s_send( TSocket_t s, const std::string& text ){
+    size_t sent = 0;
+    while( sent < text.size() ){
+        int n = (int)send( s, text.data() + sent, (int)( text.size() - sent ), DMN_SEND_FLAGS );
+        if( n <= 0 ) break;
+        sent += n;
+    }
+}
+
+const char* DMN_StateName( int state )
+{
+    switch( state ){
+    case DMN_RUNNING:  return "running";
+    case DMN_STOPPING: return "stopping";
+    case DMN_DONE:     return "done";
+    default:           return "idle";
+    }
+}
+
+int DMN_Command( int port, const char* command, std::string* answer, unsigned int timeout_ms )
+{
+    if( answer ) answer->clear();
+    if( port <= 0 || port > 65535 || !command ) return ERR_GEN_INVALIDPARAMETERS;
+#ifdef _WIN32
+    WSADATA wsa;
+    if( WSAStartup( MAKEWORD( 2, 2 ), &wsa ) != 0 ) return ERR_GEN_FUNCTIONFAILED;
+#endif
+    int status = ERR_GEN_NOTCONNECTED;
+    struct sockaddr_in addr;
+    memset( &addr, 0, sizeof(addr) );
+    addr.sin_family = AF_INET;
+    addr.sin_port   = htons( (unsigned short)port );
+    inet_pton( AF_INET, "127.0.0.1", &addr.sin_addr );
+    TSocket_t s = socket( AF_INET, SOCK_STREAM, 0 );
+    if( s != DMN_NO_SOCKET ) s_noSigpipe( s );
+    if( s != DMN_NO_SOCKET && connect( s, (struct sockaddr*)&addr, sizeof(addr) ) == 0 ){
+        s_send( s, std::string( command ) + "\n" );
+        std::string text;
+        char buf[4096];
+        long long until = s_clockNs() + (long long)timeout_ms * 1000000LL;
+        while( s_readable( s, until ) ){
+            int n = (int)recv( s, buf, sizeof(buf), 0 );
+            if( n <= 0 ) break;
+            text.append( buf, n );
+        }
+        /* the last line tells the result */
+        size_t end = text.size();
+        while( end > 0 && ( text[end - 1] == '\n' || text[end - 1] == '\r' ) ) end--;
+        size_t last = text.rfind( '\n', end ? end - 1 : 0 );
+        last = ( last == std::string::npos ) ? 0 : last + 1;
+        std::string result = text.substr( last, end - last );
+        if( result == "OK" ) status = ERR_NOERROR;
+        else if( result.compare( 0, 5, "ERROR" ) == 0 ) status = ERR_GEN_FUNCTIONFAILED;
+        if( answer ) *answer = text;
+    }
+    if( s != DMN_NO_SOCKET ) s_closeSocket( s );
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return status;
+}
+
+double DMN_StatusValue( const std::string& answer, const char* name, double fallback )
+{
+    std::string key = std::string( name ) + " ";
+    size_t at = 0;
+    while( at < answer.size() ){
+        size_t eol = answer.find( '\n', at );
+        if( eol == std::string::npos ) eol = answer.size();
+        if( answer.compare( at, key.size(), key ) == 0 ) return atof( answer.c_str() + at + key.size() );
+        at = eol + 1;
+    }
+    return fallback;
+}
+
+AcqDaemon::AcqDaemon( const TEClibFunctions* eclib )
+    : eclib( eclib ), origin( s_clockNs() ), captures( 0 ), closed_bytes( 0 ), store_errors( 0 )
+    , state( DMN_IDLE ), stopping( false ), quitting( false ), commands( 0 )
+    , listener( (long long)DMN_NO_SOCKET ), bound( -1 )
+{
+}
+
+AcqDaemon::~AcqDaemon()
+{
+    {
+        std::lock_guard<std::mutex> guard( lock );
+        quitting = true;
+        stopping = true;
+    }
+    if( worker.joinable() ) worker.join();
+    if( state != DMN_IDLE && state != DMN_DONE ) finish();
+    if( (TSocket_t)listener != DMN_NO_SOCKET ){
+        s_closeSocket( (TSocket_t)listener );
+        listener = (long long)DMN_NO_SOCKET;
+#ifdef _WIN32
+        WSACleanup();
+#endif
+    }
+    if( session ) session->disconnect();
+}
+
+int AcqDaemon::start( const TAcqJob_t& settings, std::string* error )
+{
+    std::string reason;
+    int status = ERR_NOERROR;
+    if( state != DMN_IDLE ) return ERR_GEN_FUNCTIONINPROGRESS;
+    if( !eclib || settings.Channels.empty() || settings.Chain.empty() || settings.Capture.empty() ){
+        if( error ) *error = "incomplete job";
+        return ERR_GEN_INVALIDPARAMETERS;
+    }
+    job = settings;
+
+    /* the device and the techniques */
+    std::string ecc_dir = job.EccDir;
+    if( ecc_dir.empty() && ECC_FindPackageDir( 0, &ecc_dir ) != ERR_NOERROR ){
+        if( error ) *error = "no folder of .ecc files (set ECLAB_PACKAGE_DIR or 'ecc' in the job)";
+        return ERR_GEN_FILENOTEXISTS;
+    }
+    if( ecc_dir[ecc_dir.size() - 1] != '/' && ecc_dir[ecc_dir.size() - 1] != '\\' ) ecc_dir += "/";
+    session.reset( new DeviceSession( eclib ) );
+    TDeviceInfos_t infos;
+    status = session->connect( job.Device, 5, &infos );
+    if( status != ERR_NOERROR ){
+        if( error ) *error = "cannot connect to " + job.Device;
+        session.reset();
+        return status;
+    }
+    uint8 mask[ACQ_MAX_CHANNELS] = { 0 };
+    int results[ACQ_MAX_CHANNELS];
+    for( size_t c = 0; c < job.Channels.size(); c++ ) mask[job.Channels[c]] = 1;
+    TechniqueCache cache( eclib, ecc_dir );
+    status = cache.loadChannels( session->id(), mask, results, ACQ_MAX_CHANNELS, job.Chain );
+    if( status == ERR_NOERROR ) status = eclib->BL_StartChannels( session->id(), mask, results, ACQ_MAX_CHANNELS );
+    if( status != ERR_NOERROR ){
+        for( int ch = 0; ch < ACQ_MAX_CHANNELS; ch++ ){
+            if( mask[ch] && results[ch] != ERR_NOERROR ){
+                char text[64];
+                snprintf( text, sizeof(text), "channel %d: error %d", ch + 1, results[ch] );
+                reason = text;
+                break;
+            }
+        }
+        if( error ) *error = reason.empty() ? "cannot load the techniques" : reason;
+        session->disconnect();
+        session.reset();
+        return status;
+    }
+
+    /* the storage, then the drain */
+    {
+        std::lock_guard<std::mutex> guard( capture_lock );
+        status = openCapture();
+    }
+    if( status == ERR_NOERROR && !job.Publish.empty() && bus.create( job.Publish.c_str(), BUS_DEFAULT_POINTS, ACQ_MAX_CHANNELS ) != ERR_NOERROR ){
+        status = ERR_GEN_FUNCTIONFAILED;
+        reason = "cannot create the shared memory " + job.Publish;
+    }
+    TAcqConfig_t config = ACQ_DefaultConfig();
+    config.Vmp4 = job.Vmp4;
+    acquisition.reset( new Acquisition( eclib, session.get(), config ) );
+    acquisition->setFrameFunction( s_store, this );
+    for( size_t c = 0; c < job.Channels.size() && status == ERR_NOERROR; c++ ){
+        status = acquisition->addChannel( job.Channels[c], job.Xrec );
+    }
+
+    /* the control socket */
+    if( status == ERR_NOERROR && job.ControlPort >= 0 ){
+#ifdef _WIN32
+        WSADATA wsa;
+        if( WSAStartup( MAKEWORD( 2, 2 ), &wsa ) != 0 ) status = ERR_GEN_FUNCTIONFAILED;
+#endif
+        struct sockaddr_in addr;
+        memset( &addr, 0, sizeof(addr) );
+        addr.sin_family = AF_INET;
+        addr.sin_port   = htons( (unsigned short)job.ControlPort );
+        inet_pton( AF_INET, "127.0.0.1", &addr.sin_addr );
+        TSocket_t s = ( status == ERR_NOERROR ) ? socket( AF_INET, SOCK_STREAM, 0 ) : DMN_NO_SOCKET;
+        socklen_t size = sizeof(addr);
+        int yes = 1;
+        if( s != DMN_NO_SOCKET ) setsockopt( s, SOL_SOCKET, SO_REUSEADDR, (const char*)&yes, sizeof(yes) );
+        if( s == DMN_NO_SOCKET || bind( s, (struct sockaddr*)&addr, sizeof(addr) ) != 0 || listen( s, 8 ) != 0 ||
+            getsockname( s, (struct sockaddr*)&addr, &size ) != 0 ){
+            if( s != DMN_NO_SOCKET ) s_closeSocket( s );
+#ifdef _WIN32
+            if( status == ERR_NOERROR ) WSACleanup();
+#endif
+            status = ERR_GEN_FUNCTIONFAILED;
+            reason = "cannot listen on the control port";
+        } else {
+            listener = (long long)s;
+            bound    = ntohs( addr.sin_port );
+        }
+    }
+
+    if( status == ERR_NOERROR ) status = acquisition->start();
+    if( status != ERR_NOERROR ){
+        if( error ) *error = reason.empty() ? "cannot start the acquisition" : reason;
+        acquisition.reset();
+        bus.close();
+        {
+            std::lock_guard<std::mutex> guard( capture_lock );
+            capture.close();
+        }
+        session->disconnect();
+        session.reset();
+        return status;
+    }
+    origin = s_clockNs();
+    state  = DMN_RUNNING;
+    worker = std::thread( &AcqDaemon::run, this );
+    return ERR_NOERROR;
+}
+
+int AcqDaemon::openCapture()
+{
+    /* numbered from 1 with a rotation size, the name of the job first otherwise */
+    unsigned int number = job.RotateMB ? captures + 1 : captures;
+    std::string path = JOB_CaptureName( job.Capture, number );
+    int status = capture.open( path.c_str() );
+    if( status != ERR_NOERROR ) return status;
+    capture_path = path;
+    captures++;
+    return ERR_NOERROR;
+}
+
+int AcqDaemon::rotate()
+{
+    std::lock_guard<std::mutex> guard( capture_lock );
+    if( !capture.isOpen() ) return ERR_GEN_FUNCTIONFAILED;
+    int status = capture.close();
+    closed_bytes += capture.bytesWritten();
+    int next = openCapture();
+    return status != ERR_NOERROR ? status : next;
+}
+
+int AcqDaemon::s_store( void* user, int channel, const TDecodedFrame_t& frame, const TCurrentValues_t& )
+{
+    AcqDaemon* daemon = static_cast<AcqDaemon*>( user );
+    if( daemon->bus.isOpen() ) daemon->bus.publish( channel, frame );
+    int status = ERR_GEN_FUNCTIONFAILED;
+    {
+        std::lock_guard<std::mutex> guard( daemon->capture_lock );
+        if( daemon->capture.isOpen() ) status = daemon->capture.appendFrame( channel, frame );
+        if( status != ERR_NOERROR ){
+            daemon->store_errors++;
+            return status;
+        }
+        if( daemon->job.RotateMB == 0 || daemon->capture.bytesWritten() < (long long)daemon->job.RotateMB * 1024 * 1024 ) return status;
+    }
+    return daemon->rotate();
+}
+
+int AcqDaemon::stopTechniques()
+{
+    {
+        std::lock_guard<std::mutex> guard( lock );
+        if( state != DMN_RUNNING ) return state == DMN_STOPPING ? ERR_NOERROR : ERR_GEN_FUNCTIONFAILED;
+        state = DMN_STOPPING;
+    }
+    changed.notify_all();
+    uint8 mask[ACQ_MAX_CHANNELS] = { 0 };
+    int results[ACQ_MAX_CHANNELS];
+    for( size_t c = 0; c < job.Channels.size(); c++ ) mask[job.Channels[c]] = 1;
+    return eclib->BL_StopChannels( session->id(), mask, results, ACQ_MAX_CHANNELS );
+}
+
+void AcqDaemon::stop( bool techniques )
+{
+    if( techniques ){
+        stopTechniques();
+        return;
+    }
+    std::lock_guard<std::mutex> guard( lock );
+    quitting = true;
+}
+
+bool AcqDaemon::wait( unsigned int ms )
+{
+    std::unique_lock<std::mutex> guard( lock );
+    return changed.wait_for( guard, std::chrono::milliseconds( ms ), [&](){ return state == DMN_DONE; } );
+}
+
+void AcqDaemon::finish()
+{
+    /* the frames queued are stored first */
+    if( acquisition ) acquisition->stop();
+    bus.close();
+    {
+        std::lock_guard<std::mutex> guard( capture_lock );
+        if( capture.isOpen() ){
+            if( capture.close() != ERR_NOERROR ) store_errors++;
+            closed_bytes += capture.bytesWritten();
+        }
+    }
+    {
+        std::lock_guard<std::mutex> guard( lock );
+        state = DMN_DONE;
+    }
+    changed.notify_all();
+}
+
+TDaemonStatus_t AcqDaemon::status() const
+{
+    TDaemonStatus_t s;
+    TAcqStats_t stats;
+    memset( &stats, 0, sizeof(stats) );
+    if( acquisition ) stats = acquisition->stats();
+    s.Polls       = stats.Polls;
+    s.Frames      = stats.Frames;
+    s.Points      = stats.Points;
+    s.Waits       = stats.Waits;
+    s.Skipped     = 0;
+    s.Running     = s.Done = s.Failed = 0;
+    std::vector<TAcqChannelState_t> list = channels();
+    for( size_t c = 0; c < list.size(); c++ ){
+        s.Skipped += list[c].Skipped;
+        if( list[c].State == ACQ_CHANNEL_RUNNING )   s.Running++;
+        else if( list[c].State == ACQ_CHANNEL_DONE ) s.Done++;
+        else if( list[c].State == ACQ_CHANNEL_FAILED ) s.Failed++;
+    }
+    {
+        std::lock_guard<std::mutex> guard( capture_lock );
+        s.Capture      = capture_path;
+        s.Captures     = captures;
+        s.CaptureBytes = closed_bytes + ( capture.isOpen() ? capture.bytesWritten() + capture.pendingBytes() : 0 );
+        s.StoreErrors  = store_errors + stats.StoreErrors;
+    }
+    s.Reconnects  = session ? session->stats().Reconnects : 0;
+    s.MemoryBytes = s_memoryBytes();
+    s.CpuSeconds  = s_cpuSeconds();
+    std::lock_guard<std::mutex> guard( lock );
+    s.State    = state;
+    s.Seconds  = state == DMN_IDLE ? 0.0 : ( s_clockNs() - origin ) * 1e-9;
+    s.Commands = commands;
+    s.PointsPerSecond = 0.0;
+    if( samples.size() > 1 && samples.back().first > samples.front().first ){
+        s.PointsPerSecond = ( samples.back().second - samples.front().second ) / ( samples.back().first - samples.front().first );
+    }
+    return s;
+}
+
+std::vector<TAcqChannelState_t> AcqDaemon::channels() const
+{
+    return acquisition ? acquisition->channels() : std::vector<TAcqChannelState_t>();
+}
+
+void AcqDaemon::run()
+{
+    long long next = s_clockNs();
+    long long flushed = next;
+    for( ;; ){
+        long long now = s_clockNs();
+        if( now - flushed >= DMN_FLUSH_SECONDS * 1000000000LL ){
+            /* a chunk may take hours to fill at low rates: a crash must not lose them */
+            std::lock_guard<std::mutex> guard( capture_lock );
+            if( capture.isOpen() && capture.flush() != ERR_NOERROR ) store_errors++;
+            flushed = now;
+        }
+        bool quit;
+        {
+            std::lock_guard<std::mutex> guard( lock );
+            if( stopping ) break;
+            quit = quitting;
+            if( now >= next ){
+                samples.push_back( std::make_pair( ( now - origin ) * 1e-9, acquisition->stats().Points ) );
+                while( samples.size() > DMN_RATE_WINDOW + 1 ) samples.pop_front();
+                next = now + 1000000000LL;
+            }
+        }
+        if( state != DMN_DONE && ( quit || acquisition->isDone() ) ) finish();
+
+        long long left = next - s_clockNs();
+        if( left > DMN_SELECT_MS * 1000000LL ) left = DMN_SELECT_MS * 1000000LL;
+        if( (TSocket_t)listener == DMN_NO_SOCKET ){
+            std::unique_lock<std::mutex> guard( lock );
+            changed.wait_for( guard, std::chrono::nanoseconds( left > 0 ? left : 0 ), [&](){ return stopping || quitting != quit; } );
+            continue;
+        }
+        TSocket_t s = (TSocket_t)listener;
+        if( s_readable( s, s_clockNs() + ( left > 0 ? left : 0 ) ) ){
+            TSocket_t client = accept( s, 0, 0 );
+            if( client != DMN_NO_SOCKET ){
+                s_noSigpipe( client );
+                answer( (long long)client );
+            }
+        }
+    }
+}
+
+void AcqDaemon::answer( long long socket )
+{
+    TSocket_t client = (TSocket_t)socket;
+    char request[DMN_COMMAND_SIZE + 1];
+    size_t size = 0;
+    bool failed = false;
+    long long until = s_clockNs() + DMN_COMMAND_MS * 1000000LL;
+    while( size < DMN_COMMAND_SIZE && s_readable( client, until ) ){
+        int n = (int)recv( client, request + size, (int)( DMN_COMMAND_SIZE - size ), 0 );
+        if( n <= 0 ){
+            /* reset, or closed before a command: nobody to answer */
+            failed = ( n < 0 || size == 0 );
+            break;
+        }
+        size += n;
+        if( memchr( request, '\n', size ) ) break;
+    }
+    if( failed ){
+        s_closeSocket( client );
+        return;
+    }
+    request[size] = '\0';
+    char* eol = strpbrk( request, "\r\n" );
+    if( eol ) *eol = '\0';
+    std::string command( request );
+    while( !command.empty() && ( command[0] == ' ' || command[0] == '\t' ) ) command.erase( 0, 1 );
+    while( !command.empty() && ( command[command.size() - 1] == ' ' || command[command.size() - 1] == '\t' ) ) command.erase( command.size() - 1 );
+
+    s_send( client, execute( command ) );
+    s_closeSocket( client );
+    std::lock_guard<std::mutex> guard( lock );
+    commands++;
+}
+
+std::string AcqDaemon::execute( const std::string& command )
+{
+    char line[256];
+    std::string out;
+    if( command == "status" ){
+        TDaemonStatus_t s = status();
+        snprintf( line, sizeof(line), "state %s\ndevice %s\n", DMN_StateName( s.State ), job.Device.c_str() );
+        out += line;
+        snprintf( line, sizeof(line), "seconds %.3f\npolls %llu\nframes %llu\npoints %llu\npoints_per_s %.1f\nskipped %llu\n",
+                  s.Seconds, s.Polls, s.Frames, s.Points, s.PointsPerSecond, s.Skipped );
+        out += line;
+        snprintf( line, sizeof(line), "channels_running %d\nchannels_done %d\nchannels_failed %d\n", s.Running, s.Done, s.Failed );
+        out += line;
+        out += "capture " + s.Capture + "\n";
+        if( !job.Publish.empty() ) out += "publish " + job.Publish + "\n";
+        snprintf( line, sizeof(line), "captures %u\ncapture_bytes %lld\nstore_errors %llu\nwaits %llu\nreconnects %llu\n",
+                  s.Captures, s.CaptureBytes, s.StoreErrors, s.Waits, s.Reconnects );
+        out += line;
+        snprintf( line, sizeof(line), "memory_bytes %lld\ncpu_seconds %.3f\ncommands %llu\n", s.MemoryBytes, s.CpuSeconds, s.Commands );
+        out += line;
+        return out + "OK\n";
+    }
+    if( command == "channels" ){
+        static const char* names[] = { "idle", "running", "done", "failed" };
+        std::vector<TAcqChannelState_t> list = channels();
+        for( size_t c = 0; c < list.size(); c++ ){
+            const TAcqChannelState_t& ch = list[c];
+            snprintf( line, sizeof(line), "channel %d %s polls %llu points %llu skipped %llu errors %llu status %d\n",
+                      ch.Channel + 1, names[ch.State & 3], ch.Polls, ch.Points, ch.Skipped, ch.Errors, ch.Status );
+            out += line;
+        }
+        return out + "OK\n";
+    }
+    if( command == "rotate" ){
+        return rotate() == ERR_NOERROR ? "OK\n" : "ERROR no capture file open\n";
+    }
+    if( command == "stop" ){
+        return stopTechniques() == ERR_NOERROR ? "OK\n" : "ERROR not running\n";
+    }
+    if( command == "quit" ){
+        std::lock_guard<std::mutex> guard( lock );
+        quitting = true;
+        return "OK\n";
+    }
+    return "ERROR unknown command '" + command + "' (status, channels, rotate, stop, quit)\n";
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#ifndef _ACQDAEMON_H_
+#define _ACQDAEMON_H_
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Acquisition.h"
+#include "CaptureFile.h"
+#include "DeviceSession.h"
+#include "JobFile.h"
+#include "LiveBus.h"
+
+/*
+ * Headless acquisition daemon
+ *
+ * The daemon runs a job (see JobFile.h) without window: it connects to the
+ * device through a DeviceSession, loads the chain on the channels with a
+ * TechniqueCache, starts them and drains them with an Acquisition into capture
+ * files. Once a capture file reaches the size given by the job it is closed
+ * and the next one is opened: the index of the chunks kept by the writer stays
+ * small, and the memory of the program does not grow with the length of the run.
+ * With "publish" in the job, the frames are also published in shared memory for
+ * the local programs which want the live data (see LiveBus.h).
+ *
+ * It is controlled over a TCP socket on 127.0.0.1, one command per connection:
+ * a line of text, answered by lines of text of which the last is "OK" or
+ * "ERROR <reason>".
+ *
+ *     status    "name value" lines: state, time, points, rate, channels, capture
+ *               files, memory and CPU of the process
+ *     channels  a line per channel: state, polls, points, points dropped
+ *     rotate    closes the capture file and opens the next one
+ *     stop      stops the techniques; the daemon is done once the channels are drained
+ *     quit      ends the acquisition now, the techniques keep running on the instrument
+ */
+
+/**
+ * \defgroup acq_daemon Acquisition daemon
+ * @{
+ */
+
+/** Seconds over which the rate of the points is measured */
+#define DMN_RATE_WINDOW     (10)
+
+/** State of an \ref AcqDaemon */
+typedef enum {
+    DMN_IDLE     = 0, /*!< not started */
+    DMN_RUNNING  = 1, /*!< acquiring */
+    DMN_STOPPING = 2, /*!< techniques stopped, the channels are drained */
+    DMN_DONE     = 3  /*!< every channel ended, or quit: the capture files are closed */
+} TDaemonState_e;
+
+/** Status of an \ref AcqDaemon */
+typedef struct {
+    int                State;           /*!< see \ref TDaemonState_e */
+    double             Seconds;         /*!< since the start */
+    unsigned long long Polls;
+    unsigned long long Frames;          /*!< stored */
+    unsigned long long Points;          /*!< stored */
+    double             PointsPerSecond; /*!< over the last \ref DMN_RATE_WINDOW seconds */
+    unsigned long long Skipped;         /*!< points dropped by the instrument (IRQskipped) */
+    int                Running;         /*!< channels drained */
+    int                Done;            /*!< channels whose techniques ended */
+    int                Failed;          /*!< channels on which BL_GetData failed */
+    std::string        Capture;         /*!< capture file written */
+    unsigned int       Captures;        /*!< capture files opened */
+    long long          CaptureBytes;    /*!< bytes written to all of them, and gathered for the open one */
+    unsigned long long StoreErrors;     /*!< frames which could not be written */
+    unsigned long long Waits;           /*!< times the polls waited for the storage */
+    unsigned long long Reconnects;      /*!< of the session */
+    long long          MemoryBytes;     /*!< resident memory of the process, -1 if unknown */
+    double             CpuSeconds;      /*!< CPU time of the process */
+    unsigned long long Commands;        /*!< commands answered */
+} TDaemonStatus_t;
+
+/** Name of a state, as given by the "status" command */
+const char* DMN_StateName( int state );
+
+/**
+ * This function sends a command to a daemon and reads its answer.
+ * @param port control port of the daemon on 127.0.0.1
+ * @param answer lines of the answer, the last "OK" or "ERROR ..." included
+ * @return \ref ERR_NOERROR if the daemon answered OK, \ref ERR_GEN_NOTCONNECTED if it cannot be
+ *         reached, \ref ERR_GEN_FUNCTIONFAILED if it answered an error.
+ */
+int DMN_Command( int port, const char* command, std::string* answer, unsigned int timeout_ms = 5000 );
+
+/**
+ * This function gives a value of the answer of a "status" command.
+ * @return the value, or 'fallback' if the name is not in the answer
+ */
+double DMN_StatusValue( const std::string& answer, const char* name, double fallback = -1.0 );
+
+/**
+ * This class runs a job.
+ */
+class AcqDaemon
+{
+public:
+    /** @param eclib functions of the library, kept while the daemon runs */
+    AcqDaemon( const TEClibFunctions* eclib );
+    ~AcqDaemon();
+
+    /**
+     * This function connects, loads and starts the channels of the job, opens the
+     * capture file and the control socket, and starts the acquisition.
+     * @param error optional, set to the reason of a failure
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_FUNCTIONINPROGRESS if already started,
+     *         \ref ERR_GEN_FILENOTEXISTS if the .ecc folder is not found, otherwise the error of
+     *         the step which failed.
+     */
+    int start( const TAcqJob_t& job, std::string* error = 0 );
+
+    /**
+     * This function ends the run, as the "stop" command (techniques true) or the
+     * "quit" command (false). With the techniques stopped, \ref wait tells when the
+     * channels are drained.
+     */
+    void stop( bool techniques );
+
+    /** Waits until the daemon is done, at most 'ms'; true if done */
+    bool wait( unsigned int ms );
+
+    /** Closes the capture file and opens the next one (numbered as \ref JOB_CaptureName) */
+    int rotate();
+
+    TDaemonStatus_t status() const;
+    std::vector<TAcqChannelState_t> channels() const;
+
+    /** Port of the control socket, -1 if none */
+    int port() const { return bound; }
+
+private:
+    AcqDaemon( const AcqDaemon& );
+    AcqDaemon& operator=( const AcqDaemon& );
+
+    static int s_store( void* user, int channel, const TDecodedFrame_t& frame, const TCurrentValues_t& curr );
+
+    void run();
+    void answer( long long socket );
+    std::string execute( const std::string& command );
+    int  stopTechniques();
+    int  openCapture();
+    void finish();
+
+    const TEClibFunctions*         eclib;
+    TAcqJob_t                      job;
+    std::unique_ptr<DeviceSession> session;
+    std::unique_ptr<Acquisition>   acquisition;
+    long long                      origin;        /* ns, steady clock */
+
+    mutable std::mutex             capture_lock;
+    CaptureWriter                  capture;
+    std::string                    capture_path;
+    unsigned int                   captures;      /* files opened */
+    long long                      closed_bytes;  /* written to the files closed */
+    unsigned long long             store_errors;
+    BusPublisher                   bus;           /* used by the storage thread only */
+
+    mutable std::mutex             lock;          /* state and rate */
+    std::condition_variable        changed;
+    int                            state;
+    bool                           stopping;      /* the thread ends */
+    bool                           quitting;      /* the acquisition ends now */
+    std::deque<std::pair<double, unsigned long long> > samples;  /* (s, points), once a second */
+    unsigned long long             commands;
+
+    long long                      listener;
+    int                            bound;
+    std::thread                    worker;
+};
+
+/** @} */
+
+#endif /* _ACQDAEMON_H_ */
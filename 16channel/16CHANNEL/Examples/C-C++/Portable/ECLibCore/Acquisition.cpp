@@ -0,0 +1,275 @@
+#include "Acquisition.h"
+
+#include <string.h>
+#include <chrono>
+
+static long long s_nowNs(){
+    return (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+TAcqConfig_t ACQ_DefaultConfig()
+{
+    TAcqConfig_t config;
+    config.Pressure    = BUF_DefaultConfig();
+    config.QueueFrames = 64;
+    config.MaxWaitMs   = 50;
+    config.Vmp4        = false;
+    return config;
+}
+
+Acquisition::Acquisition( const TEClibFunctions* eclib, DeviceSession* session, const TAcqConfig_t& config )
+    : eclib( eclib ), session( session ), config( config ), tracker( config.Pressure )
+    , frame_function( 0 ), frame_user( 0 ), channel_function( 0 ), channel_user( 0 )
+    , running( 0 ), started( false ), stopping( false ), origin( s_nowNs() )
+    , head( 0 ), tail( 0 ), closed( false )
+{
+    if( this->config.QueueFrames == 0 ) this->config.QueueFrames = 1;
+    memset( states, 0, sizeof(states) );
+    for( int ch = 0; ch < ACQ_MAX_CHANNELS; ch++ ) states[ch].Channel = ch;
+    memset( &counters, 0, sizeof(counters) );
+}
+
+Acquisition::~Acquisition()
+{
+    stop();
+}
+
+void Acquisition::setFrameFunction( TAcqFrameFunction_t function, void* user )
+{
+    frame_function = function;
+    frame_user     = user;
+}
+
+void Acquisition::setChannelFunction( TAcqChannelFunction_t function, void* user )
+{
+    channel_function = function;
+    channel_user     = user;
+}
+
+double Acquisition::now() const
+{
+    return ( s_nowNs() - origin ) * 1e-9;
+}
+
+int Acquisition::addChannel( uint8 channel, int xrec )
+{
+    if( !eclib || !session || channel >= ACQ_MAX_CHANNELS ) return ERR_GEN_INVALIDPARAMETERS;
+    if( started ) return ERR_GEN_FUNCTIONINPROGRESS;
+
+    TChannelInfos_t infos;
+    int status = eclib->BL_GetChannelInfos( session->id(), channel, &infos );
+    if( status != ERR_NOERROR ) return status;
+    infos.Channel = channel;
+    status = tracker.track( infos );
+    if( status != ERR_NOERROR ) return status;
+    session->track( channel );
+
+    std::lock_guard<std::mutex> guard( lock );
+    if( states[channel].State != ACQ_CHANNEL_RUNNING ) running++;
+    states[channel].State = ACQ_CHANNEL_RUNNING;
+    states[channel].Xrec  = xrec;
+    return ERR_NOERROR;
+}
+
+int Acquisition::start()
+{
+    {
+        std::lock_guard<std::mutex> guard( lock );
+        if( started ) return ERR_GEN_FUNCTIONINPROGRESS;
+        if( running == 0 ) return ERR_GEN_NOCHANNELELECTED;
+        started = true;
+    }
+    slots.reset( new TSlot_t[config.QueueFrames] );
+    origin = s_nowNs();
+    storer = std::thread( &Acquisition::store, this );
+    poller = std::thread( &Acquisition::poll, this );
+    return ERR_NOERROR;
+}
+
+void Acquisition::stop()
+{
+    {
+        std::lock_guard<std::mutex> guard( lock );
+        stopping = true;
+    }
+    changed.notify_all();
+    queue_changed.notify_all();
+    if( poller.joinable() ) poller.join();
+    if( storer.joinable() ) storer.join();
+}
+
+bool Acquisition::isDone() const
+{
+    std::lock_guard<std::mutex> guard( lock );
+    return started && ( running == 0 || stopping );
+}
+
+bool Acquisition::wait( unsigned int ms )
+{
+    std::unique_lock<std::mutex> guard( lock );
+    return changed.wait_for( guard, std::chrono::milliseconds( ms ),
+                             [&](){ return started && ( running == 0 || stopping ); } );
+}
+
+std::vector<TAcqChannelState_t> Acquisition::channels() const
+{
+    std::lock_guard<std::mutex> guard( lock );
+    std::vector<TAcqChannelState_t> list;
+    for( int ch = 0; ch < ACQ_MAX_CHANNELS; ch++ ){
+        if( states[ch].State != ACQ_CHANNEL_IDLE ) list.push_back( states[ch] );
+    }
+    return list;
+}
+
+TAcqStats_t Acquisition::stats() const
+{
+    std::lock_guard<std::mutex> guard( lock );
+    TAcqStats_t copy = counters;
+    if( started ) copy.Seconds = now();
+    return copy;
+}
+
+void Acquisition::end( int channel, int state, int status )
+{
+    tracker.untrack( (uint8)channel );
+    TAcqChannelState_t copy;
+    {
+        std::lock_guard<std::mutex> guard( lock );
+        states[channel].State  = state;
+        states[channel].Status = status;
+        running--;
+        copy = states[channel];
+    }
+    changed.notify_all();
+    if( channel_function ) channel_function( channel_user, copy );
+}
+
+void Acquisition::poll()
+{
+    std::unique_ptr<TDataBuffer_t> buf( new TDataBuffer_t );
+    TDataInfos_t infos;
+    TCurrentValues_t curr;
+    unsigned int backlog = 0;   /* channels with points left in their memory after a read */
+    int last = -1;
+    for( ;; ){
+        double wait = 0.0;
+        int ch = tracker.next( now(), &wait );
+        if( ch < 0 ) break;
+        if( wait > 0.0 && backlog ){
+            /* nothing due: the channels with a backlog are read in turn, back to back */
+            do {
+                last = ( last + 1 ) % ACQ_MAX_CHANNELS;
+            } while( !( backlog & ( 1u << last ) ) );
+            ch = last;
+            wait = 0.0;
+        }
+        if( wait > 0.0 ){
+            std::unique_lock<std::mutex> guard( lock );
+            long long ms = (long long)( wait * 1000.0 ) + 1;
+            if( ms > (long long)config.MaxWaitMs ) ms = config.MaxWaitMs;
+            changed.wait_for( guard, std::chrono::milliseconds( ms ), [&](){ return stopping; } );
+            if( stopping ) break;
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> guard( lock );
+            if( stopping ) break;
+        }
+
+        int status = session->getData( (uint8)ch, buf.get(), &infos, &curr );
+        if( status != ERR_NOERROR ){
+            backlog &= ~( 1u << ch );
+            end( ch, ACQ_CHANNEL_FAILED, status );
+            continue;
+        }
+        tracker.update( (uint8)ch, infos, curr, now() );
+        if( infos.NbRows > 0 && curr.MemFilled > 0 ) backlog |= 1u << ch;
+        else backlog &= ~( 1u << ch );
+        {
+            std::lock_guard<std::mutex> guard( lock );
+            counters.Polls++;
+            states[ch].Polls++;
+            if( infos.IRQskipped > 0 ) states[ch].Skipped += (unsigned long long)infos.IRQskipped;
+        }
+
+        if( infos.NbRows > 0 ){
+            /* a free frame; while the storage is late the points wait in the instrument */
+            TSlot_t* slot = 0;
+            long long waited = -1;
+            {
+                std::unique_lock<std::mutex> guard( queue_lock );
+                if( tail - head >= config.QueueFrames ){
+                    long long start = s_nowNs();
+                    queue_changed.wait( guard, [&](){ return tail - head < config.QueueFrames; } );
+                    waited = s_nowNs() - start;
+                }
+                slot = &slots[tail % config.QueueFrames];
+            }
+            int xrec = 0;
+            {
+                std::lock_guard<std::mutex> guard( lock );
+                if( waited >= 0 ){
+                    counters.Waits++;
+                    counters.WaitSeconds += waited * 1e-9;
+                }
+                xrec = states[ch].Xrec;
+            }
+            status = BL_DecodeData( *buf, infos, curr, config.Vmp4, xrec, eclib->BL_ConvertNumericIntoSingle, &slot->Frame );
+            {
+                std::lock_guard<std::mutex> guard( lock );
+                if( status != ERR_NOERROR ){
+                    states[ch].Errors++;
+                    continue;
+                }
+                states[ch].Frames++;
+                states[ch].Points += (unsigned long long)slot->Frame.NbRows;
+            }
+            slot->Curr    = curr;
+            slot->Channel = ch;
+            unsigned int queued = 0;
+            {
+                std::lock_guard<std::mutex> guard( queue_lock );
+                tail++;
+                queued = (unsigned int)( tail - head );
+            }
+            queue_changed.notify_all();
+            std::lock_guard<std::mutex> guard( lock );
+            if( queued > counters.QueuePeak ) counters.QueuePeak = queued;
+        } else if( curr.State == KBIO_STATE_STOP ){
+            end( ch, ACQ_CHANNEL_DONE, ERR_NOERROR );
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> guard( queue_lock );
+        closed = true;
+    }
+    queue_changed.notify_all();
+    changed.notify_all();
+}
+
+void Acquisition::store()
+{
+    for( ;; ){
+        TSlot_t* slot = 0;
+        {
+            std::unique_lock<std::mutex> guard( queue_lock );
+            queue_changed.wait( guard, [&](){ return head != tail || closed; } );
+            if( head == tail ) break;
+            slot = &slots[head % config.QueueFrames];
+        }
+        int status = frame_function ? frame_function( frame_user, slot->Channel, slot->Frame, slot->Curr ) : ERR_NOERROR;
+        {
+            std::lock_guard<std::mutex> guard( lock );
+            counters.Frames++;
+            counters.Points += (unsigned long long)slot->Frame.NbRows;
+            if( status != ERR_NOERROR ) counters.StoreErrors++;
+        }
+        {
+            std::lock_guard<std::mutex> guard( queue_lock );
+            head++;
+        }
+        queue_changed.notify_all();
+    }
+}
@@ -0,0 +1,200 @@
+#pragma once
+
+#ifndef _ACQUISITION_H_
+#define _ACQUISITION_H_
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "BLDecode.h"
+#include "BLFunctionTable.h"
+#include "BufferPressure.h"
+#include "DeviceSession.h"
+
+/*
+ * Acquisition of the channels of a device, without window
+ *
+ * The data thread of the MFC sample (CMFCSample::populateData) reads a channel
+ * with BL_GetData until its technique stops and posts every buffer to the
+ * dialog. Here a poll thread drains all the channels of a device through a
+ * DeviceSession, in the order and at the periods given by a BufferPressure,
+ * and decodes the buffers as they come. A channel which still holds points
+ * after a read (a buffer holds 1000 words at most) is read again as soon as no
+ * other channel is due, as the sample does. A storage thread gives the decoded
+ * frames to a frame function (capture file, export, publication, ...).
+ *
+ * The two threads share a queue of a fixed number of frames. When the storage
+ * is late the poll thread waits for a free frame and the points wait in the
+ * memory of the instrument: the memory of the program does not grow with the
+ * length of the run. A channel is done once its techniques stopped and its
+ * memory is drained, or once BL_GetData failed on it (as in the sample); the
+ * acquisition ends when all its channels are done, or when it is stopped.
+ */
+
+/**
+ * \defgroup acquisition Acquisition
+ * @{
+ */
+
+/** Channels of a device, 0..ACQ_MAX_CHANNELS-1 */
+#define ACQ_MAX_CHANNELS    (16)
+
+/** Channel of an \ref Acquisition */
+typedef enum {
+    ACQ_CHANNEL_IDLE    = 0, /*!< not acquired */
+    ACQ_CHANNEL_RUNNING = 1, /*!< drained */
+    ACQ_CHANNEL_DONE    = 2, /*!< the techniques stopped and the memory is drained */
+    ACQ_CHANNEL_FAILED  = 3  /*!< BL_GetData failed, see Status */
+} TAcqChannel_e;
+
+/** Settings of an \ref Acquisition */
+typedef struct {
+    TBufferPressureConfig_t Pressure;    /*!< poll periods of the channels */
+    unsigned int            QueueFrames; /*!< frames between the poll and the storage threads */
+    unsigned int            MaxWaitMs;   /*!< longest sleep of the poll thread */
+    bool                    Vmp4;        /*!< the device uses the VMP4 technology, see \ref BL_DecodeData */
+} TAcqConfig_t;
+
+/** A channel of an \ref Acquisition */
+typedef struct {
+    int                Channel;
+    int                State;      /*!< see \ref TAcqChannel_e */
+    int                Status;     /*!< error of BL_GetData if failed */
+    int                Xrec;       /*!< extra values recorded, as given to the "xctr" parameter */
+    unsigned long long Polls;
+    unsigned long long Frames;     /*!< frames decoded */
+    unsigned long long Points;
+    unsigned long long Skipped;    /*!< points dropped by the instrument (IRQskipped) */
+    unsigned long long Errors;     /*!< buffers which could not be decoded */
+} TAcqChannelState_t;
+
+/** Counters of an \ref Acquisition */
+typedef struct {
+    unsigned long long Polls;
+    unsigned long long Frames;      /*!< given to the frame function */
+    unsigned long long Points;
+    unsigned long long StoreErrors; /*!< frames for which the frame function failed */
+    unsigned long long Waits;       /*!< times the poll thread waited for a free frame */
+    double             WaitSeconds; /*!< time it waited */
+    unsigned int       QueuePeak;   /*!< most frames queued at once */
+    double             Seconds;     /*!< since the start */
+} TAcqStats_t;
+
+/**
+ * Called with each decoded frame, from the storage thread, in the order of the
+ * frames of each channel.
+ * @return \ref ERR_NOERROR if the frame is stored, another code counts a store error.
+ */
+typedef int (*TAcqFrameFunction_t)( void* user, int channel, const TDecodedFrame_t& frame, const TCurrentValues_t& curr );
+
+/** Called when a channel is done or failed, from the poll thread */
+typedef void (*TAcqChannelFunction_t)( void* user, const TAcqChannelState_t& channel );
+
+/** Default settings: those of \ref BUF_DefaultConfig, 64 frames queued, sleeps of 50 ms at most */
+TAcqConfig_t ACQ_DefaultConfig();
+
+/**
+ * This class acquires the channels of a device. The functions are called from
+ * one thread; the counters may be read from any.
+ */
+class Acquisition
+{
+public:
+    /**
+     * @param eclib functions of the library, for BL_GetChannelInfos and the conversions
+     * @param session connection to the device, kept during the acquisition
+     */
+    Acquisition( const TEClibFunctions* eclib, DeviceSession* session, const TAcqConfig_t& config = ACQ_DefaultConfig() );
+    ~Acquisition();
+
+    /** Function called with the frames, may be null; before \ref start */
+    void setFrameFunction( TAcqFrameFunction_t function, void* user );
+
+    /** Function called when a channel ends, may be null; before \ref start */
+    void setChannelFunction( TAcqChannelFunction_t function, void* user );
+
+    /**
+     * This function adds a channel to drain, whose technique is loaded; its memory is
+     * read with BL_GetChannelInfos.
+     * @param xrec extra values recorded by the technique ("xctr" parameter)
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_INVALIDPARAMETERS if the channel
+     *         is not 0..15, \ref ERR_GEN_FUNCTIONINPROGRESS once started, the error of
+     *         BL_GetChannelInfos otherwise.
+     */
+    int addChannel( uint8 channel, int xrec = 0 );
+
+    /**
+     * This function starts the poll and the storage threads.
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_NOCHANNELELECTED if no channel was
+     *         added, \ref ERR_GEN_FUNCTIONINPROGRESS if already started.
+     */
+    int start();
+
+    /**
+     * This function stops the polls, gives the frames queued to the frame function
+     * and ends the threads. The techniques are not stopped on the instrument.
+     */
+    void stop();
+
+    /** True once every channel is done or failed (or the acquisition stopped) */
+    bool isDone() const;
+
+    /** Waits until \ref isDone, at most 'ms'; true if done */
+    bool wait( unsigned int ms );
+
+    std::vector<TAcqChannelState_t> channels() const;
+    TAcqStats_t stats() const;
+
+    /** Memory of the channels, as followed by the poll thread */
+    const BufferPressure& pressure() const { return tracker; }
+
+private:
+    Acquisition( const Acquisition& );
+    Acquisition& operator=( const Acquisition& );
+
+    typedef struct {
+        TDecodedFrame_t  Frame;
+        TCurrentValues_t Curr;
+        int              Channel;
+    } TSlot_t;
+
+    void poll();
+    void store();
+    void end( int channel, int state, int status );
+    double now() const;
+
+    const TEClibFunctions*     eclib;
+    DeviceSession*             session;
+    TAcqConfig_t               config;
+    BufferPressure             tracker;
+    TAcqFrameFunction_t        frame_function;
+    void*                      frame_user;
+    TAcqChannelFunction_t      channel_function;
+    void*                      channel_user;
+
+    mutable std::mutex         lock;          /* channels, counters and the state */
+    std::condition_variable    changed;
+    TAcqChannelState_t         states[ACQ_MAX_CHANNELS];
+    TAcqStats_t                counters;
+    int                        running;       /* channels not done */
+    bool                       started;
+    bool                       stopping;
+    long long                  origin;        /* ns, steady clock */
+
+    std::mutex                 queue_lock;
+    std::condition_variable    queue_changed;
+    std::unique_ptr<TSlot_t[]> slots;
+    unsigned long long         head;          /* next frame to store */
+    unsigned long long         tail;          /* next frame to fill */
+    bool                       closed;        /* no more frames */
+
+    std::thread                poller;
+    std::thread                storer;
+};
+
+/** @} */
+
+#endif /* _ACQUISITION_H_ */
@@ -0,0 +1,102 @@
+#include "BLDecode.h"
+
+#include <string.h>
+
+int BL_STDCALL BL_NativeConvertNumericIntoSingle( unsigned int num, float* psgl )
+{
+    if( !psgl ) return ERR_GEN_INVALIDPARAMETERS;
+    memcpy( psgl, &num, sizeof(float) );
+    return ERR_NOERROR;
+}
+
+int BL_DecodeData( const TDataBuffer_t& buf, const TDataInfos_t& infos, const TCurrentValues_t& curr,
+                   bool vmp4, int xrec, BL_CONVERT_FP convert, TDecodedFrame_t* frame )
+{
+    if( !frame ) return ERR_GEN_INVALIDPARAMETERS;
+    if( !convert ) convert = BL_NativeConvertNumericIntoSingle;
+
+    frame->TechniqueID    = infos.TechniqueID;
+    frame->TechniqueIndex = infos.TechniqueIndex;
+    frame->ProcessIndex   = infos.ProcessIndex;
+    frame->Loop           = infos.loop;
+    frame->NbRows         = 0;
+    frame->Xrec           = xrec;
+    frame->NbExtra        = 0;
+
+    /* words per row before the extra values, see the layouts in BLDecode.h */
+    int base_cols;
+    switch( infos.TechniqueID ){
+    case KBIO_TECHID_OCV:
+        base_cols     = vmp4 ? 3 : 4;
+        frame->Fields = vmp4 ? BL_FIELD_EWE : ( BL_FIELD_EWE | BL_FIELD_ECE );
+        break;
+    case KBIO_TECHID_CA: /* CP and CA share the same data format */
+    case KBIO_TECHID_CP:
+        base_cols     = 5;
+        frame->Fields = BL_FIELD_EWE | BL_FIELD_I | BL_FIELD_CYCLE;
+        break;
+    case KBIO_TECHID_CV:
+        base_cols     = 6;
+        frame->Fields = BL_FIELD_CONTROL | BL_FIELD_EWE | BL_FIELD_I | BL_FIELD_CYCLE;
+        break;
+    default:
+        frame->Fields = 0;
+        return ERR_GEN_INVALIDPARAMETERS;
+    }
+
+    if( infos.NbRows == 0 ) return ERR_NOERROR;
+
+    if( infos.NbRows < 0 || infos.NbCols < base_cols || infos.NbRows * infos.NbCols > 1000 ){
+        return ERR_GEN_INVALIDPARAMETERS;
+    }
+
+    int nb_extra = infos.NbCols - base_cols;
+    if( nb_extra > BL_FRAME_MAX_EXTRA ) nb_extra = BL_FRAME_MAX_EXTRA;
+    frame->NbExtra = nb_extra;
+
+    int status = ERR_NOERROR;
+    for( int i=0; i<infos.NbRows; i++ ){
+        const unsigned int* row = &buf.data[i * infos.NbCols];
+
+        unsigned long long t_64 = ((unsigned long long)row[0] << 32) + row[1];
+        /* in double: the float product of the MFC sample loses the ms after a few minutes */
+        frame->Time[i] = infos.StartTime + (double)curr.TimeBase * (double)t_64;
+
+        switch( infos.TechniqueID ){
+        case KBIO_TECHID_OCV:
+            if( status == ERR_NOERROR ) status = convert( row[2], &frame->Ewe[i] );
+            if( !vmp4 && status == ERR_NOERROR ) status = convert( row[3], &frame->Ece[i] );
+            break;
+        case KBIO_TECHID_CA:
+        case KBIO_TECHID_CP:
+            if( status == ERR_NOERROR ) status = convert( row[2], &frame->Ewe[i] );
+            if( status == ERR_NOERROR ) status = convert( row[3], &frame->I[i] );
+            frame->Cycle[i] = row[4];
+            break;
+        case KBIO_TECHID_CV:
+            if( status == ERR_NOERROR ) status = convert( row[2], &frame->Control[i] );
+            if( status == ERR_NOERROR ) status = convert( row[3], &frame->I[i] );
+            if( status == ERR_NOERROR ) status = convert( row[4], &frame->Ewe[i] );
+            frame->Cycle[i] = row[5];
+            break;
+        }
+
+        for( int k=0; k<nb_extra; k++ ){
+            if( status == ERR_NOERROR ) status = convert( row[base_cols + k], &frame->Extra[k][i] );
+        }
+        if( status != ERR_NOERROR ) return status;
+    }
+
+    frame->NbRows = infos.NbRows;
+    return ERR_NOERROR;
+}
+
+int BL_ExtraIndex( int xrec, int nb_extra, int xrec_bit )
+{
+    if( !( xrec & xrec_bit ) ) return -1;
+    int idx = 0;
+    for( int bit = 1; bit < xrec_bit; bit <<= 1 ){
+        if( xrec & bit ) idx++;
+    }
+    return idx < nb_extra ? idx : -1;
+}
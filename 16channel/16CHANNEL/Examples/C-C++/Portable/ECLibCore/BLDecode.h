@@ -0,0 +1,114 @@
+#pragma once
+
+#ifndef _BLDECODE_H_
+#define _BLDECODE_H_
+
+#include <BLStructs.h>
+#include "BLPlatform.h"
+
+/*
+ * Decoding of the data buffers returned by BL_GetData
+ *
+ * Each row of a TDataBuffer_t holds TDataInfos_t::NbCols 32 bits words. The layout
+ * depends on the technique (see section 7. Techniques in the PDF):
+ *   - OCV:    t_high, t_low, Ewe [, Ece on VMP3 devices]
+ *   - CA, CP: t_high, t_low, Ewe, I, cycle
+ *   - CV:     t_high, t_low, Ec, I, Ewe, cycle
+ * followed by the extra values selected with the "xctr" parameter.
+ */
+
+/**
+ * \defgroup decoding Data decoding
+ * @{
+ */
+
+/** Maximum number of rows in a data buffer (the smallest row is 3 words) */
+#define BL_FRAME_MAX_ROWS  (1000 / 3 + 1)
+/** Maximum number of extra values per row (see \ref TExtraRecord_e) */
+#define BL_FRAME_MAX_EXTRA (6)
+
+#ifndef _TEXTRARECORD_E_
+#define _TEXTRARECORD_E_
+/* helper enum to ease the extra record flag manipulation (same as the MFC sample) */
+typedef enum {
+    XREC_CE   = (1 << 0),
+    XREC_AUX1 = (1 << 1),
+    XREC_AUX2 = (1 << 2),
+    // << 3 reserved
+    // << 4 reserved
+    XREC_CTL  = (1 << 5),
+    XREC_Q    = (1 << 6),
+    XREC_IRG  = (1 << 7)
+} TExtraRecord_e;
+#endif
+
+/** Fields of a \ref TDecodedFrame_t holding values */
+typedef enum {
+    BL_FIELD_EWE     = (1 << 0), /*!< Ewe (V) */
+    BL_FIELD_ECE     = (1 << 1), /*!< Ece (V) */
+    BL_FIELD_I       = (1 << 2), /*!< I (A) */
+    BL_FIELD_CYCLE   = (1 << 3), /*!< cycle number */
+    BL_FIELD_CONTROL = (1 << 4)  /*!< control value Ec (V) */
+} TDecodedField_e;
+
+/** A data buffer converted into physical values, one array per value */
+typedef struct {
+    int          TechniqueID;    /*!< technique which generated the data (see \ref TTechniqueIdentifier_e) */
+    int          TechniqueIndex; /*!< index of the technique in a linked techniques chain */
+    int          ProcessIndex;   /*!< process of the technique which generated the data */
+    int          Loop;           /*!< loop number */
+    int          NbRows;         /*!< number of decoded points */
+    int          Fields;         /*!< values available in this frame (see \ref TDecodedField_e) */
+    int          Xrec;           /*!< extra values recorded (see \ref TExtraRecord_e), in the order of the bits */
+    int          NbExtra;        /*!< number of extra values per point */
+    double       Time[BL_FRAME_MAX_ROWS];    /*!< time (s) */
+    float        Ewe[BL_FRAME_MAX_ROWS];     /*!< working electrode potential (V) */
+    float        Ece[BL_FRAME_MAX_ROWS];     /*!< counter electrode potential (V) */
+    float        I[BL_FRAME_MAX_ROWS];       /*!< current (A) */
+    float        Control[BL_FRAME_MAX_ROWS]; /*!< control potential (V) */
+    unsigned int Cycle[BL_FRAME_MAX_ROWS];   /*!< cycle number */
+    float        Extra[BL_FRAME_MAX_EXTRA][BL_FRAME_MAX_ROWS]; /*!< extra values */
+} TDecodedFrame_t;
+
+/** Pointer to a function with the signature of \ref BL_ConvertNumericIntoSingle */
+typedef int (BL_STDCALL *BL_CONVERT_FP)( unsigned int num, float* psgl );
+
+/**
+ * This function converts a value of the data buffer into a float without calling the DLL.
+ * The instruments send IEEE 754 single precision values, so the conversion is a plain
+ * reinterpretation of the bits; it is used when no conversion function is given to
+ * \ref BL_DecodeData.
+ */
+int BL_STDCALL BL_NativeConvertNumericIntoSingle( unsigned int num, float* psgl );
+
+/**
+ * This function decodes a data buffer returned by BL_GetData.
+ *
+ * @param buf data buffer
+ * @param infos data information returned with the buffer
+ * @param curr current values returned with the buffer (the time base is used)
+ * @param vmp4 true if the device uses the VMP4 technology (no Ece for OCV)
+ * @param xrec extra values recorded, as given to the "xctr" parameter
+ * @param convert conversion function (eclib->BL_ConvertNumericIntoSingle), or 0 to use
+ *              \ref BL_NativeConvertNumericIntoSingle
+ * @param frame decoded frame
+ * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_INVALIDPARAMETERS if the technique
+ *         is not supported or the number of columns does not match it, or the error
+ *         returned by the conversion function.
+ */
+int BL_DecodeData( const TDataBuffer_t& buf, const TDataInfos_t& infos, const TCurrentValues_t& curr,
+                   bool vmp4, int xrec, BL_CONVERT_FP convert, TDecodedFrame_t* frame );
+
+/**
+ * Returns the index in \ref TDecodedFrame_t::Extra of an extra value, or -1 if it was not recorded.
+ * The extra values follow the order of their bits in the "xctr" parameter.
+ *
+ * @param xrec extra values recorded (\ref TDecodedFrame_t::Xrec)
+ * @param nb_extra number of extra values per point (\ref TDecodedFrame_t::NbExtra)
+ * @param xrec_bit extra value (one bit of \ref TExtraRecord_e)
+ */
+int BL_ExtraIndex( int xrec, int nb_extra, int xrec_bit );
+
+/** @} */
+
+#endif /* _BLDECODE_H_ */
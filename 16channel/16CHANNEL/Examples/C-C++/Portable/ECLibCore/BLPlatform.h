@@ -0,0 +1,17 @@
+#pragma once
+
+#ifndef _BLPLATFORM_H_
+#define _BLPLATFORM_H_
+
+/*
+ * Platform helpers for the portable ECLib code
+ */
+
+/* The ECLib functions use the stdcall convention on Windows; it does not exist elsewhere. */
+#ifdef _WIN32
+#define BL_STDCALL __stdcall
+#else
+#define BL_STDCALL
+#endif
+
+#endif /* _BLPLATFORM_H_ */
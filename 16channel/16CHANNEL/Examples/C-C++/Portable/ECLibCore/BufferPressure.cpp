@@ -0,0 +1,190 @@
+#include "BufferPressure.h"
+
+#include <string.h>
+
+#define BUF_HIGH_FILL       (0.5)   /* part of the memory filled which makes the priority high */
+#define BUF_POLLS_BEFORE    (4)     /* polls left before the memory is full, at least */
+
+TBufferPressureConfig_t BUF_DefaultConfig()
+{
+    TBufferPressureConfig_t config;
+    config.PollMs        = 200;
+    config.MinPollMs     = 5;
+    config.HighSeconds   = 10.0;
+    config.UrgentSeconds = 2.0;
+    config.RateWindow    = 0.1;
+    config.Smoothing     = 0.3;
+    return config;
+}
+
+BufferPressure::BufferPressure( const TBufferPressureConfig_t& config )
+    : config( config ), function( 0 ), user( 0 )
+{
+}
+
+void BufferPressure::setSkipFunction( TBufferSkipFunction_t fn, void* data )
+{
+    std::lock_guard<std::mutex> guard( lock );
+    function = fn;
+    user     = data;
+}
+
+int BufferPressure::track( const TChannelInfos_t& infos )
+{
+    if( infos.Channel < 0 || infos.Channel >= 16 || infos.MemSize <= 0 ) return ERR_GEN_INVALIDPARAMETERS;
+    std::lock_guard<std::mutex> guard( lock );
+    TChannelPressure_t c;
+    memset( &c.State, 0, sizeof(c.State) );
+    c.State.Channel        = infos.Channel;
+    c.State.MemSize        = infos.MemSize;
+    c.State.MemFilled      = infos.MemFilled;
+    c.State.TimeToOverflow = -1.0;
+    c.State.PollMs         = config.PollMs;
+    c.Polled     = false;
+    c.Rated      = false;
+    c.LastPoll   = 0.0;
+    c.Since      = 0.0;
+    c.Recorded   = 0;
+    c.LastFilled = infos.MemFilled;
+    for( size_t i = 0; i < list.size(); i++ ){
+        if( list[i].State.Channel == infos.Channel ){
+            list[i] = c;
+            return ERR_NOERROR;
+        }
+    }
+    list.push_back( c );
+    return ERR_NOERROR;
+}
+
+void BufferPressure::untrack( uint8 channel )
+{
+    std::lock_guard<std::mutex> guard( lock );
+    for( size_t i = 0; i < list.size(); i++ ){
+        if( list[i].State.Channel == channel ){
+            list.erase( list.begin() + i );
+            return;
+        }
+    }
+}
+
+int BufferPressure::update( uint8 channel, const TDataInfos_t& infos, const TCurrentValues_t& curr, double time )
+{
+    TBufferSkipEvent_t event;
+    TBufferSkipFunction_t notify = 0;
+    void* data = 0;
+    int priority;
+    {
+        std::lock_guard<std::mutex> guard( lock );
+        size_t i = 0;
+        while( i < list.size() && list[i].State.Channel != channel ) i++;
+        if( i == list.size() ) return ERR_GEN_INVALIDPARAMETERS;
+        TChannelPressure_t& c = list[i];
+        TBufferChannelState_t& s = c.State;
+
+        long long read = ( infos.NbRows > 0 && infos.NbCols > 0 ) ? (long long)infos.NbRows * infos.NbCols * sizeof(unsigned int) : 0;
+        if( infos.IRQskipped > 0 ){
+            event.Channel        = channel;
+            event.Time           = time;
+            event.IRQskipped     = infos.IRQskipped;
+            event.MemFilled      = curr.MemFilled;
+            event.MemSize        = s.MemSize;
+            event.FillRate       = s.FillRate;
+            event.SincePoll      = c.Polled ? time - c.LastPoll : -1.0;
+            event.PollMs         = s.PollMs;
+            event.Priority       = s.Priority;
+            event.TechniqueIndex = infos.TechniqueIndex;
+            event.TechniqueID    = infos.TechniqueID;
+            event.NbRows         = infos.NbRows;
+            log.push_back( event );
+            if( log.size() > BUF_LOG_SIZE ) log.pop_front();
+            s.Skipped += infos.IRQskipped;
+            s.SkipEvents++;
+            notify = function;
+            data   = user;
+        }
+
+        /* what was recorded since the previous poll: the memory now, plus what was read, minus the memory then */
+        if( c.Polled ){
+            long long recorded = (long long)curr.MemFilled + read - c.LastFilled;
+            if( recorded > 0 ) c.Recorded += recorded;
+            double span = time - c.Since;
+            if( span >= config.RateWindow ){
+                double rate = c.Recorded / span;
+                s.FillRate = c.Rated ? s.FillRate + config.Smoothing * ( rate - s.FillRate ) : rate;
+                c.Rated    = true;
+                c.Since    = time;
+                c.Recorded = 0;
+            }
+        } else {
+            c.Since = time;
+        }
+        c.Polled     = true;
+        c.LastPoll   = time;
+        c.LastFilled = curr.MemFilled;
+        s.MemFilled  = curr.MemFilled;
+        s.Polls++;
+        s.BytesRead += read;
+        double fill = (double)s.MemFilled / s.MemSize;
+        if( fill > s.PeakFill ) s.PeakFill = fill;
+        evaluate( c, infos.IRQskipped > 0 );
+        priority = s.Priority;
+    }
+    if( notify ) notify( data, event );
+    return priority;
+}
+
+void BufferPressure::evaluate( TChannelPressure_t& c, bool skipped ) const
+{
+    TBufferChannelState_t& s = c.State;
+    s.TimeToOverflow = ( s.FillRate > 0.0 ) ? ( s.MemSize - s.MemFilled ) / s.FillRate : -1.0;
+    if( s.TimeToOverflow < 0.0 && c.Rated && s.MemFilled >= s.MemSize ) s.TimeToOverflow = 0.0;
+
+    if( skipped || ( s.TimeToOverflow >= 0.0 && s.TimeToOverflow < config.UrgentSeconds ) ){
+        s.Priority = BUF_PRIORITY_URGENT;
+    } else if( ( s.TimeToOverflow >= 0.0 && s.TimeToOverflow < config.HighSeconds ) || (double)s.MemFilled / s.MemSize >= BUF_HIGH_FILL ){
+        s.Priority = BUF_PRIORITY_HIGH;
+    } else {
+        s.Priority = BUF_PRIORITY_NORMAL;
+    }
+
+    /* a few polls before the memory is full; soon after the first poll to measure the rate; at once after a drop */
+    double period = config.PollMs;
+    if( s.TimeToOverflow >= 0.0 && s.TimeToOverflow * 1e3 / BUF_POLLS_BEFORE < period ) period = s.TimeToOverflow * 1e3 / BUF_POLLS_BEFORE;
+    if( !c.Rated && config.RateWindow * 1e3 < period ) period = config.RateWindow * 1e3;
+    if( skipped || period < config.MinPollMs ) period = config.MinPollMs;
+    s.PollMs = (unsigned int)period;
+}
+
+int BufferPressure::next( double time, double* wait ) const
+{
+    std::lock_guard<std::mutex> guard( lock );
+    int best = -1;
+    double best_due = 0.0;
+    int best_priority = 0;
+    for( size_t i = 0; i < list.size(); i++ ){
+        const TChannelPressure_t& c = list[i];
+        double due = c.Polled ? c.LastPoll + c.State.PollMs * 1e-3 : time;
+        if( due < time ) due = time;
+        if( best < 0 || due < best_due || ( due == best_due && c.State.Priority > best_priority ) ){
+            best          = c.State.Channel;
+            best_due      = due;
+            best_priority = c.State.Priority;
+        }
+    }
+    if( wait ) *wait = ( best < 0 ) ? 0.0 : best_due - time;
+    return best;
+}
+
+std::vector<TBufferChannelState_t> BufferPressure::channels() const
+{
+    std::vector<TBufferChannelState_t> states;
+    std::lock_guard<std::mutex> guard( lock );
+    for( size_t i = 0; i < list.size(); i++ ) states.push_back( list[i].State );
+    return states;
+}
+
+std::vector<TBufferSkipEvent_t> BufferPressure::skipLog() const
+{
+    std::lock_guard<std::mutex> guard( lock );
+    return std::vector<TBufferSkipEvent_t>( log.begin(), log.end() );
+}
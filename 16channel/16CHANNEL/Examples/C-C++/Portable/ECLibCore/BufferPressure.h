@@ -0,0 +1,159 @@
+#pragma once
+
+#ifndef _BUFFERPRESSURE_H_
+#define _BUFFERPRESSURE_H_
+
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include <BLStructs.h>
+
+/*
+ * Pressure on the memory of the channels
+ *
+ * A channel records its points in its own memory (MemSize bytes) until they are
+ * read with BL_GetData; when the memory is full the points are dropped and
+ * counted in IRQskipped. After each BL_GetData the tracker takes MemFilled, the
+ * size of the buffer read and IRQskipped, and estimates the rate at which the
+ * channel fills its memory and the time left before it is full if it is no
+ * longer read.
+ *
+ * The time left sets the poll period of the channel (a few polls before the
+ * memory is full, down to a shortest period) and its priority, which orders the
+ * channels due at the same time: the poll loop asks the tracker which channel
+ * to poll next. Each non-zero IRQskipped is logged with what the tracker knew
+ * at that time (memory, rate, time since the previous poll, technique).
+ */
+
+/**
+ * \defgroup buffer_pressure Buffer pressure
+ * @{
+ */
+
+/** Skip events kept by a \ref BufferPressure */
+#define BUF_LOG_SIZE        (256)
+
+/** Priority of a channel */
+typedef enum {
+    BUF_PRIORITY_NORMAL = 0, /*!< memory full in more than HighSeconds */
+    BUF_PRIORITY_HIGH   = 1, /*!< memory full within HighSeconds, or half full */
+    BUF_PRIORITY_URGENT = 2  /*!< memory full within UrgentSeconds, or points dropped at the last poll */
+} TBufferPriority_e;
+
+/** Settings of a \ref BufferPressure */
+typedef struct {
+    unsigned int PollMs;        /*!< poll period at normal priority */
+    unsigned int MinPollMs;     /*!< shortest poll period */
+    double       HighSeconds;   /*!< time left before the memory is full below which the priority is high */
+    double       UrgentSeconds; /*!< same, for the urgent priority */
+    double       RateWindow;    /*!< least time (s) over which a fill rate is measured */
+    double       Smoothing;     /*!< weight of the last measure in the fill rate, 0..1 */
+} TBufferPressureConfig_t;
+
+/** Memory of a channel */
+typedef struct {
+    int                Channel;
+    int                MemSize;         /*!< bytes */
+    int                MemFilled;       /*!< bytes, at the last poll */
+    double             PeakFill;        /*!< highest MemFilled / MemSize */
+    double             FillRate;        /*!< bytes per second recorded by the channel */
+    double             TimeToOverflow;  /*!< s before the memory is full if it is not read, < 0 if it does not fill */
+    int                Priority;        /*!< see \ref TBufferPriority_e */
+    unsigned int       PollMs;          /*!< poll period for the time left */
+    unsigned long long Polls;           /*!< \ref BufferPressure::update calls */
+    unsigned long long BytesRead;
+    unsigned long long Skipped;         /*!< sum of IRQskipped */
+    unsigned long long SkipEvents;      /*!< polls with a non-zero IRQskipped */
+} TBufferChannelState_t;
+
+/** A non-zero IRQskipped and its context */
+typedef struct {
+    int    Channel;
+    double Time;             /*!< s, clock of \ref BufferPressure::update */
+    int    IRQskipped;
+    int    MemFilled;        /*!< bytes, after the poll */
+    int    MemSize;
+    double FillRate;         /*!< bytes per second, as estimated before the poll */
+    double SincePoll;        /*!< s since the previous poll of the channel */
+    unsigned int PollMs;     /*!< poll period the channel had */
+    int    Priority;         /*!< priority the channel had */
+    int    TechniqueIndex;
+    int    TechniqueID;
+    int    NbRows;
+} TBufferSkipEvent_t;
+
+/** Called when a poll returns a non-zero IRQskipped */
+typedef void (*TBufferSkipFunction_t)( void* user, const TBufferSkipEvent_t& event );
+
+/** Default settings: 200 ms, down to 5 ms; high within 10 s, urgent within 2 s */
+TBufferPressureConfig_t BUF_DefaultConfig();
+
+/**
+ * This class follows the memory of the channels. It may be shared by several
+ * threads.
+ */
+class BufferPressure
+{
+public:
+    BufferPressure( const TBufferPressureConfig_t& config = BUF_DefaultConfig() );
+
+    /** Called for each skip event (from the thread of \ref update), may be null */
+    void setSkipFunction( TBufferSkipFunction_t function, void* user );
+
+    /**
+     * This function follows a channel; its memory size is given by BL_GetChannelInfos.
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_INVALIDPARAMETERS if the channel is
+     *         not 0..15 or the memory size is not positive.
+     */
+    int track( const TChannelInfos_t& infos );
+
+    /** Stops following a channel (its techniques ended) */
+    void untrack( uint8 channel );
+
+    /**
+     * This function takes the result of a BL_GetData on a channel.
+     * @param time when the call returned, s on any steady clock (the same for all the calls)
+     * @return the priority of the channel (\ref TBufferPriority_e), \ref ERR_GEN_INVALIDPARAMETERS
+     *         if the channel is not followed.
+     */
+    int update( uint8 channel, const TDataInfos_t& infos, const TCurrentValues_t& curr, double time );
+
+    /**
+     * Channel to poll next: the one whose poll is due first, the most urgent first.
+     * @param time now, same clock as \ref update
+     * @param wait set to the time (s) until that poll is due, 0 if it is
+     * @return the channel, -1 if none is followed
+     */
+    int next( double time, double* wait ) const;
+
+    /** The channels followed */
+    std::vector<TBufferChannelState_t> channels() const;
+
+    /** The last \ref BUF_LOG_SIZE skip events, oldest first */
+    std::vector<TBufferSkipEvent_t> skipLog() const;
+
+private:
+    typedef struct {
+        TBufferChannelState_t State;
+        bool                  Polled;     /* LastPoll is valid */
+        bool                  Rated;      /* FillRate was measured */
+        double                LastPoll;
+        double                Since;      /* start of the rate measure */
+        long long             Recorded;   /* bytes recorded since then */
+        int                   LastFilled;
+    } TChannelPressure_t;
+
+    void evaluate( TChannelPressure_t& c, bool skipped ) const;
+
+    TBufferPressureConfig_t          config;
+    TBufferSkipFunction_t            function;
+    void*                            user;
+    mutable std::mutex               lock;
+    std::vector<TChannelPressure_t>  list;
+    std::deque<TBufferSkipEvent_t>   log;
+};
+
+/** @} */
+
+#endif /* _BUFFERPRESSURE_H_ */
@@ -0,0 +1,584 @@
+#include "CallStats.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#if defined(_MSC_VER) && ( defined(_M_X64) || defined(_M_IX86) )
+#include <intrin.h>
+#define CST_TSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CST_TSC
+#endif
+
+#define CST_NB_SLOTS  (16 + 1)   /* the channels, then CST_NONE */
+
+static const char* s_names[CST_NB_FUNCTIONS] = {
+    "BL_GetLibVersion", "BL_GetVolumeSerialNumber", "BL_GetErrorMsg", "BL_Connect", "BL_Disconnect",
+    "BL_TestConnection", "BL_TestCommSpeed", "BL_GetUSBdeviceinfos", "BL_LoadFirmware", "BL_IsChannelPlugged",
+    "BL_GetChannelsPlugged", "BL_GetChannelInfos", "BL_GetMessage", "BL_GetHardConf", "BL_SetHardConf",
+    "BL_LoadTechnique", "BL_DefineBoolParameter", "BL_DefineSglParameter", "BL_DefineIntParameter", "BL_UpdateParameters",
+    "BL_StartChannel", "BL_StartChannels", "BL_StopChannel", "BL_StopChannels", "BL_GetCurrentValues",
+    "BL_GetData", "BL_GetFCTData", "BL_ConvertNumericIntoSingle", "BL_SetExperimentInfos", "BL_GetExperimentInfos",
+    "BL_SendMsg", "BL_LoadFlash"
+};
+
+typedef std::atomic<unsigned long long> TCounter_t;
+
+/*
+ * Counters of a function on a channel, in the shard of a thread: only that
+ * thread adds to them, uncontended; the readers load them and reset() zeroes
+ * them, which loses no call recorded meanwhile.
+ */
+typedef struct {
+    TCounter_t       Counts[HIST_NB_BUCKETS];
+    TCounter_t       Calls;
+    TCounter_t       Errors;
+    TCounter_t       Lowest;
+    TCounter_t       Highest;
+    TCounter_t       Sum;
+    TCounter_t       Other;
+    std::atomic<int> Codes[CST_NB_CODES];        /* ERR_NOERROR: free slot, kept by reset() */
+    TCounter_t       CodeCounts[CST_NB_CODES];
+} TCallCell_t;
+
+struct CallStats::Shard {
+    std::thread::id           Owner;
+    std::atomic<TCallCell_t*> Cells[CST_NB_FUNCTIONS][CST_NB_SLOTS];
+};
+
+/* the shard of the statistics the thread recorded in last */
+static thread_local unsigned long long s_cached_id    = 0;
+static thread_local void*              s_cached_shard = 0;
+
+/* calls of each function by the thread, to time one in CST_TIMED_EVERY */
+static thread_local unsigned int s_calls[CST_NB_FUNCTIONS];
+
+static std::atomic<unsigned long long> s_next_id( 1 );
+
+static inline unsigned long long s_load( const TCounter_t& c ){ return c.load( std::memory_order_relaxed ); }
+static inline void s_store( TCounter_t& c, unsigned long long v ){ c.store( v, std::memory_order_relaxed ); }
+static inline void s_add( TCounter_t& c, unsigned long long v ){ c.fetch_add( v, std::memory_order_relaxed ); }
+
+const char* CST_FunctionName( int function )
+{
+    return ( function >= 0 && function < CST_NB_FUNCTIONS ) ? s_names[function] : "?";
+}
+
+unsigned long long CallStats::ticks()
+{
+#if defined(CST_TSC)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    unsigned long long v;
+    __asm__ __volatile__( "mrs %0, cntvct_el0" : "=r"( v ) );
+    return v;
+#else
+    return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+#endif
+}
+
+double CallStats::nsPerTick()
+{
+#if defined(CST_TSC) || defined(__aarch64__)
+    /* measured once against the steady clock, over 20 ms */
+    static const double scale = [](){
+        typedef std::chrono::steady_clock Clock;
+        Clock::time_point t0 = Clock::now();
+        unsigned long long k0 = ticks();
+        std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+        Clock::time_point t1 = Clock::now();
+        unsigned long long k1 = ticks();
+        double ns = std::chrono::duration<double, std::nano>( t1 - t0 ).count();
+        return ( k1 > k0 ) ? ns / (double)( k1 - k0 ) : 1.0;
+    }();
+    return scale;
+#else
+    return 1.0;
+#endif
+}
+
+CallStats::CallStats()
+    : id( s_next_id++ ), scale( nsPerTick() )
+{
+}
+
+CallStats::~CallStats()
+{
+    for( size_t s = 0; s < shards.size(); s++ ){
+        for( int f = 0; f < CST_NB_FUNCTIONS; f++ )
+            for( int c = 0; c < CST_NB_SLOTS; c++ ) delete shards[s]->Cells[f][c].load();
+        delete shards[s];
+    }
+}
+
+CallStats::Shard* CallStats::shard()
+{
+    if( s_cached_id == id ) return (Shard*)s_cached_shard;
+    std::thread::id self = std::this_thread::get_id();
+    Shard* found = 0;
+    {
+        std::lock_guard<std::mutex> guard( lock );
+        for( size_t s = 0; s < shards.size() && !found; s++ ) if( shards[s]->Owner == self ) found = shards[s];
+        if( !found ){
+            found = new Shard();
+            found->Owner = self;
+            for( int f = 0; f < CST_NB_FUNCTIONS; f++ )
+                for( int c = 0; c < CST_NB_SLOTS; c++ ) found->Cells[f][c].store( 0 );
+            shards.push_back( found );
+        }
+    }
+    s_cached_id    = id;
+    s_cached_shard = found;
+    return found;
+}
+
+unsigned long long CallStats::start( int function )
+{
+    if( function < 0 || function >= CST_NB_FUNCTIONS ) return 0;
+    return ( s_calls[function]++ % CST_TIMED_EVERY ) ? 0 : ticks();
+}
+
+void CallStats::record( int function, int channel, unsigned long long start, int status )
+{
+    unsigned long long end = start ? ticks() : 0;
+    if( function < 0 || function >= CST_NB_FUNCTIONS ) return;
+    int slot = ( channel >= 0 && channel < 16 ) ? channel : 16;
+
+    std::atomic<TCallCell_t*>& where = shard()->Cells[function][slot];
+    TCallCell_t* cell = where.load( std::memory_order_relaxed );
+    if( !cell ){
+        cell = new TCallCell_t();   /* value-initialized: every counter is zero */
+        s_store( cell->Lowest, ULLONG_MAX );
+        where.store( cell, std::memory_order_release );
+    }
+
+    s_add( cell->Calls, 1 );
+    if( start ){
+        unsigned long long ns = ( end > start ) ? (unsigned long long)( ( end - start ) * scale + 0.5 ) : 0;
+        s_add( cell->Counts[LatencyHistogram::bucket( ns )], 1 );
+        if( ns < s_load( cell->Lowest ) ) s_store( cell->Lowest, ns );
+        if( ns > s_load( cell->Highest ) ) s_store( cell->Highest, ns );
+        s_add( cell->Sum, ns );
+    }
+    if( status == ERR_NOERROR ) return;
+
+    s_add( cell->Errors, 1 );
+    for( int k = 0; k < CST_NB_CODES; k++ ){
+        int code = cell->Codes[k].load( std::memory_order_relaxed );
+        if( code == ERR_NOERROR ){
+            cell->Codes[k].store( status, std::memory_order_release );
+            code = status;
+        }
+        if( code == status ){
+            s_add( cell->CodeCounts[k], 1 );
+            return;
+        }
+    }
+    s_add( cell->Other, 1 );
+}
+
+std::vector<TCallStat_t> CallStats::snapshot() const
+{
+    std::vector<TCallStat_t> list;
+    std::vector<unsigned long long> counts( HIST_NB_BUCKETS );
+    LatencyHistogram latency;
+    std::lock_guard<std::mutex> guard( lock );
+    for( int f = 0; f < CST_NB_FUNCTIONS; f++ ){
+        for( int c = 0; c < CST_NB_SLOTS; c++ ){
+            if( latency.count() ) latency.reset();
+            TCallStat_t stat;
+            stat.Function   = f;
+            stat.Channel    = ( c < 16 ) ? c : CST_NONE;
+            stat.Calls      = 0;
+            stat.Errors     = 0;
+            stat.OtherCodes = 0;
+            for( size_t s = 0; s < shards.size(); s++ ){
+                const TCallCell_t* cell = shards[s]->Cells[f][c].load( std::memory_order_acquire );
+                if( !cell ) continue;
+                unsigned long long calls = s_load( cell->Calls );
+                if( calls == 0 ) continue;
+                for( int b = 0; b < HIST_NB_BUCKETS; b++ ) counts[b] = s_load( cell->Counts[b] );
+                latency.mergeCounts( &counts[0], s_load( cell->Lowest ), s_load( cell->Highest ), (double)s_load( cell->Sum ) );
+                stat.Calls      += calls;
+                stat.Errors     += s_load( cell->Errors );
+                stat.OtherCodes += s_load( cell->Other );
+                for( int k = 0; k < CST_NB_CODES; k++ ){
+                    int code = cell->Codes[k].load( std::memory_order_acquire );
+                    if( code == ERR_NOERROR ) break;
+                    unsigned long long n = s_load( cell->CodeCounts[k] );
+                    if( n == 0 ) continue;
+                    size_t i = 0;
+                    while( i < stat.Codes.size() && stat.Codes[i].first != code ) i++;
+                    if( i == stat.Codes.size() ) stat.Codes.push_back( std::make_pair( code, 0ULL ) );
+                    stat.Codes[i].second += n;
+                }
+            }
+            if( stat.Calls == 0 ) continue;
+            stat.Latency = latency.summary();
+            list.push_back( stat );
+        }
+    }
+    return list;
+}
+
+LatencyHistogram CallStats::histogram( int function, int channel ) const
+{
+    LatencyHistogram latency;
+    if( function < 0 || function >= CST_NB_FUNCTIONS ) return latency;
+    std::vector<unsigned long long> counts( HIST_NB_BUCKETS );
+    std::lock_guard<std::mutex> guard( lock );
+    for( int c = 0; c < CST_NB_SLOTS; c++ ){
+        if( channel != -2 && c != ( ( channel >= 0 && channel < 16 ) ? channel : 16 ) ) continue;
+        for( size_t s = 0; s < shards.size(); s++ ){
+            const TCallCell_t* cell = shards[s]->Cells[function][c].load( std::memory_order_acquire );
+            if( !cell || s_load( cell->Calls ) == 0 ) continue;
+            for( int b = 0; b < HIST_NB_BUCKETS; b++ ) counts[b] = s_load( cell->Counts[b] );
+            latency.mergeCounts( &counts[0], s_load( cell->Lowest ), s_load( cell->Highest ), (double)s_load( cell->Sum ) );
+        }
+    }
+    return latency;
+}
+
+std::string CallStats::dump() const
+{
+    std::vector<TCallStat_t> list = snapshot();
+    std::string out;
+    char line[512];
+    snprintf( line, sizeof(line), "%-28s %4s %10s %8s %10s %10s %10s %10s  %s\n",
+              "function", "ch", "calls", "errors", "p50 us", "p99 us", "p99.9 us", "max us", "codes" );
+    out += line;
+    for( size_t i = 0; i < list.size(); i++ ){
+        const TCallStat_t& s = list[i];
+        char channel[16] = "-";
+        if( s.Channel != CST_NONE ) snprintf( channel, sizeof(channel), "%d", s.Channel + 1 );
+        snprintf( line, sizeof(line), "%-28s %4s %10llu %8llu %10.2f %10.2f %10.2f %10.2f ",
+                  CST_FunctionName( s.Function ), channel, s.Calls, s.Errors,
+                  s.Latency.P50 * 1e-3, s.Latency.P99 * 1e-3, s.Latency.P999 * 1e-3, s.Latency.Max * 1e-3 );
+        out += line;
+        for( size_t k = 0; k < s.Codes.size(); k++ ){
+            snprintf( line, sizeof(line), " %d:%llu", s.Codes[k].first, s.Codes[k].second );
+            out += line;
+        }
+        if( s.OtherCodes ){
+            snprintf( line, sizeof(line), " other:%llu", s.OtherCodes );
+            out += line;
+        }
+        out += "\n";
+    }
+    return out;
+}
+
+void CallStats::reset()
+{
+    std::lock_guard<std::mutex> guard( lock );
+    for( size_t s = 0; s < shards.size(); s++ ){
+        for( int f = 0; f < CST_NB_FUNCTIONS; f++ ){
+            for( int c = 0; c < CST_NB_SLOTS; c++ ){
+                TCallCell_t* cell = shards[s]->Cells[f][c].load( std::memory_order_acquire );
+                if( !cell ) continue;
+                for( int b = 0; b < HIST_NB_BUCKETS; b++ ) s_store( cell->Counts[b], 0 );
+                s_store( cell->Calls, 0 );
+                s_store( cell->Errors, 0 );
+                s_store( cell->Lowest, ULLONG_MAX );
+                s_store( cell->Highest, 0 );
+                s_store( cell->Sum, 0 );
+                s_store( cell->Other, 0 );
+                for( int k = 0; k < CST_NB_CODES; k++ ) s_store( cell->CodeCounts[k], 0 );
+            }
+        }
+    }
+}
+
+/* instrumented table: the real functions and the statistics they record in */
+
+static TEClibFunctions s_real;
+static CallStats*      s_stats = 0;
+
+static int BL_STDCALL s_getLibVersion( char* pVersion, unsigned int* psize ){
+    unsigned long long start = CallStats::start( CST_GETLIBVERSION );
+    int status = s_real.BL_GetLibVersion( pVersion, psize );
+    s_stats->record( CST_GETLIBVERSION, CST_NONE, start, status );
+    return status;
+}
+
+static unsigned int BL_STDCALL s_getVolumeSerialNumber( void ){
+    unsigned long long start = CallStats::start( CST_GETVOLUMESERIALNUMBER );
+    unsigned int serial = s_real.BL_GetVolumeSerialNumber();
+    s_stats->record( CST_GETVOLUMESERIALNUMBER, CST_NONE, start, ERR_NOERROR );
+    return serial;
+}
+
+static int BL_STDCALL s_getErrorMsg( int errorcode, char* pmsg, unsigned int* psize ){
+    unsigned long long start = CallStats::start( CST_GETERRORMSG );
+    int status = s_real.BL_GetErrorMsg( errorcode, pmsg, psize );
+    s_stats->record( CST_GETERRORMSG, CST_NONE, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_connect( const char* address, uint8 timeout, int* pID, TDeviceInfos_t* pInfos ){
+    unsigned long long start = CallStats::start( CST_CONNECT );
+    int status = s_real.BL_Connect( address, timeout, pID, pInfos );
+    s_stats->record( CST_CONNECT, CST_NONE, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_disconnect( int ID ){
+    unsigned long long start = CallStats::start( CST_DISCONNECT );
+    int status = s_real.BL_Disconnect( ID );
+    s_stats->record( CST_DISCONNECT, CST_NONE, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_testConnection( int ID ){
+    unsigned long long start = CallStats::start( CST_TESTCONNECTION );
+    int status = s_real.BL_TestConnection( ID );
+    s_stats->record( CST_TESTCONNECTION, CST_NONE, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_testCommSpeed( int ID, uint8 channel, int* spd_rcvt, int* spd_kernel ){
+    unsigned long long start = CallStats::start( CST_TESTCOMMSPEED );
+    int status = s_real.BL_TestCommSpeed( ID, channel, spd_rcvt, spd_kernel );
+    s_stats->record( CST_TESTCOMMSPEED, channel, start, status );
+    return status;
+}
+
+static bool BL_STDCALL s_getUSBdeviceinfos( unsigned int USBindex, char* pcompany, unsigned int* pcompanysize, char* pdevice,
+                                            unsigned int* pdevicesize, char* pSN, unsigned int* pSNsize ){
+    unsigned long long start = CallStats::start( CST_GETUSBDEVICEINFOS );
+    bool found = s_real.BL_GetUSBdeviceinfos( USBindex, pcompany, pcompanysize, pdevice, pdevicesize, pSN, pSNsize );
+    s_stats->record( CST_GETUSBDEVICEINFOS, CST_NONE, start, found ? ERR_NOERROR : ERR_GEN_FUNCTIONFAILED );
+    return found;
+}
+
+static int BL_STDCALL s_loadFirmware( int ID, uint8* pChannels, int* pResults, uint8 Length, bool ShowGauge, bool ForceReload, const char* BinFile, const char* XlxFile ){
+    unsigned long long start = CallStats::start( CST_LOADFIRMWARE );
+    int status = s_real.BL_LoadFirmware( ID, pChannels, pResults, Length, ShowGauge, ForceReload, BinFile, XlxFile );
+    s_stats->record( CST_LOADFIRMWARE, CST_NONE, start, status );
+    return status;
+}
+
+static bool BL_STDCALL s_isChannelPlugged( int ID, uint8 ch ){
+    unsigned long long start = CallStats::start( CST_ISCHANNELPLUGGED );
+    bool plugged = s_real.BL_IsChannelPlugged( ID, ch );
+    s_stats->record( CST_ISCHANNELPLUGGED, ch, start, ERR_NOERROR );   /* an answer either way */
+    return plugged;
+}
+
+static int BL_STDCALL s_getChannelsPlugged( int ID, uint8* pChPlugged, uint8 Size ){
+    unsigned long long start = CallStats::start( CST_GETCHANNELSPLUGGED );
+    int status = s_real.BL_GetChannelsPlugged( ID, pChPlugged, Size );
+    s_stats->record( CST_GETCHANNELSPLUGGED, CST_NONE, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_getChannelInfos( int ID, uint8 ch, TChannelInfos_t* pInfos ){
+    unsigned long long start = CallStats::start( CST_GETCHANNELINFOS );
+    int status = s_real.BL_GetChannelInfos( ID, ch, pInfos );
+    s_stats->record( CST_GETCHANNELINFOS, ch, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_getMessage( int ID, uint8 ch, char* msg, unsigned int* size ){
+    unsigned long long start = CallStats::start( CST_GETMESSAGE );
+    int status = s_real.BL_GetMessage( ID, ch, msg, size );
+    s_stats->record( CST_GETMESSAGE, ch, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_getHardConf( int ID, uint8 ch, THardwareConf_t* pHardConf ){
+    unsigned long long start = CallStats::start( CST_GETHARDCONF );
+    int status = s_real.BL_GetHardConf( ID, ch, pHardConf );
+    s_stats->record( CST_GETHARDCONF, ch, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_setHardConf( int ID, uint8 ch, THardwareConf_t HardConf ){
+    unsigned long long start = CallStats::start( CST_SETHARDCONF );
+    int status = s_real.BL_SetHardConf( ID, ch, HardConf );
+    s_stats->record( CST_SETHARDCONF, ch, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_loadTechnique( int ID, uint8 channel, const char* pFName, TEccParams_t Params, bool FirstTechnique, bool LastTechnique, bool DisplayParams ){
+    unsigned long long start = CallStats::start( CST_LOADTECHNIQUE );
+    int status = s_real.BL_LoadTechnique( ID, channel, pFName, Params, FirstTechnique, LastTechnique, DisplayParams );
+    s_stats->record( CST_LOADTECHNIQUE, channel, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_defineBoolParameter( const char* lbl, bool value, int index, TEccParam_t* pParam ){
+    unsigned long long start = CallStats::start( CST_DEFINEBOOLPARAMETER );
+    int status = s_real.BL_DefineBoolParameter( lbl, value, index, pParam );
+    s_stats->record( CST_DEFINEBOOLPARAMETER, CST_NONE, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_defineSglParameter( const char* lbl, float value, int index, TEccParam_t* pParam ){
+    unsigned long long start = CallStats::start( CST_DEFINESGLPARAMETER );
+    int status = s_real.BL_DefineSglParameter( lbl, value, index, pParam );
+    s_stats->record( CST_DEFINESGLPARAMETER, CST_NONE, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_defineIntParameter( const char* lbl, int value, int index, TEccParam_t* pParam ){
+    unsigned long long start = CallStats::start( CST_DEFINEINTPARAMETER );
+    int status = s_real.BL_DefineIntParameter( lbl, value, index, pParam );
+    s_stats->record( CST_DEFINEINTPARAMETER, CST_NONE, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_updateParameters( int ID, uint8 channel, int TechIndx, TEccParams_t Params, const char* EccFileName ){
+    unsigned long long start = CallStats::start( CST_UPDATEPARAMETERS );
+    int status = s_real.BL_UpdateParameters( ID, channel, TechIndx, Params, EccFileName );
+    s_stats->record( CST_UPDATEPARAMETERS, channel, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_startChannel( int ID, uint8 channel ){
+    unsigned long long start = CallStats::start( CST_STARTCHANNEL );
+    int status = s_real.BL_StartChannel( ID, channel );
+    s_stats->record( CST_STARTCHANNEL, channel, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_startChannels( int ID, uint8* pChannels, int* pResults, uint8 length ){
+    unsigned long long start = CallStats::start( CST_STARTCHANNELS );
+    int status = s_real.BL_StartChannels( ID, pChannels, pResults, length );
+    s_stats->record( CST_STARTCHANNELS, CST_NONE, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_stopChannel( int ID, uint8 channel ){
+    unsigned long long start = CallStats::start( CST_STOPCHANNEL );
+    int status = s_real.BL_StopChannel( ID, channel );
+    s_stats->record( CST_STOPCHANNEL, channel, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_stopChannels( int ID, uint8* pChannels, int* pResults, uint8 length ){
+    unsigned long long start = CallStats::start( CST_STOPCHANNELS );
+    int status = s_real.BL_StopChannels( ID, pChannels, pResults, length );
+    s_stats->record( CST_STOPCHANNELS, CST_NONE, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_getCurrentValues( int ID, uint8 channel, TCurrentValues_t* pValues ){
+    unsigned long long start = CallStats::start( CST_GETCURRENTVALUES );
+    int status = s_real.BL_GetCurrentValues( ID, channel, pValues );
+    s_stats->record( CST_GETCURRENTVALUES, channel, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_getData( int ID, uint8 channel, TDataBuffer_t* pBuf, TDataInfos_t* pInfos, TCurrentValues_t* pValues ){
+    unsigned long long start = CallStats::start( CST_GETDATA );
+    int status = s_real.BL_GetData( ID, channel, pBuf, pInfos, pValues );
+    s_stats->record( CST_GETDATA, channel, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_getFCTData( int ID, uint8 channel, TDataBuffer_t* pBuf, TDataInfos_t* pInfos, TCurrentValues_t* pValues ){
+    unsigned long long start = CallStats::start( CST_GETFCTDATA );
+    int status = s_real.BL_GetFCTData( ID, channel, pBuf, pInfos, pValues );
+    s_stats->record( CST_GETFCTDATA, channel, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_convertNumericIntoSingle( unsigned int num, float* psgl ){
+    unsigned long long start = CallStats::start( CST_CONVERTNUMERICINTOSINGLE );
+    int status = s_real.BL_ConvertNumericIntoSingle( num, psgl );
+    s_stats->record( CST_CONVERTNUMERICINTOSINGLE, CST_NONE, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_setExperimentInfos( int ID, uint8 channel, TExperimentInfos_t TExpInfos ){
+    unsigned long long start = CallStats::start( CST_SETEXPERIMENTINFOS );
+    int status = s_real.BL_SetExperimentInfos( ID, channel, TExpInfos );
+    s_stats->record( CST_SETEXPERIMENTINFOS, channel, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_getExperimentInfos( int ID, uint8 channel, TExperimentInfos_t* TExpInfos ){
+    unsigned long long start = CallStats::start( CST_GETEXPERIMENTINFOS );
+    int status = s_real.BL_GetExperimentInfos( ID, channel, TExpInfos );
+    s_stats->record( CST_GETEXPERIMENTINFOS, channel, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_sendMsg( int ID, uint8 ch, void* pBuf, unsigned int* pLen ){
+    unsigned long long start = CallStats::start( CST_SENDMSG );
+    int status = s_real.BL_SendMsg( ID, ch, pBuf, pLen );
+    s_stats->record( CST_SENDMSG, ch, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_loadFlash( int ID, const char* pfname, bool ShowGauge ){
+    unsigned long long start = CallStats::start( CST_LOADFLASH );
+    int status = s_real.BL_LoadFlash( ID, pfname, ShowGauge );
+    s_stats->record( CST_LOADFLASH, CST_NONE, start, status );
+    return status;
+}
+
+/* true if a function of the table is a wrapper: its calls would come back to it */
+static bool s_isInstrumented( const TEClibFunctions* eclib ){
+    return eclib->BL_GetLibVersion == s_getLibVersion || eclib->BL_Connect == s_connect ||
+           eclib->BL_GetData == s_getData || eclib->BL_GetCurrentValues == s_getCurrentValues ||
+           eclib->BL_ConvertNumericIntoSingle == s_convertNumericIntoSingle || eclib->BL_StartChannel == s_startChannel;
+}
+
+int CST_InstrumentTable( const TEClibFunctions* eclib, CallStats* stats, TEClibFunctions* out )
+{
+    if( !eclib || !out || eclib == out || s_isInstrumented( eclib ) ) return ERR_GEN_INVALIDPARAMETERS;
+    if( stats && s_stats && ( stats != s_stats || memcmp( eclib, &s_real, sizeof(s_real) ) != 0 ) ) return ERR_GEN_FUNCTIONINPROGRESS;
+    *out = *eclib;
+    if( !stats ) return ERR_NOERROR;
+    s_real  = *eclib;
+    s_stats = stats;
+    /* only the functions the real table has */
+#define CST_WRAP( name, wrapper ) if( s_real.name ) out->name = wrapper
+    CST_WRAP( BL_GetLibVersion,            s_getLibVersion );
+    CST_WRAP( BL_GetVolumeSerialNumber,    s_getVolumeSerialNumber );
+    CST_WRAP( BL_GetErrorMsg,              s_getErrorMsg );
+    CST_WRAP( BL_Connect,                  s_connect );
+    CST_WRAP( BL_Disconnect,               s_disconnect );
+    CST_WRAP( BL_TestConnection,           s_testConnection );
+    CST_WRAP( BL_TestCommSpeed,            s_testCommSpeed );
+    CST_WRAP( BL_GetUSBdeviceinfos,        s_getUSBdeviceinfos );
+    CST_WRAP( BL_LoadFirmware,             s_loadFirmware );
+    CST_WRAP( BL_IsChannelPlugged,         s_isChannelPlugged );
+    CST_WRAP( BL_GetChannelsPlugged,       s_getChannelsPlugged );
+    CST_WRAP( BL_GetChannelInfos,          s_getChannelInfos );
+    CST_WRAP( BL_GetMessage,               s_getMessage );
+    CST_WRAP( BL_GetHardConf,              s_getHardConf );
+    CST_WRAP( BL_SetHardConf,              s_setHardConf );
+    CST_WRAP( BL_LoadTechnique,            s_loadTechnique );
+    CST_WRAP( BL_DefineBoolParameter,      s_defineBoolParameter );
+    CST_WRAP( BL_DefineSglParameter,       s_defineSglParameter );
+    CST_WRAP( BL_DefineIntParameter,       s_defineIntParameter );
+    CST_WRAP( BL_UpdateParameters,         s_updateParameters );
+    CST_WRAP( BL_StartChannel,             s_startChannel );
+    CST_WRAP( BL_StartChannels,            s_startChannels );
+    CST_WRAP( BL_StopChannel,              s_stopChannel );
+    CST_WRAP( BL_StopChannels,             s_stopChannels );
+    CST_WRAP( BL_GetCurrentValues,         s_getCurrentValues );
+    CST_WRAP( BL_GetData,                  s_getData );
+    CST_WRAP( BL_GetFCTData,               s_getFCTData );
+    CST_WRAP( BL_ConvertNumericIntoSingle, s_convertNumericIntoSingle );
+    CST_WRAP( BL_SetExperimentInfos,       s_setExperimentInfos );
+    CST_WRAP( BL_GetExperimentInfos,       s_getExperimentInfos );
+    CST_WRAP( BL_SendMsg,                  s_sendMsg );
+    CST_WRAP( BL_LoadFlash,                s_loadFlash );
+#undef CST_WRAP
+    return ERR_NOERROR;
+}
+
+void CST_ReleaseTable()
+{
+    s_stats = 0;
+    memset( &s_real, 0, sizeof(s_real) );
+}
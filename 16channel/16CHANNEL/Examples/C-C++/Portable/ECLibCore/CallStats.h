@@ -0,0 +1,183 @@
+#pragma once
+
+#ifndef _CALLSTATS_H_
+#define _CALLSTATS_H_
+
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "BLFunctionTable.h"
+#include "Histogram.h"
+
+/*
+ * Statistics of the calls to the ECLib functions
+ *
+ * A function table whose every function is wrapped (CST_InstrumentTable) counts
+ * the calls, the error codes returned and the time of each call, per function
+ * and per channel, in latency histograms. The statistics can be read while the
+ * calls go on (snapshot, dump).
+ *
+ * Every call is counted; one call in \ref CST_TIMED_EVERY of each function by
+ * each thread is timed, the first one included, with two reads of the tick
+ * counter of the processor (the time stamp counter on x86, the virtual counter
+ * on ARM64, the steady clock elsewhere). A read of the counter may cost 20 ns in
+ * a virtual machine, more than the rest of the recording: the calls which are
+ * not timed cost a few uncontended additions, as each thread records in counters
+ * of its own, without lock, which the readers add up. Without instrumentation
+ * the table is the one of the library and nothing is measured.
+ */
+
+/**
+ * \defgroup call_stats Call statistics
+ * @{
+ */
+
+/** Channel of a call which concerns none (or several) */
+#define CST_NONE            (-1)
+/** Distinct error codes counted per function and channel, the next ones together */
+#define CST_NB_CODES        (8)
+/** One call in this number is timed, per function and thread */
+#define CST_TIMED_EVERY     (8)
+
+/** The functions of \ref TEClibFunctions, in the order of the table */
+typedef enum {
+    CST_GETLIBVERSION = 0,
+    CST_GETVOLUMESERIALNUMBER,
+    CST_GETERRORMSG,
+    CST_CONNECT,
+    CST_DISCONNECT,
+    CST_TESTCONNECTION,
+    CST_TESTCOMMSPEED,
+    CST_GETUSBDEVICEINFOS,
+    CST_LOADFIRMWARE,
+    CST_ISCHANNELPLUGGED,
+    CST_GETCHANNELSPLUGGED,
+    CST_GETCHANNELINFOS,
+    CST_GETMESSAGE,
+    CST_GETHARDCONF,
+    CST_SETHARDCONF,
+    CST_LOADTECHNIQUE,
+    CST_DEFINEBOOLPARAMETER,
+    CST_DEFINESGLPARAMETER,
+    CST_DEFINEINTPARAMETER,
+    CST_UPDATEPARAMETERS,
+    CST_STARTCHANNEL,
+    CST_STARTCHANNELS,
+    CST_STOPCHANNEL,
+    CST_STOPCHANNELS,
+    CST_GETCURRENTVALUES,
+    CST_GETDATA,
+    CST_GETFCTDATA,
+    CST_CONVERTNUMERICINTOSINGLE,
+    CST_SETEXPERIMENTINFOS,
+    CST_GETEXPERIMENTINFOS,
+    CST_SENDMSG,
+    CST_LOADFLASH,
+    CST_NB_FUNCTIONS
+} TCallFunction_e;
+
+/** Calls of a function on a channel */
+typedef struct {
+    int                Function;   /*!< see \ref TCallFunction_e */
+    int                Channel;    /*!< 0..15, \ref CST_NONE */
+    unsigned long long Calls;
+    unsigned long long Errors;     /*!< calls which did not return \ref ERR_NOERROR */
+    std::vector< std::pair<int, unsigned long long> > Codes;  /*!< calls by error code, \ref ERR_NOERROR excluded */
+    unsigned long long OtherCodes; /*!< errors beyond the \ref CST_NB_CODES codes of Codes */
+    THistSummary_t     Latency;    /*!< ns, of the calls timed (Latency.Count) */
+} TCallStat_t;
+
+/** Name of a function of the table ("BL_GetData") */
+const char* CST_FunctionName( int function );
+
+/**
+ * This class keeps the statistics of the calls. It may be shared by several
+ * threads; a thread which records keeps its counters until the statistics are
+ * destroyed.
+ */
+class CallStats
+{
+public:
+    CallStats();
+    ~CallStats();
+
+    /** Tick counter, to give as start of \ref record */
+    static unsigned long long ticks();
+
+    /** Nanoseconds per tick */
+    static double nsPerTick();
+
+    /**
+     * Start of a call of a function by this thread, to give to \ref record: the
+     * ticks for one call in \ref CST_TIMED_EVERY, 0 for the others.
+     */
+    static unsigned long long start( int function );
+
+    /**
+     * Records a call which began at 'start' (\ref ticks) and ends now.
+     * @param function see \ref TCallFunction_e
+     * @param channel 0..15, any other value is counted as \ref CST_NONE
+     * @param start ticks at the start of the call, 0 for a call only counted
+     * @param status result of the call
+     */
+    void record( int function, int channel, unsigned long long start, int status );
+
+    /** The calls of every function and channel called, in the order of the table then of the channels */
+    std::vector<TCallStat_t> snapshot() const;
+
+    /**
+     * Latencies of the calls to a function (ns).
+     * @param channel 0..15, \ref CST_NONE for the calls without channel, or -2 for every call
+     */
+    LatencyHistogram histogram( int function, int channel = -2 ) const;
+
+    /** The statistics as a text table, a line per function and channel */
+    std::string dump() const;
+
+    /**
+     * Sets every counter to zero. No call recorded meanwhile by another thread is
+     * lost, but its latency may be kept without its count, or the reverse.
+     */
+    void reset();
+
+private:
+    CallStats( const CallStats& );
+    CallStats& operator=( const CallStats& );
+
+    struct Shard;
+    Shard* shard();
+
+    const unsigned long long id;      /* distinguishes the statistics in the cache of the threads */
+    const double             scale;   /* ns per tick */
+    mutable std::mutex       lock;
+    std::vector<Shard*>      shards;  /* one per thread which recorded */
+};
+
+/**
+ * This function makes a function table whose every function records its calls
+ * in 'stats', the functions of 'eclib' being called. With no statistics (null)
+ * the table is a copy of 'eclib': the calls cost nothing more.
+ *
+ * There is one instrumented table at a time in the program: until \ref CST_ReleaseTable,
+ * a call with other statistics or other functions is refused, and 'eclib' cannot be
+ * an instrumented table (its calls would come back to the wrappers).
+ *
+ * @param eclib the functions to call
+ * @param stats where the calls are recorded, or null
+ * @param out the instrumented table
+ * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_FUNCTIONINPROGRESS if another
+ *         table is instrumented, \ref ERR_GEN_INVALIDPARAMETERS otherwise.
+ */
+int CST_InstrumentTable( const TEClibFunctions* eclib, CallStats* stats, TEClibFunctions* out );
+
+/**
+ * This function ends the instrumented table, once no thread calls it any more:
+ * another one can then be made.
+ */
+void CST_ReleaseTable();
+
+/** @} */
+
+#endif /* _CALLSTATS_H_ */
@@ -0,0 +1,530 @@
+#include "CaptureFile.h"
+
+#include <string.h>
+
+#include "ColumnCodecs.h"
+#include "FileUtils.h"
+
+static const char CAP_MAGIC[CAP_MAGIC_SIZE + 1]   = "ECLIBCAP";
+static const char CAP_TRAILER[CAP_MAGIC_SIZE + 1] = "CAPINDEX";
+static const char CAP_CHUNK_TAG[5] = "CHNK";
+static const char CAP_INDEX_TAG[5] = "CIDX";
+
+/* u8 channel, u8 nb_extra, u8 nb_columns, u8 reserved, 7 x 32 bits, 2 x f64, 2 x u32 */
+#define CAP_CHUNK_META_SIZE  (4 + 7*4 + 2*8 + 2*4)
+/* u8 id, u8 codec, u32 size */
+#define CAP_COLUMN_HEADER_SIZE (6)
+/* i64 offset, u32 size, 5 x 32 bits, 2 x f64, 2 x u32 */
+#define CAP_INDEX_ENTRY_SIZE (8 + 4 + 5*4 + 2*8 + 2*4)
+
+static void s_putBytes( std::vector<unsigned char>& out, const void* data, size_t size ){
+    size_t pos = out.size();
+    out.resize( pos + size );
+    memcpy( &out[pos], data, size );
+}
+
+/* little-endian values, as the hosts ECLib runs on */
+template<typename T>
+static void s_put( std::vector<unsigned char>& out, T value ){
+    s_putBytes( out, &value, sizeof(T) );
+}
+
+template<typename T>
+static void s_set( std::vector<unsigned char>& out, size_t pos, T value ){
+    memcpy( &out[pos], &value, sizeof(T) );
+}
+
+template<typename T>
+static T s_get( const unsigned char* p ){
+    T value;
+    memcpy( &value, p, sizeof(T) );
+    return value;
+}
+
+static void s_putEntry( std::vector<unsigned char>& out, const TCapIndexEntry_t& e ){
+    s_put<long long>( out, e.Offset );
+    s_put<unsigned int>( out, e.Size );
+    s_put<int>( out, e.Channel );
+    s_put<int>( out, e.TechniqueID );
+    s_put<int>( out, e.TechniqueIndex );
+    s_put<unsigned int>( out, e.NbRows );
+    s_put<int>( out, 0 );
+    s_put<double>( out, e.TimeFirst );
+    s_put<double>( out, e.TimeLast );
+    s_put<unsigned int>( out, e.CycleFirst );
+    s_put<unsigned int>( out, e.CycleLast );
+}
+
+static void s_getEntry( const unsigned char* p, TCapIndexEntry_t& e ){
+    e.Offset         = s_get<long long>( p );       p += 8;
+    e.Size           = s_get<unsigned int>( p );    p += 4;
+    e.Channel        = s_get<int>( p );             p += 4;
+    e.TechniqueID    = s_get<int>( p );             p += 4;
+    e.TechniqueIndex = s_get<int>( p );             p += 4;
+    e.NbRows         = s_get<unsigned int>( p );    p += 4 + 4;
+    e.TimeFirst      = s_get<double>( p );          p += 8;
+    e.TimeLast       = s_get<double>( p );          p += 8;
+    e.CycleFirst     = s_get<unsigned int>( p );    p += 4;
+    e.CycleLast      = s_get<unsigned int>( p );
+}
+
+/* meta data of a chunk, without the column vectors */
+static void s_getMeta( const unsigned char* p, TCapChunk_t& c, size_t* nb_rows, size_t* nb_columns, TCapIndexEntry_t* e ){
+    c.Channel        = p[0];
+    c.NbExtra        = p[1];
+    *nb_columns      = p[2];
+    p += 4;
+    c.TechniqueID    = s_get<int>( p );  p += 4;
+    c.TechniqueIndex = s_get<int>( p );  p += 4;
+    c.ProcessIndex   = s_get<int>( p );  p += 4;
+    c.Loop           = s_get<int>( p );  p += 4;
+    c.Fields         = s_get<int>( p );  p += 4;
+    c.Xrec           = s_get<int>( p );  p += 4;
+    *nb_rows         = s_get<unsigned int>( p ); p += 4;
+    if( e ){
+        e->Channel        = c.Channel;
+        e->TechniqueID    = c.TechniqueID;
+        e->TechniqueIndex = c.TechniqueIndex;
+        e->NbRows         = (unsigned int)*nb_rows;
+        e->TimeFirst      = s_get<double>( p );
+        e->TimeLast       = s_get<double>( p + 8 );
+        e->CycleFirst     = s_get<unsigned int>( p + 16 );
+        e->CycleLast      = s_get<unsigned int>( p + 20 );
+    }
+}
+
+static void s_clearPoints( TCapChunk_t& c ){
+    c.Time.clear(); c.Ewe.clear(); c.Ece.clear(); c.I.clear(); c.Control.clear(); c.Cycle.clear();
+    for( int k = 0; k < BL_FRAME_MAX_EXTRA; k++ ) c.Extra[k].clear();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// CaptureWriter
+
+CaptureWriter::CaptureWriter()
+    : file( 0 )
+    , position( 0 )
+    , chunk_rows( CAP_CHUNK_ROWS )
+    , sync_chunks( false )
+    , failed( ERR_NOERROR )
+{
+}
+
+CaptureWriter::~CaptureWriter()
+{
+    close();
+}
+
+int CaptureWriter::open( const char* path, bool append )
+{
+    close();
+    if( !path ) return ERR_GEN_INVALIDPARAMETERS;
+
+    entries.clear();
+    pending.assign( CAP_MAX_CHANNELS, TCapChunk_t() );
+    failed = ERR_NOERROR;
+
+    FILE* existing = append ? fopen( path, "rb" ) : 0;
+    if( existing ){
+        fclose( existing );
+
+        /* keep the complete chunks, drop the index and whatever follows the last chunk */
+        CaptureReader reader;
+        int status = reader.open( path );
+        if( status != ERR_NOERROR ) return status;
+        position = CAP_FILE_HEADER_SIZE;
+        for( size_t i = 0; i < reader.chunkCount(); i++ ){
+            entries.push_back( reader.chunk( i ) );
+            long long end = reader.chunk( i ).Offset + reader.chunk( i ).Size;
+            if( end > position ) position = end;
+        }
+        reader.close();
+
+        file = fopen( path, "r+b" );
+        if( !file ) return ERR_GEN_FUNCTIONFAILED;
+        if( FILE_Truncate( file, position ) != ERR_NOERROR || FILE_Seek( file, position, SEEK_SET ) != 0 ){
+            fclose( file );
+            file = 0;
+            return ERR_GEN_FUNCTIONFAILED;
+        }
+        return ERR_NOERROR;
+    }
+
+    file = fopen( path, "wb" );
+    if( !file ) return ERR_GEN_FUNCTIONFAILED;
+
+    std::vector<unsigned char> header;
+    s_putBytes( header, CAP_MAGIC, CAP_MAGIC_SIZE );
+    s_put<unsigned int>( header, CAP_VERSION );
+    s_put<unsigned int>( header, 0 );
+    if( fwrite( &header[0], 1, header.size(), file ) != header.size() || fflush( file ) != 0 ){
+        fclose( file );
+        file = 0;
+        return ERR_GEN_FUNCTIONFAILED;
+    }
+    position = CAP_FILE_HEADER_SIZE;
+    return ERR_NOERROR;
+}
+
+int CaptureWriter::appendFrame( int channel, const TDecodedFrame_t& frame )
+{
+    if( !file || channel < 0 || channel >= CAP_MAX_CHANNELS ) return ERR_GEN_INVALIDPARAMETERS;
+    if( failed != ERR_NOERROR ) return failed;
+    if( frame.NbRows <= 0 ) return ERR_NOERROR;
+
+    int status = ERR_NOERROR;
+    TCapChunk_t& c = pending[channel];
+
+    /* a chunk holds the points of one technique with one data layout */
+    if( !c.Time.empty() && ( c.TechniqueID != frame.TechniqueID || c.TechniqueIndex != frame.TechniqueIndex
+                             || c.ProcessIndex != frame.ProcessIndex || c.Loop != frame.Loop
+                             || c.Fields != frame.Fields || c.Xrec != frame.Xrec || c.NbExtra != frame.NbExtra ) ){
+        status = writeChunk( c );
+    }
+    if( c.Time.empty() ){
+        c.Channel        = channel;
+        c.TechniqueID    = frame.TechniqueID;
+        c.TechniqueIndex = frame.TechniqueIndex;
+        c.ProcessIndex   = frame.ProcessIndex;
+        c.Loop           = frame.Loop;
+        c.Fields         = frame.Fields;
+        c.Xrec           = frame.Xrec;
+        c.NbExtra        = frame.NbExtra;
+    }
+
+    int n = frame.NbRows;
+    c.Time.insert( c.Time.end(), frame.Time, frame.Time + n );
+    if( frame.Fields & BL_FIELD_EWE )     c.Ewe.insert( c.Ewe.end(), frame.Ewe, frame.Ewe + n );
+    if( frame.Fields & BL_FIELD_ECE )     c.Ece.insert( c.Ece.end(), frame.Ece, frame.Ece + n );
+    if( frame.Fields & BL_FIELD_I )       c.I.insert( c.I.end(), frame.I, frame.I + n );
+    if( frame.Fields & BL_FIELD_CONTROL ) c.Control.insert( c.Control.end(), frame.Control, frame.Control + n );
+    if( frame.Fields & BL_FIELD_CYCLE )   c.Cycle.insert( c.Cycle.end(), frame.Cycle, frame.Cycle + n );
+    for( int k = 0; k < frame.NbExtra; k++ ){
+        c.Extra[k].insert( c.Extra[k].end(), frame.Extra[k], frame.Extra[k] + n );
+    }
+
+    if( c.Time.size() >= chunk_rows ){
+        int written = writeChunk( c );
+        if( status == ERR_NOERROR ) status = written;
+    }
+    return status;
+}
+
+int CaptureWriter::writeChunk( TCapChunk_t& c )
+{
+    size_t rows = c.Time.size();
+    if( failed != ERR_NOERROR ) return failed;
+    if( rows == 0 ) return ERR_NOERROR;
+
+    /* columns present, with their codec */
+    struct { int id; int codec; const void* values; } cols[CAP_COL_EXTRA + BL_FRAME_MAX_EXTRA];
+    int nb_cols = 0;
+    cols[nb_cols].id = CAP_COL_TIME; cols[nb_cols].codec = CODEC_DOD64; cols[nb_cols++].values = &c.Time[0];
+    if( c.Ewe.size() == rows )     { cols[nb_cols].id = CAP_COL_EWE;     cols[nb_cols].codec = CODEC_XOR32; cols[nb_cols++].values = &c.Ewe[0]; }
+    if( c.Ece.size() == rows )     { cols[nb_cols].id = CAP_COL_ECE;     cols[nb_cols].codec = CODEC_XOR32; cols[nb_cols++].values = &c.Ece[0]; }
+    if( c.I.size() == rows )       { cols[nb_cols].id = CAP_COL_I;       cols[nb_cols].codec = CODEC_XOR32; cols[nb_cols++].values = &c.I[0]; }
+    if( c.Control.size() == rows ) { cols[nb_cols].id = CAP_COL_CONTROL; cols[nb_cols].codec = CODEC_XOR32; cols[nb_cols++].values = &c.Control[0]; }
+    if( c.Cycle.size() == rows )   { cols[nb_cols].id = CAP_COL_CYCLE;   cols[nb_cols].codec = CODEC_RLE32; cols[nb_cols++].values = &c.Cycle[0]; }
+    int irange = BL_ExtraIndex( c.Xrec, c.NbExtra, XREC_IRG );
+    for( int k = 0; k < c.NbExtra; k++ ){
+        cols[nb_cols].id     = CAP_COL_EXTRA + k;
+        cols[nb_cols].codec  = ( k == irange ) ? CODEC_RLE32 : CODEC_XOR32;
+        cols[nb_cols].values = &c.Extra[k][0];
+        nb_cols++;
+    }
+
+    TCapIndexEntry_t e;
+    e.Offset         = position;
+    e.Channel        = c.Channel;
+    e.TechniqueID    = c.TechniqueID;
+    e.TechniqueIndex = c.TechniqueIndex;
+    e.NbRows         = (unsigned int)rows;
+    e.TimeFirst      = c.Time.front();
+    e.TimeLast       = c.Time.back();
+    e.CycleFirst     = c.Cycle.empty() ? 0 : c.Cycle.front();
+    e.CycleLast      = c.Cycle.empty() ? 0 : c.Cycle.back();
+
+    buffer.clear();
+    s_putBytes( buffer, CAP_CHUNK_TAG, 4 );
+    s_put<unsigned int>( buffer, 0 ); /* size and crc, set below */
+    s_put<unsigned int>( buffer, 0 );
+
+    buffer.push_back( (unsigned char)c.Channel );
+    buffer.push_back( (unsigned char)c.NbExtra );
+    buffer.push_back( (unsigned char)nb_cols );
+    buffer.push_back( 0 );
+    s_put<int>( buffer, c.TechniqueID );
+    s_put<int>( buffer, c.TechniqueIndex );
+    s_put<int>( buffer, c.ProcessIndex );
+    s_put<int>( buffer, c.Loop );
+    s_put<int>( buffer, c.Fields );
+    s_put<int>( buffer, c.Xrec );
+    s_put<unsigned int>( buffer, (unsigned int)rows );
+    s_put<double>( buffer, e.TimeFirst );
+    s_put<double>( buffer, e.TimeLast );
+    s_put<unsigned int>( buffer, e.CycleFirst );
+    s_put<unsigned int>( buffer, e.CycleLast );
+
+    int status = ERR_NOERROR;
+    for( int k = 0; k < nb_cols; k++ ){
+        buffer.push_back( (unsigned char)cols[k].id );
+        buffer.push_back( (unsigned char)cols[k].codec );
+        size_t size_pos = buffer.size();
+        s_put<unsigned int>( buffer, 0 );
+        int encoded = CODEC_Encode( cols[k].codec, cols[k].values, rows, buffer );
+        if( status == ERR_NOERROR ) status = encoded;
+        s_set<unsigned int>( buffer, size_pos, (unsigned int)( buffer.size() - size_pos - 4 ) );
+    }
+
+    unsigned int payload = (unsigned int)( buffer.size() - CAP_CHUNK_HEADER_SIZE );
+    s_set<unsigned int>( buffer, 4, payload );
+    s_set<unsigned int>( buffer, 8, CRC32_Compute( &buffer[CAP_CHUNK_HEADER_SIZE], payload ) );
+    e.Size = (unsigned int)buffer.size();
+
+    s_clearPoints( c );
+    if( fwrite( &buffer[0], 1, buffer.size(), file ) != buffer.size() || fflush( file ) != 0 ){
+        /* the end of the file is unknown: nothing more is written, not even the index */
+        failed = ERR_GEN_FUNCTIONFAILED;
+        return failed;
+    }
+    if( sync_chunks && status == ERR_NOERROR ) status = FILE_Sync( file );
+    position += buffer.size();
+    entries.push_back( e );
+    return status == ERR_NOERROR ? ERR_NOERROR : ERR_GEN_FUNCTIONFAILED;
+}
+
+int CaptureWriter::flush()
+{
+    if( !file ) return ERR_GEN_INVALIDPARAMETERS;
+    if( failed != ERR_NOERROR ) return failed;
+    int status = ERR_NOERROR;
+    for( size_t ch = 0; ch < pending.size(); ch++ ){
+        int written = writeChunk( pending[ch] );   /* the other channels are written all the same */
+        if( status == ERR_NOERROR ) status = written;
+    }
+    return status == ERR_NOERROR ? ERR_NOERROR : ERR_GEN_FUNCTIONFAILED;
+}
+
+long long CaptureWriter::pendingBytes() const
+{
+    long long bytes = 0;
+    for( size_t ch = 0; ch < pending.size(); ch++ ){
+        const TCapChunk_t& c = pending[ch];
+        size_t values = c.Ewe.size() + c.Ece.size() + c.I.size() + c.Control.size() + c.Cycle.size();
+        for( int k = 0; k < BL_FRAME_MAX_EXTRA; k++ ) values += c.Extra[k].size();
+        bytes += (long long)( c.Time.size() * sizeof(double) + values * sizeof(float) );
+    }
+    return bytes;
+}
+
+int CaptureWriter::close()
+{
+    if( !file ) return ERR_NOERROR;
+
+    int status = flush();
+    if( failed != ERR_NOERROR ){
+        /* no index: a reader rebuilds it from the chunks written whole */
+        fclose( file );
+        file = 0;
+        pending.clear();
+        return failed;
+    }
+
+    buffer.clear();
+    s_putBytes( buffer, CAP_INDEX_TAG, 4 );
+    s_put<unsigned int>( buffer, (unsigned int)entries.size() );
+    for( size_t i = 0; i < entries.size(); i++ ){
+        s_putEntry( buffer, entries[i] );
+    }
+    s_put<unsigned int>( buffer, CRC32_Compute( &buffer[0], buffer.size() ) );
+    s_put<long long>( buffer, position );
+    s_putBytes( buffer, CAP_TRAILER, CAP_MAGIC_SIZE );
+
+    if( fwrite( &buffer[0], 1, buffer.size(), file ) != buffer.size() ) status = ERR_GEN_FUNCTIONFAILED;
+    else position += buffer.size();
+    if( fclose( file ) != 0 ) status = ERR_GEN_FUNCTIONFAILED;
+    file = 0;
+    pending.clear();
+    return status == ERR_NOERROR ? ERR_NOERROR : ERR_GEN_FUNCTIONFAILED;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// CaptureReader
+
+CaptureReader::CaptureReader()
+    : recovered( false )
+{
+}
+
+void CaptureReader::close()
+{
+    mapping.close();
+    entries.clear();
+    by_channel.clear();
+    recovered = false;
+}
+
+int CaptureReader::open( const char* path )
+{
+    close();
+    int status = mapping.open( path );
+    if( status != ERR_NOERROR ) return status;
+
+    const unsigned char* base = mapping.data();
+    if( mapping.size() < CAP_FILE_HEADER_SIZE || memcmp( base, CAP_MAGIC, CAP_MAGIC_SIZE ) != 0
+        || s_get<unsigned int>( base + CAP_MAGIC_SIZE ) != CAP_VERSION ){
+        close();
+        return ERR_TECH_DATACORRUPTED;
+    }
+
+    if( loadIndex() != ERR_NOERROR ){
+        entries.clear();
+        scanChunks( (long long)mapping.size() );
+        recovered = true;
+    }
+
+    by_channel.assign( CAP_MAX_CHANNELS, std::vector<int>() );
+    for( size_t i = 0; i < entries.size(); i++ ){
+        by_channel[entries[i].Channel].push_back( (int)i );
+    }
+    return ERR_NOERROR;
+}
+
+int CaptureReader::loadIndex()
+{
+    const unsigned char* base = mapping.data();
+    size_t size = mapping.size();
+    if( size < CAP_FILE_HEADER_SIZE + CAP_TRAILER_SIZE ) return ERR_TECH_DATACORRUPTED;
+
+    const unsigned char* trailer = base + size - CAP_TRAILER_SIZE;
+    if( memcmp( trailer + 8, CAP_TRAILER, CAP_MAGIC_SIZE ) != 0 ) return ERR_TECH_DATACORRUPTED;
+
+    long long offset = s_get<long long>( trailer );
+    if( offset < CAP_FILE_HEADER_SIZE || offset + 8 + 4 > (long long)( size - CAP_TRAILER_SIZE ) ) return ERR_TECH_DATACORRUPTED;
+
+    const unsigned char* index = base + offset;
+    if( memcmp( index, CAP_INDEX_TAG, 4 ) != 0 ) return ERR_TECH_DATACORRUPTED;
+    unsigned int count = s_get<unsigned int>( index + 4 );
+    size_t bytes = 8 + (size_t)count * CAP_INDEX_ENTRY_SIZE;
+    if( offset + bytes + 4 + CAP_TRAILER_SIZE != size ) return ERR_TECH_DATACORRUPTED;
+    if( CRC32_Compute( index, bytes ) != s_get<unsigned int>( index + bytes ) ) return ERR_TECH_DATACORRUPTED;
+
+    entries.resize( count );
+    for( unsigned int i = 0; i < count; i++ ){
+        s_getEntry( index + 8 + (size_t)i * CAP_INDEX_ENTRY_SIZE, entries[i] );
+        if( entries[i].Offset < CAP_FILE_HEADER_SIZE || entries[i].Offset + entries[i].Size > offset
+            || entries[i].Size < CAP_CHUNK_HEADER_SIZE + CAP_CHUNK_META_SIZE
+            || entries[i].Channel < 0 || entries[i].Channel >= CAP_MAX_CHANNELS ){
+            return ERR_TECH_DATACORRUPTED;
+        }
+    }
+    return ERR_NOERROR;
+}
+
+void CaptureReader::scanChunks( long long end )
+{
+    const unsigned char* base = mapping.data();
+    long long pos = CAP_FILE_HEADER_SIZE;
+
+    while( pos + CAP_CHUNK_HEADER_SIZE <= end ){
+        const unsigned char* p = base + pos;
+        if( memcmp( p, CAP_CHUNK_TAG, 4 ) != 0 ) break;
+        unsigned int payload = s_get<unsigned int>( p + 4 );
+        if( payload < CAP_CHUNK_META_SIZE || pos + CAP_CHUNK_HEADER_SIZE + payload > end ) break;
+        if( CRC32_Compute( p + CAP_CHUNK_HEADER_SIZE, payload ) != s_get<unsigned int>( p + 8 ) ) break;
+
+        TCapChunk_t c;
+        TCapIndexEntry_t e;
+        size_t rows, nb_cols;
+        s_getMeta( p + CAP_CHUNK_HEADER_SIZE, c, &rows, &nb_cols, &e );
+        e.Offset = pos;
+        e.Size   = CAP_CHUNK_HEADER_SIZE + payload;
+        entries.push_back( e );
+        pos += e.Size;
+    }
+}
+
+int CaptureReader::findTime( int channel, double t ) const
+{
+    if( channel < 0 || channel >= (int)by_channel.size() ) return -1;
+    const std::vector<int>& list = by_channel[channel];
+    size_t lo = 0, hi = list.size();
+    while( lo < hi ){
+        size_t mid = ( lo + hi ) / 2;
+        if( entries[list[mid]].TimeLast < t ) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo < list.size() ? list[lo] : -1;
+}
+
+int CaptureReader::findCycle( int channel, unsigned int cycle ) const
+{
+    if( channel < 0 || channel >= (int)by_channel.size() ) return -1;
+    const std::vector<int>& list = by_channel[channel];
+    /* the cycle number starts again with each technique: no order to bisect on */
+    for( size_t i = 0; i < list.size(); i++ ){
+        const TCapIndexEntry_t& e = entries[list[i]];
+        if( e.CycleFirst <= cycle && cycle <= e.CycleLast ) return list[i];
+    }
+    return -1;
+}
+
+std::vector<int> CaptureReader::findTechnique( int channel, int technique_index ) const
+{
+    std::vector<int> result;
+    if( channel < 0 || channel >= (int)by_channel.size() ) return result;
+    const std::vector<int>& list = by_channel[channel];
+    for( size_t i = 0; i < list.size(); i++ ){
+        if( entries[list[i]].TechniqueIndex == technique_index ) result.push_back( list[i] );
+    }
+    return result;
+}
+
+int CaptureReader::readChunk( size_t i, TCapChunk_t& out ) const
+{
+    if( i >= entries.size() ) return ERR_GEN_INVALIDPARAMETERS;
+    const TCapIndexEntry_t& e = entries[i];
+    const unsigned char* p = mapping.data() + e.Offset;
+    unsigned int payload = e.Size - CAP_CHUNK_HEADER_SIZE;
+    if( memcmp( p, CAP_CHUNK_TAG, 4 ) != 0 || s_get<unsigned int>( p + 4 ) != payload
+        || CRC32_Compute( p + CAP_CHUNK_HEADER_SIZE, payload ) != s_get<unsigned int>( p + 8 ) ){
+        return ERR_TECH_DATACORRUPTED;
+    }
+    p += CAP_CHUNK_HEADER_SIZE;
+    const unsigned char* end = p + payload;
+
+    size_t rows, nb_cols;
+    s_clearPoints( out );
+    s_getMeta( p, out, &rows, &nb_cols, 0 );
+    p += CAP_CHUNK_META_SIZE;
+
+    for( size_t k = 0; k < nb_cols; k++ ){
+        if( end - p < CAP_COLUMN_HEADER_SIZE ) return ERR_TECH_DATACORRUPTED;
+        int id    = p[0];
+        int codec = p[1];
+        unsigned int size = s_get<unsigned int>( p + 2 );
+        p += CAP_COLUMN_HEADER_SIZE;
+        if( (size_t)( end - p ) < size ) return ERR_TECH_DATACORRUPTED;
+
+        void* values = 0;
+        size_t value_size = 4;
+        switch( id ){
+        case CAP_COL_TIME:    out.Time.resize( rows );    values = rows ? &out.Time[0] : 0;    value_size = 8; break;
+        case CAP_COL_EWE:     out.Ewe.resize( rows );     values = rows ? &out.Ewe[0] : 0;     break;
+        case CAP_COL_ECE:     out.Ece.resize( rows );     values = rows ? &out.Ece[0] : 0;     break;
+        case CAP_COL_I:       out.I.resize( rows );       values = rows ? &out.I[0] : 0;       break;
+        case CAP_COL_CONTROL: out.Control.resize( rows ); values = rows ? &out.Control[0] : 0; break;
+        case CAP_COL_CYCLE:   out.Cycle.resize( rows );   values = rows ? &out.Cycle[0] : 0;   break;
+        default:
+            if( id < CAP_COL_EXTRA || id >= CAP_COL_EXTRA + BL_FRAME_MAX_EXTRA ) return ERR_TECH_DATACORRUPTED;
+            out.Extra[id - CAP_COL_EXTRA].resize( rows );
+            values = rows ? &out.Extra[id - CAP_COL_EXTRA][0] : 0;
+            break;
+        }
+        if( CODEC_ValueSize( codec ) != value_size ) return ERR_TECH_DATACORRUPTED;
+        int status = CODEC_Decode( codec, p, size, rows, values );
+        if( status != ERR_NOERROR ) return status;
+        p += size;
+    }
+    return ERR_NOERROR;
+}
@@ -0,0 +1,216 @@
+#pragma once
+
+#ifndef _CAPTUREFILE_H_
+#define _CAPTUREFILE_H_
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "BLDecode.h"
+#include "MappedFile.h"
+
+/*
+ * Capture files (*.ecap): decoded data of several channels, stored by columns
+ *
+ * The file is a header followed by chunks. A chunk holds up to a few thousand
+ * points of one channel and one technique, stored column by column (time, Ewe,
+ * I, ...), each column compressed with its own codec (see ColumnCodecs.h). Every
+ * chunk starts with its size and the CRC-32 of its content and is written in one
+ * piece, so that a file cut by a crash is read back up to its last complete
+ * chunk. The writer adds an index of the chunks (channel, technique, time and
+ * cycle ranges) at the end of the file when it is closed; a file without index
+ * is indexed again by walking its chunks.
+ *
+ *     header   "ECLIBCAP" u32 version u32 reserved
+ *     chunk    "CHNK" u32 size u32 crc, meta data, columns (u8 id, u8 codec, u32 size, bytes)
+ *     ...
+ *     index    "CIDX" u32 count, entries, u32 crc
+ *     trailer  u64 offset of the index, "CAPINDEX"
+ */
+
+/**
+ * \defgroup capture Capture files
+ * @{
+ */
+
+#define CAP_MAGIC_SIZE        (8)
+#define CAP_FILE_HEADER_SIZE  (16)
+#define CAP_CHUNK_HEADER_SIZE (12)
+#define CAP_TRAILER_SIZE      (16)
+#define CAP_VERSION           (1)
+/** Default number of points per chunk */
+#define CAP_CHUNK_ROWS        (4096)
+/** Number of channels a file can hold */
+#define CAP_MAX_CHANNELS      (256)
+
+/** Column identifiers */
+typedef enum {
+    CAP_COL_TIME    = 0, /*!< time (s), double */
+    CAP_COL_EWE     = 1, /*!< Ewe (V) */
+    CAP_COL_ECE     = 2, /*!< Ece (V) */
+    CAP_COL_I       = 3, /*!< I (A) */
+    CAP_COL_CONTROL = 4, /*!< control value (V) */
+    CAP_COL_CYCLE   = 5, /*!< cycle number, unsigned */
+    CAP_COL_EXTRA   = 6  /*!< first extra value, followed by the others */
+} TCapColumn_e;
+
+/** Entry of the index: where a chunk is and what it holds */
+typedef struct {
+    long long    Offset;         /*!< offset of the chunk in the file */
+    unsigned int Size;           /*!< size of the chunk, header included */
+    int          Channel;        /*!< channel (0-based) */
+    int          TechniqueID;    /*!< technique identifier (see \ref TTechniqueIdentifier_e) */
+    int          TechniqueIndex; /*!< index of the technique in the chain */
+    unsigned int NbRows;         /*!< number of points */
+    double       TimeFirst;      /*!< time of the first point (s) */
+    double       TimeLast;       /*!< time of the last point (s) */
+    unsigned int CycleFirst;     /*!< cycle of the first point */
+    unsigned int CycleLast;      /*!< cycle of the last point */
+} TCapIndexEntry_t;
+
+/** Points of a chunk, one array per value */
+typedef struct {
+    int                 Channel;
+    int                 TechniqueID;
+    int                 TechniqueIndex;
+    int                 ProcessIndex;
+    int                 Loop;
+    int                 Fields;  /*!< values available (see \ref TDecodedField_e) */
+    int                 Xrec;    /*!< extra values recorded (see \ref TExtraRecord_e) */
+    int                 NbExtra; /*!< number of extra values per point */
+    std::vector<double>       Time;
+    std::vector<float>        Ewe;
+    std::vector<float>        Ece;
+    std::vector<float>        I;
+    std::vector<float>        Control;
+    std::vector<unsigned int> Cycle;
+    std::vector<float>        Extra[BL_FRAME_MAX_EXTRA];
+} TCapChunk_t;
+
+/**
+ * This class appends decoded frames to a capture file.
+ *
+ * The frames of each channel are gathered until a chunk is full, or until the
+ * technique changes, then the chunk is compressed and written. Nothing written
+ * is modified afterwards: a crash loses at most the points not yet in a chunk.
+ */
+class CaptureWriter
+{
+public:
+    CaptureWriter();
+    ~CaptureWriter();
+
+    /**
+     * This function creates the file, or opens it to add chunks at its end.
+     *
+     * @param path path of the file
+     * @param append true to keep the chunks of an existing file. The index and an
+     *        incomplete last chunk (after a crash) are removed; a new index is
+     *        written on \ref close.
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_FUNCTIONFAILED if the file cannot
+     *         be written, \ref ERR_TECH_DATACORRUPTED if the file to append to is not a capture file.
+     */
+    int open( const char* path, bool append = false );
+
+    /**
+     * This function adds the points of a decoded frame of a channel (0-based).
+     * Once a chunk could not be written, the end of the file is unknown: this
+     * function, \ref flush and \ref close refuse with \ref ERR_GEN_FUNCTIONFAILED
+     * until the file is opened again, and no index is written.
+     */
+    int appendFrame( int channel, const TDecodedFrame_t& frame );
+
+    /** Writes the points gathered for every channel */
+    int flush();
+
+    /** Flushes, writes the index and closes the file */
+    int close();
+
+    /** Sets the number of points per chunk (default \ref CAP_CHUNK_ROWS) */
+    void setChunkRows( size_t rows ) { chunk_rows = rows ? rows : 1; }
+
+    /** When true, every chunk is synced to the disk (FILE_Sync) before the next one */
+    void setSyncEachChunk( bool sync ) { sync_chunks = sync; }
+
+    bool   isOpen() const { return file != 0; }
+    /** Number of bytes written so far; once closed, the size of the file */
+    long long bytesWritten() const { return position; }
+    /** Bytes of the points gathered and not written yet, before compression */
+    long long pendingBytes() const;
+    const std::vector<TCapIndexEntry_t>& index() const { return entries; }
+
+private:
+    CaptureWriter( const CaptureWriter& );
+    CaptureWriter& operator=( const CaptureWriter& );
+
+    int writeChunk( TCapChunk_t& chunk );
+
+    FILE*                         file;
+    std::vector<TCapChunk_t>      pending;  /* one per channel */
+    std::vector<TCapIndexEntry_t> entries;
+    std::vector<unsigned char>    buffer;
+    long long                     position;
+    size_t                        chunk_rows;
+    bool                          sync_chunks;
+    int                           failed;   /* error of a chunk write, until the next open */
+};
+
+/**
+ * This class reads a capture file. The file is mapped in memory; the chunks are
+ * found through the index and decompressed on request.
+ */
+class CaptureReader
+{
+public:
+    CaptureReader();
+
+    /**
+     * This function maps the file and loads its index, or rebuilds it by walking the
+     * chunks when the file was not closed.
+     *
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_FILENOTEXISTS if the file cannot be
+     *         opened, \ref ERR_TECH_DATACORRUPTED if it is not a capture file.
+     */
+    int  open( const char* path );
+    void close();
+
+    /** True if the index was rebuilt: the file was not closed, or its end was damaged */
+    bool isRecovered() const { return recovered; }
+
+    size_t                  chunkCount() const { return entries.size(); }
+    const TCapIndexEntry_t& chunk( size_t i ) const { return entries[i]; }
+
+    /**
+     * Returns the chunk of a channel holding the time 't', or the first one after it;
+     * -1 if none. The chunks of a channel are in time order, the search is a bisection.
+     */
+    int findTime( int channel, double t ) const;
+
+    /** Returns the first chunk of a channel holding the cycle, -1 if none */
+    int findCycle( int channel, unsigned int cycle ) const;
+
+    /** Returns the chunks of a channel recorded by a technique (index in the chain) */
+    std::vector<int> findTechnique( int channel, int technique_index ) const;
+
+    /**
+     * This function decompresses a chunk.
+     * @return \ref ERR_NOERROR if successful, \ref ERR_TECH_DATACORRUPTED if the chunk is damaged.
+     */
+    int readChunk( size_t i, TCapChunk_t& out ) const;
+
+    const MappedFile& file() const { return mapping; }
+
+private:
+    int  loadIndex();
+    void scanChunks( long long end );
+
+    MappedFile                    mapping;
+    std::vector<TCapIndexEntry_t> entries;
+    std::vector< std::vector<int> > by_channel; /* chunks of each channel, in file order */
+    bool                          recovered;
+};
+
+/** @} */
+
+#endif /* _CAPTUREFILE_H_ */
@@ -0,0 +1,336 @@
+#include "ColumnCodecs.h"
+
+#include <string.h>
+
+#include <BLStructs.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+typedef unsigned long long u64;
+typedef long long          i64;
+
+static int s_clz64( u64 x ){
+#ifdef _MSC_VER
+    unsigned long idx;
+    return _BitScanReverse64( &idx, x ) ? 63 - (int)idx : 64;
+#else
+    return x ? __builtin_clzll( x ) : 64;
+#endif
+}
+
+static int s_ctz64( u64 x ){
+#ifdef _MSC_VER
+    unsigned long idx;
+    return _BitScanForward64( &idx, x ) ? (int)idx : 64;
+#else
+    return x ? __builtin_ctzll( x ) : 64;
+#endif
+}
+
+static u64 s_zigzag( i64 v )   { return ( (u64)v << 1 ) ^ (u64)( v >> 63 ); }
+static i64 s_unzigzag( u64 v ) { return (i64)( v >> 1 ) ^ -(i64)( v & 1 ); }
+
+/* most significant bit first */
+class BitWriter
+{
+public:
+    BitWriter( std::vector<unsigned char>& out ) : out( out ), acc( 0 ), bits( 0 ) {}
+
+    void write( u64 value, int n ){
+        while( n > 0 ){
+            int take = n > 32 ? 32 : n;
+            n -= take;
+            acc   = ( acc << take ) | ( ( value >> n ) & ( ( 1ULL << take ) - 1 ) );
+            bits += take;
+            while( bits >= 8 ){
+                bits -= 8;
+                out.push_back( (unsigned char)( acc >> bits ) );
+            }
+            acc &= ( 1ULL << bits ) - 1;
+        }
+    }
+
+    /* pads the last byte with zeros */
+    void finish(){
+        if( bits > 0 ) out.push_back( (unsigned char)( acc << ( 8 - bits ) ) );
+        acc = 0;
+        bits = 0;
+    }
+
+private:
+    std::vector<unsigned char>& out;
+    u64 acc;
+    int bits;
+};
+
+class BitReader
+{
+public:
+    BitReader( const unsigned char* in, size_t size ) : p( in ), end( in + size ), window( 0 ), bits( 0 ) {}
+
+    /* false if the input is exhausted */
+    bool read( int n, u64* value ){
+        if( n > 32 ){
+            u64 high, low;
+            if( !read( n - 32, &high ) || !read( 32, &low ) ) return false;
+            *value = ( high << 32 ) | low;
+            return true;
+        }
+        if( bits < n ){
+            /* the window holds the next bits, most significant first */
+            while( bits <= 56 && p < end ){
+                window |= (u64)*p++ << ( 56 - bits );
+                bits   += 8;
+            }
+            if( bits < n ) return false;
+        }
+        if( n == 0 ){
+            *value = 0;
+            return true;
+        }
+        *value  = window >> ( 64 - n );
+        window <<= n;
+        bits   -= n;
+        return true;
+    }
+
+private:
+    const unsigned char* p;
+    const unsigned char* end;
+    u64                  window;
+    int                  bits;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// DOD64
+
+/* prefix, payload size */
+static const struct { u64 prefix; int prefix_bits; int payload_bits; } s_dodClasses[] = {
+    { 0x2,  2, 7  },   /* 10    */
+    { 0x6,  3, 9  },   /* 110   */
+    { 0xE,  4, 12 },   /* 1110  */
+    { 0x1E, 5, 32 },   /* 11110 */
+    { 0x1F, 5, 64 }    /* 11111 */
+};
+
+static void s_encodeDod64( const u64* v, size_t n, std::vector<unsigned char>& out ){
+    BitWriter w( out );
+    if( n > 0 ) w.write( v[0], 64 );
+    if( n > 1 ) w.write( s_zigzag( (i64)( v[1] - v[0] ) ), 64 );
+    i64 prev = n > 1 ? (i64)( v[1] - v[0] ) : 0;
+    for( size_t i = 2; i < n; i++ ){
+        i64 delta = (i64)( v[i] - v[i-1] );
+        u64 zz    = s_zigzag( (i64)( (u64)delta - (u64)prev ) );
+        prev      = delta;
+        if( zz == 0 ){
+            w.write( 0, 1 );
+            continue;
+        }
+        for( size_t c = 0; c < sizeof(s_dodClasses)/sizeof(s_dodClasses[0]); c++ ){
+            int payload = s_dodClasses[c].payload_bits;
+            if( payload == 64 || zz < ( 1ULL << payload ) ){
+                w.write( s_dodClasses[c].prefix, s_dodClasses[c].prefix_bits );
+                w.write( zz, payload );
+                break;
+            }
+        }
+    }
+    w.finish();
+}
+
+static int s_decodeDod64( const unsigned char* in, size_t size, size_t n, u64* v ){
+    BitReader r( in, size );
+    u64 x;
+    if( n > 0 ){
+        if( !r.read( 64, &v[0] ) ) return ERR_TECH_DATACORRUPTED;
+    }
+    i64 prev = 0;
+    if( n > 1 ){
+        if( !r.read( 64, &x ) ) return ERR_TECH_DATACORRUPTED;
+        prev = s_unzigzag( x );
+        v[1] = v[0] + (u64)prev;
+    }
+    for( size_t i = 2; i < n; i++ ){
+        int ones = 0;
+        u64 bit;
+        do {
+            if( !r.read( 1, &bit ) ) return ERR_TECH_DATACORRUPTED;
+            if( bit ) ones++;
+        } while( bit && ones < 5 );
+
+        i64 dod = 0;
+        if( ones > 0 ){
+            int payload = s_dodClasses[ones - 1].payload_bits;
+            if( !r.read( payload, &x ) ) return ERR_TECH_DATACORRUPTED;
+            dod = s_unzigzag( x );
+        }
+        prev = (i64)( (u64)prev + (u64)dod );
+        v[i] = v[i-1] + (u64)prev;
+    }
+    return ERR_NOERROR;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// XOR32 / XOR64
+
+template<typename T, int WIDTH, int LEAD_BITS>
+static void s_encodeXor( const T* v, size_t n, std::vector<unsigned char>& out ){
+    BitWriter w( out );
+    if( n == 0 ) return;
+    w.write( v[0], WIDTH );
+    int prev_lead = -1, prev_trail = 0;
+    for( size_t i = 1; i < n; i++ ){
+        u64 x = (u64)( v[i] ^ v[i-1] );
+        if( x == 0 ){
+            w.write( 0, 1 );
+            continue;
+        }
+        int lead  = s_clz64( x ) - ( 64 - WIDTH );
+        int trail = s_ctz64( x );
+        if( lead >= ( 1 << LEAD_BITS ) ) lead = ( 1 << LEAD_BITS ) - 1;
+        if( prev_lead >= 0 && lead >= prev_lead && trail >= prev_trail ){
+            w.write( 0x2, 2 );
+            w.write( x >> prev_trail, WIDTH - prev_lead - prev_trail );
+        } else {
+            int len = WIDTH - lead - trail;
+            w.write( 0x3, 2 );
+            w.write( (u64)lead, LEAD_BITS );
+            w.write( (u64)( len - 1 ), LEAD_BITS );
+            w.write( x >> trail, len );
+            prev_lead  = lead;
+            prev_trail = trail;
+        }
+    }
+    w.finish();
+}
+
+template<typename T, int WIDTH, int LEAD_BITS>
+static int s_decodeXor( const unsigned char* in, size_t size, size_t n, T* v ){
+    BitReader r( in, size );
+    if( n == 0 ) return ERR_NOERROR;
+    u64 x;
+    if( !r.read( WIDTH, &x ) ) return ERR_TECH_DATACORRUPTED;
+    v[0] = (T)x;
+    int prev_lead = -1, prev_trail = 0;
+    for( size_t i = 1; i < n; i++ ){
+        u64 bit;
+        if( !r.read( 1, &bit ) ) return ERR_TECH_DATACORRUPTED;
+        if( !bit ){
+            v[i] = v[i-1];
+            continue;
+        }
+        if( !r.read( 1, &bit ) ) return ERR_TECH_DATACORRUPTED;
+        if( bit ){
+            u64 lead, len;
+            if( !r.read( LEAD_BITS, &lead ) || !r.read( LEAD_BITS, &len ) ) return ERR_TECH_DATACORRUPTED;
+            len += 1;
+            if( (int)( lead + len ) > WIDTH ) return ERR_TECH_DATACORRUPTED;
+            prev_lead  = (int)lead;
+            prev_trail = WIDTH - (int)lead - (int)len;
+        } else if( prev_lead < 0 ){
+            return ERR_TECH_DATACORRUPTED;
+        }
+        if( !r.read( WIDTH - prev_lead - prev_trail, &x ) ) return ERR_TECH_DATACORRUPTED;
+        v[i] = v[i-1] ^ (T)( x << prev_trail );
+    }
+    return ERR_NOERROR;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// RLE32
+
+static void s_putVarint( std::vector<unsigned char>& out, u64 v ){
+    while( v >= 0x80 ){
+        out.push_back( (unsigned char)( v | 0x80 ) );
+        v >>= 7;
+    }
+    out.push_back( (unsigned char)v );
+}
+
+static bool s_getVarint( const unsigned char*& p, const unsigned char* end, u64* v ){
+    u64 result = 0;
+    for( int shift = 0; shift < 64; shift += 7 ){
+        if( p >= end ) return false;
+        unsigned char b = *p++;
+        result |= (u64)( b & 0x7F ) << shift;
+        if( !( b & 0x80 ) ){
+            *v = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void s_encodeRle32( const unsigned int* v, size_t n, std::vector<unsigned char>& out ){
+    for( size_t i = 0; i < n; ){
+        size_t run = 1;
+        while( i + run < n && v[i + run] == v[i] ) run++;
+        s_putVarint( out, v[i] );
+        s_putVarint( out, run );
+        i += run;
+    }
+}
+
+static int s_decodeRle32( const unsigned char* in, size_t size, size_t n, unsigned int* v ){
+    const unsigned char* p = in;
+    const unsigned char* end = in + size;
+    for( size_t i = 0; i < n; ){
+        u64 value, run;
+        if( !s_getVarint( p, end, &value ) || !s_getVarint( p, end, &run ) ) return ERR_TECH_DATACORRUPTED;
+        if( run == 0 || run > n - i ) return ERR_TECH_DATACORRUPTED;
+        for( u64 k = 0; k < run; k++ ) v[i++] = (unsigned int)value;
+    }
+    return ERR_NOERROR;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+size_t CODEC_ValueSize( int codec )
+{
+    switch( codec ){
+    case CODEC_RAW32:
+    case CODEC_XOR32:
+    case CODEC_RLE32: return 4;
+    case CODEC_RAW64:
+    case CODEC_DOD64:
+    case CODEC_XOR64: return 8;
+    }
+    return 0;
+}
+
+int CODEC_Encode( int codec, const void* values, size_t count, std::vector<unsigned char>& out )
+{
+    switch( codec ){
+    case CODEC_RAW32:
+    case CODEC_RAW64: {
+        const unsigned char* p = (const unsigned char*)values;
+        out.insert( out.end(), p, p + count * CODEC_ValueSize( codec ) );
+        return ERR_NOERROR;
+    }
+    case CODEC_DOD64: s_encodeDod64( (const u64*)values, count, out ); return ERR_NOERROR;
+    case CODEC_XOR32: s_encodeXor<unsigned int, 32, 5>( (const unsigned int*)values, count, out ); return ERR_NOERROR;
+    case CODEC_XOR64: s_encodeXor<u64, 64, 6>( (const u64*)values, count, out ); return ERR_NOERROR;
+    case CODEC_RLE32: s_encodeRle32( (const unsigned int*)values, count, out ); return ERR_NOERROR;
+    }
+    return ERR_GEN_INVALIDPARAMETERS;
+}
+
+int CODEC_Decode( int codec, const unsigned char* in, size_t size, size_t count, void* values )
+{
+    switch( codec ){
+    case CODEC_RAW32:
+    case CODEC_RAW64: {
+        size_t bytes = count * CODEC_ValueSize( codec );
+        if( size < bytes ) return ERR_TECH_DATACORRUPTED;
+        if( bytes ) memcpy( values, in, bytes );
+        return ERR_NOERROR;
+    }
+    case CODEC_DOD64: return s_decodeDod64( in, size, count, (u64*)values );
+    case CODEC_XOR32: return s_decodeXor<unsigned int, 32, 5>( in, size, count, (unsigned int*)values );
+    case CODEC_XOR64: return s_decodeXor<u64, 64, 6>( in, size, count, (u64*)values );
+    case CODEC_RLE32: return s_decodeRle32( in, size, count, (unsigned int*)values );
+    }
+    return ERR_GEN_INVALIDPARAMETERS;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#ifndef _COLUMNCODECS_H_
+#define _COLUMNCODECS_H_
+
+#include <stddef.h>
+#include <vector>
+
+/*
+ * Lossless codecs for the columns of the capture files
+ *
+ * The values are handled as their 32 or 64 bits patterns, so the floats come
+ * back bit for bit:
+ *   - DOD64: delta-of-delta of 64 bits patterns. Made for the time column: the bit
+ *     patterns of positive doubles grow with the values, so a regular sampling gives
+ *     an almost constant delta and the delta-of-delta holds in a few bits.
+ *   - XOR32, XOR64: each value is XORed with the previous one and only the
+ *     meaningful bits are kept (Gorilla). Made for the slowly varying measures.
+ *   - RLE32: runs of identical values (cycle number, I range).
+ *   - RAW32, RAW64: the values as they are.
+ */
+
+/**
+ * \defgroup codecs Column codecs
+ * @{
+ */
+
+/** Codec identifiers, as stored in the files */
+typedef enum {
+    CODEC_RAW32 = 0, /*!< 32 bits values, unchanged */
+    CODEC_RAW64 = 1, /*!< 64 bits values, unchanged */
+    CODEC_DOD64 = 2, /*!< delta-of-delta of 64 bits values */
+    CODEC_XOR32 = 3, /*!< XOR with the previous 32 bits value */
+    CODEC_XOR64 = 4, /*!< XOR with the previous 64 bits value */
+    CODEC_RLE32 = 5  /*!< run lengths of 32 bits values */
+} TCodec_e;
+
+/** Size (bytes) of the values handled by a codec, 0 if the codec is unknown */
+size_t CODEC_ValueSize( int codec );
+
+/**
+ * This function appends the encoded values to 'out'.
+ *
+ * @param codec codec (see \ref TCodec_e)
+ * @param values array of 'count' values of \ref CODEC_ValueSize bytes
+ * @param count number of values
+ * @param out encoded bytes
+ * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_INVALIDPARAMETERS if the codec is unknown.
+ */
+int CODEC_Encode( int codec, const void* values, size_t count, std::vector<unsigned char>& out );
+
+/**
+ * This function decodes 'count' values.
+ *
+ * @param codec codec (see \ref TCodec_e)
+ * @param in encoded bytes
+ * @param size number of encoded bytes
+ * @param count number of values to decode
+ * @param values array of 'count' values of \ref CODEC_ValueSize bytes
+ * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_INVALIDPARAMETERS if the codec is unknown,
+ *         \ref ERR_TECH_DATACORRUPTED if the encoded bytes do not hold 'count' values.
+ */
+int CODEC_Decode( int codec, const unsigned char* in, size_t size, size_t count, void* values );
+
+/** @} */
+
+#endif /* _COLUMNCODECS_H_ */
@@ -0,0 +1,199 @@
+#include "ControlLoop.h"
+
+#include <string.h>
+#include <chrono>
+
+typedef std::chrono::steady_clock Clock;
+
+static double s_now(){
+    return std::chrono::duration<double>( Clock::now().time_since_epoch() ).count();
+}
+
+ControlLoop::ControlLoop( const TEClibFunctions* eclib, const std::string& ecc_dir )
+    : eclib( eclib )
+    , ecc_dir( ecc_dir )
+    , device_id( -1 )
+    , channel( 0 )
+    , vmp4( false )
+    , xrec( 0 )
+    , function( 0 )
+    , user( 0 )
+    , frame( new TDecodedFrame_t )
+    , running( false )
+    , stopping( false )
+    , thread_status( ERR_NOERROR )
+{
+    memset( &counters, 0, sizeof(counters) );
+}
+
+ControlLoop::~ControlLoop()
+{
+    stop();
+}
+
+int ControlLoop::setup( int id, uint8 ch, const std::vector<TEccTechnique_t>& techniques, bool is_vmp4, int extra,
+                        TControlFunction_t control, void* control_user )
+{
+    if( running ) return ERR_GEN_FUNCTIONINPROGRESS;
+    if( !eclib || !eclib->BL_UpdateParameters || !control || techniques.empty() ) return ERR_GEN_INVALIDPARAMETERS;
+    device_id = id;
+    channel   = ch;
+    chain     = techniques;
+    vmp4      = is_vmp4;
+    xrec      = extra;
+    function  = control;
+    user      = control_user;
+    return ERR_NOERROR;
+}
+
+int ControlLoop::process( const TDataBuffer_t& buf, const TDataInfos_t& infos, const TCurrentValues_t& curr )
+{
+    double arrival = s_now();
+    if( running ) return ERR_GEN_FUNCTIONINPROGRESS;
+    if( !function ) return ERR_GEN_INVALIDPARAMETERS;
+    int status = decode( buf, infos, curr );
+    return ( status == ERR_NOERROR ) ? control( curr, arrival ) : status;
+}
+
+int ControlLoop::decode( const TDataBuffer_t& buf, const TDataInfos_t& infos, const TCurrentValues_t& curr )
+{
+    frame->NbRows = 0;
+    if( infos.NbRows == 0 ) return ERR_NOERROR;
+    int status = BL_DecodeData( buf, infos, curr, vmp4, xrec, eclib->BL_ConvertNumericIntoSingle, frame.get() );
+    if( status == ERR_NOERROR ){
+        std::lock_guard<std::mutex> guard( stats_lock );
+        counters.Frames++;
+        counters.Points += frame->NbRows;
+    }
+    return status;
+}
+
+/* the parameters exist in the technique with the same type, and may be changed while it runs */
+int ControlLoop::check( const TControlUpdate_t& changes ) const
+{
+    if( changes.TechniqueIndex < 0 || changes.TechniqueIndex >= (int)chain.size()
+        || changes.Params.empty() || changes.Params.size() > ECC_UPDATE_MAX_PARAMS ){
+        return ERR_GEN_UPDATEPARAMETERS;
+    }
+    const TEccTechnique_t& tech = chain[changes.TechniqueIndex];
+    for( size_t i = 0; i < changes.Params.size(); i++ ){
+        const TEccParam_t& param = changes.Params[i];
+        if( ECC_IsHardwareParam( param.ParamStr ) ) return ERR_GEN_UPDATEPARAMETERS;
+        bool found = false;
+        for( size_t p = 0; p < tech.Params.size() && !found; p++ ){
+            found = tech.Params[p].ParamIndex == param.ParamIndex && tech.Params[p].ParamType == param.ParamType
+                 && strncmp( tech.Params[p].ParamStr, param.ParamStr, sizeof(param.ParamStr) ) == 0;
+        }
+        if( !found ) return ERR_GEN_UPDATEPARAMETERS;
+    }
+    return ERR_NOERROR;
+}
+
+int ControlLoop::control( const TCurrentValues_t& curr, double arrival )
+{
+    if( frame->NbRows == 0 ) return ERR_NOERROR;
+    update.TechniqueIndex = frame->TechniqueIndex;
+    update.Params.clear();
+    if( !function( user, *frame, curr, &update ) ) return ERR_NOERROR;
+
+    int status = check( update );
+    double sent = 0.0, done = 0.0;
+    if( status == ERR_NOERROR ){
+        const TEccTechnique_t& tech = chain[update.TechniqueIndex];
+        std::string path = ecc_dir + tech.EccFile;
+        TEccParams_t params;
+        params.len     = (int)update.Params.size();
+        params.pParams = &update.Params[0];
+        sent   = s_now();
+        status = eclib->BL_UpdateParameters( device_id, channel, update.TechniqueIndex, params, path.c_str() );
+        done   = s_now();
+    }
+    if( status == ERR_NOERROR ){
+        /* keep the values sent, for the next checks */
+        TEccTechnique_t& tech = chain[update.TechniqueIndex];
+        for( size_t i = 0; i < update.Params.size(); i++ ){
+            for( size_t p = 0; p < tech.Params.size(); p++ ){
+                if( tech.Params[p].ParamIndex == update.Params[i].ParamIndex
+                    && strncmp( tech.Params[p].ParamStr, update.Params[i].ParamStr, sizeof(tech.Params[p].ParamStr) ) == 0 ){
+                    tech.Params[p].ParamVal = update.Params[i].ParamVal;
+                }
+            }
+        }
+    }
+
+    /* age of the last point when the buffer arrived, on the clock of the channel */
+    double age = (double)curr.ElapsedTime - frame->Time[frame->NbRows - 1];
+    if( age < 0.0 ) age = 0.0;
+
+    std::lock_guard<std::mutex> guard( stats_lock );
+    counters.Decisions++;
+    if( status == ERR_NOERROR ){
+        counters.Updates++;
+        latencies[CTRL_LATENCY_END_TO_END].recordSeconds( age + ( done - arrival ) );
+        latencies[CTRL_LATENCY_HOST].recordSeconds( done - arrival );
+        latencies[CTRL_LATENCY_UPDATE].recordSeconds( done - sent );
+    } else {
+        if( sent == 0.0 ) counters.Rejected++;
+        else counters.Failed++;
+        counters.LastError = status;
+    }
+    return status;
+}
+
+int ControlLoop::start( unsigned int poll_ms )
+{
+    if( running ) return ERR_GEN_FUNCTIONINPROGRESS;
+    if( !function || !eclib->BL_GetData ) return ERR_GEN_INVALIDPARAMETERS;
+    if( worker.joinable() ) worker.join();
+    stopping      = false;
+    thread_status = ERR_NOERROR;
+    running       = true;
+    worker = std::thread( &ControlLoop::run, this, poll_ms );
+    return ERR_NOERROR;
+}
+
+void ControlLoop::stop()
+{
+    stopping = true;
+    if( worker.joinable() ) worker.join();
+    running = false;
+}
+
+void ControlLoop::run( unsigned int poll_ms )
+{
+    TDataBuffer_t    buf;
+    TDataInfos_t     infos;
+    TCurrentValues_t curr;
+    int status = ERR_NOERROR;
+    while( !stopping ){
+        status = eclib->BL_GetData( device_id, channel, &buf, &infos, &curr );
+        double arrival = s_now();
+        if( status != ERR_NOERROR ) break;
+        status = decode( buf, infos, curr );
+        if( status != ERR_NOERROR ) break;
+        control( curr, arrival );   /* counted in the stats */
+        if( curr.State != KBIO_STATE_RUN ) break;
+        if( infos.NbRows == 0 ) std::this_thread::sleep_for( std::chrono::milliseconds( poll_ms ) );
+    }
+    thread_status = status;
+    running = false;
+}
+
+TControlLoopStats_t ControlLoop::stats() const
+{
+    std::lock_guard<std::mutex> guard( stats_lock );
+    return counters;
+}
+
+LatencyHistogram ControlLoop::latency( int which ) const
+{
+    std::lock_guard<std::mutex> guard( stats_lock );
+    return ( which >= 0 && which < CTRL_NB_LATENCIES ) ? latencies[which] : LatencyHistogram();
+}
+
+void ControlLoop::resetStats()
+{
+    std::lock_guard<std::mutex> guard( stats_lock );
+    memset( &counters, 0, sizeof(counters) );
+    for( int i = 0; i < CTRL_NB_LATENCIES; i++ ) latencies[i].reset();
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#ifndef _CONTROLLOOP_H_
+#define _CONTROLLOOP_H_
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BLDecode.h"
+#include "BLFunctionTable.h"
+#include "EccParams.h"
+#include "Histogram.h"
+
+/*
+ * Closed-loop control of a running technique
+ *
+ * The data of a channel are decoded as they arrive and given to a control
+ * function, which may decide to change parameters of the techniques loaded
+ * (Voltage_step, Current_step, ...). The changes are checked against the chain
+ * loaded, then sent with BL_UpdateParameters while the technique runs: no stop,
+ * reload and restart.
+ *
+ * The time from the last point of a frame to the end of the update it caused is
+ * measured: the age of the point when the buffer arrived (elapsed time of the
+ * channel minus the time of the point) plus the time spent on the computer.
+ */
+
+/**
+ * \defgroup control_loop Closed-loop control
+ * @{
+ */
+
+/** Parameters changed by a \ref TControlFunction_t */
+typedef struct {
+    int                      TechniqueIndex; /*!< technique of the chain to update */
+    std::vector<TEccParam_t> Params;         /*!< parameters to change: label, index, type and new value */
+} TControlUpdate_t;
+
+/**
+ * Control function, called for each frame of data. It returns true to send the
+ * parameters put in 'update', whose TechniqueIndex is preset to the technique which
+ * produced the frame and Params is empty. At most \ref ECC_UPDATE_MAX_PARAMS
+ * parameters may be changed at once, and not the acquisition ones (\ref ECC_IsHardwareParam).
+ */
+typedef bool (*TControlFunction_t)( void* user, const TDecodedFrame_t& frame, const TCurrentValues_t& curr, TControlUpdate_t* update );
+
+/** Latencies measured by a \ref ControlLoop */
+typedef enum {
+    CTRL_LATENCY_END_TO_END = 0, /*!< from the last point of the frame to the end of the update */
+    CTRL_LATENCY_HOST       = 1, /*!< from the arrival of the buffer to the end of the update */
+    CTRL_LATENCY_UPDATE     = 2, /*!< BL_UpdateParameters call */
+    CTRL_NB_LATENCIES       = 3
+} TControlLatency_e;
+
+/** Counters of a \ref ControlLoop */
+typedef struct {
+    unsigned long long Frames;    /*!< data buffers processed */
+    unsigned long long Points;
+    unsigned long long Decisions; /*!< updates asked by the control function */
+    unsigned long long Updates;   /*!< updates done */
+    unsigned long long Rejected;  /*!< updates not valid for the chain, not sent */
+    unsigned long long Failed;    /*!< updates refused by BL_UpdateParameters */
+    int                LastError; /*!< last error of an update */
+} TControlLoopStats_t;
+
+/**
+ * This class runs a control function on the data of one channel. The data are
+ * either read by the thread of the loop (\ref start), or given by the thread
+ * which already calls BL_GetData (\ref process).
+ */
+class ControlLoop
+{
+public:
+    /**
+     * @param eclib ECLib functions: BL_UpdateParameters, BL_GetData for \ref start and
+     *              BL_ConvertNumericIntoSingle if set
+     * @param ecc_dir folder of the .ecc files, prepended to \ref TEccTechnique_t::EccFile
+     */
+    ControlLoop( const TEClibFunctions* eclib, const std::string& ecc_dir = std::string() );
+    ~ControlLoop();
+
+    /**
+     * This function sets the channel and the chain loaded on it.
+     *
+     * @param id device identifier
+     * @param channel channel (0-based)
+     * @param chain techniques loaded on the channel, in order
+     * @param vmp4 true if the device uses the VMP4 technology (decoding)
+     * @param xrec extra values recorded (decoding)
+     * @param control control function
+     * @param user given to the control function
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_INVALIDPARAMETERS if a function is
+     *         missing or the chain is empty, \ref ERR_GEN_FUNCTIONINPROGRESS if the loop runs.
+     */
+    int setup( int id, uint8 channel, const std::vector<TEccTechnique_t>& chain, bool vmp4, int xrec,
+               TControlFunction_t control, void* user );
+
+    /**
+     * This function processes a buffer returned by BL_GetData: decodes it, calls the
+     * control function and sends the update it asked for. It must be called as soon
+     * as the buffer is received, the arrival time is taken when it is called.
+     *
+     * @return \ref ERR_NOERROR if successful, the error of \ref BL_DecodeData,
+     *         \ref ERR_GEN_UPDATEPARAMETERS if the update is not valid for the chain,
+     *         otherwise the error of BL_UpdateParameters.
+     */
+    int process( const TDataBuffer_t& buf, const TDataInfos_t& infos, const TCurrentValues_t& curr );
+
+    /**
+     * This function starts a thread which reads the data of the channel with BL_GetData
+     * and processes them, until the channel stops or \ref stop is called. The update
+     * errors are counted; an error of BL_GetData or of the decoding ends the thread.
+     *
+     * @param poll_ms time to wait when the channel has no new data
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_INVALIDPARAMETERS if \ref setup was
+     *         not done or BL_GetData is missing, \ref ERR_GEN_FUNCTIONINPROGRESS if the loop runs.
+     */
+    int start( unsigned int poll_ms = 5 );
+
+    /** Stops the thread and waits for it */
+    void stop();
+
+    bool isRunning() const { return running; }
+
+    /** Error which ended the thread, \ref ERR_NOERROR if the channel stopped or \ref stop was called */
+    int  status() const { return thread_status; }
+
+    TControlLoopStats_t stats() const;
+
+    /** Copy of a latency histogram (see \ref TControlLatency_e) */
+    LatencyHistogram latency( int which ) const;
+
+    void resetStats();
+
+private:
+    ControlLoop( const ControlLoop& );
+    ControlLoop& operator=( const ControlLoop& );
+
+    int  decode( const TDataBuffer_t& buf, const TDataInfos_t& infos, const TCurrentValues_t& curr );
+    int  control( const TCurrentValues_t& curr, double arrival );
+    int  check( const TControlUpdate_t& update ) const;
+    void run( unsigned int poll_ms );
+
+    const TEClibFunctions*           eclib;
+    std::string                      ecc_dir;
+    int                              device_id;
+    uint8                            channel;
+    std::vector<TEccTechnique_t>     chain;     /* values as last updated */
+    bool                             vmp4;
+    int                              xrec;
+    TControlFunction_t               function;
+    void*                            user;
+
+    std::unique_ptr<TDecodedFrame_t> frame;
+    TControlUpdate_t                 update;
+
+    std::thread                      worker;
+    std::atomic<bool>                running;
+    std::atomic<bool>                stopping;
+    std::atomic<int>                 thread_status;
+
+    mutable std::mutex               stats_lock;
+    TControlLoopStats_t              counters;
+    LatencyHistogram                 latencies[CTRL_NB_LATENCIES];
+};
+
+/** @} */
+
+#endif /* _CONTROLLOOP_H_ */
@@ -0,0 +1,770 @@
+#include "DataTrace.h"
+
+#include <string.h>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include "BLDecode.h"
+#include "EccParams.h"
+#include "FileUtils.h"
+
+static const char TRC_MAGIC[TRC_MAGIC_SIZE + 1] = "ECLIBTRC";
+
+#define TRC_MAX_WORDS       (sizeof(TDataBuffer_t) / 4)
+#define TRC_INFOS_WORDS     (sizeof(TDataInfos_t) / 4)
+#define TRC_CURR_WORDS      (sizeof(TCurrentValues_t) / 4)
+/* a data record at most: header, 5 varints, channel, 2 masks and all the words */
+#define TRC_MAX_PAYLOAD     ( 1 + 5 * 10 + 1 + 2 * 10 + sizeof(TDataInfos_t) + sizeof(TCurrentValues_t) + 10 + sizeof(TDataBuffer_t) + sizeof(TDeviceInfos_t) )
+
+static_assert( sizeof(TDataInfos_t) % 4 == 0 && TRC_INFOS_WORDS <= 64, "TDataInfos_t as a mask of 32 bits words" );
+static_assert( sizeof(TCurrentValues_t) % 4 == 0 && TRC_CURR_WORDS <= 64, "TCurrentValues_t as a mask of 32 bits words" );
+
+template<typename T>
+static T s_get( const unsigned char* p ){
+    T value;
+    memcpy( &value, p, sizeof(T) );
+    return value;
+}
+
+static long long s_clockNs(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+static void s_putVarint( std::vector<unsigned char>& out, unsigned long long value ){
+    while( value >= 0x80 ){
+        out.push_back( (unsigned char)( value | 0x80 ) );
+        value >>= 7;
+    }
+    out.push_back( (unsigned char)value );
+}
+
+static void s_putZigzag( std::vector<unsigned char>& out, long long value ){
+    s_putVarint( out, ( (unsigned long long)value << 1 ) ^ (unsigned long long)( value >> 63 ) );
+}
+
+static bool s_getVarint( const unsigned char*& p, const unsigned char* end, unsigned long long* value ){
+    unsigned long long v = 0;
+    for( int shift = 0; shift < 64 && p < end; shift += 7 ){
+        unsigned char byte = *p++;
+        v |= (unsigned long long)( byte & 0x7F ) << shift;
+        if( !( byte & 0x80 ) ){
+            *value = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool s_getZigzag( const unsigned char*& p, const unsigned char* end, long long* value ){
+    unsigned long long v;
+    if( !s_getVarint( p, end, &v ) ) return false;
+    *value = (long long)( v >> 1 ) ^ -(long long)( v & 1 );
+    return true;
+}
+
+/* the words of 'now' which differ from 'before': the mask then the words; 'before' takes 'now' */
+static void s_putDelta( std::vector<unsigned char>& out, void* before, const void* now, size_t words ){
+    unsigned int* b = (unsigned int*)before;
+    const unsigned char* n = (const unsigned char*)now;
+    unsigned long long mask = 0;
+    for( size_t i = 0; i < words; i++ ) if( memcmp( b + i, n + 4 * i, 4 ) != 0 ) mask |= 1ULL << i;
+    s_putVarint( out, mask );
+    for( size_t i = 0; i < words; i++ ){
+        if( !( mask & ( 1ULL << i ) ) ) continue;
+        out.insert( out.end(), n + 4 * i, n + 4 * i + 4 );
+        memcpy( b + i, n + 4 * i, 4 );
+    }
+}
+
+static bool s_getDelta( const unsigned char*& p, const unsigned char* end, void* value, size_t words ){
+    unsigned long long mask;
+    if( !s_getVarint( p, end, &mask ) || ( words < 64 && ( mask >> words ) ) ) return false;
+    unsigned char* v = (unsigned char*)value;
+    for( size_t i = 0; i < words; i++ ){
+        if( !( mask & ( 1ULL << i ) ) ) continue;
+        if( end - p < 4 ) return false;
+        memcpy( v + 4 * i, p, 4 );
+        p += 4;
+    }
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// TraceRecorder
+
+TraceRecorder::TraceRecorder()
+    : file( 0 ), origin( s_clockNs() ), previous( 0 ), count( 0 ), size( 0 ), error( ERR_NOERROR )
+{
+}
+
+TraceRecorder::~TraceRecorder()
+{
+    close();
+}
+
+int TraceRecorder::open( const char* path )
+{
+    close();
+    std::lock_guard<std::mutex> guard( lock );
+    file = fopen( path, "wb" );
+    if( !file ) return ERR_GEN_FUNCTIONFAILED;
+    setvbuf( file, 0, _IOFBF, 1 << 20 );
+    unsigned char header[TRC_FILE_HEADER_SIZE];
+    unsigned int   version = TRC_VERSION;
+    unsigned short infos = (unsigned short)sizeof(TDataInfos_t);
+    unsigned short curr  = (unsigned short)sizeof(TCurrentValues_t);
+    memcpy( header, TRC_MAGIC, TRC_MAGIC_SIZE );
+    memcpy( header + 8, &version, 4 );
+    memcpy( header + 12, &infos, 2 );
+    memcpy( header + 14, &curr, 2 );
+    origin   = s_clockNs();
+    previous = 0;
+    count    = 0;
+    size     = TRC_FILE_HEADER_SIZE;
+    error    = ( fwrite( header, 1, sizeof(header), file ) == sizeof(header) ) ? ERR_NOERROR : ERR_GEN_FUNCTIONFAILED;
+    last.clear();
+    return error;
+}
+
+int TraceRecorder::close()
+{
+    std::lock_guard<std::mutex> guard( lock );
+    if( !file ) return ERR_NOERROR;
+    if( fflush( file ) != 0 || FILE_Sync( file ) != ERR_NOERROR ) error = ERR_GEN_FUNCTIONFAILED;
+    if( fclose( file ) != 0 ) error = ERR_GEN_FUNCTIONFAILED;
+    file = 0;
+    return error;
+}
+
+long long TraceRecorder::now() const
+{
+    return s_clockNs() - origin;
+}
+
+/* the record of the body built, under the lock */
+void TraceRecorder::write( int type, long long start, long long end, int id, int status )
+{
+    record.clear();
+    record.resize( TRC_RECORD_HEADER_SIZE );
+    record.push_back( (unsigned char)type );
+    s_putZigzag( record, start - previous );
+    s_putVarint( record, end > start ? end - start : 0 );
+    s_putZigzag( record, id );
+    s_putZigzag( record, status );
+    record.insert( record.end(), body.begin(), body.end() );
+    previous = start;
+
+    unsigned int payload = (unsigned int)( record.size() - TRC_RECORD_HEADER_SIZE );
+    unsigned int crc     = CRC32_Compute( record.data() + TRC_RECORD_HEADER_SIZE, payload );
+    memcpy( record.data(), &payload, 4 );
+    memcpy( record.data() + 4, &crc, 4 );
+    if( fwrite( record.data(), 1, record.size(), file ) != record.size() ) error = ERR_GEN_FUNCTIONFAILED;
+    count++;
+    size += record.size();
+}
+
+void TraceRecorder::recordConnect( long long start, int status, int id, const TDeviceInfos_t& infos )
+{
+    long long end = now();
+    std::lock_guard<std::mutex> guard( lock );
+    if( !file ) return;
+    body.assign( (const unsigned char*)&infos, (const unsigned char*)&infos + sizeof(infos) );
+    write( TRC_CONNECT, start, end, id, status );
+
+    /* a new connection with this identifier: its channels start again */
+    for( size_t i = 0; i < last.size(); i++ ){
+        if( last[i].Device != id ) continue;
+        last.erase( last.begin() + i );
+        i--;
+    }
+}
+
+void TraceRecorder::recordInfos( long long start, int id, uint8 channel, int status, const TChannelInfos_t& infos )
+{
+    long long end = now();
+    std::lock_guard<std::mutex> guard( lock );
+    if( !file ) return;
+    body.clear();
+    body.push_back( channel );
+    body.insert( body.end(), (const unsigned char*)&infos, (const unsigned char*)&infos + sizeof(infos) );
+    write( TRC_INFOS, start, end, id, status );
+}
+
+void TraceRecorder::recordData( long long start, int id, uint8 channel, int status, const TDataBuffer_t& buf,
+                                const TDataInfos_t& infos, const TCurrentValues_t& curr )
+{
+    long long end = now();
+    std::lock_guard<std::mutex> guard( lock );
+    if( !file ) return;
+    body.clear();
+    body.push_back( channel );
+    if( status == ERR_NOERROR ){
+        size_t i = 0;
+        while( i < last.size() && ( last[i].Device != id || last[i].Channel != channel ) ) i++;
+        if( i == last.size() ){
+            TLast_t l;
+            memset( &l, 0, sizeof(l) );
+            l.Device  = id;
+            l.Channel = channel;
+            last.push_back( l );
+        }
+        s_putDelta( body, &last[i].Infos, &infos, TRC_INFOS_WORDS );
+        s_putDelta( body, &last[i].Curr, &curr, TRC_CURR_WORDS );
+        size_t words = ( infos.NbRows > 0 && infos.NbCols > 0 ) ? (size_t)infos.NbRows * infos.NbCols : 0;
+        if( words > TRC_MAX_WORDS ) words = TRC_MAX_WORDS;
+        s_putVarint( body, words );
+        body.insert( body.end(), (const unsigned char*)buf.data, (const unsigned char*)( buf.data + words ) );
+    }
+    write( TRC_DATA, start, end, id, status );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// TraceReader
+
+TraceReader::TraceReader()
+    : position( 0 ), previous( 0 ), truncated( false )
+{
+}
+
+int TraceReader::open( const char* path )
+{
+    close();
+    int status = mapping.open( path );
+    if( status != ERR_NOERROR ) return status;
+    const unsigned char* p = mapping.data();
+    if( mapping.size() < TRC_FILE_HEADER_SIZE || memcmp( p, TRC_MAGIC, TRC_MAGIC_SIZE ) != 0
+        || s_get<unsigned int>( p + 8 ) != TRC_VERSION
+        || s_get<unsigned short>( p + 12 ) != sizeof(TDataInfos_t)
+        || s_get<unsigned short>( p + 14 ) != sizeof(TCurrentValues_t) ){
+        mapping.close();
+        return ERR_TECH_DATACORRUPTED;
+    }
+    position = TRC_FILE_HEADER_SIZE;
+    return ERR_NOERROR;
+}
+
+void TraceReader::close()
+{
+    mapping.close();
+    position  = 0;
+    previous  = 0;
+    truncated = false;
+    last.clear();
+}
+
+bool TraceReader::next( TTraceRecord_t& record )
+{
+    if( !mapping.isOpen() || truncated ) return false;
+    size_t size = mapping.size();
+    if( position == size ) return false;
+
+    const unsigned char* p = mapping.data() + position;
+    truncated = true;
+    if( size - position < TRC_RECORD_HEADER_SIZE ) return false;
+    unsigned int payload = s_get<unsigned int>( p );
+    if( payload == 0 || payload > TRC_MAX_PAYLOAD || size - position - TRC_RECORD_HEADER_SIZE < payload ) return false;
+    p += TRC_RECORD_HEADER_SIZE;
+    if( CRC32_Compute( p, payload ) != s_get<unsigned int>( p - 4 ) ) return false;
+    const unsigned char* end = p + payload;
+
+    long long delta, device, status;
+    unsigned long long duration;
+    record.Type = *p++;
+    if( !s_getZigzag( p, end, &delta ) || !s_getVarint( p, end, &duration ) || !s_getZigzag( p, end, &device ) ||
+        !s_getZigzag( p, end, &status ) ) return false;
+    record.Start    = previous + delta;
+    record.Duration = (long long)duration;
+    record.Device   = (int)device;
+    record.Status   = (int)status;
+    record.Channel  = -1;
+    record.Words    = 0;
+
+    switch( record.Type ){
+    case TRC_CONNECT:
+        if( (size_t)( end - p ) != sizeof(TDeviceInfos_t) ) return false;
+        memcpy( &record.DeviceInfos, p, sizeof(TDeviceInfos_t) );
+        for( size_t i = 0; i < last.size(); i++ ){
+            if( last[i].Device != record.Device ) continue;
+            last.erase( last.begin() + i );
+            i--;
+        }
+        break;
+    case TRC_INFOS:
+        if( (size_t)( end - p ) != 1 + sizeof(TChannelInfos_t) ) return false;
+        record.Channel = *p++;
+        memcpy( &record.ChannelInfos, p, sizeof(TChannelInfos_t) );
+        break;
+    case TRC_DATA: {
+        if( end - p < 1 ) return false;
+        record.Channel = *p++;
+        if( record.Status != ERR_NOERROR ){
+            if( p != end ) return false;
+            break;
+        }
+        size_t i = 0;
+        while( i < last.size() && ( last[i].Device != record.Device || last[i].Channel != record.Channel ) ) i++;
+        if( i == last.size() ){
+            TLast_t l;
+            memset( &l, 0, sizeof(l) );
+            l.Device  = record.Device;
+            l.Channel = record.Channel;
+            last.push_back( l );
+        }
+        unsigned long long words;
+        if( !s_getDelta( p, end, &last[i].Infos, TRC_INFOS_WORDS ) || !s_getDelta( p, end, &last[i].Curr, TRC_CURR_WORDS ) ||
+            !s_getVarint( p, end, &words ) || words > TRC_MAX_WORDS || (size_t)( end - p ) != words * 4 ) return false;
+        record.Infos = last[i].Infos;
+        record.Curr  = last[i].Curr;
+        record.Words = (int)words;
+        memcpy( record.Buffer.data, p, (size_t)words * 4 );
+        break;
+    }
+    default:
+        return false;
+    }
+
+    previous  = record.Start;
+    truncated = false;
+    position += TRC_RECORD_HEADER_SIZE + payload;
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Recording table
+
+static TEClibFunctions s_real;
+static TraceRecorder*  s_recorder = 0;
+
+static int BL_STDCALL s_recordConnect( const char* address, uint8 timeout, int* pID, TDeviceInfos_t* pInfos ){
+    long long start = s_recorder->now();
+    int status = s_real.BL_Connect( address, timeout, pID, pInfos );
+    TDeviceInfos_t none;
+    memset( &none, 0, sizeof(none) );
+    s_recorder->recordConnect( start, status, ( status == ERR_NOERROR && pID ) ? *pID : -1, ( status == ERR_NOERROR && pInfos ) ? *pInfos : none );
+    return status;
+}
+
+static int BL_STDCALL s_recordChannelInfos( int ID, uint8 ch, TChannelInfos_t* infos ){
+    long long start = s_recorder->now();
+    int status = s_real.BL_GetChannelInfos( ID, ch, infos );
+    TChannelInfos_t none;
+    memset( &none, 0, sizeof(none) );
+    s_recorder->recordInfos( start, ID, ch, status, ( status == ERR_NOERROR && infos ) ? *infos : none );
+    return status;
+}
+
+static int BL_STDCALL s_recordData( int ID, uint8 channel, TDataBuffer_t* pBuf, TDataInfos_t* pInfos, TCurrentValues_t* pValues ){
+    long long start = s_recorder->now();
+    int status = s_real.BL_GetData( ID, channel, pBuf, pInfos, pValues );
+    if( pBuf && pInfos && pValues ) s_recorder->recordData( start, ID, channel, status, *pBuf, *pInfos, *pValues );
+    return status;
+}
+
+/* true if a function of the table is a wrapper: its calls would come back to it */
+static bool s_isRecorded( const TEClibFunctions* eclib ){
+    return eclib->BL_Connect == s_recordConnect || eclib->BL_GetChannelInfos == s_recordChannelInfos || eclib->BL_GetData == s_recordData;
+}
+
+int TRC_RecordTable( const TEClibFunctions* eclib, TraceRecorder* recorder, TEClibFunctions* out )
+{
+    if( !eclib || !out || eclib == out || s_isRecorded( eclib ) ) return ERR_GEN_INVALIDPARAMETERS;
+    if( recorder && s_recorder && ( recorder != s_recorder || memcmp( eclib, &s_real, sizeof(s_real) ) != 0 ) ) return ERR_GEN_FUNCTIONINPROGRESS;
+    *out = *eclib;
+    if( !recorder ) return ERR_NOERROR;
+    s_real     = *eclib;
+    s_recorder = recorder;
+    if( s_real.BL_Connect )         out->BL_Connect         = s_recordConnect;
+    if( s_real.BL_GetChannelInfos ) out->BL_GetChannelInfos = s_recordChannelInfos;
+    if( s_real.BL_GetData )         out->BL_GetData         = s_recordData;
+    return ERR_NOERROR;
+}
+
+void TRC_ReleaseTable()
+{
+    s_recorder = 0;
+    memset( &s_real, 0, sizeof(s_real) );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// TraceReplay
+
+TraceReplay::TraceReplay()
+    : connected( 0 ), speed( 1.0 ), length( 0 ), total( 0 ), served( 0 )
+{
+}
+
+int TraceReplay::load( const char* path )
+{
+    TraceReader reader;
+    int status = reader.open( path );
+    if( status != ERR_NOERROR ) return status;
+
+    std::lock_guard<std::mutex> guard( lock );
+    devices.clear();
+    total  = 0;
+    length = 0;
+    long long end = 0;
+    std::unique_ptr<TTraceRecord_t> record( new TTraceRecord_t );
+    while( reader.next( *record ) ){
+        const TTraceRecord_t& r = *record;
+        if( r.Start + r.Duration > end ) end = r.Start + r.Duration;
+        if( r.Type == TRC_CONNECT ){
+            TDeviceTrace_t device;
+            device.Id        = r.Device;
+            device.Status    = r.Status;
+            device.Connected = r.Start + r.Duration;
+            device.Infos     = r.DeviceInfos;
+            device.Origin    = 0;
+            device.Open      = false;
+            devices.push_back( device );
+            continue;
+        }
+
+        /* the last connection with this identifier */
+        size_t d = devices.size();
+        while( d > 0 && ( devices[d - 1].Id != r.Device || devices[d - 1].Status != ERR_NOERROR ) ) d--;
+        if( d == 0 || r.Channel < 0 ) continue;
+        TDeviceTrace_t& device = devices[d - 1];
+        size_t c = 0;
+        while( c < device.Channels.size() && device.Channels[c].Channel != r.Channel ) c++;
+        if( c == device.Channels.size() ){
+            TChannelTrace_t channel;
+            channel.Channel  = r.Channel;
+            channel.HasInfos = false;
+            channel.Next     = 0;
+            memset( &channel.Infos, 0, sizeof(channel.Infos) );
+            memset( &channel.Last, 0, sizeof(channel.Last) );
+            device.Channels.push_back( channel );
+        }
+        TChannelTrace_t& channel = device.Channels[c];
+        if( r.Type == TRC_INFOS ){
+            if( r.Status == ERR_NOERROR && !channel.HasInfos ){
+                channel.Infos    = r.ChannelInfos;
+                channel.HasInfos = true;
+            }
+            continue;
+        }
+        TAnswer_t answer;
+        answer.Due    = r.Start + r.Duration - device.Connected;
+        answer.Status = r.Status;
+        if( r.Status == ERR_NOERROR ){
+            answer.Infos = r.Infos;
+            answer.Curr  = r.Curr;
+            answer.Words.assign( r.Buffer.data, r.Buffer.data + r.Words );
+            if( channel.Answers.empty() ) channel.Last = r.Curr;
+        } else {
+            memset( &answer.Infos, 0, sizeof(answer.Infos) );
+            memset( &answer.Curr, 0, sizeof(answer.Curr) );
+        }
+        channel.Answers.push_back( answer );
+        total++;
+    }
+    for( size_t d = 0; d < devices.size(); d++ ){
+        if( devices[d].Status != ERR_NOERROR ) continue;
+        length = end - devices[d].Connected;
+        return ERR_NOERROR;
+    }
+    devices.clear();
+    return ERR_GEN_FILENOTEXISTS;
+}
+
+void TraceReplay::setSpeed( double value )
+{
+    std::lock_guard<std::mutex> guard( lock );
+    speed = ( value > 0.0 ) ? value : 0.0;
+}
+
+void TraceReplay::rewind()
+{
+    std::lock_guard<std::mutex> guard( lock );
+    connected = 0;
+    served    = 0;
+    for( size_t d = 0; d < devices.size(); d++ ){
+        devices[d].Open = false;
+        for( size_t c = 0; c < devices[d].Channels.size(); c++ ){
+            TChannelTrace_t& channel = devices[d].Channels[c];
+            channel.Next = 0;
+            if( !channel.Answers.empty() ) channel.Last = channel.Answers[0].Curr;
+        }
+    }
+}
+
+TraceReplay::TChannelTrace_t* TraceReplay::find( int id, uint8 channel, TDeviceTrace_t** device )
+{
+    for( size_t d = devices.size(); d > 0; d-- ){
+        TDeviceTrace_t& dev = devices[d - 1];
+        if( !dev.Open || dev.Id != id ) continue;
+        if( device ) *device = &dev;
+        for( size_t c = 0; c < dev.Channels.size(); c++ ) if( dev.Channels[c].Channel == channel ) return &dev.Channels[c];
+        return 0;
+    }
+    if( device ) *device = 0;
+    return 0;
+}
+
+int TraceReplay::connect( int* id, TDeviceInfos_t* infos )
+{
+    std::lock_guard<std::mutex> guard( lock );
+    if( connected >= devices.size() ) return ERR_COMM_CONNECTIONFAILED;
+    TDeviceTrace_t& device = devices[connected++];
+    if( device.Status != ERR_NOERROR ) return device.Status;
+    device.Open   = true;
+    device.Origin = s_clockNs();
+    if( id ) *id = device.Id;
+    if( infos ) *infos = device.Infos;
+    return ERR_NOERROR;
+}
+
+int TraceReplay::channelInfos( int id, uint8 channel, TChannelInfos_t* infos )
+{
+    if( !infos ) return ERR_GEN_INVALIDPARAMETERS;
+    std::lock_guard<std::mutex> guard( lock );
+    TDeviceTrace_t* device;
+    TChannelTrace_t* c = find( id, channel, &device );
+    if( !device ) return ERR_GEN_NOTCONNECTED;
+    if( !c ) return ERR_GEN_CHANNELNOTPLUGGED;
+    if( c->HasInfos ){
+        *infos = c->Infos;
+    } else {
+        memset( infos, 0, sizeof(*infos) );
+        infos->Channel = channel;
+    }
+    infos->State = c->Last.State;
+    return ERR_NOERROR;
+}
+
+int TraceReplay::getData( int id, uint8 channel, TDataBuffer_t* buf, TDataInfos_t* infos, TCurrentValues_t* curr )
+{
+    if( !buf || !infos || !curr ) return ERR_GEN_INVALIDPARAMETERS;
+    const TAnswer_t* answer = 0;
+    long long due = 0;
+    {
+        std::lock_guard<std::mutex> guard( lock );
+        TDeviceTrace_t* device;
+        TChannelTrace_t* c = find( id, channel, &device );
+        if( !device ) return ERR_GEN_NOTCONNECTED;
+        if( !c ) return ERR_GEN_CHANNELNOTPLUGGED;
+        if( c->Next == c->Answers.size() ){
+            /* the trace of the channel is over: no point, stopped */
+            memset( infos, 0, sizeof(*infos) );
+            *curr = c->Last;
+            curr->State = KBIO_STATE_STOP;
+            return ERR_NOERROR;
+        }
+        answer = &c->Answers[c->Next++];
+        if( answer->Status == ERR_NOERROR ) c->Last = answer->Curr;
+        if( speed > 0.0 ) due = device->Origin + (long long)( answer->Due / speed );
+        served++;
+    }
+
+    /* the answers are not changed once loaded: copied out of the lock */
+    if( due > 0 ){
+        long long wait = due - s_clockNs();
+        if( wait > 0 ) std::this_thread::sleep_for( std::chrono::nanoseconds( wait ) );
+    }
+    if( answer->Status != ERR_NOERROR ) return answer->Status;
+    *infos = answer->Infos;
+    *curr  = answer->Curr;
+    if( !answer->Words.empty() ) memcpy( buf->data, answer->Words.data(), answer->Words.size() * 4 );
+    return ERR_NOERROR;
+}
+
+int TraceReplay::currentValues( int id, uint8 channel, TCurrentValues_t* curr )
+{
+    if( !curr ) return ERR_GEN_INVALIDPARAMETERS;
+    std::lock_guard<std::mutex> guard( lock );
+    TDeviceTrace_t* device;
+    TChannelTrace_t* c = find( id, channel, &device );
+    if( !device ) return ERR_GEN_NOTCONNECTED;
+    if( !c ) return ERR_GEN_CHANNELNOTPLUGGED;
+    *curr = c->Last;
+    if( c->Next == c->Answers.size() ) curr->State = KBIO_STATE_STOP;
+    return ERR_NOERROR;
+}
+
+bool TraceReplay::plugged( int id, uint8 channel )
+{
+    std::lock_guard<std::mutex> guard( lock );
+    return find( id, channel, 0 ) != 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Replay table
+
+static TraceReplay* s_replay = 0;
+
+static int BL_STDCALL s_getLibVersion( char* pVersion, unsigned int* psize ){
+    static const char version[] = "trace replay";
+    if( !pVersion || !psize || *psize < sizeof(version) ) return ERR_GEN_INVALIDPARAMETERS;
+    memcpy( pVersion, version, sizeof(version) );
+    *psize = sizeof(version);
+    return ERR_NOERROR;
+}
+
+static unsigned int BL_STDCALL s_getVolumeSerialNumber(){
+    return 0;
+}
+
+static int BL_STDCALL s_getErrorMsg( int errorcode, char* pmsg, unsigned int* psize ){
+    if( !pmsg || !psize || *psize == 0 ) return ERR_GEN_INVALIDPARAMETERS;
+    int n = snprintf( pmsg, *psize, "error %d (trace replay)", errorcode );
+    *psize = ( n < 0 ) ? 0 : (unsigned int)n;
+    return ERR_NOERROR;
+}
+
+static int BL_STDCALL s_connect( const char*, uint8, int* pID, TDeviceInfos_t* pInfos ){
+    return s_replay->connect( pID, pInfos );
+}
+
+static int BL_STDCALL s_disconnect( int ){
+    return ERR_NOERROR;
+}
+
+static int BL_STDCALL s_testConnection( int ){
+    return ERR_NOERROR;
+}
+
+static int BL_STDCALL s_testCommSpeed( int ID, uint8 channel, int* spd_rcvt, int* spd_kernel ){
+    if( !s_replay->plugged( ID, channel ) ) return ERR_GEN_CHANNELNOTPLUGGED;
+    if( spd_rcvt ) *spd_rcvt = 0;
+    if( spd_kernel ) *spd_kernel = 0;
+    return ERR_NOERROR;
+}
+
+static bool BL_STDCALL s_getUSBdeviceinfos( unsigned int, char*, unsigned int*, char*, unsigned int*, char*, unsigned int* ){
+    return false;
+}
+
+static int BL_STDCALL s_loadFirmware( int, uint8*, int* pResults, uint8 Length, bool, bool, const char*, const char* ){
+    if( pResults ) for( int i = 0; i < Length; i++ ) pResults[i] = ERR_NOERROR;
+    return ERR_NOERROR;
+}
+
+static bool BL_STDCALL s_isChannelPlugged( int ID, uint8 ch ){
+    return s_replay->plugged( ID, ch );
+}
+
+static int BL_STDCALL s_getChannelsPlugged( int ID, uint8* pChPlugged, uint8 Size ){
+    if( !pChPlugged ) return ERR_GEN_INVALIDPARAMETERS;
+    for( int i = 0; i < Size; i++ ) pChPlugged[i] = s_replay->plugged( ID, (uint8)i ) ? 1 : 0;
+    return ERR_NOERROR;
+}
+
+static int BL_STDCALL s_getChannelInfos( int ID, uint8 ch, TChannelInfos_t* infos ){
+    return s_replay->channelInfos( ID, ch, infos );
+}
+
+static int BL_STDCALL s_getMessage( int, uint8, char* msg, unsigned int* size ){
+    if( msg && size && *size ) msg[0] = '\0';
+    if( size ) *size = 0;
+    return ERR_NOERROR;
+}
+
+static int BL_STDCALL s_getHardConf( int, uint8, THardwareConf_t* pHardConf ){
+    if( !pHardConf ) return ERR_GEN_INVALIDPARAMETERS;
+    memset( pHardConf, 0, sizeof(*pHardConf) );
+    return ERR_NOERROR;
+}
+
+static int BL_STDCALL s_setHardConf( int, uint8, THardwareConf_t ){
+    return ERR_NOERROR;
+}
+
+static int BL_STDCALL s_loadTechnique( int, uint8, const char*, TEccParams_t, bool, bool, bool ){
+    return ERR_NOERROR;
+}
+
+static int BL_STDCALL s_defineBoolParameter( const char* lbl, bool value, int index, TEccParam_t* pParam ){
+    return ECC_DefineBoolParameter( lbl, value, index, pParam );
+}
+
+static int BL_STDCALL s_defineSglParameter( const char* lbl, float value, int index, TEccParam_t* pParam ){
+    return ECC_DefineSglParameter( lbl, value, index, pParam );
+}
+
+static int BL_STDCALL s_defineIntParameter( const char* lbl, int value, int index, TEccParam_t* pParam ){
+    return ECC_DefineIntParameter( lbl, value, index, pParam );
+}
+
+static int BL_STDCALL s_updateParameters( int, uint8, int, TEccParams_t, const char* ){
+    return ERR_NOERROR;
+}
+
+static int BL_STDCALL s_startChannel( int, uint8 ){
+    return ERR_NOERROR;
+}
+
+static int BL_STDCALL s_channels( int, uint8*, int* pResults, uint8 length ){
+    if( pResults ) for( int i = 0; i < length; i++ ) pResults[i] = ERR_NOERROR;
+    return ERR_NOERROR;
+}
+
+static int BL_STDCALL s_getCurrentValues( int ID, uint8 channel, TCurrentValues_t* pValues ){
+    return s_replay->currentValues( ID, channel, pValues );
+}
+
+static int BL_STDCALL s_getData( int ID, uint8 channel, TDataBuffer_t* pBuf, TDataInfos_t* pInfos, TCurrentValues_t* pValues ){
+    return s_replay->getData( ID, channel, pBuf, pInfos, pValues );
+}
+
+static int BL_STDCALL s_getFCTData( int, uint8, TDataBuffer_t*, TDataInfos_t*, TCurrentValues_t* ){
+    return ERR_GEN_FUNCTIONFAILED;
+}
+
+static int BL_STDCALL s_setExperimentInfos( int, uint8, TExperimentInfos_t ){
+    return ERR_NOERROR;
+}
+
+static int BL_STDCALL s_getExperimentInfos( int, uint8, TExperimentInfos_t* TExpInfos ){
+    if( !TExpInfos ) return ERR_GEN_INVALIDPARAMETERS;
+    memset( TExpInfos, 0, sizeof(*TExpInfos) );
+    return ERR_NOERROR;
+}
+
+static int BL_STDCALL s_sendMsg( int, uint8, void*, unsigned int* ){
+    return ERR_GEN_FUNCTIONFAILED;
+}
+
+static int BL_STDCALL s_loadFlash( int, const char*, bool ){
+    return ERR_NOERROR;
+}
+
+int TRC_FillFunctionTable( TraceReplay* replay, TEClibFunctions* eclib )
+{
+    if( !replay || !eclib ) return ERR_GEN_INVALIDPARAMETERS;
+    s_replay = replay;
+    eclib->BL_GetLibVersion            = s_getLibVersion;
+    eclib->BL_GetVolumeSerialNumber    = s_getVolumeSerialNumber;
+    eclib->BL_GetErrorMsg              = s_getErrorMsg;
+    eclib->BL_Connect                  = s_connect;
+    eclib->BL_Disconnect               = s_disconnect;
+    eclib->BL_TestConnection           = s_testConnection;
+    eclib->BL_TestCommSpeed            = s_testCommSpeed;
+    eclib->BL_GetUSBdeviceinfos        = s_getUSBdeviceinfos;
+    eclib->BL_LoadFirmware             = s_loadFirmware;
+    eclib->BL_IsChannelPlugged         = s_isChannelPlugged;
+    eclib->BL_GetChannelsPlugged       = s_getChannelsPlugged;
+    eclib->BL_GetChannelInfos          = s_getChannelInfos;
+    eclib->BL_GetMessage               = s_getMessage;
+    eclib->BL_GetHardConf              = s_getHardConf;
+    eclib->BL_SetHardConf              = s_setHardConf;
+    eclib->BL_LoadTechnique            = s_loadTechnique;
+    eclib->BL_DefineBoolParameter      = s_defineBoolParameter;
+    eclib->BL_DefineSglParameter       = s_defineSglParameter;
+    eclib->BL_DefineIntParameter       = s_defineIntParameter;
+    eclib->BL_UpdateParameters         = s_updateParameters;
+    eclib->BL_StartChannel             = s_startChannel;
+    eclib->BL_StartChannels            = s_channels;
+    eclib->BL_StopChannel              = s_startChannel;
+    eclib->BL_StopChannels             = s_channels;
+    eclib->BL_GetCurrentValues         = s_getCurrentValues;
+    eclib->BL_GetData                  = s_getData;
+    eclib->BL_GetFCTData               = s_getFCTData;
+    eclib->BL_ConvertNumericIntoSingle = BL_NativeConvertNumericIntoSingle;
+    eclib->BL_SetExperimentInfos       = s_setExperimentInfos;
+    eclib->BL_GetExperimentInfos       = s_getExperimentInfos;
+    eclib->BL_SendMsg                  = s_sendMsg;
+    eclib->BL_LoadFlash                = s_loadFlash;
+    return ERR_NOERROR;
+}
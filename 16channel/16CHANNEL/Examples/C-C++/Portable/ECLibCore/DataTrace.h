@@ -0,0 +1,282 @@
+#pragma once
+
+#ifndef _DATATRACE_H_
+#define _DATATRACE_H_
+
+#include <stdio.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "BLFunctionTable.h"
+#include "MappedFile.h"
+
+/*
+ * Traces of the answers of the instruments (*.etrc), and their replay
+ *
+ * A function table whose BL_Connect, BL_GetChannelInfos and BL_GetData are
+ * wrapped (TRC_RecordTable) writes every answer to a trace, with the time the
+ * call started and its duration: the exact sequence of TDataBuffer_t,
+ * TDataInfos_t and TCurrentValues_t the instrument returned, errors included.
+ * A replay (TraceReplay, TRC_FillFunctionTable) gives the same answers back
+ * through another function table, in the same order per channel, paced as
+ * they were (or N times faster, or at once): the decoding, the storage and the
+ * export of a real run can then be measured again, offline and on any host.
+ *
+ *     header   "ECLIBTRC" u32 version u16 sizeof(TDataInfos_t) u16 sizeof(TCurrentValues_t)
+ *     record   u32 size u32 crc, u8 type, zigzag start (ns after the start of the
+ *              previous record), varint duration (ns), zigzag device, zigzag status, body
+ *
+ *     connect  TDeviceInfos_t
+ *     infos    u8 channel, TChannelInfos_t
+ *     data     u8 channel, if the status is ERR_NOERROR: TDataInfos_t then
+ *              TCurrentValues_t, each as a varint mask of the 32 bits words which
+ *              changed since the previous answer of the channel and those words,
+ *              then varint NbRows x NbCols and the data words
+ *
+ * (varint: 7 bits per byte, low bits first; zigzag: the sign in the low bit.)
+ *
+ * The structures are stored as they are in memory: a trace is replayed on a
+ * host of the same byte order. A trace cut by a crash is read up to its last
+ * complete record.
+ */
+
+/**
+ * \defgroup data_trace Data traces
+ * @{
+ */
+
+#define TRC_MAGIC_SIZE         (8)
+#define TRC_FILE_HEADER_SIZE   (16)
+#define TRC_RECORD_HEADER_SIZE (8)
+#define TRC_VERSION            (1)
+
+/** Types of records */
+typedef enum {
+    TRC_CONNECT = 1, /*!< answer of BL_Connect */
+    TRC_INFOS   = 2, /*!< answer of BL_GetChannelInfos */
+    TRC_DATA    = 3  /*!< answer of BL_GetData */
+} TTraceRecordType_e;
+
+/** A record of a trace */
+typedef struct {
+    int              Type;          /*!< see \ref TTraceRecordType_e */
+    long long        Start;         /*!< ns after the start of the recording */
+    long long        Duration;      /*!< ns */
+    int              Device;        /*!< identifier given by BL_Connect */
+    int              Status;        /*!< returned by the function */
+    int              Channel;       /*!< 0-based, TRC_INFOS and TRC_DATA */
+    TDeviceInfos_t   DeviceInfos;   /*!< TRC_CONNECT */
+    TChannelInfos_t  ChannelInfos;  /*!< TRC_INFOS */
+    TDataInfos_t     Infos;         /*!< TRC_DATA, if the status is ERR_NOERROR */
+    TCurrentValues_t Curr;          /*!< same */
+    int              Words;         /*!< same, data words in the buffer */
+    TDataBuffer_t    Buffer;        /*!< same */
+} TTraceRecord_t;
+
+/**
+ * This class writes a trace. The record functions may be called by several
+ * threads at once; the records are written in the order of the calls.
+ */
+class TraceRecorder
+{
+public:
+    TraceRecorder();
+    ~TraceRecorder();
+
+    /**
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_FUNCTIONFAILED if the file cannot be written.
+     */
+    int  open( const char* path );
+    /** @return \ref ERR_NOERROR if successful, \ref ERR_GEN_FUNCTIONFAILED if a write failed */
+    int  close();
+    bool isOpen() const { return file != 0; }
+
+    /** ns on the clock of the recorder, for the start of a call */
+    long long now() const;
+
+    void recordConnect( long long start, int status, int id, const TDeviceInfos_t& infos );
+    void recordInfos( long long start, int id, uint8 channel, int status, const TChannelInfos_t& infos );
+    void recordData( long long start, int id, uint8 channel, int status, const TDataBuffer_t& buf,
+                     const TDataInfos_t& infos, const TCurrentValues_t& curr );
+
+    /** Records written and their bytes */
+    unsigned long long records() const { return count; }
+    unsigned long long bytes() const { return size; }
+
+private:
+    TraceRecorder( const TraceRecorder& );
+    TraceRecorder& operator=( const TraceRecorder& );
+
+    void write( int type, long long start, long long end, int id, int status );
+
+    typedef struct {
+        int              Device;
+        int              Channel;
+        TDataInfos_t     Infos;
+        TCurrentValues_t Curr;
+    } TLast_t;
+
+    FILE*                      file;
+    std::mutex                 lock;
+    long long                  origin;
+    long long                  previous;   /* start of the previous record */
+    std::vector<unsigned char> body;       /* of the record being written */
+    std::vector<unsigned char> record;
+    std::vector<TLast_t>       last;       /* previous answer of each channel */
+    unsigned long long         count;
+    unsigned long long         size;
+    int                        error;
+};
+
+/**
+ * This class reads the records of a trace, in order. The reading stops at the
+ * first damaged or incomplete record.
+ */
+class TraceReader
+{
+public:
+    TraceReader();
+
+    /**
+     * @return \ref ERR_NOERROR if successful, the error of \ref MappedFile::open, or
+     *         \ref ERR_TECH_DATACORRUPTED if it is not a trace of this host.
+     */
+    int  open( const char* path );
+    void close();
+
+    /** Reads the next record; false at the end of the valid records */
+    bool next( TTraceRecord_t& record );
+
+    /** True once \ref next stopped on a damaged or incomplete record */
+    bool isTruncated() const { return truncated; }
+
+private:
+    typedef struct {
+        int              Device;
+        int              Channel;
+        TDataInfos_t     Infos;
+        TCurrentValues_t Curr;
+    } TLast_t;
+
+    MappedFile           mapping;
+    size_t               position;
+    long long            previous;
+    bool                 truncated;
+    std::vector<TLast_t> last;
+};
+
+/**
+ * This function makes a function table whose BL_Connect, BL_GetChannelInfos and
+ * BL_GetData write their answers to 'recorder', the functions of 'eclib' being
+ * called. With no recorder (null) the table is a copy of 'eclib'.
+ *
+ * There is one recording table at a time in the program: until \ref TRC_ReleaseTable,
+ * a call with another recorder or other functions is refused, and 'eclib' cannot be
+ * a recording table (its calls would come back to the wrappers).
+ *
+ * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_FUNCTIONINPROGRESS if another
+ *         table records, \ref ERR_GEN_INVALIDPARAMETERS otherwise.
+ */
+int TRC_RecordTable( const TEClibFunctions* eclib, TraceRecorder* recorder, TEClibFunctions* out );
+
+/**
+ * This function ends the recording table, once no thread calls it any more:
+ * another one can then be made.
+ */
+void TRC_ReleaseTable();
+
+/**
+ * This class holds a trace to replay. BL_Connect gives the devices in the
+ * order they were connected; BL_GetData gives the answers of a channel in
+ * order, each one once it is due: at its time in the recording (from the
+ * connection), divided by the speed. Once all the answers of a channel are
+ * given, BL_GetData returns no point and the channel stopped.
+ */
+class TraceReplay
+{
+public:
+    TraceReplay();
+
+    /**
+     * This function reads a whole trace.
+     * @return \ref ERR_NOERROR if successful, the error of \ref TraceReader::open, or
+     *         \ref ERR_GEN_FILENOTEXISTS if it holds no connection.
+     */
+    int load( const char* path );
+
+    /** Speed of the replay: 1 as recorded, 4 four times faster, 0 with no wait */
+    void setSpeed( double speed );
+
+    /** Back to the start of the trace: the devices are connected again */
+    void rewind();
+
+    /** Answers of BL_GetData in the trace, and given so far */
+    unsigned long long answers() const { return total; }
+    unsigned long long given() const { return served; }
+
+    /** Duration of the recording from the first connection to the last answer, s */
+    double duration() const { return length * 1e-9; }
+
+    int connect( int* id, TDeviceInfos_t* infos );
+    int channelInfos( int id, uint8 channel, TChannelInfos_t* infos );
+    int getData( int id, uint8 channel, TDataBuffer_t* buf, TDataInfos_t* infos, TCurrentValues_t* curr );
+    int currentValues( int id, uint8 channel, TCurrentValues_t* curr );
+    bool plugged( int id, uint8 channel );
+
+private:
+    TraceReplay( const TraceReplay& );
+    TraceReplay& operator=( const TraceReplay& );
+
+    typedef struct {
+        long long                 Due;       /* ns after the connection, as recorded */
+        int                       Status;
+        TDataInfos_t              Infos;
+        TCurrentValues_t          Curr;
+        std::vector<unsigned int> Words;
+    } TAnswer_t;
+
+    typedef struct {
+        int                    Channel;
+        bool                   HasInfos;
+        TChannelInfos_t        Infos;
+        std::vector<TAnswer_t> Answers;
+        size_t                 Next;
+        TCurrentValues_t       Last;
+    } TChannelTrace_t;
+
+    typedef struct {
+        int                          Id;
+        int                          Status;
+        long long                    Connected;   /* ns, in the recording */
+        TDeviceInfos_t               Infos;
+        std::vector<TChannelTrace_t> Channels;
+        long long                    Origin;      /* ns on the steady clock, when connected in the replay */
+        bool                         Open;
+    } TDeviceTrace_t;
+
+    TChannelTrace_t* find( int id, uint8 channel, TDeviceTrace_t** device );
+
+    std::mutex                  lock;
+    std::vector<TDeviceTrace_t> devices;
+    size_t                      connected;
+    double                      speed;
+    long long                   length;
+    unsigned long long          total;
+    std::atomic<unsigned long long> served;
+};
+
+/**
+ * This function fills a function table with the functions of a replay: the
+ * answers of the trace for BL_Connect, BL_GetChannelInfos, BL_GetData and
+ * BL_GetCurrentValues; success for the loads and the starts of techniques,
+ * which are in the trace already. There is one replay table at a time in the
+ * program.
+ * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_INVALIDPARAMETERS otherwise.
+ */
+int TRC_FillFunctionTable( TraceReplay* replay, TEClibFunctions* eclib );
+
+/** @} */
+
+#endif /* _DATATRACE_H_ */
@@ -0,0 +1,214 @@
+#include "DeviceDiscovery.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <chrono>
+
+#include "ParallelFor.h"
+
+typedef std::chrono::steady_clock Clock;
+
+#define DIS_CACHE_HEADER "# ECLib devices: address, serial number, device, device code, last seen (s since 1970)"
+
+static double s_elapsed( Clock::time_point start ){
+    return std::chrono::duration<double>( Clock::now() - start ).count();
+}
+
+static bool s_isUSB( const std::string& address ){
+    return address.compare( 0, 3, "USB" ) == 0;
+}
+
+/* splits a line of the cache on the tabs, empty fields included */
+static std::vector<std::string> s_fields( const char* line ){
+    std::vector<std::string> fields( 1 );
+    for( const char* p = line; *p && *p != '\r' && *p != '\n'; p++ ){
+        if( *p == '\t' ) fields.push_back( std::string() );
+        else fields.back() += *p;
+    }
+    return fields;
+}
+
+TDiscoveryOptions_t DIS_DefaultOptions()
+{
+    TDiscoveryOptions_t options;
+    options.MaxUSB     = DIS_MAX_USB;
+    options.Timeout    = DIS_TIMEOUT;
+    options.Threads    = 0;
+    options.CachedOnly = false;
+    options.ConnectUSB = false;
+    return options;
+}
+
+DeviceDiscovery::DeviceDiscovery( const TEClibFunctions* eclib )
+    : eclib( eclib )
+{
+}
+
+int DeviceDiscovery::loadCache( const std::string& path )
+{
+    entries.clear();
+    FILE* f = fopen( path.c_str(), "r" );
+    if( !f ) return ERR_GEN_FILENOTEXISTS;
+    char line[1024];
+    while( fgets( line, sizeof(line), f ) ){
+        if( line[0] == '#' ) continue;
+        std::vector<std::string> fields = s_fields( line );
+        if( fields.size() < 5 || fields[0].empty() ) continue;
+        TDeviceCacheEntry_t entry;
+        entry.Address    = fields[0];
+        entry.Serial     = fields[1];
+        entry.Device     = fields[2];
+        entry.DeviceCode = atoi( fields[3].c_str() );
+        entry.LastSeen   = atoll( fields[4].c_str() );
+        entries.push_back( entry );
+    }
+    fclose( f );
+    return ERR_NOERROR;
+}
+
+int DeviceDiscovery::saveCache( const std::string& path ) const
+{
+    FILE* f = fopen( path.c_str(), "w" );
+    if( !f ) return ERR_GEN_FILENOTEXISTS;
+    fprintf( f, "%s\n", DIS_CACHE_HEADER );
+    for( size_t i = 0; i < entries.size(); i++ ){
+        const TDeviceCacheEntry_t& e = entries[i];
+        fprintf( f, "%s\t%s\t%s\t%d\t%lld\n", e.Address.c_str(), e.Serial.c_str(), e.Device.c_str(), e.DeviceCode, e.LastSeen );
+    }
+    return ( fclose( f ) == 0 ) ? ERR_NOERROR : ERR_GEN_FUNCTIONFAILED;
+}
+
+/* connects and closes at once */
+bool DeviceDiscovery::probeAddress( const std::string& address, uint8 timeout, TDiscoveredDevice_t* device )
+{
+    Clock::time_point start = Clock::now();
+    TDeviceInfos_t infos;
+    int id = -1;
+    int status = eclib->BL_Connect( address.c_str(), timeout, &id, &infos );
+    device->Seconds = s_elapsed( start );
+    if( status != ERR_NOERROR ) return false;
+    if( eclib->BL_Disconnect ) eclib->BL_Disconnect( id );
+    device->DeviceCode       = infos.DeviceCode;
+    device->NumberOfChannels = infos.NumberOfChannels;
+    return true;
+}
+
+/* the indices up to the first one without device */
+int DeviceDiscovery::probeUSB( const TDiscoveryOptions_t& options, std::vector<TDiscoveredDevice_t>* found )
+{
+    int probed = 0;
+    for( int index = 0; index < options.MaxUSB; index++ ){
+        Clock::time_point start = Clock::now();
+        char company[256], name[256], serial[256];
+        unsigned int company_size = sizeof(company), name_size = sizeof(name), serial_size = sizeof(serial);
+        probed++;
+        if( !eclib->BL_GetUSBdeviceinfos( (unsigned int)index, company, &company_size, name, &name_size, serial, &serial_size ) ) break;
+        company[sizeof(company) - 1] = name[sizeof(name) - 1] = serial[sizeof(serial) - 1] = 0;
+
+        TDiscoveredDevice_t device;
+        device.Address          = "USB" + std::to_string( index );
+        device.Serial           = serial;
+        device.Device           = name;
+        device.DeviceCode       = -1;
+        device.NumberOfChannels = -1;
+        device.Cached = device.Moved = false;
+        double seconds = s_elapsed( start );
+        if( options.ConnectUSB && !probeAddress( device.Address, options.Timeout, &device ) ) continue;
+        device.Seconds = seconds + ( options.ConnectUSB ? device.Seconds : 0.0 );
+        found->push_back( device );
+    }
+    return probed;
+}
+
+int DeviceDiscovery::discover( const TDiscoveryOptions_t& options, std::vector<TDiscoveredDevice_t>* found, TDiscoveryReport_t* report )
+{
+    TDiscoveryReport_t done;
+    memset( &done, 0, sizeof(done) );
+    if( report ) *report = done;
+    if( !found || !eclib || !eclib->BL_Connect || ( options.MaxUSB > 0 && !eclib->BL_GetUSBdeviceinfos ) ){
+        return ERR_GEN_INVALIDPARAMETERS;
+    }
+    found->clear();
+
+    /* the cached Ethernet addresses first, then the others of the list */
+    std::vector<std::string> addresses;
+    for( size_t i = 0; i < entries.size(); i++ ){
+        if( !s_isUSB( entries[i].Address ) ) addresses.push_back( entries[i].Address );
+    }
+    if( !options.CachedOnly ){
+        for( size_t i = 0; i < options.Addresses.size(); i++ ){
+            bool known = false;
+            for( size_t k = 0; k < addresses.size() && !known; k++ ) known = ( addresses[k] == options.Addresses[i] );
+            if( !known ) addresses.push_back( options.Addresses[i] );
+        }
+    }
+
+    /* task 0 lists the USB devices, the others probe an address each */
+    Clock::time_point start = Clock::now();
+    std::vector<TDiscoveredDevice_t> usb;
+    std::vector<TDiscoveredDevice_t> ethernet( addresses.size() );
+    std::vector<char> present( addresses.size(), 0 );
+    std::vector<double> ends( addresses.size(), 0.0 );
+    int usb_probed = 0;
+    PAR_For( addresses.size() + 1, options.Threads, [&]( size_t task ){
+        if( task == 0 ){
+            if( options.MaxUSB > 0 ) usb_probed = probeUSB( options, &usb );
+            done.UsbSeconds = s_elapsed( start );
+            return;
+        }
+        TDiscoveredDevice_t& device = ethernet[task - 1];
+        device.Address          = addresses[task - 1];
+        device.DeviceCode       = -1;
+        device.NumberOfChannels = -1;
+        device.Cached = device.Moved = false;
+        present[task - 1] = probeAddress( device.Address, options.Timeout, &device ) ? 1 : 0;
+        ends[task - 1] = s_elapsed( start );
+    } );
+    for( size_t i = 0; i < ends.size(); i++ ){
+        if( ends[i] > done.EthernetSeconds ) done.EthernetSeconds = ends[i];
+    }
+    *found = usb;
+    for( size_t i = 0; i < ethernet.size(); i++ ){
+        if( present[i] ) found->push_back( ethernet[i] );
+    }
+    done.Seconds = s_elapsed( start );
+    done.Probed  = usb_probed + (int)addresses.size();
+    done.Found   = (int)found->size();
+
+    /* the cache: a USB device by its serial number (by its address without one), an Ethernet device by its address */
+    long long now = (long long)time( 0 );
+    std::vector<char> seen( entries.size(), 0 );
+    for( size_t i = 0; i < found->size(); i++ ){
+        TDiscoveredDevice_t& device = (*found)[i];
+        bool by_serial = s_isUSB( device.Address ) && !device.Serial.empty();
+        size_t k = 0;
+        for( ; k < entries.size(); k++ ){
+            if( seen[k] ) continue;
+            if( by_serial ? ( entries[k].Serial == device.Serial ) : ( entries[k].Address == device.Address && entries[k].Serial == device.Serial ) ) break;
+        }
+        if( k == entries.size() ){
+            TDeviceCacheEntry_t entry;
+            entry.DeviceCode = -1;
+            entries.push_back( entry );
+            seen.push_back( 0 );
+        } else if( entries[k].Address == device.Address ){
+            device.Cached = true;
+            done.CacheHits++;
+        } else {
+            device.Moved = true;
+            done.Moved++;
+        }
+        TDeviceCacheEntry_t& entry = entries[k];
+        entry.Address  = device.Address;
+        entry.Serial   = device.Serial;
+        entry.Device   = device.Device;
+        entry.LastSeen = now;
+        if( device.DeviceCode >= 0 ) entry.DeviceCode = device.DeviceCode;
+        seen[k] = 1;
+    }
+    for( size_t k = 0; k < entries.size(); k++ ) done.Missing += !seen[k];
+    if( report ) *report = done;
+    return ERR_NOERROR;
+}
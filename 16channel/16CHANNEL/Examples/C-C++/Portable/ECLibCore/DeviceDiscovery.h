@@ -0,0 +1,122 @@
+#pragma once
+
+#ifndef _DEVICEDISCOVERY_H_
+#define _DEVICEDISCOVERY_H_
+
+#include <string>
+#include <vector>
+
+#include "BLFunctionTable.h"
+
+/*
+ * Discovery of the devices on USB and Ethernet
+ *
+ * The USB devices are listed with BL_GetUSBdeviceinfos, index after index; the
+ * Ethernet devices are found by a BL_Connect to each address of a list. Done one
+ * after the other with the recommended 5 s time-out, every address without device
+ * costs 5 s. Here the USB indices and all the addresses are probed at the same
+ * time, with a short time-out, and each device found is closed at once.
+ *
+ * The devices found are kept in a cache (a text file) between the runs: the
+ * serial number of a USB device with its index (its index alone without serial
+ * number), the address of an Ethernet device.
+ * A discovery limited to the cached addresses finds a known rack in the time of a
+ * connection, and a USB device whose index changed is reported as moved.
+ */
+
+/**
+ * \defgroup device_discovery Device discovery
+ * @{
+ */
+
+/** Default number of USB indices probed */
+#define DIS_MAX_USB         (16)
+/** Default time-out of BL_Connect for the discovery (s) */
+#define DIS_TIMEOUT         (1)
+
+/** A device found */
+typedef struct {
+    std::string Address;          /*!< "USB0", "192.109.209.200", ... as for BL_Connect */
+    std::string Serial;           /*!< serial number of a USB device, empty for Ethernet */
+    std::string Device;           /*!< device name of a USB device, empty for Ethernet */
+    int         DeviceCode;       /*!< see \ref TDeviceType_e, -1 if the device was not connected */
+    int         NumberOfChannels; /*!< -1 if the device was not connected */
+    double      Seconds;          /*!< time of the probe */
+    bool        Cached;           /*!< found at the address of the cache */
+    bool        Moved;            /*!< found in the cache at another address */
+} TDiscoveredDevice_t;
+
+/** A device of the cache */
+typedef struct {
+    std::string Address;
+    std::string Serial;
+    std::string Device;
+    int         DeviceCode;
+    long long   LastSeen;         /*!< s since 1970 */
+} TDeviceCacheEntry_t;
+
+/** How to discover */
+typedef struct {
+    int                      MaxUSB;     /*!< USB indices probed, up to the first without device; 0 for no USB */
+    std::vector<std::string> Addresses;  /*!< Ethernet addresses probed, with the cached ones */
+    uint8                    Timeout;    /*!< time-out of BL_Connect (s) */
+    int                      Threads;    /*!< 0: every address at once, 1 if BL_Connect must not be called concurrently */
+    bool                     CachedOnly; /*!< probe only the cached Ethernet addresses */
+    bool                     ConnectUSB; /*!< connect to the USB devices for their device code */
+} TDiscoveryOptions_t;
+
+/** Report of a discovery */
+typedef struct {
+    int    Probed;          /*!< addresses and USB indices probed */
+    int    Found;
+    int    CacheHits;       /*!< devices found at their cached address */
+    int    Moved;           /*!< USB devices found at another index */
+    int    Missing;         /*!< cached devices not found */
+    double UsbSeconds;      /*!< until the USB devices were listed */
+    double EthernetSeconds; /*!< until the last address was probed */
+    double Seconds;
+} TDiscoveryReport_t;
+
+/** Default options: 16 USB indices, no address, 1 s time-out, every address at once */
+TDiscoveryOptions_t DIS_DefaultOptions();
+
+/**
+ * This class finds the devices and keeps their addresses between the runs.
+ */
+class DeviceDiscovery
+{
+public:
+    DeviceDiscovery( const TEClibFunctions* eclib );
+
+    /**
+     * This function reads the cache of a previous run.
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_FILENOTEXISTS if there is no cache yet.
+     */
+    int loadCache( const std::string& path );
+
+    /** This function writes the cache, updated by the discoveries */
+    int saveCache( const std::string& path ) const;
+
+    const std::vector<TDeviceCacheEntry_t>& cache() const { return entries; }
+
+    /**
+     * This function probes the USB indices and the Ethernet addresses concurrently.
+     *
+     * @param options see \ref TDiscoveryOptions_t
+     * @param found the devices found, USB first, then Ethernet in the order of the addresses
+     * @param report optional report
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_INVALIDPARAMETERS if a function is missing.
+     */
+    int discover( const TDiscoveryOptions_t& options, std::vector<TDiscoveredDevice_t>* found, TDiscoveryReport_t* report = 0 );
+
+private:
+    int  probeUSB( const TDiscoveryOptions_t& options, std::vector<TDiscoveredDevice_t>* found );
+    bool probeAddress( const std::string& address, uint8 timeout, TDiscoveredDevice_t* device );
+
+    const TEClibFunctions*           eclib;
+    std::vector<TDeviceCacheEntry_t> entries;
+};
+
+/** @} */
+
+#endif /* _DEVICEDISCOVERY_H_ */
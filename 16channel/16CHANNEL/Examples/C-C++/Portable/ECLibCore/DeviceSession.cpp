@@ -0,0 +1,238 @@
+#include "DeviceSession.h"
+
+#include <string.h>
+#include <chrono>
+#include <thread>
+
+typedef std::chrono::steady_clock Clock;
+
+static long long s_nowNs(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>( Clock::now().time_since_epoch() ).count();
+}
+
+bool SES_IsLinkError( int status )
+{
+    return status == ERR_GEN_NOTCONNECTED || status == ERR_COMM_COMMFAILED
+        || status == ERR_COMM_CONNECTIONFAILED || status == ERR_COMM_WAITINGACK;
+}
+
+DeviceSession::DeviceSession( const TEClibFunctions* eclib )
+    : eclib( eclib ), timeout( 5 ), attempts( SES_CONNECT_ATTEMPTS ), delay_ms( SES_CONNECT_DELAY_MS ), device_id( -1 )
+{
+    memset( &counters, 0, sizeof(counters) );
+}
+
+DeviceSession::~DeviceSession()
+{
+    disconnect();
+}
+
+int DeviceSession::connect( const std::string& address, uint8 timeout, TDeviceInfos_t* infos )
+{
+    if( !eclib || !eclib->BL_Connect || !eclib->BL_GetData || !eclib->BL_GetChannelInfos ) return ERR_GEN_INVALIDPARAMETERS;
+    disconnect();
+
+    std::lock_guard<std::mutex> guard( connect_lock );
+    TDeviceInfos_t device;
+    int id = -1;
+    int status = eclib->BL_Connect( address.c_str(), timeout, &id, &device );
+    if( status != ERR_NOERROR ) return status;
+    if( infos ) *infos = device;
+    this->address = address;
+    this->timeout = timeout;
+    device_id = id;
+    return ERR_NOERROR;
+}
+
+void DeviceSession::disconnect()
+{
+    std::lock_guard<std::mutex> guard( connect_lock );
+    int id = device_id.exchange( -1 );
+    if( id >= 0 && eclib->BL_Disconnect ) eclib->BL_Disconnect( id );
+    address.clear();
+    std::lock_guard<std::mutex> channels_guard( lock );
+    channels.clear();
+}
+
+void DeviceSession::setRetry( int attempts, unsigned int delay_ms )
+{
+    this->attempts = ( attempts > 0 ) ? attempts : 1;
+    this->delay_ms = delay_ms;
+}
+
+int DeviceSession::track( uint8 channel )
+{
+    int id = device_id;
+    if( id < 0 ) return ERR_GEN_NOTCONNECTED;
+    TChannelInfos_t infos;
+    int status = eclib->BL_GetChannelInfos( id, channel, &infos );
+    if( status != ERR_NOERROR ) return status;
+
+    std::lock_guard<std::mutex> guard( lock );
+    TChannel_t& c = channels[channel];
+    c.NbOfTechniques = infos.NbOfTechniques;
+    c.Lost           = false;
+    c.Pending        = false;
+    c.LastData       = 0;
+    return ERR_NOERROR;
+}
+
+void DeviceSession::untrack( uint8 channel )
+{
+    std::lock_guard<std::mutex> guard( lock );
+    channels.erase( channel );
+}
+
+int DeviceSession::check()
+{
+    int id = device_id;
+    if( id < 0 ) return reconnect( -1, ERR_GEN_NOTCONNECTED );
+    if( !eclib->BL_TestConnection ) return ERR_NOERROR;
+    int status = eclib->BL_TestConnection( id );
+    return SES_IsLinkError( status ) ? reconnect( id, status ) : status;
+}
+
+int DeviceSession::getData( uint8 channel, TDataBuffer_t* pBuf, TDataInfos_t* pInfos, TCurrentValues_t* pValues )
+{
+    {
+        std::lock_guard<std::mutex> guard( lock );
+        if( channels.find( channel ) == channels.end() ){
+            TChannel_t c = { -1, false, false, 0 };
+            channels[channel] = c;
+        }
+    }
+
+    /* a single retry: a second loss right after a reconnection is given back to the caller */
+    int status = ERR_GEN_NOTCONNECTED;
+    for( int pass = 0; pass < 2; pass++ ){
+        int id = device_id;
+        if( id < 0 ){
+            /* a reconnection may be in progress in another thread */
+            { std::lock_guard<std::mutex> wait( connect_lock ); }
+            if( ( id = device_id ) < 0 ) return ERR_GEN_NOTCONNECTED;
+        }
+        {
+            /* the channels are reconciled before the new identifier is published */
+            std::lock_guard<std::mutex> guard( lock );
+            if( channels[channel].Lost ) return ERR_GEN_FUNCTIONFAILED;
+        }
+        status = eclib->BL_GetData( id, channel, pBuf, pInfos, pValues );
+        if( !SES_IsLinkError( status ) || pass == 1 ) break;
+        int reconnected = reconnect( id, status );
+        if( reconnected != ERR_NOERROR ) return reconnected;
+    }
+    if( status != ERR_NOERROR ) return status;
+
+    long long now = s_nowNs();
+    std::lock_guard<std::mutex> guard( lock );
+    TChannel_t& c = channels[channel];
+    if( c.Pending ){
+        if( c.LastData ) metrics[SES_METRIC_DATA_GAP].record( (unsigned long long)( now - c.LastData ) );
+        c.Pending = false;
+    }
+    c.LastData = now;
+    return ERR_NOERROR;
+}
+
+int DeviceSession::reconnect( int failed_id, int error )
+{
+    std::lock_guard<std::mutex> guard( connect_lock );
+    if( address.empty() ) return ERR_GEN_NOTCONNECTED;
+    if( failed_id >= 0 && device_id != failed_id ){
+        /* another thread did it */
+        return ( device_id >= 0 ) ? ERR_NOERROR : ERR_GEN_NOTCONNECTED;
+    }
+
+    long long start = s_nowNs();
+    int old = device_id.exchange( -1 );
+    if( old >= 0 && eclib->BL_Disconnect ) eclib->BL_Disconnect( old );
+
+    int status = ERR_GEN_NOTCONNECTED;
+    int id = -1;
+    unsigned int delay = delay_ms;
+    for( int a = 0; a < attempts; a++ ){
+        if( a > 0 ){
+            std::this_thread::sleep_for( std::chrono::milliseconds( delay ) );
+            if( delay < delay_ms * 8 ) delay *= 2;
+        }
+        TDeviceInfos_t device;
+        status = eclib->BL_Connect( address.c_str(), timeout, &id, &device );
+        std::lock_guard<std::mutex> counters_guard( lock );
+        counters.Attempts++;
+        if( status == ERR_NOERROR ) break;
+    }
+    if( status != ERR_NOERROR ){
+        std::lock_guard<std::mutex> counters_guard( lock );
+        counters.Losses++;
+        counters.Failures++;
+        counters.LastError   = error;
+        counters.DownSeconds += ( s_nowNs() - start ) * 1e-9;
+        return status;
+    }
+
+    /* what became of the channels while the link was down */
+    std::map<int, TChannel_t> known;
+    {
+        std::lock_guard<std::mutex> channels_guard( lock );
+        known = channels;
+    }
+    std::vector<TSessionReconcile_t> done;
+    for( std::map<int, TChannel_t>::const_iterator it = known.begin(); it != known.end(); ++it ){
+        TSessionReconcile_t r;
+        memset( &r, 0, sizeof(r) );
+        r.Channel        = it->first;
+        r.NbOfTechniques = it->second.NbOfTechniques;
+        r.GapSeconds     = it->second.LastData ? ( s_nowNs() - it->second.LastData ) * 1e-9 : 0.0;
+        TChannelInfos_t infos;
+        if( eclib->BL_GetChannelInfos( id, (uint8)it->first, &infos ) != ERR_NOERROR ){
+            r.Outcome = SES_CHANNEL_FAILED;
+            done.push_back( r );
+            continue;
+        }
+        r.State             = infos.State;
+        r.NbOfTechniquesNow = infos.NbOfTechniques;
+        r.MemFilled         = infos.MemFilled;
+        if( infos.FirmwareCode != KIBIO_FIRM_KERNEL || infos.NbOfTechniques == 0
+            || ( r.NbOfTechniques > 0 && infos.NbOfTechniques != r.NbOfTechniques ) ){
+            r.Outcome = SES_CHANNEL_LOST;
+        } else {
+            r.Outcome = ( infos.State == KBIO_STATE_RUN ) ? SES_CHANNEL_RUNNING : SES_CHANNEL_STOPPED;
+        }
+        done.push_back( r );
+    }
+
+    std::lock_guard<std::mutex> channels_guard( lock );
+    for( size_t i = 0; i < done.size(); i++ ){
+        std::map<int, TChannel_t>::iterator it = channels.find( done[i].Channel );
+        if( it == channels.end() ) continue;
+        it->second.Lost    = ( done[i].Outcome == SES_CHANNEL_LOST );
+        it->second.Pending = true;
+    }
+    reconciled.swap( done );
+    double seconds = ( s_nowNs() - start ) * 1e-9;
+    counters.Losses++;
+    counters.Reconnects++;
+    counters.LastError    = error;
+    counters.DownSeconds += seconds;
+    metrics[SES_METRIC_RECONNECT].recordSeconds( seconds );
+    device_id = id;
+    return ERR_NOERROR;
+}
+
+std::vector<TSessionReconcile_t> DeviceSession::lastReconcile() const
+{
+    std::lock_guard<std::mutex> guard( lock );
+    return reconciled;
+}
+
+TSessionStats_t DeviceSession::stats() const
+{
+    std::lock_guard<std::mutex> guard( lock );
+    return counters;
+}
+
+LatencyHistogram DeviceSession::metric( TSessionMetric_e which ) const
+{
+    std::lock_guard<std::mutex> guard( lock );
+    return metrics[which];
+}
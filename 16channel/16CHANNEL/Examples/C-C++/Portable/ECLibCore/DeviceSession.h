@@ -0,0 +1,176 @@
+#pragma once
+
+#ifndef _DEVICESESSION_H_
+#define _DEVICESESSION_H_
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "BLFunctionTable.h"
+#include "Histogram.h"
+
+/*
+ * Connection to a device which survives a loss of the link
+ *
+ * When the link drops (USB cable, network), the techniques keep running on the
+ * instrument and their points are kept in its memory. The session detects the
+ * loss from the errors of the calls (and from BL_TestConnection when checked),
+ * connects again with BL_Connect and reconciles each channel it drains: the
+ * State, NbOfTechniques and MemFilled read with BL_GetChannelInfos tell whether
+ * the techniques still run, ended during the loss, or were lost (channel reset).
+ * The draining with BL_GetData then goes on where it stopped; the techniques are
+ * neither loaded nor started again.
+ *
+ * Several threads may drain channels through the same session: the first one
+ * which meets the error connects again, the others wait for it and retry.
+ */
+
+/**
+ * \defgroup device_session Device session
+ * @{
+ */
+
+/** Default number of BL_Connect attempts for a reconnection */
+#define SES_CONNECT_ATTEMPTS    (10)
+/** Default delay before the first new attempt, doubled up to 8 times (ms) */
+#define SES_CONNECT_DELAY_MS    (250)
+
+/** Channel after a reconnection */
+typedef enum {
+    SES_CHANNEL_RUNNING  = 0, /*!< the techniques still run, the draining goes on */
+    SES_CHANNEL_STOPPED  = 1, /*!< the techniques ended or were paused, the points left are drained */
+    SES_CHANNEL_LOST     = 2, /*!< the techniques are no longer on the channel (reset, firmware reloaded) */
+    SES_CHANNEL_FAILED   = 3  /*!< BL_GetChannelInfos failed */
+} TSessionChannel_e;
+
+/** Reconciliation of a channel */
+typedef struct {
+    int    Channel;
+    int    Outcome;            /*!< see \ref TSessionChannel_e */
+    int    State;              /*!< channel state (\ref TChannelState_e) read after the reconnection */
+    int    NbOfTechniques;     /*!< techniques loaded, before the loss (-1 if unknown) */
+    int    NbOfTechniquesNow;  /*!< techniques loaded, after the reconnection */
+    int    MemFilled;          /*!< bytes waiting in the memory of the channel */
+    double GapSeconds;         /*!< time from the last data before the loss to the reconnection */
+} TSessionReconcile_t;
+
+/** Counters of a \ref DeviceSession */
+typedef struct {
+    unsigned long long Losses;       /*!< losses of the link detected */
+    unsigned long long Reconnects;   /*!< successful reconnections */
+    unsigned long long Attempts;     /*!< BL_Connect calls for the reconnections */
+    unsigned long long Failures;     /*!< reconnections given up */
+    double             DownSeconds;  /*!< total time without link */
+    int                LastError;    /*!< error which caused the last loss */
+} TSessionStats_t;
+
+/** Metrics of a \ref DeviceSession */
+typedef enum {
+    SES_METRIC_RECONNECT = 0, /*!< from the detection of the loss to the end of the reconciliation */
+    SES_METRIC_DATA_GAP  = 1, /*!< per channel, from the last data before the loss to the first data after */
+    SES_NB_METRICS       = 2
+} TSessionMetric_e;
+
+/**
+ * This function tells whether an error means that the link with the device is lost.
+ */
+bool SES_IsLinkError( int status );
+
+/**
+ * This class keeps a connection to a device and restores it when the link is lost.
+ */
+class DeviceSession
+{
+public:
+    DeviceSession( const TEClibFunctions* eclib );
+    ~DeviceSession();
+
+    /**
+     * This function connects to a device.
+     * @param address as for BL_Connect: "USB0", "192.109.209.200", ...
+     * @param timeout communication time-out (s)
+     * @param infos optional information of the device
+     * @return \ref ERR_NOERROR if successful, the error of BL_Connect otherwise.
+     */
+    int connect( const std::string& address, uint8 timeout = 5, TDeviceInfos_t* infos = 0 );
+
+    /** Closes the connection */
+    void disconnect();
+
+    /** Current device identifier, -1 if not connected; it changes with each reconnection */
+    int id() const { return device_id; }
+
+    /** Sets the number of BL_Connect attempts and the delay before the first new one */
+    void setRetry( int attempts, unsigned int delay_ms );
+
+    /**
+     * This function remembers the state of a channel (BL_GetChannelInfos) to reconcile
+     * it after a loss. The channels drained with \ref getData are followed anyway.
+     */
+    int track( uint8 channel );
+
+    /** Stops following a channel */
+    void untrack( uint8 channel );
+
+    /**
+     * This function tests the link with BL_TestConnection and connects again if it is lost.
+     * @return \ref ERR_NOERROR if the link is up (again), the error otherwise.
+     */
+    int check();
+
+    /**
+     * Same as BL_GetData; if the link is lost, the session connects again and the call is
+     * retried. A channel whose techniques were lost returns \ref ERR_GEN_FUNCTIONFAILED.
+     */
+    int getData( uint8 channel, TDataBuffer_t* pBuf, TDataInfos_t* pInfos, TCurrentValues_t* pValues );
+
+    /**
+     * This function connects again and reconciles the channels followed.
+     * @param failed_id device identifier which failed, the reconnection is skipped if
+     *        another thread already connected again; -1 to connect again anyway.
+     * @param error error which showed the loss
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_NOTCONNECTED if \ref connect was
+     *         not called, otherwise the error of the last BL_Connect.
+     */
+    int reconnect( int failed_id = -1, int error = ERR_GEN_NOTCONNECTED );
+
+    /** Reconciliations of the channels at the last reconnection */
+    std::vector<TSessionReconcile_t> lastReconcile() const;
+
+    TSessionStats_t stats() const;
+
+    /** Histogram of a metric (copy), see \ref TSessionMetric_e */
+    LatencyHistogram metric( TSessionMetric_e which ) const;
+
+private:
+    DeviceSession( const DeviceSession& );
+    DeviceSession& operator=( const DeviceSession& );
+
+    typedef struct {
+        int       NbOfTechniques;
+        bool      Lost;
+        bool      Pending;      /* reconnected, data gap not measured yet */
+        long long LastData;     /* ns, steady clock, 0 before the first data */
+    } TChannel_t;
+
+    const TEClibFunctions*    eclib;
+    std::string               address;
+    uint8                     timeout;
+    int                       attempts;
+    unsigned int              delay_ms;
+    std::atomic<int>          device_id;
+
+    std::mutex                connect_lock;   /* one reconnection at a time */
+    mutable std::mutex        lock;           /* channels, counters and metrics */
+    std::map<int, TChannel_t> channels;
+    std::vector<TSessionReconcile_t> reconciled;
+    TSessionStats_t           counters;
+    LatencyHistogram          metrics[SES_NB_METRICS];
+};
+
+/** @} */
+
+#endif /* _DEVICESESSION_H_ */
@@ -0,0 +1,129 @@
+#include "ECLibLoader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+/* the library, the error of the system when it cannot be opened */
+static void* s_open( const char* path, std::string* reason ){
+#ifdef _WIN32
+    HMODULE handle = LoadLibraryA( path );
+    if( !handle && reason ){
+        char text[32];
+        snprintf( text, sizeof(text), "error %lu", (unsigned long)GetLastError() );
+        *reason = text;
+    }
+    return (void*)handle;
+#else
+    void* handle = dlopen( path, RTLD_NOW | RTLD_LOCAL );
+    if( !handle && reason ){
+        const char* text = dlerror();
+        *reason = text ? text : "dlopen failed";
+    }
+    return handle;
+#endif
+}
+
+static void s_close( void* handle ){
+#ifdef _WIN32
+    FreeLibrary( (HMODULE)handle );
+#else
+    dlclose( handle );
+#endif
+}
+
+/* copies the address of a function into its member; false if the library does not export it */
+static bool s_symbol( void* handle, const char* name, void* member ){
+#ifdef _WIN32
+    FARPROC address = GetProcAddress( (HMODULE)handle, name );
+#else
+    void* address = dlsym( handle, name );
+#endif
+    if( !address ) return false;
+    memcpy( member, &address, sizeof(address) );
+    return true;
+}
+
+std::string LDR_DefaultLibrary()
+{
+    const char* value = getenv( LDR_LIBRARY_VARIABLE );
+    if( value && value[0] ) return value;
+#ifdef _WIN32
+    return "EClib.dll";
+#else
+    return "libEClib.so";
+#endif
+}
+
+int LDR_Load( const char* path, TEClibFunctions* eclib, std::string* error )
+{
+    if( !eclib ) return ERR_GEN_INVALIDPARAMETERS;
+    memset( eclib, 0, sizeof(TEClibFunctions) );
+
+    std::string library = ( path && path[0] ) ? std::string( path ) : LDR_DefaultLibrary();
+    std::string reason;
+    void* handle = s_open( library.c_str(), &reason );
+    if( !handle ){
+        if( error ) *error = library + ": " + reason;
+        return ERR_GEN_FILENOTEXISTS;
+    }
+
+    /* the same functions, in the same order, as BL_Init of the MFC sample */
+    const char* missing = 0;
+#define LDR_GET( name ) if( !missing && !s_symbol( handle, #name, &eclib->name ) ) missing = #name
+    LDR_GET( BL_GetLibVersion );
+    LDR_GET( BL_GetVolumeSerialNumber );
+    LDR_GET( BL_GetErrorMsg );
+    LDR_GET( BL_Connect );
+    LDR_GET( BL_Disconnect );
+    LDR_GET( BL_TestConnection );
+    LDR_GET( BL_TestCommSpeed );
+    LDR_GET( BL_GetUSBdeviceinfos );
+    LDR_GET( BL_LoadFirmware );
+    LDR_GET( BL_IsChannelPlugged );
+    LDR_GET( BL_GetChannelsPlugged );
+    LDR_GET( BL_GetChannelInfos );
+    LDR_GET( BL_GetMessage );
+    LDR_GET( BL_GetHardConf );
+    LDR_GET( BL_SetHardConf );
+    LDR_GET( BL_LoadTechnique );
+    LDR_GET( BL_DefineBoolParameter );
+    LDR_GET( BL_DefineSglParameter );
+    LDR_GET( BL_DefineIntParameter );
+    LDR_GET( BL_UpdateParameters );
+    LDR_GET( BL_StartChannel );
+    LDR_GET( BL_StartChannels );
+    LDR_GET( BL_StopChannel );
+    LDR_GET( BL_StopChannels );
+    LDR_GET( BL_GetCurrentValues );
+    LDR_GET( BL_GetData );
+    LDR_GET( BL_GetFCTData );
+    LDR_GET( BL_ConvertNumericIntoSingle );
+    LDR_GET( BL_SetExperimentInfos );
+    LDR_GET( BL_GetExperimentInfos );
+    LDR_GET( BL_SendMsg );
+    LDR_GET( BL_LoadFlash );
+#undef LDR_GET
+
+    if( missing ){
+        if( error ) *error = library + ": no function " + missing;
+        s_close( handle );
+        memset( eclib, 0, sizeof(TEClibFunctions) );
+        return ERR_GEN_LIBNOTCORRECTLYLOADED;
+    }
+    eclib->hECLibDll = handle;
+    return ERR_NOERROR;
+}
+
+void LDR_Unload( TEClibFunctions* eclib )
+{
+    if( !eclib ) return;
+    if( eclib->hECLibDll ) s_close( eclib->hECLibDll );
+    memset( eclib, 0, sizeof(TEClibFunctions) );
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#ifndef _ECLIBLOADER_H_
+#define _ECLIBLOADER_H_
+
+#include <string>
+
+#include "BLFunctionTable.h"
+
+/*
+ * Loading of ECLib at run time, as BL_Init / BL_End in BLWrap.cpp of the MFC sample
+ *
+ * The library is loaded with LoadLibrary on Windows and dlopen elsewhere, and
+ * each function of the table is looked up by its exported name. Any library
+ * exporting the functions of BLFunctions.h is accepted: EClib.dll, or the
+ * simulated instrument (libECLibSim.so, ECLibSim.dll) to run without device.
+ * Several libraries may be loaded at once, each in its own table.
+ */
+
+/**
+ * \defgroup eclib_loader ECLib loader
+ * @{
+ */
+
+/** Environment variable giving the library loaded by default */
+#define LDR_LIBRARY_VARIABLE  "ECLIB_LIBRARY"
+
+/**
+ * This function returns the library to load when none is given: the value of
+ * ECLIB_LIBRARY if it is set, otherwise "EClib.dll" on Windows and "libEClib.so"
+ * elsewhere (searched as the system searches the libraries).
+ */
+std::string LDR_DefaultLibrary();
+
+/**
+ * This function loads a library and fills a function table with its functions.
+ * The table holds the handle of the library in hECLibDll, for \ref LDR_Unload.
+ *
+ * @param path the library, with its path or only its name; null or empty for
+ *        \ref LDR_DefaultLibrary
+ * @param eclib table to fill; it is cleared if the load fails
+ * @param error optional, set to the reason of a failure (file, missing function)
+ * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_INVALIDPARAMETERS if there is no
+ *         table, \ref ERR_GEN_FILENOTEXISTS if the library cannot be loaded,
+ *         \ref ERR_GEN_LIBNOTCORRECTLYLOADED if a function is missing from it.
+ */
+int LDR_Load( const char* path, TEClibFunctions* eclib, std::string* error = 0 );
+
+/**
+ * This function releases the library of a table filled by \ref LDR_Load and clears
+ * the table. A table which holds no library is cleared only.
+ */
+void LDR_Unload( TEClibFunctions* eclib );
+
+/** @} */
+
+#endif /* _ECLIBLOADER_H_ */
@@ -0,0 +1,37 @@
+#include "EccBuilder.h"
+
+EccArena::EccArena( size_t capacity )
+    : storage( capacity )
+    , top( 0 )
+{
+}
+
+#define ECC_SCHEMA( NAME, SCHEMA ) \
+    { NAME, SCHEMA::TechniqueID, SCHEMA::EccBase, SCHEMA::Params, sizeof(SCHEMA::Params) / sizeof(SCHEMA::Params[0]) }
+
+static const TEccSchema_t s_schemas[] = {
+    ECC_SCHEMA( "ocv",         EccSchemaOCV ),
+    ECC_SCHEMA( "ca",          EccSchemaCA ),
+    ECC_SCHEMA( "cp",          EccSchemaCP ),
+    ECC_SCHEMA( "cv",          EccSchemaCV ),
+    ECC_SCHEMA( "loop",        EccSchemaLoop ),
+    ECC_SCHEMA( "trigger_out", EccSchemaTO ),
+    ECC_SCHEMA( "trigger_in",  EccSchemaTI ),
+    ECC_SCHEMA( "trigger_set", EccSchemaTOS )
+};
+
+const TEccSchema_t* ECC_FindSchema( const char* name )
+{
+    for( size_t i = 0; name && i < sizeof(s_schemas) / sizeof(s_schemas[0]); i++ ){
+        if( strcmp( s_schemas[i].Name, name ) == 0 ) return &s_schemas[i];
+    }
+    return 0;
+}
+
+const TEccSchema_t* ECC_FindSchemaById( int technique_id )
+{
+    for( size_t i = 0; i < sizeof(s_schemas) / sizeof(s_schemas[0]); i++ ){
+        if( s_schemas[i].TechniqueID == technique_id ) return &s_schemas[i];
+    }
+    return 0;
+}
@@ -0,0 +1,331 @@
+#pragma once
+
+#ifndef _ECCBUILDER_H_
+#define _ECCBUILDER_H_
+
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+
+#include "EccParams.h"
+
+/*
+ * Typed technique parameters
+ *
+ * The parameters a .ecc file accepts are described by a schema: the labels, their
+ * types and the number of indices of the multi-step ones. EccBuilder<schema> fills
+ * the TEccParam_t from it, so that a label which is not in the schema, or a value
+ * of the wrong type, does not compile:
+ *
+ *     EccArena arena;
+ *     EccBuilder<EccSchemaCA> ca( arena );
+ *     ca.sgl <ECC_PARAM( EccSchemaCA, "Voltage_step" )>( 1.5f, 0 );
+ *     ca.flag<ECC_PARAM( EccSchemaCA, "vs_initial" )>( false, 0 );
+ *     ...
+ *     TEccParams_t params;
+ *     status = ca.params( &params );    // the length is counted, never written by hand
+ *
+ * The parameters are stored in the arena, one block allocated once and reused from
+ * a technique to the next: building a chain allocates nothing.
+ */
+
+/**
+ * \ingroup ecc_params
+ * @{
+ */
+
+/** Default number of parameters an \ref EccArena holds */
+#define ECC_ARENA_CAPACITY (1024)
+/** Number of steps of the multi-step techniques (CA, CP) */
+#define ECC_MAX_STEPS      (100)
+/** Number of vertices of the CV technique */
+#define ECC_CV_VERTICES    (5)
+
+/** A parameter accepted by a .ecc file */
+typedef struct {
+    const char* Label; /*!< label, as given to BL_DefineXXXParameter */
+    int         Type;  /*!< type (see \ref TParamType_e) */
+    int         Steps; /*!< number of indices: 1 for the single value parameters */
+} TEccSchemaParam_t;
+
+/** Open Circuit Voltage (ocv.ecc) */
+struct EccSchemaOCV {
+    static constexpr int         TechniqueID = KBIO_TECHID_OCV;
+    static constexpr const char* EccBase = "ocv";
+    static constexpr TEccSchemaParam_t Params[] = {
+        { "Rest_time_T",     PARAM_SINGLE, 1 },
+        { "Record_every_dE", PARAM_SINGLE, 1 },
+        { "Record_every_dT", PARAM_SINGLE, 1 },
+        { "E_Range",         PARAM_INT32,  1 },
+        { "xctr",            PARAM_INT32,  1 }
+    };
+};
+
+/** Chrono-Amperometry (ca.ecc) */
+struct EccSchemaCA {
+    static constexpr int         TechniqueID = KBIO_TECHID_CA;
+    static constexpr const char* EccBase = "ca";
+    static constexpr TEccSchemaParam_t Params[] = {
+        { "Voltage_step",    PARAM_SINGLE,  ECC_MAX_STEPS },
+        { "vs_initial",      PARAM_BOOLEAN, ECC_MAX_STEPS },
+        { "Duration_step",   PARAM_SINGLE,  ECC_MAX_STEPS },
+        { "Step_number",     PARAM_INT32,   1 },
+        { "N_Cycles",        PARAM_INT32,   1 },
+        { "Record_every_dI", PARAM_SINGLE,  1 },
+        { "Record_every_dT", PARAM_SINGLE,  1 },
+        { "I_Range",         PARAM_INT32,   1 },
+        { "E_Range",         PARAM_INT32,   1 },
+        { "Bandwidth",       PARAM_INT32,   1 },
+        { "xctr",            PARAM_INT32,   1 }
+    };
+};
+
+/** Chrono-Potentiometry (cp.ecc) */
+struct EccSchemaCP {
+    static constexpr int         TechniqueID = KBIO_TECHID_CP;
+    static constexpr const char* EccBase = "cp";
+    static constexpr TEccSchemaParam_t Params[] = {
+        { "Current_step",    PARAM_SINGLE,  ECC_MAX_STEPS },
+        { "vs_initial",      PARAM_BOOLEAN, ECC_MAX_STEPS },
+        { "Duration_step",   PARAM_SINGLE,  ECC_MAX_STEPS },
+        { "Step_number",     PARAM_INT32,   1 },
+        { "N_Cycles",        PARAM_INT32,   1 },
+        { "Record_every_dE", PARAM_SINGLE,  1 },
+        { "Record_every_dT", PARAM_SINGLE,  1 },
+        { "I_Range",         PARAM_INT32,   1 },
+        { "E_Range",         PARAM_INT32,   1 },
+        { "Bandwidth",       PARAM_INT32,   1 },
+        { "xctr",            PARAM_INT32,   1 }
+    };
+};
+
+/** Cyclic Voltammetry (cv.ecc) */
+struct EccSchemaCV {
+    static constexpr int         TechniqueID = KBIO_TECHID_CV;
+    static constexpr const char* EccBase = "cv";
+    static constexpr TEccSchemaParam_t Params[] = {
+        { "vs_initial",        PARAM_BOOLEAN, ECC_CV_VERTICES },
+        { "Voltage_step",      PARAM_SINGLE,  ECC_CV_VERTICES },
+        { "Scan_Rate",         PARAM_SINGLE,  ECC_CV_VERTICES },
+        { "Scan_number",       PARAM_INT32,   1 },
+        { "Record_every_dE",   PARAM_SINGLE,  1 },
+        { "Average_over_dE",   PARAM_BOOLEAN, 1 },
+        { "N_Cycles",          PARAM_INT32,   1 },
+        { "Begin_measuring_I", PARAM_SINGLE,  1 },
+        { "End_measuring_I",   PARAM_SINGLE,  1 },
+        { "I_Range",           PARAM_INT32,   1 },
+        { "E_Range",           PARAM_INT32,   1 },
+        { "Bandwidth",         PARAM_INT32,   1 },
+        { "xctr",              PARAM_INT32,   1 }
+    };
+};
+
+/** Loop (loop.ecc): goes back to a technique of the chain */
+struct EccSchemaLoop {
+    static constexpr int         TechniqueID = KBIO_TECHID_LOOP;
+    static constexpr const char* EccBase = "loop";
+    static constexpr TEccSchemaParam_t Params[] = {
+        { "loop_N_times",    PARAM_INT32, 1 },   /* -1: goes back for ever */
+        { "protocol_number", PARAM_INT32, 1 }    /* index of the technique (0-based) */
+    };
+};
+
+/** Trigger Out (TO.ecc): pulse on the trigger output during the next technique */
+struct EccSchemaTO {
+    static constexpr int         TechniqueID = KBIO_TECHID_TO;
+    static constexpr const char* EccBase = "TO";
+    static constexpr TEccSchemaParam_t Params[] = {
+        { "Trigger_Logic",    PARAM_INT32, 1 },
+        { "Trigger_Duration", PARAM_INT32, 1 }   /* s, an integer in the ECLib documentation */
+    };
+};
+
+/** Trigger In (TI.ecc): waits for the trigger input */
+struct EccSchemaTI {
+    static constexpr int         TechniqueID = KBIO_TECHID_TI;
+    static constexpr const char* EccBase = "TI";
+    static constexpr TEccSchemaParam_t Params[] = {
+        { "Trigger_Logic", PARAM_INT32, 1 }
+    };
+};
+
+/** Trigger Out Set (TOS.ecc): level of the trigger output between the pulses */
+struct EccSchemaTOS {
+    static constexpr int         TechniqueID = KBIO_TECHID_TOS;
+    static constexpr const char* EccBase = "TOS";
+    static constexpr TEccSchemaParam_t Params[] = {
+        { "Trigger_Logic", PARAM_INT32, 1 }
+    };
+};
+
+/** A schema, for the code which finds the techniques at run time (\ref ECC_FindSchema) */
+typedef struct {
+    const char*              Name;        /*!< name of the technique in the sequences, e.g. "ca" */
+    int                      TechniqueID;
+    const char*              EccBase;
+    const TEccSchemaParam_t* Params;
+    size_t                   Count;       /*!< number of parameters */
+} TEccSchema_t;
+
+/** Schema of a technique by its name ("ocv", "ca", "cp", "cv", "loop", "trigger_out", "trigger_in", "trigger_set"), 0 if unknown */
+const TEccSchema_t* ECC_FindSchema( const char* name );
+
+/** Schema of a technique by its identifier, 0 if unknown */
+const TEccSchema_t* ECC_FindSchemaById( int technique_id );
+
+constexpr bool ECC_SameLabel( const char* a, const char* b ){
+    return *a == *b && ( *a == '\0' || ECC_SameLabel( a + 1, b + 1 ) );
+}
+
+constexpr size_t ECC_LabelLength( const char* label ){
+    return *label ? 1 + ECC_LabelLength( label + 1 ) : 0;
+}
+
+/** Position of a label in a schema, -1 if the schema does not accept it */
+template<size_t N>
+constexpr int ECC_FindParam( const TEccSchemaParam_t (&params)[N], const char* label, size_t i = 0 ){
+    return i == N ? -1 : ECC_SameLabel( params[i].Label, label ) ? (int)i : ECC_FindParam( params, label, i + 1 );
+}
+
+/** Largest number of indices of the parameters of a schema */
+template<size_t N>
+constexpr int ECC_MaxSteps( const TEccSchemaParam_t (&params)[N], size_t i = 0 ){
+    return i == N ? 1 : ( params[i].Steps > ECC_MaxSteps( params, i + 1 ) ? params[i].Steps : ECC_MaxSteps( params, i + 1 ) );
+}
+
+/** Position of a label in a schema, as a constant for the methods of \ref EccBuilder */
+#define ECC_PARAM( SCHEMA, LABEL ) ECC_FindParam( SCHEMA::Params, LABEL )
+
+/**
+ * This class holds the parameters of the techniques being built, in one block of
+ * memory allocated once. The \ref TEccParams_t built from it are valid until
+ * \ref reset is called.
+ */
+class EccArena
+{
+public:
+    explicit EccArena( size_t capacity = ECC_ARENA_CAPACITY );
+
+    /** Returns the next parameter, or 0 if the arena is full */
+    TEccParam_t* alloc() { return top < storage.size() ? &storage[top++] : 0; }
+
+    /** Releases all the parameters */
+    void   reset() { top = 0; }
+
+    size_t used() const { return top; }
+    size_t capacity() const { return storage.size(); }
+
+private:
+    EccArena( const EccArena& );
+    EccArena& operator=( const EccArena& );
+
+    std::vector<TEccParam_t> storage;
+    size_t                   top;
+};
+
+/**
+ * This class builds the parameters of a technique, described by a schema
+ * (\ref EccSchemaOCV, \ref EccSchemaCA, ...). The parameters are given by their
+ * position in the schema (\ref ECC_PARAM), checked when compiling; the index of a
+ * multi-step parameter, the space left in the arena and the parameters defined
+ * twice are checked at run time and reported by \ref params.
+ *
+ * Only one builder at a time may add parameters to an arena.
+ */
+template<class SCHEMA>
+class EccBuilder
+{
+public:
+    typedef SCHEMA Schema;
+
+    EccBuilder( EccArena& arena ) : arena( arena ), first( arena.used() ), count( 0 ), first_param( 0 ), error( ERR_NOERROR ) {
+        memset( defined, 0, sizeof(defined) );
+    }
+
+    template<int P> EccBuilder& sgl( float value, int index = 0 ){
+        check<P, PARAM_SINGLE>();
+        int bits;
+        memcpy( &bits, &value, sizeof(bits) );
+        add( P, bits, index );
+        return *this;
+    }
+
+    template<int P> EccBuilder& num( int value, int index = 0 ){
+        check<P, PARAM_INT32>();
+        add( P, value, index );
+        return *this;
+    }
+
+    template<int P> EccBuilder& flag( bool value, int index = 0 ){
+        check<P, PARAM_BOOLEAN>();
+        add( P, value ? 1 : 0, index );
+        return *this;
+    }
+
+    /**
+     * This function gives the parameters to load.
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_INVALIDPARAMETERS if an index was out
+     *         of the schema, a parameter was defined twice, the arena was full or used by another builder.
+     */
+    int params( TEccParams_t* out ) const {
+        if( error != ERR_NOERROR ) return error;
+        out->len     = (int)count;
+        out->pParams = count ? first_param : 0;
+        return ERR_NOERROR;
+    }
+
+    /** Copies the parameters into a \ref TEccTechnique_t, with the .ecc file of the device family */
+    int technique( bool vmp4, TEccTechnique_t* tech ) const {
+        if( error != ERR_NOERROR ) return error;
+        tech->TechniqueID = SCHEMA::TechniqueID;
+        tech->EccFile     = ECC_FileName( SCHEMA::EccBase, vmp4 );
+        tech->Params.assign( first_param, first_param + count );
+        return ERR_NOERROR;
+    }
+
+    int    status() const { return error; }
+    size_t size() const { return count; }
+
+private:
+    static constexpr size_t NB_PARAMS = sizeof(SCHEMA::Params) / sizeof(SCHEMA::Params[0]);
+
+    template<int P, int TYPE> static void check(){
+        static_assert( P >= 0 && P < (int)NB_PARAMS, "this .ecc file has no parameter with this label" );
+        static_assert( P < 0 || SCHEMA::Params[P < 0 ? 0 : P].Type == TYPE, "the parameter has another type" );
+        static_assert( ECC_LabelLength( SCHEMA::Params[P < 0 ? 0 : P].Label ) < ECC_PARAM_LABEL_SIZE, "label too long" );
+    }
+
+    void add( int p, int value, int index ){
+        const TEccSchemaParam_t& def = SCHEMA::Params[p];
+        if( error != ERR_NOERROR ) return;
+        if( index < 0 || index >= def.Steps || defined[p][index]
+            || arena.used() != first + count ){
+            error = ERR_GEN_INVALIDPARAMETERS;
+            return;
+        }
+        TEccParam_t* param = arena.alloc();
+        if( !param ){
+            error = ERR_GEN_INVALIDPARAMETERS;
+            return;
+        }
+        if( count == 0 ) first_param = param;
+        memset( param, 0, sizeof(*param) );
+        memcpy( param->ParamStr, def.Label, ECC_LabelLength( def.Label ) );
+        param->ParamType  = def.Type;
+        param->ParamVal   = value;
+        param->ParamIndex = index;
+        defined[p][index] = 1;
+        count++;
+    }
+
+    EccArena&     arena;
+    size_t        first;
+    size_t        count;
+    TEccParam_t*  first_param;
+    int           error;
+    unsigned char defined[NB_PARAMS][ECC_MaxSteps( SCHEMA::Params )];
+};
+
+/** @} */
+
+#endif /* _ECCBUILDER_H_ */
@@ -0,0 +1,188 @@
+#include "EccLibrary.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#include "EccParams.h"
+#include "FileUtils.h"
+#include "MappedFile.h"
+
+static long long s_nowMs(){
+    return std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+static std::string s_lower( const std::string& name ){
+    std::string low( name );
+    for( size_t i = 0; i < low.size(); i++ ) low[i] = (char)tolower( (unsigned char)low[i] );
+    return low;
+}
+
+static bool s_isEcc( const std::string& name ){
+    return name.size() > 4 && s_lower( name.substr( name.size() - 4 ) ) == ".ecc";
+}
+
+EccLibrary::EccLibrary()
+    : check_ms( ECC_CHECK_INTERVAL_MS )
+{
+    memset( &counters, 0, sizeof(counters) );
+}
+
+/* reads and hashes a file of the folder; the lock is held */
+int EccLibrary::readFile( const std::string& name, TEntry_t* entry )
+{
+    std::string path = folder + "/" + name;
+    TFileStat_t st;
+    if( FILE_Stat( path.c_str(), &st ) != ERR_NOERROR ) return ERR_TECH_ECCFILENOTEXISTS;
+    MappedFile mapped;
+    if( mapped.open( path.c_str() ) != ERR_NOERROR ) return ERR_TECH_ECCFILENOTEXISTS;
+    std::shared_ptr< std::vector<unsigned char> > content( new std::vector<unsigned char>( mapped.data(), mapped.data() + mapped.size() ) );
+    entry->File.Name    = name;
+    entry->File.Path    = path;
+    entry->File.Size    = st.Size;
+    entry->File.ModTime = st.ModTime;
+    entry->File.Crc     = CRC32_Compute( content->empty() ? 0 : &(*content)[0], content->size() );
+    entry->File.Content = content;
+    entry->Checked      = s_nowMs();
+    counters.BytesRead += content->size();
+    return ERR_NOERROR;
+}
+
+int EccLibrary::open( const std::string& dir )
+{
+    std::lock_guard<std::mutex> guard( lock );
+    entries.clear();
+    memset( &counters, 0, sizeof(counters) );
+    folder = FILE_FullPath( dir.c_str() );
+    while( folder.size() > 1 && ( folder[folder.size() - 1] == '/' || folder[folder.size() - 1] == '\\' ) ) folder.erase( folder.size() - 1 );
+
+    std::vector<std::string> names;
+    if( FILE_ListDir( folder.c_str(), names ) != ERR_NOERROR ) return ERR_GEN_FILENOTEXISTS;
+    for( size_t i = 0; i < names.size(); i++ ){
+        if( !s_isEcc( names[i] ) ) continue;
+        TEntry_t entry;
+        if( readFile( names[i], &entry ) == ERR_NOERROR ) entries[s_lower( names[i] )] = entry;
+    }
+    counters.Files = entries.size();
+    return entries.empty() ? ERR_GEN_FILENOTEXISTS : ERR_NOERROR;
+}
+
+int EccLibrary::file( const std::string& name, TEccFile_t* out )
+{
+    std::lock_guard<std::mutex> guard( lock );
+    std::map<std::string, TEntry_t>::iterator it = entries.find( s_lower( name ) );
+    if( it == entries.end() ) return ERR_TECH_ECCFILENOTEXISTS;
+
+    TEntry_t& entry = it->second;
+    long long now = s_nowMs();
+    if( now - entry.Checked >= (long long)check_ms ){
+        counters.Checks++;
+        TFileStat_t st;
+        if( FILE_Stat( entry.File.Path.c_str(), &st ) != ERR_NOERROR ){
+            entries.erase( it );
+            counters.Files = entries.size();
+            return ERR_TECH_ECCFILENOTEXISTS;
+        }
+        if( st.Size != entry.File.Size || st.ModTime != entry.File.ModTime ){
+            int status = readFile( entry.File.Name, &entry );
+            if( status != ERR_NOERROR ) return status;
+            counters.Reloads++;
+        }
+        entry.Checked = now;
+    } else {
+        counters.Hits++;
+    }
+    if( out ) *out = entry.File;
+    return ERR_NOERROR;
+}
+
+int EccLibrary::technique( const char* base, bool vmp4, TEccFile_t* out )
+{
+    if( !base ) return ERR_GEN_INVALIDPARAMETERS;
+    return file( ECC_FileName( base, vmp4 ), out );
+}
+
+int EccLibrary::refresh( int* changes )
+{
+    std::lock_guard<std::mutex> guard( lock );
+    int changed = 0;
+    std::vector<std::string> names;
+    if( FILE_ListDir( folder.c_str(), names ) != ERR_NOERROR ) return ERR_GEN_FILENOTEXISTS;
+
+    std::map<std::string, TEntry_t> scanned;
+    for( size_t i = 0; i < names.size(); i++ ){
+        if( !s_isEcc( names[i] ) ) continue;
+        std::string key = s_lower( names[i] );
+        std::map<std::string, TEntry_t>::iterator it = entries.find( key );
+        TFileStat_t st;
+        if( it != entries.end() && FILE_Stat( it->second.File.Path.c_str(), &st ) == ERR_NOERROR
+            && st.Size == it->second.File.Size && st.ModTime == it->second.File.ModTime ){
+            scanned[key] = it->second;
+            scanned[key].Checked = s_nowMs();
+            continue;
+        }
+        TEntry_t entry;
+        if( readFile( names[i], &entry ) != ERR_NOERROR ) continue;
+        if( it != entries.end() ) counters.Reloads++;
+        scanned[key] = entry;
+        changed++;
+    }
+    for( std::map<std::string, TEntry_t>::iterator it = entries.begin(); it != entries.end(); ++it ){
+        if( scanned.find( it->first ) == scanned.end() ) changed++;
+    }
+    entries.swap( scanned );
+    counters.Files = entries.size();
+    if( changes ) *changes = changed;
+    return ERR_NOERROR;
+}
+
+std::vector<std::string> EccLibrary::names() const
+{
+    std::lock_guard<std::mutex> guard( lock );
+    std::vector<std::string> list;
+    for( std::map<std::string, TEntry_t>::const_iterator it = entries.begin(); it != entries.end(); ++it ){
+        list.push_back( it->second.File.Name );
+    }
+    return list;
+}
+
+TEccLibraryStats_t EccLibrary::stats() const
+{
+    std::lock_guard<std::mutex> guard( lock );
+    return counters;
+}
+
+/* true if the folder holds .ecc files */
+static bool s_hasEcc( const std::string& dir ){
+    std::vector<std::string> names;
+    if( FILE_ListDir( dir.c_str(), names ) != ERR_NOERROR ) return false;
+    for( size_t i = 0; i < names.size(); i++ ){
+        if( s_isEcc( names[i] ) ) return true;
+    }
+    return false;
+}
+
+int ECC_FindPackageDir( const char* start, std::string* dir )
+{
+    if( !dir ) return ERR_GEN_INVALIDPARAMETERS;
+    const char* env = getenv( ECC_PACKAGE_ENV );
+    if( env && *env ){
+        if( !s_hasEcc( env ) ) return ERR_GEN_FILENOTEXISTS;
+        *dir = FILE_FullPath( env );
+        return ERR_NOERROR;
+    }
+
+    std::string folder = FILE_FullPath( ( start && *start ) ? start : "." );
+    for( ;; ){
+        std::string candidate = folder + "/" + ECC_PACKAGE_FOLDER;
+        if( s_hasEcc( candidate ) ){
+            *dir = candidate;
+            return ERR_NOERROR;
+        }
+        size_t slash = folder.find_last_of( "/\\" );
+        if( slash == std::string::npos || slash == 0 || folder.size() <= 3 ) break;
+        folder.erase( slash );
+    }
+    return ERR_GEN_FILENOTEXISTS;
+}
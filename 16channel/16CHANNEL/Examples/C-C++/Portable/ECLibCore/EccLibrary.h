@@ -0,0 +1,141 @@
+#pragma once
+
+#ifndef _ECCLIBRARY_H_
+#define _ECCLIBRARY_H_
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <BLStructs.h>
+
+/*
+ * Index of the .ecc files of the development package
+ *
+ * The folder is scanned once: every .ecc file is read, hashed (CRC-32) and kept
+ * in memory, indexed by its name without case ("TO4.ecc" and "to4.ecc" are the
+ * same). The techniques are found by their base name and the device family
+ * (ca.ecc for the VMP3 series, ca4.ecc for the VMP4 technology), and given to
+ * BL_LoadTechnique by their absolute path, whatever the current directory.
+ *
+ * A file changed on the disk is detected by its size and modification time,
+ * checked at most once per interval: it is then read and hashed again. In
+ * between, a file is served from memory without any access to the disk.
+ */
+
+/**
+ * \defgroup ecc_library .ecc file library
+ * @{
+ */
+
+/** Name of the folder of the .ecc files in the development package */
+#define ECC_PACKAGE_FOLDER      "EC-Lab Development Package"
+/** Environment variable which gives the folder of the .ecc files */
+#define ECC_PACKAGE_ENV         "ECLAB_PACKAGE_DIR"
+/** Default interval between two checks of a file on the disk (ms) */
+#define ECC_CHECK_INTERVAL_MS   (1000)
+
+/** A .ecc file of the library */
+typedef struct {
+    std::string                                       Name;    /*!< file name, e.g. "ca4.ecc" */
+    std::string                                       Path;    /*!< absolute path */
+    long long                                         Size;
+    long long                                         ModTime; /*!< see \ref TFileStat_t */
+    unsigned int                                      Crc;     /*!< CRC-32 of the content */
+    std::shared_ptr<const std::vector<unsigned char> > Content;
+} TEccFile_t;
+
+/** Counters of an \ref EccLibrary */
+typedef struct {
+    unsigned long long Files;      /*!< files in the index */
+    unsigned long long Hits;       /*!< files served from memory */
+    unsigned long long Checks;     /*!< checks of a file on the disk (stat) */
+    unsigned long long Reloads;    /*!< files read again because they changed */
+    unsigned long long BytesRead;  /*!< bytes read from the disk since the library was opened */
+} TEccLibraryStats_t;
+
+/**
+ * This class indexes and caches the .ecc files of a folder. It may be shared by
+ * several threads.
+ */
+class EccLibrary
+{
+public:
+    EccLibrary();
+
+    /**
+     * This function scans a folder: every .ecc file is read and hashed.
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_FILENOTEXISTS if the folder cannot be
+     *         read or holds no .ecc file.
+     */
+    int open( const std::string& dir );
+
+    /** Absolute path of the folder scanned */
+    const std::string& dir() const { return folder; }
+
+    /** Sets the interval between two checks of a file on the disk, 0 to check on each access */
+    void setCheckInterval( unsigned int ms ) { check_ms = ms; }
+
+    /**
+     * This function gives a file of the library. The file is checked on the disk if
+     * the check interval elapsed, and read again if it changed.
+     *
+     * @param name file name, as \ref TEccTechnique_t::EccFile ("ca4.ecc")
+     * @param file the file, its path and its content
+     * @return \ref ERR_NOERROR if successful, \ref ERR_TECH_ECCFILENOTEXISTS if the library has
+     *         no such file or it was removed from the disk.
+     */
+    int file( const std::string& name, TEccFile_t* file );
+
+    /**
+     * Same as \ref file for a technique and a device family: "ca" gives ca.ecc, or ca4.ecc
+     * if vmp4 is true. There is no fallback from a family to the other one.
+     */
+    int technique( const char* base, bool vmp4, TEccFile_t* file );
+
+    /**
+     * This function scans the folder again: new files are added, removed files are
+     * dropped, changed files are read again.
+     * @param changes optional number of files added, removed or changed
+     */
+    int refresh( int* changes = 0 );
+
+    /** Names of the files of the library */
+    std::vector<std::string> names() const;
+
+    TEccLibraryStats_t stats() const;
+
+private:
+    EccLibrary( const EccLibrary& );
+    EccLibrary& operator=( const EccLibrary& );
+
+    typedef struct {
+        TEccFile_t File;
+        long long  Checked;   /* ms, steady clock */
+    } TEntry_t;
+
+    int  readFile( const std::string& name, TEntry_t* entry );
+
+    mutable std::mutex              lock;
+    std::string                     folder;
+    std::map<std::string, TEntry_t> entries;   /* by lower case name */
+    unsigned int                    check_ms;
+    TEccLibraryStats_t              counters;
+};
+
+/**
+ * This function finds the folder of the .ecc files: the folder given by the
+ * ECLAB_PACKAGE_DIR environment variable if set, otherwise an "EC-Lab Development
+ * Package" folder in 'start' or in one of its parents.
+ *
+ * @param start folder to start from (e.g. the folder of the program), 0 for the current one
+ * @param dir absolute path of the folder found
+ * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_FILENOTEXISTS if no folder was found.
+ */
+int ECC_FindPackageDir( const char* start, std::string* dir );
+
+/** @} */
+
+#endif /* _ECCLIBRARY_H_ */
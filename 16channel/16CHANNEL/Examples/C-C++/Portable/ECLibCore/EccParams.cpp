@@ -0,0 +1,102 @@
+#include "EccParams.h"
+
+#include <ctype.h>
+#include <string.h>
+
+static int s_define( const char* lbl, int type, int value, int index, TEccParam_t* pParam ){
+    if( !lbl || !pParam || strlen( lbl ) >= ECC_PARAM_LABEL_SIZE ) return ERR_GEN_INVALIDPARAMETERS;
+    memset( pParam, 0, sizeof(*pParam) );
+    strcpy( pParam->ParamStr, lbl );
+    pParam->ParamType  = type;
+    pParam->ParamVal   = value;
+    pParam->ParamIndex = index;
+    return ERR_NOERROR;
+}
+
+int ECC_DefineBoolParameter( const char* lbl, bool value, int index, TEccParam_t* pParam )
+{
+    return s_define( lbl, PARAM_BOOLEAN, value ? 1 : 0, index, pParam );
+}
+
+int ECC_DefineSglParameter( const char* lbl, float value, int index, TEccParam_t* pParam )
+{
+    int bits;
+    memcpy( &bits, &value, sizeof(bits) );
+    return s_define( lbl, PARAM_SINGLE, bits, index, pParam );
+}
+
+int ECC_DefineIntParameter( const char* lbl, int value, int index, TEccParam_t* pParam )
+{
+    return s_define( lbl, PARAM_INT32, value, index, pParam );
+}
+
+float ECC_SglValue( const TEccParam_t& param )
+{
+    float value;
+    memcpy( &value, &param.ParamVal, sizeof(value) );
+    return value;
+}
+
+TEccParams_t ECC_Params( const TEccTechnique_t& tech )
+{
+    TEccParams_t params;
+    params.len     = (int)tech.Params.size();
+    params.pParams = tech.Params.empty() ? 0 : const_cast<TEccParam_t*>( &tech.Params[0] );
+    return params;
+}
+
+std::string ECC_FileName( const char* base, bool vmp4 )
+{
+    std::string name( base );
+    if( vmp4 ) name += "4";
+    name += ".ecc";
+    return name;
+}
+
+bool ECC_IsVmp4( int device_code )
+{
+    static const TDeviceType_e vmp4_devices[] = {
+        KBIO_DEV_SP200, KBIO_DEV_SP300,
+        KBIO_DEV_VSP300, KBIO_DEV_VMP300, KBIO_DEV_SP240
+    };
+
+    for( size_t i = 0; i < sizeof(vmp4_devices)/sizeof(vmp4_devices[0]); i++ ){
+        if( device_code == vmp4_devices[i] ) return true;
+    }
+    return false;
+}
+
+bool ECC_IsVmp4Device( const char* device )
+{
+    static const char* vmp4_devices[] = { "SP200", "SP300", "VSP300", "VMP300", "SP240" };
+
+    /* EC-Lab writes "SP-300", the device list "SP300": compare without the dashes and blanks */
+    char name[32];
+    size_t n = 0;
+    for( ; device && *device && n < sizeof(name) - 1; device++ ){
+        if( *device != '-' && *device != ' ' ) name[n++] = (char)toupper( (unsigned char)*device );
+    }
+    name[n] = '\0';
+
+    for( size_t i = 0; i < sizeof(vmp4_devices)/sizeof(vmp4_devices[0]); i++ ){
+        if( strcmp( name, vmp4_devices[i] ) == 0 ) return true;
+    }
+    return false;
+}
+
+bool ECC_IsHardwareParam( const char* label )
+{
+    static const char* hardware[] = { "I_Range", "E_Range", "Bandwidth", "tb" };
+    for( size_t i = 0; label && i < sizeof(hardware)/sizeof(hardware[0]); i++ ){
+        if( strcmp( label, hardware[i] ) == 0 ) return true;
+    }
+    return false;
+}
+
+void ECC_ChangedParams( const TEccTechnique_t& from, const TEccTechnique_t& to, std::vector<TEccParam_t>& changed )
+{
+    changed.clear();
+    for( size_t p = 0; p < to.Params.size(); p++ ){
+        if( p >= from.Params.size() || from.Params[p].ParamVal != to.Params[p].ParamVal ) changed.push_back( to.Params[p] );
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#ifndef _ECCPARAMS_H_
+#define _ECCPARAMS_H_
+
+#include <string>
+#include <vector>
+
+#include <BLStructs.h>
+
+/*
+ * Technique parameters (TEccParam_t) built without calling the DLL
+ *
+ * BL_DefineBoolParameter, BL_DefineSglParameter and BL_DefineIntParameter only
+ * fill the structure: the label is copied, and the value is stored in ParamVal as
+ * an int, a 0/1 boolean or the bits of the IEEE 754 single. The functions below do
+ * the same, so parameter tables can be prepared before the DLL is loaded and away
+ * from the thread which talks to the instrument.
+ */
+
+/**
+ * \defgroup ecc_params Technique parameters
+ * @{
+ */
+
+/** Size of the label of a parameter (see \ref TEccParam_t::ParamStr) */
+#define ECC_PARAM_LABEL_SIZE  (64)
+
+/** Largest number of parameters BL_UpdateParameters accepts in one call */
+#define ECC_UPDATE_MAX_PARAMS (10)
+
+/**
+ * Same as BL_DefineBoolParameter.
+ * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_INVALIDPARAMETERS if the label is too long.
+ */
+int ECC_DefineBoolParameter( const char* lbl, bool value, int index, TEccParam_t* pParam );
+
+/** Same as BL_DefineSglParameter (see \ref ECC_DefineBoolParameter for the returned value) */
+int ECC_DefineSglParameter( const char* lbl, float value, int index, TEccParam_t* pParam );
+
+/** Same as BL_DefineIntParameter (see \ref ECC_DefineBoolParameter for the returned value) */
+int ECC_DefineIntParameter( const char* lbl, int value, int index, TEccParam_t* pParam );
+
+/** Value of a parameter defined with \ref ECC_DefineSglParameter */
+float ECC_SglValue( const TEccParam_t& param );
+
+/** A technique ready to be loaded: the .ecc file and its parameters */
+typedef struct {
+    int                      TechniqueID; /*!< technique identifier (see \ref TTechniqueIdentifier_e) */
+    std::string              EccFile;     /*!< name of the .ecc file, e.g. "cv.ecc" or "cv4.ecc" */
+    std::vector<TEccParam_t> Params;      /*!< parameters, in the order they were defined */
+} TEccTechnique_t;
+
+/**
+ * Returns the \ref TEccParams_t to give to BL_LoadTechnique. It points into the
+ * technique, which must outlive the call.
+ */
+TEccParams_t ECC_Params( const TEccTechnique_t& tech );
+
+/** Returns the .ecc file of a technique for the device family ("ca" gives "ca.ecc" or "ca4.ecc") */
+std::string ECC_FileName( const char* base, bool vmp4 );
+
+/** True if the device code (see \ref TDeviceType_e) uses the VMP4 technology: SP-200, SP-300, VSP-300, VMP-300, SP-240 */
+bool ECC_IsVmp4( int device_code );
+
+/** Same as \ref ECC_IsVmp4 for a device name as written by EC-Lab ("SP-300", "VMP3", ...) */
+bool ECC_IsVmp4Device( const char* device );
+
+/**
+ * True if the parameter configures the acquisition (I_Range, E_Range, Bandwidth, tb):
+ * it is set when the technique begins and cannot be changed by BL_UpdateParameters.
+ */
+bool ECC_IsHardwareParam( const char* label );
+
+/**
+ * This function gives the parameters of a technique whose values differ in another
+ * version of it, as they are given to BL_UpdateParameters.
+ *
+ * @param from technique loaded
+ * @param to same technique with new values (same labels, types and indices, see \ref ECC_SameShape)
+ * @param changed parameters of 'to' whose values changed
+ */
+void ECC_ChangedParams( const TEccTechnique_t& from, const TEccTechnique_t& to, std::vector<TEccParam_t>& changed );
+
+/** @} */
+
+#endif /* _ECCPARAMS_H_ */
@@ -0,0 +1,246 @@
+#include "EccSequence.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "MappedFile.h"
+
+static bool s_isBlank( char c ){
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+/* words of a line, up to the comment */
+static void s_split( const char* begin, const char* end, std::vector<std::string>& words ){
+    words.clear();
+    const char* p = begin;
+    while( p < end && *p != '#' ){
+        while( p < end && s_isBlank( *p ) ) p++;
+        const char* word = p;
+        while( p < end && !s_isBlank( *p ) && *p != '#' ) p++;
+        if( p > word ) words.push_back( std::string( word, p ) );
+    }
+}
+
+static bool s_parseInt( const std::string& text, int* value ){
+    char* end = 0;
+    errno = 0;
+    long v = strtol( text.c_str(), &end, 10 );
+    if( text.empty() || *end != '\0' || errno != 0 || v < -2147483647L - 1 || v > 2147483647L ) return false;
+    *value = (int)v;
+    return true;
+}
+
+static bool s_parseFloat( const std::string& text, float* value ){
+    char* end = 0;
+    errno = 0;
+    *value = strtof( text.c_str(), &end );
+    return !text.empty() && *end == '\0' && errno == 0;
+}
+
+static bool s_parseBool( const std::string& text, bool* value ){
+    if( text == "1" || text == "true" )  { *value = true;  return true; }
+    if( text == "0" || text == "false" ) { *value = false; return true; }
+    return false;
+}
+
+static int s_findParam( const TEccSchema_t* schema, const std::string& label ){
+    for( size_t p = 0; p < schema->Count; p++ ){
+        if( label == schema->Params[p].Label ) return (int)p;
+    }
+    return -1;
+}
+
+EccSequence::EccSequence()
+{
+}
+
+int EccSequence::fail( int code, int line, const std::string& msg )
+{
+    char where[32];
+    snprintf( where, sizeof(where), "line %d: ", line );
+    error = where + msg;
+    return code;
+}
+
+int EccSequence::open( const char* path )
+{
+    MappedFile file;
+    int status = file.open( path );
+    if( status != ERR_NOERROR ){
+        nodes.clear();
+        error = std::string( "cannot open " ) + ( path ? path : "(null)" );
+        return status;
+    }
+    return parse( (const char*)file.data(), file.size() );
+}
+
+int EccSequence::parse( const char* text, size_t size )
+{
+    nodes.clear();
+    labels.clear();
+    pending.clear();
+    error.clear();
+
+    const char* end = text ? text + size : text;
+    const char* line = text;
+    std::vector<std::string> words;
+    int number = 0;
+    while( line < end ){
+        const char* eol = (const char*)memchr( line, '\n', end - line );
+        if( !eol ) eol = end;
+        number++;
+        s_split( line, eol, words );
+        line = ( eol < end ) ? eol + 1 : end;
+        if( words.empty() ) continue;
+
+        int status = ERR_NOERROR;
+        if( words[0] == "label" ){
+            if( words.size() != 2 ) return fail( ERR_GEN_INVALIDPARAMETERS, number, "label needs one name" );
+            bool known = false;
+            for( size_t l = 0; l < labels.size() && !known; l++ ) known = labels[l].first == words[1];
+            for( size_t l = 0; l < pending.size() && !known; l++ ) known = pending[l] == words[1];
+            if( known ) return fail( ERR_GEN_INVALIDPARAMETERS, number, "label '" + words[1] + "' defined twice" );
+            pending.push_back( words[1] );
+        } else if( words[0] == "loop" ){
+            status = parseLoop( number, words );
+        } else {
+            status = parseNode( number, words );
+        }
+        if( status != ERR_NOERROR ) return status;
+    }
+
+    if( !pending.empty() ) return fail( ERR_GEN_INVALIDPARAMETERS, number, "label '" + pending[0] + "' without technique after it" );
+    if( nodes.empty() ) return fail( ERR_GEN_INVALIDPARAMETERS, number, "no technique" );
+    return ERR_NOERROR;
+}
+
+int EccSequence::parseLoop( int line, const std::vector<std::string>& words )
+{
+    if( words.size() != 3 ) return fail( ERR_GEN_INVALIDPARAMETERS, line, "loop needs a label and a number of times (or 'forever')" );
+    size_t target = nodes.size();
+    for( size_t l = 0; l < labels.size(); l++ ){
+        if( labels[l].first == words[1] ) target = labels[l].second;
+    }
+    if( target == nodes.size() ) return fail( ERR_GEN_INVALIDPARAMETERS, line, "loop to '" + words[1] + "', which is not a label of a technique before it" );
+    int times = -1;
+    if( words[2] != "forever" && ( !s_parseInt( words[2], &times ) || times < 1 ) ){
+        return fail( ERR_GEN_INVALIDPARAMETERS, line, "the number of times of a loop is 1 or more, or 'forever'" );
+    }
+
+    TEccSequenceNode_t node;
+    node.Line   = line;
+    node.Schema = ECC_FindSchemaById( KBIO_TECHID_LOOP );
+    node.Params.resize( 2 );
+    int status = ECC_DefineIntParameter( "loop_N_times", times, 0, &node.Params[0] );
+    if( status == ERR_NOERROR ) status = ECC_DefineIntParameter( "protocol_number", (int)target, 0, &node.Params[1] );
+    if( status != ERR_NOERROR ) return fail( status, line, "cannot define the loop" );
+    for( size_t l = 0; l < pending.size(); l++ ) labels.push_back( std::make_pair( pending[l], nodes.size() ) );
+    pending.clear();
+    nodes.push_back( node );
+    return ERR_NOERROR;
+}
+
+int EccSequence::parseNode( int line, const std::vector<std::string>& words )
+{
+    TEccSequenceNode_t node;
+    node.Line   = line;
+    node.Schema = ECC_FindSchema( words[0].c_str() );
+    if( !node.Schema ) return fail( ERR_GEN_INVALIDPARAMETERS, line, "unknown technique '" + words[0] + "'" );
+
+    for( size_t w = 1; w < words.size(); w++ ){
+        const std::string& word = words[w];
+        size_t equal = word.find( '=' );
+        if( equal == std::string::npos ) return fail( ERR_GEN_INVALIDPARAMETERS, line, "'" + word + "' is not label=value" );
+        std::string label = word.substr( 0, equal );
+        std::string value = word.substr( equal + 1 );
+        int index = 0;
+        size_t bracket = label.find( '[' );
+        if( bracket != std::string::npos ){
+            if( label[label.size() - 1] != ']' || !s_parseInt( label.substr( bracket + 1, label.size() - bracket - 2 ), &index ) ){
+                return fail( ERR_GEN_INVALIDPARAMETERS, line, "bad index in '" + label + "'" );
+            }
+            label.erase( bracket );
+        }
+
+        int p = s_findParam( node.Schema, label );
+        if( p < 0 ) return fail( ERR_GEN_INVALIDPARAMETERS, line, std::string( node.Schema->Name ) + " has no parameter '" + label + "'" );
+        const TEccSchemaParam_t& def = node.Schema->Params[p];
+        if( index < 0 || index >= def.Steps ) return fail( ERR_GEN_INVALIDPARAMETERS, line, "index of '" + label + "' out of range" );
+        for( size_t q = 0; q < node.Params.size(); q++ ){
+            if( label == node.Params[q].ParamStr && node.Params[q].ParamIndex == index ){
+                return fail( ERR_GEN_INVALIDPARAMETERS, line, "'" + words[w].substr( 0, equal ) + "' defined twice" );
+            }
+        }
+
+        TEccParam_t param;
+        int   ivalue;
+        float fvalue;
+        bool  bvalue;
+        int status = ERR_GEN_INVALIDPARAMETERS;
+        if( def.Type == PARAM_INT32 && s_parseInt( value, &ivalue ) ){
+            status = ECC_DefineIntParameter( def.Label, ivalue, index, &param );
+        } else if( def.Type == PARAM_SINGLE && s_parseFloat( value, &fvalue ) ){
+            status = ECC_DefineSglParameter( def.Label, fvalue, index, &param );
+        } else if( def.Type == PARAM_BOOLEAN && s_parseBool( value, &bvalue ) ){
+            status = ECC_DefineBoolParameter( def.Label, bvalue, index, &param );
+        }
+        if( status != ERR_NOERROR ){
+            static const char* types[3] = { "an integer", "a boolean", "a number" };
+            return fail( ERR_GEN_INVALIDPARAMETERS, line, "'" + label + "' is " + types[def.Type] + ", not '" + value + "'" );
+        }
+        node.Params.push_back( param );
+    }
+
+    int status = checkNode( node );
+    if( status != ERR_NOERROR ) return status;
+    for( size_t l = 0; l < pending.size(); l++ ) labels.push_back( std::make_pair( pending[l], nodes.size() ) );
+    pending.clear();
+    nodes.push_back( node );
+    return ERR_NOERROR;
+}
+
+/* every single value parameter is given, the multi-step ones have the same steps 0..n-1 */
+int EccSequence::checkNode( const TEccSequenceNode_t& node )
+{
+    const TEccSchema_t* schema = node.Schema;
+    int steps = -1;
+    for( size_t p = 0; p < schema->Count; p++ ){
+        const TEccSchemaParam_t& def = schema->Params[p];
+        int count = 0, last = -1;
+        for( size_t q = 0; q < node.Params.size(); q++ ){
+            if( strcmp( node.Params[q].ParamStr, def.Label ) != 0 ) continue;
+            count++;
+            if( node.Params[q].ParamIndex > last ) last = node.Params[q].ParamIndex;
+        }
+        if( count == 0 ) return fail( ERR_GEN_INVALIDPARAMETERS, node.Line, std::string( "missing '" ) + def.Label + "'" );
+        if( def.Steps == 1 ) continue;
+        if( last + 1 != count ) return fail( ERR_GEN_INVALIDPARAMETERS, node.Line, std::string( "steps of '" ) + def.Label + "' not numbered from 0" );
+        if( steps >= 0 && count != steps ) return fail( ERR_GEN_INVALIDPARAMETERS, node.Line, std::string( "'" ) + def.Label + "' has another number of steps" );
+        steps = count;
+    }
+
+    int p = s_findParam( schema, "Step_number" );
+    if( p >= 0 && steps >= 0 ){
+        for( size_t q = 0; q < node.Params.size(); q++ ){
+            if( strcmp( node.Params[q].ParamStr, "Step_number" ) == 0 && node.Params[q].ParamVal + 1 != steps ){
+                return fail( ERR_GEN_INVALIDPARAMETERS, node.Line, "Step_number does not match the steps given" );
+            }
+        }
+    }
+    return ERR_NOERROR;
+}
+
+int EccSequence::compile( bool vmp4, std::vector<TEccTechnique_t>& chain ) const
+{
+    chain.clear();
+    if( nodes.empty() ) return ERR_GEN_INVALIDPARAMETERS;
+    chain.resize( nodes.size() );
+    for( size_t t = 0; t < nodes.size(); t++ ){
+        chain[t].TechniqueID = nodes[t].Schema->TechniqueID;
+        chain[t].EccFile     = ECC_FileName( nodes[t].Schema->EccBase, vmp4 );
+        chain[t].Params      = nodes[t].Params;
+    }
+    return ERR_NOERROR;
+}
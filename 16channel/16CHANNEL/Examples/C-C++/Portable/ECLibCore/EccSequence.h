@@ -0,0 +1,92 @@
+#pragma once
+
+#ifndef _ECCSEQUENCE_H_
+#define _ECCSEQUENCE_H_
+
+#include <string>
+#include <vector>
+
+#include "EccBuilder.h"
+
+/*
+ * Sequences of linked techniques (*.seq)
+ *
+ * A sequence is a text file, one node per line; '#' starts a comment. A technique
+ * line gives the name of the technique (see \ref ECC_FindSchema) followed by its
+ * parameters, with the labels of the .ecc file; the index of a multi-step parameter
+ * is given between brackets. "label" names the next technique, "loop" goes back to
+ * a named technique a number of times (or for ever):
+ *
+ *     ocv          Rest_time_T=60 Record_every_dE=0.1 Record_every_dT=1 E_Range=0 xctr=0
+ *     label        cycle
+ *     trigger_out  Trigger_Logic=1 Trigger_Duration=1
+ *     ca           Voltage_step[0]=0.5 vs_initial[0]=false Duration_step[0]=30 Step_number=0 ...
+ *     trigger_in   Trigger_Logic=1
+ *     loop         cycle 9          # 10 cycles
+ *
+ * Every node is checked against the schema of its technique when the sequence is
+ * parsed: unknown labels, values of the wrong type, indices out of range, missing
+ * parameters, steps not matching Step_number and loops to unknown labels are
+ * reported with their line, before anything is sent to an instrument.
+ */
+
+/**
+ * \ingroup ecc_params
+ * @{
+ */
+
+/** A technique of a sequence */
+typedef struct {
+    int                      Line;   /*!< line of the node in the text (1-based) */
+    const TEccSchema_t*      Schema;
+    std::vector<TEccParam_t> Params; /*!< parameters, in the order of the text */
+} TEccSequenceNode_t;
+
+/**
+ * This class parses a sequence of linked techniques and compiles it into the chain
+ * to load (see \ref TechniqueCache::load and \ref TechniqueCache::loadChannels).
+ */
+class EccSequence
+{
+public:
+    EccSequence();
+
+    /**
+     * This function reads and parses a sequence file.
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_FILENOTEXISTS if the file cannot be
+     *         opened, \ref ERR_GEN_INVALIDPARAMETERS if a node is not valid (see \ref errorMessage).
+     */
+    int open( const char* path );
+
+    /** Same as \ref open, for a sequence already in memory */
+    int parse( const char* text, size_t size );
+
+    /** Human readable description of the last error, with its line */
+    const char* errorMessage() const { return error.c_str(); }
+
+    size_t                    techniqueCount() const { return nodes.size(); }
+    const TEccSequenceNode_t& technique( size_t i ) const { return nodes[i]; }
+
+    /**
+     * This function gives the techniques to load, in order.
+     * @param vmp4 true to use the .ecc files of the VMP4 technology devices
+     * @param chain compiled techniques
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_INVALIDPARAMETERS if the sequence is empty.
+     */
+    int compile( bool vmp4, std::vector<TEccTechnique_t>& chain ) const;
+
+private:
+    int fail( int code, int line, const std::string& msg );
+    int parseNode( int line, const std::vector<std::string>& words );
+    int parseLoop( int line, const std::vector<std::string>& words );
+    int checkNode( const TEccSequenceNode_t& node );
+
+    std::vector<TEccSequenceNode_t>                 nodes;
+    std::vector< std::pair<std::string, size_t> >   labels;   /* name, technique */
+    std::vector<std::string>                        pending;  /* labels of the next technique */
+    std::string                                     error;
+};
+
+/** @} */
+
+#endif /* _ECCSEQUENCE_H_ */
@@ -0,0 +1,149 @@
+#include "FileUtils.h"
+
+#include <string.h>
+
+#include <BLStructs.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+int FILE_Seek( FILE* f, long long offset, int whence )
+{
+#ifdef _WIN32
+    return _fseeki64( f, offset, whence );
+#else
+    return fseeko( f, (off_t)offset, whence );
+#endif
+}
+
+long long FILE_Tell( FILE* f )
+{
+#ifdef _WIN32
+    return _ftelli64( f );
+#else
+    return (long long)ftello( f );
+#endif
+}
+
+int FILE_Sync( FILE* f )
+{
+    if( !f || fflush( f ) != 0 ) return ERR_GEN_FUNCTIONFAILED;
+#ifdef _WIN32
+    return _commit( _fileno( f ) ) == 0 ? ERR_NOERROR : ERR_GEN_FUNCTIONFAILED;
+#else
+    return fsync( fileno( f ) ) == 0 ? ERR_NOERROR : ERR_GEN_FUNCTIONFAILED;
+#endif
+}
+
+int FILE_Truncate( FILE* f, long long size )
+{
+    if( !f || fflush( f ) != 0 ) return ERR_GEN_FUNCTIONFAILED;
+#ifdef _WIN32
+    return _chsize_s( _fileno( f ), size ) == 0 ? ERR_NOERROR : ERR_GEN_FUNCTIONFAILED;
+#else
+    return ftruncate( fileno( f ), (off_t)size ) == 0 ? ERR_NOERROR : ERR_GEN_FUNCTIONFAILED;
+#endif
+}
+
+int FILE_Stat( const char* path, TFileStat_t* st )
+{
+    if( !path || !st ) return ERR_GEN_INVALIDPARAMETERS;
+#ifdef _WIN32
+    struct _stat64 info;
+    if( _stat64( path, &info ) != 0 || ( info.st_mode & _S_IFREG ) == 0 ) return ERR_GEN_FILENOTEXISTS;
+    st->Size    = (long long)info.st_size;
+    st->ModTime = (long long)info.st_mtime * 1000000000LL;
+#else
+    struct stat info;
+    if( stat( path, &info ) != 0 || !S_ISREG( info.st_mode ) ) return ERR_GEN_FILENOTEXISTS;
+    st->Size    = (long long)info.st_size;
+    st->ModTime = (long long)info.st_mtim.tv_sec * 1000000000LL + info.st_mtim.tv_nsec;
+#endif
+    return ERR_NOERROR;
+}
+
+int FILE_ListDir( const char* dir, std::vector<std::string>& names )
+{
+    names.clear();
+    if( !dir ) return ERR_GEN_INVALIDPARAMETERS;
+#ifdef _WIN32
+    std::string pattern = std::string( dir ) + "\\*";
+    WIN32_FIND_DATAA found;
+    HANDLE h = FindFirstFileA( pattern.c_str(), &found );
+    if( h == INVALID_HANDLE_VALUE ) return ERR_GEN_FILENOTEXISTS;
+    do {
+        if( !( found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY ) ) names.push_back( found.cFileName );
+    } while( FindNextFileA( h, &found ) );
+    FindClose( h );
+#else
+    DIR* d = opendir( dir );
+    if( !d ) return ERR_GEN_FILENOTEXISTS;
+    std::string prefix = std::string( dir ) + "/";
+    for( struct dirent* e = readdir( d ); e; e = readdir( d ) ){
+        struct stat info;
+        if( stat( ( prefix + e->d_name ).c_str(), &info ) == 0 && S_ISREG( info.st_mode ) ) names.push_back( e->d_name );
+    }
+    closedir( d );
+#endif
+    return ERR_NOERROR;
+}
+
+std::string FILE_FullPath( const char* path )
+{
+    if( !path ) return std::string();
+#ifdef _WIN32
+    char full[_MAX_PATH];
+    return _fullpath( full, path, sizeof(full) ) ? std::string( full ) : std::string( path );
+#else
+    char full[PATH_MAX];
+    return realpath( path, full ) ? std::string( full ) : std::string( path );
+#endif
+}
+
+/* tables of the CRC-32 polynomial for slicing-by-8, built on first use:
+   v[k][n] is the CRC of the byte n followed by k zero bytes */
+struct Crc32Table {
+    unsigned int v[8][256];
+    Crc32Table() {
+        for( unsigned int n = 0; n < 256; n++ ){
+            unsigned int c = n;
+            for( int k = 0; k < 8; k++ ) c = ( c & 1 ) ? 0xEDB88320u ^ ( c >> 1 ) : c >> 1;
+            v[0][n] = c;
+        }
+        for( unsigned int n = 0; n < 256; n++ ){
+            for( int k = 1; k < 8; k++ ) v[k][n] = v[0][v[k-1][n] & 0xFF] ^ ( v[k-1][n] >> 8 );
+        }
+    }
+};
+
+unsigned int CRC32_Compute( const void* data, size_t size, unsigned int crc )
+{
+    static const Crc32Table table;
+
+    const unsigned char* p = (const unsigned char*)data;
+    crc = ~crc;
+    /* 8 bytes per step, little-endian as the hosts ECLib runs on */
+    for( ; size >= 8; size -= 8, p += 8 ){
+        unsigned int lo, hi;
+        memcpy( &lo, p, 4 );
+        memcpy( &hi, p + 4, 4 );
+        lo ^= crc;
+        crc = table.v[7][lo & 0xFF] ^ table.v[6][( lo >> 8 ) & 0xFF] ^ table.v[5][( lo >> 16 ) & 0xFF] ^ table.v[4][lo >> 24]
+            ^ table.v[3][hi & 0xFF] ^ table.v[2][( hi >> 8 ) & 0xFF] ^ table.v[1][( hi >> 16 ) & 0xFF] ^ table.v[0][hi >> 24];
+    }
+    for( ; size > 0; size--, p++ ){
+        crc = table.v[0][( crc ^ *p ) & 0xFF] ^ ( crc >> 8 );
+    }
+    return ~crc;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#ifndef _FILEUTILS_H_
+#define _FILEUTILS_H_
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+/*
+ * 64 bits file positions, truncation and durable writes, file information and
+ * directory listing on Linux and Windows
+ */
+
+/**
+ * \ingroup portable_io
+ * @{
+ */
+
+/** fseek with a 64 bits offset */
+int       FILE_Seek( FILE* f, long long offset, int whence );
+
+/** ftell with a 64 bits result, -1 if failed */
+long long FILE_Tell( FILE* f );
+
+/**
+ * Flushes the stdio buffer and asks the system to write the file to the disk
+ * (fsync / _commit): the data survives a crash of the host, not only of the process.
+ * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_FUNCTIONFAILED otherwise.
+ */
+int       FILE_Sync( FILE* f );
+
+/**
+ * Cuts the file at 'size' bytes. The stdio buffer is flushed first.
+ * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_FUNCTIONFAILED otherwise.
+ */
+int       FILE_Truncate( FILE* f, long long size );
+
+/** Size and time of last modification of a file */
+typedef struct {
+    long long Size;
+    long long ModTime;   /*!< ns since 1970, with the resolution of the file system */
+} TFileStat_t;
+
+/**
+ * stat / _stat64, without reading the file.
+ * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_FILENOTEXISTS if the file does not exist.
+ */
+int       FILE_Stat( const char* path, TFileStat_t* st );
+
+/**
+ * Names of the files of a directory (not the sub-directories), in no particular order.
+ * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_FILENOTEXISTS if the directory cannot be read.
+ */
+int       FILE_ListDir( const char* dir, std::vector<std::string>& names );
+
+/** Absolute path of a file or directory, or the path itself if it cannot be resolved */
+std::string FILE_FullPath( const char* path );
+
+/** CRC-32 (IEEE 802.3, as zlib), to be chained by giving the previous value as 'crc' */
+unsigned int CRC32_Compute( const void* data, size_t size, unsigned int crc = 0 );
+
+/** @} */
+
+#endif /* _FILEUTILS_H_ */
@@ -0,0 +1,132 @@
+#include "FirmwareSetup.h"
+
+#include <string.h>
+#include <chrono>
+
+#include "ParallelFor.h"
+
+typedef std::chrono::steady_clock Clock;
+
+#define FW_NB_CHANNELS (16) /* channels of a device, as in the MFC sample */
+
+static double s_elapsed( Clock::time_point start ){
+    return std::chrono::duration<double>( Clock::now() - start ).count();
+}
+
+TFirmwareOptions_t FW_DefaultOptions()
+{
+    TFirmwareOptions_t options;
+    memset( &options, 0, sizeof(options) );
+    return options;
+}
+
+int FW_StaleReasons( const TChannelInfos_t& infos, const TFirmwareOptions_t& options )
+{
+    int stale = options.Force ? FW_STALE_FORCED : FW_STALE_NONE;
+    if( infos.FirmwareCode != KIBIO_FIRM_KERNEL ) return stale | FW_STALE_CODE;
+    if( options.FirmwareVersion && infos.FirmwareVersion != options.FirmwareVersion ) stale |= FW_STALE_VERSION;
+    if( options.XilinxVersion && infos.XilinxVersion != options.XilinxVersion ) stale |= FW_STALE_XILINX;
+    return stale;
+}
+
+int FW_SetupChannels( const TEClibFunctions* eclib, int id, const TFirmwareOptions_t& options, TFirmwareReport_t* report )
+{
+    TFirmwareReport_t done;
+    done.Plugged = done.Stale = done.Failed = 0;
+    done.PluggedSeconds = done.InfosSeconds = done.LoadSeconds = done.VerifySeconds = done.TotalSeconds = 0.0;
+    if( report ) *report = done;
+    if( !eclib || !eclib->BL_GetChannelsPlugged || !eclib->BL_GetChannelInfos || !eclib->BL_LoadFirmware ){
+        return ERR_GEN_INVALIDPARAMETERS;
+    }
+
+    /* plugged channels */
+    Clock::time_point start = Clock::now();
+    uint8 plugged[FW_NB_CHANNELS] = { 0 };
+    int status = eclib->BL_GetChannelsPlugged( id, plugged, FW_NB_CHANNELS );
+    done.PluggedSeconds = s_elapsed( start );
+    if( status == ERR_NOERROR ){
+        for( int ch = 0; ch < FW_NB_CHANNELS; ch++ ){
+            if( !plugged[ch] ) continue;
+            TChannelStartup_t channel;
+            memset( &channel, 0, sizeof(channel) );
+            channel.Channel = ch;
+            done.Channels.push_back( channel );
+        }
+        done.Plugged = (int)done.Channels.size();
+        if( done.Channels.empty() ) status = ERR_GEN_NOCHANNELELECTED;
+    }
+    if( status != ERR_NOERROR ){
+        done.TotalSeconds = s_elapsed( start );
+        if( report ) *report = done;
+        return status;
+    }
+
+    /* firmware of all the channels, before anything is loaded */
+    Clock::time_point phase = Clock::now();
+    PAR_For( done.Channels.size(), 0, [&]( size_t i ){
+        TChannelStartup_t& channel = done.Channels[i];
+        Clock::time_point t = Clock::now();
+        int st = eclib->BL_GetChannelInfos( id, (uint8)channel.Channel, &channel.Infos );
+        channel.InfoSeconds = s_elapsed( t );
+        channel.Stale = ( st == ERR_NOERROR ) ? FW_StaleReasons( channel.Infos, options )
+                                              : ( FW_STALE_INFOS | ( options.Force ? FW_STALE_FORCED : 0 ) );
+    } );
+    done.InfosSeconds = s_elapsed( phase );
+
+    std::vector<size_t> stale;
+    uint8 mask[FW_NB_CHANNELS] = { 0 };
+    for( size_t i = 0; i < done.Channels.size(); i++ ){
+        if( done.Channels[i].Stale == FW_STALE_NONE ) continue;
+        stale.push_back( i );
+        mask[done.Channels[i].Channel] = 1;
+    }
+    done.Stale = (int)stale.size();
+
+    /* only the stale channels, without gauge; they are reloaded even if the DLL finds the kernel there */
+    phase = Clock::now();
+    if( !stale.empty() && options.Threads <= 0 ){
+        int results[FW_NB_CHANNELS] = { 0 };
+        status = eclib->BL_LoadFirmware( id, mask, results, FW_NB_CHANNELS, false, true, options.BinFile, options.XlxFile );
+        double seconds = s_elapsed( phase );
+        for( size_t k = 0; k < stale.size(); k++ ){
+            TChannelStartup_t& channel = done.Channels[stale[k]];
+            channel.Result      = ( status != ERR_NOERROR && results[channel.Channel] == ERR_NOERROR ) ? status : results[channel.Channel];
+            channel.LoadSeconds = seconds;
+        }
+    } else if( !stale.empty() ){
+        PAR_For( stale.size(), options.Threads, [&]( size_t k ){
+            TChannelStartup_t& channel = done.Channels[stale[k]];
+            uint8 one[FW_NB_CHANNELS] = { 0 };
+            int results[FW_NB_CHANNELS] = { 0 };
+            one[channel.Channel] = 1;
+            Clock::time_point t = Clock::now();
+            int st = eclib->BL_LoadFirmware( id, one, results, FW_NB_CHANNELS, false, true, options.BinFile, options.XlxFile );
+            channel.LoadSeconds = s_elapsed( t );
+            channel.Result = ( st != ERR_NOERROR ) ? st : results[channel.Channel];
+        } );
+    }
+    done.LoadSeconds = s_elapsed( phase );
+
+    /* the loaded channels must now run the kernel */
+    phase = Clock::now();
+    TFirmwareOptions_t verify( options );
+    verify.Force = false;
+    PAR_For( stale.size(), 0, [&]( size_t k ){
+        TChannelStartup_t& channel = done.Channels[stale[k]];
+        if( channel.Result != ERR_NOERROR ) return;
+        int st = eclib->BL_GetChannelInfos( id, (uint8)channel.Channel, &channel.Infos );
+        if( st != ERR_NOERROR ) channel.Result = st;
+        else if( FW_StaleReasons( channel.Infos, verify ) != FW_STALE_NONE ) channel.Result = ERR_COMM_LOADFIRMWAREFAILED;
+    } );
+    done.VerifySeconds = s_elapsed( phase );
+
+    status = ERR_NOERROR;
+    for( size_t i = 0; i < done.Channels.size(); i++ ){
+        if( done.Channels[i].Result == ERR_NOERROR ) continue;
+        if( status == ERR_NOERROR ) status = done.Channels[i].Result;
+        done.Failed++;
+    }
+    done.TotalSeconds = s_elapsed( start );
+    if( report ) *report = done;
+    return status;
+}
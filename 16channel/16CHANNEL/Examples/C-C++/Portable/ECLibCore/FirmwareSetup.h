@@ -0,0 +1,92 @@
+#pragma once
+
+#ifndef _FIRMWARESETUP_H_
+#define _FIRMWARESETUP_H_
+
+#include <vector>
+
+#include "BLFunctionTable.h"
+
+/*
+ * Firmware of the channels at startup
+ *
+ * The MFC sample calls BL_LoadFirmware on every plugged channel, with the gauge,
+ * and reloads everything when "force reload" is checked. Here the firmware of all
+ * the channels is read first (BL_GetChannelInfos, from several threads); only the
+ * channels whose firmware is not the kernel of the library, or not the expected
+ * version, are loaded, without gauge. The time of each phase and of each channel
+ * is reported.
+ */
+
+/**
+ * \defgroup firmware_setup Firmware setup
+ * @{
+ */
+
+/** Why the firmware of a channel is loaded (bits) */
+typedef enum {
+    FW_STALE_NONE     = 0,
+    FW_STALE_CODE     = (1 << 0), /*!< no firmware, or not the one of the library (EC-Lab, calibration, ...) */
+    FW_STALE_VERSION  = (1 << 1), /*!< kernel of another version */
+    FW_STALE_XILINX   = (1 << 2), /*!< Xilinx firmware of another version */
+    FW_STALE_INFOS    = (1 << 3), /*!< BL_GetChannelInfos failed */
+    FW_STALE_FORCED   = (1 << 4)  /*!< reload asked */
+} TFirmwareStale_e;
+
+/** How to set up the firmware */
+typedef struct {
+    int         FirmwareVersion; /*!< expected kernel version, 0 for any version */
+    int         XilinxVersion;   /*!< expected Xilinx version, 0 for any version */
+    bool        Force;           /*!< load every plugged channel, as ForceReload */
+    int         Threads;         /*!< 0: one BL_LoadFirmware call for all the stale channels,
+                                      N: one call per channel from N threads */
+    const char* BinFile;         /*!< kernel file (kernel.bin / kernel4.bin), 0 for the default file */
+    const char* XlxFile;         /*!< Xilinx file (.xlx), 0 for the default file */
+} TFirmwareOptions_t;
+
+/** Startup of a channel */
+typedef struct {
+    int             Channel;
+    int             Stale;        /*!< see \ref TFirmwareStale_e */
+    int             Result;       /*!< result of the load, \ref ERR_NOERROR if not loaded */
+    double          InfoSeconds;  /*!< BL_GetChannelInfos */
+    double          LoadSeconds;  /*!< BL_LoadFirmware (the whole call when the channels are loaded at once) */
+    TChannelInfos_t Infos;        /*!< after the startup */
+} TChannelStartup_t;
+
+/** Startup of a device, by phase */
+typedef struct {
+    int                            Plugged;
+    int                            Stale;
+    int                            Failed;
+    double                         PluggedSeconds; /*!< BL_GetChannelsPlugged */
+    double                         InfosSeconds;   /*!< firmware of all the channels read */
+    double                         LoadSeconds;    /*!< firmware loaded on the stale channels */
+    double                         VerifySeconds;  /*!< firmware of the loaded channels read again */
+    double                         TotalSeconds;
+    std::vector<TChannelStartup_t> Channels;       /*!< plugged channels */
+} TFirmwareReport_t;
+
+/** Default options: any version, no forced reload, one BL_LoadFirmware call, default files */
+TFirmwareOptions_t FW_DefaultOptions();
+
+/** Reasons (see \ref TFirmwareStale_e) to load the firmware of a channel whose information was read */
+int FW_StaleReasons( const TChannelInfos_t& infos, const TFirmwareOptions_t& options );
+
+/**
+ * This function makes the plugged channels of a device ready for the library,
+ * loading the firmware only where needed.
+ *
+ * @param eclib ECLib functions: BL_GetChannelsPlugged, BL_GetChannelInfos and BL_LoadFirmware
+ * @param id device identifier
+ * @param options see \ref TFirmwareOptions_t
+ * @param report optional report of the startup
+ * @return \ref ERR_NOERROR if every plugged channel runs the firmware of the library,
+ *         \ref ERR_GEN_INVALIDPARAMETERS if a function is missing, \ref ERR_GEN_NOCHANNELELECTED
+ *         if no channel is plugged, otherwise the first error of a channel.
+ */
+int FW_SetupChannels( const TEClibFunctions* eclib, int id, const TFirmwareOptions_t& options, TFirmwareReport_t* report );
+
+/** @} */
+
+#endif /* _FIRMWARESETUP_H_ */
@@ -0,0 +1,111 @@
+#include "Histogram.h"
+
+#define HIST_LINEAR   (64)  /* values with their own bucket */
+#define HIST_SUB_BITS (5)   /* significant bits of the other values */
+
+static int s_bucket( unsigned long long v ){
+    if( v < HIST_LINEAR ) return (int)v;
+    int e = 0;   /* highest bit set, found in 6 steps */
+    for( int step = 32; step; step >>= 1 ) if( v >> ( e + step ) ) e += step;
+    int shift = e - HIST_SUB_BITS;
+    return HIST_LINEAR + ( e - 6 ) * ( 1 << HIST_SUB_BITS ) + (int)( ( v >> shift ) - ( 1u << HIST_SUB_BITS ) );
+}
+
+/* highest value counted in a bucket */
+static unsigned long long s_highest( int b ){
+    if( b < HIST_LINEAR ) return (unsigned long long)b;
+    int e     = 6 + ( b - HIST_LINEAR ) / ( 1 << HIST_SUB_BITS );
+    int sub   = ( 1 << HIST_SUB_BITS ) + ( b - HIST_LINEAR ) % ( 1 << HIST_SUB_BITS );
+    int shift = e - HIST_SUB_BITS;
+    return ( (unsigned long long)( sub + 1 ) << shift ) - 1;
+}
+
+LatencyHistogram::LatencyHistogram()
+    : counts( HIST_NB_BUCKETS, 0 )
+{
+    reset();
+}
+
+void LatencyHistogram::record( unsigned long long ns )
+{
+    counts[s_bucket( ns )]++;
+    if( total == 0 || ns < lowest ) lowest = ns;
+    if( ns > highest ) highest = ns;
+    sum += (double)ns;
+    total++;
+}
+
+void LatencyHistogram::recordSeconds( double seconds )
+{
+    record( seconds > 0.0 ? (unsigned long long)( seconds * 1e9 + 0.5 ) : 0 );
+}
+
+void LatencyHistogram::merge( const LatencyHistogram& other )
+{
+    if( other.total == 0 ) return;
+    for( int b = 0; b < HIST_NB_BUCKETS; b++ ) counts[b] += other.counts[b];
+    if( total == 0 || other.lowest < lowest ) lowest = other.lowest;
+    if( other.highest > highest ) highest = other.highest;
+    sum   += other.sum;
+    total += other.total;
+}
+
+void LatencyHistogram::mergeCounts( const unsigned long long* other, unsigned long long lowestNs, unsigned long long highestNs, double sumNs )
+{
+    unsigned long long n = 0;
+    for( int b = 0; b < HIST_NB_BUCKETS; b++ ){
+        counts[b] += other[b];
+        n         += other[b];
+    }
+    if( n == 0 ) return;
+    if( total == 0 || lowestNs < lowest ) lowest = lowestNs;
+    if( highestNs > highest ) highest = highestNs;
+    sum   += sumNs;
+    total += n;
+}
+
+int LatencyHistogram::bucket( unsigned long long ns )
+{
+    return s_bucket( ns );
+}
+
+void LatencyHistogram::reset()
+{
+    for( int b = 0; b < HIST_NB_BUCKETS; b++ ) counts[b] = 0;
+    total   = 0;
+    lowest  = 0;
+    highest = 0;
+    sum     = 0.0;
+}
+
+unsigned long long LatencyHistogram::percentile( double percent ) const
+{
+    if( total == 0 ) return 0;
+    if( percent < 0.0 ) percent = 0.0;
+    if( percent > 100.0 ) percent = 100.0;
+    unsigned long long rank = (unsigned long long)( percent / 100.0 * total + 0.5 );
+    if( rank == 0 ) rank = 1;
+    unsigned long long seen = 0;
+    for( int b = 0; b < HIST_NB_BUCKETS; b++ ){
+        seen += counts[b];
+        if( seen >= rank ){
+            unsigned long long v = s_highest( b );
+            return v < highest ? ( v > lowest ? v : lowest ) : highest;
+        }
+    }
+    return highest;
+}
+
+THistSummary_t LatencyHistogram::summary() const
+{
+    THistSummary_t s;
+    s.Count = total;
+    s.Min   = min();
+    s.P50   = percentile( 50.0 );
+    s.P90   = percentile( 90.0 );
+    s.P99   = percentile( 99.0 );
+    s.P999  = percentile( 99.9 );
+    s.Max   = highest;
+    s.Mean  = mean();
+    return s;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#ifndef _HISTOGRAM_H_
+#define _HISTOGRAM_H_
+
+#include <vector>
+
+/*
+ * Latency histograms
+ *
+ * The values (ns) are counted in buckets whose width grows with the value: the
+ * values below 64 ns have their own bucket, the next ones are counted with 5
+ * significant bits, so that a percentile is known within 1/32 (3 %) whatever the
+ * value, from nanoseconds to hours, in a fixed table of 1920 counters. Recording a
+ * value is a few instructions and allocates nothing.
+ */
+
+/**
+ * \defgroup histograms Latency histograms
+ * @{
+ */
+
+/** Number of buckets of a \ref LatencyHistogram */
+#define HIST_NB_BUCKETS (64 + 58 * 32)
+
+/** Main values of a \ref LatencyHistogram (ns) */
+typedef struct {
+    unsigned long long Count;
+    unsigned long long Min;
+    unsigned long long P50;
+    unsigned long long P90;
+    unsigned long long P99;
+    unsigned long long P999;
+    unsigned long long Max;
+    double             Mean;
+} THistSummary_t;
+
+/**
+ * This class counts latencies. It is not thread safe: each thread records in its
+ * own histogram, or the callers share one under a lock; histograms are merged.
+ */
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void record( unsigned long long ns );
+
+    /** Records a time given in seconds (negative times are recorded as 0) */
+    void recordSeconds( double seconds );
+
+    /** Adds the values of another histogram */
+    void merge( const LatencyHistogram& other );
+
+    /**
+     * Adds values counted elsewhere in the buckets of \ref bucket (lock-free
+     * recorders keep their own counters and merge them to read them).
+     * @param other \ref HIST_NB_BUCKETS counters
+     */
+    void mergeCounts( const unsigned long long* other, unsigned long long lowestNs, unsigned long long highestNs, double sumNs );
+
+    void reset();
+
+    /** Bucket in which a value (ns) is counted, from 0 to \ref HIST_NB_BUCKETS - 1 */
+    static int bucket( unsigned long long ns );
+
+    unsigned long long count() const { return total; }
+    unsigned long long min() const { return total ? lowest : 0; }
+    unsigned long long max() const { return highest; }
+    double             mean() const { return total ? sum / total : 0.0; }
+
+    /**
+     * Value below which a percentage of the values are (ns): the highest value of
+     * the bucket holding it, never more than \ref max.
+     * @param percent percentage, from 0 to 100
+     */
+    unsigned long long percentile( double percent ) const;
+
+    THistSummary_t summary() const;
+
+private:
+    std::vector<unsigned long long> counts;
+    unsigned long long              total;
+    unsigned long long              lowest;
+    unsigned long long              highest;
+    double                          sum;
+};
+
+/** @} */
+
+#endif /* _HISTOGRAM_H_ */
@@ -0,0 +1,1048 @@
+#include "InstrumentSim.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "BLDecode.h"
+#include "EccBuilder.h"
+
+typedef std::chrono::steady_clock Clock;
+
+#define SIM_NB_CHANNELS     (16)
+#define SIM_LIB_VERSION     "6.05 (simulator)"
+#define SIM_FIRMWARE        (604)
+#define SIM_XILINX          (100)
+
+/* the cell of every channel: E0, then Rs in series with Rct // Cdl */
+#define SIM_RS              (50.0)     /* Ohm */
+#define SIM_RCT             (1000.0)   /* Ohm */
+#define SIM_CDL             (1e-3)     /* F */
+#define SIM_E_NOISE         (100e-6)   /* V */
+#define SIM_I_NOISE         (20e-9)    /* A */
+
+/* extra values the simulator records, in the order of their bits */
+#define SIM_XREC            ( XREC_CE | XREC_AUX1 | XREC_AUX2 | XREC_CTL | XREC_Q | XREC_IRG )
+
+/* a technique loaded on a channel */
+typedef struct {
+    int                      TechniqueID;
+    std::vector<TEccParam_t> Params;
+} TSimTechnique_t;
+
+/* a part of a technique where the control (E or I) goes linearly from a value to another */
+typedef struct {
+    double Duration;
+    double From;
+    double To;
+    int    Cycle;
+} TSimSegment_t;
+
+/* points of the memory of a channel, at most one data buffer, as BL_GetData returns them */
+typedef struct {
+    TDataInfos_t              Infos;
+    std::vector<unsigned int> Words;
+} TSimBlock_t;
+
+typedef struct {
+    int                          Firmware;
+    THardwareConf_t              HardConf;
+    TExperimentInfos_t           Experiment;
+    std::vector<TSimTechnique_t> Chain;
+    std::vector<int>             LoopsDone;  /* times each loop technique went back */
+    int                          State;
+    bool                         Done;       /* the chain ended; STOP once the memory is read */
+    double                       Origin;     /* time of the simulation when the channel started */
+    double                       Elapsed;    /* simulated since (s) */
+    size_t                       Tech;       /* technique running */
+    int                          Loop;
+    double                       TechStart;  /* Elapsed when it began */
+    double                       TechEnd;
+    std::vector<TSimSegment_t>   Segments;
+    size_t                       Seg;
+    double                       SegStart;   /* from TechStart */
+    double                       Interval;   /* between two points */
+    double                       Next;       /* Elapsed of the next point */
+    double                       StartEwe;   /* when the technique began, for vs_initial */
+    double                       StartI;
+    int                          Xrec;       /* extra values of the technique ("xctr") */
+    double                       Charge;     /* since the technique began (C) */
+    double                       ModelTime;  /* Elapsed of the cell values below */
+    double                       E0, Eta, Ewe, I, Control;
+    unsigned int                 Noise;
+    std::deque<TSimBlock_t>      Memory;
+    int                          MemFilled;
+    int                          Skipped;
+} TSimChannel_t;
+
+typedef struct {
+    std::string   Address;
+    TSimChannel_t Channels[SIM_NB_CHANNELS];
+} TSimDevice_t;
+
+static std::mutex                s_lock;
+static TSimConfig_t              s_config = SIM_DefaultConfig();
+static std::deque<TSimDevice_t>  s_devices;
+static std::vector<int>          s_connections;  /* device of each identifier, -1 once closed */
+static Clock::time_point         s_origin = Clock::now();
+static double                    s_clock;        /* with Speed 0 */
+static std::atomic<int>          s_call_us( 0 );
+
+/////////////////////////////////////////////////////////////////////////////
+// configuration and clock
+
+TSimConfig_t SIM_DefaultConfig()
+{
+    TSimConfig_t config;
+    config.Channels   = SIM_NB_CHANNELS;
+    config.DeviceCode = KBIO_DEV_VMP3;
+    config.UsbDevices = 1;
+    config.Speed      = 1.0;
+    config.Step       = 0.01;
+    config.MaxRate    = 50000.0;
+    config.MemSize    = SIM_MEMSIZE;
+    config.CallMs     = 0.0;
+    config.Seed       = 1;
+    config.Firmware   = true;
+    return config;
+}
+
+TSimConfig_t SIM_ConfigFromEnvironment()
+{
+    TSimConfig_t config = SIM_DefaultConfig();
+    const char* value;
+    if( ( value = getenv( "ECLIBSIM_CHANNELS" ) ) )  config.Channels   = atoi( value );
+    if( ( value = getenv( "ECLIBSIM_DEVICE" ) ) )    config.DeviceCode = atoi( value );
+    if( ( value = getenv( "ECLIBSIM_USB" ) ) )       config.UsbDevices = atoi( value );
+    if( ( value = getenv( "ECLIBSIM_SPEED" ) ) )     config.Speed      = atof( value );
+    if( ( value = getenv( "ECLIBSIM_STEP" ) ) )      config.Step       = atof( value );
+    if( ( value = getenv( "ECLIBSIM_RATE" ) ) )      config.MaxRate    = atof( value );
+    if( ( value = getenv( "ECLIBSIM_MEMORY" ) ) )    config.MemSize    = atoi( value );
+    if( ( value = getenv( "ECLIBSIM_CALL_MS" ) ) )   config.CallMs     = atof( value );
+    if( ( value = getenv( "ECLIBSIM_SEED" ) ) )      config.Seed       = (unsigned int)strtoul( value, 0, 10 );
+    if( ( value = getenv( "ECLIBSIM_FIRMWARE" ) ) )  config.Firmware   = atoi( value ) != 0;
+    if( ( value = getenv( "ECLIBSIM_ADDRESSES" ) ) ){
+        std::string address;
+        for( const char* p = value; ; p++ ){
+            if( *p == ',' || *p == '\0' ){
+                if( !address.empty() ) config.Addresses.push_back( address );
+                address.clear();
+                if( *p == '\0' ) break;
+            } else if( !isspace( (unsigned char)*p ) ){
+                address += *p;
+            }
+        }
+    }
+    return config;
+}
+
+static double s_now(){
+    if( s_config.Speed > 0.0 ) return s_config.Speed * std::chrono::duration<double>( Clock::now() - s_origin ).count();
+    return s_clock;
+}
+
+int SIM_Configure( const TSimConfig_t& config )
+{
+    if( config.Channels < 1 || config.Channels > SIM_NB_CHANNELS || config.UsbDevices < 0 || config.Speed < 0.0 ||
+        config.Step < 0.0 || config.MaxRate <= 0.0 || config.MemSize < 1000 * 4 || config.CallMs < 0.0 ){
+        return ERR_GEN_INVALIDPARAMETERS;
+    }
+    std::lock_guard<std::mutex> guard( s_lock );
+    s_config = config;
+    s_devices.clear();
+    s_connections.clear();
+    s_origin = Clock::now();
+    s_clock  = 0.0;
+    s_call_us = (int)( config.CallMs * 1e3 );
+    return ERR_NOERROR;
+}
+
+void SIM_Advance( double seconds )
+{
+    std::lock_guard<std::mutex> guard( s_lock );
+    if( seconds > 0.0 ) s_clock += seconds;
+}
+
+double SIM_Now()
+{
+    std::lock_guard<std::mutex> guard( s_lock );
+    return s_now();
+}
+
+/* time each function of the device takes, outside of the lock */
+static void s_call(){
+    int us = s_call_us;
+    if( us > 0 ) std::this_thread::sleep_for( std::chrono::microseconds( us ) );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// parameters of the techniques
+
+static const TEccParam_t* s_param( const TSimTechnique_t& tech, const char* label, int index ){
+    const TEccParam_t* found = 0;
+    for( size_t i = 0; i < tech.Params.size(); i++ ){
+        if( tech.Params[i].ParamIndex == index && strcmp( tech.Params[i].ParamStr, label ) == 0 ) found = &tech.Params[i];
+    }
+    return found;
+}
+
+static double s_sgl( const TSimTechnique_t& tech, const char* label, int index, double value ){
+    const TEccParam_t* param = s_param( tech, label, index );
+    if( !param ) return value;
+    return ( param->ParamType == PARAM_SINGLE ) ? ECC_SglValue( *param ) : param->ParamVal;
+}
+
+static int s_int( const TSimTechnique_t& tech, const char* label, int index, int value ){
+    const TEccParam_t* param = s_param( tech, label, index );
+    return param ? param->ParamVal : value;
+}
+
+/* technique of a .ecc file: "C:\...\ca.ecc", "cv4.ecc", "TO.ecc", ... */
+static int s_techniqueOf( const char* file ){
+    static const char* names[] = { "ocv", "ca", "cp", "cv", "loop", "trigger_out", "trigger_in", "trigger_set" };
+    if( !file ) return KBIO_TECHID_NONE;
+    const char* base = file;
+    for( const char* p = file; *p; p++ ){
+        if( *p == '/' || *p == '\\' ) base = p + 1;
+    }
+    std::string name;
+    for( const char* p = base; *p && *p != '.'; p++ ) name += (char)tolower( (unsigned char)*p );
+    if( !name.empty() && name[name.size() - 1] == '4' ) name.erase( name.size() - 1 );
+    for( size_t i = 0; i < sizeof(names)/sizeof(names[0]); i++ ){
+        const TEccSchema_t* schema = ECC_FindSchema( names[i] );
+        std::string ecc_base;
+        for( const char* p = schema->EccBase; *p; p++ ) ecc_base += (char)tolower( (unsigned char)*p );
+        if( name == ecc_base ) return schema->TechniqueID;
+    }
+    return KBIO_TECHID_NONE;
+}
+
+/*
+ * The control of a technique, part by part: the rest of OCV, the steps of CA
+ * (E) and CP (I) cycle after cycle, the scans of CV (E). 'ewe' and 'i' are the
+ * values when the technique begins, for vs_initial.
+ */
+static void s_segments( const TSimTechnique_t& tech, double ewe, double i, std::vector<TSimSegment_t>* segments ){
+    segments->clear();
+    TSimSegment_t seg = { 0.0, 0.0, 0.0, 0 };
+    switch( tech.TechniqueID ){
+    case KBIO_TECHID_OCV:
+        seg.Duration = s_sgl( tech, "Rest_time_T", 0, 10.0 );
+        segments->push_back( seg );
+        break;
+    case KBIO_TECHID_CA:
+    case KBIO_TECHID_CP: {
+        bool ca = ( tech.TechniqueID == KBIO_TECHID_CA );
+        int steps = s_int( tech, "Step_number", 0, 0 );
+        if( steps < 0 ) steps = 0;
+        if( steps >= ECC_MAX_STEPS ) steps = ECC_MAX_STEPS - 1;
+        int cycles = s_int( tech, "N_Cycles", 0, 0 );
+        for( int c = 0; c <= cycles; c++ ){
+            for( int k = 0; k <= steps; k++ ){
+                double value = s_sgl( tech, ca ? "Voltage_step" : "Current_step", k, 0.0 );
+                if( s_int( tech, "vs_initial", k, 0 ) ) value += ca ? ewe : i;
+                seg.Duration = s_sgl( tech, "Duration_step", k, 1.0 );
+                seg.From = seg.To = value;
+                seg.Cycle = c;
+                segments->push_back( seg );
+            }
+        }
+        break;
+    }
+    case KBIO_TECHID_CV: {
+        double v[ECC_CV_VERTICES], rate[ECC_CV_VERTICES];
+        for( int k = 0; k < ECC_CV_VERTICES; k++ ){
+            v[k] = s_sgl( tech, "Voltage_step", k, 0.0 ) + ( s_int( tech, "vs_initial", k, 0 ) ? ewe : 0.0 );
+            rate[k] = fabs( s_sgl( tech, "Scan_Rate", k, 10.0 ) ) * 1e-3;   /* mV/s */
+            if( rate[k] <= 0.0 ) rate[k] = 10e-3;
+        }
+        /* Ei to E1, E1 to E2 and back as many cycles as asked, then to Ei and Ef */
+        int path[4 + 2 * 64 + 2];
+        int cycle_of[4 + 2 * 64 + 2];
+        int n = 0;
+        int cycles = s_int( tech, "N_Cycles", 0, 0 );
+        if( cycles < 0 ) cycles = 0;
+        if( cycles > 63 ) cycles = 63;
+        path[n] = 0; cycle_of[n++] = 0;
+        path[n] = 1; cycle_of[n++] = 0;
+        path[n] = 2; cycle_of[n++] = 0;
+        for( int c = 1; c <= cycles; c++ ){
+            path[n] = 1; cycle_of[n++] = c;
+            path[n] = 2; cycle_of[n++] = c;
+        }
+        path[n] = 3; cycle_of[n++] = cycles;
+        path[n] = 4; cycle_of[n++] = cycles;
+        for( int k = 1; k < n; k++ ){
+            seg.From     = v[path[k - 1]];
+            seg.To       = v[path[k]];
+            seg.Duration = fabs( seg.To - seg.From ) / rate[path[k]];
+            seg.Cycle    = cycle_of[k];
+            segments->push_back( seg );
+        }
+        break;
+    }
+    }
+}
+
+/* time between two points of a technique */
+static double s_interval( const TSimTechnique_t& tech ){
+    double interval;
+    if( tech.TechniqueID == KBIO_TECHID_CV ){
+        double rate = fabs( s_sgl( tech, "Scan_Rate", 1, 10.0 ) ) * 1e-3;
+        interval = ( rate > 0.0 ) ? s_sgl( tech, "Record_every_dE", 0, 0.001 ) / rate : 0.0;
+    } else {
+        interval = s_sgl( tech, "Record_every_dT", 0, 0.1 );
+    }
+    double shortest = 1.0 / s_config.MaxRate;
+    if( shortest < SIM_TIMEBASE ) shortest = SIM_TIMEBASE;
+    return ( interval > shortest ) ? interval : shortest;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// channels
+
+static void s_resetChannel( TSimChannel_t& ch, int device, int channel ){
+    ch.Firmware = s_config.Firmware ? KIBIO_FIRM_KERNEL : KIBIO_FIRM_NONE;
+    ch.HardConf.Conn   = KBIO_CONN_STD;
+    ch.HardConf.Ground = KBIO_MODE_GROUNDED;
+    memset( &ch.Experiment, 0, sizeof(ch.Experiment) );
+    ch.Chain.clear();
+    ch.LoopsDone.clear();
+    ch.State   = KBIO_STATE_STOP;
+    ch.Done    = true;
+    ch.Origin  = ch.Elapsed = 0.0;
+    ch.Tech    = 0;
+    ch.Loop    = 0;
+    ch.TechStart = ch.TechEnd = 0.0;
+    ch.Segments.clear();
+    ch.Seg      = 0;
+    ch.SegStart = 0.0;
+    ch.Interval = ch.Next = ch.ModelTime = 0.0;
+    ch.StartEwe = ch.StartI = 0.0;
+    ch.Xrec     = 0;
+    ch.Charge   = 0.0;
+    ch.E0      = 0.1 + 0.02 * channel;
+    ch.Eta     = 0.0;
+    ch.Ewe     = ch.E0;
+    ch.I       = 0.0;
+    ch.Control = 0.0;
+    ch.Noise   = s_config.Seed * 2654435761u + (unsigned int)( device * SIM_NB_CHANNELS + channel ) * 40503u + 1u;
+    ch.Memory.clear();
+    ch.MemFilled = 0;
+    ch.Skipped   = 0;
+}
+
+/* noise in [-amplitude, amplitude], a triangle distribution */
+static double s_noise( TSimChannel_t& ch, double amplitude ){
+    double u[2];
+    for( int k = 0; k < 2; k++ ){
+        ch.Noise ^= ch.Noise << 13;
+        ch.Noise ^= ch.Noise >> 17;
+        ch.Noise ^= ch.Noise << 5;
+        u[k] = ch.Noise / 4294967296.0;
+    }
+    return ( u[0] + u[1] - 1.0 ) * amplitude;
+}
+
+static unsigned int s_bits( double value ){
+    float sgl = (float)value;
+    unsigned int bits;
+    memcpy( &bits, &sgl, sizeof(bits) );
+    return bits;
+}
+
+static int s_columns( int technique_id ){
+    switch( technique_id ){
+    case KBIO_TECHID_OCV: return ECC_IsVmp4( s_config.DeviceCode ) ? 3 : 4;
+    case KBIO_TECHID_CA:
+    case KBIO_TECHID_CP:  return 5;
+    case KBIO_TECHID_CV:  return 6;
+    }
+    return 0;
+}
+
+/* words of a point of the technique running, the extra values included */
+static int s_rowColumns( const TSimChannel_t& ch ){
+    int cols = s_columns( ch.Chain[ch.Tech].TechniqueID );
+    for( int bit = 1; bit <= SIM_XREC; bit <<= 1 ) cols += ( ch.Xrec & bit ) ? 1 : 0;
+    return cols;
+}
+
+/*
+ * Runs the chain from the technique 'index' at the time 'at': the loops go back,
+ * the triggers and the techniques without duration pass at once. Ends the chain
+ * after the last technique, or if the loops go round without any time going by.
+ */
+static void s_enterTechnique( TSimChannel_t& ch, size_t index, double at ){
+    size_t jumps = 0;
+    while( index < ch.Chain.size() ){
+        const TSimTechnique_t& tech = ch.Chain[index];
+        if( tech.TechniqueID == KBIO_TECHID_LOOP ){
+            int times  = s_int( tech, "loop_N_times", 0, 0 );
+            int target = s_int( tech, "protocol_number", 0, 0 );
+            if( ( times < 0 || ch.LoopsDone[index] < times ) && target >= 0 && (size_t)target < index && jumps++ <= ch.Chain.size() ){
+                ch.LoopsDone[index]++;
+                for( size_t k = target; k < index; k++ ) ch.LoopsDone[k] = 0;
+                ch.Loop++;
+                index = target;
+                continue;
+            }
+            index++;
+            continue;
+        }
+        if( s_columns( tech.TechniqueID ) == 0 ){
+            index++;
+            continue;
+        }
+        ch.StartEwe = ch.Ewe;
+        ch.StartI   = ch.I;
+        s_segments( tech, ch.StartEwe, ch.StartI, &ch.Segments );
+        double duration = 0.0;
+        for( size_t k = 0; k < ch.Segments.size(); k++ ) duration += ch.Segments[k].Duration;
+        if( duration <= 0.0 ){
+            index++;
+            continue;
+        }
+        ch.Tech      = index;
+        ch.TechStart = at;
+        ch.TechEnd   = at + duration;
+        ch.Seg       = 0;
+        ch.SegStart  = 0.0;
+        ch.Interval  = s_interval( tech );
+        ch.Next      = at;
+        ch.Control   = ch.Segments[0].From;
+        ch.Xrec      = s_int( tech, "xctr", 0, 0 ) & SIM_XREC;
+        ch.Charge    = 0.0;
+        return;
+    }
+    ch.Done    = true;
+    ch.Elapsed = at;
+}
+
+/* the cell from the last point to 't', then the point in the memory */
+static void s_record( TSimChannel_t& ch, double t ){
+    const TSimTechnique_t& tech = ch.Chain[ch.Tech];
+    double u = t - ch.TechStart;
+    while( ch.Seg + 1 < ch.Segments.size() && u >= ch.SegStart + ch.Segments[ch.Seg].Duration ){
+        ch.SegStart += ch.Segments[ch.Seg].Duration;
+        ch.Seg++;
+    }
+    const TSimSegment_t& seg = ch.Segments[ch.Seg];
+    double x = ( seg.Duration > 0.0 ) ? ( u - ch.SegStart ) / seg.Duration : 1.0;
+    if( x > 1.0 ) x = 1.0;
+    ch.Control = seg.From + ( seg.To - seg.From ) * x;
+
+    double dt = t - ch.ModelTime;
+    ch.ModelTime = t;
+    switch( tech.TechniqueID ){
+    case KBIO_TECHID_OCV:
+        ch.I   = 0.0;
+        ch.Eta = ch.Eta * exp( -dt / ( SIM_RCT * SIM_CDL ) );
+        ch.Ewe = ch.E0 + ch.Eta;
+        break;
+    case KBIO_TECHID_CP:
+        ch.I   = ch.Control;
+        ch.Eta = ch.I * SIM_RCT + ( ch.Eta - ch.I * SIM_RCT ) * exp( -dt / ( SIM_RCT * SIM_CDL ) );
+        ch.Ewe = ch.E0 + ch.I * SIM_RS + ch.Eta;
+        break;
+    default: {   /* CA, CV: the potential is held, the current flows through Rs */
+        double eta_end = ( ch.Control - ch.E0 ) * SIM_RCT / ( SIM_RS + SIM_RCT );
+        double tau     = SIM_CDL * SIM_RS * SIM_RCT / ( SIM_RS + SIM_RCT );
+        ch.Eta = eta_end + ( ch.Eta - eta_end ) * exp( -dt / tau );
+        ch.I   = ( ch.Control - ch.E0 - ch.Eta ) / SIM_RS;
+        ch.Ewe = ch.Control;
+        break;
+    }
+    }
+
+    ch.Charge += ch.I * dt;
+
+    int cols  = s_rowColumns( ch );
+    int bytes = cols * (int)sizeof(unsigned int);
+    if( ch.MemFilled + bytes > s_config.MemSize ){
+        ch.Skipped++;
+        return;
+    }
+    TSimBlock_t* block = ch.Memory.empty() ? 0 : &ch.Memory.back();
+    if( !block || block->Infos.TechniqueIndex != (int)ch.Tech || block->Infos.loop != ch.Loop || block->Infos.NbCols != cols ||
+        block->Infos.StartTime != ch.TechStart || block->Infos.NbRows >= 1000 / cols ){
+        ch.Memory.push_back( TSimBlock_t() );
+        block = &ch.Memory.back();
+        memset( &block->Infos, 0, sizeof(block->Infos) );
+        block->Infos.NbCols         = cols;
+        block->Infos.TechniqueIndex = (int)ch.Tech;
+        block->Infos.TechniqueID    = tech.TechniqueID;
+        block->Infos.loop           = ch.Loop;
+        block->Infos.StartTime      = ch.TechStart;
+        block->Words.reserve( ( 1000 / cols ) * cols );
+    }
+    unsigned long long t_64 = (unsigned long long)llround( u / (double)(float)SIM_TIMEBASE );
+    double ewe = ch.Ewe + s_noise( ch, SIM_E_NOISE );
+    double i   = ch.I + s_noise( ch, SIM_I_NOISE );
+    std::vector<unsigned int>& w = block->Words;
+    w.push_back( (unsigned int)( t_64 >> 32 ) );
+    w.push_back( (unsigned int)( t_64 & 0xFFFFFFFFu ) );
+    switch( tech.TechniqueID ){
+    case KBIO_TECHID_OCV:
+        w.push_back( s_bits( ewe ) );
+        if( cols == 4 ) w.push_back( s_bits( s_noise( ch, SIM_E_NOISE ) ) );
+        break;
+    case KBIO_TECHID_CA:
+    case KBIO_TECHID_CP:
+        w.push_back( s_bits( ewe ) );
+        w.push_back( s_bits( i ) );
+        w.push_back( (unsigned int)seg.Cycle );
+        break;
+    case KBIO_TECHID_CV:
+        w.push_back( s_bits( ch.Control ) );
+        w.push_back( s_bits( i ) );
+        w.push_back( s_bits( ewe ) );
+        w.push_back( (unsigned int)seg.Cycle );
+        break;
+    }
+    if( ch.Xrec & XREC_CE )   w.push_back( s_bits( -0.5 * ewe ) );
+    if( ch.Xrec & XREC_AUX1 ) w.push_back( s_bits( s_noise( ch, SIM_E_NOISE ) ) );
+    if( ch.Xrec & XREC_AUX2 ) w.push_back( s_bits( s_noise( ch, SIM_E_NOISE ) ) );
+    if( ch.Xrec & XREC_CTL )  w.push_back( s_bits( ch.Control ) );
+    if( ch.Xrec & XREC_Q )    w.push_back( s_bits( ch.Charge ) );
+    if( ch.Xrec & XREC_IRG )  w.push_back( s_bits( s_int( tech, "I_Range", 0, KBIO_IRANGE_10mA ) ) );
+    block->Infos.NbRows++;
+    ch.MemFilled += bytes;
+}
+
+/* the points of a running channel up to the time of the simulation */
+static void s_simulate( TSimChannel_t& ch ){
+    if( ch.State == KBIO_STATE_RUN && !ch.Done ){
+        double target = s_now() - ch.Origin;
+        while( !ch.Done ){
+            if( ch.Next < ch.TechEnd ){
+                if( ch.Next > target ) break;
+                s_record( ch, ch.Next );
+                ch.Next += ch.Interval;
+                continue;
+            }
+            if( ch.TechEnd > target ) break;
+            s_enterTechnique( ch, ch.Tech + 1, ch.TechEnd );
+        }
+        if( !ch.Done ) ch.Elapsed = target;
+    }
+    if( ch.State == KBIO_STATE_RUN && ch.Done && ch.Memory.empty() ) ch.State = KBIO_STATE_STOP;
+}
+
+static int s_channel( int ID, uint8 channel, TSimChannel_t** ch ){
+    if( ID < 0 || ID >= (int)s_connections.size() || s_connections[ID] < 0 ) return ERR_GEN_NOTCONNECTED;
+    if( channel >= s_config.Channels ) return ERR_GEN_CHANNELNOTPLUGGED;
+    *ch = &s_devices[s_connections[ID]].Channels[channel];
+    return ERR_NOERROR;
+}
+
+/* same as s_channel, for the functions which need the kernel firmware */
+static int s_kernelChannel( int ID, uint8 channel, TSimChannel_t** ch ){
+    int status = s_channel( ID, channel, ch );
+    if( status == ERR_NOERROR && (*ch)->Firmware != KIBIO_FIRM_KERNEL ) status = ERR_FIRM_FIRMWARENOTLOADED;
+    return status;
+}
+
+static void s_currentValues( const TSimChannel_t& ch, TCurrentValues_t* values ){
+    memset( values, 0, sizeof(*values) );
+    values->State       = ch.State;
+    values->MemFilled   = ch.MemFilled;
+    values->TimeBase    = (float)SIM_TIMEBASE;
+    values->Ewe         = (float)ch.Ewe;
+    values->EweRangeMin = -10.0f;
+    values->EweRangeMax = 10.0f;
+    values->EceRangeMin = -10.0f;
+    values->EceRangeMax = 10.0f;
+    values->I           = (float)ch.I;
+    values->IRange      = ch.Chain.empty() ? KBIO_IRANGE_10mA : s_int( ch.Chain[ch.Tech], "I_Range", 0, KBIO_IRANGE_10mA );
+    values->ElapsedTime = (float)ch.Elapsed;
+}
+
+static void s_copyText( const char* text, char* buf, unsigned int* size ){
+    if( !size ) return;
+    size_t len = strlen( text );
+    if( buf && *size > 0 ){
+        size_t n = ( len < *size - 1 ) ? len : *size - 1;
+        memcpy( buf, text, n );
+        buf[n] = '\0';
+    }
+    *size = (unsigned int)len;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// the ECLib functions
+
+static int BL_STDCALL s_getLibVersion( char* pVersion, unsigned int* psize ){
+    if( !pVersion || !psize ) return ERR_GEN_INVALIDPARAMETERS;
+    s_copyText( SIM_LIB_VERSION, pVersion, psize );
+    return ERR_NOERROR;
+}
+
+static unsigned int BL_STDCALL s_getVolumeSerialNumber( void ){
+    return 0x51A00001u;
+}
+
+static int BL_STDCALL s_getErrorMsg( int errorcode, char* pmsg, unsigned int* psize ){
+    static const struct { int Code; const char* Text; } messages[] = {
+        { ERR_NOERROR,                 "no error" },
+        { ERR_GEN_NOTCONNECTED,        "no instrument connected" },
+        { ERR_GEN_CHANNELNOTPLUGGED,   "selected channel(s) unplugged" },
+        { ERR_GEN_INVALIDPARAMETERS,   "invalid function parameters" },
+        { ERR_GEN_FILENOTEXISTS,       "selected file does not exist" },
+        { ERR_GEN_FUNCTIONFAILED,      "function failed" },
+        { ERR_GEN_NOCHANNELELECTED,    "no channel selected" },
+        { ERR_GEN_DEVICE_NOTALLOWED,   "device not allowed" },
+        { ERR_GEN_CHANNEL_RUNNING,     "selected channel(s) already used" },
+        { ERR_GEN_UPDATEPARAMETERS,    "invalid update function parameters" },
+        { ERR_COMM_CONNECTIONFAILED,   "cannot establish connection with the instrument" },
+        { ERR_COMM_MAXCONNREACHED,     "maximum number of allowed connections reached" },
+        { ERR_FIRM_FIRMWARENOTLOADED,  "no firmware loaded on the selected channel(s)" },
+        { ERR_TECH_ECCFILENOTEXISTS,   "cannot find the selected ECC file" }
+    };
+    if( !pmsg || !psize ) return ERR_GEN_INVALIDPARAMETERS;
+    for( size_t i = 0; i < sizeof(messages)/sizeof(messages[0]); i++ ){
+        if( messages[i].Code == errorcode ){
+            s_copyText( messages[i].Text, pmsg, psize );
+            return ERR_NOERROR;
+        }
+    }
+    s_copyText( "unknown error", pmsg, psize );
+    return ERR_GEN_INVALIDPARAMETERS;
+}
+
+static int BL_STDCALL s_connect( const char* address, uint8, int* pID, TDeviceInfos_t* pInfos ){
+    s_call();
+    if( !address || !pID || !pInfos ) return ERR_GEN_INVALIDPARAMETERS;
+    std::lock_guard<std::mutex> guard( s_lock );
+    bool present = false;
+    if( strncmp( address, "USB", 3 ) == 0 ){
+        char* end = 0;
+        long index = strtol( address + 3, &end, 10 );
+        present = ( end != address + 3 && *end == '\0' && index >= 0 && index < s_config.UsbDevices );
+    } else {
+        for( size_t i = 0; i < s_config.Addresses.size() && !present; i++ ) present = ( s_config.Addresses[i] == address );
+    }
+    if( !present ) return ERR_COMM_CONNECTIONFAILED;
+
+    size_t device = 0;
+    while( device < s_devices.size() && s_devices[device].Address != address ) device++;
+    if( device == s_devices.size() ){
+        if( s_devices.size() >= SIM_MAX_DEVICES ) return ERR_COMM_MAXCONNREACHED;
+        s_devices.push_back( TSimDevice_t() );
+        s_devices.back().Address = address;
+        for( int ch = 0; ch < SIM_NB_CHANNELS; ch++ ) s_resetChannel( s_devices.back().Channels[ch], (int)device, ch );
+    }
+    *pID = (int)s_connections.size();
+    s_connections.push_back( (int)device );
+
+    memset( pInfos, 0, sizeof(*pInfos) );
+    pInfos->DeviceCode        = s_config.DeviceCode;
+    pInfos->RAMSize           = 64;
+    pInfos->NumberOfChannels  = s_config.Channels;
+    pInfos->NumberOfSlots     = SIM_NB_CHANNELS;
+    pInfos->FirmwareVersion   = SIM_FIRMWARE;
+    pInfos->FirmwareDate_yyyy = 2013;
+    pInfos->FirmwareDate_mm   = 1;
+    pInfos->FirmwareDate_dd   = 1;
+    pInfos->NbOfConnectedPC   = 1;
+    return ERR_NOERROR;
+}
+
+static int BL_STDCALL s_disconnect( int ID ){
+    s_call();
+    std::lock_guard<std::mutex> guard( s_lock );
+    if( ID < 0 || ID >= (int)s_connections.size() || s_connections[ID] < 0 ) return ERR_GEN_NOTCONNECTED;
+    s_connections[ID] = -1;   /* the channels go on running */
+    return ERR_NOERROR;
+}
+
+static int BL_STDCALL s_testConnection( int ID ){
+    s_call();
+    std::lock_guard<std::mutex> guard( s_lock );
+    return ( ID >= 0 && ID < (int)s_connections.size() && s_connections[ID] >= 0 ) ? ERR_NOERROR : ERR_GEN_NOTCONNECTED;
+}
+
+static int BL_STDCALL s_testCommSpeed( int ID, uint8 channel, int* spd_rcvt, int* spd_kernel ){
+    s_call();
+    if( !spd_rcvt || !spd_kernel ) return ERR_GEN_INVALIDPARAMETERS;
+    std::lock_guard<std::mutex> guard( s_lock );
+    TSimChannel_t* ch;
+    int status = s_channel( ID, channel, &ch );
+    if( status != ERR_NOERROR ) return status;
+    *spd_rcvt   = 1 + (int)s_config.CallMs;
+    *spd_kernel = 2 + 2 * (int)s_config.CallMs;
+    return ERR_NOERROR;
+}
+
+static bool BL_STDCALL s_getUSBdeviceinfos( unsigned int USBindex, char* pcompany, unsigned int* pcompanysize,
+                                            char* pdevice, unsigned int* pdevicesize, char* pSN, unsigned int* pSNsize ){
+    s_call();
+    std::lock_guard<std::mutex> guard( s_lock );
+    if( USBindex >= (unsigned int)s_config.UsbDevices ) return false;
+    char serial[32];
+    snprintf( serial, sizeof(serial), "SIM%04u", USBindex );
+    s_copyText( "Bio-Logic", pcompany, pcompanysize );
+    s_copyText( ECC_IsVmp4( s_config.DeviceCode ) ? "SP-300" : "VMP3", pdevice, pdevicesize );
+    s_copyText( serial, pSN, pSNsize );
+    return true;
+}
+
+static int BL_STDCALL s_loadFirmware( int ID, uint8* pChannels, int* pResults, uint8 Length, bool, bool, const char*, const char* ){
+    s_call();
+    if( !pChannels || !pResults ) return ERR_GEN_INVALIDPARAMETERS;
+    std::lock_guard<std::mutex> guard( s_lock );
+    int status = ERR_NOERROR;
+    for( int channel = 0; channel < Length; channel++ ){
+        if( !pChannels[channel] ) continue;
+        TSimChannel_t* ch;
+        int result = ( channel < SIM_NB_CHANNELS ) ? s_channel( ID, (uint8)channel, &ch ) : ERR_GEN_CHANNELNOTPLUGGED;
+        if( result == ERR_NOERROR && ch->State != KBIO_STATE_STOP ) result = ERR_GEN_CHANNEL_RUNNING;
+        if( result == ERR_NOERROR ){
+            ch->Firmware = KIBIO_FIRM_KERNEL;
+            ch->Chain.clear();
+        }
+        pResults[channel] = result;
+        if( status == ERR_NOERROR ) status = result;
+    }
+    return status;
+}
+
+static bool BL_STDCALL s_isChannelPlugged( int ID, uint8 channel ){
+    s_call();
+    std::lock_guard<std::mutex> guard( s_lock );
+    TSimChannel_t* ch;
+    return s_channel( ID, channel, &ch ) == ERR_NOERROR;
+}
+
+static int BL_STDCALL s_getChannelsPlugged( int ID, uint8* pChPlugged, uint8 Size ){
+    s_call();
+    if( !pChPlugged ) return ERR_GEN_INVALIDPARAMETERS;
+    std::lock_guard<std::mutex> guard( s_lock );
+    if( ID < 0 || ID >= (int)s_connections.size() || s_connections[ID] < 0 ) return ERR_GEN_NOTCONNECTED;
+    for( int channel = 0; channel < Size; channel++ ) pChPlugged[channel] = ( channel < s_config.Channels ) ? 1 : 0;
+    return ERR_NOERROR;
+}
+
+static int BL_STDCALL s_getChannelInfos( int ID, uint8 channel, TChannelInfos_t* pInfos ){
+    s_call();
+    if( !pInfos ) return ERR_GEN_INVALIDPARAMETERS;
+    std::lock_guard<std::mutex> guard( s_lock );
+    TSimChannel_t* ch;
+    int status = s_channel( ID, channel, &ch );
+    if( status != ERR_NOERROR ) return status;
+    s_simulate( *ch );
+    bool vmp4 = ECC_IsVmp4( s_config.DeviceCode );
+    memset( pInfos, 0, sizeof(*pInfos) );
+    pInfos->Channel           = channel;
+    pInfos->BoardVersion      = vmp4 ? 4 : 3;
+    pInfos->BoardSerialNumber = 1000 * ( s_connections[ID] + 1 ) + channel;
+    pInfos->FirmwareCode      = ch->Firmware;
+    pInfos->FirmwareVersion   = ( ch->Firmware == KIBIO_FIRM_KERNEL ) ? SIM_FIRMWARE : 0;
+    pInfos->XilinxVersion     = ( ch->Firmware == KIBIO_FIRM_KERNEL ) ? SIM_XILINX : 0;
+    pInfos->AmpCode           = KIBIO_AMPL_NONE;
+    pInfos->Zboard            = 1;
+    pInfos->MemSize           = s_config.MemSize;
+    pInfos->MemFilled         = ch->MemFilled;
+    pInfos->State             = ch->State;
+    pInfos->MaxIRange         = KBIO_IRANGE_1A;
+    pInfos->MinIRange         = vmp4 ? KBIO_IRANGE_100pA : KBIO_IRANGE_1nA;
+    pInfos->MaxBandwidth      = vmp4 ? KBIO_BW_9 : KBIO_BW_7;
+    pInfos->NbOfTechniques    = (int)ch->Chain.size();
+    return ERR_NOERROR;
+}
+
+static int BL_STDCALL s_getMessage( int ID, uint8 channel, char* msg, unsigned int* size ){
+    s_call();
+    if( !msg || !size ) return ERR_GEN_INVALIDPARAMETERS;
+    std::lock_guard<std::mutex> guard( s_lock );
+    TSimChannel_t* ch;
+    int status = s_channel( ID, channel, &ch );
+    if( status == ERR_NOERROR ) s_copyText( "", msg, size );
+    return status;
+}
+
+static int BL_STDCALL s_getHardConf( int ID, uint8 channel, THardwareConf_t* pHardConf ){
+    s_call();
+    if( !pHardConf ) return ERR_GEN_INVALIDPARAMETERS;
+    std::lock_guard<std::mutex> guard( s_lock );
+    TSimChannel_t* ch;
+    int status = s_channel( ID, channel, &ch );
+    if( status == ERR_NOERROR ) *pHardConf = ch->HardConf;
+    return status;
+}
+
+static int BL_STDCALL s_setHardConf( int ID, uint8 channel, THardwareConf_t HardConf ){
+    s_call();
+    std::lock_guard<std::mutex> guard( s_lock );
+    TSimChannel_t* ch;
+    int status = s_channel( ID, channel, &ch );
+    if( status == ERR_NOERROR && ch->State != KBIO_STATE_STOP ) status = ERR_GEN_CHANNEL_RUNNING;
+    if( status == ERR_NOERROR ) ch->HardConf = HardConf;
+    return status;
+}
+
+static int BL_STDCALL s_loadTechnique( int ID, uint8 channel, const char* pFName, TEccParams_t Params,
+                                       bool FirstTechnique, bool, bool ){
+    s_call();
+    if( Params.len < 0 || ( Params.len > 0 && !Params.pParams ) ) return ERR_GEN_INVALIDPARAMETERS;
+    std::lock_guard<std::mutex> guard( s_lock );
+    TSimChannel_t* ch;
+    int status = s_kernelChannel( ID, channel, &ch );
+    if( status != ERR_NOERROR ) return status;
+    s_simulate( *ch );
+    if( ch->State != KBIO_STATE_STOP ) return ERR_GEN_CHANNEL_RUNNING;
+    TSimTechnique_t tech;
+    tech.TechniqueID = s_techniqueOf( pFName );
+    if( tech.TechniqueID == KBIO_TECHID_NONE ) return ERR_TECH_ECCFILENOTEXISTS;
+    tech.Params.assign( Params.pParams, Params.pParams + Params.len );
+    if( FirstTechnique ) ch->Chain.clear();
+    ch->Chain.push_back( tech );
+    return ERR_NOERROR;
+}
+
+static int BL_STDCALL s_defineBoolParameter( const char* lbl, bool value, int index, TEccParam_t* pParam ){
+    return ECC_DefineBoolParameter( lbl, value, index, pParam );
+}
+
+static int BL_STDCALL s_defineSglParameter( const char* lbl, float value, int index, TEccParam_t* pParam ){
+    return ECC_DefineSglParameter( lbl, value, index, pParam );
+}
+
+static int BL_STDCALL s_defineIntParameter( const char* lbl, int value, int index, TEccParam_t* pParam ){
+    return ECC_DefineIntParameter( lbl, value, index, pParam );
+}
+
+/* the new values take effect at once, on the running technique too */
+static int BL_STDCALL s_updateParameters( int ID, uint8 channel, int TechIndx, TEccParams_t Params, const char* EccFileName ){
+    s_call();
+    if( Params.len < 0 || ( Params.len > 0 && !Params.pParams ) ) return ERR_GEN_INVALIDPARAMETERS;
+    std::lock_guard<std::mutex> guard( s_lock );
+    TSimChannel_t* ch;
+    int status = s_kernelChannel( ID, channel, &ch );
+    if( status != ERR_NOERROR ) return status;
+    if( TechIndx < 0 || TechIndx >= (int)ch->Chain.size() ) return ERR_GEN_UPDATEPARAMETERS;
+    TSimTechnique_t& tech = ch->Chain[TechIndx];
+    if( s_techniqueOf( EccFileName ) != tech.TechniqueID ) return ERR_GEN_UPDATEPARAMETERS;
+    for( int p = 0; p < Params.len; p++ ){
+        if( ECC_IsHardwareParam( Params.pParams[p].ParamStr ) ) return ERR_GEN_UPDATEPARAMETERS;
+    }
+
+    s_simulate( *ch );
+    for( int p = 0; p < Params.len; p++ ){
+        const TEccParam_t& param = Params.pParams[p];
+        TEccParam_t* found = const_cast<TEccParam_t*>( s_param( tech, param.ParamStr, param.ParamIndex ) );
+        if( found ) *found = param;
+        else tech.Params.push_back( param );
+    }
+    if( ch->State == KBIO_STATE_RUN && !ch->Done && ch->Tech == (size_t)TechIndx ){
+        std::vector<TSimSegment_t> segments;
+        s_segments( tech, ch->StartEwe, ch->StartI, &segments );
+        double duration = 0.0;
+        for( size_t k = 0; k < segments.size(); k++ ) duration += segments[k].Duration;
+        ch->Segments = segments;
+        ch->Seg      = 0;
+        ch->SegStart = 0.0;
+        ch->TechEnd  = ch->TechStart + duration;
+        ch->Interval = s_interval( tech );
+    }
+    return ERR_NOERROR;
+}
+
+static int s_start( int ID, uint8 channel ){
+    TSimChannel_t* ch;
+    int status = s_kernelChannel( ID, channel, &ch );
+    if( status != ERR_NOERROR ) return status;
+    s_simulate( *ch );
+    if( ch->State != KBIO_STATE_STOP ) return ERR_GEN_CHANNEL_RUNNING;
+    if( ch->Chain.empty() ) return ERR_GEN_FUNCTIONFAILED;
+    ch->Memory.clear();
+    ch->MemFilled = 0;
+    ch->Skipped   = 0;
+    ch->LoopsDone.assign( ch->Chain.size(), 0 );
+    ch->Loop      = 0;
+    ch->Origin    = s_now();
+    ch->Elapsed   = 0.0;
+    ch->ModelTime = 0.0;
+    ch->Done      = false;
+    ch->State     = KBIO_STATE_RUN;
+    s_enterTechnique( *ch, 0, 0.0 );
+    return ERR_NOERROR;
+}
+
+static int s_stop( int ID, uint8 channel ){
+    TSimChannel_t* ch;
+    int status = s_channel( ID, channel, &ch );
+    if( status != ERR_NOERROR ) return status;
+    s_simulate( *ch );
+    ch->Done  = true;
+    ch->State = KBIO_STATE_STOP;   /* the points recorded can still be read */
+    return ERR_NOERROR;
+}
+
+static int BL_STDCALL s_startChannel( int ID, uint8 channel ){
+    s_call();
+    std::lock_guard<std::mutex> guard( s_lock );
+    return s_start( ID, channel );
+}
+
+static int BL_STDCALL s_startChannels( int ID, uint8* pChannels, int* pResults, uint8 length ){
+    s_call();
+    if( !pChannels || !pResults ) return ERR_GEN_INVALIDPARAMETERS;
+    std::lock_guard<std::mutex> guard( s_lock );
+    int status = ERR_GEN_NOCHANNELELECTED;
+    for( int channel = 0; channel < length; channel++ ){
+        if( !pChannels[channel] ) continue;
+        pResults[channel] = ( channel < SIM_NB_CHANNELS ) ? s_start( ID, (uint8)channel ) : ERR_GEN_CHANNELNOTPLUGGED;
+        if( status == ERR_GEN_NOCHANNELELECTED || status == ERR_NOERROR ) status = pResults[channel];
+    }
+    return status;
+}
+
+static int BL_STDCALL s_stopChannel( int ID, uint8 channel ){
+    s_call();
+    std::lock_guard<std::mutex> guard( s_lock );
+    return s_stop( ID, channel );
+}
+
+static int BL_STDCALL s_stopChannels( int ID, uint8* pChannels, int* pResults, uint8 length ){
+    s_call();
+    if( !pChannels || !pResults ) return ERR_GEN_INVALIDPARAMETERS;
+    std::lock_guard<std::mutex> guard( s_lock );
+    int status = ERR_GEN_NOCHANNELELECTED;
+    for( int channel = 0; channel < length; channel++ ){
+        if( !pChannels[channel] ) continue;
+        pResults[channel] = ( channel < SIM_NB_CHANNELS ) ? s_stop( ID, (uint8)channel ) : ERR_GEN_CHANNELNOTPLUGGED;
+        if( status == ERR_GEN_NOCHANNELELECTED || status == ERR_NOERROR ) status = pResults[channel];
+    }
+    return status;
+}
+
+static int BL_STDCALL s_getCurrentValues( int ID, uint8 channel, TCurrentValues_t* pValues ){
+    s_call();
+    if( !pValues ) return ERR_GEN_INVALIDPARAMETERS;
+    std::lock_guard<std::mutex> guard( s_lock );
+    TSimChannel_t* ch;
+    int status = s_kernelChannel( ID, channel, &ch );
+    if( status != ERR_NOERROR ) return status;
+    s_simulate( *ch );
+    s_currentValues( *ch, pValues );
+    return ERR_NOERROR;
+}
+
+/* the oldest buffer of the memory; the dropped points are counted in IRQskipped */
+static int BL_STDCALL s_getData( int ID, uint8 channel, TDataBuffer_t* pBuf, TDataInfos_t* pInfos, TCurrentValues_t* pValues ){
+    s_call();
+    if( !pBuf || !pInfos || !pValues ) return ERR_GEN_INVALIDPARAMETERS;
+    std::lock_guard<std::mutex> guard( s_lock );
+    TSimChannel_t* ch;
+    int status = s_kernelChannel( ID, channel, &ch );
+    if( status != ERR_NOERROR ) return status;
+    if( s_config.Speed <= 0.0 ) s_clock += s_config.Step;
+    s_simulate( *ch );
+
+    memset( pInfos, 0, sizeof(*pInfos) );
+    if( !ch->Memory.empty() ){
+        TSimBlock_t& block = ch->Memory.front();
+        memcpy( pBuf->data, &block.Words[0], block.Words.size() * sizeof(unsigned int) );
+        *pInfos = block.Infos;
+        ch->MemFilled -= (int)( block.Words.size() * sizeof(unsigned int) );
+        ch->Memory.pop_front();
+    } else if( !ch->Chain.empty() ){
+        pInfos->TechniqueIndex = (int)ch->Tech;
+        pInfos->TechniqueID    = ch->Chain[ch->Tech].TechniqueID;
+        pInfos->NbCols         = s_rowColumns( *ch );
+        pInfos->loop           = ch->Loop;
+        pInfos->StartTime      = ch->TechStart;
+    }
+    pInfos->IRQskipped = ch->Skipped;
+    ch->Skipped = 0;
+    if( ch->State == KBIO_STATE_RUN && ch->Done && ch->Memory.empty() ) ch->State = KBIO_STATE_STOP;
+    s_currentValues( *ch, pValues );
+    return ERR_NOERROR;
+}
+
+static int BL_STDCALL s_getFCTData( int, uint8, TDataBuffer_t*, TDataInfos_t*, TCurrentValues_t* ){
+    s_call();
+    return ERR_GEN_DEVICE_NOTALLOWED;
+}
+
+static int BL_STDCALL s_convertNumericIntoSingle( unsigned int num, float* psgl ){
+    if( !psgl ) return ERR_GEN_INVALIDPARAMETERS;
+    memcpy( psgl, &num, sizeof(float) );
+    return ERR_NOERROR;
+}
+
+static int BL_STDCALL s_setExperimentInfos( int ID, uint8 channel, TExperimentInfos_t TExpInfos ){
+    s_call();
+    std::lock_guard<std::mutex> guard( s_lock );
+    TSimChannel_t* ch;
+    int status = s_channel( ID, channel, &ch );
+    if( status == ERR_NOERROR ) ch->Experiment = TExpInfos;
+    return status;
+}
+
+static int BL_STDCALL s_getExperimentInfos( int ID, uint8 channel, TExperimentInfos_t* TExpInfos ){
+    s_call();
+    if( !TExpInfos ) return ERR_GEN_INVALIDPARAMETERS;
+    std::lock_guard<std::mutex> guard( s_lock );
+    TSimChannel_t* ch;
+    int status = s_channel( ID, channel, &ch );
+    if( status == ERR_NOERROR ) *TExpInfos = ch->Experiment;
+    return status;
+}
+
+static int BL_STDCALL s_sendMsg( int, uint8, void*, unsigned int* ){
+    s_call();
+    return ERR_GEN_DEVICE_NOTALLOWED;
+}
+
+static int BL_STDCALL s_loadFlash( int ID, const char*, bool ){
+    s_call();
+    std::lock_guard<std::mutex> guard( s_lock );
+    return ( ID >= 0 && ID < (int)s_connections.size() && s_connections[ID] >= 0 ) ? ERR_NOERROR : ERR_GEN_NOTCONNECTED;
+}
+
+int SIM_FillFunctionTable( TEClibFunctions* eclib )
+{
+    if( !eclib ) return ERR_GEN_INVALIDPARAMETERS;
+    memset( eclib, 0, sizeof(*eclib) );
+    eclib->BL_GetLibVersion            = s_getLibVersion;
+    eclib->BL_GetVolumeSerialNumber    = s_getVolumeSerialNumber;
+    eclib->BL_GetErrorMsg              = s_getErrorMsg;
+    eclib->BL_Connect                  = s_connect;
+    eclib->BL_Disconnect               = s_disconnect;
+    eclib->BL_TestConnection           = s_testConnection;
+    eclib->BL_TestCommSpeed            = s_testCommSpeed;
+    eclib->BL_GetUSBdeviceinfos        = s_getUSBdeviceinfos;
+    eclib->BL_LoadFirmware             = s_loadFirmware;
+    eclib->BL_IsChannelPlugged         = s_isChannelPlugged;
+    eclib->BL_GetChannelsPlugged       = s_getChannelsPlugged;
+    eclib->BL_GetChannelInfos          = s_getChannelInfos;
+    eclib->BL_GetMessage               = s_getMessage;
+    eclib->BL_GetHardConf              = s_getHardConf;
+    eclib->BL_SetHardConf              = s_setHardConf;
+    eclib->BL_LoadTechnique            = s_loadTechnique;
+    eclib->BL_DefineBoolParameter      = s_defineBoolParameter;
+    eclib->BL_DefineSglParameter       = s_defineSglParameter;
+    eclib->BL_DefineIntParameter       = s_defineIntParameter;
+    eclib->BL_UpdateParameters         = s_updateParameters;
+    eclib->BL_StartChannel             = s_startChannel;
+    eclib->BL_StartChannels            = s_startChannels;
+    eclib->BL_StopChannel              = s_stopChannel;
+    eclib->BL_StopChannels             = s_stopChannels;
+    eclib->BL_GetCurrentValues         = s_getCurrentValues;
+    eclib->BL_GetData                  = s_getData;
+    eclib->BL_GetFCTData               = s_getFCTData;
+    eclib->BL_ConvertNumericIntoSingle = s_convertNumericIntoSingle;
+    eclib->BL_SetExperimentInfos       = s_setExperimentInfos;
+    eclib->BL_GetExperimentInfos       = s_getExperimentInfos;
+    eclib->BL_SendMsg                  = s_sendMsg;
+    eclib->BL_LoadFlash                = s_loadFlash;
+    return ERR_NOERROR;
+}
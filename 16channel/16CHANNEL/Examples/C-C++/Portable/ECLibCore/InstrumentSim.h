@@ -0,0 +1,96 @@
+#pragma once
+
+#ifndef _INSTRUMENTSIM_H_
+#define _INSTRUMENTSIM_H_
+
+#include <string>
+#include <vector>
+
+#include "BLFunctionTable.h"
+
+/*
+ * Simulated instrument behind the ECLib functions
+ *
+ * Every function of the table is implemented, without device and without the
+ * DLL, so that the acquisition code can be run and measured anywhere: on Linux,
+ * on a build machine. The simulated devices have N channels, each with a cell
+ * (Rs in series with Rct // Cdl) on which the OCV, CA, CP and CV techniques of a
+ * chain run, loops and triggers included. The points are recorded in the memory
+ * of the channel at the Record_every_dT of the technique (Record_every_dE over the
+ * scan rate for CV), in the data formats of BL_GetData with the extra values
+ * selected by "xctr"; a full memory drops the points and counts them in
+ * IRQskipped. A channel goes back to STOP when its chain is done and its memory
+ * read, or when it is stopped.
+ *
+ * The time of the simulation is either the real time multiplied by a speed, or a
+ * clock which only moves when told to (SIM_Advance, or a step at each BL_GetData):
+ * with the latter, the points returned only depend on the calls, so a run can be
+ * measured and compared from one build to the next.
+ *
+ * The functions are given through a table (SIM_FillFunctionTable), or exported
+ * with the names of BLFunctions.h by the ECLibSim shared library (Simulator/),
+ * which takes its configuration from the environment (SIM_ConfigFromEnvironment).
+ */
+
+/**
+ * \defgroup instrument_sim Instrument simulator
+ * @{
+ */
+
+/** Largest number of simulated devices (distinct addresses) */
+#define SIM_MAX_DEVICES     (8)
+/** Default memory of a channel (bytes) */
+#define SIM_MEMSIZE         (4 * 1024 * 1024)
+/** Default time base (s) */
+#define SIM_TIMEBASE        (20e-6)
+
+/** How the simulated devices behave */
+typedef struct {
+    int                      Channels;   /*!< channels plugged on each device, 1..16 */
+    int                      DeviceCode; /*!< see \ref TDeviceType_e; a VMP4 code gives the 3 columns OCV format */
+    int                      UsbDevices; /*!< devices answering at "USB0", "USB1", ... */
+    std::vector<std::string> Addresses;  /*!< Ethernet addresses where a device answers */
+    double                   Speed;      /*!< simulated seconds per real second; 0 for the clock of \ref SIM_Advance */
+    double                   Step;       /*!< with Speed 0, seconds the clock moves at each BL_GetData */
+    double                   MaxRate;    /*!< points per second a channel records at most */
+    int                      MemSize;    /*!< memory of a channel (bytes) */
+    double                   CallMs;     /*!< time each function takes (ms of real time) */
+    unsigned int             Seed;       /*!< seed of the noise on the measures */
+    bool                     Firmware;   /*!< the channels run the kernel firmware from the start */
+} TSimConfig_t;
+
+/** Default configuration: 16 channels of a VMP3 on USB0, real time, 4 MB per channel */
+TSimConfig_t SIM_DefaultConfig();
+
+/**
+ * The default configuration changed by the environment variables:
+ * ECLIBSIM_CHANNELS, ECLIBSIM_DEVICE (device code), ECLIBSIM_USB, ECLIBSIM_ADDRESSES
+ * (comma separated), ECLIBSIM_SPEED, ECLIBSIM_STEP, ECLIBSIM_RATE, ECLIBSIM_MEMORY,
+ * ECLIBSIM_CALL_MS, ECLIBSIM_SEED and ECLIBSIM_FIRMWARE (0 or 1).
+ */
+TSimConfig_t SIM_ConfigFromEnvironment();
+
+/**
+ * This function resets the simulated devices with a new configuration: the
+ * connections are closed and the channels emptied.
+ * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_INVALIDPARAMETERS if a value is out of range.
+ */
+int SIM_Configure( const TSimConfig_t& config );
+
+/** Moves the clock of the simulation (with Speed 0) by 'seconds' */
+void SIM_Advance( double seconds );
+
+/** Time of the simulation (s since the configuration) */
+double SIM_Now();
+
+/**
+ * This function fills a function table with the simulated functions. The
+ * devices keep the configuration given last to \ref SIM_Configure, the default
+ * one if none was.
+ * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_INVALIDPARAMETERS if 'eclib' is null.
+ */
+int SIM_FillFunctionTable( TEClibFunctions* eclib );
+
+/** @} */
+
+#endif /* _INSTRUMENTSIM_H_ */
@@ -0,0 +1,232 @@
+#include "JobFile.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#include "MappedFile.h"
+
+#define JOB_MAX_CHANNELS    (16)
+
+static bool s_isBlank( char c ){
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+/* the line up to the comment, without the blanks around */
+static std::string s_trim( const char* begin, const char* end ){
+    const char* hash = (const char*)memchr( begin, '#', end - begin );
+    if( hash ) end = hash;
+    while( begin < end && s_isBlank( *begin ) ) begin++;
+    while( end > begin && s_isBlank( end[-1] ) ) end--;
+    return std::string( begin, end );
+}
+
+static bool s_parseInt( const std::string& text, int* value ){
+    char* end = 0;
+    errno = 0;
+    long v = strtol( text.c_str(), &end, 10 );
+    if( text.empty() || *end != '\0' || errno != 0 || v < -2147483647L - 1 || v > 2147483647L ) return false;
+    *value = (int)v;
+    return true;
+}
+
+static bool s_isAbsolute( const std::string& path ){
+    return ( !path.empty() && ( path[0] == '/' || path[0] == '\\' ) ) || ( path.size() > 1 && path[1] == ':' );
+}
+
+std::string JOB_CaptureName( const std::string& capture, unsigned int number )
+{
+    if( number == 0 ) return capture;
+    size_t dot   = capture.rfind( '.' );
+    size_t slash = capture.find_last_of( "/\\" );
+    if( dot == std::string::npos || ( slash != std::string::npos && dot < slash ) ) dot = capture.size();
+    char suffix[16];
+    snprintf( suffix, sizeof(suffix), "-%04u", number );
+    return capture.substr( 0, dot ) + suffix + capture.substr( dot );
+}
+
+JobFile::JobFile()
+{
+    settings.Vmp4        = false;
+    settings.RotateMB    = 0;
+    settings.ControlPort = JOB_CONTROL_PORT;
+    settings.Xrec        = 0;
+}
+
+int JobFile::fail( int code, int line, const std::string& msg )
+{
+    char where[32];
+    snprintf( where, sizeof(where), "line %d: ", line );
+    error = where + msg;
+    return code;
+}
+
+std::string JobFile::resolve( const std::string& path ) const
+{
+    if( path.empty() || folder.empty() || s_isAbsolute( path ) ) return path;
+    return folder + "/" + path;
+}
+
+int JobFile::open( const char* path )
+{
+    MappedFile file;
+    int status = file.open( path );
+    if( status != ERR_NOERROR ){
+        error = std::string( "cannot open " ) + ( path ? path : "(null)" );
+        return status;
+    }
+    std::string name( path );
+    size_t slash = name.find_last_of( "/\\" );
+    std::string dir = ( slash == std::string::npos ) ? std::string() : name.substr( 0, slash ? slash : 1 );
+    return parse( (const char*)file.data(), file.size(), dir.empty() ? 0 : dir.c_str() );
+}
+
+int JobFile::parseChannels( int line, const std::string& value )
+{
+    settings.Channels.clear();
+    size_t start = 0;
+    while( start <= value.size() ){
+        size_t comma = value.find( ',', start );
+        if( comma == std::string::npos ) comma = value.size();
+        std::string part = s_trim( value.data() + start, value.data() + comma );
+        size_t dash = part.find( '-' );
+        int first = 0, last = 0;
+        bool valid;
+        if( dash == std::string::npos ){
+            valid = s_parseInt( part, &first );
+            last  = first;
+        } else {
+            valid = s_parseInt( s_trim( part.data(), part.data() + dash ), &first ) &&
+                    s_parseInt( s_trim( part.data() + dash + 1, part.data() + part.size() ), &last );
+        }
+        if( !valid || first < 1 || last > JOB_MAX_CHANNELS || first > last ){
+            return fail( ERR_GEN_INVALIDPARAMETERS, line, "channels are 1 to 16, as a list of numbers and ranges ('1-8, 12')" );
+        }
+        for( int ch = first; ch <= last; ch++ ) settings.Channels.push_back( (uint8)( ch - 1 ) );
+        start = comma + 1;
+    }
+    std::sort( settings.Channels.begin(), settings.Channels.end() );
+    settings.Channels.erase( std::unique( settings.Channels.begin(), settings.Channels.end() ), settings.Channels.end() );
+    return ERR_NOERROR;
+}
+
+int JobFile::compile( int line, EccSequence& sequence )
+{
+    int status = sequence.compile( settings.Vmp4, settings.Chain );
+    if( status != ERR_NOERROR ) return fail( status, line, "the sequence cannot be compiled" );
+
+    /* the data of the channel are decoded with one set of extra values */
+    bool found = false;
+    for( size_t t = 0; t < settings.Chain.size(); t++ ){
+        const std::vector<TEccParam_t>& params = settings.Chain[t].Params;
+        for( size_t p = 0; p < params.size(); p++ ){
+            if( strcmp( params[p].ParamStr, "xctr" ) != 0 ) continue;
+            if( found && params[p].ParamVal != settings.Xrec ){
+                return fail( ERR_GEN_INVALIDPARAMETERS, sequence.technique( t ).Line,
+                             "the techniques of a job record the same extra values (xctr)" );
+            }
+            settings.Xrec = params[p].ParamVal;
+            found = true;
+        }
+    }
+    return ERR_NOERROR;
+}
+
+int JobFile::parse( const char* text, size_t size, const char* dir )
+{
+    TAcqJob_t empty;
+    empty.Vmp4        = false;
+    empty.RotateMB    = 0;
+    empty.ControlPort = JOB_CONTROL_PORT;
+    empty.Xrec        = 0;
+    settings = empty;
+    folder   = dir ? dir : "";
+    error.clear();
+
+    const char* end  = text ? text + size : text;
+    const char* line = text;
+    int number = 0, sequence_line = 0;
+    std::string sequence_path, inline_text;
+    bool has_device = false, has_channels = false, has_capture = false;
+    while( line < end ){
+        const char* eol = (const char*)memchr( line, '\n', end - line );
+        if( !eol ) eol = end;
+        number++;
+        std::string content = s_trim( line, eol );
+        line = ( eol < end ) ? eol + 1 : end;
+        if( content.empty() ) continue;
+
+        size_t blank = 0;
+        while( blank < content.size() && !s_isBlank( content[blank] ) ) blank++;
+        std::string key = content.substr( 0, blank );
+        std::string value = s_trim( content.data() + blank, content.data() + content.size() );
+
+        if( key == "sequence" ){
+            sequence_line = number;
+            if( !value.empty() ){
+                sequence_path = resolve( value );
+                continue;
+            }
+            /* the techniques follow, on the same lines as in the job for the errors */
+            inline_text.assign( number, '\n' );
+            inline_text.append( line, end );
+            break;
+        }
+        if( value.empty() ) return fail( ERR_GEN_INVALIDPARAMETERS, number, "'" + key + "' needs a value" );
+
+        int n = 0;
+        if( key == "device" ){
+            settings.Device = value;
+            has_device = true;
+        } else if( key == "library" ){
+            settings.Library = value;
+        } else if( key == "ecc" ){
+            settings.EccDir = resolve( value );
+        } else if( key == "vmp4" ){
+            if( value != "0" && value != "1" ) return fail( ERR_GEN_INVALIDPARAMETERS, number, "vmp4 is 0 or 1" );
+            settings.Vmp4 = ( value == "1" );
+        } else if( key == "channels" ){
+            int status = parseChannels( number, value );
+            if( status != ERR_NOERROR ) return status;
+            has_channels = true;
+        } else if( key == "capture" ){
+            settings.Capture = resolve( value );
+            has_capture = true;
+        } else if( key == "rotate" ){
+            if( !s_parseInt( value, &n ) || n < 0 || n > 1024 * 1024 ) return fail( ERR_GEN_INVALIDPARAMETERS, number, "rotate is a size in MB, 0 for one file" );
+            settings.RotateMB = (unsigned int)n;
+        } else if( key == "control" ){
+            if( value == "none" ) n = -1;
+            else if( !s_parseInt( value, &n ) || n < 0 || n > 65535 ) return fail( ERR_GEN_INVALIDPARAMETERS, number, "control is a port (0 for any free one) or 'none'" );
+            settings.ControlPort = n;
+        } else if( key == "publish" ){
+            settings.Publish = value;
+        } else {
+            return fail( ERR_GEN_INVALIDPARAMETERS, number, "unknown setting '" + key + "'" );
+        }
+    }
+
+    if( !has_device )   return fail( ERR_GEN_INVALIDPARAMETERS, number, "no device" );
+    if( !has_channels ) return fail( ERR_GEN_INVALIDPARAMETERS, number, "no channels" );
+    if( !has_capture )  return fail( ERR_GEN_INVALIDPARAMETERS, number, "no capture file" );
+    if( !sequence_line ) return fail( ERR_GEN_INVALIDPARAMETERS, number, "no sequence" );
+
+    EccSequence sequence;
+    int status;
+    if( !sequence_path.empty() ){
+        status = sequence.open( sequence_path.c_str() );
+        if( status != ERR_NOERROR ){
+            error = sequence_path + ": " + sequence.errorMessage();
+            return status;
+        }
+    } else {
+        status = sequence.parse( inline_text.data(), inline_text.size() );
+        if( status != ERR_NOERROR ){
+            error = sequence.errorMessage();
+            return status;
+        }
+    }
+    return compile( sequence_line, sequence );
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#ifndef _JOBFILE_H_
+#define _JOBFILE_H_
+
+#include <string>
+#include <vector>
+
+#include "EccParams.h"
+#include "EccSequence.h"
+
+/*
+ * Acquisition jobs (*.job)
+ *
+ * A job tells a headless acquisition what to run: the device, the channels, the
+ * chain of techniques and where the data go. It is a text file, one setting per
+ * line, '#' starts a comment; the value is the rest of the line (a path may hold
+ * spaces). The relative paths are relative to the folder of the job file.
+ *
+ *     device    USB0                  # address given to BL_Connect
+ *     library   EClib.dll             # optional, see LDR_Load
+ *     ecc       ../EC-Lab Development Package   # optional, found by ECC_FindPackageDir
+ *     vmp4      0                     # optional, .ecc files of the VMP4 technology
+ *     channels  1-8, 12               # 1-based, as in EC-Lab
+ *     capture   run.ecap              # run-0001.ecap, run-0002.ecap, ... when rotated
+ *     rotate    256                   # optional, MB of a capture file before the next one
+ *     control   9470                  # optional, port of the control socket on 127.0.0.1
+ *     publish   eclib-live            # optional, shared memory of the live data (LiveBus.h)
+ *     sequence  cycles.seq
+ *
+ * "sequence" gives a sequence file (see \ref EccSequence); alone on its line, the
+ * techniques follow it in the job itself, up to the end of the file.
+ */
+
+/**
+ * \defgroup job_file Acquisition jobs
+ * @{
+ */
+
+/** Default port of the control socket */
+#define JOB_CONTROL_PORT    (9470)
+
+/** A job, as read from its file */
+typedef struct {
+    std::string                  Device;      /*!< address given to BL_Connect */
+    std::string                  Library;     /*!< ECLib to load, empty for the default one */
+    std::string                  EccDir;      /*!< folder of the .ecc files, empty to search it */
+    bool                         Vmp4;        /*!< .ecc files of the VMP4 technology */
+    std::vector<uint8>           Channels;    /*!< 0-based, in increasing order */
+    std::string                  Capture;     /*!< capture file */
+    unsigned int                 RotateMB;    /*!< size of a capture file before the next one, 0 for one file */
+    int                          ControlPort; /*!< port of the control socket, 0 for any free one, -1 for none */
+    std::string                  Publish;     /*!< segment where the frames are published, empty for none */
+    std::vector<TEccTechnique_t> Chain;       /*!< techniques loaded on each channel */
+    int                          Xrec;        /*!< extra values recorded by the chain ("xctr") */
+} TAcqJob_t;
+
+/**
+ * This class reads a job file.
+ */
+class JobFile
+{
+public:
+    JobFile();
+
+    /**
+     * This function reads and checks a job file.
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_FILENOTEXISTS if the file or its
+     *         sequence cannot be opened, \ref ERR_GEN_INVALIDPARAMETERS if a setting or a
+     *         technique is not valid (see \ref errorMessage).
+     */
+    int open( const char* path );
+
+    /**
+     * Same as \ref open, for a job already in memory.
+     * @param folder folder of the relative paths, 0 for the current one
+     */
+    int parse( const char* text, size_t size, const char* folder = 0 );
+
+    /** Human readable description of the last error, with its line */
+    const char* errorMessage() const { return error.c_str(); }
+
+    const TAcqJob_t& job() const { return settings; }
+
+private:
+    int fail( int code, int line, const std::string& msg );
+    int parseChannels( int line, const std::string& value );
+    int compile( int line, EccSequence& sequence );
+    std::string resolve( const std::string& path ) const;
+
+    TAcqJob_t   settings;
+    std::string folder;
+    std::string error;
+};
+
+/**
+ * This function gives the name of a capture file of a job: the capture file itself
+ * for the number 0, otherwise the number before the extension (run.ecap, 3: run-0003.ecap).
+ */
+std::string JOB_CaptureName( const std::string& capture, unsigned int number );
+
+/** @} */
+
+#endif /* _JOBFILE_H_ */
@@ -0,0 +1,331 @@
+#include "Journal.h"
+
+#include <string.h>
+#include <chrono>
+#include <memory>
+
+#include "BLDecode.h"
+#include "CaptureFile.h"
+#include "FileUtils.h"
+
+static const char JNL_MAGIC[JNL_MAGIC_SIZE + 1] = "ECLIBJNL";
+
+#define JNL_FLAG_VMP4 (1 << 0)
+
+/* u8 channel, u8 flags, u16 words, i32 xrec, infos, current values */
+#define JNL_BODY_SIZE     (8 + sizeof(TDataInfos_t) + sizeof(TCurrentValues_t))
+#define JNL_MAX_WORDS     (sizeof(TDataBuffer_t) / 4)
+/* the sequence number closes the record */
+#define JNL_PAYLOAD_SIZE( words ) ( JNL_BODY_SIZE + (size_t)(words) * 4 + 8 )
+
+template<typename T>
+static T s_get( const unsigned char* p ){
+    T value;
+    memcpy( &value, p, sizeof(T) );
+    return value;
+}
+
+static void s_header( unsigned char* p ){
+    memcpy( p, JNL_MAGIC, JNL_MAGIC_SIZE );
+    unsigned int   version = JNL_VERSION;
+    unsigned short infos = (unsigned short)sizeof(TDataInfos_t);
+    unsigned short curr  = (unsigned short)sizeof(TCurrentValues_t);
+    memcpy( p + 8, &version, 4 );
+    memcpy( p + 12, &infos, 2 );
+    memcpy( p + 14, &curr, 2 );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// JournalWriter
+
+JournalWriter::JournalWriter()
+    : file( 0 )
+    , last_sequence( 0 )
+    , durable_sequence( 0 )
+    , interval_ms( JNL_GROUP_INTERVAL_MS )
+    , group_bytes( JNL_GROUP_BYTES )
+    , max_pending( JNL_MAX_PENDING )
+    , error( ERR_NOERROR )
+    , stopping( false )
+{
+    memset( &counters, 0, sizeof(counters) );
+}
+
+JournalWriter::~JournalWriter()
+{
+    close();
+}
+
+int JournalWriter::open( const char* path, bool append )
+{
+    close();
+    if( !path ) return ERR_GEN_INVALIDPARAMETERS;
+
+    last_sequence = 0;
+    long long position = 0;
+
+    FILE* existing = append ? fopen( path, "rb" ) : 0;
+    if( existing ){
+        fclose( existing );
+
+        /* keep the valid records, drop a record cut by the crash */
+        JournalReader reader;
+        int status = reader.open( path );
+        if( status != ERR_NOERROR ) return status;
+        std::unique_ptr<TJournalRecord_t> record( new TJournalRecord_t );
+        while( reader.next( *record ) ) last_sequence = record->Sequence;
+        position = reader.validSize();
+        reader.close();
+
+        file = fopen( path, "r+b" );
+        if( !file ) return ERR_GEN_FUNCTIONFAILED;
+        if( FILE_Truncate( file, position ) != ERR_NOERROR || FILE_Seek( file, position, SEEK_SET ) != 0 ){
+            fclose( file );
+            file = 0;
+            return ERR_GEN_FUNCTIONFAILED;
+        }
+    } else {
+        file = fopen( path, "wb" );
+        if( !file ) return ERR_GEN_FUNCTIONFAILED;
+        unsigned char header[JNL_FILE_HEADER_SIZE];
+        s_header( header );
+        if( fwrite( header, 1, sizeof(header), file ) != sizeof(header) || FILE_Sync( file ) != ERR_NOERROR ){
+            fclose( file );
+            file = 0;
+            return ERR_GEN_FUNCTIONFAILED;
+        }
+    }
+
+    durable_sequence = last_sequence;
+    error    = ERR_NOERROR;
+    stopping = false;
+    pending.clear();
+    memset( &counters, 0, sizeof(counters) );
+    writer = std::thread( &JournalWriter::run, this );
+    return ERR_NOERROR;
+}
+
+int JournalWriter::append( int channel, const TDataBuffer_t& buf, const TDataInfos_t& infos, const TCurrentValues_t& curr,
+                           bool vmp4, int xrec, unsigned long long* sequence )
+{
+    if( !file || channel < 0 || channel > 255 || infos.NbRows < 0 || infos.NbCols < 0
+        || (size_t)infos.NbRows * (size_t)infos.NbCols > JNL_MAX_WORDS ){
+        return ERR_GEN_INVALIDPARAMETERS;
+    }
+
+    /* the record is built and its CRC computed out of the lock; only the
+       sequence number, appended last, is added to the CRC inside */
+    unsigned short words = (unsigned short)( infos.NbRows * infos.NbCols );
+    unsigned int   payload = (unsigned int)JNL_PAYLOAD_SIZE( words );
+    unsigned char  body[JNL_BODY_SIZE];
+    body[0] = (unsigned char)channel;
+    body[1] = (unsigned char)( vmp4 ? JNL_FLAG_VMP4 : 0 );
+    memcpy( body + 2, &words, 2 );
+    memcpy( body + 4, &xrec, 4 );
+    memcpy( body + 8, &infos, sizeof(infos) );
+    memcpy( body + 8 + sizeof(infos), &curr, sizeof(curr) );
+    unsigned int crc = CRC32_Compute( body, sizeof(body) );
+    crc = CRC32_Compute( buf.data, (size_t)words * 4, crc );
+
+    size_t record = JNL_RECORD_HEADER_SIZE + payload;
+    std::unique_lock<std::mutex> guard( lock );
+    if( error != ERR_NOERROR ) return error;
+    if( !pending.empty() && pending.size() + record > max_pending ){
+        counters.Stalls++;
+        wake.notify_one();
+        written.wait( guard, [&]{ return error != ERR_NOERROR || pending.empty() || pending.size() + record <= max_pending; } );
+        if( error != ERR_NOERROR ) return error;
+    }
+
+    unsigned long long seq = ++last_sequence;
+    crc = CRC32_Compute( &seq, 8, crc );
+
+    size_t pos = pending.size();
+    pending.resize( pos + record );
+    unsigned char* p = &pending[pos];
+    memcpy( p, &payload, 4 );
+    memcpy( p + 4, &crc, 4 );
+    p += JNL_RECORD_HEADER_SIZE;
+    memcpy( p, body, sizeof(body) );
+    memcpy( p + sizeof(body), buf.data, (size_t)words * 4 );
+    memcpy( p + sizeof(body) + (size_t)words * 4, &seq, 8 );
+    counters.Records++;
+
+    if( interval_ms == 0 || pending.size() >= group_bytes ) wake.notify_one();
+    if( sequence ) *sequence = seq;
+    return ERR_NOERROR;
+}
+
+int JournalWriter::waitDurable( unsigned long long sequence )
+{
+    std::unique_lock<std::mutex> guard( lock );
+    if( !file || sequence > last_sequence ) return ERR_GEN_INVALIDPARAMETERS;   /* never appended: it would never come */
+    wake.notify_one();
+    written.wait( guard, [&]{ return error != ERR_NOERROR || durable_sequence >= sequence; } );
+    return error;
+}
+
+int JournalWriter::close()
+{
+    if( !file ) return ERR_NOERROR;
+    {
+        std::lock_guard<std::mutex> guard( lock );
+        stopping = true;
+    }
+    wake.notify_one();
+    writer.join();
+
+    int status = error;
+    if( fclose( file ) != 0 && status == ERR_NOERROR ) status = ERR_GEN_FUNCTIONFAILED;
+    file = 0;
+    return status;
+}
+
+void JournalWriter::setGroupCommit( unsigned int interval, size_t bytes )
+{
+    std::lock_guard<std::mutex> guard( lock );
+    interval_ms = interval;
+    group_bytes = bytes ? bytes : 1;
+}
+
+void JournalWriter::setMaxPending( size_t bytes )
+{
+    std::lock_guard<std::mutex> guard( lock );
+    max_pending = bytes;
+}
+
+TJournalStats_t JournalWriter::stats() const
+{
+    std::lock_guard<std::mutex> guard( lock );
+    return counters;
+}
+
+void JournalWriter::run()
+{
+    std::unique_lock<std::mutex> guard( lock );
+    for( ;; ){
+        if( interval_ms > 0 ){
+            wake.wait_for( guard, std::chrono::milliseconds( interval_ms ),
+                           [this]{ return stopping || pending.size() >= group_bytes; } );
+        } else {
+            wake.wait( guard, [this]{ return stopping || !pending.empty(); } );
+        }
+        if( pending.empty() ){
+            if( stopping ) break;
+            continue;
+        }
+
+        /* the appends go on in 'pending' while the group is written */
+        group.swap( pending );
+        unsigned long long seq = last_sequence;
+        guard.unlock();
+        int status = ( fwrite( &group[0], 1, group.size(), file ) == group.size() ) ? FILE_Sync( file )
+                                                                                     : ERR_GEN_FUNCTIONFAILED;
+        guard.lock();
+
+        if( status == ERR_NOERROR ){
+            durable_sequence = seq;
+            counters.Bytes  += group.size();
+            counters.Syncs++;
+            if( group.size() > counters.MaxGroup ) counters.MaxGroup = group.size();
+        } else {
+            error = status;
+        }
+        group.clear();
+        written.notify_all();
+        if( error != ERR_NOERROR ) break;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// JournalReader
+
+JournalReader::JournalReader()
+    : position( 0 )
+    , truncated( false )
+{
+}
+
+int JournalReader::open( const char* path )
+{
+    close();
+    int status = mapping.open( path );
+    if( status != ERR_NOERROR ) return status;
+
+    unsigned char header[JNL_FILE_HEADER_SIZE];
+    s_header( header );
+    if( mapping.size() < JNL_FILE_HEADER_SIZE || memcmp( mapping.data(), header, JNL_FILE_HEADER_SIZE ) != 0 ){
+        mapping.close();
+        return ERR_TECH_DATACORRUPTED;
+    }
+    position = JNL_FILE_HEADER_SIZE;
+    return ERR_NOERROR;
+}
+
+void JournalReader::close()
+{
+    mapping.close();
+    position  = 0;
+    truncated = false;
+}
+
+bool JournalReader::next( TJournalRecord_t& record )
+{
+    if( !mapping.isOpen() || truncated ) return false;
+    size_t size = mapping.size();
+    if( position == size ) return false;
+
+    const unsigned char* p = mapping.data() + position;
+    truncated = true;
+    if( size - position < JNL_RECORD_HEADER_SIZE ) return false;
+    unsigned int payload = s_get<unsigned int>( p );
+    if( payload < JNL_PAYLOAD_SIZE( 0 ) || payload > JNL_PAYLOAD_SIZE( JNL_MAX_WORDS )
+        || size - position - JNL_RECORD_HEADER_SIZE < payload ){
+        return false;
+    }
+    p += JNL_RECORD_HEADER_SIZE;
+    if( CRC32_Compute( p, payload ) != s_get<unsigned int>( p - 4 ) ) return false;
+
+    unsigned short words = s_get<unsigned short>( p + 2 );
+    if( payload != JNL_PAYLOAD_SIZE( words ) ) return false;
+    record.Channel = p[0];
+    record.Vmp4    = ( p[1] & JNL_FLAG_VMP4 ) != 0;
+    record.Xrec    = s_get<int>( p + 4 );
+    memcpy( &record.Infos, p + 8, sizeof(record.Infos) );
+    memcpy( &record.Curr, p + 8 + sizeof(record.Infos), sizeof(record.Curr) );
+    if( (size_t)record.Infos.NbRows * (size_t)record.Infos.NbCols != words ) return false;
+    memcpy( record.Buffer.data, p + JNL_BODY_SIZE, (size_t)words * 4 );
+    record.Sequence = s_get<unsigned long long>( p + JNL_BODY_SIZE + (size_t)words * 4 );
+
+    truncated = false;
+    position += JNL_RECORD_HEADER_SIZE + payload;
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+int JNL_Replay( const char* path, CaptureWriter& store, TJournalReplay_t* result )
+{
+    TJournalReplay_t counts;
+    memset( &counts, 0, sizeof(counts) );
+
+    JournalReader reader;
+    int status = reader.open( path );
+
+    std::unique_ptr<TJournalRecord_t> record( new TJournalRecord_t );
+    std::unique_ptr<TDecodedFrame_t>  frame( new TDecodedFrame_t );
+    while( status == ERR_NOERROR && reader.next( *record ) ){
+        counts.Records++;
+        counts.LastSequence = record->Sequence;
+        if( BL_DecodeData( record->Buffer, record->Infos, record->Curr, record->Vmp4, record->Xrec, 0, frame.get() ) != ERR_NOERROR ){
+            counts.Skipped++;
+            continue;
+        }
+        status = store.appendFrame( record->Channel, *frame );
+        if( status == ERR_NOERROR ) counts.Points += frame->NbRows;
+    }
+    counts.Truncated = reader.isTruncated();
+
+    if( result ) *result = counts;
+    return status;
+}
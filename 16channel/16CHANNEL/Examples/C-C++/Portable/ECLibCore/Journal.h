@@ -0,0 +1,210 @@
+#pragma once
+
+#ifndef _JOURNAL_H_
+#define _JOURNAL_H_
+
+#include <stdio.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <BLStructs.h>
+#include "MappedFile.h"
+
+class CaptureWriter;
+
+/*
+ * Acquisition journal (*.ejnl): write-ahead log of the raw data buffers
+ *
+ * Every buffer returned by BL_GetData is appended to the journal, with its
+ * TDataInfos_t and TCurrentValues_t, before it is decoded. The records are
+ * gathered in memory and written by a background thread, which syncs the file
+ * to the disk once per group (group commit): a few milliseconds of data at
+ * most are lost when the host crashes, and the acquisition threads never wait
+ * for the disk unless the writer falls behind by more than the pending limit.
+ *
+ * After a crash the journal is replayed into a new capture file (see
+ * CaptureFile.h): the buffers are decoded again, as they were during the run.
+ *
+ *     header   "ECLIBJNL" u32 version u16 sizeof(TDataInfos_t) u16 sizeof(TCurrentValues_t)
+ *     record   u32 size u32 crc, u8 channel, u8 flags, u16 words, i32 xrec,
+ *              TDataInfos_t, TCurrentValues_t, data words, u64 sequence
+ *     ...
+ *
+ * The structures are stored as they are in memory: a journal is replayed on the
+ * host which recorded it.
+ */
+
+/**
+ * \defgroup journal Acquisition journal
+ * @{
+ */
+
+#define JNL_MAGIC_SIZE         (8)
+#define JNL_FILE_HEADER_SIZE   (16)
+#define JNL_RECORD_HEADER_SIZE (8)
+#define JNL_VERSION            (1)
+/** Default time between two syncs of the file (ms) */
+#define JNL_GROUP_INTERVAL_MS  (5)
+/** Default amount of data which triggers a sync before the interval (bytes) */
+#define JNL_GROUP_BYTES        (256 * 1024)
+/** Default amount of data not yet written above which \ref JournalWriter::append waits (bytes) */
+#define JNL_MAX_PENDING        (8 * 1024 * 1024)
+
+/** A data buffer read from a journal */
+typedef struct {
+    unsigned long long Sequence; /*!< number of the record in the journal (1-based) */
+    int              Channel;    /*!< channel (0-based) */
+    bool             Vmp4;       /*!< device of the VMP4 technology */
+    int              Xrec;       /*!< extra values recorded (see \ref TExtraRecord_e) */
+    TDataInfos_t     Infos;
+    TCurrentValues_t Curr;
+    TDataBuffer_t    Buffer;     /*!< the NbRows x NbCols first words are valid */
+} TJournalRecord_t;
+
+/** Counters of a \ref JournalWriter */
+typedef struct {
+    unsigned long long Records;   /*!< records appended */
+    unsigned long long Bytes;     /*!< bytes written to the file */
+    unsigned long long Syncs;     /*!< groups written and synced */
+    unsigned long long Stalls;    /*!< appends which waited for the writer thread */
+    unsigned long long MaxGroup;  /*!< largest group (bytes) */
+} TJournalStats_t;
+
+/** Result of \ref JNL_Replay */
+typedef struct {
+    unsigned long long Records;   /*!< records read */
+    unsigned long long Points;    /*!< points decoded and stored */
+    unsigned long long Skipped;   /*!< records which could not be decoded */
+    unsigned long long LastSequence;
+    bool               Truncated; /*!< the journal ends with a damaged or incomplete record */
+} TJournalReplay_t;
+
+/**
+ * This class appends the data buffers to a journal. \ref append may be called by
+ * several acquisition threads at once; a background thread writes and syncs.
+ */
+class JournalWriter
+{
+public:
+    JournalWriter();
+    ~JournalWriter();
+
+    /**
+     * This function creates the journal, or opens it to continue it after a restart.
+     *
+     * @param path path of the file
+     * @param append true to keep the records of an existing journal. A damaged or
+     *        incomplete last record is removed and the sequence numbers go on.
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_FUNCTIONFAILED if the file cannot
+     *         be written, \ref ERR_TECH_DATACORRUPTED if the file to append to is not a journal.
+     */
+    int open( const char* path, bool append = false );
+
+    /**
+     * This function adds a data buffer to the journal. It only copies the buffer, unless
+     * more than the pending limit is waiting for the disk.
+     *
+     * @param channel channel (0-based)
+     * @param buf data buffer, infos data information, curr current values, as returned by BL_GetData
+     * @param vmp4 true if the device uses the VMP4 technology
+     * @param xrec extra values recorded, as given to the "xctr" parameter
+     * @param sequence optional sequence number of the record, for \ref waitDurable
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_INVALIDPARAMETERS if the buffer is
+     *         not valid, or the error of the writer thread.
+     */
+    int append( int channel, const TDataBuffer_t& buf, const TDataInfos_t& infos, const TCurrentValues_t& curr,
+                bool vmp4, int xrec, unsigned long long* sequence = 0 );
+
+    /**
+     * This function waits until the record 'sequence' is on the disk.
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_INVALIDPARAMETERS if the journal
+     *         is not open or the record was not appended yet, or the error of the writer thread.
+     */
+    int waitDurable( unsigned long long sequence );
+
+    /** Writes the pending records, syncs and closes the file */
+    int close();
+
+    /**
+     * Sets the group commit: the file is synced every 'interval_ms', or as soon as
+     * 'bytes' are pending. With an interval of 0 the records are written as soon as
+     * the previous sync is over, the ones appended meanwhile forming the next group.
+     */
+    void setGroupCommit( unsigned int interval_ms, size_t bytes );
+
+    /** Sets the amount of pending data above which \ref append waits (default \ref JNL_MAX_PENDING) */
+    void setMaxPending( size_t bytes );
+
+    bool            isOpen() const { return file != 0; }
+    TJournalStats_t stats() const;
+
+private:
+    JournalWriter( const JournalWriter& );
+    JournalWriter& operator=( const JournalWriter& );
+
+    void run();
+
+    FILE*                      file;
+    std::thread                writer;
+    mutable std::mutex         lock;
+    std::condition_variable    wake;      /* signals the writer thread */
+    std::condition_variable    written;   /* signals the appends and waitDurable */
+    std::vector<unsigned char> pending;   /* records not yet given to the writer thread */
+    std::vector<unsigned char> group;     /* records being written */
+    unsigned long long         last_sequence;
+    unsigned long long         durable_sequence;
+    unsigned int               interval_ms;
+    size_t                     group_bytes;
+    size_t                     max_pending;
+    int                        error;
+    bool                       stopping;
+    TJournalStats_t            counters;
+};
+
+/**
+ * This class reads the records of a journal, in order. The reading stops at the
+ * first damaged or incomplete record: what follows was not synced when the host stopped.
+ */
+class JournalReader
+{
+public:
+    JournalReader();
+
+    /**
+     * @return \ref ERR_NOERROR if successful, the error of \ref MappedFile::open, or
+     *         \ref ERR_TECH_DATACORRUPTED if it is not a journal of this host.
+     */
+    int  open( const char* path );
+    void close();
+
+    /** Reads the next record; false at the end of the valid records */
+    bool next( TJournalRecord_t& record );
+
+    /** True once \ref next stopped on a damaged or incomplete record */
+    bool      isTruncated() const { return truncated; }
+    /** Size of the valid part of the file read so far */
+    long long validSize() const { return (long long)position; }
+
+private:
+    MappedFile mapping;
+    size_t     position;
+    bool       truncated;
+};
+
+/**
+ * This function decodes the records of a journal (\ref BL_DecodeData) and appends
+ * them to a capture file, to rebuild the data of a run which was interrupted.
+ *
+ * @param path path of the journal
+ * @param store capture file, open
+ * @param result optional counters
+ * @return \ref ERR_NOERROR if successful, the error of \ref JournalReader::open, or the
+ *         error of \ref CaptureWriter::appendFrame.
+ */
+int JNL_Replay( const char* path, CaptureWriter& store, TJournalReplay_t* result = 0 );
+
+/** @} */
+
+#endif /* _JOURNAL_H_ */
@@ -0,0 +1,306 @@
+#include "LinkMonitor.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#define LNK_CRITICAL_FRACTION (0.5)   /* of the time-out */
+#define LNK_TREND_SAMPLES     (8)     /* least round trips for a trend */
+#define LNK_SLOT_STEP_NS      (1000000LL)
+
+static long long s_clockNs(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+/* the probes must not delay the acquisition: the thread gives way to the others */
+static void s_lowerPriority(){
+#ifdef _WIN32
+    SetThreadPriority( GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL );
+#elif defined(__linux__)
+    setpriority( PRIO_PROCESS, (id_t)syscall( SYS_gettid ), 10 );
+#endif
+}
+
+/* value below which 'percent' % of the sorted values are */
+static double s_percentile( const std::vector<double>& sorted, double percent ){
+    if( sorted.empty() ) return 0.0;
+    size_t rank = (size_t)ceil( percent / 100.0 * sorted.size() );
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+TLinkMonitorConfig_t LNK_DefaultConfig()
+{
+    TLinkMonitorConfig_t config;
+    config.PeriodMs       = 1000;
+    config.GuardMs        = 20;
+    config.FailureMs      = LNK_FAILURE_MS;
+    config.WarnFraction   = 0.25;
+    config.HorizonSeconds = 600.0;
+    config.HostLateMs     = 100.0;
+    return config;
+}
+
+LinkMonitor::LinkMonitor( const TEClibFunctions* eclib )
+    : eclib( eclib ), origin( s_clockNs() ), device_id( -1 ), config( LNK_DefaultConfig() ), alert( 0 ), user( 0 ),
+      polls( 0 ), poll_start( 0 ), poll_end( 0 ), poll_period( 0 ), running( false ), stopping( false )
+{
+}
+
+LinkMonitor::~LinkMonitor()
+{
+    stop();
+}
+
+int LinkMonitor::setup( int id, const std::vector<uint8>& channels, const TLinkMonitorConfig_t& settings,
+                        TLinkAlertFunction_t function, void* data )
+{
+    if( running ) return ERR_GEN_FUNCTIONINPROGRESS;
+    if( !eclib || !eclib->BL_TestCommSpeed || channels.empty() || settings.PeriodMs == 0 || settings.FailureMs <= 0.0 ||
+        settings.WarnFraction <= 0.0 || settings.HorizonSeconds <= 0.0 || settings.HostLateMs <= 0.0 ) return ERR_GEN_INVALIDPARAMETERS;
+    for( size_t i = 0; i < channels.size(); i++ ) if( channels[i] >= 16 ) return ERR_GEN_INVALIDPARAMETERS;
+
+    std::lock_guard<std::mutex> guard( lock );
+    device_id = id;
+    config    = settings;
+    alert     = function;
+    user      = data;
+    links.clear();
+    for( size_t i = 0; i < channels.size(); i++ ){
+        TChannelLink_t link;
+        link.Channel = channels[i];
+        link.Next    = 0;
+        memset( &link.Health, 0, sizeof(link.Health) );
+        link.Health.Channel = channels[i];
+        links.push_back( link );
+    }
+    return ERR_NOERROR;
+}
+
+int LinkMonitor::start()
+{
+    if( running ) return ERR_GEN_FUNCTIONINPROGRESS;
+    if( links.empty() ) return ERR_GEN_INVALIDPARAMETERS;
+    if( worker.joinable() ) worker.join();
+    stopping = false;
+    running  = true;
+    worker = std::thread( &LinkMonitor::run, this );
+    return ERR_NOERROR;
+}
+
+void LinkMonitor::stop()
+{
+    {
+        std::lock_guard<std::mutex> guard( wake_lock );
+        stopping = true;
+    }
+    wake.notify_all();
+    if( worker.joinable() ) worker.join();
+    running = false;
+}
+
+void LinkMonitor::pollBegin()
+{
+    long long now  = s_clockNs() - origin;
+    long long last = poll_start;
+    if( last > 0 ){
+        long long period = poll_period;
+        poll_period = period ? period + ( now - last - period ) / 8 : now - last;
+    }
+    poll_start = now;
+    polls++;
+}
+
+void LinkMonitor::pollEnd()
+{
+    poll_end = s_clockNs() - origin;
+    polls--;
+}
+
+int LinkMonitor::probe( uint8 channel )
+{
+    size_t index = 0;
+    {
+        std::lock_guard<std::mutex> guard( lock );
+        while( index < links.size() && links[index].Channel != channel ) index++;
+        if( index == links.size() ) return ERR_GEN_INVALIDPARAMETERS;
+    }
+    return probeLink( index, 0.0, false );
+}
+
+std::vector<TLinkChannelHealth_t> LinkMonitor::health() const
+{
+    std::vector<TLinkChannelHealth_t> list;
+    std::lock_guard<std::mutex> guard( lock );
+    for( size_t i = 0; i < links.size(); i++ ) list.push_back( links[i].Health );
+    return list;
+}
+
+int LinkMonitor::probeLink( size_t index, double late, bool forced )
+{
+    int device = 0, channel = 0;
+    uint8 ch = links[index].Channel;   /* the list only changes in setup, never while probing */
+    long long start = s_clockNs();
+    int status = eclib->BL_TestCommSpeed( device_id, ch, &device, &channel );
+    long long end = s_clockNs();
+
+    TLinkChannelHealth_t changed;
+    bool notify = false;
+    {
+        std::lock_guard<std::mutex> guard( lock );
+        TChannelLink_t& link = links[index];
+        int health = link.Health.Health, cause = link.Health.Cause;
+        link.Health.Probes++;
+        if( forced ) link.Health.Forced++;
+        link.Health.LastError = status;
+        if( status != ERR_NOERROR ){
+            link.Health.Failures++;
+        } else {
+            /* the time of the call beyond the round trip it reports is spent on the computer */
+            double call_ms = ( end - start ) * 1e-6;
+            TSample_t sample;
+            sample.Time    = ( end - origin ) * 1e-9;
+            sample.Device  = device;
+            sample.Channel = channel;
+            sample.Late    = late + ( call_ms > channel ? call_ms - channel : 0.0 );
+            if( link.Window.size() < LNK_WINDOW ) link.Window.push_back( sample );
+            else link.Window[link.Next] = sample;
+            link.Next = ( link.Next + 1 ) % LNK_WINDOW;
+        }
+        evaluate( link, ( end - origin ) * 1e-9 );
+        if( link.Health.Health != health || link.Health.Cause != cause ){
+            changed = link.Health;
+            notify  = ( alert != 0 );
+        }
+    }
+    if( notify ) alert( user, changed );
+    return status;
+}
+
+void LinkMonitor::evaluate( TChannelLink_t& link, double now ) const
+{
+    TLinkChannelHealth_t& h = link.Health;
+    size_t n = link.Window.size();
+    std::vector<double> device( n ), channel( n ), late( n );
+    double mean_t = 0.0, mean_y = 0.0;
+    for( size_t i = 0; i < n; i++ ){
+        device[i]  = link.Window[i].Device;
+        channel[i] = link.Window[i].Channel;
+        late[i]    = link.Window[i].Late;
+        mean_t += link.Window[i].Time;
+        mean_y += link.Window[i].Channel;
+    }
+    double last = n ? link.Window[( link.Next + LNK_WINDOW - 1 ) % LNK_WINDOW].Channel : 0.0;   /* newest */
+
+    /* least squares of the round trip to the channel against the time */
+    double slope = 0.0;
+    if( n >= LNK_TREND_SAMPLES ){
+        mean_t /= n;
+        mean_y /= n;
+        double cov = 0.0, var = 0.0;
+        for( size_t i = 0; i < n; i++ ){
+            double dt = link.Window[i].Time - mean_t;
+            cov += dt * ( link.Window[i].Channel - mean_y );
+            var += dt * dt;
+        }
+        if( var > 0.0 ) slope = cov / var;
+    }
+
+    std::sort( device.begin(), device.end() );
+    std::sort( channel.begin(), channel.end() );
+    std::sort( late.begin(), late.end() );
+    h.Samples       = (int)n;
+    h.DeviceP50     = s_percentile( device, 50.0 );
+    h.DeviceP99     = s_percentile( device, 99.0 );
+    h.ChannelP50    = s_percentile( channel, 50.0 );
+    h.ChannelP99    = s_percentile( channel, 99.0 );
+    h.ChannelMax    = n ? channel[n - 1] : 0.0;
+    h.TrendMsPerMin = slope * 60.0;
+    h.ProjectedMs   = ( n >= LNK_TREND_SAMPLES ) ? mean_y + slope * ( now + config.HorizonSeconds - mean_t ) : last;
+    if( h.ProjectedMs < 0.0 ) h.ProjectedMs = 0.0;
+    h.LateP99       = s_percentile( late, 99.0 );
+
+    double warn = config.WarnFraction * config.FailureMs;
+    if( h.LastError != ERR_NOERROR ){
+        h.Health = LNK_HEALTH_DOWN;
+        h.Cause  = LNK_CAUSE_LINK;
+    } else if( last >= LNK_CRITICAL_FRACTION * config.FailureMs ){
+        h.Health = LNK_HEALTH_CRITICAL;
+        h.Cause  = LNK_CAUSE_LINK;
+    } else if( h.ProjectedMs >= warn || h.ChannelP99 >= warn ){
+        h.Health = LNK_HEALTH_DEGRADED;
+        h.Cause  = LNK_CAUSE_LINK;
+    } else if( h.LateP99 >= config.HostLateMs ){
+        h.Health = LNK_HEALTH_DEGRADED;
+        h.Cause  = LNK_CAUSE_HOST;
+    } else {
+        h.Health = LNK_HEALTH_OK;
+        h.Cause  = LNK_CAUSE_NONE;
+    }
+}
+
+bool LinkMonitor::slotFree( long long now ) const
+{
+    if( polls > 0 ) return false;
+    long long guard = (long long)config.GuardMs * 1000000LL;
+    long long last  = poll_start;
+    if( last == 0 ) return true;   /* no acquisition */
+    if( now - poll_end < guard ) return false;
+    long long period = poll_period;
+    if( period > 0 ){
+        long long next = last + period;
+        if( now > next - guard && now < next + guard ) return false;
+    }
+    return true;
+}
+
+bool LinkMonitor::wait( long long until )
+{
+    std::unique_lock<std::mutex> guard( wake_lock );
+    for( ;; ){
+        if( stopping ) return false;
+        long long left = until - ( s_clockNs() - origin );
+        if( left <= 0 ) return true;
+        wake.wait_for( guard, std::chrono::nanoseconds( left ) );
+    }
+}
+
+void LinkMonitor::run()
+{
+    s_lowerPriority();
+    long long spacing = (long long)config.PeriodMs * 1000000LL / (long long)links.size();
+    long long due = s_clockNs() - origin;
+    size_t next = 0;
+    while( wait( due ) ){
+        long long now = s_clockNs() - origin;
+        double late = ( now - due ) * 1e-6;   /* the sleep lasted longer than asked */
+
+        /* a slot between the polls, or the probe is made anyway after a whole spacing */
+        bool forced = false;
+        while( !slotFree( now ) ){
+            if( now - due >= spacing ){
+                forced = true;
+                break;
+            }
+            if( !wait( now + LNK_SLOT_STEP_NS ) ){
+                running = false;
+                return;
+            }
+            now = s_clockNs() - origin;
+        }
+        probeLink( next, late, forced );
+        next = ( next + 1 ) % links.size();
+        due += spacing;
+        now = s_clockNs() - origin;
+        if( due < now ) due = now;   /* no catching up after a long probe */
+    }
+    running = false;
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+#ifndef _LINKMONITOR_H_
+#define _LINKMONITOR_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "BLFunctionTable.h"
+
+/*
+ * Health of the link with a device, probed in the background
+ *
+ * BL_TestCommSpeed gives the round trip from the library to the device and from
+ * the library to a channel (ms). A thread of low priority calls it on each
+ * channel in turn, between the polls of the acquisition: the thread which
+ * drains the channels tells when it polls (pollBegin, pollEnd) and the probes
+ * are kept away from the polls by a guard time.
+ *
+ * The last round trips of each channel give rolling percentiles and a trend
+ * (least squares over the window), projected a few minutes ahead: a link whose
+ * round trip grows is reported before it reaches the time-out of ECLib (about
+ * 20 s) and the data are lost. The lateness of the probes on the computer (a
+ * sleep which lasts longer than asked, a call which takes longer than the round
+ * trip it reports) is measured too: a slow computer and a slow link are told
+ * apart.
+ */
+
+/**
+ * \defgroup link_monitor Link monitor
+ * @{
+ */
+
+/** Round trips kept per channel */
+#define LNK_WINDOW          (256)
+/** Time-out of the communication of ECLib, beyond which a call fails (ms) */
+#define LNK_FAILURE_MS      (20000.0)
+
+/** Health of the link with a channel */
+typedef enum {
+    LNK_HEALTH_OK       = 0,
+    LNK_HEALTH_DEGRADED = 1, /*!< the round trip is heading for the time-out, or the computer is late */
+    LNK_HEALTH_CRITICAL = 2, /*!< the round trip is past half of the time-out */
+    LNK_HEALTH_DOWN     = 3  /*!< the last probe failed */
+} TLinkHealth_e;
+
+/** What makes the health of a channel other than \ref LNK_HEALTH_OK */
+typedef enum {
+    LNK_CAUSE_NONE = 0,
+    LNK_CAUSE_LINK = 1, /*!< round trips of the USB or Ethernet link */
+    LNK_CAUSE_HOST = 2  /*!< lateness of the computer, the link being fine */
+} TLinkCause_e;
+
+/** Settings of a \ref LinkMonitor */
+typedef struct {
+    unsigned int PeriodMs;       /*!< time between two probes of the same channel */
+    unsigned int GuardMs;        /*!< least time between a probe and a poll of the acquisition */
+    double       FailureMs;      /*!< time-out of the link, \ref LNK_FAILURE_MS */
+    double       WarnFraction;   /*!< degraded when the projected round trip reaches this part of FailureMs */
+    double       HorizonSeconds; /*!< how far ahead the trend is projected */
+    double       HostLateMs;     /*!< degraded (cause host) when the p99 of the lateness reaches it */
+} TLinkMonitorConfig_t;
+
+/** Round trips and health of a channel; times in ms */
+typedef struct {
+    int                Channel;
+    int                Health;       /*!< see \ref TLinkHealth_e */
+    int                Cause;        /*!< see \ref TLinkCause_e */
+    unsigned long long Probes;
+    unsigned long long Failures;     /*!< probes which returned an error */
+    unsigned long long Forced;       /*!< probes made without a free slot between the polls */
+    int                LastError;
+    int                Samples;      /*!< round trips in the window */
+    double             DeviceP50;    /*!< library to device */
+    double             DeviceP99;
+    double             ChannelP50;   /*!< library to channel */
+    double             ChannelP99;
+    double             ChannelMax;
+    double             TrendMsPerMin;/*!< slope of the round trip to the channel */
+    double             ProjectedMs;  /*!< round trip to the channel expected HorizonSeconds ahead */
+    double             LateP99;      /*!< lateness of the probes on the computer */
+} TLinkChannelHealth_t;
+
+/** Called by the thread of the monitor when the health or its cause change */
+typedef void (*TLinkAlertFunction_t)( void* user, const TLinkChannelHealth_t& health );
+
+/** Default settings: a probe per channel and per second, 20 ms from the polls, 10 min ahead */
+TLinkMonitorConfig_t LNK_DefaultConfig();
+
+/**
+ * This class probes the link with the channels of a device. The poll and probe
+ * functions may be called from any thread.
+ */
+class LinkMonitor
+{
+public:
+    /** @param eclib ECLib functions: BL_TestCommSpeed */
+    LinkMonitor( const TEClibFunctions* eclib );
+    ~LinkMonitor();
+
+    /**
+     * This function sets the device and the channels to probe.
+     * @param alert called when the health of a channel changes, may be null
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_INVALIDPARAMETERS if BL_TestCommSpeed
+     *         is missing, a channel is not 0..15 or a setting is 0, \ref ERR_GEN_FUNCTIONINPROGRESS
+     *         if the monitor runs.
+     */
+    int setup( int id, const std::vector<uint8>& channels, const TLinkMonitorConfig_t& config,
+               TLinkAlertFunction_t alert = 0, void* user = 0 );
+
+    /** New device identifier, after a reconnection */
+    void setDevice( int id ) { device_id = id; }
+
+    /**
+     * This function starts the thread of low priority which probes the channels.
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_INVALIDPARAMETERS if \ref setup was
+     *         not done, \ref ERR_GEN_FUNCTIONINPROGRESS if the monitor runs.
+     */
+    int start();
+
+    /** Stops the thread and waits for it */
+    void stop();
+
+    bool isRunning() const { return running; }
+
+    /** The acquisition begins a poll (BL_GetData): no probe until \ref pollEnd and the guard time */
+    void pollBegin();
+
+    /** The poll begun by \ref pollBegin is over */
+    void pollEnd();
+
+    /**
+     * This function probes a channel now, from the calling thread.
+     * @return the error of BL_TestCommSpeed, \ref ERR_GEN_INVALIDPARAMETERS if the channel
+     *         is not one of \ref setup.
+     */
+    int probe( uint8 channel );
+
+    /** The channels of \ref setup */
+    std::vector<TLinkChannelHealth_t> health() const;
+
+private:
+    LinkMonitor( const LinkMonitor& );
+    LinkMonitor& operator=( const LinkMonitor& );
+
+    typedef struct {
+        double Time;      /* s since the monitor was created */
+        double Device;
+        double Channel;
+        double Late;
+    } TSample_t;
+
+    typedef struct {
+        uint8                  Channel;
+        std::vector<TSample_t> Window;   /* ring of LNK_WINDOW samples */
+        size_t                 Next;
+        TLinkChannelHealth_t   Health;
+    } TChannelLink_t;
+
+    int  probeLink( size_t index, double late, bool forced );
+    void evaluate( TChannelLink_t& link, double now ) const;
+    bool slotFree( long long now ) const;
+    bool wait( long long until );
+    void run();
+
+    const TEClibFunctions*      eclib;
+    long long                   origin;        /* ns, steady clock */
+    std::atomic<int>            device_id;
+    TLinkMonitorConfig_t        config;
+    TLinkAlertFunction_t        alert;
+    void*                       user;
+
+    std::atomic<int>            polls;         /* polls in progress */
+    std::atomic<long long>      poll_start;    /* ns since origin, of the last poll */
+    std::atomic<long long>      poll_end;
+    std::atomic<long long>      poll_period;   /* ns, mean time between the polls, 0 if unknown */
+
+    std::thread                 worker;
+    std::atomic<bool>           running;
+    bool                        stopping;
+    std::mutex                  wake_lock;
+    std::condition_variable     wake;
+
+    mutable std::mutex          lock;          /* channels */
+    std::vector<TChannelLink_t> links;
+};
+
+/** @} */
+
+#endif /* _LINKMONITOR_H_ */
@@ -0,0 +1,419 @@
+#include "LiveBus.h"
+
+#include <BLStructs.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <string.h>
+#include <atomic>
+#include <chrono>
+
+#define BUS_HEADER_SIZE     (256)
+#define BUS_CONTROL_SIZE    (64)
+#define BUS_POINTS_PER_FRAME (8)     /* frames of a channel: its points / 8 */
+#define BUS_MIN_POINTS      (1024)
+#define BUS_MAX_POINTS      (1u << 24)
+
+typedef struct {
+    char                      Magic[8];
+    unsigned int              Version;
+    unsigned int              Channels;
+    unsigned int              Points;
+    unsigned int              Frames;
+    unsigned long long        Size;
+    unsigned long long        ChannelOffset;
+    unsigned long long        ChannelBytes;
+    long long                 Epoch;
+    int                       Pid;
+    std::atomic<unsigned int> Closed;
+} TBusHeader_t;
+
+typedef struct {
+    std::atomic<unsigned long long> FrameClaim;  /* frames being written, up to */
+    std::atomic<unsigned long long> FrameHead;   /* frames published */
+    std::atomic<unsigned long long> PointClaim;
+    std::atomic<unsigned long long> PointHead;
+} TBusControl_t;
+
+typedef struct {
+    unsigned long long Sequence;
+    unsigned int       NbRows;
+    int                TechniqueID;
+    int                TechniqueIndex;
+    int                ProcessIndex;
+    int                Loop;
+    int                Fields;
+    int                Xrec;
+    int                NbExtra;
+} TBusFrame_t;
+
+static_assert( std::atomic<unsigned long long>::is_always_lock_free, "the rings need lock-free 64 bits atomics" );
+static_assert( sizeof(TBusHeader_t) == 64 && sizeof(TBusHeader_t) <= BUS_HEADER_SIZE, "layout of the header" );
+static_assert( sizeof(TBusControl_t) <= BUS_CONTROL_SIZE && sizeof(TBusFrame_t) == 40, "layout of a channel" );
+
+/* where the rings of a channel are */
+typedef struct {
+    TBusControl_t* Control;
+    TBusFrame_t*   Frames;
+    double*        Time;
+    float*         Ewe;
+    float*         Ece;
+    float*         I;
+    float*         Ctrl;
+    unsigned int*  Cycle;
+    float*         Extra[BL_FRAME_MAX_EXTRA];
+} TBusRings_t;
+
+static unsigned long long s_channelBytes( unsigned int points, unsigned int frames ){
+    unsigned long long bytes = BUS_CONTROL_SIZE + (unsigned long long)frames * sizeof(TBusFrame_t) +
+                               (unsigned long long)points * ( sizeof(double) + 5 * sizeof(float) + BL_FRAME_MAX_EXTRA * sizeof(float) );
+    return ( bytes + 63 ) & ~63ULL;
+}
+
+static TBusRings_t s_rings( const unsigned char* base, int channel ){
+    const TBusHeader_t* header = (const TBusHeader_t*)base;
+    unsigned char* at = (unsigned char*)base + header->ChannelOffset + channel * header->ChannelBytes;
+    unsigned long long points = header->Points;
+    TBusRings_t r;
+    r.Control = (TBusControl_t*)at;
+    r.Frames  = (TBusFrame_t*)( at + BUS_CONTROL_SIZE );
+    r.Time    = (double*)( at + BUS_CONTROL_SIZE + header->Frames * sizeof(TBusFrame_t) );
+    r.Ewe     = (float*)( r.Time + points );
+    r.Ece     = r.Ewe + points;
+    r.I       = r.Ece + points;
+    r.Ctrl    = r.I + points;
+    r.Cycle   = (unsigned int*)( r.Ctrl + points );
+    for( int k = 0; k < BL_FRAME_MAX_EXTRA; k++ ) r.Extra[k] = (float*)( r.Cycle + points ) + k * points;
+    return r;
+}
+
+/* name of the segment for the system, empty if not valid */
+static std::string s_segmentName( const char* name ){
+    if( !name || !name[0] || strlen( name ) > 200 ) return std::string();
+    for( const char* p = name; *p; p++ ){
+        char c = *p;
+        if( !( ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' ) || ( c >= '0' && c <= '9' ) || c == '-' || c == '_' || c == '.' ) ){
+            return std::string();
+        }
+    }
+#ifdef _WIN32
+    return std::string( "Local\\" ) + name;
+#else
+    return std::string( "/" ) + name;
+#endif
+}
+
+BusPublisher::BusPublisher()
+    : base( 0 )
+    , length( 0 )
+#ifdef _WIN32
+    , map_handle( 0 )
+#endif
+{
+}
+
+BusPublisher::~BusPublisher()
+{
+    close();
+}
+
+int BusPublisher::create( const char* name, unsigned int points, int channels )
+{
+    std::string path = s_segmentName( name );
+    if( path.empty() || channels < 1 || channels > BUS_MAX_CHANNELS ||
+        points < BUS_MIN_POINTS || points > BUS_MAX_POINTS || ( points & ( points - 1 ) ) ){
+        return ERR_GEN_INVALIDPARAMETERS;
+    }
+    close();
+
+    unsigned int frames = points / BUS_POINTS_PER_FRAME;
+    unsigned long long channel_bytes = s_channelBytes( points, frames );
+    unsigned long long size = BUS_HEADER_SIZE + channels * channel_bytes;
+#ifdef _WIN32
+    HANDLE handle = CreateFileMappingA( INVALID_HANDLE_VALUE, 0, PAGE_READWRITE, (DWORD)( size >> 32 ), (DWORD)size, path.c_str() );
+    if( !handle ) return ERR_GEN_FUNCTIONFAILED;
+    if( GetLastError() == ERROR_ALREADY_EXISTS ){
+        /* still mapped by another program: Windows frees it with the last one */
+        CloseHandle( handle );
+        return ERR_GEN_FUNCTIONFAILED;
+    }
+    base = (unsigned char*)MapViewOfFile( handle, FILE_MAP_ALL_ACCESS, 0, 0, (SIZE_T)size );
+    if( !base ){
+        CloseHandle( handle );
+        return ERR_GEN_FUNCTIONFAILED;
+    }
+    map_handle = handle;
+#else
+    shm_unlink( path.c_str() );
+    int fd = shm_open( path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644 );
+    if( fd < 0 ) return ERR_GEN_FUNCTIONFAILED;
+    void* addr = MAP_FAILED;
+    if( ftruncate( fd, (off_t)size ) == 0 ) addr = mmap( 0, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    ::close( fd );
+    if( addr == MAP_FAILED ){
+        shm_unlink( path.c_str() );
+        return ERR_GEN_FUNCTIONFAILED;
+    }
+    base = (unsigned char*)addr;
+#endif
+    length  = (size_t)size;
+    segment = name;
+
+    /* the pages are given now rather than at the first frames; the rings are empty */
+    memset( base, 0, length );
+    TBusHeader_t* header = (TBusHeader_t*)base;
+    header->Version       = BUS_VERSION;
+    header->Channels      = (unsigned int)channels;
+    header->Points        = points;
+    header->Frames        = frames;
+    header->Size          = size;
+    header->ChannelOffset = BUS_HEADER_SIZE;
+    header->ChannelBytes  = channel_bytes;
+    header->Epoch         = (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                std::chrono::system_clock::now().time_since_epoch() ).count();
+#ifdef _WIN32
+    header->Pid           = (int)GetCurrentProcessId();
+#else
+    header->Pid           = (int)getpid();
+#endif
+    /* the magic comes last for the readers */
+    std::atomic_thread_fence( std::memory_order_release );
+    memcpy( header->Magic, BUS_MAGIC, sizeof(header->Magic) );
+    return ERR_NOERROR;
+}
+
+void BusPublisher::close()
+{
+    if( !base ) return;
+    ( (TBusHeader_t*)base )->Closed.store( 1, std::memory_order_release );
+#ifdef _WIN32
+    UnmapViewOfFile( base );
+    CloseHandle( (HANDLE)map_handle );
+    map_handle = 0;
+#else
+    munmap( base, length );
+    shm_unlink( s_segmentName( segment.c_str() ).c_str() );
+#endif
+    base   = 0;
+    length = 0;
+    segment.clear();
+}
+
+int BusPublisher::publish( int channel, const TDecodedFrame_t& frame )
+{
+    if( !base ) return ERR_GEN_FUNCTIONFAILED;
+    const TBusHeader_t* header = (const TBusHeader_t*)base;
+    if( channel < 0 || channel >= (int)header->Channels ) return ERR_GEN_INVALIDPARAMETERS;
+    if( frame.NbRows <= 0 ) return ERR_NOERROR;
+
+    TBusRings_t r = s_rings( base, channel );
+    unsigned long long mask   = header->Points - 1;
+    unsigned long long seq    = r.Control->PointHead.load( std::memory_order_relaxed );
+    unsigned long long number = r.Control->FrameHead.load( std::memory_order_relaxed );
+    int extra = ( frame.NbExtra < BL_FRAME_MAX_EXTRA ) ? frame.NbExtra : BL_FRAME_MAX_EXTRA;
+    int done  = 0;
+    while( done < frame.NbRows ){
+        /* up to the end of the ring */
+        size_t at = (size_t)( seq & mask );
+        int    n  = frame.NbRows - done;
+        if( (unsigned long long)n > header->Points - at ) n = (int)( header->Points - at );
+
+        r.Control->PointClaim.store( seq + n, std::memory_order_relaxed );
+        r.Control->FrameClaim.store( number + 1, std::memory_order_relaxed );
+        std::atomic_thread_fence( std::memory_order_release );
+
+        memcpy( r.Time + at, frame.Time + done, n * sizeof(double) );
+        if( frame.Fields & BL_FIELD_EWE )     memcpy( r.Ewe + at, frame.Ewe + done, n * sizeof(float) );
+        if( frame.Fields & BL_FIELD_ECE )     memcpy( r.Ece + at, frame.Ece + done, n * sizeof(float) );
+        if( frame.Fields & BL_FIELD_I )       memcpy( r.I + at, frame.I + done, n * sizeof(float) );
+        if( frame.Fields & BL_FIELD_CONTROL ) memcpy( r.Ctrl + at, frame.Control + done, n * sizeof(float) );
+        if( frame.Fields & BL_FIELD_CYCLE )   memcpy( r.Cycle + at, frame.Cycle + done, n * sizeof(unsigned int) );
+        for( int k = 0; k < extra; k++ ) memcpy( r.Extra[k] + at, frame.Extra[k] + done, n * sizeof(float) );
+
+        TBusFrame_t& f   = r.Frames[number & ( header->Frames - 1 )];
+        f.Sequence       = seq;
+        f.NbRows         = (unsigned int)n;
+        f.TechniqueID    = frame.TechniqueID;
+        f.TechniqueIndex = frame.TechniqueIndex;
+        f.ProcessIndex   = frame.ProcessIndex;
+        f.Loop           = frame.Loop;
+        f.Fields         = frame.Fields;
+        f.Xrec           = frame.Xrec;
+        f.NbExtra        = extra;
+
+        seq += n;
+        number++;
+        done += n;
+        r.Control->PointHead.store( seq, std::memory_order_release );
+        r.Control->FrameHead.store( number, std::memory_order_release );
+    }
+    return ERR_NOERROR;
+}
+
+int BUS_FrameFunction( void* user, int channel, const TDecodedFrame_t& frame, const TCurrentValues_t& )
+{
+    return user ? static_cast<BusPublisher*>( user )->publish( channel, frame ) : ERR_GEN_INVALIDPARAMETERS;
+}
+
+BusReader::BusReader()
+    : base( 0 )
+    , length( 0 )
+#ifdef _WIN32
+    , map_handle( 0 )
+#endif
+{
+}
+
+BusReader::~BusReader()
+{
+    detach();
+}
+
+int BusReader::attach( const char* name )
+{
+    std::string path = s_segmentName( name );
+    if( path.empty() ) return ERR_GEN_INVALIDPARAMETERS;
+    detach();
+
+#ifdef _WIN32
+    HANDLE handle = OpenFileMappingA( FILE_MAP_READ, FALSE, path.c_str() );
+    if( !handle ) return ERR_GEN_FILENOTEXISTS;
+    base = (const unsigned char*)MapViewOfFile( handle, FILE_MAP_READ, 0, 0, 0 );
+    MEMORY_BASIC_INFORMATION info;
+    if( !base || VirtualQuery( base, &info, sizeof(info) ) == 0 ){
+        if( base ) UnmapViewOfFile( base );
+        base = 0;
+        CloseHandle( handle );
+        return ERR_GEN_FUNCTIONFAILED;
+    }
+    map_handle = handle;
+    length = (size_t)info.RegionSize;
+#else
+    int fd = shm_open( path.c_str(), O_RDONLY, 0 );
+    if( fd < 0 ) return ERR_GEN_FILENOTEXISTS;
+    struct stat st;
+    void* addr = MAP_FAILED;
+    if( fstat( fd, &st ) == 0 && st.st_size >= BUS_HEADER_SIZE ){
+        addr = mmap( 0, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+    }
+    ::close( fd );
+    if( addr == MAP_FAILED ) return ERR_GEN_FUNCTIONFAILED;
+    base   = (const unsigned char*)addr;
+    length = (size_t)st.st_size;
+#endif
+
+    /* a bus of this version, whose rings fit in the mapping */
+    const TBusHeader_t* header = (const TBusHeader_t*)base;
+    bool valid = length >= BUS_HEADER_SIZE && memcmp( header->Magic, BUS_MAGIC, sizeof(header->Magic) ) == 0;
+    std::atomic_thread_fence( std::memory_order_acquire );
+    valid = valid && header->Version == BUS_VERSION && header->Channels >= 1 && header->Channels <= BUS_MAX_CHANNELS &&
+            header->Points >= BUS_MIN_POINTS && header->Points <= BUS_MAX_POINTS && !( header->Points & ( header->Points - 1 ) ) &&
+            header->Frames == header->Points / BUS_POINTS_PER_FRAME && header->ChannelOffset == BUS_HEADER_SIZE &&
+            header->ChannelBytes == s_channelBytes( header->Points, header->Frames ) &&
+            header->Size == BUS_HEADER_SIZE + header->Channels * header->ChannelBytes && header->Size <= length;
+    if( !valid ){
+        detach();
+        return ERR_GEN_FUNCTIONFAILED;
+    }
+    return ERR_NOERROR;
+}
+
+void BusReader::detach()
+{
+    if( !base ) return;
+#ifdef _WIN32
+    UnmapViewOfFile( base );
+    CloseHandle( (HANDLE)map_handle );
+    map_handle = 0;
+#else
+    munmap( (void*)base, length );
+#endif
+    base   = 0;
+    length = 0;
+}
+
+int BusReader::channels() const
+{
+    return base ? (int)( (const TBusHeader_t*)base )->Channels : 0;
+}
+
+unsigned int BusReader::points() const
+{
+    return base ? ( (const TBusHeader_t*)base )->Points : 0;
+}
+
+bool BusReader::isClosed() const
+{
+    return !base || ( (const TBusHeader_t*)base )->Closed.load( std::memory_order_acquire ) != 0;
+}
+
+long long BusReader::epoch() const
+{
+    return base ? ( (const TBusHeader_t*)base )->Epoch : 0;
+}
+
+unsigned long long BusReader::frameHead( int channel ) const
+{
+    if( channel < 0 || channel >= channels() ) return 0;
+    return s_rings( base, channel ).Control->FrameHead.load( std::memory_order_acquire );
+}
+
+unsigned long long BusReader::pointHead( int channel ) const
+{
+    if( channel < 0 || channel >= channels() ) return 0;
+    return s_rings( base, channel ).Control->PointHead.load( std::memory_order_acquire );
+}
+
+int BusReader::next( int channel, unsigned long long* cursor, TBusView_t* view ) const
+{
+    if( !view || !cursor ) return ERR_GEN_INVALIDPARAMETERS;
+    view->NbRows = 0;
+    if( channel < 0 || channel >= channels() ) return ERR_GEN_INVALIDPARAMETERS;
+
+    const TBusHeader_t* header = (const TBusHeader_t*)base;
+    TBusRings_t r = s_rings( base, channel );
+    unsigned long long head = r.Control->FrameHead.load( std::memory_order_acquire );
+    for( ; *cursor < head; (*cursor)++ ){
+        if( head - *cursor > header->Frames ) *cursor = head - header->Frames;
+        TBusFrame_t f = r.Frames[*cursor & ( header->Frames - 1 )];
+        std::atomic_thread_fence( std::memory_order_acquire );
+        /* the frame, then its points, overwritten while read */
+        if( r.Control->FrameClaim.load( std::memory_order_relaxed ) > *cursor + header->Frames ) continue;
+        if( r.Control->PointClaim.load( std::memory_order_relaxed ) > f.Sequence + header->Points ) continue;
+
+        size_t at = (size_t)( f.Sequence & ( header->Points - 1 ) );
+        view->Sequence       = f.Sequence;
+        view->NbRows         = f.NbRows;
+        view->TechniqueID    = f.TechniqueID;
+        view->TechniqueIndex = f.TechniqueIndex;
+        view->ProcessIndex   = f.ProcessIndex;
+        view->Loop           = f.Loop;
+        view->Fields         = f.Fields;
+        view->Xrec           = f.Xrec;
+        view->NbExtra        = f.NbExtra;
+        view->Time           = r.Time + at;
+        view->Ewe            = r.Ewe + at;
+        view->Ece            = r.Ece + at;
+        view->I              = r.I + at;
+        view->Control        = r.Ctrl + at;
+        view->Cycle          = r.Cycle + at;
+        for( int k = 0; k < BL_FRAME_MAX_EXTRA; k++ ) view->Extra[k] = r.Extra[k] + at;
+        (*cursor)++;
+        return ERR_NOERROR;
+    }
+    return ERR_NOERROR;
+}
+
+bool BusReader::isValid( int channel, const TBusView_t& view ) const
+{
+    if( channel < 0 || channel >= channels() ) return false;
+    std::atomic_thread_fence( std::memory_order_acquire );
+    return s_rings( base, channel ).Control->PointClaim.load( std::memory_order_relaxed ) <= view.Sequence + points();
+}
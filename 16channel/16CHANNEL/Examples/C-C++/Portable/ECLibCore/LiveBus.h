@@ -0,0 +1,193 @@
+#pragma once
+
+#ifndef _LIVEBUS_H_
+#define _LIVEBUS_H_
+
+#include <string>
+
+#include "BLDecode.h"
+
+/*
+ * Publication of the live data to local programs, through shared memory
+ *
+ * Only one program can hold the connection to an instrument. It publishes the
+ * decoded frames (a frame function of an Acquisition, see \ref BUS_FrameFunction)
+ * in a named shared memory segment (shm_open on POSIX, a file mapping object on
+ * Windows); any number of programs of the same computer attach to it, read only,
+ * and read the points in place, without copy and without the instrument.
+ *
+ * Each channel has two rings: its points, column by column, and its frames (the
+ * technique of a run of points). A point gets the sequence number of the points
+ * published on its channel before it; the frames are numbered the same way. The
+ * publisher never waits: a slow reader finds a gap in the sequence numbers of
+ * the points, the oldest being overwritten. A frame is split at the end of the
+ * ring, so that the columns of a frame are always contiguous.
+ *
+ * The publisher claims the points it is about to write before writing them:
+ * a reader checks after using the points that they were not claimed meanwhile
+ * (\ref BusReader::isValid), as with a seqlock.
+ *
+ * Layout of the segment (little endian, every offset a multiple of 8), for the
+ * programs which map it without this code (LabVIEW, Python, ...):
+ *
+ *     header   (256 bytes)  "ECLIBBUS" u32 version u32 channels u32 points u32 frames
+ *                           u64 size u64 offset of the channel 0 u64 size of a channel
+ *                           i64 epoch (ns) i32 pid u32 closed
+ *     channel  u64 frame claim, u64 frame head, u64 point claim, u64 point head (64 bytes)
+ *              frames  x { u64 sequence, u32 rows, i32 technique id, technique index,
+ *                          process index, loop, fields, xrec, extra values }
+ *              points  x f64 time, then points x f32 Ewe, Ece, I, control,
+ *              points  x u32 cycle, then 6 x points x f32 extra values
+ *     ...      the next channels
+ *
+ * The points of sequence 's' are at the index 's % points' of the columns,
+ * the frame 'f' at 'f % frames'; points and frames are powers of 2.
+ */
+
+/**
+ * \defgroup live_bus Live data bus
+ * @{
+ */
+
+#define BUS_MAGIC           "ECLIBBUS"
+#define BUS_VERSION         (1)
+#define BUS_MAX_CHANNELS    (16)
+/** Name of the segment used by the tools when none is given */
+#define BUS_DEFAULT_NAME    "eclib-live"
+/** Default points of a channel (about 850 kB) */
+#define BUS_DEFAULT_POINTS  (16384)
+
+/** Points of a frame, read in place */
+typedef struct {
+    unsigned long long  Sequence;       /*!< of the first point */
+    unsigned int        NbRows;         /*!< 0 if no new frame */
+    int                 TechniqueID;    /*!< see \ref TTechniqueIdentifier_e */
+    int                 TechniqueIndex;
+    int                 ProcessIndex;
+    int                 Loop;
+    int                 Fields;         /*!< values available (see \ref TDecodedField_e) */
+    int                 Xrec;           /*!< extra values recorded (see \ref TExtraRecord_e) */
+    int                 NbExtra;
+    const double*       Time;
+    const float*        Ewe;
+    const float*        Ece;
+    const float*        I;
+    const float*        Control;
+    const unsigned int* Cycle;
+    const float*        Extra[BL_FRAME_MAX_EXTRA];
+} TBusView_t;
+
+/**
+ * This class creates a segment and publishes the frames of the channels in it.
+ * The frames of a channel are published from one thread at a time.
+ */
+class BusPublisher
+{
+public:
+    BusPublisher();
+    ~BusPublisher();
+
+    /**
+     * This function creates the segment. On POSIX a segment of the same name left
+     * by another publisher is replaced (the readers attached to it keep it); on
+     * Windows the name is free once no program maps the segment any more.
+     * @param name name of the segment: letters, digits, '-', '_' and '.'
+     * @param points points of each channel, a power of 2 from 1024
+     * @param channels channels published, 1..\ref BUS_MAX_CHANNELS
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_INVALIDPARAMETERS if a value is
+     *         not valid, \ref ERR_GEN_FUNCTIONFAILED if the segment cannot be created (or,
+     *         on Windows, exists).
+     */
+    int create( const char* name, unsigned int points = BUS_DEFAULT_POINTS, int channels = BUS_MAX_CHANNELS );
+
+    /** Marks the segment closed for its readers and removes its name */
+    void close();
+
+    /**
+     * This function publishes a decoded frame of a channel.
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_INVALIDPARAMETERS if the channel
+     *         is not published, \ref ERR_GEN_FUNCTIONFAILED if the segment is not created.
+     */
+    int publish( int channel, const TDecodedFrame_t& frame );
+
+    bool isOpen() const { return base != 0; }
+    const std::string& name() const { return segment; }
+    size_t size() const { return length; }
+
+private:
+    BusPublisher( const BusPublisher& );
+    BusPublisher& operator=( const BusPublisher& );
+
+    unsigned char* base;
+    size_t         length;
+    std::string    segment;
+#ifdef _WIN32
+    void*          map_handle;
+#endif
+};
+
+/**
+ * This class attaches to a segment, read only, and reads the frames of its channels.
+ */
+class BusReader
+{
+public:
+    BusReader();
+    ~BusReader();
+
+    /**
+     * This function maps the segment of a publisher.
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_FILENOTEXISTS if there is no
+     *         segment of this name, \ref ERR_GEN_FUNCTIONFAILED if it is not a bus of this version.
+     */
+    int attach( const char* name );
+    void detach();
+
+    bool isAttached() const { return base != 0; }
+    int  channels() const;
+    /** Points of each channel the rings hold */
+    unsigned int points() const;
+    /** True once the publisher closed the segment */
+    bool isClosed() const;
+    /** Identifies the publisher: ns since 1970 at the creation of the segment */
+    long long epoch() const;
+
+    /** Frames published on a channel; as a cursor, the next frame to come */
+    unsigned long long frameHead( int channel ) const;
+    /** Points published on a channel */
+    unsigned long long pointHead( int channel ) const;
+
+    /**
+     * This function gives the next frame of a channel, in place. A cursor behind
+     * the frames kept moves to the oldest one: the sequence of the points tells
+     * the points lost.
+     * @param cursor frame to read (0 for the oldest one kept), moved to the next one
+     * @param view points of the frame; NbRows is 0 if no frame was published since
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_INVALIDPARAMETERS if the channel
+     *         is not published or the reader not attached.
+     */
+    int next( int channel, unsigned long long* cursor, TBusView_t* view ) const;
+
+    /** True if the points of a view were not overwritten: called after reading them */
+    bool isValid( int channel, const TBusView_t& view ) const;
+
+private:
+    BusReader( const BusReader& );
+    BusReader& operator=( const BusReader& );
+
+    const unsigned char* base;
+    size_t               length;
+#ifdef _WIN32
+    void*                map_handle;
+#endif
+};
+
+/**
+ * Frame function of an \ref Acquisition publishing the frames, 'user' being a
+ * \ref BusPublisher (see \ref TAcqFrameFunction_t).
+ */
+int BUS_FrameFunction( void* user, int channel, const TDecodedFrame_t& frame, const TCurrentValues_t& curr );
+
+/** @} */
+
+#endif /* _LIVEBUS_H_ */
@@ -0,0 +1,100 @@
+#include "MappedFile.h"
+
+#include <BLStructs.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+    : base( 0 )
+    , length( 0 )
+    , opened( false )
+#ifdef _WIN32
+    , file_handle( INVALID_HANDLE_VALUE )
+    , map_handle( 0 )
+#else
+    , fd( -1 )
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+int MappedFile::open( const char* path )
+{
+    if( !path || !path[0] ) return ERR_GEN_INVALIDPARAMETERS;
+
+    close();
+
+#ifdef _WIN32
+    file_handle = CreateFileA( path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, 0,
+                               OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, 0 );
+    if( file_handle == INVALID_HANDLE_VALUE ) return ERR_GEN_FILENOTEXISTS;
+
+    LARGE_INTEGER fsize;
+    if( !GetFileSizeEx( (HANDLE)file_handle, &fsize ) ){
+        close();
+        return ERR_GEN_FUNCTIONFAILED;
+    }
+    length = (size_t)fsize.QuadPart;
+    opened = true;
+    if( length == 0 ) return ERR_NOERROR; /* nothing to map */
+
+    map_handle = CreateFileMappingA( (HANDLE)file_handle, 0, PAGE_READONLY, 0, 0, 0 );
+    if( map_handle ){
+        base = (const unsigned char*)MapViewOfFile( (HANDLE)map_handle, FILE_MAP_READ, 0, 0, 0 );
+    }
+#else
+    fd = ::open( path, O_RDONLY );
+    if( fd < 0 ) return ERR_GEN_FILENOTEXISTS;
+
+    struct stat st;
+    if( fstat( fd, &st ) != 0 ){
+        close();
+        return ERR_GEN_FUNCTIONFAILED;
+    }
+    length = (size_t)st.st_size;
+    opened = true;
+    if( length == 0 ) return ERR_NOERROR; /* mmap refuses empty mappings */
+
+    void* addr = mmap( 0, length, PROT_READ, MAP_SHARED, fd, 0 );
+    if( addr != MAP_FAILED ){
+        base = (const unsigned char*)addr;
+        /* the readers walk the file front to back */
+        madvise( addr, length, MADV_SEQUENTIAL );
+    }
+#endif
+
+    if( !base ){
+        close();
+        return ERR_GEN_FUNCTIONFAILED;
+    }
+    return ERR_NOERROR;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+    if( base ) UnmapViewOfFile( base );
+    if( map_handle ) CloseHandle( (HANDLE)map_handle );
+    if( file_handle != INVALID_HANDLE_VALUE ) CloseHandle( (HANDLE)file_handle );
+    map_handle  = 0;
+    file_handle = INVALID_HANDLE_VALUE;
+#else
+    if( base ) munmap( (void*)base, length );
+    if( fd >= 0 ) ::close( fd );
+    fd = -1;
+#endif
+    base   = 0;
+    length = 0;
+    opened = false;
+}
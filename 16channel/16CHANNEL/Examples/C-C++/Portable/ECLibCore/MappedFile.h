@@ -0,0 +1,61 @@
+#pragma once
+
+#ifndef _MAPPEDFILE_H_
+#define _MAPPEDFILE_H_
+
+#include <stddef.h>
+
+/*
+ * Read-only memory mapping of a file (mmap on Linux, file mapping objects on Windows)
+ */
+
+/**
+ * \defgroup portable_io Portable file helpers
+ * @{
+ */
+
+/**
+ * This class maps a whole file in memory, read-only. The mapping stays valid until
+ * \ref MappedFile::close is called or the object is destroyed, and every pointer
+ * handed out by the readers built on top of it points straight into the mapping.
+ */
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    /**
+     * Maps the file in memory. Any previous mapping is released first.
+     *
+     * @param path path of the file to map
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_FILENOTEXISTS if the file
+     *         cannot be opened, \ref ERR_GEN_FUNCTIONFAILED if the mapping failed.
+     */
+    int  open( const char* path );
+
+    /** Releases the mapping. Safe to call several times. */
+    void close();
+
+    const unsigned char* data() const { return base; }
+    size_t               size() const { return length; }
+    bool                 isOpen() const { return opened; }
+
+private:
+    MappedFile( const MappedFile& );            // not copyable
+    MappedFile& operator=( const MappedFile& );
+
+    const unsigned char* base;
+    size_t               length;
+    bool                 opened;   /* an empty file is open but has no mapping */
+#ifdef _WIN32
+    void*                file_handle;
+    void*                map_handle;
+#else
+    int                  fd;
+#endif
+};
+
+/** @} */
+
+#endif /* _MAPPEDFILE_H_ */
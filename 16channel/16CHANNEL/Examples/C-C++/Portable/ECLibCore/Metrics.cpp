@@ -0,0 +1,683 @@
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__)
+#include <pthread.h>
+#include <time.h>
+#endif
+
+#include "Metrics.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+typedef SOCKET TSocket_t;
+#define MET_NO_SOCKET       INVALID_SOCKET
+#define s_closeSocket       closesocket
+#else
+typedef int TSocket_t;
+#define MET_NO_SOCKET       (-1)
+#define s_closeSocket       close
+#endif
+
+#define MET_SELECT_MS       (100)    /* longest wait of the exporter for a connection */
+#define MET_REQUEST_SIZE    (4096)   /* longest request read */
+#define MET_REQUEST_MS      (1000)   /* longest wait for a request */
+#define MET_SEND_MS         (1000)   /* longest wait of a send to a client */
+#define MET_MAX_CLIENTS     (32)     /* connections read at once, the next ones wait in the backlog */
+
+/* a scraper which resets its connection must not end the process with SIGPIPE */
+#ifdef MSG_NOSIGNAL
+#define MET_SEND_FLAGS      MSG_NOSIGNAL
+#else
+#define MET_SEND_FLAGS      0
+#endif
+
+/* a connection whose request is being read */
+typedef struct {
+    TSocket_t   Socket;
+    std::string Request;
+    long long   Until;   /* answered as it is then */
+} TMetClient_t;
+
+/* the codes of TErrorCodes_e, in the order of BLStructs.h */
+static const struct {
+    int         Code;
+    const char* Name;
+} s_codes[] = {
+    { ERR_NOERROR, "ERR_NOERROR" },
+    { ERR_GEN_NOTCONNECTED, "ERR_GEN_NOTCONNECTED" },
+    { ERR_GEN_CONNECTIONINPROGRESS, "ERR_GEN_CONNECTIONINPROGRESS" },
+    { ERR_GEN_CHANNELNOTPLUGGED, "ERR_GEN_CHANNELNOTPLUGGED" },
+    { ERR_GEN_INVALIDPARAMETERS, "ERR_GEN_INVALIDPARAMETERS" },
+    { ERR_GEN_FILENOTEXISTS, "ERR_GEN_FILENOTEXISTS" },
+    { ERR_GEN_FUNCTIONFAILED, "ERR_GEN_FUNCTIONFAILED" },
+    { ERR_GEN_NOCHANNELELECTED, "ERR_GEN_NOCHANNELELECTED" },
+    { ERR_GEN_INVALIDCONF, "ERR_GEN_INVALIDCONF" },
+    { ERR_GEN_ECLAB_LOADED, "ERR_GEN_ECLAB_LOADED" },
+    { ERR_GEN_LIBNOTCORRECTLYLOADED, "ERR_GEN_LIBNOTCORRECTLYLOADED" },
+    { ERR_GEN_USBLIBRARYERROR, "ERR_GEN_USBLIBRARYERROR" },
+    { ERR_GEN_FUNCTIONINPROGRESS, "ERR_GEN_FUNCTIONINPROGRESS" },
+    { ERR_GEN_CHANNEL_RUNNING, "ERR_GEN_CHANNEL_RUNNING" },
+    { ERR_GEN_DEVICE_NOTALLOWED, "ERR_GEN_DEVICE_NOTALLOWED" },
+    { ERR_GEN_UPDATEPARAMETERS, "ERR_GEN_UPDATEPARAMETERS" },
+    { ERR_INSTR_VMEERROR, "ERR_INSTR_VMEERROR" },
+    { ERR_INSTR_TOOMANYDATA, "ERR_INSTR_TOOMANYDATA" },
+    { ERR_INSTR_RESPNOTPOSSIBLE, "ERR_INSTR_RESPNOTPOSSIBLE" },
+    { ERR_INSTR_RESPERROR, "ERR_INSTR_RESPERROR" },
+    { ERR_INSTR_MSGSIZEERROR, "ERR_INSTR_MSGSIZEERROR" },
+    { ERR_COMM_COMMFAILED, "ERR_COMM_COMMFAILED" },
+    { ERR_COMM_CONNECTIONFAILED, "ERR_COMM_CONNECTIONFAILED" },
+    { ERR_COMM_WAITINGACK, "ERR_COMM_WAITINGACK" },
+    { ERR_COMM_INVALIDIPADDRESS, "ERR_COMM_INVALIDIPADDRESS" },
+    { ERR_COMM_ALLOCMEMFAILED, "ERR_COMM_ALLOCMEMFAILED" },
+    { ERR_COMM_LOADFIRMWAREFAILED, "ERR_COMM_LOADFIRMWAREFAILED" },
+    { ERR_COMM_INCOMPATIBLESERVER, "ERR_COMM_INCOMPATIBLESERVER" },
+    { ERR_COMM_MAXCONNREACHED, "ERR_COMM_MAXCONNREACHED" },
+    { ERR_FIRM_FIRMFILENOTEXISTS, "ERR_FIRM_FIRMFILENOTEXISTS" },
+    { ERR_FIRM_FIRMFILEACCESSFAILED, "ERR_FIRM_FIRMFILEACCESSFAILED" },
+    { ERR_FIRM_FIRMINVALIDFILE, "ERR_FIRM_FIRMINVALIDFILE" },
+    { ERR_FIRM_FIRMLOADINGFAILED, "ERR_FIRM_FIRMLOADINGFAILED" },
+    { ERR_FIRM_XILFILENOTEXISTS, "ERR_FIRM_XILFILENOTEXISTS" },
+    { ERR_FIRM_XILFILEACCESSFAILED, "ERR_FIRM_XILFILEACCESSFAILED" },
+    { ERR_FIRM_XILINVALIDFILE, "ERR_FIRM_XILINVALIDFILE" },
+    { ERR_FIRM_XILLOADINGFAILED, "ERR_FIRM_XILLOADINGFAILED" },
+    { ERR_FIRM_FIRMWARENOTLOADED, "ERR_FIRM_FIRMWARENOTLOADED" },
+    { ERR_FIRM_FIRMWAREINCOMPATIBLE, "ERR_FIRM_FIRMWAREINCOMPATIBLE" },
+    { ERR_TECH_ECCFILENOTEXISTS, "ERR_TECH_ECCFILENOTEXISTS" },
+    { ERR_TECH_INCOMPATIBLEECC, "ERR_TECH_INCOMPATIBLEECC" },
+    { ERR_TECH_ECCFILECORRUPTED, "ERR_TECH_ECCFILECORRUPTED" },
+    { ERR_TECH_LOADTECHNIQUEFAILED, "ERR_TECH_LOADTECHNIQUEFAILED" },
+    { ERR_TECH_DATACORRUPTED, "ERR_TECH_DATACORRUPTED" },
+    { ERR_TECH_MEMFULL, "ERR_TECH_MEMFULL" }
+};
+#define MET_NB_CODES        ( (int)( sizeof(s_codes) / sizeof(s_codes[0]) ) + 1 )   /* the last one for the unknown codes */
+
+static const double s_bounds[MET_NB_BUCKETS] = { 0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 1.0 };
+
+static long long s_clockNs(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+static int s_codeIndex( int code ){
+    for( int i = 0; i < MET_NB_CODES - 1; i++ ) if( s_codes[i].Code == code ) return i;
+    return MET_NB_CODES - 1;
+}
+
+static unsigned long long s_threadKey(){
+    return (unsigned long long)std::hash<std::thread::id>()( std::this_thread::get_id() );
+}
+
+/* CPU time of a registered thread, s */
+static double s_threadCpu( unsigned long long clock ){
+#if defined(__linux__)
+    struct timespec ts;
+    if( clock_gettime( (clockid_t)clock, &ts ) != 0 ) return 0.0;
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#elif defined(_WIN32)
+    FILETIME created, ended, kernel, user;
+    if( !GetThreadTimes( (HANDLE)(uintptr_t)clock, &created, &ended, &kernel, &user ) ) return 0.0;
+    unsigned long long k = ( (unsigned long long)kernel.dwHighDateTime << 32 ) | kernel.dwLowDateTime;
+    unsigned long long u = ( (unsigned long long)user.dwHighDateTime << 32 ) | user.dwLowDateTime;
+    return ( k + u ) * 1e-7;
+#else
+    (void)clock;
+    return 0.0;
+#endif
+}
+
+/* the label values are quoted: \ " and new lines escaped */
+static std::string s_label( const std::string& value ){
+    std::string out;
+    for( size_t i = 0; i < value.size(); i++ ){
+        if( value[i] == '\\' || value[i] == '"' ) out += '\\';
+        if( value[i] == '\n' ) out += "\\n";
+        else out += value[i];
+    }
+    return out;
+}
+
+static std::string s_channelLabels( const TMetricsSnapshot_t& s, int channel ){
+    return "device=\"" + s_label( s.Device ) + "\",channel=\"" + ( channel == MET_NONE ? std::string() : std::to_string( channel + 1 ) ) + "\"";
+}
+
+static void s_family( std::string& out, const char* name, const char* type, const char* help ){
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+}
+
+static void s_sample( std::string& out, const char* name, const std::string& labels, double value ){
+    char text[64];
+    if( value == (double)(long long)value ) snprintf( text, sizeof(text), " %lld\n", (long long)value );
+    else snprintf( text, sizeof(text), " %.9g\n", value );
+    out += name;
+    out += '{';
+    out += labels;
+    out += '}';
+    out += text;
+}
+
+double MET_LatencyBound( int bucket )
+{
+    return ( bucket >= 0 && bucket < MET_NB_BUCKETS ) ? s_bounds[bucket] : -1.0;
+}
+
+const char* MET_ErrorName( int code )
+{
+    int i = s_codeIndex( code );
+    return ( i < MET_NB_CODES - 1 ) ? s_codes[i].Name : 0;
+}
+
+AcqMetrics::AcqMetrics( const char* device )
+    : device( device ? device : "" ), errors( new std::atomic<unsigned long long>[17 * MET_NB_CODES] ), origin( s_clockNs() )
+{
+    for( int ch = 0; ch < 16; ch++ ){
+        TChannelCounters_t& c = channels[ch];
+        c.Points = 0;
+        c.Skipped = 0;
+        c.Dropped = 0;
+        c.Bytes = 0;
+        c.LatencyNs = 0;
+        for( int b = 0; b <= MET_NB_BUCKETS; b++ ) c.Latency[b] = 0;
+        c.MemFilled = 0;
+        c.MemSize = 0;
+        c.Used = false;
+        rates[ch].Points = 0;
+        rates[ch].Time   = 0.0;
+        rates[ch].Rate   = 0.0;
+    }
+    for( int i = 0; i < 17 * MET_NB_CODES; i++ ) errors[i] = 0;
+}
+
+AcqMetrics::~AcqMetrics()
+{
+#ifdef _WIN32
+    for( size_t i = 0; i < threads.size(); i++ ) if( threads[i].Running ) CloseHandle( (HANDLE)(uintptr_t)threads[i].Clock );
+#endif
+    delete[] errors;
+}
+
+void AcqMetrics::setMemSize( uint8 channel, int bytes )
+{
+    if( channel >= 16 ) return;
+    channels[channel].MemSize.store( bytes, std::memory_order_relaxed );
+    channels[channel].Used.store( true, std::memory_order_relaxed );
+}
+
+void AcqMetrics::recordPoll( uint8 channel, long long ns, const TDataInfos_t& infos, const TCurrentValues_t& curr )
+{
+    if( channel >= 16 ) return;
+    TChannelCounters_t& c = channels[channel];
+    int bucket = 0;
+    double seconds = ns * 1e-9;
+    while( bucket < MET_NB_BUCKETS && seconds > s_bounds[bucket] ) bucket++;
+    if( infos.NbRows > 0 ){
+        c.Points.fetch_add( infos.NbRows, std::memory_order_relaxed );
+        if( infos.NbCols > 0 ) c.Bytes.fetch_add( (unsigned long long)infos.NbRows * infos.NbCols * sizeof(unsigned int), std::memory_order_relaxed );
+    }
+    if( infos.IRQskipped > 0 ) c.Skipped.fetch_add( infos.IRQskipped, std::memory_order_relaxed );
+    c.LatencyNs.fetch_add( ns > 0 ? ns : 0, std::memory_order_relaxed );
+    c.Latency[bucket].fetch_add( 1, std::memory_order_relaxed );
+    c.MemFilled.store( curr.MemFilled, std::memory_order_relaxed );
+    if( !c.Used.load( std::memory_order_relaxed ) ) c.Used.store( true, std::memory_order_relaxed );
+}
+
+void AcqMetrics::recordError( int channel, int code )
+{
+    if( code == ERR_NOERROR ) return;
+    int row = ( channel >= 0 && channel < 16 ) ? channel : 16;
+    errors[row * MET_NB_CODES + s_codeIndex( code )].fetch_add( 1, std::memory_order_relaxed );
+}
+
+void AcqMetrics::recordDropped( uint8 channel, unsigned int frames )
+{
+    if( channel >= 16 || frames == 0 ) return;
+    channels[channel].Dropped.fetch_add( frames, std::memory_order_relaxed );
+    if( !channels[channel].Used.load( std::memory_order_relaxed ) ) channels[channel].Used.store( true, std::memory_order_relaxed );
+}
+
+int AcqMetrics::registerThread( const char* name )
+{
+    TThread_t t;
+    t.Name    = name ? name : "";
+    t.Key     = s_threadKey();
+    t.Last    = 0.0;
+    t.Running = true;
+#if defined(__linux__)
+    clockid_t clock;
+    if( pthread_getcpuclockid( pthread_self(), &clock ) != 0 ) return ERR_GEN_FUNCTIONFAILED;
+    t.Clock = (unsigned long long)clock;
+#elif defined(_WIN32)
+    HANDLE handle;
+    if( !DuplicateHandle( GetCurrentProcess(), GetCurrentThread(), GetCurrentProcess(), &handle, THREAD_QUERY_LIMITED_INFORMATION, FALSE, 0 ) ){
+        return ERR_GEN_FUNCTIONFAILED;
+    }
+    t.Clock = (unsigned long long)(uintptr_t)handle;
+#else
+    return ERR_GEN_FUNCTIONFAILED;
+#endif
+    std::lock_guard<std::mutex> guard( lock );
+    threads.push_back( t );
+    return ERR_NOERROR;
+}
+
+void AcqMetrics::unregisterThread()
+{
+    unsigned long long key = s_threadKey();
+    std::lock_guard<std::mutex> guard( lock );
+    for( size_t i = 0; i < threads.size(); i++ ){
+        TThread_t& t = threads[i];
+        if( t.Key != key || !t.Running ) continue;
+        t.Last    = s_threadCpu( t.Clock );
+        t.Running = false;
+#ifdef _WIN32
+        CloseHandle( (HANDLE)(uintptr_t)t.Clock );
+#endif
+    }
+}
+
+TMetricsSnapshot_t AcqMetrics::snapshot()
+{
+    TMetricsSnapshot_t s;
+    s.Device = device;
+    double now = ( s_clockNs() - origin ) * 1e-9;
+    std::lock_guard<std::mutex> guard( lock );
+    for( int ch = 0; ch < 16; ch++ ){
+        const TChannelCounters_t& c = channels[ch];
+        if( !c.Used.load( std::memory_order_relaxed ) ) continue;
+        TChannelMetrics_t m;
+        m.Channel    = ch;
+        m.Points     = c.Points.load( std::memory_order_relaxed );
+        m.Skipped    = c.Skipped.load( std::memory_order_relaxed );
+        m.Dropped    = c.Dropped.load( std::memory_order_relaxed );
+        m.Bytes      = c.Bytes.load( std::memory_order_relaxed );
+        m.MemFilled  = c.MemFilled.load( std::memory_order_relaxed );
+        m.MemSize    = c.MemSize.load( std::memory_order_relaxed );
+        m.LatencySum = c.LatencyNs.load( std::memory_order_relaxed ) * 1e-9;
+        m.Polls      = 0;
+        for( int b = 0; b <= MET_NB_BUCKETS; b++ ){
+            m.Latency[b] = c.Latency[b].load( std::memory_order_relaxed );
+            m.Polls     += m.Latency[b];   /* a poll is counted in a bucket */
+        }
+
+        /* the rate is measured over a window, whatever the readers and their periods */
+        TRate_t& r = rates[ch];
+        if( now - r.Time >= MET_RATE_WINDOW ){
+            r.Rate   = ( m.Points - r.Points ) / ( now - r.Time );
+            r.Points = m.Points;
+            r.Time   = now;
+        }
+        m.PointsPerSecond = r.Rate;
+        s.Channels.push_back( m );
+    }
+    for( int row = 0; row < 17; row++ ){
+        for( int i = 0; i < MET_NB_CODES; i++ ){
+            unsigned long long n = errors[row * MET_NB_CODES + i].load( std::memory_order_relaxed );
+            if( !n ) continue;
+            TErrorMetrics_t e;
+            e.Channel = ( row < 16 ) ? row : MET_NONE;
+            e.Code    = ( i < MET_NB_CODES - 1 ) ? s_codes[i].Code : MET_OTHER;
+            e.Count   = n;
+            s.Errors.push_back( e );
+        }
+    }
+    for( size_t i = 0; i < threads.size(); i++ ){
+        TThreadMetrics_t t;
+        t.Name       = threads[i].Name;
+        t.Running    = threads[i].Running;
+        t.CpuSeconds = t.Running ? s_threadCpu( threads[i].Clock ) : threads[i].Last;
+        s.Threads.push_back( t );
+    }
+    return s;
+}
+
+std::string AcqMetrics::text()
+{
+    std::vector<AcqMetrics*> list( 1, this );
+    return MET_Text( list );
+}
+
+std::string MET_Text( const std::vector<AcqMetrics*>& metrics )
+{
+    std::vector<TMetricsSnapshot_t> all;
+    for( size_t i = 0; i < metrics.size(); i++ ) all.push_back( metrics[i]->snapshot() );
+
+    /* the labels of each channel, and the channel counters, family by family */
+    typedef unsigned long long (*TCounter_t)( const TChannelMetrics_t& );
+    static const struct {
+        const char* Name;
+        const char* Help;
+        TCounter_t  Value;
+    } counters[] = {
+        { "eclib_polls_total", "BL_GetData which succeeded.", []( const TChannelMetrics_t& m ){ return m.Polls; } },
+        { "eclib_points_total", "Points read from the channel.", []( const TChannelMetrics_t& m ){ return m.Points; } },
+        { "eclib_data_bytes_total", "Bytes of the data buffers read.", []( const TChannelMetrics_t& m ){ return m.Bytes; } },
+        { "eclib_points_skipped_total", "Points dropped by the instrument, its memory full (IRQskipped).", []( const TChannelMetrics_t& m ){ return m.Skipped; } },
+        { "eclib_frames_dropped_total", "Frames dropped by the program.", []( const TChannelMetrics_t& m ){ return m.Dropped; } }
+    };
+
+    std::string out;
+    char buf[64];
+    for( size_t k = 0; k < sizeof(counters) / sizeof(counters[0]); k++ ){
+        s_family( out, counters[k].Name, "counter", counters[k].Help );
+        for( size_t d = 0; d < all.size(); d++ ){
+            for( size_t c = 0; c < all[d].Channels.size(); c++ ){
+                const TChannelMetrics_t& m = all[d].Channels[c];
+                std::string labels = s_channelLabels( all[d], m.Channel );
+                s_sample( out, counters[k].Name, labels, (double)counters[k].Value( m ) );
+            }
+        }
+    }
+
+    s_family( out, "eclib_points_per_second", "gauge", "Points read per second, over the last second at least." );
+    for( size_t d = 0; d < all.size(); d++ ){
+        for( size_t c = 0; c < all[d].Channels.size(); c++ ){
+            const TChannelMetrics_t& m = all[d].Channels[c];
+            s_sample( out, "eclib_points_per_second", s_channelLabels( all[d], m.Channel ), m.PointsPerSecond );
+        }
+    }
+    s_family( out, "eclib_memory_filled_bytes", "gauge", "Memory of the channel filled, at the last poll." );
+    for( size_t d = 0; d < all.size(); d++ ){
+        for( size_t c = 0; c < all[d].Channels.size(); c++ ){
+            const TChannelMetrics_t& m = all[d].Channels[c];
+            s_sample( out, "eclib_memory_filled_bytes", s_channelLabels( all[d], m.Channel ), m.MemFilled );
+        }
+    }
+    s_family( out, "eclib_memory_fill_ratio", "gauge", "Part of the memory of the channel filled, at the last poll." );
+    for( size_t d = 0; d < all.size(); d++ ){
+        for( size_t c = 0; c < all[d].Channels.size(); c++ ){
+            const TChannelMetrics_t& m = all[d].Channels[c];
+            if( m.MemSize <= 0 ) continue;
+            s_sample( out, "eclib_memory_fill_ratio", s_channelLabels( all[d], m.Channel ), (double)m.MemFilled / m.MemSize );
+        }
+    }
+
+    s_family( out, "eclib_poll_latency_seconds", "histogram", "Time of the BL_GetData which succeeded." );
+    for( size_t d = 0; d < all.size(); d++ ){
+        for( size_t c = 0; c < all[d].Channels.size(); c++ ){
+            const TChannelMetrics_t& m = all[d].Channels[c];
+            std::string labels = s_channelLabels( all[d], m.Channel );
+            unsigned long long count = 0;
+            for( int b = 0; b <= MET_NB_BUCKETS; b++ ){
+                count += m.Latency[b];
+                if( b < MET_NB_BUCKETS ) snprintf( buf, sizeof(buf), ",le=\"%g\"", s_bounds[b] );
+                else snprintf( buf, sizeof(buf), ",le=\"+Inf\"" );
+                s_sample( out, "eclib_poll_latency_seconds_bucket", labels + buf, (double)count );
+            }
+            s_sample( out, "eclib_poll_latency_seconds_sum", labels, m.LatencySum );
+            s_sample( out, "eclib_poll_latency_seconds_count", labels, (double)count );
+        }
+    }
+
+    s_family( out, "eclib_errors_total", "counter", "Errors returned by the library, by code of TErrorCodes_e." );
+    for( size_t d = 0; d < all.size(); d++ ){
+        for( size_t e = 0; e < all[d].Errors.size(); e++ ){
+            const TErrorMetrics_t& m = all[d].Errors[e];
+            const char* name = MET_ErrorName( m.Code );
+            std::string labels = s_channelLabels( all[d], m.Channel ) + ",code=\"" + ( name ? std::to_string( m.Code ) : std::string( "other" ) ) +
+                                 "\",name=\"" + ( name ? name : "" ) + "\"";
+            s_sample( out, "eclib_errors_total", labels, (double)m.Count );
+        }
+    }
+
+    s_family( out, "eclib_thread_cpu_seconds_total", "counter", "CPU time of the threads of the acquisition." );
+    for( size_t d = 0; d < all.size(); d++ ){
+        for( size_t t = 0; t < all[d].Threads.size(); t++ ){
+            const TThreadMetrics_t& m = all[d].Threads[t];
+            s_sample( out, "eclib_thread_cpu_seconds_total", "device=\"" + s_label( all[d].Device ) + "\",thread=\"" + s_label( m.Name ) + "\"", m.CpuSeconds );
+        }
+    }
+    return out;
+}
+
+TMetricsExportConfig_t MET_DefaultExportConfig()
+{
+    TMetricsExportConfig_t config;
+    config.Address  = "127.0.0.1";
+    config.Port     = 9464;
+    config.PeriodMs = 5000;
+    return config;
+}
+
+MetricsExporter::MetricsExporter()
+    : config( MET_DefaultExportConfig() ), listener( (long long)MET_NO_SOCKET ), bound( -1 ), stopping( false ), served( 0 ), written( 0 )
+{
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    stop();
+}
+
+void MetricsExporter::add( AcqMetrics* metrics )
+{
+    if( metrics && !worker.joinable() ) list.push_back( metrics );
+}
+
+int MetricsExporter::start( const TMetricsExportConfig_t& settings )
+{
+    if( worker.joinable() ) return ERR_GEN_FUNCTIONINPROGRESS;
+    if( list.empty() || ( settings.Port < 0 && settings.Path.empty() ) || settings.Port > 65535 ||
+        ( !settings.Path.empty() && settings.PeriodMs == 0 ) ) return ERR_GEN_INVALIDPARAMETERS;
+    config = settings;
+    bound  = -1;
+
+    if( config.Port >= 0 ){
+#ifdef _WIN32
+        WSADATA wsa;
+        if( WSAStartup( MAKEWORD( 2, 2 ), &wsa ) != 0 ) return ERR_GEN_FUNCTIONFAILED;
+#endif
+        struct sockaddr_in addr;
+        memset( &addr, 0, sizeof(addr) );
+        addr.sin_family = AF_INET;
+        addr.sin_port   = htons( (unsigned short)config.Port );
+        if( inet_pton( AF_INET, config.Address.c_str(), &addr.sin_addr ) != 1 ) return ERR_GEN_INVALIDPARAMETERS;
+        TSocket_t s = socket( AF_INET, SOCK_STREAM, 0 );
+        if( s == MET_NO_SOCKET ) return ERR_GEN_FUNCTIONFAILED;
+        int yes = 1;
+        setsockopt( s, SOL_SOCKET, SO_REUSEADDR, (const char*)&yes, sizeof(yes) );
+        socklen_t size = sizeof(addr);
+        if( bind( s, (struct sockaddr*)&addr, sizeof(addr) ) != 0 || listen( s, 8 ) != 0 ||
+            getsockname( s, (struct sockaddr*)&addr, &size ) != 0 ){
+            s_closeSocket( s );
+            return ERR_GEN_FUNCTIONFAILED;
+        }
+        listener = (long long)s;
+        bound    = ntohs( addr.sin_port );
+    }
+    stopping = false;
+    worker = std::thread( &MetricsExporter::run, this );
+    return ERR_NOERROR;
+}
+
+void MetricsExporter::stop()
+{
+    {
+        std::lock_guard<std::mutex> guard( wake_lock );
+        stopping = true;
+    }
+    wake.notify_all();
+    if( worker.joinable() ) worker.join();
+    if( (TSocket_t)listener != MET_NO_SOCKET ){
+        s_closeSocket( (TSocket_t)listener );
+        listener = (long long)MET_NO_SOCKET;
+#ifdef _WIN32
+        WSACleanup();
+#endif
+    }
+}
+
+static void s_setupClient( TSocket_t s ){
+#ifdef SO_NOSIGPIPE
+    int yes = 1;
+    setsockopt( s, SOL_SOCKET, SO_NOSIGPIPE, &yes, sizeof(yes) );
+#endif
+    /* a client which does not read cannot hold the thread */
+#ifdef _WIN32
+    DWORD ms = MET_SEND_MS;
+    setsockopt( s, SOL_SOCKET, SO_SNDTIMEO, (const char*)&ms, sizeof(ms) );
+#else
+    struct timeval tv;
+    tv.tv_sec  = MET_SEND_MS / 1000;
+    tv.tv_usec = ( MET_SEND_MS % 1000 ) * 1000;
+    setsockopt( s, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv) );
+#endif
+}
+
+static bool s_requestComplete( const std::string& request ){
+    return request.size() >= MET_REQUEST_SIZE || request.find( "\r\n\r\n" ) != std::string::npos ||
+           request.find( "\n\n" ) != std::string::npos;
+}
+
+void MetricsExporter::run()
+{
+    /* the clients are read together: one which stalls does not delay the others */
+    std::vector<TMetClient_t> clients;
+    long long next = s_clockNs();
+    for( ;; ){
+        long long now = s_clockNs();
+        if( !config.Path.empty() && now >= next ){
+            writeFile();
+            next = now + (long long)config.PeriodMs * 1000000LL;
+        }
+        long long left = config.Path.empty() ? MET_SELECT_MS * 1000000LL : next - now;
+
+        if( (TSocket_t)listener == MET_NO_SOCKET ){
+            std::unique_lock<std::mutex> guard( wake_lock );
+            if( stopping ) break;
+            wake.wait_for( guard, std::chrono::nanoseconds( left > 0 ? left : 0 ) );
+            if( stopping ) break;
+            continue;
+        }
+
+        /* the connections, a stop seen within MET_SELECT_MS */
+        {
+            std::lock_guard<std::mutex> guard( wake_lock );
+            if( stopping ) break;
+        }
+        if( left > MET_SELECT_MS * 1000000LL ) left = MET_SELECT_MS * 1000000LL;
+        if( left < 0 ) left = 0;
+        TSocket_t s = (TSocket_t)listener;
+        TSocket_t highest = s;
+        fd_set ready;
+        FD_ZERO( &ready );
+        if( clients.size() < MET_MAX_CLIENTS ) FD_SET( s, &ready );
+        for( size_t i = 0; i < clients.size(); i++ ){
+            FD_SET( clients[i].Socket, &ready );
+            if( clients[i].Socket > highest ) highest = clients[i].Socket;
+        }
+        struct timeval tv;
+        tv.tv_sec  = (long)( left / 1000000000LL );
+        tv.tv_usec = (long)( left % 1000000000LL / 1000 );
+        if( select( (int)highest + 1, &ready, 0, 0, &tv ) <= 0 ) FD_ZERO( &ready );
+        now = s_clockNs();
+
+        /* the request line and the headers, up to the empty line */
+        for( size_t i = 0; i < clients.size(); ){
+            TMetClient_t& c = clients[i];
+            bool done = now >= c.Until, failed = false;
+            if( FD_ISSET( c.Socket, &ready ) ){
+                char chunk[MET_REQUEST_SIZE];
+                int n = (int)recv( c.Socket, chunk, (int)( MET_REQUEST_SIZE - c.Request.size() ), 0 );
+                if( n > 0 ){
+                    c.Request.append( chunk, n );
+                    done = s_requestComplete( c.Request );
+                } else {
+                    /* reset, or closed before a request: nobody to answer */
+                    failed = ( n < 0 || c.Request.empty() );
+                    done = true;
+                }
+            }
+            if( !done ){
+                i++;
+                continue;
+            }
+            if( failed ) s_closeSocket( c.Socket );
+            else answer( (long long)c.Socket, c.Request );
+            clients.erase( clients.begin() + i );
+        }
+
+        if( FD_ISSET( s, &ready ) ){
+            TSocket_t client = accept( s, 0, 0 );
+            if( client != MET_NO_SOCKET ){
+                s_setupClient( client );
+                TMetClient_t c;
+                c.Socket = client;
+                c.Until  = now + MET_REQUEST_MS * 1000000LL;
+                clients.push_back( c );
+            }
+        }
+    }
+    for( size_t i = 0; i < clients.size(); i++ ) s_closeSocket( clients[i].Socket );
+    if( !config.Path.empty() ) writeFile();
+}
+
+void MetricsExporter::answer( long long socket, const std::string& text )
+{
+    TSocket_t client = (TSocket_t)socket;
+    const char* request = text.c_str();
+
+    std::string body, status = "200 OK";
+    if( strncmp( request, "GET /metrics ", 13 ) == 0 || strncmp( request, "GET / ", 6 ) == 0 ||
+        strncmp( request, "GET /metrics?", 13 ) == 0 ){
+        body = MET_Text( list );
+    } else if( strncmp( request, "GET ", 4 ) == 0 ){
+        status = "404 Not Found";
+        body   = "only /metrics here\n";
+    } else {
+        status = "405 Method Not Allowed";
+        body   = "GET only\n";
+    }
+    std::string response = "HTTP/1.1 " + status + "\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\nContent-Length: " +
+                           std::to_string( body.size() ) + "\r\nConnection: close\r\n\r\n" + body;
+    size_t sent = 0;
+    while( sent < response.size() ){
+        int n = (int)send( client, response.data() + sent, (int)( response.size() - sent ), MET_SEND_FLAGS );
+        if( n <= 0 ) break;
+        sent += n;
+    }
+    s_closeSocket( client );
+    served++;
+}
+
+int MetricsExporter::writeFile()
+{
+    /* written aside, then put in place in one step */
+    std::string text = MET_Text( list );
+    std::string part = config.Path + ".part";
+    FILE* f = fopen( part.c_str(), "wb" );
+    if( !f ) return ERR_GEN_FILENOTEXISTS;
+    bool ok = fwrite( text.data(), 1, text.size(), f ) == text.size();
+    ok = ( fclose( f ) == 0 ) && ok;
+#ifdef _WIN32
+    ok = ok && MoveFileExA( part.c_str(), config.Path.c_str(), MOVEFILE_REPLACE_EXISTING ) != 0;
+#else
+    ok = ok && rename( part.c_str(), config.Path.c_str() ) == 0;
+#endif
+    if( !ok ){
+        remove( part.c_str() );
+        return ERR_GEN_FUNCTIONFAILED;
+    }
+    written++;
+    return ERR_NOERROR;
+}
@@ -0,0 +1,236 @@
+#pragma once
+
+#ifndef _METRICS_H_
+#define _METRICS_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <BLStructs.h>
+
+/*
+ * Metrics of the acquisition, in the text format of Prometheus
+ *
+ * The poll loop records each BL_GetData (points read, points dropped by the
+ * instrument in IRQskipped, memory filled, time of the call), the error codes
+ * returned by the library and the frames the program had to drop itself. The
+ * counters are atomic and updated without lock nor allocation: a poll costs a
+ * few relaxed additions to the counters of its channel, which sit on cache
+ * lines of their own. The threads of the acquisition register themselves to
+ * have their CPU time exported.
+ *
+ * The metrics are read (snapshot, text) while the acquisition goes on; a
+ * MetricsExporter serves them over HTTP on a local address (GET /metrics) and
+ * writes them to a file at a fixed period, replaced at once so that a reader
+ * (the textfile collector of node_exporter, a script) never sees half of it.
+ */
+
+/**
+ * \defgroup metrics Metrics
+ * @{
+ */
+
+/** Channel of an error which concerns none (BL_Connect, ...) */
+#define MET_NONE            (-1)
+/** Code of the errors not in \ref TErrorCodes_e, counted together */
+#define MET_OTHER           (1)
+/** Bounds of the buckets of the poll latency histogram, s (the last one, +Inf, is implied) */
+#define MET_NB_BUCKETS      (12)
+/** Least time (s) over which the points per second are measured */
+#define MET_RATE_WINDOW     (1.0)
+
+/** Metrics of a channel */
+typedef struct {
+    int                Channel;          /*!< 0..15 */
+    unsigned long long Polls;            /*!< BL_GetData which succeeded */
+    unsigned long long Points;           /*!< rows read */
+    double             PointsPerSecond;  /*!< over the last \ref MET_RATE_WINDOW at least */
+    unsigned long long Skipped;          /*!< points dropped by the instrument (IRQskipped) */
+    unsigned long long Dropped;          /*!< frames dropped by the program */
+    unsigned long long Bytes;            /*!< of the data buffers read */
+    int                MemFilled;        /*!< bytes, at the last poll */
+    int                MemSize;          /*!< bytes, 0 if unknown */
+    double             LatencySum;       /*!< s, of the BL_GetData */
+    unsigned long long Latency[MET_NB_BUCKETS + 1]; /*!< calls per bucket, not cumulative; the last one above all bounds */
+} TChannelMetrics_t;
+
+/** Errors of a code */
+typedef struct {
+    int                Channel;          /*!< 0..15, \ref MET_NONE */
+    int                Code;             /*!< see \ref TErrorCodes_e, \ref MET_OTHER */
+    unsigned long long Count;
+} TErrorMetrics_t;
+
+/** CPU of a thread */
+typedef struct {
+    std::string Name;
+    double      CpuSeconds;
+    bool        Running;                 /*!< false once unregistered: the time is the last one */
+} TThreadMetrics_t;
+
+/** All the metrics of an \ref AcqMetrics */
+typedef struct {
+    std::string                    Device;
+    std::vector<TChannelMetrics_t> Channels;   /*!< those polled or given a memory size */
+    std::vector<TErrorMetrics_t>   Errors;     /*!< non-zero counts only */
+    std::vector<TThreadMetrics_t>  Threads;
+} TMetricsSnapshot_t;
+
+/** Bound of a bucket of the poll latency histogram, s */
+double MET_LatencyBound( int bucket );
+
+/** Name of an error code of \ref TErrorCodes_e ("ERR_GEN_NOTCONNECTED", ...), null if unknown */
+const char* MET_ErrorName( int code );
+
+/**
+ * This class counts the metrics of a device. The record functions may be called
+ * by any thread at any time.
+ */
+class AcqMetrics
+{
+public:
+    /** @param device value of the "device" label of the metrics */
+    AcqMetrics( const char* device = "0" );
+    ~AcqMetrics();
+
+    /** Memory of a channel (given by BL_GetChannelInfos), for the fill */
+    void setMemSize( uint8 channel, int bytes );
+
+    /**
+     * A BL_GetData which succeeded.
+     * @param ns time of the call, ns
+     */
+    void recordPoll( uint8 channel, long long ns, const TDataInfos_t& infos, const TCurrentValues_t& curr );
+
+    /** An error returned by a function of the library on a channel (or \ref MET_NONE) */
+    void recordError( int channel, int code );
+
+    /** Frames of a channel dropped by the program (a queue full, ...) */
+    void recordDropped( uint8 channel, unsigned int frames );
+
+    /**
+     * The calling thread has its CPU time exported under a name; it must call
+     * \ref unregisterThread before it ends.
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_FUNCTIONFAILED if the CPU time of a
+     *         thread cannot be read on this system.
+     */
+    int registerThread( const char* name );
+    void unregisterThread();
+
+    /** The metrics now */
+    TMetricsSnapshot_t snapshot();
+
+    /** Same, in the text format of Prometheus */
+    std::string text();
+
+private:
+    AcqMetrics( const AcqMetrics& );
+    AcqMetrics& operator=( const AcqMetrics& );
+
+    struct alignas(64) TChannelCounters_t {
+        std::atomic<unsigned long long> Points;
+        std::atomic<unsigned long long> Skipped;
+        std::atomic<unsigned long long> Dropped;
+        std::atomic<unsigned long long> Bytes;
+        std::atomic<unsigned long long> LatencyNs;
+        std::atomic<unsigned long long> Latency[MET_NB_BUCKETS + 1];
+        std::atomic<int>                MemFilled;
+        std::atomic<int>                MemSize;
+        std::atomic<bool>               Used;
+    };
+
+    typedef struct {
+        std::string        Name;
+        unsigned long long Key;       /* of the thread */
+        unsigned long long Clock;     /* clockid_t, HANDLE */
+        double             Last;      /* CPU s, once unregistered */
+        bool               Running;
+    } TThread_t;
+
+    typedef struct {
+        unsigned long long Points;
+        double             Time;
+        double             Rate;
+    } TRate_t;
+
+    std::string        device;
+    TChannelCounters_t channels[16];
+    std::atomic<unsigned long long>* errors;   /* [17][error codes], the last row for MET_NONE */
+    std::mutex         lock;                   /* threads and rates, never taken by the record functions */
+    std::vector<TThread_t> threads;
+    TRate_t            rates[16];
+    long long          origin;
+};
+
+/** Where a \ref MetricsExporter publishes */
+typedef struct {
+    std::string  Address;    /*!< of the HTTP endpoint, "127.0.0.1" for this computer only */
+    int          Port;       /*!< of the HTTP endpoint, 0 for any free port, < 0 for none */
+    std::string  Path;       /*!< file written, empty for none */
+    unsigned int PeriodMs;   /*!< between two writes of the file */
+} TMetricsExportConfig_t;
+
+/** Default: http://127.0.0.1:9464/metrics, no file, 5 s */
+TMetricsExportConfig_t MET_DefaultExportConfig();
+
+/** Text of the metrics of several devices (families merged) */
+std::string MET_Text( const std::vector<AcqMetrics*>& metrics );
+
+/**
+ * This class publishes the metrics of one or more devices from a thread of its
+ * own: an HTTP endpoint answering GET /metrics, a file written periodically, or both.
+ */
+class MetricsExporter
+{
+public:
+    MetricsExporter();
+    ~MetricsExporter();
+
+    /** Adds the metrics of a device, before \ref start */
+    void add( AcqMetrics* metrics );
+
+    /**
+     * This function opens the endpoint and starts the thread.
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_INVALIDPARAMETERS if there is nothing
+     *         to publish or nowhere to, \ref ERR_GEN_FUNCTIONINPROGRESS if it runs, \ref
+     *         ERR_GEN_FUNCTIONFAILED if the endpoint cannot be opened.
+     */
+    int start( const TMetricsExportConfig_t& config );
+
+    /** Writes the file one last time and stops the thread */
+    void stop();
+
+    /** Port of the endpoint (the one chosen when 0 was asked), -1 if none */
+    int port() const { return bound; }
+
+    /** Requests answered, files written */
+    unsigned long long requests() const { return served; }
+    unsigned long long writes() const { return written; }
+
+private:
+    MetricsExporter( const MetricsExporter& );
+    MetricsExporter& operator=( const MetricsExporter& );
+
+    void run();
+    void answer( long long socket, const std::string& request );
+    int  writeFile();
+
+    TMetricsExportConfig_t            config;
+    std::vector<AcqMetrics*>          list;
+    long long                         listener;
+    int                               bound;
+    std::thread                       worker;
+    std::mutex                        wake_lock;
+    std::condition_variable           wake;
+    bool                              stopping;
+    std::atomic<unsigned long long>   served;
+    std::atomic<unsigned long long>   written;
+};
+
+/** @} */
+
+#endif /* _METRICS_H_ */
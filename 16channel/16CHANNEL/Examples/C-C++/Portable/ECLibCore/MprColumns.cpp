@@ -0,0 +1,126 @@
+#include "MprFile.h"
+
+#include <algorithm>
+
+/*
+ * Column identifiers of the "VMP data" module.
+ *
+ * The identifiers 1, 2, 3, 21, 31 and 65 are not stored as values of their own:
+ * they share a single flag byte, placed where the first of them appears in the
+ * column list, and each one owns some bits of it.
+ *
+ * The table must stay sorted by identifier (binary search in MPR_GetColumnDef).
+ */
+static const TMprColumnDef_t s_columns[] = {
+    {   1, MPR_TYPE_FLAGS, 0x03, "mode",                    ""       },
+    {   2, MPR_TYPE_FLAGS, 0x04, "ox/red",                  ""       },
+    {   3, MPR_TYPE_FLAGS, 0x08, "error",                   ""       },
+    {   4, MPR_TYPE_F64,   0,    "time",                    "s"      },
+    {   5, MPR_TYPE_F32,   0,    "control",                 "V/mA"   },
+    {   6, MPR_TYPE_F32,   0,    "Ewe",                     "V"      },
+    {   7, MPR_TYPE_F64,   0,    "dQ",                      "mA.h"   },
+    {   8, MPR_TYPE_F32,   0,    "I",                       "mA"     },
+    {   9, MPR_TYPE_F32,   0,    "Ece",                     "V"      },
+    {  11, MPR_TYPE_F64,   0,    "<I>",                     "mA"     },
+    {  13, MPR_TYPE_F64,   0,    "(Q-Qo)",                  "mA.h"   },
+    {  16, MPR_TYPE_F32,   0,    "Analog IN 1",             "V"      },
+    {  19, MPR_TYPE_F32,   0,    "control",                 "V"      },
+    {  20, MPR_TYPE_F32,   0,    "control",                 "mA"     },
+    {  21, MPR_TYPE_FLAGS, 0x10, "control changes",         ""       },
+    {  23, MPR_TYPE_F64,   0,    "dQ",                      "mA.h"   },
+    {  24, MPR_TYPE_F64,   0,    "cycle number",            ""       },
+    {  26, MPR_TYPE_F32,   0,    "Rapp",                    "Ohm"    },
+    {  27, MPR_TYPE_F32,   0,    "Ewe-Ece",                 "V"      },
+    {  31, MPR_TYPE_FLAGS, 0x20, "Ns changes",              ""       },
+    {  32, MPR_TYPE_F32,   0,    "freq",                    "Hz"     },
+    {  33, MPR_TYPE_F32,   0,    "|Ewe|",                   "V"      },
+    {  34, MPR_TYPE_F32,   0,    "|I|",                     "A"      },
+    {  35, MPR_TYPE_F32,   0,    "Phase(Z)",                "deg"    },
+    {  36, MPR_TYPE_F32,   0,    "|Z|",                     "Ohm"    },
+    {  37, MPR_TYPE_F32,   0,    "Re(Z)",                   "Ohm"    },
+    {  38, MPR_TYPE_F32,   0,    "-Im(Z)",                  "Ohm"    },
+    {  39, MPR_TYPE_U16,   0,    "I Range",                 ""       },
+    {  65, MPR_TYPE_FLAGS, 0x80, "counter inc.",            ""       },
+    {  69, MPR_TYPE_F32,   0,    "R",                       "Ohm"    },
+    {  70, MPR_TYPE_F32,   0,    "P",                       "W"      },
+    {  74, MPR_TYPE_F64,   0,    "Energy",                  "W.h"    },
+    {  75, MPR_TYPE_F32,   0,    "Analog OUT",              "V"      },
+    {  76, MPR_TYPE_F32,   0,    "<I>",                     "mA"     },
+    {  77, MPR_TYPE_F32,   0,    "<Ewe>",                   "V"      },
+    {  78, MPR_TYPE_F32,   0,    "Cs-2",                    "uF-2"   },
+    {  96, MPR_TYPE_F32,   0,    "|Ece|",                   "V"      },
+    {  98, MPR_TYPE_F32,   0,    "Phase(Zce)",              "deg"    },
+    {  99, MPR_TYPE_F32,   0,    "|Zce|",                   "Ohm"    },
+    { 100, MPR_TYPE_F32,   0,    "Re(Zce)",                 "Ohm"    },
+    { 101, MPR_TYPE_F32,   0,    "-Im(Zce)",                "Ohm"    },
+    { 123, MPR_TYPE_F64,   0,    "Energy charge",           "W.h"    },
+    { 124, MPR_TYPE_F64,   0,    "Energy discharge",        "W.h"    },
+    { 125, MPR_TYPE_F64,   0,    "Capacitance charge",      "uF"     },
+    { 126, MPR_TYPE_F64,   0,    "Capacitance discharge",   "uF"     },
+    { 131, MPR_TYPE_U16,   0,    "Ns",                      ""       },
+    { 163, MPR_TYPE_F32,   0,    "|Estack|",                "V"      },
+    { 168, MPR_TYPE_F32,   0,    "Rcmp",                    "Ohm"    },
+    { 169, MPR_TYPE_F32,   0,    "Cs",                      "uF"     },
+    { 172, MPR_TYPE_F32,   0,    "Cp",                      "uF"     },
+    { 173, MPR_TYPE_F32,   0,    "Cp-2",                    "uF-2"   },
+    { 174, MPR_TYPE_F32,   0,    "<Ewe>",                   "V"      },
+    { 241, MPR_TYPE_F32,   0,    "|E1|",                    "V"      },
+    { 242, MPR_TYPE_F32,   0,    "|E2|",                    "V"      },
+    { 271, MPR_TYPE_F32,   0,    "Phase(Z1)",               "deg"    },
+    { 272, MPR_TYPE_F32,   0,    "Phase(Z2)",               "deg"    },
+    { 301, MPR_TYPE_F32,   0,    "|Z1|",                    "Ohm"    },
+    { 302, MPR_TYPE_F32,   0,    "|Z2|",                    "Ohm"    },
+    { 331, MPR_TYPE_F32,   0,    "Re(Z1)",                  "Ohm"    },
+    { 332, MPR_TYPE_F32,   0,    "Re(Z2)",                  "Ohm"    },
+    { 361, MPR_TYPE_F32,   0,    "-Im(Z1)",                 "Ohm"    },
+    { 362, MPR_TYPE_F32,   0,    "-Im(Z2)",                 "Ohm"    },
+    { 391, MPR_TYPE_F32,   0,    "<E1>",                    "V"      },
+    { 392, MPR_TYPE_F32,   0,    "<E2>",                    "V"      },
+    { 422, MPR_TYPE_F32,   0,    "Phase(Zstack)",           "deg"    },
+    { 423, MPR_TYPE_F32,   0,    "|Zstack|",                "Ohm"    },
+    { 424, MPR_TYPE_F32,   0,    "Re(Zstack)",              "Ohm"    },
+    { 425, MPR_TYPE_F32,   0,    "-Im(Zstack)",             "Ohm"    },
+    { 426, MPR_TYPE_F32,   0,    "<Estack>",                "V"      },
+    { 430, MPR_TYPE_F32,   0,    "Phase(Zwe-ce)",           "deg"    },
+    { 431, MPR_TYPE_F32,   0,    "|Zwe-ce|",                "Ohm"    },
+    { 432, MPR_TYPE_F32,   0,    "Re(Zwe-ce)",              "Ohm"    },
+    { 433, MPR_TYPE_F32,   0,    "-Im(Zwe-ce)",             "Ohm"    },
+    { 434, MPR_TYPE_F32,   0,    "(Q-Qo)",                  "C"      },
+    { 435, MPR_TYPE_F32,   0,    "dQ",                      "C"      },
+    { 441, MPR_TYPE_F32,   0,    "<Ecv>",                   "V"      },
+    { 462, MPR_TYPE_F32,   0,    "Temperature",             "degC"   },
+    { 467, MPR_TYPE_F64,   0,    "Q charge/discharge",      "mA.h"   },
+    { 468, MPR_TYPE_U32,   0,    "half cycle",              ""       },
+    { 469, MPR_TYPE_U32,   0,    "z cycle",                 ""       },
+    { 471, MPR_TYPE_F32,   0,    "<Ece>",                   "V"      },
+    { 473, MPR_TYPE_F32,   0,    "THD Ewe",                 "%"      },
+    { 474, MPR_TYPE_F32,   0,    "THD I",                   "%"      },
+    { 476, MPR_TYPE_F32,   0,    "NSD Ewe",                 "%"      },
+    { 477, MPR_TYPE_F32,   0,    "NSD I",                   "%"      },
+    { 479, MPR_TYPE_F32,   0,    "NSR Ewe",                 "%"      },
+    { 480, MPR_TYPE_F32,   0,    "NSR I",                   "%"      },
+};
+
+static bool s_lessId( const TMprColumnDef_t& def, unsigned int id ){
+    return def.Id < id;
+}
+
+const TMprColumnDef_t* MPR_GetColumnDef( unsigned int id )
+{
+    const TMprColumnDef_t* end = s_columns + sizeof(s_columns)/sizeof(s_columns[0]);
+    const TMprColumnDef_t* def = std::lower_bound( s_columns, end, id, s_lessId );
+    return ( def != end && def->Id == id ) ? def : 0;
+}
+
+size_t MPR_TypeSize( TMprValueType_e type )
+{
+    switch( type ){
+    case MPR_TYPE_FLAGS:
+    case MPR_TYPE_U8:  return 1;
+    case MPR_TYPE_U16: return 2;
+    case MPR_TYPE_U32:
+    case MPR_TYPE_F32: return 4;
+    case MPR_TYPE_F64: return 8;
+    }
+    return 0;
+}
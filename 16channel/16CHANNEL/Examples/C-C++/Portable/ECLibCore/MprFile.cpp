@@ -0,0 +1,258 @@
+#include "MprFile.h"
+
+#include <stdio.h>
+
+const char MPR_MAGIC[MPR_MAGIC_SIZE + 1] = "BIO-LOGIC MODULAR FILE\x1a";
+
+/* a "max length" field of 0xFFFFFFFF right after the long name announces the longer header */
+#define MPR_MAX_LENGTH_MARKER (0xFFFFFFFFu)
+
+static unsigned int s_readU32( const unsigned char* p ){
+    return (unsigned int)p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+static unsigned short s_readU16( const unsigned char* p ){
+    return (unsigned short)(p[0] | (p[1] << 8));
+}
+
+/* copies a blank padded field into a C-string, removing the trailing blanks */
+static void s_copyField( char* dst, const unsigned char* src, size_t len ){
+    memcpy( dst, src, len );
+    dst[len] = '\0';
+    while( len > 0 && ( dst[len-1] == ' ' || dst[len-1] == '\0' ) ){
+        dst[--len] = '\0';
+    }
+}
+
+MprFlagView::MprFlagView( const unsigned char* first, size_t stride, size_t count, unsigned char mask )
+    : first( first ), stride( stride ), count( count ), mask( mask ), shift( 0 )
+{
+    while( mask && !( mask & 1 ) ){
+        mask >>= 1;
+        shift++;
+    }
+}
+
+MprFile::MprFile()
+    : data_module( 0 )
+    , first_row( 0 )
+    , row_size( 0 )
+    , row_count( 0 )
+    , declared_rows( 0 )
+    , interrupted( false )
+{
+}
+
+MprFile::~MprFile()
+{
+    close();
+}
+
+void MprFile::close()
+{
+    mapping.close();
+    modules.clear();
+    columns.clear();
+    data_module   = 0;
+    first_row     = 0;
+    row_size      = 0;
+    row_count     = 0;
+    declared_rows = 0;
+    interrupted   = false;
+}
+
+int MprFile::fail( int code, const char* message )
+{
+    error = message;
+    close();
+    return code;
+}
+
+int MprFile::open( const char* path )
+{
+    close();
+    error.clear();
+
+    int status = mapping.open( path );
+    if( status != ERR_NOERROR ){
+        error = ( status == ERR_GEN_FILENOTEXISTS ) ? "cannot open the file" : "cannot map the file";
+        return status;
+    }
+
+    if( mapping.size() < MPR_FILE_HEADER_SIZE || memcmp( mapping.data(), MPR_MAGIC, MPR_MAGIC_SIZE ) != 0 ){
+        return fail( ERR_TECH_DATACORRUPTED, "not a BIO-LOGIC MODULAR FILE" );
+    }
+
+    status = parseModules();
+    if( status != ERR_NOERROR ) return status;
+
+    data_module = findModule( "VMP data" );
+    if( data_module ){
+        status = parseDataModule( *data_module );
+    }
+    return status;
+}
+
+int MprFile::parseModules()
+{
+    const unsigned char* base = mapping.data();
+    const size_t         size = mapping.size();
+    size_t               offset = MPR_FILE_HEADER_SIZE;
+
+    while( offset < size ){
+        if( size - offset < MPR_MODULE_HEADER_SIZE || memcmp( base + offset, "MODULE", MPR_MODULE_TAG_SIZE ) != 0 ){
+            return fail( ERR_TECH_DATACORRUPTED, "invalid module header" );
+        }
+
+        TMprModule_t mod;
+        const unsigned char* hdr = base + offset + MPR_MODULE_TAG_SIZE;
+        s_copyField( mod.ShortName, hdr,      10 );
+        s_copyField( mod.LongName,  hdr + 10, 25 );
+        hdr += 35;
+
+        size_t header_size = MPR_MODULE_HEADER_SIZE;
+        if( s_readU32( hdr ) == MPR_MAX_LENGTH_MARKER ){
+            if( size - offset < MPR_MODULE_HEADER_V2_SIZE ){
+                return fail( ERR_TECH_DATACORRUPTED, "truncated module header" );
+            }
+            mod.Length  = s_readU32( hdr + 4 );
+            mod.Version = s_readU32( hdr + 8 );
+            s_copyField( mod.Date, hdr + 16, 8 );
+            header_size = MPR_MODULE_HEADER_V2_SIZE;
+        } else {
+            mod.Length  = s_readU32( hdr );
+            mod.Version = s_readU32( hdr + 4 );
+            s_copyField( mod.Date, hdr + 8, 8 );
+        }
+
+        mod.HeaderOffset = offset;
+        mod.DataOffset   = offset + header_size;
+
+        size_t available = size - mod.DataOffset;
+        if( mod.Length > available ){
+            /* only the data module may be cut short (interrupted acquisition), and only if it is the last one */
+            if( strcmp( mod.ShortName, "VMP data" ) != 0 ){
+                return fail( ERR_TECH_DATACORRUPTED, "module longer than the file" );
+            }
+            mod.Length = (unsigned int)available;
+        }
+
+        offset = mod.DataOffset + mod.Length;
+
+        /* a data module followed by something else than a module is being written (or its
+           writer died): the header was not fixed up yet, the rows go up to the end of the file */
+        if( strcmp( mod.ShortName, "VMP data" ) == 0 && offset < size
+            && ( size - offset < MPR_MODULE_TAG_SIZE || memcmp( base + offset, "MODULE", MPR_MODULE_TAG_SIZE ) != 0 ) ){
+            mod.Length  = (unsigned int)( size - mod.DataOffset );
+            offset      = size;
+            interrupted = true;
+        }
+
+        modules.push_back( mod );
+    }
+    return ERR_NOERROR;
+}
+
+int MprFile::parseDataModule( const TMprModule_t& mod )
+{
+    const unsigned char* data = mapping.data() + mod.DataOffset;
+    size_t header_size = MPR_DATA_NBPOINTS_SIZE + MPR_DATA_NBCOLS_SIZE;
+
+    if( mod.Length < header_size ){
+        return fail( ERR_TECH_DATACORRUPTED, "truncated data module" );
+    }
+
+    declared_rows = s_readU32( data );
+    size_t nb_cols = data[MPR_DATA_NBPOINTS_SIZE];
+
+    size_t id_size, rows_offset;
+    switch( mod.Version ){
+    case 0:  id_size = 1; rows_offset = MPR_DATA_V0_ROWS_OFFSET; break;
+    case 2:  id_size = 2; rows_offset = MPR_DATA_V2_ROWS_OFFSET; break;
+    case 3:  id_size = 2; rows_offset = MPR_DATA_V3_ROWS_OFFSET; break;
+    default:
+        return fail( ERR_GEN_FUNCTIONFAILED, "unsupported data module version" );
+    }
+
+    if( mod.Length < rows_offset || header_size + nb_cols * id_size > rows_offset ){
+        return fail( ERR_TECH_DATACORRUPTED, "truncated data module" );
+    }
+
+    /* build the row layout from the column identifiers */
+    size_t flags_offset = (size_t)-1;
+    row_size = 0;
+    for( size_t c = 0; c < nb_cols; c++ ){
+        const unsigned char* p = data + header_size + c * id_size;
+        unsigned short id = ( id_size == 1 ) ? p[0] : s_readU16( p );
+
+        TMprColumn_t col;
+        col.Id  = id;
+        col.Def = MPR_GetColumnDef( id );
+        if( !col.Def ){
+            char msg[64];
+            snprintf( msg, sizeof(msg), "unknown column identifier %u", (unsigned int)id );
+            return fail( ERR_GEN_FUNCTIONFAILED, msg );
+        }
+
+        if( col.Def->Type == MPR_TYPE_FLAGS ){
+            /* all the flags share one byte, created by the first flag column */
+            if( flags_offset == (size_t)-1 ){
+                flags_offset = row_size;
+                row_size += 1;
+            }
+            col.Offset = flags_offset;
+        } else {
+            col.Offset = row_size;
+            row_size  += MPR_TypeSize( col.Def->Type );
+        }
+        columns.push_back( col );
+    }
+
+    first_row = data + rows_offset;
+    row_count = 0;
+    if( row_size > 0 ){
+        size_t complete_rows = ( mod.Length - rows_offset ) / row_size;
+        row_count = ( declared_rows < complete_rows && !interrupted ) ? declared_rows : complete_rows;
+    }
+    return ERR_NOERROR;
+}
+
+const TMprModule_t* MprFile::findModule( const char* shortname ) const
+{
+    for( size_t i = 0; i < modules.size(); i++ ){
+        if( strcmp( modules[i].ShortName, shortname ) == 0 ) return &modules[i];
+    }
+    return 0;
+}
+
+int MprFile::findColumn( unsigned int id ) const
+{
+    for( size_t i = 0; i < columns.size(); i++ ){
+        if( columns[i].Id == id ) return (int)i;
+    }
+    return -1;
+}
+
+int MprFile::flags( unsigned int id, MprFlagView& out ) const
+{
+    int idx = findColumn( id );
+    if( idx < 0 || columns[idx].Def->Type != MPR_TYPE_FLAGS ) return ERR_GEN_INVALIDPARAMETERS;
+    out = MprFlagView( first_row + columns[idx].Offset, row_size, row_count, columns[idx].Def->Mask );
+    return ERR_NOERROR;
+}
+
+double MprFile::valueAt( size_t col, size_t row ) const
+{
+    const TMprColumn_t&  c = columns[col];
+    const unsigned char* p = first_row + row * row_size + c.Offset;
+
+    switch( c.Def->Type ){
+    case MPR_TYPE_FLAGS: return MprFlagView( p, 0, 1, c.Def->Mask )[0];
+    case MPR_TYPE_U8:    return p[0];
+    case MPR_TYPE_U16:   return MprColumnView<unsigned short>( p, 0, 1 )[0];
+    case MPR_TYPE_U32:   return MprColumnView<unsigned int>( p, 0, 1 )[0];
+    case MPR_TYPE_F32:   return MprColumnView<float>( p, 0, 1 )[0];
+    case MPR_TYPE_F64:   return MprColumnView<double>( p, 0, 1 )[0];
+    }
+    return 0.0;
+}
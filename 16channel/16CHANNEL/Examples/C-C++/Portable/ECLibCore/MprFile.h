@@ -0,0 +1,271 @@
+#pragma once
+
+#ifndef _MPRFILE_H_
+#define _MPRFILE_H_
+
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include <BLStructs.h>
+#include "MappedFile.h"
+
+/*
+ * Reader for the EC-Lab binary data files (*.mpr)
+ *
+ * A .mpr file is a "BIO-LOGIC MODULAR FILE" header followed by a sequence of
+ * modules, each one introduced by the "MODULE" tag: "VMP Set" (settings),
+ * "VMP data" (the measured points) and "VMP LOG" (log). The data module holds
+ * the number of points, the list of column identifiers and then the points
+ * themselves, row after row, as packed little-endian values.
+ */
+
+/**
+ * \defgroup mpr_files EC-Lab .mpr files
+ * @{
+ */
+
+/** Size of the file header ("BIO-LOGIC MODULAR FILE" magic, padding and 4 zero bytes) */
+#define MPR_FILE_HEADER_SIZE  (0x34)
+/** Size of the magic string at the beginning of the file (including the 0x1A terminator) */
+#define MPR_MAGIC_SIZE        (23)
+/** Size of the "MODULE" tag */
+#define MPR_MODULE_TAG_SIZE   (6)
+/** Size of a module header (tag included) for the files written by EC-Lab up to v11.4x */
+#define MPR_MODULE_HEADER_SIZE    (MPR_MODULE_TAG_SIZE + 10 + 25 + 4 + 4 + 8)
+/** Size of a module header (tag included) with the "max length" field of later EC-Lab versions */
+#define MPR_MODULE_HEADER_V2_SIZE (MPR_MODULE_TAG_SIZE + 10 + 25 + 4 + 4 + 4 + 4 + 8)
+
+/** The data module starts with the number of points (u32) and the number of columns (u8) */
+#define MPR_DATA_NBPOINTS_SIZE (4)
+#define MPR_DATA_NBCOLS_SIZE   (1)
+
+/** Offset of the first row in the data module, depending on the module version */
+#define MPR_DATA_V0_ROWS_OFFSET (100)
+#define MPR_DATA_V2_ROWS_OFFSET (0x195)
+#define MPR_DATA_V3_ROWS_OFFSET (0x196)
+
+extern const char MPR_MAGIC[MPR_MAGIC_SIZE + 1];
+
+/** Binary types of the values stored in the data module */
+typedef enum {
+    MPR_TYPE_FLAGS = 0, /*!< bit field of the flag byte shared by several columns (see \ref TMprColumnDef_t::Mask) */
+    MPR_TYPE_U8    = 1, /*!< unsigned 8 bits integer */
+    MPR_TYPE_U16   = 2, /*!< unsigned 16 bits integer */
+    MPR_TYPE_U32   = 3, /*!< unsigned 32 bits integer */
+    MPR_TYPE_F32   = 4, /*!< single precision float */
+    MPR_TYPE_F64   = 5  /*!< double precision float */
+} TMprValueType_e;
+
+/** Description of a column identifier of the data module */
+typedef struct {
+    unsigned short  Id;   /*!< column identifier, as stored in the data module */
+    TMprValueType_e Type; /*!< binary type of the values */
+    unsigned char   Mask; /*!< bits used in the flag byte (\ref MPR_TYPE_FLAGS only, 0 otherwise) */
+    const char*     Name; /*!< column name, as shown by EC-Lab */
+    const char*     Unit; /*!< column unit, empty if the value has no unit */
+} TMprColumnDef_t;
+
+/** A module of the file, as found while walking the module headers */
+typedef struct {
+    char         ShortName[11]; /*!< module short name, e.g. "VMP data" (trailing spaces removed) */
+    char         LongName[26];  /*!< module long name (trailing spaces removed) */
+    char         Date[9];       /*!< date of the module, mm/dd/yy */
+    unsigned int Version;       /*!< module version */
+    unsigned int Length;        /*!< length of the module data (bytes) */
+    size_t       HeaderOffset;  /*!< offset of the "MODULE" tag in the file */
+    size_t       DataOffset;    /*!< offset of the module data in the file */
+} TMprModule_t;
+
+/** A column of the data module */
+typedef struct {
+    unsigned short         Id;     /*!< column identifier */
+    const TMprColumnDef_t* Def;    /*!< column description */
+    size_t                 Offset; /*!< offset of the value inside a row (bytes) */
+} TMprColumn_t;
+
+/**
+ * This function returns the description of a column identifier.
+ *
+ * @param id column identifier found in the data module
+ * @return a pointer to a static description, or 0 if the identifier is unknown.
+ */
+const TMprColumnDef_t* MPR_GetColumnDef( unsigned int id );
+
+/** This function returns the size in bytes of a value of the given type (1 for the flags). */
+size_t MPR_TypeSize( TMprValueType_e type );
+
+/** Maps the C++ types to the \ref TMprValueType_e values, used to type-check the views */
+template<typename T> struct MprTypeOf;
+template<> struct MprTypeOf<unsigned char>  { static const TMprValueType_e value = MPR_TYPE_U8;  };
+template<> struct MprTypeOf<unsigned short> { static const TMprValueType_e value = MPR_TYPE_U16; };
+template<> struct MprTypeOf<unsigned int>   { static const TMprValueType_e value = MPR_TYPE_U32; };
+template<> struct MprTypeOf<float>          { static const TMprValueType_e value = MPR_TYPE_F32; };
+template<> struct MprTypeOf<double>         { static const TMprValueType_e value = MPR_TYPE_F64; };
+
+/**
+ * Typed view on one column of the data module. The view does not copy anything:
+ * it points into the file mapping and reads the values in place, one row stride
+ * apart. The rows are packed, so the values are read with memcpy to stay safe
+ * on unaligned addresses (compilers turn it into a single load).
+ *
+ * The view is only valid while the \ref MprFile it comes from is open.
+ */
+template<typename T>
+class MprColumnView
+{
+public:
+    MprColumnView() : first( 0 ), stride( 0 ), count( 0 ) {}
+    MprColumnView( const unsigned char* first, size_t stride, size_t count )
+        : first( first ), stride( stride ), count( count ) {}
+
+    T operator[]( size_t row ) const {
+        T value;
+        memcpy( &value, first + row * stride, sizeof(T) );
+        return value;
+    }
+    size_t size() const { return count; }
+    bool   empty() const { return count == 0; }
+
+private:
+    const unsigned char* first;
+    size_t               stride;
+    size_t               count;
+};
+
+/** View on a flag column: the bits of the shared flag byte selected by the column mask */
+class MprFlagView
+{
+public:
+    MprFlagView() : first( 0 ), stride( 0 ), count( 0 ), mask( 0 ), shift( 0 ) {}
+    MprFlagView( const unsigned char* first, size_t stride, size_t count, unsigned char mask );
+
+    unsigned char operator[]( size_t row ) const {
+        return (unsigned char)(( first[row * stride] & mask ) >> shift);
+    }
+    size_t size() const { return count; }
+
+private:
+    const unsigned char* first;
+    size_t               stride;
+    size_t               count;
+    unsigned char        mask;
+    unsigned char        shift;
+};
+
+/**
+ * This class memory-maps a .mpr file, walks its module headers and exposes the columns
+ * of the data module as views on the mapping.
+ *
+ * Short example:
+ \code
+
+ MprFile mpr;
+ if( mpr.open( "data/test_C16.mpr" ) == ERR_NOERROR ){
+     MprColumnView<double> time;
+     MprColumnView<float>  ewe;
+     if( mpr.view( 4, time ) == ERR_NOERROR && mpr.view( 6, ewe ) == ERR_NOERROR ){
+         for( size_t i=0; i<mpr.rowCount(); i++ )
+             printf( "%g %g\n", time[i], ewe[i] );
+     }
+ }
+
+ \endcode
+ */
+class MprFile
+{
+public:
+    MprFile();
+    ~MprFile();
+
+    /**
+     * This function maps the file, checks the magic string and walks the modules.
+     * A data module whose point count exceeds the bytes present in the file, or which
+     * is followed by rows its header does not count yet (typically a file whose
+     * acquisition was interrupted), is exposed with the complete rows only.
+     *
+     * @param path path of the .mpr file
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_FILENOTEXISTS if the file cannot
+     *         be opened, \ref ERR_TECH_DATACORRUPTED if the file is not a valid .mpr file
+     *         and \ref ERR_GEN_FUNCTIONFAILED if the data module uses an unsupported layout
+     *         (see \ref errorMessage).
+     */
+    int  open( const char* path );
+    void close();
+
+    /** Human readable description of the last error returned by \ref open */
+    const char* errorMessage() const { return error.c_str(); }
+
+    size_t              moduleCount() const { return modules.size(); }
+    const TMprModule_t& module( size_t i ) const { return modules[i]; }
+    /** Returns the first module with this short name (e.g. "VMP data"), or 0 */
+    const TMprModule_t* findModule( const char* shortname ) const;
+
+    /** Data module, or 0 if the file has none */
+    const TMprModule_t* dataModule() const { return data_module; }
+
+    size_t              rowCount() const { return row_count; }
+    size_t              rowSize() const { return row_size; }
+    /** Number of points announced by the data module header (may differ from \ref rowCount) */
+    size_t              declaredRowCount() const { return declared_rows; }
+    /**
+     * True if the data module was still being written: rows follow the length announced
+     * by its header. All the complete rows are then exposed, whatever the declared count.
+     */
+    bool                isInterrupted() const { return interrupted; }
+    /** Pointer to the first row of the data module */
+    const unsigned char* rows() const { return first_row; }
+
+    size_t              columnCount() const { return columns.size(); }
+    const TMprColumn_t& column( size_t i ) const { return columns[i]; }
+    /** Returns the index of the column with this identifier, or -1 */
+    int                 findColumn( unsigned int id ) const;
+
+    /**
+     * This function returns a typed view on a column.
+     *
+     * @param id column identifier (see \ref MPR_GetColumnDef)
+     * @param out view to initialize
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_INVALIDPARAMETERS if the column
+     *         does not exist or its type is not T.
+     */
+    template<typename T>
+    int view( unsigned int id, MprColumnView<T>& out ) const {
+        int idx = findColumn( id );
+        if( idx < 0 || columns[idx].Def->Type != MprTypeOf<T>::value ) return ERR_GEN_INVALIDPARAMETERS;
+        out = MprColumnView<T>( first_row + columns[idx].Offset, row_size, row_count );
+        return ERR_NOERROR;
+    }
+
+    /** Same as \ref view for the flag columns (mode, ox/red, error, control changes, ...) */
+    int  flags( unsigned int id, MprFlagView& out ) const;
+
+    /** Reads any value as a double, whatever its type. Convenient but slower than the views. */
+    double valueAt( size_t col, size_t row ) const;
+
+    /** Access to the underlying mapping */
+    const MappedFile& file() const { return mapping; }
+
+private:
+    MprFile( const MprFile& );
+    MprFile& operator=( const MprFile& );
+
+    int  parseModules();
+    int  parseDataModule( const TMprModule_t& mod );
+    int  fail( int code, const char* message );
+
+    MappedFile                 mapping;
+    std::vector<TMprModule_t>  modules;
+    std::vector<TMprColumn_t>  columns;
+    const TMprModule_t*        data_module;
+    const unsigned char*       first_row;
+    size_t                     row_size;
+    size_t                     row_count;
+    size_t                     declared_rows;
+    bool                       interrupted;
+    std::string                error;
+};
+
+/** @} */
+
+#endif /* _MPRFILE_H_ */
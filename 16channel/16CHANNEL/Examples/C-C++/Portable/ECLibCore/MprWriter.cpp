@@ -0,0 +1,340 @@
+#include "MprWriter.h"
+
+#include <string.h>
+#include <time.h>
+#include <chrono>
+
+#include "FileUtils.h"
+
+/* size of the zero-filled settings and log modules written without template */
+#define MPR_BLANK_SETTINGS_SIZE (1024)
+#define MPR_BLANK_LOG_SIZE      (256)
+
+/* EC-Lab "mode" flag values */
+#define MPR_MODE_GALVANO  (1)
+#define MPR_MODE_POTENTIO (2)
+#define MPR_MODE_REST     (3)
+
+/* 1 A = 1000 mA, 1 C = 1/3.6 mA.h */
+#define MPR_A_TO_MA   (1000.0)
+#define MPR_C_TO_MAH  (1.0 / 3.6)
+
+static double s_now(){
+    return std::chrono::duration<double>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+static void s_putU32( unsigned char* p, unsigned int v ){
+    p[0] = (unsigned char)v; p[1] = (unsigned char)(v >> 8); p[2] = (unsigned char)(v >> 16); p[3] = (unsigned char)(v >> 24);
+}
+
+template<typename T>
+static void s_put( unsigned char* p, T value ){
+    memcpy( p, &value, sizeof(T) ); /* the .mpr files are little-endian, as the hosts ECLib runs on */
+}
+
+static int s_mode( int technique_id ){
+    switch( technique_id ){
+    case KBIO_TECHID_OCV: return MPR_MODE_REST;
+    case KBIO_TECHID_CP:  return MPR_MODE_GALVANO;
+    default:              return MPR_MODE_POTENTIO;
+    }
+}
+
+static void s_addColumn( std::vector<unsigned short>& ids, unsigned short id ){
+    for( size_t i = 0; i < ids.size(); i++ ){
+        if( ids[i] == id ) return;
+    }
+    ids.push_back( id );
+}
+
+int MPR_ColumnsForTechnique( int technique_id, bool vmp4, int xrec, std::vector<unsigned short>& ids )
+{
+    ids.clear();
+    s_addColumn( ids, 1 );  /* mode */
+    s_addColumn( ids, 2 );  /* ox/red */
+    s_addColumn( ids, 4 );  /* time/s */
+
+    switch( technique_id ){
+    case KBIO_TECHID_OCV:
+        s_addColumn( ids, 6 );              /* Ewe/V */
+        if( !vmp4 ) s_addColumn( ids, 9 );  /* Ece/V */
+        break;
+    case KBIO_TECHID_CA:
+    case KBIO_TECHID_CP:
+        s_addColumn( ids, 6 );   /* Ewe/V */
+        s_addColumn( ids, 8 );   /* I/mA */
+        s_addColumn( ids, 24 );  /* cycle number */
+        break;
+    case KBIO_TECHID_CV:
+        s_addColumn( ids, 19 );  /* control/V */
+        s_addColumn( ids, 6 );   /* Ewe/V */
+        s_addColumn( ids, 8 );   /* I/mA */
+        s_addColumn( ids, 24 );  /* cycle number */
+        break;
+    default:
+        ids.clear();
+        return ERR_GEN_INVALIDPARAMETERS;
+    }
+
+    if( xrec & XREC_CE )   s_addColumn( ids, 9 );    /* Ece/V */
+    if( xrec & XREC_AUX1 ) s_addColumn( ids, 16 );   /* Analog IN 1/V */
+    if( xrec & XREC_CTL )  s_addColumn( ids, 19 );   /* control/V */
+    if( xrec & XREC_Q )    s_addColumn( ids, 434 );  /* (Q-Qo)/C */
+    if( xrec & XREC_IRG )  s_addColumn( ids, 39 );   /* I Range */
+    return ERR_NOERROR;
+}
+
+MprWriter::MprWriter()
+    : file( 0 )
+    , log_version( 0 )
+    , row_size( 0 )
+    , rows_written( 0 )
+    , pending_rows( 0 )
+    , data_header_offset( 0 )
+    , rows_offset( MPR_DATA_V2_ROWS_OFFSET )
+    , flush_rows( MPR_WRITER_FLUSH_ROWS )
+    , flush_seconds( MPR_WRITER_FLUSH_SECONDS )
+    , last_flush( 0.0 )
+{
+    date[0] = '\0';
+}
+
+MprWriter::~MprWriter()
+{
+    close();
+}
+
+int MprWriter::writeModuleHeader( const char* shortname, const char* longname, unsigned int length, unsigned int version )
+{
+    unsigned char hdr[MPR_MODULE_HEADER_SIZE];
+    memset( hdr, ' ', sizeof(hdr) );
+    memcpy( hdr, "MODULE", MPR_MODULE_TAG_SIZE );
+    memcpy( hdr + MPR_MODULE_TAG_SIZE,      shortname, strlen( shortname ) );
+    memcpy( hdr + MPR_MODULE_TAG_SIZE + 10, longname,  strlen( longname ) );
+    s_putU32( hdr + MPR_MODULE_TAG_SIZE + 35, length );
+    s_putU32( hdr + MPR_MODULE_TAG_SIZE + 39, version );
+    memcpy( hdr + MPR_MODULE_TAG_SIZE + 43, date, 8 );
+    return fwrite( hdr, 1, sizeof(hdr), file ) == sizeof(hdr) ? ERR_NOERROR : ERR_GEN_FUNCTIONFAILED;
+}
+
+int MprWriter::open( const char* path, const unsigned short* ids, size_t nb_ids, const MprFile* tpl )
+{
+    close();
+    if( !path || !ids || nb_ids == 0 || nb_ids > 255 ) return ERR_GEN_INVALIDPARAMETERS;
+
+    /* row layout, same rules as the reader */
+    columns.clear();
+    row_size = 0;
+    size_t flags_offset = (size_t)-1;
+    for( size_t c = 0; c < nb_ids; c++ ){
+        TMprColumn_t col;
+        col.Id  = ids[c];
+        col.Def = MPR_GetColumnDef( ids[c] );
+        if( !col.Def ) return ERR_GEN_INVALIDPARAMETERS;
+        if( col.Def->Type == MPR_TYPE_FLAGS ){
+            if( flags_offset == (size_t)-1 ){
+                flags_offset = row_size++;
+            }
+            col.Offset = flags_offset;
+        } else {
+            col.Offset = row_size;
+            row_size  += MPR_TypeSize( col.Def->Type );
+        }
+        columns.push_back( col );
+    }
+
+    /* settings and log modules: copies of the template, or blank */
+    std::vector<unsigned char> settings( MPR_BLANK_SETTINGS_SIZE, 0 );
+    unsigned int settings_version = 0;
+    log_module.assign( MPR_BLANK_LOG_SIZE, 0 );
+    log_version = 0;
+    if( tpl ){
+        const TMprModule_t* set = tpl->findModule( "VMP Set" );
+        const TMprModule_t* log = tpl->findModule( "VMP LOG" );
+        const unsigned char* base = tpl->file().data();
+        if( set ){
+            settings.assign( base + set->DataOffset, base + set->DataOffset + set->Length );
+            settings_version = set->Version;
+        }
+        if( log ){
+            log_module.assign( base + log->DataOffset, base + log->DataOffset + log->Length );
+            log_version = log->Version;
+        }
+    }
+
+    time_t now = time( 0 );
+    strftime( date, sizeof(date), "%m/%d/%y", localtime( &now ) );
+
+    file = fopen( path, "wb" );
+    if( !file ) return ERR_GEN_FUNCTIONFAILED;
+
+    /* file header */
+    unsigned char header[MPR_FILE_HEADER_SIZE];
+    memset( header, ' ', sizeof(header) );
+    memcpy( header, MPR_MAGIC, MPR_MAGIC_SIZE );
+    memset( header + MPR_FILE_HEADER_SIZE - 4, 0, 4 );
+    int status = ( fwrite( header, 1, sizeof(header), file ) == sizeof(header) ) ? ERR_NOERROR : ERR_GEN_FUNCTIONFAILED;
+
+    /* settings module */
+    if( status == ERR_NOERROR ) status = writeModuleHeader( "VMP Set", "VMP settings", (unsigned int)settings.size(), settings_version );
+    if( !settings.empty() && fwrite( &settings[0], 1, settings.size(), file ) != settings.size() ){
+        status = ERR_GEN_FUNCTIONFAILED;
+    }
+
+    /* data module: no point yet, the length covers the data header only */
+    data_header_offset = FILE_Tell( file );
+    if( status == ERR_NOERROR ) status = writeModuleHeader( "VMP data", "VMP data", (unsigned int)rows_offset, MPR_WRITER_DATA_VERSION );
+
+    std::vector<unsigned char> data_header( rows_offset, 0 );
+    data_header[MPR_DATA_NBPOINTS_SIZE] = (unsigned char)nb_ids;
+    for( size_t c = 0; c < nb_ids; c++ ){
+        data_header[MPR_DATA_NBPOINTS_SIZE + MPR_DATA_NBCOLS_SIZE + 2*c]     = (unsigned char)ids[c];
+        data_header[MPR_DATA_NBPOINTS_SIZE + MPR_DATA_NBCOLS_SIZE + 2*c + 1] = (unsigned char)( ids[c] >> 8 );
+    }
+    if( fwrite( &data_header[0], 1, data_header.size(), file ) != data_header.size() ){
+        status = ERR_GEN_FUNCTIONFAILED;
+    }
+    if( fflush( file ) != 0 ) status = ERR_GEN_FUNCTIONFAILED;
+
+    if( status != ERR_NOERROR ){
+        fclose( file );
+        file = 0;
+        return ERR_GEN_FUNCTIONFAILED;
+    }
+
+    rows_written = 0;
+    pending_rows = 0;
+    pending.clear();
+    pending.reserve( flush_rows * row_size );
+    last_flush = s_now();
+    return ERR_NOERROR;
+}
+
+int MprWriter::appendRows( const void* rows, size_t count )
+{
+    if( !file ) return ERR_GEN_INVALIDPARAMETERS;
+    if( count == 0 ) return ERR_NOERROR;
+
+    const unsigned char* p = (const unsigned char*)rows;
+    pending.insert( pending.end(), p, p + count * row_size );
+    pending_rows += count;
+
+    if( pending_rows >= flush_rows || s_now() - last_flush >= flush_seconds ){
+        return flush();
+    }
+    return ERR_NOERROR;
+}
+
+void MprWriter::fillRow( unsigned char* row, const TDecodedFrame_t& frame, int i, const int* extra_idx )
+{
+    for( size_t c = 0; c < columns.size(); c++ ){
+        unsigned char* p = row + columns[c].Offset;
+        switch( columns[c].Id ){
+        case 1:   *p |= (unsigned char)( s_mode( frame.TechniqueID ) & 0x03 ); break;
+        case 2:   if( ( frame.Fields & BL_FIELD_I ) && frame.I[i] >= 0.0f ) *p |= 0x04; break;
+        case 4:   s_put<double>( p, frame.Time[i] ); break;
+        case 6:
+        case 77:  if( frame.Fields & BL_FIELD_EWE ) s_put<float>( p, frame.Ewe[i] ); break;
+        case 8:
+        case 76:  if( frame.Fields & BL_FIELD_I ) s_put<float>( p, (float)( frame.I[i] * MPR_A_TO_MA ) ); break;
+        case 11:  if( frame.Fields & BL_FIELD_I ) s_put<double>( p, frame.I[i] * MPR_A_TO_MA ); break;
+        case 9:
+            if( frame.Fields & BL_FIELD_ECE )  s_put<float>( p, frame.Ece[i] );
+            else if( extra_idx[0] >= 0 )       s_put<float>( p, frame.Extra[extra_idx[0]][i] );
+            break;
+        case 16:  if( extra_idx[1] >= 0 ) s_put<float>( p, frame.Extra[extra_idx[1]][i] ); break;
+        case 5:
+        case 19:
+            if( frame.Fields & BL_FIELD_CONTROL ) s_put<float>( p, frame.Control[i] );
+            else if( extra_idx[2] >= 0 )          s_put<float>( p, frame.Extra[extra_idx[2]][i] );
+            break;
+        case 434: if( extra_idx[3] >= 0 ) s_put<float>( p, frame.Extra[extra_idx[3]][i] ); break;
+        case 13:  if( extra_idx[3] >= 0 ) s_put<double>( p, frame.Extra[extra_idx[3]][i] * MPR_C_TO_MAH ); break;
+        case 24:  if( frame.Fields & BL_FIELD_CYCLE ) s_put<double>( p, (double)frame.Cycle[i] ); break;
+        case 39:  if( extra_idx[4] >= 0 ) s_put<unsigned short>( p, (unsigned short)frame.Extra[extra_idx[4]][i] ); break;
+        default:  break; /* no value for this column in the ECLib data, left to 0 */
+        }
+    }
+}
+
+int MprWriter::appendFrame( const TDecodedFrame_t& frame )
+{
+    if( !file ) return ERR_GEN_INVALIDPARAMETERS;
+    if( frame.NbRows <= 0 ) return ERR_NOERROR;
+
+    /* where the extra values are in this frame: CE, AUX1, CTRL, Q, IRANGE */
+    int extra_idx[5] = {
+        BL_ExtraIndex( frame.Xrec, frame.NbExtra, XREC_CE ),  BL_ExtraIndex( frame.Xrec, frame.NbExtra, XREC_AUX1 ),
+        BL_ExtraIndex( frame.Xrec, frame.NbExtra, XREC_CTL ), BL_ExtraIndex( frame.Xrec, frame.NbExtra, XREC_Q ),
+        BL_ExtraIndex( frame.Xrec, frame.NbExtra, XREC_IRG )
+    };
+
+    size_t first = pending.size();
+    pending.resize( first + frame.NbRows * row_size, 0 );
+    for( int i = 0; i < frame.NbRows; i++ ){
+        fillRow( &pending[first + i * row_size], frame, i, extra_idx );
+    }
+    pending_rows += frame.NbRows;
+
+    if( pending_rows >= flush_rows || s_now() - last_flush >= flush_seconds ){
+        return flush();
+    }
+    return ERR_NOERROR;
+}
+
+int MprWriter::fixUpHeader()
+{
+    unsigned char value[4];
+    int status = ERR_NOERROR;
+
+    /* module length, then point count: a reader never sees a count larger than the rows */
+    s_putU32( value, (unsigned int)( rows_offset + rows_written * row_size ) );
+    if( FILE_Seek( file, data_header_offset + MPR_MODULE_TAG_SIZE + 35, SEEK_SET ) != 0
+        || fwrite( value, 1, 4, file ) != 4 ){
+        status = ERR_GEN_FUNCTIONFAILED;
+    }
+    s_putU32( value, (unsigned int)rows_written );
+    if( FILE_Seek( file, data_header_offset + MPR_MODULE_HEADER_SIZE, SEEK_SET ) != 0
+        || fwrite( value, 1, 4, file ) != 4 ){
+        status = ERR_GEN_FUNCTIONFAILED;
+    }
+    if( FILE_Seek( file, 0, SEEK_END ) != 0 || fflush( file ) != 0 ){
+        status = ERR_GEN_FUNCTIONFAILED;
+    }
+    return status;
+}
+
+int MprWriter::flush()
+{
+    if( !file ) return ERR_GEN_INVALIDPARAMETERS;
+
+    int status = ERR_NOERROR;
+    if( pending_rows > 0 ){
+        if( fwrite( &pending[0], 1, pending.size(), file ) != pending.size() ){
+            status = ERR_GEN_FUNCTIONFAILED;
+        } else {
+            rows_written += pending_rows;
+        }
+        pending.clear();
+        pending_rows = 0;
+        if( status == ERR_NOERROR ) status = fixUpHeader();
+    }
+    last_flush = s_now();
+    return status;
+}
+
+int MprWriter::close()
+{
+    if( !file ) return ERR_NOERROR;
+
+    int status = flush();
+
+    if( status == ERR_NOERROR ) status = writeModuleHeader( "VMP LOG", "VMP LOG", (unsigned int)log_module.size(), log_version );
+    if( status == ERR_NOERROR && !log_module.empty() && fwrite( &log_module[0], 1, log_module.size(), file ) != log_module.size() ){
+        status = ERR_GEN_FUNCTIONFAILED;
+    }
+    if( fclose( file ) != 0 ) status = ERR_GEN_FUNCTIONFAILED;
+    file = 0;
+
+    return status == ERR_NOERROR ? ERR_NOERROR : ERR_GEN_FUNCTIONFAILED;
+}
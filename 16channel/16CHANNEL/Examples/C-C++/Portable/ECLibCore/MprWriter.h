@@ -0,0 +1,149 @@
+#pragma once
+
+#ifndef _MPRWRITER_H_
+#define _MPRWRITER_H_
+
+#include <stdio.h>
+#include <vector>
+
+#include "BLDecode.h"
+#include "MprFile.h"
+
+/*
+ * Streaming writer for the EC-Lab binary data files (*.mpr)
+ *
+ * The file is written in the same layout as the files recorded by EC-Lab:
+ * file header, "VMP Set" module, "VMP data" module (version 2) and "VMP LOG"
+ * module. The points are appended at the end of the data module while the
+ * acquisition runs; the point count and the module length are fixed up in
+ * place every few rows, so the cost of an append only depends on the number
+ * of new rows. The log module is written when the file is closed.
+ *
+ * A file whose writer did not close it (crash, power loss) ends with the data
+ * module: \ref MprFile reads it back with all the complete rows.
+ */
+
+/**
+ * \ingroup mpr_files
+ * @{
+ */
+
+/** Version of the data module written by \ref MprWriter (same as the EC-Lab v10/v11 files) */
+#define MPR_WRITER_DATA_VERSION   (2)
+/** Default number of rows buffered between two header fix-ups */
+#define MPR_WRITER_FLUSH_ROWS     (4096)
+/** Default maximum delay between two header fix-ups (s) */
+#define MPR_WRITER_FLUSH_SECONDS  (1.0)
+
+/**
+ * This function fills the list of the .mpr columns matching the data of a technique,
+ * the same columns the MFC sample shows for it (see setupDataList).
+ *
+ * @param technique_id technique identifier (see \ref TTechniqueIdentifier_e)
+ * @param vmp4 true for the VMP4 technology devices
+ * @param xrec extra values recorded (see \ref TExtraRecord_e). XREC_AUX2 has no .mpr column and is dropped.
+ * @param ids list of column identifiers to fill
+ * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_INVALIDPARAMETERS if the technique is not supported.
+ */
+int MPR_ColumnsForTechnique( int technique_id, bool vmp4, int xrec, std::vector<unsigned short>& ids );
+
+/**
+ * This class writes a .mpr file while the data is acquired.
+ *
+ * Short example:
+ \code
+
+ std::vector<unsigned short> ids;
+ MPR_ColumnsForTechnique( KBIO_TECHID_CA, vmp4, xrec, ids );
+
+ MprFile tpl;      // settings and log modules are taken from a file recorded by EC-Lab
+ tpl.open( "test_C16.mpr" );
+
+ MprWriter writer;
+ writer.open( "capture.mpr", &ids[0], ids.size(), &tpl );
+ while( acquiring ){
+     eclib->BL_GetData( conn_id, ch, &buf, &infos, &curr );
+     BL_DecodeData( buf, infos, curr, vmp4, xrec, eclib->BL_ConvertNumericIntoSingle, &frame );
+     writer.appendFrame( frame );
+ }
+ writer.close();
+
+ \endcode
+ */
+class MprWriter
+{
+public:
+    MprWriter();
+    ~MprWriter();
+
+    /**
+     * This function creates the file and writes the header, the settings module and
+     * the header of the data module.
+     *
+     * @param path path of the file to create
+     * @param ids column identifiers of the data module (see \ref MPR_GetColumnDef)
+     * @param nb_ids number of identifiers
+     * @param tpl optional .mpr file whose settings and log modules are copied. Without
+     *            it, zero-filled modules are written: \ref MprFile reads the file, but
+     *            EC-Lab needs the settings of a real experiment to display it.
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_INVALIDPARAMETERS if a column
+     *         identifier is unknown, \ref ERR_GEN_FUNCTIONFAILED if the file cannot be written.
+     */
+    int open( const char* path, const unsigned short* ids, size_t nb_ids, const MprFile* tpl = 0 );
+
+    /**
+     * Appends rows already in the layout of the data module (\ref rowSize bytes each).
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_FUNCTIONFAILED if the file cannot be written.
+     */
+    int appendRows( const void* rows, size_t count );
+
+    /**
+     * Appends the points of a decoded frame. Each column takes the matching value of
+     * the frame (time, Ewe, I converted in mA, ...); the columns without a value in
+     * this frame are written as 0.
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_FUNCTIONFAILED if the file cannot be written.
+     */
+    int appendFrame( const TDecodedFrame_t& frame );
+
+    /** Writes the buffered rows and fixes up the point count and the module length. */
+    int flush();
+
+    /** Flushes, writes the log module and closes the file. */
+    int close();
+
+    /** Sets the number of rows and the delay (s) after which the header is fixed up */
+    void setFlushInterval( size_t rows, double seconds ) { flush_rows = rows; flush_seconds = seconds; }
+
+    bool   isOpen() const { return file != 0; }
+    size_t rowSize() const { return row_size; }
+    /** Number of rows appended so far (flushed or not) */
+    size_t rowCount() const { return rows_written + pending_rows; }
+    const std::vector<TMprColumn_t>& columnList() const { return columns; }
+
+private:
+    MprWriter( const MprWriter& );
+    MprWriter& operator=( const MprWriter& );
+
+    int  writeModuleHeader( const char* shortname, const char* longname, unsigned int length, unsigned int version );
+    int  fixUpHeader();
+    void fillRow( unsigned char* row, const TDecodedFrame_t& frame, int i, const int* extra_idx );
+
+    FILE*                      file;
+    std::vector<TMprColumn_t>  columns;
+    std::vector<unsigned char> pending;
+    std::vector<unsigned char> log_module;
+    unsigned int               log_version;
+    size_t                     row_size;
+    size_t                     rows_written;
+    size_t                     pending_rows;
+    long long                  data_header_offset; /* offset of the "MODULE" tag of the data module */
+    size_t                     rows_offset;        /* offset of the first row in the data module */
+    size_t                     flush_rows;
+    double                     flush_seconds;
+    double                     last_flush;
+    char                       date[9];
+};
+
+/** @} */
+
+#endif /* _MPRWRITER_H_ */
@@ -0,0 +1,374 @@
+#include "MpsFile.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "EccBuilder.h"
+
+/*
+ * Compilation of the .mps techniques into ECLib techniques
+ *
+ * The parameter names and units are the ones of section 7. Techniques in the PDF
+ * (and of the s_setXXParameters functions of the MFC sample). The .mps values are
+ * converted into the units expected by the .ecc files: V, A, s, and mV/s for the
+ * scan rates.
+ */
+
+/* the CV technique of ECLib runs Ei -> E1 -> E2 -> Ei -> Ef */
+#define MPS_CV_VERTICES ECC_CV_VERTICES
+
+/* EC-Lab writes the micro prefix in Latin-1, or in UTF-8 when the file was edited */
+static size_t s_microPrefix( const char* unit ){
+    if( (unsigned char)unit[0] == 0xB5 ) return 1;
+    if( (unsigned char)unit[0] == 0xC2 && (unsigned char)unit[1] == 0xB5 ) return 2;
+    if( unit[0] == 'u' ) return 1;
+    return 0;
+}
+
+/* factor from a unit such as "mV", "µA", "mV/s" to the SI unit (V, A, V/s, ...); false if unknown */
+static bool s_unitScale( const std::string& unit, double* scale ){
+    const char* u = unit.c_str();
+    double prefix = 1.0;
+    size_t skip;
+    if( ( skip = s_microPrefix( u ) ) != 0 ) prefix = 1e-6;
+    else if( u[0] == 'p' && u[1] ) { prefix = 1e-12; skip = 1; }
+    else if( u[0] == 'n' && u[1] ) { prefix = 1e-9;  skip = 1; }
+    else if( u[0] == 'm' && u[1] ) { prefix = 1e-3;  skip = 1; }
+    else if( u[0] == 'k' && u[1] ) { prefix = 1e3;   skip = 1; }
+    u += skip;
+
+    static const char* bases[] = { "V", "A", "s", "C", "A.h", "W", "Ohm", "V/s", "V/h", "A/s", "V/min" };
+    static const double factors[] = { 1.0, 1.0, 1.0, 1.0, 3600.0, 1.0, 1.0, 1.0, 1.0/3600.0, 1.0, 1.0/60.0 };
+    for( size_t i = 0; i < sizeof(bases)/sizeof(bases[0]); i++ ){
+        if( strcmp( u, bases[i] ) == 0 ){
+            *scale = prefix * factors[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+/* unit written in the key: "Ei (V)" gives "V" */
+static std::string s_keyUnit( const std::string& key ){
+    size_t open = key.rfind( '(' );
+    size_t close = key.rfind( ')' );
+    if( open == std::string::npos || close == std::string::npos || close < open ) return std::string();
+    return key.substr( open + 1, close - open - 1 );
+}
+
+/* "h:m:s" duration, "0:00:5.0000" gives 5 s */
+static bool s_duration( const std::string& text, double* seconds ){
+    double total = 0.0;
+    const char* p = text.c_str();
+    for( int field = 0; ; field++ ){
+        char* next;
+        double v = strtod( p, &next );
+        if( next == p || field > 2 ) return false;
+        total = total * 60.0 + v;
+        if( *next == '\0' ) break;
+        if( *next != ':' ) return false;
+        p = next + 1;
+    }
+    *seconds = total;
+    return true;
+}
+
+/* access to the values of a technique table, the first error is kept */
+class MpsReader
+{
+public:
+    MpsReader( const TMpsTechnique_t& tech ) : status( ERR_NOERROR ), tech( tech ) {}
+
+    /** index of the first row with this key, -1 if none */
+    int find( const char* key ) const {
+        for( size_t i = 0; i < tech.Rows.size(); i++ ){
+            if( tech.Rows[i].Key == key ) return (int)i;
+        }
+        return -1;
+    }
+
+    /** number of sequences of the technique (values on the first row) */
+    size_t sequences() const {
+        int ns = find( "Ns" );
+        if( ns >= 0 ) return tech.Rows[ns].Values.size();
+        return tech.Rows.empty() ? 0 : tech.Rows[0].Values.size();
+    }
+
+    bool has( const char* key ) const { return find( key ) >= 0; }
+
+    const std::string& text( const char* key, size_t seq ) {
+        static const std::string empty;
+        int r = find( key );
+        if( r < 0 ){
+            fail( std::string( "missing \"" ) + key + "\"" );
+            return empty;
+        }
+        return value( r, seq );
+    }
+
+    /** value converted in the SI unit: the unit is in the key, on the "<key> unit" or "unit <key>" row */
+    double number( const char* key, size_t seq ) {
+        int r = find( key );
+        if( r < 0 ){
+            fail( std::string( "missing \"" ) + key + "\"" );
+            return 0.0;
+        }
+        const std::string& v = value( r, seq );
+        std::string unit = s_keyUnit( tech.Rows[r].Key );
+        if( unit.empty() ){
+            int u = find( ( std::string( key ) + " unit" ).c_str() );
+            if( u < 0 ) u = find( ( std::string( "unit " ) + key ).c_str() );
+            if( u >= 0 ) unit = value( u, seq );
+        }
+        double result = 0.0;
+        if( unit == "h:m:s" ){
+            if( !s_duration( v, &result ) ) fail( std::string( "invalid duration \"" ) + v + "\" for \"" + key + "\"" );
+            return result;
+        }
+        char* end;
+        result = strtod( v.c_str(), &end );
+        if( v.empty() || *end != '\0' ){
+            fail( std::string( "invalid number \"" ) + v + "\" for \"" + key + "\"" );
+            return 0.0;
+        }
+        if( !unit.empty() ){
+            double scale;
+            if( !s_unitScale( unit, &scale ) ){
+                fail( std::string( "unknown unit \"" ) + unit + "\" for \"" + key + "\"" );
+                return 0.0;
+            }
+            result *= scale;
+        }
+        return result;
+    }
+
+    /** reference of a potential ("vs." row following the key): true if relative to the initial potential */
+    bool versusInitial( const char* key, size_t seq ) {
+        int r = find( key );
+        if( r < 0 || r + 1 >= (int)tech.Rows.size() || tech.Rows[r + 1].Key != "vs." ) return false;
+        const std::string& ref = value( r + 1, seq );
+        if( ref == "Ref" || ref == "<None>" || ref.empty() ) return false;
+        if( ref == "Eoc" || ref == "Ei" || ref == "Ectrl" || ref == "Emeas" || ref == "Is" || ref == "Ictrl" || ref == "Imeas" ){
+            /* ECLib only knows "vs. initial": the potential when the technique starts, which
+               is the open circuit potential when the channel is at rest */
+            return true;
+        }
+        fail( std::string( "unsupported reference \"" ) + ref + "\" for \"" + key + "\"" );
+        return false;
+    }
+
+    /** I range of the "I Range" row */
+    int currentRange() {
+        const std::string& v = text( "I Range", 0 );
+        if( v == "Auto" || v.empty() ) return KBIO_IRANGE_AUTO;
+        if( v == "Booster" ) return KBIO_IRANGE_BOOSTER;
+
+        char* end;
+        double amps = strtod( v.c_str(), &end );
+        while( *end == ' ' ) end++;
+        double scale;
+        if( end != v.c_str() && s_unitScale( end, &scale ) ){
+            static const struct { double amps; int range; } ranges[] = {
+                { 1e-12, KBIO_IRANGE_1pA },   { 1e-11, KBIO_IRANGE_10pA },  { 1e-10, KBIO_IRANGE_100pA },
+                { 1e-9,  KBIO_IRANGE_1nA },   { 1e-8,  KBIO_IRANGE_10nA },  { 1e-7,  KBIO_IRANGE_100nA },
+                { 1e-6,  KBIO_IRANGE_1uA },   { 1e-5,  KBIO_IRANGE_10uA },  { 1e-4,  KBIO_IRANGE_100uA },
+                { 1e-3,  KBIO_IRANGE_1mA },   { 1e-2,  KBIO_IRANGE_10mA },  { 1e-1,  KBIO_IRANGE_100mA },
+                { 1.0,   KBIO_IRANGE_1A }
+            };
+            amps *= scale;
+            for( size_t i = 0; i < sizeof(ranges)/sizeof(ranges[0]); i++ ){
+                if( fabs( amps - ranges[i].amps ) < ranges[i].amps * 1e-3 ) return ranges[i].range;
+            }
+        }
+        fail( "unsupported I range \"" + v + "\"" );
+        return KBIO_IRANGE_AUTO;
+    }
+
+    /** smallest E range holding the "E range min (V)" / "E range max (V)" window */
+    int voltageRange() {
+        double lo = number( "E range min (V)", 0 );
+        double hi = number( "E range max (V)", 0 );
+        double span = fabs( lo ) > fabs( hi ) ? fabs( lo ) : fabs( hi );
+        if( span <= 2.5 + 1e-9 ) return KBIO_ERANGE_2_5;
+        if( span <= 5.0 + 1e-9 ) return KBIO_ERANGE_5;
+        if( span <= 10.0 + 1e-9 ) return KBIO_ERANGE_10;
+        fail( "E range wider than +/- 10 V" );
+        return KBIO_ERANGE_AUTO;
+    }
+
+    void fail( const std::string& msg ) {
+        if( status == ERR_NOERROR ){
+            status = ERR_GEN_INVALIDPARAMETERS;
+            error  = msg;
+        }
+    }
+
+    int         status;
+    std::string error;
+
+private:
+    /* value of a sequence; a row with a single value applies to all the sequences */
+    const std::string& value( int r, size_t seq ) {
+        static const std::string empty;
+        const std::vector<std::string>& values = tech.Rows[r].Values;
+        if( seq < values.size() ) return values[seq];
+        if( values.size() == 1 ) return values[0];
+        fail( "no value for \"" + tech.Rows[r].Key + "\"" );
+        return empty;
+    }
+
+    const TMpsTechnique_t& tech;
+};
+
+/* the first of two results which failed: ORed, two error codes give another one */
+static int s_firstError( int first, int second ){
+    return ( first != ERR_NOERROR ) ? first : second;
+}
+
+/* copies the built parameters at the end of the plan, and releases the arena */
+template<class SCHEMA>
+static int s_addTechnique( EccBuilder<SCHEMA>& out, EccArena& arena, bool vmp4, std::vector<TEccTechnique_t>& plan ){
+    plan.push_back( TEccTechnique_t() );
+    int status = out.technique( vmp4, &plan.back() );
+    arena.reset();
+    return status;
+}
+
+/* OCV: also used for the rest period in front of the voltammetries, skipped if 'optional' and empty */
+static int s_compileRest( MpsReader& in, bool optional, bool vmp4, int xrec, EccArena& arena, std::vector<TEccTechnique_t>& plan ){
+    typedef EccSchemaOCV S;
+    double rest = in.number( "tR (h:m:s)", 0 );
+    if( in.status != ERR_NOERROR ) return in.status;
+    if( optional && rest <= 0.0 ) return ERR_NOERROR;
+
+    EccBuilder<S> out( arena );
+    out.sgl<ECC_PARAM( S, "Rest_time_T" )>    ( (float)rest );
+    out.sgl<ECC_PARAM( S, "Record_every_dE" )>( (float)in.number( "dER (mV)", 0 ) );
+    out.sgl<ECC_PARAM( S, "Record_every_dT" )>( (float)in.number( "dtR (s)", 0 ) );
+    out.num<ECC_PARAM( S, "E_Range" )>        ( in.voltageRange() );
+    out.num<ECC_PARAM( S, "xctr" )>           ( xrec );
+    return s_firstError( in.status, s_addTechnique( out, arena, vmp4, plan ) );
+}
+
+/* CA and CP: one step per sequence */
+template<class S>
+static int s_compileChrono( MpsReader& in, bool vmp4, int xrec, EccArena& arena, std::vector<TEccTechnique_t>& plan ){
+    constexpr bool potentio = ( S::TechniqueID == KBIO_TECHID_CA );
+    size_t steps = in.sequences();
+    if( steps == 0 || steps > ECC_MAX_STEPS ){
+        in.fail( steps ? "more than " + std::to_string( ECC_MAX_STEPS ) + " sequences" : std::string( "no sequence" ) );
+        return in.status;
+    }
+    EccBuilder<S> out( arena );
+
+    for( size_t k = 0; k < steps; k++ ){
+        if constexpr( potentio ){
+            out.template sgl <ECC_PARAM( S, "Voltage_step" )> ( (float)in.number( "Ei (V)", k ), (int)k );
+            out.template flag<ECC_PARAM( S, "vs_initial" )>   ( in.versusInitial( "Ei (V)", k ), (int)k );
+            out.template sgl <ECC_PARAM( S, "Duration_step" )>( (float)in.number( "ti (h:m:s)", k ), (int)k );
+        } else {
+            out.template sgl <ECC_PARAM( S, "Current_step" )> ( (float)in.number( "Is", k ), (int)k );
+            out.template flag<ECC_PARAM( S, "vs_initial" )>   ( in.versusInitial( "Is", k ), (int)k );
+            out.template sgl <ECC_PARAM( S, "Duration_step" )>( (float)in.number( "ts (h:m:s)", k ), (int)k );
+        }
+    }
+    out.template num<ECC_PARAM( S, "Step_number" )>( (int)steps - 1 );
+    out.template num<ECC_PARAM( S, "N_Cycles" )>   ( in.has( "nc cycles" ) ? (int)in.number( "nc cycles", 0 ) : 0 );
+    if constexpr( potentio ){
+        out.template sgl<ECC_PARAM( S, "Record_every_dI" )>( (float)in.number( "dI", 0 ) );
+        out.template sgl<ECC_PARAM( S, "Record_every_dT" )>( (float)in.number( "dt (s)", 0 ) );
+    } else {
+        out.template sgl<ECC_PARAM( S, "Record_every_dE" )>( (float)in.number( "dEs (mV)", 0 ) );
+        out.template sgl<ECC_PARAM( S, "Record_every_dT" )>( (float)in.number( "dts (s)", 0 ) );
+    }
+    int irange = in.currentRange();
+    if( !potentio && irange == KBIO_IRANGE_AUTO ){
+        in.fail( "chronopotentiometry needs a fixed I range" );
+    }
+    out.template num<ECC_PARAM( S, "I_Range" )>  ( irange );
+    out.template num<ECC_PARAM( S, "E_Range" )>  ( in.voltageRange() );
+    out.template num<ECC_PARAM( S, "Bandwidth" )>( (int)in.number( "Bandwidth", 0 ) );
+    out.template num<ECC_PARAM( S, "xctr" )>     ( xrec );
+    return s_firstError( in.status, s_addTechnique( out, arena, vmp4, plan ) );
+}
+
+/* CV and LSV: the LSV sweeps Ei -> EL, the other vertices stay at EL */
+static int s_compileVoltammetry( MpsReader& in, bool linear, bool vmp4, int xrec, EccArena& arena, std::vector<TEccTechnique_t>& plan ){
+    typedef EccSchemaCV S;
+    if( in.has( "tR (h:m:s)" ) ){
+        int status = s_compileRest( in, true, vmp4, xrec, arena, plan );
+        if( status != ERR_NOERROR ) return status;
+    }
+
+    const char* keys[MPS_CV_VERTICES] = { "Ei (V)", "E1 (V)", "E2 (V)", "Ei (V)", "Ef (V)" };
+    if( linear ){
+        keys[1] = keys[2] = keys[3] = keys[4] = "EL (V)";
+    }
+    double rate_mv = in.number( "dE/dt", 0 ) * 1000.0;   /* V/s -> mV/s */
+
+    EccBuilder<S> out( arena );
+    for( int k = 0; k < MPS_CV_VERTICES; k++ ){
+        out.flag<ECC_PARAM( S, "vs_initial" )>  ( in.versusInitial( keys[k], 0 ), k );
+        out.sgl <ECC_PARAM( S, "Voltage_step" )>( (float)in.number( keys[k], 0 ), k );
+        out.sgl <ECC_PARAM( S, "Scan_Rate" )>   ( (float)rate_mv, k );
+    }
+    out.num <ECC_PARAM( S, "Scan_number" )>      ( 2 );
+    out.sgl <ECC_PARAM( S, "Record_every_dE" )>  ( (float)( in.number( "N", 0 ) * MPS_SCAN_STEP ) );
+    out.flag<ECC_PARAM( S, "Average_over_dE" )>  ( in.text( "record", 0 ) == "<I>" );
+    out.num <ECC_PARAM( S, "N_Cycles" )>         ( ( !linear && in.has( "nc cycles" ) ) ? (int)in.number( "nc cycles", 0 ) : 0 );
+    out.sgl <ECC_PARAM( S, "Begin_measuring_I" )>( (float)( in.number( "step percent", 0 ) / 100.0 ) );
+    out.sgl <ECC_PARAM( S, "End_measuring_I" )>  ( 1.0f );
+    out.num <ECC_PARAM( S, "I_Range" )>          ( in.currentRange() );
+    out.num <ECC_PARAM( S, "E_Range" )>          ( in.voltageRange() );
+    out.num <ECC_PARAM( S, "Bandwidth" )>        ( (int)in.number( "Bandwidth", 0 ) );
+    out.num <ECC_PARAM( S, "xctr" )>             ( xrec );
+    return s_firstError( in.status, s_addTechnique( out, arena, vmp4, plan ) );
+}
+
+static bool s_startsWith( const std::string& name, const char* prefix ){
+    size_t n = strlen( prefix );
+    if( name.size() < n ) return false;
+    for( size_t i = 0; i < n; i++ ){
+        if( tolower( (unsigned char)name[i] ) != tolower( (unsigned char)prefix[i] ) ) return false;
+    }
+    return true;
+}
+
+int MpsFile::compile( bool vmp4, int xrec, std::vector<TEccTechnique_t>& plan )
+{
+    plan.clear();
+    error.clear();
+    /* one technique at a time: room for the largest one, a CA or CP of ECC_MAX_STEPS steps */
+    EccArena arena( 3 * ECC_MAX_STEPS + 16 );
+
+    for( size_t t = 0; t < techniques.size(); t++ ){
+        const TMpsTechnique_t& tech = techniques[t];
+        MpsReader in( tech );
+        int status;
+
+        if( s_startsWith( tech.Name, "Open Circuit Voltage" ) ){
+            status = s_compileRest( in, false, vmp4, xrec, arena, plan );
+        } else if( s_startsWith( tech.Name, "Chronoamperometry" ) ){
+            status = s_compileChrono<EccSchemaCA>( in, vmp4, xrec, arena, plan );
+        } else if( s_startsWith( tech.Name, "Chronopotentiometry" ) ){
+            status = s_compileChrono<EccSchemaCP>( in, vmp4, xrec, arena, plan );
+        } else if( s_startsWith( tech.Name, "Cyclic Voltammetry" ) ){
+            status = s_compileVoltammetry( in, false, vmp4, xrec, arena, plan );
+        } else if( s_startsWith( tech.Name, "Linear Sweep Voltammetry" ) ){
+            status = s_compileVoltammetry( in, true, vmp4, xrec, arena, plan );
+        } else {
+            plan.clear();
+            return fail( ERR_GEN_INVALIDPARAMETERS, "technique " + std::to_string( tech.Number ) + ": \"" + tech.Name + "\" is not supported" );
+        }
+
+        if( status != ERR_NOERROR ){
+            plan.clear();
+            std::string msg = in.error.empty() ? std::string( "invalid parameter label" ) : in.error;
+            return fail( ERR_GEN_INVALIDPARAMETERS, "technique " + std::to_string( tech.Number ) + " (" + tech.Name + "): " + msg );
+        }
+    }
+    return ERR_NOERROR;
+}
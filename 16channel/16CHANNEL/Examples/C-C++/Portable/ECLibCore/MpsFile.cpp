@@ -0,0 +1,237 @@
+#include "MpsFile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "MappedFile.h"
+
+static const char MPS_BANNER[] = "EC-LAB SETTING FILE";
+
+static bool s_isBlank( char c ){
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+/* [begin, end) without the leading and trailing blanks */
+static std::string s_trim( const char* begin, const char* end ){
+    while( begin < end && s_isBlank( *begin ) ) begin++;
+    while( end > begin && s_isBlank( end[-1] ) ) end--;
+    return std::string( begin, end );
+}
+
+/* splits a line of a technique table into the key and the value fields */
+static void s_splitRow( const char* begin, const char* end, TMpsRow_t& row ){
+    const char* key_end = ( end - begin > MPS_FIELD_WIDTH ) ? begin + MPS_FIELD_WIDTH : end;
+    row.Key = s_trim( begin, key_end );
+    row.Values.clear();
+    for( const char* p = key_end; p < end; p += MPS_FIELD_WIDTH ){
+        const char* field_end = ( end - p > MPS_FIELD_WIDTH ) ? p + MPS_FIELD_WIDTH : end;
+        row.Values.push_back( s_trim( p, field_end ) );
+    }
+    /* the last fields are padded with blanks up to the width of the longest line */
+    while( !row.Values.empty() && row.Values.back().empty() ){
+        row.Values.pop_back();
+    }
+}
+
+MpsFile::MpsFile()
+{
+}
+
+int MpsFile::fail( int code, const std::string& msg )
+{
+    error = msg;
+    return code;
+}
+
+int MpsFile::open( const char* path )
+{
+    MappedFile file;
+    int status = file.open( path );
+    if( status != ERR_NOERROR ){
+        headers.clear();
+        techniques.clear();
+        return fail( status, std::string( "cannot open " ) + ( path ? path : "(null)" ) );
+    }
+    return parse( (const char*)file.data(), file.size() );
+}
+
+int MpsFile::parse( const char* text, size_t size )
+{
+    headers.clear();
+    techniques.clear();
+    error.clear();
+
+    if( !text || size < sizeof(MPS_BANNER) - 1 || memcmp( text, MPS_BANNER, sizeof(MPS_BANNER) - 1 ) != 0 ){
+        return fail( ERR_TECH_DATACORRUPTED, "not an EC-Lab setting file" );
+    }
+
+    enum { IN_HEADER, IN_NAME, IN_TABLE } state = IN_HEADER;
+    const char* end = text + size;
+    const char* line = text;
+
+    /* skip the banner line */
+    while( line < end && *line != '\n' ) line++;
+
+    while( line < end ){
+        if( *line == '\n' ) line++;
+        const char* eol = (const char*)memchr( line, '\n', end - line );
+        if( !eol ) eol = end;
+        const char* last = eol;
+        while( last > line && last[-1] == '\r' ) last--;
+
+        bool blank = true;
+        for( const char* p = line; p < last && blank; p++ ) blank = s_isBlank( *p );
+
+        const char* colon = 0;
+        for( const char* p = line; p + 2 < last; p++ ){
+            if( p[0] == ' ' && p[1] == ':' && ( p[2] == ' ' || p + 3 == last ) ){ colon = p; break; }
+        }
+        if( !colon && last - line >= 2 && last[-1] == ':' && last[-2] == ' ' ) colon = last - 2;
+
+        std::string key = colon ? s_trim( line, colon ) : std::string();
+        if( colon && key == "Technique" ){
+            TMpsTechnique_t tech;
+            tech.Number = atoi( s_trim( colon + 2, last ).c_str() );
+            techniques.push_back( tech );
+            state = IN_NAME;
+        } else if( blank ){
+            if( state == IN_TABLE ) state = IN_HEADER;
+        } else if( state == IN_NAME ){
+            techniques.back().Name = s_trim( line, last );
+            state = IN_TABLE;
+        } else if( state == IN_TABLE ){
+            TMpsRow_t row;
+            s_splitRow( line, last, row );
+            techniques.back().Rows.push_back( row );
+        } else if( colon ){
+            headers.push_back( std::make_pair( key, s_trim( colon + 2 < last ? colon + 2 : last, last ) ) );
+        } else {
+            /* option lines without value ("Turn to OCV between techniques") */
+            headers.push_back( std::make_pair( s_trim( line, last ), std::string() ) );
+        }
+        line = eol;
+    }
+
+    const char* declared = header( "Number of linked techniques" );
+    if( declared && (size_t)atoi( declared ) != techniques.size() ){
+        char msg[128];
+        snprintf( msg, sizeof(msg), "%s techniques announced, %zu found", declared, techniques.size() );
+        return fail( ERR_TECH_DATACORRUPTED, msg );
+    }
+    for( size_t t = 0; t < techniques.size(); t++ ){
+        if( techniques[t].Name.empty() ){
+            return fail( ERR_TECH_DATACORRUPTED, "technique without name" );
+        }
+    }
+    return ERR_NOERROR;
+}
+
+const char* MpsFile::header( const char* key ) const
+{
+    for( size_t i = 0; i < headers.size(); i++ ){
+        if( headers[i].first == key ) return headers[i].second.c_str();
+    }
+    return 0;
+}
+
+const char* MpsFile::device() const
+{
+    const char* dev = header( "Device" );
+    return dev ? dev : "";
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+unsigned long long MPS_Hash( const void* data, size_t size, unsigned long long seed )
+{
+    const unsigned char* p = (const unsigned char*)data;
+    unsigned long long hash = seed;
+    for( size_t i = 0; i < size; i++ ){
+        hash ^= p[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+MpsCache::MpsCache()
+    : nb_hits( 0 )
+    , nb_misses( 0 )
+{
+}
+
+int MpsCache::load( const char* path, bool vmp4, int xrec, std::shared_ptr<const TMpsPlan_t>& plan, std::string* error )
+{
+    MappedFile file;
+    int status = file.open( path );
+    if( status != ERR_NOERROR ){
+        if( error ) *error = std::string( "cannot open " ) + ( path ? path : "(null)" );
+        return status;
+    }
+    return loadText( (const char*)file.data(), file.size(), vmp4, xrec, plan, error );
+}
+
+int MpsCache::loadText( const char* text, size_t size, bool vmp4, int xrec, std::shared_ptr<const TMpsPlan_t>& plan, std::string* error )
+{
+    /* the compilation options are part of the key: the same file gives other parameters on a VMP4 device */
+    unsigned char options[5] = { (unsigned char)vmp4, (unsigned char)xrec, (unsigned char)( xrec >> 8 ),
+                                 (unsigned char)( xrec >> 16 ), (unsigned char)( xrec >> 24 ) };
+    unsigned long long hash = MPS_Hash( text, size );
+    unsigned long long key  = MPS_Hash( options, sizeof(options), hash );
+
+    {
+        std::lock_guard<std::mutex> guard( lock );
+        std::map<unsigned long long, TEntry_t>::const_iterator it = entries.find( key );
+        if( it != entries.end() && it->second.Text.size() == size && memcmp( it->second.Text.data(), text, size ) == 0 ){
+            nb_hits++;
+            plan = it->second.Plan;
+            return ERR_NOERROR;
+        }
+        nb_misses++;
+    }
+
+    /* compiled outside of the lock: the other channels keep being served */
+    MpsFile mps;
+    std::shared_ptr<TMpsPlan_t> compiled( new TMpsPlan_t );
+    int status = mps.parse( text, size );
+    if( status == ERR_NOERROR ) status = mps.compile( vmp4, xrec, compiled->Techniques );
+    if( status != ERR_NOERROR ){
+        if( error ) *error = mps.errorMessage();
+        return status;
+    }
+    compiled->Hash   = hash;
+    compiled->Device = mps.device();
+    plan = compiled;
+
+    std::lock_guard<std::mutex> guard( lock );
+    TEntry_t& entry = entries[key];
+    entry.Text.assign( text, size );
+    entry.Plan = plan;
+    return ERR_NOERROR;
+}
+
+size_t MpsCache::size() const
+{
+    std::lock_guard<std::mutex> guard( lock );
+    return entries.size();
+}
+
+size_t MpsCache::hits() const
+{
+    std::lock_guard<std::mutex> guard( lock );
+    return nb_hits;
+}
+
+size_t MpsCache::misses() const
+{
+    std::lock_guard<std::mutex> guard( lock );
+    return nb_misses;
+}
+
+void MpsCache::clear()
+{
+    std::lock_guard<std::mutex> guard( lock );
+    entries.clear();
+    nb_hits   = 0;
+    nb_misses = 0;
+}
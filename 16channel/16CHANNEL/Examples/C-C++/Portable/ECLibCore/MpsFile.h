@@ -0,0 +1,173 @@
+#pragma once
+
+#ifndef _MPSFILE_H_
+#define _MPSFILE_H_
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <BLStructs.h>
+#include "EccParams.h"
+
+/*
+ * Reader for the EC-Lab setting files (*.mps)
+ *
+ * A .mps file is a text file: the "EC-LAB SETTING FILE" banner, a header made of
+ * "key : value" lines (device, electrode, number of linked techniques, ...) and
+ * then, for each linked technique, a "Technique : N" line, the name of the
+ * technique and a table of parameters. Each line of the table holds a key in a
+ * 20 characters wide field, followed by one 20 characters wide field per
+ * sequence (Ns 0, 1, 2, ...):
+ *
+ *     Technique : 1
+ *     Linear Sweep Voltammetry
+ *     Ei (V)              0.000
+ *     vs.                 Eoc
+ *     dE/dt               100.000
+ *     dE/dt unit          mV/s
+ *
+ * The units are given either in the key ("Ei (V)") or on their own line
+ * ("dE/dt unit", "unit dI"); EC-Lab writes the files in Latin-1 ("µA").
+ */
+
+/**
+ * \defgroup mps_files EC-Lab .mps files
+ * @{
+ */
+
+/** Width of the key and value fields of a technique table */
+#define MPS_FIELD_WIDTH (20)
+
+/** Step of the potential scans (V): EC-Lab averages "N" steps of this size for each recorded point */
+#define MPS_SCAN_STEP   (0.001)
+
+/** A line of a technique table */
+typedef struct {
+    std::string              Key;    /*!< key, e.g. "Ei (V)" */
+    std::vector<std::string> Values; /*!< one value per sequence */
+} TMpsRow_t;
+
+/** A technique of the setting file */
+typedef struct {
+    int                    Number; /*!< number of the technique in the file (1-based) */
+    std::string            Name;   /*!< name of the technique, e.g. "Linear Sweep Voltammetry" */
+    std::vector<TMpsRow_t> Rows;   /*!< parameter table, in the order of the file */
+} TMpsTechnique_t;
+
+/**
+ * This class parses a .mps file and compiles its techniques into the parameters
+ * of the ECLib techniques (.ecc file + \ref TEccParam_t array).
+ *
+ * Supported techniques: Open Circuit Voltage, Chronoamperometry, Chronopotentiometry,
+ * Cyclic Voltammetry and Linear Sweep Voltammetry (which is run with cv.ecc, its
+ * vertices E1, E2 and Ef set to EL). A rest period before a voltammetry (tR) gives
+ * an OCV technique in front of it.
+ */
+class MpsFile
+{
+public:
+    MpsFile();
+
+    /**
+     * This function reads and parses a .mps file.
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_FILENOTEXISTS if the file cannot
+     *         be opened, \ref ERR_TECH_DATACORRUPTED if it is not a valid setting file
+     *         (see \ref errorMessage).
+     */
+    int open( const char* path );
+
+    /** Same as \ref open, for the content of a file already in memory */
+    int parse( const char* text, size_t size );
+
+    /** Human readable description of the last error returned by \ref open, \ref parse or \ref compile */
+    const char* errorMessage() const { return error.c_str(); }
+
+    /** Value of a header line (e.g. "Device"), or 0 if the file has none */
+    const char* header( const char* key ) const;
+
+    /** Device the settings were written for ("VMP3", "SP-300", ...) */
+    const char* device() const;
+
+    size_t                 techniqueCount() const { return techniques.size(); }
+    const TMpsTechnique_t& technique( size_t i ) const { return techniques[i]; }
+
+    /**
+     * This function converts the techniques into ECLib techniques, in the order they
+     * have to be loaded (first, then next ones with BL_LoadTechnique( ..., first=false, ... )).
+     *
+     * @param vmp4 true to use the .ecc files of the VMP4 technology devices
+     * @param xrec extra values to record ("xctr" parameter, see \ref TExtraRecord_e)
+     * @param plan compiled techniques
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_INVALIDPARAMETERS if a technique
+     *         or a value is not supported (see \ref errorMessage).
+     */
+    int compile( bool vmp4, int xrec, std::vector<TEccTechnique_t>& plan );
+
+private:
+    int fail( int code, const std::string& msg );
+
+    std::vector< std::pair<std::string, std::string> > headers;
+    std::vector<TMpsTechnique_t> techniques;
+    std::string                  error;
+};
+
+/** The techniques compiled from a .mps file */
+typedef struct {
+    unsigned long long           Hash;       /*!< hash of the content of the file */
+    std::string                  Device;     /*!< device of the setting file */
+    std::vector<TEccTechnique_t> Techniques; /*!< techniques to load, in order */
+} TMpsPlan_t;
+
+/**
+ * This class keeps the compiled .mps files, indexed by the hash of their content.
+ * Loading the same settings on the 16 channels of an instrument, or loading them
+ * again for the next experiment, returns the plan compiled the first time. The
+ * cache can be shared by several threads.
+ */
+class MpsCache
+{
+public:
+    MpsCache();
+
+    /**
+     * Returns the compiled plan of a .mps file, compiling it if its content was not seen before.
+     *
+     * @param path path of the .mps file
+     * @param vmp4 true to use the .ecc files of the VMP4 technology devices
+     * @param xrec extra values to record (see \ref TExtraRecord_e)
+     * @param plan compiled plan, shared with the cache
+     * @param error optional description of the error
+     * @return \ref ERR_NOERROR if successful, otherwise the error of \ref MpsFile::open or
+     *         \ref MpsFile::compile.
+     */
+    int load( const char* path, bool vmp4, int xrec, std::shared_ptr<const TMpsPlan_t>& plan, std::string* error = 0 );
+
+    /** Same as \ref load, for the content of a file already in memory */
+    int loadText( const char* text, size_t size, bool vmp4, int xrec, std::shared_ptr<const TMpsPlan_t>& plan, std::string* error = 0 );
+
+    size_t size() const;
+    size_t hits() const;
+    size_t misses() const;
+    void   clear();
+
+private:
+    typedef struct {
+        std::string                       Text; /* content, compared on a hash match */
+        std::shared_ptr<const TMpsPlan_t> Plan;
+    } TEntry_t;
+
+    mutable std::mutex                     lock;
+    std::map<unsigned long long, TEntry_t> entries;
+    size_t                                 nb_hits;
+    size_t                                 nb_misses;
+};
+
+/** 64 bits FNV-1a hash, used to index the .mps contents */
+unsigned long long MPS_Hash( const void* data, size_t size, unsigned long long seed = 0xcbf29ce484222325ULL );
+
+/** @} */
+
+#endif /* _MPSFILE_H_ */
@@ -0,0 +1,38 @@
+#pragma once
+
+#ifndef _PARALLELFOR_H_
+#define _PARALLELFOR_H_
+
+#include <stddef.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/*
+ * Work spread over threads, used inside ECLibCore (not part of its interface)
+ */
+
+/**
+ * This function calls 'work' once for each index in [0, count), from 'threads'
+ * threads, the calling one included: each thread takes the next index in order
+ * until there is none left. With 'threads' 0 or more than 'count', there is one
+ * thread per index. It returns once every call returned.
+ *
+ * @return the number of threads used
+ */
+template<class F>
+int PAR_For( size_t count, int threads, F work )
+{
+    if( threads <= 0 || (size_t)threads > count ) threads = (int)count;
+    std::atomic<size_t> next( 0 );
+    auto worker = [&](){
+        for( size_t i = next++; i < count; i = next++ ) work( i );
+    };
+    std::vector<std::thread> pool;
+    for( int k = 1; k < threads; k++ ) pool.push_back( std::thread( worker ) );
+    worker();
+    for( size_t k = 0; k < pool.size(); k++ ) pool[k].join();
+    return threads;
+}
+
+#endif /* _PARALLELFOR_H_ */
@@ -0,0 +1,335 @@
+#include "PhaseProfiler.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <set>
+#include <utility>
+
+static long long s_clockNs(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+/* JSON string, quoted */
+static std::string s_json( const std::string& text ){
+    std::string out( "\"" );
+    for( size_t i = 0; i < text.size(); i++ ){
+        unsigned char c = (unsigned char)text[i];
+        if( c == '"' || c == '\\' ) out += '\\';
+        if( c < 0x20 ){
+            char escaped[8];
+            snprintf( escaped, sizeof(escaped), "\\u%04x", c );
+            out += escaped;
+        } else {
+            out += (char)c;
+        }
+    }
+    return out + "\"";
+}
+
+/* process of a device, row of a channel in the timeline */
+static int s_pid( int device ){ return ( device == PRF_NONE ) ? 0 : device + 1; }
+static int s_tid( int channel ){ return ( channel == PRF_NONE ) ? 0 : channel + 1; }
+
+PhaseProfiler::PhaseProfiler()
+    : origin( s_clockNs() )
+{
+}
+
+long long PhaseProfiler::now() const
+{
+    return s_clockNs() - origin;
+}
+
+void PhaseProfiler::record( const char* name, int device, int channel, long long start, int status )
+{
+    TPhaseEvent_t event;
+    event.Name     = name ? name : "";
+    event.Device   = device;
+    event.Channel  = channel;
+    event.Start    = start;
+    event.Duration = now() - start;
+    event.Status   = status;
+    std::lock_guard<std::mutex> guard( lock );
+    list.push_back( event );
+}
+
+void PhaseProfiler::setDeviceName( int device, const std::string& name )
+{
+    std::lock_guard<std::mutex> guard( lock );
+    devices[device] = name;
+}
+
+std::vector<TPhaseEvent_t> PhaseProfiler::events() const
+{
+    std::lock_guard<std::mutex> guard( lock );
+    return list;
+}
+
+std::vector<TPhaseTotal_t> PhaseProfiler::totals() const
+{
+    std::vector<TPhaseEvent_t> copy = events();
+    std::vector<TPhaseTotal_t> out;
+    std::map<std::string, size_t> index;
+    for( size_t i = 0; i < copy.size(); i++ ){
+        const TPhaseEvent_t& e = copy[i];
+        double start = e.Start * 1e-9, seconds = e.Duration * 1e-9;
+        std::map<std::string, size_t>::iterator it = index.find( e.Name );
+        if( it == index.end() ){
+            TPhaseTotal_t t = { e.Name, 0, 0, 0.0, 0.0, start, start };
+            it = index.insert( std::make_pair( e.Name, out.size() ) ).first;
+            out.push_back( t );
+        }
+        TPhaseTotal_t& t = out[it->second];
+        t.Count++;
+        t.Errors  += ( e.Status != ERR_NOERROR );
+        t.Seconds += seconds;
+        if( seconds > t.Max ) t.Max = seconds;
+        if( start < t.First ) t.First = start;
+        if( start + seconds > t.Last ) t.Last = start + seconds;
+    }
+    /* in the order of their first start */
+    for( size_t i = 1; i < out.size(); i++ ){
+        for( size_t k = i; k > 0 && out[k].First < out[k - 1].First; k-- ) std::swap( out[k], out[k - 1] );
+    }
+    return out;
+}
+
+void PhaseProfiler::clear()
+{
+    std::lock_guard<std::mutex> guard( lock );
+    list.clear();
+}
+
+std::string PhaseProfiler::chromeTrace() const
+{
+    std::vector<TPhaseEvent_t> copy;
+    std::map<int, std::string> names;
+    {
+        std::lock_guard<std::mutex> guard( lock );
+        copy  = list;
+        names = devices;
+    }
+
+    std::string out( "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" );
+    char line[512];
+    bool first = true;
+
+    /* names of the processes (devices) and of the rows (channels) */
+    std::set< std::pair<int, int> > rows;
+    for( size_t i = 0; i < copy.size(); i++ ) rows.insert( std::make_pair( copy[i].Device, copy[i].Channel ) );
+    int last_device = PRF_NONE - 1;
+    for( std::set< std::pair<int, int> >::const_iterator it = rows.begin(); it != rows.end(); ++it ){
+        int device = it->first, channel = it->second;
+        if( device != last_device ){
+            std::string name = "computer";
+            if( device != PRF_NONE ){
+                snprintf( line, sizeof(line), "device %d", device );
+                name = line;
+                std::map<int, std::string>::const_iterator n = names.find( device );
+                if( n != names.end() ) name += " (" + n->second + ")";
+            }
+            snprintf( line, sizeof(line), "%s{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":0,\"args\":{\"name\":%s}}",
+                      first ? "" : ",\n", s_pid( device ), s_json( name ).c_str() );
+            out += line;
+            first = false;
+            last_device = device;
+        }
+        char row[32];
+        if( channel == PRF_NONE ) snprintf( row, sizeof(row), device == PRF_NONE ? "steps" : "device" );
+        else snprintf( row, sizeof(row), "channel %d", channel );
+        snprintf( line, sizeof(line), ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                  s_pid( device ), s_tid( channel ), row );
+        out += line;
+        snprintf( line, sizeof(line), ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"sort_index\":%d}}",
+                  s_pid( device ), s_tid( channel ), s_tid( channel ) );
+        out += line;
+    }
+
+    /* the steps, in microseconds */
+    for( size_t i = 0; i < copy.size(); i++ ){
+        const TPhaseEvent_t& e = copy[i];
+        snprintf( line, sizeof(line), "%s{\"name\":%s,\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d,\"args\":{\"status\":%d}}",
+                  first ? "" : ",\n", s_json( e.Name ).c_str(), e.Status == ERR_NOERROR ? "step" : "error",
+                  e.Start * 1e-3, e.Duration * 1e-3, s_pid( e.Device ), s_tid( e.Channel ), e.Status );
+        out += line;
+        first = false;
+    }
+    out += "\n]}\n";
+    return out;
+}
+
+int PhaseProfiler::writeChromeTrace( const std::string& path ) const
+{
+    std::string json = chromeTrace();
+    FILE* f = fopen( path.c_str(), "w" );
+    if( !f ) return ERR_GEN_FILENOTEXISTS;
+    bool ok = fwrite( json.data(), 1, json.size(), f ) == json.size();
+    return ( fclose( f ) == 0 && ok ) ? ERR_NOERROR : ERR_GEN_FILENOTEXISTS;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+PhaseScope::PhaseScope( PhaseProfiler* profiler, const char* name, int device, int channel )
+    : profiler( profiler ), name( name ), device( device ), channel( channel ),
+      start( profiler ? profiler->now() : 0 ), result( ERR_NOERROR )
+{
+}
+
+PhaseScope::~PhaseScope()
+{
+    if( profiler ) profiler->record( name, device, channel, start, result );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// instrumented function table
+
+static TEClibFunctions s_real;
+static PhaseProfiler*  s_profiler = 0;
+
+static int BL_STDCALL s_connect( const char* address, uint8 timeout, int* pID, TDeviceInfos_t* pInfos ){
+    long long start = s_profiler->now();
+    int status = s_real.BL_Connect( address, timeout, pID, pInfos );
+    int device = ( status == ERR_NOERROR && pID ) ? *pID : PRF_NONE;
+    if( device != PRF_NONE && address ) s_profiler->setDeviceName( device, address );
+    s_profiler->record( "BL_Connect", device, PRF_NONE, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_disconnect( int ID ){
+    long long start = s_profiler->now();
+    int status = s_real.BL_Disconnect( ID );
+    s_profiler->record( "BL_Disconnect", ID, PRF_NONE, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_testConnection( int ID ){
+    long long start = s_profiler->now();
+    int status = s_real.BL_TestConnection( ID );
+    s_profiler->record( "BL_TestConnection", ID, PRF_NONE, start, status );
+    return status;
+}
+
+static bool BL_STDCALL s_getUSBdeviceinfos( unsigned int USBindex, char* pcompany, unsigned int* pcompanysize, char* pdevice,
+                                            unsigned int* pdevicesize, char* pSN, unsigned int* pSNsize ){
+    long long start = s_profiler->now();
+    bool found = s_real.BL_GetUSBdeviceinfos( USBindex, pcompany, pcompanysize, pdevice, pdevicesize, pSN, pSNsize );
+    s_profiler->record( "BL_GetUSBdeviceinfos", PRF_NONE, PRF_NONE, start, found ? ERR_NOERROR : ERR_GEN_FUNCTIONFAILED );
+    return found;
+}
+
+/* a call on several channels: a step on each channel selected, with its result, or on the device if none */
+static void s_recordChannels( const char* name, int ID, const uint8* pChannels, const int* pResults, uint8 length, long long start, int status ){
+    bool any = false;
+    for( int ch = 0; pChannels && ch < length; ch++ ){
+        if( !pChannels[ch] ) continue;
+        s_profiler->record( name, ID, ch, start, ( status == ERR_NOERROR && pResults ) ? pResults[ch] : status );
+        any = true;
+    }
+    if( !any ) s_profiler->record( name, ID, PRF_NONE, start, status );
+}
+
+static int BL_STDCALL s_loadFirmware( int ID, uint8* pChannels, int* pResults, uint8 Length, bool ShowGauge, bool ForceReload, const char* BinFile, const char* XlxFile ){
+    long long start = s_profiler->now();
+    int status = s_real.BL_LoadFirmware( ID, pChannels, pResults, Length, ShowGauge, ForceReload, BinFile, XlxFile );
+    s_recordChannels( "BL_LoadFirmware", ID, pChannels, pResults, Length, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_getChannelsPlugged( int ID, uint8* pChPlugged, uint8 Size ){
+    long long start = s_profiler->now();
+    int status = s_real.BL_GetChannelsPlugged( ID, pChPlugged, Size );
+    s_profiler->record( "BL_GetChannelsPlugged", ID, PRF_NONE, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_getChannelInfos( int ID, uint8 ch, TChannelInfos_t* pInfos ){
+    long long start = s_profiler->now();
+    int status = s_real.BL_GetChannelInfos( ID, ch, pInfos );
+    s_profiler->record( "BL_GetChannelInfos", ID, ch, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_loadTechnique( int ID, uint8 channel, const char* pFName, TEccParams_t Params, bool FirstTechnique, bool LastTechnique, bool DisplayParams ){
+    long long start = s_profiler->now();
+    int status = s_real.BL_LoadTechnique( ID, channel, pFName, Params, FirstTechnique, LastTechnique, DisplayParams );
+    s_profiler->record( "BL_LoadTechnique", ID, channel, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_updateParameters( int ID, uint8 channel, int TechIndx, TEccParams_t Params, const char* EccFileName ){
+    long long start = s_profiler->now();
+    int status = s_real.BL_UpdateParameters( ID, channel, TechIndx, Params, EccFileName );
+    s_profiler->record( "BL_UpdateParameters", ID, channel, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_startChannel( int ID, uint8 channel ){
+    long long start = s_profiler->now();
+    int status = s_real.BL_StartChannel( ID, channel );
+    s_profiler->record( "BL_StartChannel", ID, channel, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_startChannels( int ID, uint8* pChannels, int* pResults, uint8 length ){
+    long long start = s_profiler->now();
+    int status = s_real.BL_StartChannels( ID, pChannels, pResults, length );
+    s_recordChannels( "BL_StartChannels", ID, pChannels, pResults, length, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_stopChannel( int ID, uint8 channel ){
+    long long start = s_profiler->now();
+    int status = s_real.BL_StopChannel( ID, channel );
+    s_profiler->record( "BL_StopChannel", ID, channel, start, status );
+    return status;
+}
+
+static int BL_STDCALL s_stopChannels( int ID, uint8* pChannels, int* pResults, uint8 length ){
+    long long start = s_profiler->now();
+    int status = s_real.BL_StopChannels( ID, pChannels, pResults, length );
+    s_recordChannels( "BL_StopChannels", ID, pChannels, pResults, length, start, status );
+    return status;
+}
+
+/* true if a function of the table is a wrapper: its calls would come back to it */
+static bool s_isInstrumented( const TEClibFunctions* eclib ){
+    return eclib->BL_Connect == s_connect || eclib->BL_Disconnect == s_disconnect || eclib->BL_TestConnection == s_testConnection ||
+           eclib->BL_GetUSBdeviceinfos == s_getUSBdeviceinfos || eclib->BL_LoadFirmware == s_loadFirmware ||
+           eclib->BL_GetChannelsPlugged == s_getChannelsPlugged || eclib->BL_GetChannelInfos == s_getChannelInfos ||
+           eclib->BL_LoadTechnique == s_loadTechnique || eclib->BL_UpdateParameters == s_updateParameters ||
+           eclib->BL_StartChannel == s_startChannel || eclib->BL_StartChannels == s_startChannels ||
+           eclib->BL_StopChannel == s_stopChannel || eclib->BL_StopChannels == s_stopChannels;
+}
+
+int PRF_InstrumentTable( const TEClibFunctions* eclib, PhaseProfiler* profiler, TEClibFunctions* out )
+{
+    if( !eclib || !profiler || !out || eclib == out || s_isInstrumented( eclib ) ) return ERR_GEN_INVALIDPARAMETERS;
+    if( s_profiler && ( profiler != s_profiler || memcmp( eclib, &s_real, sizeof(s_real) ) != 0 ) ) return ERR_GEN_FUNCTIONINPROGRESS;
+    s_real     = *eclib;
+    s_profiler = profiler;
+    *out       = *eclib;
+    /* only the functions the real table has */
+#define PRF_WRAP( name, wrapper ) if( s_real.name ) out->name = wrapper
+    PRF_WRAP( BL_Connect,            s_connect );
+    PRF_WRAP( BL_Disconnect,         s_disconnect );
+    PRF_WRAP( BL_TestConnection,     s_testConnection );
+    PRF_WRAP( BL_GetUSBdeviceinfos,  s_getUSBdeviceinfos );
+    PRF_WRAP( BL_LoadFirmware,       s_loadFirmware );
+    PRF_WRAP( BL_GetChannelsPlugged, s_getChannelsPlugged );
+    PRF_WRAP( BL_GetChannelInfos,    s_getChannelInfos );
+    PRF_WRAP( BL_LoadTechnique,      s_loadTechnique );
+    PRF_WRAP( BL_UpdateParameters,   s_updateParameters );
+    PRF_WRAP( BL_StartChannel,       s_startChannel );
+    PRF_WRAP( BL_StartChannels,      s_startChannels );
+    PRF_WRAP( BL_StopChannel,        s_stopChannel );
+    PRF_WRAP( BL_StopChannels,       s_stopChannels );
+#undef PRF_WRAP
+    return ERR_NOERROR;
+}
+
+void PRF_ReleaseTable()
+{
+    s_profiler = 0;
+    memset( &s_real, 0, sizeof(s_real) );
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#ifndef _PHASEPROFILER_H_
+#define _PHASEPROFILER_H_
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "BLFunctionTable.h"
+
+/*
+ * Timeline of the startup of the devices and of their channels
+ *
+ * Each step (load of the DLL, BL_Connect, BL_GetChannelsPlugged, BL_LoadFirmware,
+ * BL_LoadTechnique, BL_StartChannel, ...) is recorded with its device, its channel,
+ * its start, its duration and its result. The timeline is written in the trace
+ * format of Chrome (chrome://tracing, Perfetto): a process per device and a row
+ * per channel, the steps of the whole device on a row of their own.
+ *
+ * The steps are recorded by hand (PhaseScope) or by a function table whose
+ * lifecycle functions are wrapped (PRF_InstrumentTable).
+ */
+
+/**
+ * \defgroup phase_profiler Phase profiler
+ * @{
+ */
+
+/** Device or channel of a step which concerns none */
+#define PRF_NONE        (-1)
+
+/** A step */
+typedef struct {
+    std::string  Name;
+    int          Device;     /*!< device identifier, \ref PRF_NONE for the computer */
+    int          Channel;    /*!< \ref PRF_NONE for the whole device */
+    long long    Start;      /*!< ns since the profiler was created */
+    long long    Duration;   /*!< ns */
+    int          Status;     /*!< result of the step */
+} TPhaseEvent_t;
+
+/** Steps of the same name */
+typedef struct {
+    std::string  Name;
+    int          Count;
+    int          Errors;
+    double       Seconds;    /*!< sum of the durations */
+    double       Max;
+    double       First;      /*!< start of the first one, s */
+    double       Last;       /*!< end of the last one, s */
+} TPhaseTotal_t;
+
+/**
+ * This class records the steps. It may be shared by several threads.
+ */
+class PhaseProfiler
+{
+public:
+    PhaseProfiler();
+
+    /** Time (ns since the profiler was created), to give as start of \ref record */
+    long long now() const;
+
+    /** Records a step which began at 'start' and ends now */
+    void record( const char* name, int device, int channel, long long start, int status = ERR_NOERROR );
+
+    /** Gives a name to a device in the timeline ("USB0", "192.109.209.200") */
+    void setDeviceName( int device, const std::string& name );
+
+    std::vector<TPhaseEvent_t> events() const;
+
+    /** Steps by name, in the order of their first start */
+    std::vector<TPhaseTotal_t> totals() const;
+
+    void clear();
+
+    /** The timeline as Chrome trace JSON */
+    std::string chromeTrace() const;
+
+    /**
+     * This function writes the timeline as Chrome trace JSON.
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_FILENOTEXISTS if the file cannot be written.
+     */
+    int writeChromeTrace( const std::string& path ) const;
+
+private:
+    PhaseProfiler( const PhaseProfiler& );
+    PhaseProfiler& operator=( const PhaseProfiler& );
+
+    long long                  origin;   /* ns, steady clock */
+    mutable std::mutex         lock;
+    std::vector<TPhaseEvent_t> list;
+    std::map<int, std::string> devices;
+};
+
+/**
+ * This class records a step from its construction to its destruction.
+ */
+class PhaseScope
+{
+public:
+    PhaseScope( PhaseProfiler* profiler, const char* name, int device = PRF_NONE, int channel = PRF_NONE );
+    ~PhaseScope();
+
+    /** Result recorded with the step */
+    void setStatus( int status ) { result = status; }
+
+private:
+    PhaseScope( const PhaseScope& );
+    PhaseScope& operator=( const PhaseScope& );
+
+    PhaseProfiler* profiler;
+    const char*    name;
+    int            device;
+    int            channel;
+    long long      start;
+    int            result;
+};
+
+/**
+ * This function makes a function table whose lifecycle functions (BL_Connect,
+ * BL_Disconnect, BL_TestConnection, BL_GetUSBdeviceinfos, BL_GetChannelsPlugged,
+ * BL_GetChannelInfos, BL_LoadFirmware, BL_LoadTechnique, BL_UpdateParameters,
+ * BL_StartChannel(s), BL_StopChannel(s)) record a step in the profiler before
+ * they return. BL_LoadFirmware, BL_StartChannels and BL_StopChannels record a
+ * step on each channel selected, with the result of the channel. The other
+ * functions are those of 'eclib'.
+ *
+ * There is one instrumented table at a time in the program: until \ref PRF_ReleaseTable,
+ * a call with another profiler or other functions is refused, and 'eclib' cannot be
+ * an instrumented table (its calls would come back to the wrappers).
+ *
+ * @param eclib the functions to call
+ * @param profiler where the steps are recorded
+ * @param out the instrumented table
+ * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_FUNCTIONINPROGRESS if another
+ *         table is instrumented, \ref ERR_GEN_INVALIDPARAMETERS otherwise.
+ */
+int PRF_InstrumentTable( const TEClibFunctions* eclib, PhaseProfiler* profiler, TEClibFunctions* out );
+
+/**
+ * This function ends the instrumented table, once no thread calls it any more:
+ * another one can then be made.
+ */
+void PRF_ReleaseTable();
+
+/** @} */
+
+#endif /* _PHASEPROFILER_H_ */
@@ -0,0 +1,279 @@
+#include "TechniqueCache.h"
+
+#include <string.h>
+#include <chrono>
+
+#include "MappedFile.h"
+#include "ParallelFor.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double s_elapsed( Clock::time_point start ){
+    return std::chrono::duration<double>( Clock::now() - start ).count();
+}
+
+static bool s_sameParam( const TEccParam_t& a, const TEccParam_t& b ){
+    return a.ParamType == b.ParamType && a.ParamIndex == b.ParamIndex
+        && strncmp( a.ParamStr, b.ParamStr, sizeof(a.ParamStr) ) == 0;
+}
+
+bool ECC_SameShape( const std::vector<TEccTechnique_t>& a, const std::vector<TEccTechnique_t>& b )
+{
+    if( a.size() != b.size() ) return false;
+    for( size_t t = 0; t < a.size(); t++ ){
+        if( a[t].TechniqueID != b[t].TechniqueID || a[t].EccFile != b[t].EccFile
+            || a[t].Params.size() != b[t].Params.size() ){
+            return false;
+        }
+        for( size_t p = 0; p < a[t].Params.size(); p++ ){
+            if( !s_sameParam( a[t].Params[p], b[t].Params[p] ) ) return false;
+        }
+    }
+    return true;
+}
+
+bool ECC_SameValues( const TEccTechnique_t& a, const TEccTechnique_t& b )
+{
+    if( a.Params.size() != b.Params.size() ) return false;
+    for( size_t p = 0; p < a.Params.size(); p++ ){
+        if( a.Params[p].ParamVal != b.Params[p].ParamVal || !s_sameParam( a.Params[p], b.Params[p] ) ) return false;
+    }
+    return true;
+}
+
+int ECC_CheckChain( const std::vector<TEccTechnique_t>& chain, const std::string& ecc_dir, EccLibrary* library )
+{
+    if( chain.empty() ) return ERR_GEN_INVALIDPARAMETERS;
+    for( size_t t = 0; t < chain.size(); t++ ){
+        const TEccTechnique_t& tech = chain[t];
+        if( tech.EccFile.empty() ) return ERR_GEN_INVALIDPARAMETERS;
+        for( size_t p = 0; p < tech.Params.size(); p++ ){
+            const TEccParam_t& param = tech.Params[p];
+            if( param.ParamStr[0] == '\0' || memchr( param.ParamStr, '\0', sizeof(param.ParamStr) ) == 0
+                || param.ParamType < PARAM_INT32 || param.ParamType > PARAM_SINGLE || param.ParamIndex < 0 ){
+                return ERR_GEN_INVALIDPARAMETERS;
+            }
+        }
+
+        /* each file is read once, even if several techniques of the chain use it */
+        bool seen = false;
+        for( size_t u = 0; u < t && !seen; u++ ) seen = chain[u].EccFile == tech.EccFile;
+        if( seen ) continue;
+        if( library ){
+            TEccFile_t file;
+            int status = library->file( tech.EccFile, &file );
+            if( status != ERR_NOERROR ) return status;
+            if( file.Size == 0 ) return ERR_TECH_ECCFILECORRUPTED;
+            continue;
+        }
+        MappedFile ecc;
+        std::string path = ecc_dir + tech.EccFile;
+        if( ecc.open( path.c_str() ) != ERR_NOERROR ) return ERR_TECH_ECCFILENOTEXISTS;
+        if( ecc.size() == 0 ) return ERR_TECH_ECCFILECORRUPTED;
+        volatile unsigned char sink = 0;
+        for( size_t i = 0; i < ecc.size(); i += 4096 ) sink = sink + ecc.data()[i];   /* in the system cache for the loads */
+    }
+    return ERR_NOERROR;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// TechniqueCache
+
+TechniqueCache::TechniqueCache( const TEClibFunctions* eclib, const std::string& ecc_dir )
+    : eclib( eclib )
+    , ecc_dir( ecc_dir )
+    , library( 0 )
+{
+    memset( &counters, 0, sizeof(counters) );
+}
+
+TechniqueCache::TEntry_t* TechniqueCache::entry( int id, uint8 channel, bool create ) const
+{
+    std::lock_guard<std::mutex> guard( entries_lock );
+    TEntries_t::iterator found = entries.find( std::make_pair( id, channel ) );
+    if( found != entries.end() ) return found->second.get();
+    if( !create ) return 0;
+    TEntry_t* made = new TEntry_t();
+    made->Valid = false;
+    entries[std::make_pair( id, channel )].reset( made );
+    return made;
+}
+
+int TechniqueCache::load( int id, uint8 channel, const std::vector<TEccTechnique_t>& chain, TTechniqueLoad_t* report )
+{
+    TTechniqueLoad_t done;
+    done.Kind       = TECH_LOAD_FULL;
+    done.Techniques = 0;
+    done.Status     = ERR_NOERROR;
+    done.Seconds    = 0.0;
+
+    if( chain.empty() || !eclib || !eclib->BL_LoadTechnique || !eclib->BL_UpdateParameters ){
+        done.Status = ERR_GEN_INVALIDPARAMETERS;
+        if( report ) *report = done;
+        return done.Status;
+    }
+
+    TEntry_t& entry = *this->entry( id, channel, true );
+    std::lock_guard<std::mutex> guard( entry.Lock );
+    Clock::time_point start = Clock::now();
+    bool fallback = false;
+
+    if( entry.Valid && ECC_SameShape( entry.Chain, chain ) ){
+        done.Kind = TECH_LOAD_UNCHANGED;
+        std::vector<TEccParam_t> changed;
+        for( size_t t = 0; t < chain.size() && done.Status == ERR_NOERROR; t++ ){
+            ECC_ChangedParams( entry.Chain[t], chain[t], changed );
+            if( changed.empty() ) continue;
+            for( size_t p = 0; p < changed.size() && done.Status == ERR_NOERROR; p++ ){
+                /* the acquisition parameters are locked once the technique is loaded */
+                if( ECC_IsHardwareParam( changed[p].ParamStr ) ) done.Status = ERR_GEN_UPDATEPARAMETERS;
+            }
+            std::string path;
+            if( done.Status == ERR_NOERROR ) done.Status = eccPath( chain[t].EccFile, &path );
+            for( size_t p = 0; p < changed.size() && done.Status == ERR_NOERROR; p += ECC_UPDATE_MAX_PARAMS ){
+                TEccParams_t params;
+                params.len     = (int)( changed.size() - p < ECC_UPDATE_MAX_PARAMS ? changed.size() - p : ECC_UPDATE_MAX_PARAMS );
+                params.pParams = &changed[p];
+                done.Status = eclib->BL_UpdateParameters( id, channel, (int)t, params, path.c_str() );
+            }
+            if( done.Status == ERR_NOERROR ){
+                entry.Chain[t] = chain[t];
+                done.Kind = TECH_LOAD_UPDATE;
+                done.Techniques++;
+            }
+        }
+        if( done.Status != ERR_NOERROR ){
+            /* the instrument may hold a mix of old and new values: load everything again */
+            fallback = true;
+            done.Kind = TECH_LOAD_FULL;
+            done.Techniques = 0;
+        }
+    }
+
+    if( done.Kind == TECH_LOAD_FULL ){
+        entry.Valid  = false;
+        done.Status  = fullLoad( id, channel, chain, &done.Techniques );
+        if( done.Status == ERR_NOERROR ){
+            entry.Chain = chain;
+            entry.Valid = true;
+        }
+    }
+    done.Seconds = s_elapsed( start );
+
+    {
+        std::lock_guard<std::mutex> stats_guard( stats_lock );
+        if( fallback ) counters.Fallbacks++;
+        switch( done.Kind ){
+            case TECH_LOAD_FULL:      counters.FullLoads++; counters.LoadSeconds += done.Seconds; break;
+            case TECH_LOAD_UPDATE:    counters.Updates++;   counters.UpdateSeconds += done.Seconds; break;
+            default:                  counters.Unchanged++; break;
+        }
+    }
+    if( report ) *report = done;
+    return done.Status;
+}
+
+int TechniqueCache::fullLoad( int id, uint8 channel, const std::vector<TEccTechnique_t>& chain, int* sent )
+{
+    int status = ERR_NOERROR;
+    *sent = 0;
+    for( size_t t = 0; t < chain.size() && status == ERR_NOERROR; t++ ){
+        std::string path;
+        status = eccPath( chain[t].EccFile, &path );
+        if( status != ERR_NOERROR ) break;
+        status = eclib->BL_LoadTechnique( id, channel, path.c_str(), ECC_Params( chain[t] ),
+                                          t == 0, t + 1 == chain.size(), false );
+        if( status == ERR_NOERROR ) (*sent)++;
+    }
+    return status;
+}
+
+int TechniqueCache::loadChannels( int id, const uint8* pChannels, int* pResults, uint8 length,
+                                  const std::vector<TEccTechnique_t>& chain, TTechniqueBulkLoad_t* report, int threads )
+{
+    TTechniqueBulkLoad_t done;
+    memset( &done, 0, sizeof(done) );
+    if( report ) *report = done;
+    if( !pChannels || !pResults || length == 0 ) return ERR_GEN_INVALIDPARAMETERS;
+
+    std::vector<uint8> selected;
+    for( int ch = 0; ch < length; ch++ ){
+        if( pChannels[ch] ) selected.push_back( (uint8)ch );
+    }
+    if( selected.empty() ) return ERR_GEN_NOCHANNELELECTED;
+    done.Channels = (int)selected.size();
+
+    Clock::time_point start = Clock::now();
+    int status = ECC_CheckChain( chain, ecc_dir, library );
+    done.CheckSeconds = s_elapsed( start );
+    if( status != ERR_NOERROR ){
+        for( size_t i = 0; i < selected.size(); i++ ) pResults[selected[i]] = status;
+        done.Failed  = done.Channels;
+        done.Seconds = s_elapsed( start );
+        if( report ) *report = done;
+        return status;
+    }
+
+    /* the channels are taken in order by the threads, each thread loads its channel up to the end */
+    done.Threads = PAR_For( selected.size(), threads, [&]( size_t i ){
+        pResults[selected[i]] = load( id, selected[i], chain );
+    } );
+    done.Seconds = s_elapsed( start );
+
+    for( size_t i = 0; i < selected.size(); i++ ){
+        if( pResults[selected[i]] == ERR_NOERROR ) continue;
+        if( status == ERR_NOERROR ) status = pResults[selected[i]];
+        done.Failed++;
+    }
+    if( report ) *report = done;
+    return status;
+}
+
+int TechniqueCache::eccPath( const std::string& name, std::string* path ) const
+{
+    if( !library ){
+        *path = ecc_dir + name;
+        return ERR_NOERROR;
+    }
+    TEccFile_t file;
+    int status = library->file( name, &file );
+    if( status == ERR_NOERROR ) *path = file.Path;
+    return status;
+}
+
+void TechniqueCache::invalidate( int id, uint8 channel )
+{
+    TEntry_t* found = entry( id, channel, false );
+    if( !found ) return;
+    std::lock_guard<std::mutex> guard( found->Lock );
+    found->Valid = false;
+    found->Chain.clear();
+}
+
+void TechniqueCache::clear()
+{
+    std::vector<TEntry_t*> list;
+    {
+        std::lock_guard<std::mutex> guard( entries_lock );
+        for( TEntries_t::iterator it = entries.begin(); it != entries.end(); ++it ) list.push_back( it->second.get() );
+    }
+    for( size_t i = 0; i < list.size(); i++ ){
+        std::lock_guard<std::mutex> guard( list[i]->Lock );
+        list[i]->Valid = false;
+        list[i]->Chain.clear();
+    }
+}
+
+bool TechniqueCache::isLoaded( int id, uint8 channel ) const
+{
+    TEntry_t* found = entry( id, channel, false );
+    if( !found ) return false;
+    std::lock_guard<std::mutex> guard( found->Lock );
+    return found->Valid;
+}
+
+TTechniqueCacheStats_t TechniqueCache::stats() const
+{
+    std::lock_guard<std::mutex> guard( stats_lock );
+    return counters;
+}
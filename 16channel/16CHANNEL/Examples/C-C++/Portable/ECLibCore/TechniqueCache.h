@@ -0,0 +1,182 @@
+#pragma once
+
+#ifndef _TECHNIQUECACHE_H_
+#define _TECHNIQUECACHE_H_
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "BLFunctionTable.h"
+#include "EccLibrary.h"
+#include "EccParams.h"
+
+/*
+ * Technique chains loaded on the channels
+ *
+ * BL_LoadTechnique sends the .ecc file and the parameters of every technique of
+ * the chain; BL_UpdateParameters only sends parameters of one technique already
+ * loaded, at most 10 per call. The cache keeps the chain last loaded on each
+ * channel of each device and, when a chain of the same shape is loaded again (same .ecc files,
+ * same labels, types and indices), only sends the parameters whose values changed.
+ * A change of an acquisition parameter (I_Range, ...) needs a full load.
+ */
+
+/**
+ * \defgroup technique_cache Technique cache
+ * @{
+ */
+
+/** What a \ref TechniqueCache::load did */
+typedef enum {
+    TECH_LOAD_FULL      = 0, /*!< the chain was loaded with BL_LoadTechnique */
+    TECH_LOAD_UPDATE    = 1, /*!< the changed techniques were updated with BL_UpdateParameters */
+    TECH_LOAD_UNCHANGED = 2  /*!< the chain was already loaded, nothing was sent */
+} TTechniqueLoadKind_e;
+
+/** Report of a \ref TechniqueCache::load */
+typedef struct {
+    int    Kind;       /*!< see \ref TTechniqueLoadKind_e */
+    int    Techniques; /*!< techniques sent (loaded or updated) */
+    int    Status;     /*!< result of the load */
+    double Seconds;    /*!< time spent in the ECLib calls */
+} TTechniqueLoad_t;
+
+/** Report of a \ref TechniqueCache::loadChannels */
+typedef struct {
+    int    Channels;       /*!< channels selected */
+    int    Failed;         /*!< channels whose load failed */
+    int    Threads;        /*!< channels loaded at once */
+    double CheckSeconds;   /*!< time spent reading and checking the .ecc files */
+    double Seconds;        /*!< wall-clock time of the whole load */
+} TTechniqueBulkLoad_t;
+
+/** Counters of a \ref TechniqueCache */
+typedef struct {
+    unsigned long long FullLoads;
+    unsigned long long Updates;
+    unsigned long long Unchanged;
+    unsigned long long Fallbacks;  /*!< updates refused (instrument, acquisition parameter), followed by a full load */
+    double             LoadSeconds;
+    double             UpdateSeconds;
+} TTechniqueCacheStats_t;
+
+/**
+ * This class loads technique chains on the channels of the instruments, through an
+ * ECLib function table. It may be used by one thread per channel at once.
+ */
+class TechniqueCache
+{
+public:
+    /**
+     * @param eclib ECLib functions: BL_LoadTechnique and BL_UpdateParameters are used
+     * @param ecc_dir folder of the .ecc files, prepended to \ref TEccTechnique_t::EccFile
+     */
+    TechniqueCache( const TEClibFunctions* eclib, const std::string& ecc_dir = std::string() );
+
+    /**
+     * This function loads a chain on a channel, or updates the one already loaded.
+     *
+     * A full load is done when the channel of this device has no chain in the cache,
+     * when the shape of the chain or an acquisition parameter changed. When only values changed, BL_UpdateParameters is called with the
+     * changed parameters; if the instrument refuses an update, the chain is fully loaded.
+     *
+     * @param id device identifier
+     * @param channel channel (0-based)
+     * @param chain techniques, in the order of the chain
+     * @param report optional report of what was done
+     * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_INVALIDPARAMETERS if the chain is empty
+     *         or the functions are missing, otherwise the error of the ECLib function.
+     */
+    int load( int id, uint8 channel, const std::vector<TEccTechnique_t>& chain, TTechniqueLoad_t* report = 0 );
+
+    /**
+     * This function loads a chain on several channels of a device at once.
+     *
+     * The .ecc files of the chain are read and checked once, before anything is
+     * sent; then the channels are loaded by several threads, so that the commands
+     * of a channel are sent while another channel processes its own. Each channel
+     * is loaded as by \ref load.
+     *
+     * @param id device identifier
+     * @param pChannels array who represents the channels of the device, as for BL_StartChannels:
+     *                  0: channel not selected, 1: channel selected
+     * @param pResults array that will receive the result of the load of each channel selected
+     * @param length length of the arrays pointed by pChannels and pResults
+     * @param chain techniques, in the order of the chain
+     * @param report optional report of the load
+     * @param threads channels loaded at once, 0 for all the channels selected
+     * @return \ref ERR_NOERROR if every channel was loaded, \ref ERR_GEN_NOCHANNELELECTED if no
+     *         channel is selected, the error of \ref ECC_CheckChain if the chain is not valid (then
+     *         nothing is sent), otherwise the first error of the channels.
+     */
+    int loadChannels( int id, const uint8* pChannels, int* pResults, uint8 length,
+                      const std::vector<TEccTechnique_t>& chain, TTechniqueBulkLoad_t* report = 0, int threads = 0 );
+
+    /** Forgets the chain of a channel of a device: the next \ref load is a full load (firmware reloaded, ...) */
+    void invalidate( int id, uint8 channel );
+
+    /** Forgets the chains of all the channels of all the devices */
+    void clear();
+
+    /** True if a chain is loaded on the channel according to the cache */
+    bool isLoaded( int id, uint8 channel ) const;
+
+    TTechniqueCacheStats_t stats() const;
+
+    const std::string& eccDir() const { return ecc_dir; }
+
+    /**
+     * Takes the .ecc files from a library instead of the folder given to the constructor:
+     * their absolute paths are given to ECLib and the checks of \ref loadChannels are
+     * done in memory. The library must outlive the cache; 0 goes back to the folder.
+     */
+    void setLibrary( EccLibrary* ecc_library ) { library = ecc_library; }
+
+private:
+    typedef struct {
+        std::mutex                   Lock;
+        bool                         Valid;
+        std::vector<TEccTechnique_t> Chain;
+    } TEntry_t;
+    typedef std::map< std::pair<int, uint8>, std::unique_ptr<TEntry_t> > TEntries_t;
+
+    /* the entry of a channel of a device, made if 'create'; it stays until the cache is destroyed */
+    TEntry_t* entry( int id, uint8 channel, bool create ) const;
+    int fullLoad( int id, uint8 channel, const std::vector<TEccTechnique_t>& chain, int* sent );
+    int eccPath( const std::string& name, std::string* path ) const;
+
+    const TEClibFunctions*      eclib;
+    std::string                 ecc_dir;
+    EccLibrary*                 library;
+    mutable std::mutex          entries_lock;
+    mutable TEntries_t          entries;    /* by device and channel */
+    mutable std::mutex          stats_lock;
+    TTechniqueCacheStats_t      counters;
+};
+
+/**
+ * This function checks a chain before it is loaded: every .ecc file is read once and
+ * must not be empty, every parameter must have a label, a known type and a valid index.
+ *
+ * @param chain techniques, in the order of the chain
+ * @param ecc_dir folder of the .ecc files
+ * @param library if not 0, the .ecc files are taken from this library, in memory, instead of the folder
+ * @return \ref ERR_NOERROR if successful, \ref ERR_GEN_INVALIDPARAMETERS if the chain is empty or
+ *         a parameter is not valid, \ref ERR_TECH_ECCFILENOTEXISTS if a .ecc file cannot be read,
+ *         \ref ERR_TECH_ECCFILECORRUPTED if it is empty.
+ */
+int ECC_CheckChain( const std::vector<TEccTechnique_t>& chain, const std::string& ecc_dir, EccLibrary* library = 0 );
+
+/** True if the two chains have the same .ecc files and the same labels, types and indices */
+bool ECC_SameShape( const std::vector<TEccTechnique_t>& a, const std::vector<TEccTechnique_t>& b );
+
+/** True if the two techniques have the same parameters and values */
+bool ECC_SameValues( const TEccTechnique_t& a, const TEccTechnique_t& b );
+
+/** @} */
+
+#endif /* _TECHNIQUECACHE_H_ */
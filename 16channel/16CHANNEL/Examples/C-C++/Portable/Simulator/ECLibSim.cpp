@@ -0,0 +1,161 @@
+// ECLibSim.cpp : the simulated instrument as a shared library with the symbols of the DLL
+//
+// libECLibSim.so (ECLibSim.dll on Windows) exports every function of BLFunctions.h;
+// a program which loads ECLib at run time loads it instead, and runs without device.
+// The simulated devices take their configuration from the environment when the
+// library is first called (see SIM_ConfigFromEnvironment in InstrumentSim.h):
+//
+//     ECLIBSIM_CHANNELS=8 ECLIBSIM_SPEED=0 ECLIBSIM_STEP=0.05 ./program
+//
+
+/* the declarations of BLFunctions.h are checked against the definitions below */
+#ifndef _WIN32
+#define _stdcall
+#endif
+#include <BLFunctions.h>
+
+#include "InstrumentSim.h"
+
+#ifdef _WIN32
+#define SIM_EXPORT __declspec(dllexport)
+#else
+#define SIM_EXPORT __attribute__((visibility("default")))
+#endif
+
+static const TEClibFunctions* s_table(){
+    static TEClibFunctions table;
+    static int status = ( SIM_Configure( SIM_ConfigFromEnvironment() ), SIM_FillFunctionTable( &table ) );
+    (void)status;
+    return &table;
+}
+
+SIM_EXPORT int _stdcall BL_GetLibVersion( char* pVersion, unsigned int* psize ){
+    return s_table()->BL_GetLibVersion( pVersion, psize );
+}
+
+SIM_EXPORT unsigned int _stdcall BL_GetVolumeSerialNumber( void ){
+    return s_table()->BL_GetVolumeSerialNumber();
+}
+
+SIM_EXPORT int _stdcall BL_GetErrorMsg( int errorcode, char* pmsg, unsigned int* psize ){
+    return s_table()->BL_GetErrorMsg( errorcode, pmsg, psize );
+}
+
+SIM_EXPORT int _stdcall BL_Connect( const char* address, uint8 timeout, int* pID, TDeviceInfos_t* pInfos ){
+    return s_table()->BL_Connect( address, timeout, pID, pInfos );
+}
+
+SIM_EXPORT int _stdcall BL_Disconnect( int ID ){
+    return s_table()->BL_Disconnect( ID );
+}
+
+SIM_EXPORT int _stdcall BL_TestConnection( int ID ){
+    return s_table()->BL_TestConnection( ID );
+}
+
+SIM_EXPORT int _stdcall BL_TestCommSpeed( int ID, uint8 channel, int* spd_rcvt, int* spd_kernel ){
+    return s_table()->BL_TestCommSpeed( ID, channel, spd_rcvt, spd_kernel );
+}
+
+SIM_EXPORT bool _stdcall BL_GetUSBdeviceinfos( unsigned int USBindex, char* pcompany, unsigned int* pcompanysize,
+                                               char* pdevice, unsigned int* pdevicesize, char* pSN, unsigned int* pSNsize ){
+    return s_table()->BL_GetUSBdeviceinfos( USBindex, pcompany, pcompanysize, pdevice, pdevicesize, pSN, pSNsize );
+}
+
+SIM_EXPORT int _stdcall BL_LoadFirmware( int ID, uint8* pChannels, int* pResults, uint8 Length,
+                                         bool ShowGauge, bool ForceReload, const char* BinFile, const char* XlxFile ){
+    return s_table()->BL_LoadFirmware( ID, pChannels, pResults, Length, ShowGauge, ForceReload, BinFile, XlxFile );
+}
+
+SIM_EXPORT bool _stdcall BL_IsChannelPlugged( int ID, uint8 ch ){
+    return s_table()->BL_IsChannelPlugged( ID, ch );
+}
+
+SIM_EXPORT int _stdcall BL_GetChannelsPlugged( int ID, uint8* pChPlugged, uint8 Size ){
+    return s_table()->BL_GetChannelsPlugged( ID, pChPlugged, Size );
+}
+
+SIM_EXPORT int _stdcall BL_GetChannelInfos( int ID, uint8 ch, TChannelInfos_t* pInfos ){
+    return s_table()->BL_GetChannelInfos( ID, ch, pInfos );
+}
+
+SIM_EXPORT int _stdcall BL_GetMessage( int ID, uint8 ch, char* msg, unsigned int* size ){
+    return s_table()->BL_GetMessage( ID, ch, msg, size );
+}
+
+SIM_EXPORT int _stdcall BL_GetHardConf( int ID, uint8 ch, THardwareConf_t* pHardConf ){
+    return s_table()->BL_GetHardConf( ID, ch, pHardConf );
+}
+
+SIM_EXPORT int _stdcall BL_SetHardConf( int ID, uint8 ch, THardwareConf_t HardConf ){
+    return s_table()->BL_SetHardConf( ID, ch, HardConf );
+}
+
+SIM_EXPORT int _stdcall BL_LoadTechnique( int ID, uint8 channel, const char* pFName, TEccParams_t Params,
+                                          bool FirstTechnique, bool LastTechnique, bool DisplayParams ){
+    return s_table()->BL_LoadTechnique( ID, channel, pFName, Params, FirstTechnique, LastTechnique, DisplayParams );
+}
+
+SIM_EXPORT int _stdcall BL_DefineBoolParameter( const char* lbl, bool value, int index, TEccParam_t* pParam ){
+    return s_table()->BL_DefineBoolParameter( lbl, value, index, pParam );
+}
+
+SIM_EXPORT int _stdcall BL_DefineSglParameter( const char* lbl, float value, int index, TEccParam_t* pParam ){
+    return s_table()->BL_DefineSglParameter( lbl, value, index, pParam );
+}
+
+SIM_EXPORT int _stdcall BL_DefineIntParameter( const char* lbl, int value, int index, TEccParam_t* pParam ){
+    return s_table()->BL_DefineIntParameter( lbl, value, index, pParam );
+}
+
+SIM_EXPORT int _stdcall BL_UpdateParameters( int ID, uint8 channel, int TechIndx, TEccParams_t Params, const char* EccFileName ){
+    return s_table()->BL_UpdateParameters( ID, channel, TechIndx, Params, EccFileName );
+}
+
+SIM_EXPORT int _stdcall BL_StartChannel( int ID, uint8 channel ){
+    return s_table()->BL_StartChannel( ID, channel );
+}
+
+SIM_EXPORT int _stdcall BL_StartChannels( int ID, uint8* pChannels, int* pResults, uint8 length ){
+    return s_table()->BL_StartChannels( ID, pChannels, pResults, length );
+}
+
+SIM_EXPORT int _stdcall BL_StopChannel( int ID, uint8 channel ){
+    return s_table()->BL_StopChannel( ID, channel );
+}
+
+SIM_EXPORT int _stdcall BL_StopChannels( int ID, uint8* pChannels, int* pResults, uint8 length ){
+    return s_table()->BL_StopChannels( ID, pChannels, pResults, length );
+}
+
+SIM_EXPORT int _stdcall BL_GetCurrentValues( int ID, uint8 channel, TCurrentValues_t* pValues ){
+    return s_table()->BL_GetCurrentValues( ID, channel, pValues );
+}
+
+SIM_EXPORT int _stdcall BL_GetData( int ID, uint8 channel, TDataBuffer_t* pBuf, TDataInfos_t* pInfos, TCurrentValues_t* pValues ){
+    return s_table()->BL_GetData( ID, channel, pBuf, pInfos, pValues );
+}
+
+SIM_EXPORT int _stdcall BL_GetFCTData( int ID, uint8 channel, TDataBuffer_t* pBuf, TDataInfos_t* pInfos, TCurrentValues_t* pValues ){
+    return s_table()->BL_GetFCTData( ID, channel, pBuf, pInfos, pValues );
+}
+
+SIM_EXPORT int _stdcall BL_ConvertNumericIntoSingle( unsigned int num, float* psgl ){
+    return s_table()->BL_ConvertNumericIntoSingle( num, psgl );
+}
+
+SIM_EXPORT int _stdcall BL_SetExperimentInfos( int ID, uint8 channel, TExperimentInfos_t TExpInfos ){
+    return s_table()->BL_SetExperimentInfos( ID, channel, TExpInfos );
+}
+
+SIM_EXPORT int _stdcall BL_GetExperimentInfos( int ID, uint8 channel, TExperimentInfos_t* TExpInfos ){
+    return s_table()->BL_GetExperimentInfos( ID, channel, TExpInfos );
+}
+
+SIM_EXPORT int _stdcall BL_SendMsg( int ID, uint8 ch, void* pBuf, unsigned int* pLen ){
+    return s_table()->BL_SendMsg( ID, ch, pBuf, pLen );
+}
+
+SIM_EXPORT int _stdcall BL_LoadFlash( int ID, const char* pfname, bool ShowGauge ){
+    return s_table()->BL_LoadFlash( ID, pfname, ShowGauge );
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#ifndef _TOOLTECHNIQUES_H_
+#define _TOOLTECHNIQUES_H_
+
+#include "BLFunctionTable.h"
+#include "EccBuilder.h"
+
+/*
+ * Techniques loaded by the command line programs on the simulated channels
+ */
+
+/** Number of parameters of \ref TOOL_LoadCA */
+#define TOOL_CA_PARAMS (2 * 3 + 4)
+
+/**
+ * This function loads a CA of two steps (0.5 V then 0.2 V), 'seconds' long,
+ * recording 'rate' points per second, on a channel.
+ * @return \ref ERR_NOERROR if successful, the error of the parameters or of BL_LoadTechnique otherwise.
+ */
+inline int TOOL_LoadCA( const TEClibFunctions* eclib, int id, int ch, double seconds, double rate )
+{
+    typedef EccSchemaCA S;
+    EccArena arena( TOOL_CA_PARAMS );
+    EccBuilder<S> ca( arena );
+    for( int k = 0; k < 2; k++ ){
+        ca.sgl <ECC_PARAM( S, "Voltage_step" )> ( k ? 0.2f : 0.5f, k )
+          .flag<ECC_PARAM( S, "vs_initial" )>   ( false, k )
+          .sgl <ECC_PARAM( S, "Duration_step" )>( (float)( seconds / 2 ), k );
+    }
+    ca.num<ECC_PARAM( S, "Step_number" )>    ( 1 )
+      .num<ECC_PARAM( S, "N_Cycles" )>       ( 0 )
+      .sgl<ECC_PARAM( S, "Record_every_dT" )>( (float)( 1.0 / rate ) )
+      .num<ECC_PARAM( S, "I_Range" )>        ( KBIO_IRANGE_10mA );
+    TEccParams_t params;
+    int status = ca.params( &params );
+    if( status != ERR_NOERROR ) return status;
+    return eclib->BL_LoadTechnique( id, (uint8)ch, "ca.ecc", params, true, true, false );
+}
+
+#endif /* _TOOLTECHNIQUES_H_ */
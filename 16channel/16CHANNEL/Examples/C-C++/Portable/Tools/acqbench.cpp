@@ -0,0 +1,368 @@
+// acqbench.cpp : benchmark suite of the acquisition path
+//
+// usage: acqbench [results.json] [seconds per run] [work folder]
+//
+// The acquisition path of a program is run against simulated devices (see
+// InstrumentSim.h): a poll thread calls BL_GetData on every channel and decodes
+// the buffers, a consumer thread stores the frames in a capture file and exports
+// them to one .mpr file per channel (in the work folder; no folder, no files).
+// The runs sweep the number of channels (1 to 64, 16 per device), the rate of
+// the points and the number of extra values ("xctr"). The clock of the devices
+// moves between the polls, so every run gets the same points.
+//
+// For each run: points per second, latency from the return of BL_GetData to the
+// frame stored and exported (p50, p99), CPU of the program per channel (the time
+// in the simulated BL_GetData left out) and allocations per frame (those of the
+// program only). The results are written as JSON, to be compared between builds.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BLDecode.h"
+#include "CaptureFile.h"
+#include "Histogram.h"
+#include "InstrumentSim.h"
+#include "MprWriter.h"
+
+typedef std::chrono::steady_clock Clock;
+
+#define POLL_PERIOD  (0.05)   /* s of the simulation between two polls */
+#define QUEUE_SLOTS  (64)     /* frames between the poll thread and the consumer */
+
+/////////////////////////////////////////////////////////////////////////////
+// allocations of the program: counted on the threads of the path, outside BL_GetData
+
+static std::atomic<unsigned long long> s_allocs( 0 );
+static thread_local bool               s_counting = false;
+
+void* operator new( size_t size )
+{
+    if( s_counting ) s_allocs++;
+    void* p = malloc( size ? size : 1 );
+    if( !p ) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete( void* p ) noexcept { free( p ); }
+void operator delete( void* p, size_t ) noexcept { free( p ); }
+
+/////////////////////////////////////////////////////////////////////////////
+
+static double s_elapsed( Clock::time_point start ){
+    return std::chrono::duration<double>( Clock::now() - start ).count();
+}
+
+/* a decoded frame waiting for the consumer */
+typedef struct {
+    int               Channel;
+    Clock::time_point Received;   /* when BL_GetData returned */
+    TDecodedFrame_t   Frame;
+} TSlot_t;
+
+/* slots decoded in place by the poll thread, then stored by the consumer: one producer, one consumer */
+typedef struct {
+    std::unique_ptr<TSlot_t[]> Slots;
+    size_t                     Head;    /* next slot for the consumer */
+    size_t                     Tail;    /* next slot for the producer */
+    bool                       Closed;
+    std::mutex                 Lock;
+    std::condition_variable    Changed;
+} TFrameQueue_t;
+
+/* results of a run */
+typedef struct {
+    int                Channels;
+    double             Rate;
+    int                ExtraColumns;
+    unsigned long long Points;
+    unsigned long long Frames;
+    unsigned long long Skipped;
+    double             Seconds;         /* wall time of the acquisition */
+    double             DeviceSeconds;   /* in the simulated BL_GetData */
+    double             CpuSeconds;
+    unsigned long long Allocs;
+    THistSummary_t     Latency;
+    int                Errors;
+} TRunResult_t;
+
+static const int s_technique_ids[] = { KBIO_TECHID_OCV, KBIO_TECHID_CA, KBIO_TECHID_CP, KBIO_TECHID_CV };
+
+/* technique 'kind' of the channel, of 'seconds', recording 'rate' points per second and the extra values 'xrec' */
+static int s_loadTechnique( const TEClibFunctions* eclib, int id, int ch, int kind, double seconds, double rate, int xrec ){
+    TEccParam_t p[24];
+    int n = 0;
+    const char* file = "ocv.ecc";
+    switch( kind ){
+    case 0:
+        eclib->BL_DefineSglParameter( "Rest_time_T", (float)seconds, 0, &p[n++] );
+        eclib->BL_DefineSglParameter( "Record_every_dE", 0.0f, 0, &p[n++] );
+        eclib->BL_DefineSglParameter( "Record_every_dT", (float)( 1.0 / rate ), 0, &p[n++] );
+        eclib->BL_DefineIntParameter( "E_Range", KBIO_ERANGE_10, 0, &p[n++] );
+        break;
+    case 1:
+    case 2:
+        file = ( kind == 1 ) ? "ca.ecc" : "cp.ecc";
+        for( int k = 0; k < 2; k++ ){
+            if( kind == 1 ) eclib->BL_DefineSglParameter( "Voltage_step", k ? 0.2f : 0.5f, k, &p[n++] );
+            else            eclib->BL_DefineSglParameter( "Current_step", k ? -1e-4f : 1e-4f, k, &p[n++] );
+            eclib->BL_DefineBoolParameter( "vs_initial", false, k, &p[n++] );
+            eclib->BL_DefineSglParameter( "Duration_step", (float)( seconds / 2 ), k, &p[n++] );
+        }
+        eclib->BL_DefineIntParameter( "Step_number", 1, 0, &p[n++] );
+        eclib->BL_DefineIntParameter( "N_Cycles", 0, 0, &p[n++] );
+        eclib->BL_DefineSglParameter( "Record_every_dT", (float)( 1.0 / rate ), 0, &p[n++] );
+        eclib->BL_DefineIntParameter( "I_Range", KBIO_IRANGE_10mA, 0, &p[n++] );
+        break;
+    case 3: {
+        /* 0 V to 0.8 V, to -0.2 V and back to 0 V: 2 V scanned */
+        static const float vertices[5] = { 0.0f, 0.8f, -0.2f, 0.0f, 0.0f };
+        double scan = 2.0 / seconds;   /* V/s */
+        file = "cv.ecc";
+        for( int k = 0; k < 5; k++ ){
+            eclib->BL_DefineSglParameter( "Voltage_step", vertices[k], k, &p[n++] );
+            eclib->BL_DefineSglParameter( "Scan_Rate", (float)( scan * 1e3 ), k, &p[n++] );
+        }
+        eclib->BL_DefineSglParameter( "Record_every_dE", (float)( scan / rate ), 0, &p[n++] );
+        eclib->BL_DefineIntParameter( "N_Cycles", 0, 0, &p[n++] );
+        eclib->BL_DefineIntParameter( "I_Range", KBIO_IRANGE_10mA, 0, &p[n++] );
+        break;
+    }
+    }
+    eclib->BL_DefineIntParameter( "xctr", xrec, 0, &p[n++] );
+    TEccParams_t params = { n, p };
+    return eclib->BL_LoadTechnique( id, (uint8)ch, file, params, true, true, false );
+}
+
+/* stores and exports the frames until the queue is closed and empty */
+static void s_consume( TFrameQueue_t* queue, CaptureWriter* capture, std::vector<std::unique_ptr<MprWriter> >* exports,
+                       LatencyHistogram* latency, int* errors ){
+    s_counting = true;
+    for( ;; ){
+        {
+            std::unique_lock<std::mutex> guard( queue->Lock );
+            queue->Changed.wait( guard, [&](){ return queue->Head != queue->Tail || queue->Closed; } );
+            if( queue->Head == queue->Tail ) break;
+        }
+        TSlot_t& slot = queue->Slots[queue->Head % QUEUE_SLOTS];
+        if( capture->isOpen() && capture->appendFrame( slot.Channel, slot.Frame ) != ERR_NOERROR ) (*errors)++;
+        MprWriter* mpr = (*exports)[slot.Channel].get();
+        if( mpr && mpr->appendFrame( slot.Frame ) != ERR_NOERROR ) (*errors)++;
+        latency->recordSeconds( s_elapsed( slot.Received ) );
+        {
+            std::lock_guard<std::mutex> guard( queue->Lock );
+            queue->Head++;
+        }
+        queue->Changed.notify_all();
+    }
+    s_counting = false;
+}
+
+static int s_run( const TEClibFunctions* eclib, int channels, double rate, int xrec, double seconds,
+                  const std::string& work, TRunResult_t* r ){
+    memset( r, 0, sizeof(*r) );
+    r->Channels = channels;
+    r->Rate     = rate;
+    for( int bit = 1; bit <= XREC_IRG; bit <<= 1 ) r->ExtraColumns += ( xrec & bit ) ? 1 : 0;
+
+    int devices = ( channels + 15 ) / 16;
+    TSimConfig_t config = SIM_DefaultConfig();
+    config.Channels   = ( channels < 16 ) ? channels : 16;
+    config.UsbDevices = devices;
+    config.Speed      = 0.0;
+    config.Step       = 0.0;
+    if( SIM_Configure( config ) != ERR_NOERROR ) return ERR_GEN_INVALIDPARAMETERS;
+
+    std::vector<int> ids( devices, -1 );
+    for( int dev = 0; dev < devices; dev++ ){
+        TDeviceInfos_t infos;
+        std::string address = "USB" + std::to_string( dev );
+        int status = eclib->BL_Connect( address.c_str(), 5, &ids[dev], &infos );
+        uint8 mask[16] = { 0 };
+        int results[16];
+        for( int ch = 0; ch < config.Channels && status == ERR_NOERROR; ch++ ){
+            int g = dev * 16 + ch;
+            status = s_loadTechnique( eclib, ids[dev], ch, g % 4, seconds, rate, xrec );
+            mask[ch] = 1;
+        }
+        if( status == ERR_NOERROR ) status = eclib->BL_StartChannels( ids[dev], mask, results, 16 );
+        if( status != ERR_NOERROR ) return status;
+    }
+
+    CaptureWriter capture;
+    std::vector<std::unique_ptr<MprWriter> > exports( channels );
+    if( !work.empty() ){
+        if( capture.open( ( work + "/acqbench.ecap" ).c_str() ) != ERR_NOERROR ) return ERR_GEN_FUNCTIONFAILED;
+        for( int g = 0; g < channels; g++ ){
+            std::vector<unsigned short> columns;
+            MPR_ColumnsForTechnique( s_technique_ids[g % 4], false, xrec, columns );
+            exports[g].reset( new MprWriter() );
+            std::string path = work + "/acqbench_" + std::to_string( g + 1 ) + ".mpr";
+            if( exports[g]->open( path.c_str(), &columns[0], columns.size() ) != ERR_NOERROR ) return ERR_GEN_FUNCTIONFAILED;
+        }
+    }
+
+    std::unique_ptr<TFrameQueue_t> queue( new TFrameQueue_t() );
+    queue->Slots.reset( new TSlot_t[QUEUE_SLOTS] );
+    queue->Head = queue->Tail = 0;
+    queue->Closed = false;
+    LatencyHistogram latency;
+    int consumer_errors = 0;
+    std::vector<char> running( channels, 1 );
+    TDataBuffer_t buf;
+    TDataInfos_t infos;
+    TCurrentValues_t curr;
+
+    s_allocs = 0;
+    clock_t cpu = clock();
+    Clock::time_point start = Clock::now();
+    std::thread consumer( s_consume, queue.get(), &capture, &exports, &latency, &consumer_errors );
+    s_counting = true;
+    int left = channels, polls = 0;
+    while( left > 0 && r->Errors == 0 && polls++ < (int)( 4 * seconds / POLL_PERIOD ) + 10 ){
+        SIM_Advance( POLL_PERIOD );
+        for( int g = 0; g < channels; g++ ){
+            if( !running[g] ) continue;
+            for( ;; ){
+                /* a free slot, decoded in place */
+                {
+                    std::unique_lock<std::mutex> guard( queue->Lock );
+                    queue->Changed.wait( guard, [&](){ return queue->Tail - queue->Head < QUEUE_SLOTS; } );
+                }
+                TSlot_t& slot = queue->Slots[queue->Tail % QUEUE_SLOTS];
+                s_counting = false;
+                Clock::time_point call = Clock::now();
+                int status = eclib->BL_GetData( ids[g / 16], (uint8)( g % 16 ), &buf, &infos, &curr );
+                slot.Received = Clock::now();
+                r->DeviceSeconds += std::chrono::duration<double>( slot.Received - call ).count();
+                s_counting = true;
+                if( status != ERR_NOERROR ){
+                    r->Errors++;
+                    break;
+                }
+                r->Skipped += infos.IRQskipped;
+                if( infos.NbRows == 0 ){
+                    if( curr.State == KBIO_STATE_STOP ){
+                        running[g] = 0;
+                        left--;
+                    }
+                    break;
+                }
+                if( BL_DecodeData( buf, infos, curr, false, xrec, 0, &slot.Frame ) != ERR_NOERROR ){
+                    r->Errors++;
+                    break;
+                }
+                slot.Channel = g;
+                r->Points += infos.NbRows;
+                r->Frames++;
+                {
+                    std::lock_guard<std::mutex> guard( queue->Lock );
+                    queue->Tail++;
+                }
+                queue->Changed.notify_all();
+            }
+        }
+    }
+    s_counting = false;
+    {
+        std::lock_guard<std::mutex> guard( queue->Lock );
+        queue->Closed = true;
+    }
+    queue->Changed.notify_all();
+    consumer.join();
+    r->Seconds    = s_elapsed( start );
+    r->CpuSeconds = (double)( clock() - cpu ) / CLOCKS_PER_SEC;
+    r->Allocs     = s_allocs;
+    r->Latency    = latency.summary();
+
+    if( capture.isOpen() && capture.close() != ERR_NOERROR ) r->Errors++;
+    for( int g = 0; g < channels; g++ ){
+        if( exports[g] && exports[g]->close() != ERR_NOERROR ) r->Errors++;
+    }
+    for( int dev = 0; dev < devices; dev++ ) eclib->BL_Disconnect( ids[dev] );
+
+    double expected = seconds * rate * channels;
+    if( left || r->Skipped || consumer_errors || (double)r->Points < expected * 0.999 || (double)r->Points > expected * 1.001 + channels ){
+        r->Errors++;
+    }
+    return ERR_NOERROR;
+}
+
+static int s_writeJson( const std::string& path, double seconds, bool files, const std::vector<TRunResult_t>& runs ){
+    FILE* f = fopen( path.c_str(), "w" );
+    if( !f ) return ERR_GEN_FILENOTEXISTS;
+    fprintf( f, "{\n  \"benchmark\": \"acqbench\",\n  \"seconds_per_run\": %g,\n  \"store_export\": %s,\n  \"runs\": [\n",
+             seconds, files ? "true" : "false" );
+    for( size_t i = 0; i < runs.size(); i++ ){
+        const TRunResult_t& r = runs[i];
+        double channel_seconds = r.Channels * seconds;
+        fprintf( f, "    { \"channels\": %d, \"rate\": %g, \"extra_columns\": %d, \"points\": %llu, \"frames\": %llu, "
+                    "\"wall_s\": %.6f, \"points_per_s\": %.0f, \"latency_p50_us\": %.2f, \"latency_p99_us\": %.2f, "
+                    "\"latency_max_us\": %.2f, \"cpu_us_per_channel_s\": %.2f, \"allocs_per_frame\": %.4f, "
+                    "\"skipped\": %llu, \"errors\": %d }%s\n",
+                 r.Channels, r.Rate, r.ExtraColumns, r.Points, r.Frames, r.Seconds, r.Points / r.Seconds,
+                 r.Latency.P50 * 1e-3, r.Latency.P99 * 1e-3, r.Latency.Max * 1e-3,
+                 ( r.CpuSeconds - r.DeviceSeconds ) / channel_seconds * 1e6, r.Frames ? (double)r.Allocs / r.Frames : 0.0,
+                 r.Skipped, r.Errors, ( i + 1 < runs.size() ) ? "," : "" );
+    }
+    fprintf( f, "  ]\n}\n" );
+    return ( fclose( f ) == 0 ) ? ERR_NOERROR : ERR_GEN_FUNCTIONFAILED;
+}
+
+int main( int argc, char** argv )
+{
+    std::string path = ( argc > 1 ) ? argv[1] : "acqbench.json";
+    double seconds   = ( argc > 2 ) ? atof( argv[2] ) : 5.0;
+    std::string work = ( argc > 3 ) ? argv[3] : "";
+    if( path.empty() || seconds <= 0.0 ){
+        printf( "usage: %s [results.json (default acqbench.json)] [seconds per run (default 5)] [work folder for the files, none by default]\n", argv[0] );
+        return 1;
+    }
+
+    static const int    channel_counts[] = { 1, 4, 16, 64 };
+    static const double rates[]          = { 100.0, 1000.0, 10000.0 };
+    static const int    xrecs[]          = { 0, XREC_CE | XREC_AUX1 | XREC_AUX2,
+                                             XREC_CE | XREC_AUX1 | XREC_AUX2 | XREC_CTL | XREC_Q | XREC_IRG };
+
+    TEClibFunctions eclib;
+    SIM_FillFunctionTable( &eclib );
+
+    std::vector<TRunResult_t> runs;
+    int errors = 0;
+    printf( "%8s %8s %5s %10s %10s %9s %9s %12s %12s\n", "channels", "rate", "extra", "points", "Mpoints/s",
+            "p50 us", "p99 us", "cpu us/ch.s", "allocs/frame" );
+    for( size_t c = 0; c < sizeof(channel_counts)/sizeof(channel_counts[0]); c++ ){
+        for( size_t k = 0; k < sizeof(rates)/sizeof(rates[0]); k++ ){
+            for( size_t x = 0; x < sizeof(xrecs)/sizeof(xrecs[0]); x++ ){
+                TRunResult_t r;
+                int status = s_run( &eclib, channel_counts[c], rates[k], xrecs[x], seconds, work, &r );
+                if( status != ERR_NOERROR ){
+                    printf( "Cannot run %d channels at %.0f points/s: error %d\n", channel_counts[c], rates[k], status );
+                    return 2;
+                }
+                printf( "%8d %8.0f %5d %10llu %10.2f %9.1f %9.1f %12.2f %12.3f%s\n", r.Channels, r.Rate, r.ExtraColumns,
+                        r.Points, r.Points / r.Seconds * 1e-6, r.Latency.P50 * 1e-3, r.Latency.P99 * 1e-3,
+                        ( r.CpuSeconds - r.DeviceSeconds ) / ( r.Channels * seconds ) * 1e6,
+                        r.Frames ? (double)r.Allocs / r.Frames : 0.0, r.Errors ? "  ERRORS" : "" );
+                errors += r.Errors;
+                runs.push_back( r );
+            }
+        }
+    }
+
+    int status = s_writeJson( path, seconds, !work.empty(), runs );
+    printf( "%zu runs written to %s (error %d)\n", runs.size(), path.c_str(), status );
+    if( status != ERR_NOERROR ) errors++;
+    return errors ? 4 : 0;
+}
@@ -0,0 +1,177 @@
+// acqcore.cpp : acquisition without window, through ECLib loaded at run time
+//
+// usage: acqcore [seconds] [capture file] [library]
+//
+// The library (the simulated instrument built with this folder by default, or
+// EClib.dll) is loaded with LDR_Load; four channels of a device run a CA, each
+// at its own rate, for 10 times 'seconds' of the simulation (the simulated clock
+// runs 10 times faster). An Acquisition drains them into a capture file until
+// the techniques end. The same run is then made with the simulated instrument
+// linked in the program (SIM_FillFunctionTable): both must give the points of
+// the techniques, as read back from the capture files.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string>
+
+#include "Acquisition.h"
+#include "CaptureFile.h"
+#include "DeviceSession.h"
+#include "ECLibLoader.h"
+#include "InstrumentSim.h"
+#include "ToolTechniques.h"
+
+#ifndef ECLIBSIM_LIBRARY
+#define ECLIBSIM_LIBRARY ""
+#endif
+
+#define NB_CHANNELS  (4)
+#define SPEED        (10)
+
+static const double s_rates[NB_CHANNELS] = { 100.0, 200.0, 500.0, 1000.0 };
+
+typedef struct {
+    TAcqStats_t        Stats;
+    unsigned long long Points[NB_CHANNELS];  /* read back from the capture file */
+    unsigned long long Skipped;
+    int                Failed;               /* channels which did not end normally */
+} TRun_t;
+
+static int s_store( void* user, int channel, const TDecodedFrame_t& frame, const TCurrentValues_t& ){
+    return static_cast<CaptureWriter*>( user )->appendFrame( channel, frame );
+}
+
+/* runs the techniques and drains them into 'path' */
+static int s_run( const TEClibFunctions* eclib, double seconds, const char* path, TRun_t* run ){
+    DeviceSession session( eclib );
+    TDeviceInfos_t dev;
+    int status = session.connect( "USB0", 5, &dev );
+    if( status != ERR_NOERROR ) return status;
+    for( int ch = 0; ch < NB_CHANNELS && status == ERR_NOERROR; ch++ ){
+        status = TOOL_LoadCA( eclib, session.id(), ch, seconds * SPEED, s_rates[ch] );
+    }
+    CaptureWriter capture;
+    if( status == ERR_NOERROR && capture.open( path ) != ERR_NOERROR ) status = ERR_GEN_FUNCTIONFAILED;
+    if( status != ERR_NOERROR ){
+        session.disconnect();
+        return status;
+    }
+
+    Acquisition acquisition( eclib, &session );
+    acquisition.setFrameFunction( s_store, &capture );
+    for( int ch = 0; ch < NB_CHANNELS && status == ERR_NOERROR; ch++ ){
+        status = eclib->BL_StartChannel( session.id(), (uint8)ch );
+        if( status == ERR_NOERROR ) status = acquisition.addChannel( (uint8)ch );
+    }
+    if( status == ERR_NOERROR ) status = acquisition.start();
+    if( status == ERR_NOERROR ){
+        while( !acquisition.wait( 1000 ) ){}
+        acquisition.stop();
+        run->Stats = acquisition.stats();
+        std::vector<TAcqChannelState_t> channels = acquisition.channels();
+        for( size_t i = 0; i < channels.size(); i++ ){
+            run->Skipped += channels[i].Skipped;
+            if( channels[i].State != ACQ_CHANNEL_DONE ) run->Failed++;
+        }
+    }
+    session.disconnect();
+    if( capture.close() != ERR_NOERROR && status == ERR_NOERROR ) status = ERR_GEN_FUNCTIONFAILED;
+    if( status != ERR_NOERROR ) return status;
+
+    CaptureReader reader;
+    status = reader.open( path );
+    if( status != ERR_NOERROR ) return status;
+    for( size_t i = 0; i < reader.chunkCount(); i++ ){
+        const TCapIndexEntry_t& chunk = reader.chunk( i );
+        if( chunk.Channel >= 0 && chunk.Channel < NB_CHANNELS ) run->Points[chunk.Channel] += chunk.NbRows;
+    }
+    return ERR_NOERROR;
+}
+
+static void s_setEnvironment( const char* name, const char* value ){
+#ifdef _WIN32
+    _putenv_s( name, value );
+#else
+    setenv( name, value, 1 );
+#endif
+}
+
+int main( int argc, char** argv )
+{
+    double      seconds = ( argc > 1 ) ? atof( argv[1] ) : 2.0;
+    const char* path    = ( argc > 2 ) ? argv[2] : "acqcore.ecap";
+    std::string library = ( argc > 3 ) ? argv[3] : ECLIBSIM_LIBRARY;
+    if( seconds < 0.5 || seconds > 3600.0 ){
+        printf( "usage: %s [seconds 0.5..3600 (default 2)] [capture file (default acqcore.ecap)] [library (default %s)]\n",
+                argv[0], ECLIBSIM_LIBRARY[0] ? ECLIBSIM_LIBRARY : "ECLIB_LIBRARY" );
+        return 1;
+    }
+    int errors = 0;
+
+    /* a library which is not there */
+    TEClibFunctions eclib;
+    std::string error;
+    int status = LDR_Load( "no_such_eclib_library", &eclib, &error );
+    printf( "missing library: %d (%s)\n", status, error.c_str() );
+    if( status != ERR_GEN_FILENOTEXISTS || eclib.hECLibDll || eclib.BL_Connect ) errors++;
+
+    /* the simulated instrument takes its configuration from the environment at its first call */
+    char speed[16];
+    snprintf( speed, sizeof(speed), "%d", SPEED );
+    s_setEnvironment( "ECLIBSIM_CHANNELS", "4" );
+    s_setEnvironment( "ECLIBSIM_SPEED", speed );
+    status = LDR_Load( library.empty() ? 0 : library.c_str(), &eclib, &error );
+    if( status != ERR_NOERROR ){
+        printf( "Cannot load the library: %d (%s)\n", status, error.c_str() );
+        return 2;
+    }
+    char version[64] = "";
+    unsigned int size = sizeof(version);
+    eclib.BL_GetLibVersion( version, &size );
+    printf( "loaded %s, version %s\n", library.empty() ? LDR_DefaultLibrary().c_str() : library.c_str(), version );
+
+    TSimConfig_t config = SIM_DefaultConfig();
+    config.Channels = NB_CHANNELS;
+    config.Speed    = SPEED;
+    TEClibFunctions linked;
+    if( SIM_Configure( config ) != ERR_NOERROR || SIM_FillFunctionTable( &linked ) != ERR_NOERROR ){
+        printf( "Cannot set up the simulated instrument\n" );
+        return 2;
+    }
+
+    std::string linked_path = std::string( path ) + ".linked";
+    const char* names[] = { "loaded", "linked" };
+    const TEClibFunctions* tables[] = { &eclib, &linked };
+    const char* paths[] = { path, linked_path.c_str() };
+    printf( "\n%-8s %8s %8s %8s %10s %10s %6s %6s", "table", "seconds", "polls", "frames", "points", "points/s", "waits", "peak" );
+    for( int ch = 0; ch < NB_CHANNELS; ch++ ) printf( "  ch%d/expected", ch + 1 );
+    printf( "\n" );
+    for( int k = 0; k < 2; k++ ){
+        TRun_t run = {};
+        status = s_run( tables[k], seconds, paths[k], &run );
+        if( status != ERR_NOERROR ){
+            printf( "Error %d during the acquisition through the %s table\n", status, names[k] );
+            LDR_Unload( &eclib );
+            return 2;
+        }
+        const TAcqStats_t& s = run.Stats;
+        printf( "%-8s %8.2f %8llu %8llu %10llu %10.0f %6llu %6u", names[k], s.Seconds, s.Polls, s.Frames, s.Points,
+                s.Seconds > 0.0 ? s.Points / s.Seconds : 0.0, s.Waits, s.QueuePeak );
+        unsigned long long stored = 0;
+        for( int ch = 0; ch < NB_CHANNELS; ch++ ){
+            double expected = seconds * SPEED * s_rates[ch];
+            printf( "  %6llu/%-6.0f", run.Points[ch], expected );
+            if( fabs( (double)run.Points[ch] - expected ) > 1.0 + 1e-3 * expected ) errors++;
+            stored += run.Points[ch];
+        }
+        printf( "\n" );
+        if( stored != s.Points || s.StoreErrors || run.Skipped || run.Failed ) errors++;
+    }
+
+    LDR_Unload( &eclib );
+    if( eclib.hECLibDll || eclib.BL_GetData ) errors++;
+    printf( "%s\n", errors ? "ERRORS" : "OK" );
+    return errors ? 4 : 0;
+}
@@ -0,0 +1,113 @@
+// acqd.cpp : headless acquisition daemon
+//
+// usage: acqd <job file>
+//        acqd <status|channels|rotate|stop|quit> [control port]
+//
+// Runs the job (see JobFile.h) with an AcqDaemon: the library given by the job
+// (or ECLIB_LIBRARY, or the EClib of the system) is loaded with LDR_Load, the
+// channels are started and drained into the capture files until their
+// techniques end. Ctrl+C ends the acquisition, the techniques keep running on
+// the instrument. While it runs, "acqd status" (channels, ...) sends the command
+// to the control port with DMN_Command, as any local program may do.
+//
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "AcqDaemon.h"
+#include "ECLibLoader.h"
+#include "JobFile.h"
+
+static volatile sig_atomic_t s_interrupted = 0;
+
+static void s_onSignal( int ){
+    s_interrupted = 1;
+}
+
+static bool s_isCommand( const char* text ){
+    static const char* commands[] = { "status", "channels", "rotate", "stop", "quit" };
+    for( size_t i = 0; i < sizeof(commands)/sizeof(commands[0]); i++ ){
+        if( strcmp( text, commands[i] ) == 0 ) return true;
+    }
+    return false;
+}
+
+int main( int argc, char** argv )
+{
+    if( argc < 2 ){
+        printf( "usage: %s <job file>\n"
+                "       %s <status|channels|rotate|stop|quit> [control port (default %d)]\n", argv[0], argv[0], JOB_CONTROL_PORT );
+        return 1;
+    }
+
+    /* a command to a daemon running */
+    if( s_isCommand( argv[1] ) ){
+        int port = ( argc > 2 ) ? atoi( argv[2] ) : JOB_CONTROL_PORT;
+        std::string answer;
+        int status = DMN_Command( port, argv[1], &answer );
+        if( status == ERR_GEN_NOTCONNECTED ){
+            printf( "no daemon on the port %d\n", port );
+            return 2;
+        }
+        printf( "%s", answer.c_str() );
+        return status == ERR_NOERROR ? 0 : 4;
+    }
+
+    JobFile file;
+    int status = file.open( argv[1] );
+    if( status != ERR_NOERROR ){
+        printf( "%s: %s (error %d)\n", argv[1], file.errorMessage(), status );
+        return 1;
+    }
+    const TAcqJob_t& job = file.job();
+
+    TEClibFunctions eclib;
+    std::string error;
+    status = LDR_Load( job.Library.empty() ? 0 : job.Library.c_str(), &eclib, &error );
+    if( status != ERR_NOERROR ){
+        printf( "Cannot load the library: %d (%s)\n", status, error.c_str() );
+        return 2;
+    }
+
+    int exit_code = 0;
+    {
+        AcqDaemon daemon( &eclib );
+        status = daemon.start( job, &error );
+        if( status != ERR_NOERROR ){
+            printf( "Cannot start the job: %d (%s)\n", status, error.c_str() );
+            exit_code = 2;
+        } else {
+            printf( "%zu channel(s) of %s, %zu technique(s), into %s", job.Channels.size(), job.Device.c_str(), job.Chain.size(),
+                    daemon.status().Capture.c_str() );
+            if( daemon.port() > 0 ) printf( ", control port %d", daemon.port() );
+            printf( "\n" );
+            fflush( stdout );
+
+            signal( SIGINT, s_onSignal );
+            signal( SIGTERM, s_onSignal );
+#ifdef SIGPIPE
+            signal( SIGPIPE, SIG_IGN );
+#endif
+            while( !daemon.wait( 500 ) ){
+                if( s_interrupted ){
+                    daemon.stop( false );
+                    s_interrupted = 0;
+                }
+            }
+
+            TDaemonStatus_t s = daemon.status();
+            printf( "%.1f s: %llu point(s) in %llu frame(s), %u capture file(s) of %lld bytes in all, %d channel(s) done, %d failed\n",
+                    s.Seconds, s.Points, s.Frames, s.Captures, s.CaptureBytes, s.Done, s.Failed );
+            if( s.Failed || s.StoreErrors || s.Skipped ){
+                printf( "%d channel(s) failed, %llu frame(s) not stored, %llu point(s) dropped by the instrument\n",
+                        s.Failed, s.StoreErrors, s.Skipped );
+                exit_code = 4;
+            }
+        }
+    }
+    LDR_Unload( &eclib );
+    return exit_code;
+}
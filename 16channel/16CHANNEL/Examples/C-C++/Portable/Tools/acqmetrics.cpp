@@ -0,0 +1,289 @@
+// acqmetrics.cpp : metrics of an acquisition, served over HTTP and written to a file
+//
+// usage: acqmetrics [seconds] [port] [file]
+//
+// Measures the cost of a recorded poll, then acquires from four simulated
+// channels on two poll threads. Each frame read goes through a small queue to a
+// slow storage thread, which drops the frames it has no room for; each poll
+// thread also asks for the data of an unplugged channel now and then. The
+// metrics are served at http://127.0.0.1:port/metrics (any free port with 0)
+// and written to the file; they are read back during the acquisition and after
+// it, and must give the points, the errors, the frames dropped and the polls
+// the threads counted themselves.
+//
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "InstrumentSim.h"
+#include "Metrics.h"
+#include "ToolTechniques.h"
+
+typedef std::chrono::steady_clock Clock;
+
+#ifdef _WIN32
+typedef SOCKET TSocket_t;
+#else
+typedef int TSocket_t;
+#define closesocket close
+#endif
+
+#define NB_CHANNELS  (4)
+#define UNPLUGGED    (5)       /* channel asked for now and then */
+#define POLL_MS      (10)
+#define QUEUE_SIZE   (8)       /* frames waiting for the storage */
+#define STORE_MS     (4)       /* time to store a frame */
+#define OVERHEAD_N   (1000000)
+
+static const double s_rates[NB_CHANNELS] = { 1000.0, 5000.0, 10000.0, 20000.0 };
+
+static TEClibFunctions   s_eclib;
+static int               s_id = -1;
+static AcqMetrics        s_metrics( "0" );
+static std::atomic<bool> s_acquiring( true );
+static std::mutex        s_queue_lock;
+static std::deque<int>   s_queue;
+
+/* what the threads counted themselves */
+static std::atomic<unsigned long long> s_points[NB_CHANNELS];
+static std::atomic<unsigned long long> s_polls[NB_CHANNELS];
+static std::atomic<unsigned long long> s_dropped[NB_CHANNELS];
+static std::atomic<unsigned long long> s_unplugged( 0 );
+
+static void s_poll( int first, const char* name ){
+    s_metrics.registerThread( name );
+    TDataBuffer_t buf;
+    TDataInfos_t infos;
+    TCurrentValues_t curr;
+    int round = 0;
+    while( s_acquiring ){
+        for( int ch = first; ch < first + 2; ch++ ){
+            Clock::time_point start = Clock::now();
+            int status = s_eclib.BL_GetData( s_id, (uint8)ch, &buf, &infos, &curr );
+            long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>( Clock::now() - start ).count();
+            if( status != ERR_NOERROR ){
+                s_metrics.recordError( ch, status );
+                continue;
+            }
+            s_metrics.recordPoll( (uint8)ch, ns, infos, curr );
+            s_polls[ch]++;
+            s_points[ch] += infos.NbRows;
+            if( infos.NbRows <= 0 ) continue;
+
+            /* to the storage, if it has room */
+            std::lock_guard<std::mutex> guard( s_queue_lock );
+            if( s_queue.size() < QUEUE_SIZE ){
+                s_queue.push_back( ch );
+            } else {
+                s_metrics.recordDropped( (uint8)ch, 1 );
+                s_dropped[ch]++;
+            }
+        }
+        if( ++round % 10 == 0 ){
+            int status = s_eclib.BL_GetData( s_id, UNPLUGGED, &buf, &infos, &curr );
+            s_metrics.recordError( UNPLUGGED, status );
+            if( status == ERR_GEN_CHANNELNOTPLUGGED ) s_unplugged++;
+        }
+        std::this_thread::sleep_for( std::chrono::milliseconds( POLL_MS ) );
+    }
+    s_metrics.unregisterThread();
+}
+
+static void s_store(){
+    s_metrics.registerThread( "storage" );
+    for( ;; ){
+        bool empty;
+        {
+            std::lock_guard<std::mutex> guard( s_queue_lock );
+            empty = s_queue.empty();
+            if( !empty ) s_queue.pop_front();
+        }
+        if( empty && !s_acquiring ) break;
+        /* busy while storing: the thread shows some CPU */
+        Clock::time_point until = Clock::now() + std::chrono::milliseconds( empty ? 1 : STORE_MS );
+        if( empty ) std::this_thread::sleep_until( until );
+        else while( Clock::now() < until ){}
+    }
+    s_metrics.unregisterThread();
+}
+
+/* GET of a path on the local endpoint: the status line and the body */
+static bool s_get( int port, const char* path, std::string* status, std::string* body ){
+    TSocket_t s = socket( AF_INET, SOCK_STREAM, 0 );
+    struct sockaddr_in addr;
+    memset( &addr, 0, sizeof(addr) );
+    addr.sin_family = AF_INET;
+    addr.sin_port   = htons( (unsigned short)port );
+    inet_pton( AF_INET, "127.0.0.1", &addr.sin_addr );
+    if( connect( s, (struct sockaddr*)&addr, sizeof(addr) ) != 0 ){
+        closesocket( s );
+        return false;
+    }
+    std::string request = std::string( "GET " ) + path + " HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+    send( s, request.data(), (int)request.size(), 0 );
+    std::string response;
+    char chunk[4096];
+    int n;
+    while( ( n = (int)recv( s, chunk, sizeof(chunk), 0 ) ) > 0 ) response.append( chunk, n );
+    closesocket( s );
+    size_t line = response.find( "\r\n" ), head = response.find( "\r\n\r\n" );
+    if( line == std::string::npos || head == std::string::npos ) return false;
+    *status = response.substr( 0, line );
+    *body   = response.substr( head + 4 );
+    return true;
+}
+
+/* value of a sample, -1 if it is not in the text */
+static double s_value( const std::string& text, const std::string& sample ){
+    size_t at = text.find( "\n" + sample + " " );
+    if( at == std::string::npos ) return -1.0;
+    return atof( text.c_str() + at + 1 + sample.size() + 1 );
+}
+
+static std::string s_channel( const char* name, int ch ){
+    return std::string( name ) + "{device=\"0\",channel=\"" + std::to_string( ch + 1 ) + "\"}";
+}
+
+int main( int argc, char** argv )
+{
+    double seconds  = ( argc > 1 ) ? atof( argv[1] ) : 3.0;
+    int         port = ( argc > 2 ) ? atoi( argv[2] ) : 0;
+    const char* file = ( argc > 3 ) ? argv[3] : "acqmetrics.prom";
+    if( seconds < 1.0 || seconds > 600.0 || port < 0 || port > 65535 ){
+        printf( "usage: %s [seconds 1..600 (default 3)] [port, 0 for any (default 0)] [file (default acqmetrics.prom)]\n", argv[0] );
+        return 1;
+    }
+
+    /* the cost of a poll recorded, on a channel of its own */
+    {
+        AcqMetrics metrics;
+        TDataInfos_t infos;
+        TCurrentValues_t curr;
+        memset( &infos, 0, sizeof(infos) );
+        memset( &curr, 0, sizeof(curr) );
+        infos.NbRows = 10;
+        infos.NbCols = 5;
+        Clock::time_point start = Clock::now();
+        for( int i = 0; i < OVERHEAD_N; i++ ){
+            curr.MemFilled = i;
+            metrics.recordPoll( (uint8)( i & 15 ), 20000 + ( i & 4095 ), infos, curr );
+        }
+        double ns = std::chrono::duration<double, std::nano>( Clock::now() - start ).count() / OVERHEAD_N;
+        printf( "recordPoll: %.1f ns per call\n", ns );
+    }
+
+    TSimConfig_t config = SIM_DefaultConfig();
+    config.Channels = NB_CHANNELS;
+    TDeviceInfos_t dev;
+    if( SIM_Configure( config ) != ERR_NOERROR || SIM_FillFunctionTable( &s_eclib ) != ERR_NOERROR ||
+        s_eclib.BL_Connect( "USB0", 5, &s_id, &dev ) != ERR_NOERROR ){
+        printf( "Cannot connect to the simulated device\n" );
+        return 2;
+    }
+    for( int ch = 0; ch < NB_CHANNELS; ch++ ){
+        TChannelInfos_t infos;
+        int status = TOOL_LoadCA( &s_eclib, s_id, ch, seconds + 10.0, s_rates[ch] );
+        if( status == ERR_NOERROR ) status = s_eclib.BL_GetChannelInfos( s_id, (uint8)ch, &infos );
+        if( status == ERR_NOERROR ) status = s_eclib.BL_StartChannel( s_id, (uint8)ch );
+        if( status != ERR_NOERROR ){
+            printf( "Error %d on channel %d\n", status, ch + 1 );
+            return 2;
+        }
+        s_metrics.setMemSize( (uint8)ch, infos.MemSize );
+    }
+
+    MetricsExporter exporter;
+    TMetricsExportConfig_t publish = MET_DefaultExportConfig();
+    publish.Port     = port;
+    publish.Path     = file;
+    publish.PeriodMs = 500;
+    exporter.add( &s_metrics );
+    if( exporter.start( publish ) != ERR_NOERROR ){
+        printf( "Cannot serve the metrics on port %d\n", port );
+        return 2;
+    }
+    printf( "metrics at http://127.0.0.1:%d/metrics and in %s\n", exporter.port(), file );
+
+    std::thread storage( s_store );
+    std::thread poll1( s_poll, 0, "poll1" );
+    std::thread poll2( s_poll, 2, "poll2" );
+
+    /* read while the acquisition goes on */
+    int errors = 0;
+    std::string status, body;
+    std::this_thread::sleep_for( std::chrono::duration<double>( seconds / 2 ) );
+    if( !s_get( exporter.port(), "/metrics", &status, &body ) || status.find( " 200 " ) == std::string::npos ){
+        printf( "no answer on /metrics\n" );
+        errors++;
+    }
+    printf( "%-8s %12s %12s\n", "channel", "points/s", "expected" );
+    for( int ch = 0; ch < NB_CHANNELS; ch++ ){
+        double rate = s_value( body, s_channel( "eclib_points_per_second", ch ) );
+        printf( "%-8d %12.0f %12.0f\n", ch + 1, rate, s_rates[ch] );
+        if( rate < 0.8 * s_rates[ch] || rate > 1.2 * s_rates[ch] ) errors++;
+    }
+    std::this_thread::sleep_for( std::chrono::duration<double>( seconds / 2 ) );
+
+    s_acquiring = false;
+    poll1.join();
+    poll2.join();
+    storage.join();
+
+    /* after it: the counts of the threads, served and written */
+    if( !s_get( exporter.port(), "/metrics", &status, &body ) ) errors++;
+    std::string other_status, other_body;
+    if( !s_get( exporter.port(), "/other", &other_status, &other_body ) || other_status.find( " 404 " ) == std::string::npos ) errors++;
+    exporter.stop();
+    std::string written;
+    FILE* f = fopen( file, "rb" );
+    if( f ){
+        char chunk[4096];
+        size_t n;
+        while( ( n = fread( chunk, 1, sizeof(chunk), f ) ) > 0 ) written.append( chunk, n );
+        fclose( f );
+    }
+
+    printf( "\n%-8s %12s %12s %12s %12s %12s\n", "channel", "points", "served", "polls", "dropped", "fill" );
+    for( int ch = 0; ch < NB_CHANNELS; ch++ ){
+        double points  = s_value( body, s_channel( "eclib_points_total", ch ) );
+        double polls   = s_value( body, s_channel( "eclib_poll_latency_seconds_count", ch ) );
+        double dropped = s_value( body, s_channel( "eclib_frames_dropped_total", ch ) );
+        double fill    = s_value( body, s_channel( "eclib_memory_fill_ratio", ch ) );
+        printf( "%-8d %12llu %12.0f %12.0f %12.0f %12.6f\n", ch + 1, (unsigned long long)s_points[ch], points, polls, dropped, fill );
+        if( points != (double)s_points[ch] || polls != (double)s_polls[ch] || dropped != (double)s_dropped[ch] || fill < 0.0 ) errors++;
+        if( s_value( written, s_channel( "eclib_points_total", ch ) ) != points ) errors++;
+    }
+    std::string unplugged = "eclib_errors_total{device=\"0\",channel=\"" + std::to_string( UNPLUGGED + 1 ) + "\",code=\"-3\",name=\"ERR_GEN_CHANNELNOTPLUGGED\"}";
+    double unplugged_errors = s_value( body, unplugged );
+    printf( "%.0f errors ERR_GEN_CHANNELNOTPLUGGED (%llu asked)\n", unplugged_errors, (unsigned long long)s_unplugged );
+    if( unplugged_errors != (double)s_unplugged || s_unplugged == 0 ) errors++;
+    const char* threads[] = { "poll1", "poll2", "storage" };
+    for( int t = 0; t < 3; t++ ){
+        double cpu = s_value( body, std::string( "eclib_thread_cpu_seconds_total{device=\"0\",thread=\"" ) + threads[t] + "\"}" );
+        printf( "thread %-8s %.3f s CPU\n", threads[t], cpu );
+        if( cpu <= 0.0 ) errors++;
+    }
+    printf( "%llu requests answered, %llu files written (%d bytes)\n", exporter.requests(), exporter.writes(), (int)written.size() );
+    if( exporter.writes() < 2 ) errors++;
+
+    s_eclib.BL_Disconnect( s_id );
+    printf( "%s\n", errors ? "ERRORS" : "OK" );
+    return errors ? 4 : 0;
+}
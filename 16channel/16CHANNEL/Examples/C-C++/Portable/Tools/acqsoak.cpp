@@ -0,0 +1,215 @@
+// acqsoak.cpp : long run of the acquisition daemon on the simulated instrument
+//
+// usage: acqsoak [days] [speed] [channels] [capture file]
+//
+// An AcqDaemon runs a job on the simulated instrument linked in the program,
+// whose clock runs 'speed' times faster than the real one (10000: a simulated
+// week in about one minute). Each channel loops for ever over a CA and a CP
+// recording a point per second, into capture files rotated every 16 MB. The
+// status is read through the control socket every simulated hour; the capture
+// files closed are read back, counted and removed. After 'days' simulated days
+// the techniques are stopped with the "stop" command.
+//
+// The program checks that the points of each day arrive at the rate of the
+// techniques, that the memory of the process and the CPU time per point do not
+// grow with the days, that no point is dropped, and that the capture files hold
+// every point given by the daemon.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AcqDaemon.h"
+#include "CaptureFile.h"
+#include "InstrumentSim.h"
+#include "JobFile.h"
+
+#define ROTATE_MB       (16)
+#define SAMPLE_SECONDS  (3600.0)   /* simulated */
+#define DAY_SECONDS     (86400.0)
+
+typedef struct {
+    double             Rate;       /* points per simulated second */
+    double             MemoryMB;   /* at the end of the day */
+    double             CpuUs;      /* CPU time per point */
+    unsigned int       Captures;
+} TDay_t;
+
+/* counts the points of the capture files 'from'..'to' (closed), and removes them */
+static int s_countCaptures( const std::string& capture, unsigned int from, unsigned int to, unsigned long long* points ){
+    for( unsigned int n = from; n <= to; n++ ){
+        std::string path = JOB_CaptureName( capture, n );
+        CaptureReader reader;
+        int status = reader.open( path.c_str() );
+        if( status != ERR_NOERROR ){
+            printf( "Cannot read %s: error %d\n", path.c_str(), status );
+            return status;
+        }
+        for( size_t i = 0; i < reader.chunkCount(); i++ ) *points += reader.chunk( i ).NbRows;
+        reader.close();
+        remove( path.c_str() );
+    }
+    return ERR_NOERROR;
+}
+
+static double s_median( std::vector<double> values ){
+    if( values.empty() ) return 0.0;
+    std::sort( values.begin(), values.end() );
+    return values[values.size() / 2];
+}
+
+int main( int argc, char** argv )
+{
+    double      days     = ( argc > 1 ) ? atof( argv[1] ) : 7.0;
+    double      speed    = ( argc > 2 ) ? atof( argv[2] ) : 10000.0;
+    int         channels = ( argc > 3 ) ? atoi( argv[3] ) : 16;
+    std::string capture  = ( argc > 4 ) ? argv[4] : "acqsoak.ecap";
+    if( days < 0.1 || days > 365.0 || speed < 1.0 || speed > 100000.0 || channels < 1 || channels > 16 ){
+        printf( "usage: %s [days 0.1..365 (default 7)] [speed 1..100000 (default 10000)] [channels 1..16 (default 16)] [capture file (default acqsoak.ecap)]\n", argv[0] );
+        return 1;
+    }
+    int errors = 0;
+
+    TSimConfig_t config = SIM_DefaultConfig();
+    config.Channels = channels;
+    config.Speed    = speed;
+    TEClibFunctions eclib;
+    if( SIM_Configure( config ) != ERR_NOERROR || SIM_FillFunctionTable( &eclib ) != ERR_NOERROR ){
+        printf( "Cannot set up the simulated instrument\n" );
+        return 2;
+    }
+
+    /* the job, its techniques inline */
+    char job_text[2048];
+    snprintf( job_text, sizeof(job_text),
+        "device    USB0\n"
+        "channels  1-%d\n"
+        "capture   %s\n"
+        "rotate    %d\n"
+        "control   0\n"
+        "sequence\n"
+        "label     cycle\n"
+        "ca        Voltage_step[0]=0.5 vs_initial[0]=false Duration_step[0]=3000 Voltage_step[1]=0 vs_initial[1]=false Duration_step[1]=600 "
+                  "Step_number=1 N_Cycles=0 Record_every_dI=1 Record_every_dT=1 I_Range=12 E_Range=3 Bandwidth=5 xctr=0\n"
+        "cp        Current_step[0]=0.001 vs_initial[0]=false Duration_step[0]=3600 Step_number=0 N_Cycles=0 "
+                  "Record_every_dE=10 Record_every_dT=1 I_Range=8 E_Range=3 Bandwidth=5 xctr=0\n"
+        "loop      cycle forever\n",
+        channels, capture.c_str(), ROTATE_MB );
+    JobFile file;
+    int status = file.parse( job_text, strlen( job_text ) );
+    if( status != ERR_NOERROR ){
+        printf( "job: %s (error %d)\n", file.errorMessage(), status );
+        return 2;
+    }
+
+    AcqDaemon daemon( &eclib );
+    std::string error;
+    status = daemon.start( file.job(), &error );
+    if( status != ERR_NOERROR ){
+        printf( "Cannot start the daemon: %d (%s)\n", status, error.c_str() );
+        return 2;
+    }
+    int port = daemon.port();
+    double origin = SIM_Now();
+    printf( "%d channel(s), a point per second each, %.0f simulated day(s) at %.0f times the real time, control port %d\n\n",
+            channels, days, speed, port );
+    printf( "%4s %12s %12s %10s %10s %9s\n", "day", "points", "points/s", "memory MB", "CPU us/pt", "captures" );
+
+    /* the status through the control socket, every simulated hour */
+    std::vector<TDay_t> list;
+    unsigned long long counted = 0, day_points = 0;
+    unsigned int verified = 0;
+    double day_start = origin, day_cpu = 0.0, first_memory = -1.0;
+    std::string answer;
+    for( ;; ){
+        double next = SIM_Now() + SAMPLE_SECONDS;
+        while( SIM_Now() < next ) std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+        status = DMN_Command( port, "status", &answer );
+        if( status != ERR_NOERROR ){
+            printf( "status: error %d\n%s", status, answer.c_str() );
+            errors++;
+            break;
+        }
+        double now      = SIM_Now();
+        double points   = DMN_StatusValue( answer, "points" );
+        double cpu      = DMN_StatusValue( answer, "cpu_seconds" );
+        double memory   = DMN_StatusValue( answer, "memory_bytes" ) / ( 1024.0 * 1024.0 );
+        unsigned int captures = (unsigned int)DMN_StatusValue( answer, "captures" );
+        if( DMN_StatusValue( answer, "channels_running" ) != channels ){
+            printf( "%s", answer.c_str() );
+            errors++;
+            break;
+        }
+        if( captures > verified + 1 ){
+            if( s_countCaptures( capture, verified + 1, captures - 1, &counted ) != ERR_NOERROR ) errors++;
+            verified = captures - 1;
+        }
+
+        if( now - day_start >= DAY_SECONDS || now - origin >= days * DAY_SECONDS ){
+            TDay_t day;
+            day.Rate     = ( points - day_points ) / ( now - day_start );
+            day.MemoryMB = memory;
+            day.CpuUs    = ( points > day_points ) ? ( cpu - day_cpu ) / ( points - day_points ) * 1e6 : 0.0;
+            day.Captures = captures;
+            list.push_back( day );
+            printf( "%4zu %12.0f %12.2f %10.1f %10.3f %9u\n", list.size(), points, day.Rate, day.MemoryMB, day.CpuUs, day.Captures );
+            fflush( stdout );
+            if( first_memory < 0.0 ) first_memory = memory;
+            day_start  = now;
+            day_points = (unsigned long long)points;
+            day_cpu    = cpu;
+        }
+        if( now - origin >= days * DAY_SECONDS ) break;
+    }
+
+    /* the end: the techniques are stopped, the channels drained */
+    double stopped = SIM_Now();
+    if( DMN_Command( port, "stop", &answer ) != ERR_NOERROR ){
+        printf( "stop: %s", answer.c_str() );
+        errors++;
+        daemon.stop( false );
+    }
+    while( !daemon.wait( 1000 ) ){}
+    TDaemonStatus_t s = daemon.status();
+    if( s_countCaptures( capture, verified + 1, s.Captures, &counted ) != ERR_NOERROR ) errors++;
+
+    double expected = channels * ( stopped - origin );
+    printf( "\n%llu point(s) stored (%.0f expected), %llu read back from %u capture file(s) of %.1f MB in all\n",
+            s.Points, expected, counted, s.Captures, s.CaptureBytes / ( 1024.0 * 1024.0 ) );
+    printf( "%llu frame(s), %llu poll(s), %llu wait(s) for the storage, %llu point(s) dropped, %llu store error(s), %llu command(s)\n",
+            s.Frames, s.Polls, s.Waits, s.Skipped, s.StoreErrors, s.Commands );
+    if( s.State != DMN_DONE || s.Done != channels || s.Failed ) errors++;
+    if( s.Skipped || s.StoreErrors || counted != s.Points ) errors++;
+    if( fabs( (double)s.Points - expected ) > 0.01 * expected ) errors++;
+
+    /* flat: the rate of each day (the points lag the clock by a poll), the memory and the CPU time per point after the first day */
+    std::vector<double> cpu;
+    for( size_t d = 0; d < list.size(); d++ ){
+        if( fabs( list[d].Rate - channels ) > 0.05 * channels ){
+            printf( "day %zu: %.2f points/s instead of %d\n", d + 1, list[d].Rate, channels );
+            errors++;
+        }
+        if( list[d].MemoryMB - first_memory > 16.0 ){
+            printf( "day %zu: the memory grew by %.1f MB since the first day\n", d + 1, list[d].MemoryMB - first_memory );
+            errors++;
+        }
+        if( d > 0 ) cpu.push_back( list[d].CpuUs );
+    }
+    double median = s_median( cpu );
+    for( size_t d = 0; d < cpu.size(); d++ ){
+        if( cpu[d] > 2.0 * median + 1.0 ){
+            printf( "day %zu: %.3f us of CPU per point, %.3f for the median day\n", d + 2, cpu[d], median );
+            errors++;
+        }
+    }
+
+    printf( "%s\n", errors ? "ERRORS" : "OK" );
+    return errors ? 4 : 0;
+}
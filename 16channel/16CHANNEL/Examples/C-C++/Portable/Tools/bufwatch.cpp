@@ -0,0 +1,167 @@
+// bufwatch.cpp : pressure on the memory of the channels and polls by priority
+//
+// usage: bufwatch [seconds] [memory kB per channel]
+//
+// Four channels of a simulated device record at 100, 1000, 5000 and 20000
+// points/s in a small memory. The computer can poll one channel per ms. They are
+// drained twice: every 200 ms each, then in the order given by a BufferPressure,
+// which shortens the period of the channels whose memory fills fast. The points
+// dropped (IRQskipped) are logged with their context; with the priorities there
+// must be few, and every point must be either read or counted as dropped. The
+// clock of the simulation only moves between the polls: the runs give the same
+// results every time.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+
+#include "BufferPressure.h"
+#include "InstrumentSim.h"
+#include "ToolTechniques.h"
+
+#define NB_CHANNELS  (4)
+#define TICK         (0.001)   /* s of the simulation between two polls */
+#define FIXED_MS     (200)
+#define ROW_BYTES    (5 * 4)   /* a point of CA */
+
+static const double s_rates[NB_CHANNELS] = { 100.0, 1000.0, 5000.0, 20000.0 };
+static const char*  s_priorities[]       = { "normal", "high", "urgent" };
+
+typedef struct {
+    unsigned long long Points[NB_CHANNELS];
+    unsigned long long Skipped[NB_CHANNELS];
+    int                Priority[NB_CHANNELS];   /* at the middle of the run */
+    double             Rate[NB_CHANNELS];       /* estimated, bytes/s */
+    int                Polls;
+} TRun_t;
+
+static void s_logSkip( void* user, const TBufferSkipEvent_t& e ){
+    if( !user ) return;
+    printf( "    t %6.3f s  channel %d: %5d points dropped, memory %6d/%d bytes, %8.0f bytes/s, %5.0f ms since the poll (period %u ms, %s)\n",
+            e.Time, e.Channel + 1, e.IRQskipped, e.MemFilled, e.MemSize, e.FillRate, e.SincePoll * 1e3, e.PollMs, s_priorities[e.Priority] );
+}
+
+/* drains all the channels until they stop: at a fixed period, or by priority */
+static int s_run( const TEClibFunctions* eclib, const TSimConfig_t& config, double seconds, bool adaptive, TRun_t* run ){
+    int id = -1;
+    TDeviceInfos_t dev;
+    SIM_Configure( config );
+    if( eclib->BL_Connect( "USB0", 5, &id, &dev ) != ERR_NOERROR ) return ERR_COMM_CONNECTIONFAILED;
+    BufferPressure pressure;
+    pressure.setSkipFunction( s_logSkip, adaptive ? (void*)run : 0 );
+    for( int ch = 0; ch < NB_CHANNELS; ch++ ){
+        TChannelInfos_t infos;
+        int status = TOOL_LoadCA( eclib, id, ch, seconds, s_rates[ch] );
+        if( status == ERR_NOERROR ) status = eclib->BL_GetChannelInfos( id, (uint8)ch, &infos );
+        if( status == ERR_NOERROR ) status = pressure.track( infos );
+        if( status == ERR_NOERROR ) status = eclib->BL_StartChannel( id, (uint8)ch );
+        if( status != ERR_NOERROR ) return status;
+    }
+
+    TDataBuffer_t buf;
+    TDataInfos_t infos;
+    TCurrentValues_t curr;
+    double last[NB_CHANNELS] = { 0 };
+    bool running[NB_CHANNELS];
+    for( int ch = 0; ch < NB_CHANNELS; ch++ ) running[ch] = true;
+    int left = NB_CHANNELS;
+    bool middle = false;
+    for( int tick = 0; left > 0 && tick < (int)( 2 * seconds / TICK ); tick++ ){
+        SIM_Advance( TICK );
+        double now = SIM_Now();
+
+        /* one channel per tick: the first one due */
+        int ch = -1;
+        if( adaptive ){
+            double wait = 0.0;
+            ch = pressure.next( now, &wait );
+            if( wait > 0.0 ) ch = -1;
+        } else {
+            for( int k = 0; k < NB_CHANNELS && ch < 0; k++ ) if( running[k] && now - last[k] >= FIXED_MS * 1e-3 - 1e-9 ) ch = k;
+        }
+        if( ch < 0 || !running[ch] ) continue;
+        last[ch] = now;
+        run->Polls++;
+        do {
+            int status = eclib->BL_GetData( id, (uint8)ch, &buf, &infos, &curr );
+            if( status != ERR_NOERROR ) return status;
+            pressure.update( (uint8)ch, infos, curr, now );
+            run->Points[ch]  += infos.NbRows;
+            run->Skipped[ch] += infos.IRQskipped;
+        } while( infos.NbRows > 0 );
+        if( curr.State == KBIO_STATE_STOP ){
+            pressure.untrack( (uint8)ch );
+            running[ch] = false;
+            left--;
+        }
+
+        if( !middle && now >= seconds / 2 ){
+            std::vector<TBufferChannelState_t> states = pressure.channels();
+            for( size_t k = 0; k < states.size(); k++ ){
+                run->Priority[states[k].Channel] = states[k].Priority;
+                run->Rate[states[k].Channel]     = states[k].FillRate;
+            }
+            middle = true;
+        }
+    }
+    if( adaptive ){
+        std::vector<TBufferSkipEvent_t> log = pressure.skipLog();
+        printf( "    %d skip events logged\n", (int)log.size() );
+    }
+    eclib->BL_Disconnect( id );
+    return left ? ERR_GEN_FUNCTIONFAILED : ERR_NOERROR;
+}
+
+int main( int argc, char** argv )
+{
+    double seconds = ( argc > 1 ) ? atof( argv[1] ) : 10.0;
+    int    memory  = ( argc > 2 ) ? atoi( argv[2] ) : 64;
+    if( seconds < 1.0 || memory < 8 || memory > 4096 ){
+        printf( "usage: %s [seconds, at least 1 (default 10)] [memory kB per channel 8..4096 (default 64)]\n", argv[0] );
+        return 1;
+    }
+
+    TSimConfig_t config = SIM_DefaultConfig();
+    config.Channels = NB_CHANNELS;
+    config.Speed    = 0.0;
+    config.Step     = 0.0;
+    config.MemSize  = memory * 1024;
+    TEClibFunctions eclib;
+    SIM_FillFunctionTable( &eclib );
+
+    TRun_t fixed = {}, adaptive = {};
+    printf( "every %d ms:\n", FIXED_MS );
+    int status = s_run( &eclib, config, seconds, false, &fixed );
+    if( status == ERR_NOERROR ){
+        printf( "by priority:\n" );
+        status = s_run( &eclib, config, seconds, true, &adaptive );
+    }
+    if( status != ERR_NOERROR ){
+        printf( "Error %d during the acquisition\n", status );
+        return 2;
+    }
+
+    int errors = 0;
+    unsigned long long fixed_skipped = 0, adaptive_skipped = 0;
+    printf( "\n%-8s %8s %12s %12s %12s %12s %12s %9s\n", "channel", "points/s", "fixed read", "dropped", "priority read", "dropped", "bytes/s est.", "priority" );
+    for( int ch = 0; ch < NB_CHANNELS; ch++ ){
+        double expected = s_rates[ch] * seconds;
+        printf( "%-8d %8.0f %12llu %12llu %12llu %12llu %12.0f %9s\n", ch + 1, s_rates[ch], fixed.Points[ch], fixed.Skipped[ch],
+                adaptive.Points[ch], adaptive.Skipped[ch], adaptive.Rate[ch], s_priorities[adaptive.Priority[ch]] );
+        if( fabs( (double)( fixed.Points[ch] + fixed.Skipped[ch] ) - expected ) > 1.0 + 1e-3 * expected ) errors++;
+        if( fabs( (double)( adaptive.Points[ch] + adaptive.Skipped[ch] ) - expected ) > 1.0 + 1e-3 * expected ) errors++;
+        if( fabs( adaptive.Rate[ch] - s_rates[ch] * ROW_BYTES ) > 0.1 * s_rates[ch] * ROW_BYTES ) errors++;
+        fixed_skipped    += fixed.Skipped[ch];
+        adaptive_skipped += adaptive.Skipped[ch];
+    }
+    printf( "dropped: %llu every %d ms (%d polls), %llu by priority (%d polls)\n", fixed_skipped, FIXED_MS, fixed.Polls, adaptive_skipped, adaptive.Polls );
+
+    /* the priorities follow the time left before the memory is full */
+    for( int ch = 1; ch < NB_CHANNELS; ch++ ) if( adaptive.Priority[ch] < adaptive.Priority[ch - 1] ) errors++;
+    if( adaptive.Skipped[0] || adaptive.Skipped[1] || adaptive_skipped * 20 > fixed_skipped ) errors++;
+
+    printf( "%s\n", errors ? "ERRORS" : "OK" );
+    return errors ? 4 : 0;
+}
@@ -0,0 +1,129 @@
+// bulkload.cpp : a technique chain loaded on 1, 4 and 16 channels at once
+//
+// usage: bulkload <settings.mps> [ecc folder] [link KB/s] [channel ms]
+//
+// The chain compiled from a .mps file is loaded with TechniqueCache::loadChannels,
+// one channel after the other and all the channels at once, and the wall-clock
+// time of each load is printed. No instrument is needed: BL_LoadTechnique is
+// replaced by a model of one, where the .ecc file and the parameters go through
+// the link of the device one command at a time (link KB/s), then the channel
+// takes some time to process the technique (channel ms) while the link is free
+// for the other channels. The results of each channel are then shown for a chain
+// with a missing .ecc file and for an unplugged channel.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "MappedFile.h"
+#include "MpsFile.h"
+#include "TechniqueCache.h"
+
+static double            s_link_rate   = 1000.0 * 1024;  /* bytes per second */
+static double            s_channel_sec = 0.010;
+static std::mutex        s_link;                          /* the command queue of the device */
+static std::atomic<int>  s_loads( 0 );
+static int               s_unplugged = -1;
+
+static void s_wait( double seconds ){
+    std::this_thread::sleep_for( std::chrono::duration<double>( seconds ) );
+}
+
+static int BL_STDCALL s_loadTechnique( int, uint8 channel, const char* pFName, TEccParams_t Params, bool, bool, bool ){
+    if( channel == s_unplugged ) return ERR_GEN_CHANNELNOTPLUGGED;
+    MappedFile ecc;
+    if( ecc.open( pFName ) != ERR_NOERROR ) return ERR_TECH_ECCFILENOTEXISTS;
+    double bytes = (double)ecc.size() + Params.len * (double)sizeof(TEccParam_t);
+    {
+        std::lock_guard<std::mutex> guard( s_link );
+        s_wait( bytes / s_link_rate );
+    }
+    s_wait( s_channel_sec );
+    s_loads++;
+    return ERR_NOERROR;
+}
+
+static int BL_STDCALL s_updateParameters( int, uint8, int, TEccParams_t, const char* ){
+    return ERR_NOERROR;
+}
+
+static int s_run( TechniqueCache& cache, const std::vector<TEccTechnique_t>& chain, int channels, int threads,
+                  TTechniqueBulkLoad_t* report, std::vector<int>& results ){
+    std::vector<uint8> mask( 16, 0 );
+    for( int ch = 0; ch < channels; ch++ ) mask[ch] = 1;
+    results.assign( 16, ERR_NOERROR );
+    cache.clear();
+    return cache.loadChannels( 1, mask.data(), results.data(), (uint8)mask.size(), chain, report, threads );
+}
+
+static void s_printResults( const std::vector<int>& results ){
+    for( size_t ch = 0; ch < results.size(); ch++ ) printf( " %d", results[ch] );
+    printf( "\n" );
+}
+
+int main( int argc, char** argv )
+{
+    if( argc < 2 ){
+        printf( "usage: %s <settings.mps> [ecc folder (default ../../../EC-Lab Development Package/)] [link KB/s (default 1000)] [channel ms (default 10)]\n", argv[0] );
+        return 1;
+    }
+    std::string ecc_dir = ( argc > 2 ) ? argv[2] : "../../../EC-Lab Development Package/";
+    if( argc > 3 ) s_link_rate   = atof( argv[3] ) * 1024;
+    if( argc > 4 ) s_channel_sec = atof( argv[4] ) / 1000;
+    if( !ecc_dir.empty() && ecc_dir[ecc_dir.size() - 1] != '/' && ecc_dir[ecc_dir.size() - 1] != '\\' ) ecc_dir += "/";
+    if( s_link_rate <= 0 || s_channel_sec < 0 ){
+        printf( "the link rate must be positive and the channel time must not be negative\n" );
+        return 1;
+    }
+
+    MpsFile mps;
+    std::vector<TEccTechnique_t> chain;
+    int status = mps.open( argv[1] );
+    if( status == ERR_NOERROR ) status = mps.compile( ECC_IsVmp4Device( mps.device() ), 0, chain );
+    if( status != ERR_NOERROR ){
+        printf( "Cannot compile '%s': %s (error %d)\n", argv[1], mps.errorMessage(), status );
+        return 2;
+    }
+
+    std::unique_ptr<TEClibFunctions> eclib( new TEClibFunctions() );
+    eclib->BL_LoadTechnique    = s_loadTechnique;
+    eclib->BL_UpdateParameters = s_updateParameters;
+    TechniqueCache cache( eclib.get(), ecc_dir );
+    printf( "%s: %zu technique(s); model: link %.0f KB/s, channel %.1f ms per technique\n",
+            argv[1], chain.size(), s_link_rate / 1024, s_channel_sec * 1e3 );
+
+    int errors = 0;
+    std::vector<int> results;
+    TTechniqueBulkLoad_t one, all;
+    static const int counts[3] = { 1, 4, 16 };
+    for( int c = 0; c < 3; c++ ){
+        int status_one = s_run( cache, chain, counts[c], 1, &one, results );
+        int status_all = s_run( cache, chain, counts[c], 0, &all, results );
+        if( status_one != ERR_NOERROR || status_all != ERR_NOERROR || all.Failed ) errors++;
+        printf( "%2d channel(s): one at a time %7.1f ms, all at once %7.1f ms (%.1fx), .ecc checked in %.1f us\n",
+                counts[c], one.Seconds * 1e3, all.Seconds * 1e3, one.Seconds / all.Seconds, all.CheckSeconds * 1e6 );
+    }
+
+    /* per channel results */
+    std::vector<TEccTechnique_t> missing( chain );
+    missing.back().EccFile = "missing.ecc";
+    int loads = s_loads;
+    status = s_run( cache, missing, 16, 0, &all, results );
+    printf( "missing .ecc file: error %d, %d technique(s) sent, results:", status, s_loads - loads );
+    s_printResults( results );
+    if( status != ERR_TECH_ECCFILENOTEXISTS || s_loads != loads ) errors++;
+
+    s_unplugged = 13;
+    status = s_run( cache, chain, 16, 0, &all, results );
+    printf( "channel 14 unplugged: error %d, %d channel(s) failed, results:", status, all.Failed );
+    s_printResults( results );
+    if( status != ERR_GEN_CHANNELNOTPLUGGED || all.Failed != 1 || results[13] != ERR_GEN_CHANNELNOTPLUGGED ) errors++;
+    return errors ? 4 : 0;
+}
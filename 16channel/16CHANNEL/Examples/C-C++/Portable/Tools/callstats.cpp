@@ -0,0 +1,158 @@
+// callstats.cpp : statistics of the calls to the ECLib functions
+//
+// usage: callstats [calls per thread] [threads]
+//
+// Measures the cost of the instrumented table (CST_InstrumentTable) on the
+// cheapest function of a simulated device, which must stay under 50 ns per
+// call, and checks that a table cannot be instrumented twice. Then calls BL_GetCurrentValues and
+// BL_GetData from several threads, each on its own channels, some on channels
+// which are not plugged; the statistics are read while the calls go on and
+// checked against the calls made.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "CallStats.h"
+#include "InstrumentSim.h"
+
+typedef std::chrono::steady_clock Clock;
+
+#define PLUGGED         (8)      /* channels of the simulated device, the next ones answer an error */
+#define ROUNDS          (5)      /* of the measure of the cost, the fastest is kept */
+#define COST_BUDGET_NS  (50.0)
+
+/* ns per call of BL_ConvertNumericIntoSingle through a table, fastest of the rounds */
+static double s_cost( const TEClibFunctions* eclib, int calls ){
+    double best = 0.0;
+    float value = 0.0f, sum = 0.0f;
+    for( int r = 0; r < ROUNDS; r++ ){
+        Clock::time_point start = Clock::now();
+        for( int i = 0; i < calls; i++ ){
+            eclib->BL_ConvertNumericIntoSingle( (unsigned int)i, &value );
+            sum += value;
+        }
+        double ns = std::chrono::duration<double, std::nano>( Clock::now() - start ).count() / calls;
+        if( r == 0 || ns < best ) best = ns;
+    }
+    if( sum == 1.0f ) printf( " " );   /* the calls are not optimized out */
+    return best;
+}
+
+/* ns of the two reads of the tick counter of a timed call */
+static double s_ticksCost( int calls ){
+    unsigned long long sum = 0;
+    Clock::time_point start = Clock::now();
+    for( int i = 0; i < calls; i++ ){
+        unsigned long long t = CallStats::ticks();
+        sum += CallStats::ticks() - t;
+    }
+    double ns = std::chrono::duration<double, std::nano>( Clock::now() - start ).count() / calls;
+    return sum ? ns : 0.0;
+}
+
+static void s_caller( const TEClibFunctions* eclib, int id, int first, int step, int calls, int* errors ){
+    TCurrentValues_t values;
+    TDataBuffer_t buf;
+    TDataInfos_t infos;
+    *errors = 0;
+    for( int i = 0; i < calls; i++ ){
+        int ch = first + step * ( i % ( 16 / step ) );
+        int status = ( ( i / ( 16 / step ) ) % 4 ) ? eclib->BL_GetCurrentValues( id, (uint8)ch, &values ) : eclib->BL_GetData( id, (uint8)ch, &buf, &infos, &values );
+        if( ( status != ERR_NOERROR ) != ( ch >= PLUGGED ) ) ( *errors )++;
+    }
+}
+
+int main( int argc, char** argv )
+{
+    int calls   = ( argc > 1 ) ? atoi( argv[1] ) : 200000;
+    int threads = ( argc > 2 ) ? atoi( argv[2] ) : 4;
+    if( calls < 16 || threads < 1 || threads > 16 || 16 % threads ){
+        printf( "usage: %s [calls per thread (default 200000)] [threads 1, 2, 4, 8 or 16 (default 4)]\n", argv[0] );
+        return 1;
+    }
+
+    TSimConfig_t config = SIM_DefaultConfig();
+    config.Channels = PLUGGED;
+    config.Speed    = 0.0;
+    config.Step     = 0.0;
+    TEClibFunctions raw, disabled, instrumented;
+    CallStats stats;
+    int id = -1;
+    TDeviceInfos_t infos;
+    if( SIM_Configure( config ) != ERR_NOERROR || SIM_FillFunctionTable( &raw ) != ERR_NOERROR ||
+        CST_InstrumentTable( &raw, 0, &disabled ) != ERR_NOERROR || CST_InstrumentTable( &raw, &stats, &instrumented ) != ERR_NOERROR ||
+        instrumented.BL_Connect( "USB0", 5, &id, &infos ) != ERR_NOERROR ){
+        printf( "Cannot connect to the simulated device\n" );
+        return 2;
+    }
+    int errors = 0;
+
+    /* without statistics the functions are those of the library */
+    if( disabled.BL_GetData != raw.BL_GetData || disabled.BL_ConvertNumericIntoSingle != raw.BL_ConvertNumericIntoSingle ) errors++;
+
+    double direct = s_cost( &raw, calls );
+    double wrapped = s_cost( &instrumented, calls );
+    printf( "BL_ConvertNumericIntoSingle: %.1f ns per call, %.1f ns instrumented: %.1f ns more (%.1f ns for the ticks of a timed call, %.2f ns per tick)\n",
+            direct, wrapped, wrapped - direct, s_ticksCost( calls ), CallStats::nsPerTick() );
+    if( wrapped - direct > COST_BUDGET_NS ){
+        printf( "more than %.0f ns per call\n", COST_BUDGET_NS );
+        errors++;
+    }
+    /* every call counted, one in CST_TIMED_EVERY timed */
+    std::vector<TCallStat_t> converted = stats.snapshot();
+    unsigned long long timed = stats.histogram( CST_CONVERTNUMERICINTOSINGLE ).count();
+    if( converted.empty() || converted.back().Function != CST_CONVERTNUMERICINTOSINGLE || converted.back().Calls != (unsigned long long)calls * ROUNDS ||
+        timed != ( (unsigned long long)calls * ROUNDS + CST_TIMED_EVERY - 1 ) / CST_TIMED_EVERY ) errors++;
+    stats.reset();
+
+    /* one instrumented table: neither another one nor the instrumented table itself */
+    CallStats other;
+    TEClibFunctions again;
+    if( CST_InstrumentTable( &raw, &other, &again ) != ERR_GEN_FUNCTIONINPROGRESS ||
+        CST_InstrumentTable( &instrumented, &stats, &again ) != ERR_GEN_INVALIDPARAMETERS ) errors++;
+
+    /* the threads, and the statistics read while they call */
+    std::vector<std::thread> list;
+    std::vector<int> failed( threads, 0 );
+    Clock::time_point start = Clock::now();
+    for( int t = 0; t < threads; t++ ) list.push_back( std::thread( s_caller, &instrumented, id, t, threads, calls, &failed[t] ) );
+    int dumps = 0;
+    for( unsigned long long made = 0; made < (unsigned long long)calls * threads / 2; dumps++ ){
+        stats.dump();
+        std::vector<TCallStat_t> partial = stats.snapshot();
+        made = 0;
+        for( size_t i = 0; i < partial.size(); i++ ) made += partial[i].Calls;
+    }
+    for( int t = 0; t < threads; t++ ){
+        list[t].join();
+        errors += failed[t];
+    }
+    double seconds = std::chrono::duration<double>( Clock::now() - start ).count();
+    printf( "%d threads, %d calls each in %.3f s, statistics read %d times meanwhile\n\n", threads, calls, seconds, dumps );
+    printf( "%s\n", stats.dump().c_str() );
+
+    /* each channel got the calls made on it, the unplugged ones with their error */
+    std::vector<TCallStat_t> snapshot = stats.snapshot();
+    unsigned long long total = 0;
+    for( size_t i = 0; i < snapshot.size(); i++ ){
+        const TCallStat_t& s = snapshot[i];
+        total += s.Calls;
+        if( s.Channel >= PLUGGED ){
+            if( s.Errors != s.Calls || s.Codes.size() != 1 || s.Codes[0].first != ERR_GEN_CHANNELNOTPLUGGED ) errors++;
+        } else if( s.Errors != 0 || s.Channel == CST_NONE ){
+            errors++;
+        }
+    }
+    if( total != (unsigned long long)calls * threads || snapshot.size() != 32 ) errors++;
+
+    instrumented.BL_Disconnect( id );
+    CST_ReleaseTable();
+    if( CST_InstrumentTable( &raw, &other, &again ) != ERR_NOERROR ) errors++;
+    CST_ReleaseTable();
+    printf( "%s\n", errors ? "ERRORS" : "OK" );
+    return errors ? 4 : 0;
+}
@@ -0,0 +1,223 @@
+// capbench.cpp : benchmark of the capture files
+//
+// usage: capbench [points per channel] [channels] [output.ecap]
+//
+// Battery cycling data (CA layout with the Q and I range extra values) is
+// synthesized for every channel and written to a capture file. The file is
+// then read back and compared with the source, searched by time and cycle,
+// cut in the middle of a chunk to check the recovery, and appended to.
+// Sizes are compared with the same points as raw rows.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+
+#include "CaptureFile.h"
+
+typedef std::chrono::steady_clock Clock;
+
+#define ROWS_PER_FRAME (125) /* 125 rows x 8 words, a full CA buffer with 3 extra values */
+#define TIME_BASE      (2e-5f)
+#define NB_EXTRA       (2)
+#define XREC           (XREC_Q | XREC_IRG)
+
+static double s_elapsed( Clock::time_point start ){
+    return std::chrono::duration<double>( Clock::now() - start ).count();
+}
+
+static unsigned int s_noise( unsigned int ch, unsigned long long k ){
+    unsigned long long x = ( k + 1 ) * 0x9E3779B97F4A7C15ULL ^ ( (unsigned long long)ch << 40 );
+    x ^= x >> 31; x *= 0xBF58476D1CE4E5B9ULL; x ^= x >> 29;
+    return (unsigned int)x;
+}
+
+/* point k of a channel: 1 point every 10 ms, charge/discharge cycles of 10000 points */
+static void s_point( int ch, unsigned long long k, double* t, float* ewe, float* i, unsigned int* cycle, float* q, float* irange ){
+    unsigned long long ticks = k * 500;
+    unsigned int cyc  = (unsigned int)( k / 10000 );
+    bool   charge     = ( k / 5000 ) % 2 == 0;
+    double phase      = (double)( k % 5000 ) / 5000.0;
+    /* values quantized as by an ADC: 20 bits over the range */
+    double e = ( charge ? 3.2 + 1.0 * phase : 4.2 - 1.0 * phase ) + ( (int)( s_noise( ch, k ) % 9 ) - 4 ) * 1e-5;
+    double c = ( charge ? 0.01 : -0.01 ) + ( (int)( s_noise( ch + 100, k ) % 5 ) - 2 ) * 2e-6;
+    *t      = (double)TIME_BASE * (double)ticks;
+    *ewe    = (float)( floor( e / 2e-5 ) * 2e-5 );
+    *i      = (float)( floor( c / 2e-7 ) * 2e-7 );
+    *cycle  = cyc;
+    *q      = (float)( ( charge ? phase : 1.0 - phase ) * 180.0 );
+    *irange = (float)KBIO_IRANGE_10mA;
+}
+
+static void s_makeFrame( int ch, unsigned long long first, int n, TDecodedFrame_t* f ){
+    f->TechniqueID    = KBIO_TECHID_CA;
+    f->TechniqueIndex = 0;
+    f->ProcessIndex   = 0;
+    f->Loop           = 0;
+    f->NbRows         = n;
+    f->Fields         = BL_FIELD_EWE | BL_FIELD_I | BL_FIELD_CYCLE;
+    f->Xrec           = XREC;
+    f->NbExtra        = NB_EXTRA;
+    for( int r = 0; r < n; r++ ){
+        s_point( ch, first + r, &f->Time[r], &f->Ewe[r], &f->I[r], &f->Cycle[r], &f->Extra[0][r], &f->Extra[1][r] );
+    }
+}
+
+/* writes the points [from[ch], to) of every channel, the channels interleaved frame by frame */
+static int s_write( CaptureWriter& w, const std::vector<unsigned long long>& from, unsigned long long to ){
+    static TDecodedFrame_t frame;
+    std::vector<unsigned long long> k( from );
+    int status = ERR_NOERROR;
+    bool more = true;
+    while( more && status == ERR_NOERROR ){
+        more = false;
+        for( size_t ch = 0; ch < k.size() && status == ERR_NOERROR; ch++ ){
+            if( k[ch] >= to ) continue;
+            int n = (int)( to - k[ch] < ROWS_PER_FRAME ? to - k[ch] : ROWS_PER_FRAME );
+            s_makeFrame( (int)ch, k[ch], n, &frame );
+            status = w.appendFrame( (int)ch, frame );
+            k[ch] += n;
+            more = true;
+        }
+    }
+    return status;
+}
+
+/* decodes every chunk and compares it with the source; returns the number of points checked, or -1 */
+static long long s_verify( const CaptureReader& r, int channels, double* decode_time ){
+    TCapChunk_t c;
+    std::vector<unsigned long long> next( channels, 0 );
+    long long checked = 0;
+    *decode_time = 0.0;
+    for( size_t i = 0; i < r.chunkCount(); i++ ){
+        Clock::time_point start = Clock::now();
+        if( r.readChunk( i, c ) != ERR_NOERROR ){
+            printf( "  chunk %zu: damaged\n", i );
+            return -1;
+        }
+        *decode_time += s_elapsed( start );
+        if( c.Channel >= channels ) return -1;
+        for( size_t row = 0; row < c.Time.size(); row++ ){
+            double t; float ewe, cur, q, irange; unsigned int cycle;
+            s_point( c.Channel, next[c.Channel]++, &t, &ewe, &cur, &cycle, &q, &irange );
+            if( memcmp( &t, &c.Time[row], 8 ) || ewe != c.Ewe[row] || cur != c.I[row] || cycle != c.Cycle[row]
+                || q != c.Extra[0][row] || irange != c.Extra[1][row] ){
+                printf( "  channel %d, point %llu differs\n", c.Channel, next[c.Channel] - 1 );
+                return -1;
+            }
+            checked++;
+        }
+    }
+    return checked;
+}
+
+static long long s_fileSize( const char* path ){
+    MappedFile f;
+    return f.open( path ) == ERR_NOERROR ? (long long)f.size() : -1;
+}
+
+int main( int argc, char** argv )
+{
+    unsigned long long points = ( argc > 1 ) ? strtoull( argv[1], 0, 10 ) : 1000000;
+    int                channels = ( argc > 2 ) ? atoi( argv[2] ) : 16;
+    const char*        output = ( argc > 3 ) ? argv[3] : "capbench.ecap";
+    if( channels < 1 || channels > CAP_MAX_CHANNELS || points == 0 ){
+        printf( "usage: %s [points per channel (default 1000000)] [channels (default 16)] [output.ecap]\n", argv[0] );
+        return 1;
+    }
+
+    /* time, Ewe, I (f32), cycle (u32) and 2 extra values per raw point */
+    double raw_mb = (double)points * channels * ( 8 + 4 + 4 + 4 + 4 * NB_EXTRA ) / ( 1024.0 * 1024.0 );
+
+    CaptureWriter w;
+    Clock::time_point start = Clock::now();
+    int status = w.open( output );
+    if( status == ERR_NOERROR ) status = s_write( w, std::vector<unsigned long long>( channels, 0 ), points );
+    if( status == ERR_NOERROR ) status = w.close();
+    double t = s_elapsed( start );
+    if( status != ERR_NOERROR ){
+        printf( "Cannot write '%s' (error %d)\n", output, status );
+        return 2;
+    }
+    long long size = s_fileSize( output );
+    printf( "wrote %s: %d channels x %llu points, %.1f MB raw -> %.1f MB (ratio %.2f, %.2f bytes/point)\n",
+            output, channels, points, raw_mb, size / ( 1024.0 * 1024.0 ), raw_mb * 1024.0 * 1024.0 / size,
+            (double)size / ( (double)points * channels ) );
+    printf( "write (synthesis included): %.3f s, %.1f MB/s raw\n", t, raw_mb / t );
+
+    CaptureReader r;
+    start = Clock::now();
+    status = r.open( output );
+    double open_time = s_elapsed( start );
+    if( status != ERR_NOERROR ){
+        printf( "Cannot read '%s' (error %d)\n", output, status );
+        return 3;
+    }
+    double decode_time;
+    long long checked = s_verify( r, channels, &decode_time );
+    int errors = ( checked != (long long)( points * channels ) ) ? 1 : 0;
+    printf( "read: open %.3f ms (%zu chunks), decode %.3f s, %.1f MB/s raw, %s\n",
+            open_time * 1e3, r.chunkCount(), decode_time, raw_mb / decode_time, errors ? "FAILED" : "bit exact" );
+
+    /* random access: chunk holding a time, then the point itself */
+    const int lookups = 10000;
+    TCapChunk_t c;
+    double last_time = (double)TIME_BASE * (double)( ( points - 1 ) * 500 );
+    start = Clock::now();
+    for( int n = 0; n < lookups; n++ ){
+        int ch = (int)( s_noise( 7, n ) % channels );
+        double when = last_time * ( s_noise( 8, n ) % 1000000 ) / 1000000.0;
+        int idx = r.findTime( ch, when );
+        if( idx < 0 || r.readChunk( idx, c ) != ERR_NOERROR || c.Time.back() < when ){
+            errors++;
+            break;
+        }
+    }
+    t = s_elapsed( start );
+    printf( "random access by time: %.1f us per lookup (bisection + chunk decode)\n", t * 1e6 / lookups );
+    int by_cycle = r.findCycle( channels - 1, (unsigned int)( points / 10000 / 2 ) );
+    if( by_cycle < 0 || r.chunk( by_cycle ).Channel != channels - 1 ) errors++;
+    r.close();
+
+    /* crash: the file cut in the middle of a chunk, without index */
+    {
+        MappedFile whole;
+        whole.open( output );
+        std::vector<unsigned char> copy( whole.data(), whole.data() + whole.size() / 2 );
+        whole.close();
+        std::string cut_path = std::string( output ) + ".cut";
+        FILE* f = fopen( cut_path.c_str(), "wb" );
+        if( f ){
+            fwrite( &copy[0], 1, copy.size(), f );
+            fclose( f );
+        }
+
+        CaptureReader cut;
+        status = cut.open( cut_path.c_str() );
+        long long cut_checked = status == ERR_NOERROR ? s_verify( cut, channels, &decode_time ) : -1;
+        size_t cut_chunks = cut.chunkCount();
+        printf( "cut at %zu bytes: %s, %zu chunks, %lld points recovered\n", copy.size(),
+                cut.isRecovered() ? "index rebuilt" : "index found", cut_chunks, cut_checked );
+        if( !cut.isRecovered() || cut_checked <= 0 ) errors++;
+        cut.close();
+
+        /* append to the damaged file: the incomplete chunk is dropped, a new index is written */
+        CaptureWriter again;
+        status = again.open( cut_path.c_str(), true );
+        std::vector<unsigned long long> next( channels, 0 );
+        for( size_t i = 0; i < again.index().size(); i++ ) next[again.index()[i].Channel] += again.index()[i].NbRows;
+        if( status == ERR_NOERROR ) status = s_write( again, next, points );
+        if( status == ERR_NOERROR ) status = again.close();
+        if( status == ERR_NOERROR ) status = cut.open( cut_path.c_str() );
+        checked = status == ERR_NOERROR ? s_verify( cut, channels, &decode_time ) : -1;
+        bool ok = status == ERR_NOERROR && !cut.isRecovered() && checked == (long long)( points * channels );
+        printf( "append after the crash: %s, %lld points\n", ok ? "ok" : "FAILED", checked );
+        if( !ok ) errors++;
+        cut.close();
+        remove( cut_path.c_str() );
+    }
+    return errors ? 4 : 0;
+}
@@ -0,0 +1,219 @@
+// ctrlloop.cpp : closed-loop update of a running CA technique, with its latencies
+//
+// usage: ctrlloop [seconds] [transfer ms] [update ms]
+//
+// A CA technique holds the current of a cell at a target by changing its
+// Voltage_step while it runs: the control function integrates the error of the
+// current of each frame, and the ControlLoop sends the new potential with
+// BL_UpdateParameters. No instrument is needed: BL_GetData and BL_UpdateParameters
+// are replaced by a simulated channel (a cell of 1 kOhm behind 0.2 V, a point per
+// ms, the points sent to the computer every 'transfer ms', an update taking
+// 'update ms'). The latency histograms from the points to the updates are printed,
+// then updates which are not valid for the chain are shown rejected.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "ControlLoop.h"
+#include "EccBuilder.h"
+
+typedef std::chrono::steady_clock Clock;
+
+#define TIME_BASE     (2e-5)
+#define CELL_OCV      (0.2)    /* V */
+#define CELL_R        (1000.0) /* Ohm */
+#define TARGET_I      (5e-4)   /* A */
+
+static double s_elapsed( Clock::time_point start ){
+    return std::chrono::duration<double>( Clock::now() - start ).count();
+}
+
+static unsigned int s_word( float v ){
+    unsigned int w;
+    memcpy( &w, &v, sizeof(w) );
+    return w;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// simulated channel
+
+static std::mutex         s_lock;
+static Clock::time_point  s_start;
+static double             s_duration   = 2.0;
+static double             s_transfer   = 0.010;
+static double             s_update     = 0.002;
+static double             s_potential  = 0.0;   /* Voltage_step[0] applied */
+static long long          s_sent       = 0;     /* points sent to the computer */
+static unsigned int       s_noise      = 12345;
+
+static int BL_STDCALL s_getData( int, uint8, TDataBuffer_t* pBuf, TDataInfos_t* pInfos, TCurrentValues_t* pValues ){
+    std::lock_guard<std::mutex> guard( s_lock );
+    double now = s_elapsed( s_start );
+    bool running = now < s_duration;
+    double until = running ? now : s_duration;
+    /* the points recorded up to the last transfer */
+    long long available = (long long)( (long long)( until / s_transfer ) * s_transfer * 1000.0 );
+    long long rows = available - s_sent;
+    if( rows > 200 ) rows = 200;
+    if( rows < 0 ) rows = 0;
+
+    memset( pInfos, 0, sizeof(*pInfos) );
+    pInfos->TechniqueID = KBIO_TECHID_CA;
+    pInfos->NbRows      = (int)rows;
+    pInfos->NbCols      = 5;
+    for( int i = 0; i < (int)rows; i++ ){
+        long long k = s_sent + i;
+        unsigned long long t = (unsigned long long)( k * 1e-3 / TIME_BASE );
+        s_noise = s_noise * 1103515245u + 12345u;
+        float current = (float)( ( s_potential - CELL_OCV ) / CELL_R + 2e-6 * ( (int)( s_noise >> 16 & 0xff ) - 128 ) / 128.0 );
+        unsigned int* row = &pBuf->data[i * 5];
+        row[0] = (unsigned int)( t >> 32 );
+        row[1] = (unsigned int)t;
+        row[2] = s_word( (float)s_potential );
+        row[3] = s_word( current );
+        row[4] = 0;
+    }
+    s_sent += rows;
+
+    memset( pValues, 0, sizeof(*pValues) );
+    pValues->State       = ( running || s_sent < available ) ? KBIO_STATE_RUN : KBIO_STATE_STOP;
+    pValues->TimeBase    = (float)TIME_BASE;
+    pValues->ElapsedTime = (float)until;
+    return ERR_NOERROR;
+}
+
+static int BL_STDCALL s_updateParameters( int, uint8, int TechIndx, TEccParams_t Params, const char* ){
+    if( TechIndx != 0 || Params.len > ECC_UPDATE_MAX_PARAMS ) return ERR_GEN_UPDATEPARAMETERS;
+    std::this_thread::sleep_for( std::chrono::duration<double>( s_update ) );
+    std::lock_guard<std::mutex> guard( s_lock );
+    for( int i = 0; i < Params.len; i++ ){
+        if( strcmp( Params.pParams[i].ParamStr, "Voltage_step" ) == 0 && Params.pParams[i].ParamIndex == 0 ){
+            s_potential = ECC_SglValue( Params.pParams[i] );
+        }
+    }
+    return ERR_NOERROR;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// control functions
+
+typedef struct {
+    double Potential;   /* V, last value sent */
+    double Current;     /* A, mean of the last frame */
+} TRegulator_t;
+
+/* integral control of the current: the potential moves by a part of the error */
+static bool s_regulate( void* user, const TDecodedFrame_t& frame, const TCurrentValues_t&, TControlUpdate_t* update ){
+    TRegulator_t* reg = (TRegulator_t*)user;
+    double sum = 0.0;
+    for( int i = 0; i < frame.NbRows; i++ ) sum += frame.I[i];
+    reg->Current = sum / frame.NbRows;
+    double next = reg->Potential + 0.5 * CELL_R * ( TARGET_I - reg->Current );
+    if( next - reg->Potential < 1e-4 && reg->Potential - next < 1e-4 ) return false;
+    reg->Potential = next;
+    TEccParam_t param;
+    ECC_DefineSglParameter( "Voltage_step", (float)next, 0, &param );
+    update->Params.push_back( param );
+    return true;
+}
+
+static bool s_changeRange( void*, const TDecodedFrame_t&, const TCurrentValues_t&, TControlUpdate_t* update ){
+    TEccParam_t param;
+    ECC_DefineIntParameter( "I_Range", KBIO_IRANGE_1mA, 0, &param );
+    update->Params.push_back( param );
+    return true;
+}
+
+static bool s_unknownStep( void*, const TDecodedFrame_t&, const TCurrentValues_t&, TControlUpdate_t* update ){
+    TEccParam_t param;
+    ECC_DefineSglParameter( "Voltage_step", 1.0f, 5, &param );
+    update->Params.push_back( param );
+    return true;
+}
+
+static void s_print( const char* name, const LatencyHistogram& h ){
+    THistSummary_t s = h.summary();
+    printf( "%-12s %6llu  p50 %7.3f ms  p90 %7.3f ms  p99 %7.3f ms  max %7.3f ms\n",
+            name, s.Count, s.P50 * 1e-6, s.P90 * 1e-6, s.P99 * 1e-6, s.Max * 1e-6 );
+}
+
+int main( int argc, char** argv )
+{
+    if( argc > 1 ) s_duration = atof( argv[1] );
+    if( argc > 2 ) s_transfer = atof( argv[2] ) / 1000;
+    if( argc > 3 ) s_update   = atof( argv[3] ) / 1000;
+    if( s_duration <= 0 || s_transfer <= 0 || s_update < 0 ){
+        printf( "usage: %s [seconds (default 2)] [transfer ms (default 10)] [update ms (default 2)]\n", argv[0] );
+        return 1;
+    }
+
+    /* CA, one step at 0 V for ever */
+    typedef EccSchemaCA S;
+    EccArena arena;
+    EccBuilder<S> ca( arena );
+    ca.sgl <ECC_PARAM( S, "Voltage_step" )>   ( 0.0f )
+      .flag<ECC_PARAM( S, "vs_initial" )>     ( false )
+      .sgl <ECC_PARAM( S, "Duration_step" )>  ( 3600.0f )
+      .num <ECC_PARAM( S, "Step_number" )>    ( 0 )
+      .num <ECC_PARAM( S, "N_Cycles" )>       ( 0 )
+      .sgl <ECC_PARAM( S, "Record_every_dI" )>( 1.0f )
+      .sgl <ECC_PARAM( S, "Record_every_dT" )>( 0.001f )
+      .num <ECC_PARAM( S, "I_Range" )>        ( KBIO_IRANGE_10mA )
+      .num <ECC_PARAM( S, "E_Range" )>        ( KBIO_ERANGE_2_5 )
+      .num <ECC_PARAM( S, "Bandwidth" )>      ( KBIO_BW_5 )
+      .num <ECC_PARAM( S, "xctr" )>           ( 0 );
+    std::vector<TEccTechnique_t> chain( 1 );
+    if( ca.technique( false, &chain[0] ) != ERR_NOERROR ) return 2;
+
+    std::unique_ptr<TEClibFunctions> eclib( new TEClibFunctions() );
+    eclib->BL_GetData          = s_getData;
+    eclib->BL_UpdateParameters = s_updateParameters;
+
+    int errors = 0;
+    TRegulator_t reg = { 0.0, 0.0 };
+    ControlLoop loop( eclib.get() );
+    s_start = Clock::now();
+    int status = loop.setup( 1, 0, chain, false, 0, s_regulate, &reg );
+    if( status == ERR_NOERROR ) status = loop.start( 1 );
+    if( status != ERR_NOERROR ){
+        printf( "Cannot start the loop: error %d\n", status );
+        return 2;
+    }
+    while( loop.isRunning() ) std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+    loop.stop();
+
+    TControlLoopStats_t st = loop.stats();
+    printf( "%.1f s, transfer every %.1f ms, update %.1f ms: %llu frames, %llu points, %llu updates (%llu rejected, %llu failed)\n",
+            s_duration, s_transfer * 1e3, s_update * 1e3, st.Frames, st.Points, st.Updates, st.Rejected, st.Failed );
+    printf( "current %.4f mA for a target of %.4f mA, Voltage_step %.4f V\n", reg.Current * 1e3, TARGET_I * 1e3, s_potential );
+    s_print( "end to end", loop.latency( CTRL_LATENCY_END_TO_END ) );
+    s_print( "computer", loop.latency( CTRL_LATENCY_HOST ) );
+    s_print( "update call", loop.latency( CTRL_LATENCY_UPDATE ) );
+    if( loop.status() != ERR_NOERROR || st.Updates == 0 || st.Rejected || st.Failed ) errors++;
+    if( reg.Current < TARGET_I * 0.95 || reg.Current > TARGET_I * 1.05 ) errors++;
+
+    /* updates which are not valid for the chain are not sent */
+    TDataBuffer_t    buf;
+    TDataInfos_t     infos;
+    TCurrentValues_t curr;
+    s_duration = 1e9;
+    s_start = Clock::now() - std::chrono::milliseconds( 50 );
+    s_sent  = 0;
+    s_getData( 1, 0, &buf, &infos, &curr );
+    TControlFunction_t bad[2] = { s_changeRange, s_unknownStep };
+    const char* names[2] = { "I_Range changed", "Voltage_step[5]" };
+    for( int b = 0; b < 2; b++ ){
+        ControlLoop check( eclib.get() );
+        check.setup( 1, 0, chain, false, 0, bad[b], 0 );
+        status = check.process( buf, infos, curr );
+        printf( "%-16s -> %s (error %d)\n", names[b], status == ERR_GEN_UPDATEPARAMETERS ? "rejected" : "SENT", status );
+        if( status != ERR_GEN_UPDATEPARAMETERS || check.stats().Rejected != 1 ) errors++;
+    }
+    return errors ? 4 : 0;
+}
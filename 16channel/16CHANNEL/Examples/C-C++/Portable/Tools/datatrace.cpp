@@ -0,0 +1,200 @@
+// datatrace.cpp : record of the answers of BL_GetData, then their replay
+//
+// usage: datatrace [seconds] [trace file] [capture file]
+//
+// Four channels of a simulated device are polled every 20 ms for 'seconds'
+// through a recording table; the frames are decoded as they come. The trace is
+// then replayed at full speed (the frames decoded and stored to the capture
+// file), 4 times faster and as recorded: each replay must give the same frames,
+// the same errors, and last as long as the recording divided by its speed.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include "BLDecode.h"
+#include "CaptureFile.h"
+#include "DataTrace.h"
+#include "InstrumentSim.h"
+#include "ToolTechniques.h"
+
+typedef std::chrono::steady_clock Clock;
+
+#define NB_CHANNELS  (4)
+#define UNPLUGGED    (6)       /* channel asked for at each round */
+#define POLL_MS      (20)
+
+static const double s_rates[NB_CHANNELS] = { 1000.0, 2000.0, 5000.0, 10000.0 };
+
+typedef struct {
+    unsigned long long Frames;
+    unsigned long long Points;
+    unsigned long long Errors;    /* answers with an error */
+    unsigned long long Digest;    /* of the decoded frames, in the order of each channel */
+    double             Seconds;
+} TPass_t;
+
+static double s_elapsed( Clock::time_point start ){
+    return std::chrono::duration<double>( Clock::now() - start ).count();
+}
+
+/* FNV-1a of the decoded values, mixed per channel so that only the order within a channel matters */
+static void s_digest( TPass_t* pass, unsigned long long* channel, const TDecodedFrame_t& frame ){
+    unsigned long long h = *channel;
+    const unsigned char* parts[] = { (const unsigned char*)frame.Time, (const unsigned char*)frame.Ewe, (const unsigned char*)frame.I };
+    const size_t sizes[] = { sizeof(double), sizeof(float), sizeof(float) };
+    for( int k = 0; k < 3; k++ ){
+        for( size_t i = 0; i < sizes[k] * frame.NbRows; i++ ){
+            h ^= parts[k][i];
+            h *= 1099511628211ULL;
+        }
+    }
+    pass->Digest += h - *channel;
+    *channel = h;
+}
+
+/*
+ * Polls the channels (and the unplugged one) every 'poll_ms' until 'seconds' are
+ * over, then stops them and reads what is left; with no time (a replay), until
+ * every channel stopped.
+ */
+static int s_acquire( const TEClibFunctions* eclib, int id, double seconds, int poll_ms, CaptureWriter* capture, TPass_t* pass ){
+    std::unique_ptr<TDataBuffer_t>   buf( new TDataBuffer_t );
+    std::unique_ptr<TDecodedFrame_t> frame( new TDecodedFrame_t );
+    TDataInfos_t infos;
+    TCurrentValues_t curr;
+    unsigned long long digests[NB_CHANNELS] = { 0 };
+    bool stopped[NB_CHANNELS] = { false };
+    bool stopping = ( seconds <= 0.0 );
+    int left = NB_CHANNELS;
+    Clock::time_point start = Clock::now();
+    while( left > 0 ){
+        if( !stopping && s_elapsed( start ) >= seconds ){
+            for( int ch = 0; ch < NB_CHANNELS; ch++ ) eclib->BL_StopChannel( id, (uint8)ch );
+            stopping = true;
+        }
+        for( int ch = 0; ch < NB_CHANNELS; ch++ ){
+            if( stopped[ch] ) continue;
+            int status = eclib->BL_GetData( id, (uint8)ch, buf.get(), &infos, &curr );
+            if( status != ERR_NOERROR ) return status;
+            if( infos.NbRows > 0 ){
+                status = BL_DecodeData( *buf, infos, curr, false, 0, eclib->BL_ConvertNumericIntoSingle, frame.get() );
+                if( status != ERR_NOERROR ) return status;
+                if( capture && capture->appendFrame( ch, *frame ) != ERR_NOERROR ) return ERR_GEN_FUNCTIONFAILED;
+                s_digest( pass, &digests[ch], *frame );
+                pass->Frames++;
+                pass->Points += frame->NbRows;
+            } else if( stopping && curr.State == KBIO_STATE_STOP ){
+                stopped[ch] = true;
+                left--;
+            }
+        }
+        if( left == 0 ) break;
+        if( eclib->BL_GetData( id, UNPLUGGED, buf.get(), &infos, &curr ) != ERR_NOERROR ) pass->Errors++;
+        if( poll_ms > 0 ) std::this_thread::sleep_for( std::chrono::milliseconds( poll_ms ) );
+    }
+    pass->Seconds = s_elapsed( start );
+    return ERR_NOERROR;
+}
+
+int main( int argc, char** argv )
+{
+    double      seconds = ( argc > 1 ) ? atof( argv[1] ) : 2.0;
+    const char* path    = ( argc > 2 ) ? argv[2] : "datatrace.etrc";
+    const char* store   = ( argc > 3 ) ? argv[3] : "datatrace.ecap";
+    if( seconds < 0.5 || seconds > 3600.0 ){
+        printf( "usage: %s [seconds 0.5..3600 (default 2)] [trace file (default datatrace.etrc)] [capture file (default datatrace.ecap)]\n", argv[0] );
+        return 1;
+    }
+
+    /* the recording */
+    TSimConfig_t config = SIM_DefaultConfig();
+    config.Channels = NB_CHANNELS;
+    TEClibFunctions sim, eclib;
+    TraceRecorder recorder;
+    int id = -1;
+    TDeviceInfos_t dev;
+    if( SIM_Configure( config ) != ERR_NOERROR || SIM_FillFunctionTable( &sim ) != ERR_NOERROR ||
+        recorder.open( path ) != ERR_NOERROR || TRC_RecordTable( &sim, &recorder, &eclib ) != ERR_NOERROR ||
+        eclib.BL_Connect( "USB0", 5, &id, &dev ) != ERR_NOERROR ){
+        printf( "Cannot record the simulated device to %s\n", path );
+        return 2;
+    }
+    for( int ch = 0; ch < NB_CHANNELS; ch++ ){
+        TChannelInfos_t infos;
+        int status = TOOL_LoadCA( &eclib, id, ch, seconds + 10.0, s_rates[ch] );
+        if( status == ERR_NOERROR ) status = eclib.BL_GetChannelInfos( id, (uint8)ch, &infos );
+        if( status == ERR_NOERROR ) status = eclib.BL_StartChannel( id, (uint8)ch );
+        if( status != ERR_NOERROR ){
+            printf( "Error %d on channel %d\n", status, ch + 1 );
+            return 2;
+        }
+    }
+    TPass_t recorded = {};
+    int status = s_acquire( &eclib, id, seconds, POLL_MS, 0, &recorded );
+    eclib.BL_Disconnect( id );
+    if( status == ERR_NOERROR ) status = recorder.close();
+    if( status != ERR_NOERROR ){
+        printf( "Error %d during the recording\n", status );
+        return 2;
+    }
+    double raw = (double)recorder.records() * ( sizeof(TDataInfos_t) + sizeof(TCurrentValues_t) + sizeof(TDataBuffer_t) );
+    printf( "recorded %llu answers, %llu points in %.2f s: %llu bytes (%.1f bytes per point, %.1f%% of the structures returned)\n",
+            recorder.records(), recorded.Points, recorded.Seconds, recorder.bytes(),
+            recorded.Points ? (double)recorder.bytes() / recorded.Points : 0.0, 100.0 * recorder.bytes() / raw );
+
+    /* the replays */
+    TraceReplay replay;
+    TEClibFunctions replayed;
+    if( replay.load( path ) != ERR_NOERROR || TRC_FillFunctionTable( &replay, &replayed ) != ERR_NOERROR ){
+        printf( "Cannot load %s\n", path );
+        return 2;
+    }
+    int errors = 0;
+
+    /* one recording table: neither another one nor the recording table itself */
+    TraceRecorder other;
+    TEClibFunctions again;
+    if( TRC_RecordTable( &sim, &other, &again ) != ERR_GEN_FUNCTIONINPROGRESS ||
+        TRC_RecordTable( &eclib, &recorder, &again ) != ERR_GEN_INVALIDPARAMETERS ) errors++;
+    TRC_ReleaseTable();
+    if( TRC_RecordTable( &sim, &other, &again ) != ERR_NOERROR ) errors++;
+    TRC_ReleaseTable();
+
+    static const double speeds[] = { 0.0, 4.0, 1.0 };
+    printf( "\n%-8s %10s %10s %10s %12s %12s %8s\n", "speed", "seconds", "expected", "frames", "points", "points/s", "same" );
+    for( size_t k = 0; k < sizeof(speeds) / sizeof(speeds[0]); k++ ){
+        CaptureWriter capture;
+        if( speeds[k] == 0.0 && capture.open( store ) != ERR_NOERROR ){
+            printf( "Cannot write %s\n", store );
+            return 2;
+        }
+        replay.rewind();
+        replay.setSpeed( speeds[k] );
+        TPass_t pass = {};
+        status = replayed.BL_Connect( "USB0", 5, &id, &dev );
+        if( status == ERR_NOERROR ) status = s_acquire( &replayed, id, 0.0, 0, capture.isOpen() ? &capture : 0, &pass );
+        if( capture.isOpen() && capture.close() != ERR_NOERROR ) status = ERR_GEN_FUNCTIONFAILED;
+        if( status != ERR_NOERROR ){
+            printf( "Error %d during the replay\n", status );
+            return 2;
+        }
+        bool same = pass.Frames == recorded.Frames && pass.Points == recorded.Points && pass.Digest == recorded.Digest &&
+                    pass.Errors == recorded.Errors && replay.given() == replay.answers();
+        double expected = speeds[k] > 0.0 ? replay.duration() / speeds[k] : 0.0;
+        char label[16];
+        if( speeds[k] > 0.0 ) snprintf( label, sizeof(label), "%gx", speeds[k] );
+        else snprintf( label, sizeof(label), "max" );
+        printf( "%-8s %10.3f %10.3f %10llu %12llu %12.0f %8s\n", label, pass.Seconds, expected, pass.Frames, pass.Points,
+                pass.Seconds > 0.0 ? pass.Points / pass.Seconds : 0.0, same ? "yes" : "NO" );
+        if( !same ) errors++;
+        /* paced: as long as the recording from the connection, within the last poll */
+        if( speeds[k] > 0.0 && ( pass.Seconds < 0.95 * expected - 0.05 || pass.Seconds > 1.05 * expected + 0.1 ) ) errors++;
+    }
+    printf( "%s\n", errors ? "ERRORS" : "OK" );
+    return errors ? 4 : 0;
+}
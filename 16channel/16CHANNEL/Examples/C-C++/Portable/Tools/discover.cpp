@@ -0,0 +1,169 @@
+// discover.cpp : discovery of a rack of devices on USB and Ethernet
+//
+// usage: discover [cache file] [ms per device second]
+//
+// A rack of 4 USB and 6 Ethernet devices is searched among the USB indices and
+// a list of 16 addresses: one address after the other with the 5 s time-out of
+// the sample, all at once with a 1 s time-out, then from the cache written by
+// the previous run. No instrument is needed: BL_GetUSBdeviceinfos and BL_Connect
+// are simulated, a connection taking 0.3 s and an address without device the
+// whole time-out. The device is run faster than real time ('ms per device
+// second', 20 by default) and the times printed are those of the device.
+// Finally the USB cables are swapped and a device is removed, to check that the
+// cache notices it, and a device without serial number is found twice.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "DeviceDiscovery.h"
+
+#define CONNECT_SECONDS (0.3)
+
+/////////////////////////////////////////////////////////////////////////////
+// simulated rack
+
+static double                   s_scale = 0.020;   /* real seconds per device second */
+static std::mutex               s_lock;
+static std::vector<std::string> s_usb;             /* serial numbers by USB index */
+static std::vector<std::string> s_ethernet;        /* addresses with a device */
+static int                      s_open = 0;        /* connections not closed */
+
+static void s_wait( double device_seconds ){
+    std::this_thread::sleep_for( std::chrono::duration<double>( device_seconds * s_scale ) );
+}
+
+static bool s_copy( const std::string& text, char* buf, unsigned int* size ){
+    if( text.size() + 1 > *size ) return false;
+    memcpy( buf, text.c_str(), text.size() + 1 );
+    *size = (unsigned int)text.size();
+    return true;
+}
+
+static bool BL_STDCALL s_getUSBdeviceinfos( unsigned int USBindex, char* pcompany, unsigned int* pcompanysize, char* pdevice,
+                                            unsigned int* pdevicesize, char* pSN, unsigned int* pSNsize ){
+    s_wait( 0.01 );
+    std::lock_guard<std::mutex> guard( s_lock );
+    if( USBindex >= s_usb.size() ) return false;
+    return s_copy( "Bio-Logic", pcompany, pcompanysize ) && s_copy( "VMP3", pdevice, pdevicesize ) && s_copy( s_usb[USBindex], pSN, pSNsize );
+}
+
+static int BL_STDCALL s_connect( const char* address, uint8 timeout, int* pID, TDeviceInfos_t* pInfos ){
+    std::string a( address );
+    bool present = false;
+    {
+        std::lock_guard<std::mutex> guard( s_lock );
+        if( a.compare( 0, 3, "USB" ) == 0 ) present = (size_t)atoi( a.c_str() + 3 ) < s_usb.size();
+        for( size_t i = 0; i < s_ethernet.size() && !present; i++ ) present = ( s_ethernet[i] == a );
+    }
+    if( !present ){
+        s_wait( timeout );
+        return ERR_COMM_CONNECTIONFAILED;
+    }
+    s_wait( CONNECT_SECONDS );
+    std::lock_guard<std::mutex> guard( s_lock );
+    s_open++;
+    *pID = 1;
+    memset( pInfos, 0, sizeof(*pInfos) );
+    pInfos->DeviceCode       = ( a.compare( 0, 3, "USB" ) == 0 ) ? KBIO_DEV_VMP3 : KBIO_DEV_SP300;
+    pInfos->NumberOfChannels = ( pInfos->DeviceCode == KBIO_DEV_VMP3 ) ? 16 : 2;
+    return ERR_NOERROR;
+}
+
+static int BL_STDCALL s_disconnect( int ){
+    std::lock_guard<std::mutex> guard( s_lock );
+    s_open--;
+    return ERR_NOERROR;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+static void s_print( const char* name, int status, const TDiscoveryReport_t& r ){
+    printf( "%-28s %6.2f s  (USB %5.2f s, Ethernet %5.2f s)  %2d probed, %2d found, %2d cached, %d moved, %d missing%s\n",
+            name, r.Seconds / s_scale, r.UsbSeconds / s_scale, r.EthernetSeconds / s_scale,
+            r.Probed, r.Found, r.CacheHits, r.Moved, r.Missing, status == ERR_NOERROR ? "" : " FAILED" );
+}
+
+int main( int argc, char** argv )
+{
+    std::string cache = ( argc > 1 ) ? argv[1] : "discover.cache";
+    if( argc > 2 ) s_scale = atof( argv[2] ) / 1000;
+    if( cache.empty() || s_scale <= 0 ){
+        printf( "usage: %s [cache file (default discover.cache)] [ms per device second (default 20)]\n", argv[0] );
+        return 1;
+    }
+    remove( cache.c_str() );
+
+    const char* serials[4] = { "0437", "0438", "0512", "0513" };
+    for( int i = 0; i < 4; i++ ) s_usb.push_back( serials[i] );
+    std::vector<std::string> list;
+    for( int i = 0; i < 16; i++ ){
+        list.push_back( "192.109.209." + std::to_string( 220 + i ) );
+        if( i % 3 == 0 && s_ethernet.size() < 6 ) s_ethernet.push_back( list.back() );
+    }
+
+    std::unique_ptr<TEClibFunctions> eclib( new TEClibFunctions() );
+    eclib->BL_GetUSBdeviceinfos = s_getUSBdeviceinfos;
+    eclib->BL_Connect           = s_connect;
+    eclib->BL_Disconnect        = s_disconnect;
+
+    int errors = 0;
+    std::vector<TDiscoveredDevice_t> found;
+    TDiscoveryReport_t report;
+    TDiscoveryOptions_t options = DIS_DefaultOptions();
+    options.Addresses = list;
+    {
+        /* as the sample would do it */
+        DeviceDiscovery sequential( eclib.get() );
+        TDiscoveryOptions_t one = options;
+        one.Threads = 1;
+        one.Timeout = 5;
+        int status = sequential.discover( one, &found, &report );
+        s_print( "one after the other, 5 s", status, report );
+        if( status != ERR_NOERROR || report.Found != 10 ) errors++;
+    }
+
+    DeviceDiscovery first( eclib.get() );
+    int status = first.discover( options, &found, &report );
+    s_print( "all at once, 1 s", status, report );
+    if( status != ERR_NOERROR || report.Found != 10 || first.saveCache( cache ) != ERR_NOERROR ) errors++;
+    for( size_t i = 0; i < found.size(); i++ ){
+        printf( "  %-16s %-6s %-6s code %3d, %2d channels, %.2f s\n", found[i].Address.c_str(), found[i].Serial.c_str(),
+                found[i].Device.c_str(), found[i].DeviceCode, found[i].NumberOfChannels, found[i].Seconds / s_scale );
+    }
+
+    /* next run: from the cache */
+    DeviceDiscovery next( eclib.get() );
+    options.CachedOnly = true;
+    status = next.loadCache( cache );
+    if( status == ERR_NOERROR ) status = next.discover( options, &found, &report );
+    s_print( "from the cache", status, report );
+    if( status != ERR_NOERROR || report.Found != 10 || report.CacheHits != 10 || report.Missing != 0 ) errors++;
+
+    /* the USB cables swapped, an Ethernet device switched off */
+    std::swap( s_usb[0], s_usb[3] );
+    s_ethernet.pop_back();
+    status = next.discover( options, &found, &report );
+    s_print( "cables swapped, one off", status, report );
+    if( status != ERR_NOERROR || report.Found != 9 || report.Moved != 2 || report.Missing != 1 ) errors++;
+
+    /* a USB device without serial number: cached by its address, once */
+    s_usb[1].clear();
+    for( int run = 0; run < 2; run++ ) status = next.discover( options, &found, &report );
+    s_print( "no serial number, twice", status, report );
+    if( status != ERR_NOERROR || report.Found != 9 || report.CacheHits != 9 || report.Missing != 2 ) errors++;
+
+    if( s_open != 0 ){
+        printf( "%d connections not closed\n", s_open );
+        errors++;
+    }
+    remove( cache.c_str() );
+    return errors ? 4 : 0;
+}
@@ -0,0 +1,204 @@
+// eccbench.cpp : technique parameters built with EccBuilder
+//
+// usage: eccbench [iterations]
+//
+// The OCV, CA and CP parameters of the MFC sample (s_set_OcvParameters,
+// s_setCAParameters, s_setCPParameters) are built with the typed builder in a
+// reused arena, and the same way as the sample: a new[] array of a length
+// written by hand, filled by ECC_DefineXXXParameter. Both tables are compared,
+// the time per chain is printed, and the checks done at run time are shown.
+//
+// A label which is not in the schema does not compile:
+//     ca.sgl<ECC_PARAM( EccSchemaCA, "Current_step" )>( 0.002f );
+//         error: this .ecc file has no parameter with this label
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#include "EccBuilder.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double s_elapsed( Clock::time_point start ){
+    return std::chrono::duration<double>( Clock::now() - start ).count();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// as the MFC sample
+
+static int s_sampleOcv( TEccParams_t* params, int xrec ){
+    int status = ERR_NOERROR;
+    params->len = 5;
+    TEccParam_t* param_list = new TEccParam_t[params->len];
+    memset( param_list, 0, params->len * sizeof(TEccParam_t) );
+    params->pParams = param_list;
+    status |= ECC_DefineSglParameter( "Rest_time_T",     10.0f, 0,    &param_list[0] );
+    status |= ECC_DefineSglParameter( "Record_every_dE",  0.1f, 0,    &param_list[1] );
+    status |= ECC_DefineSglParameter( "Record_every_dT", 0.01f, 0,    &param_list[2] );
+    status |= ECC_DefineIntParameter( "E_Range", KBIO_ERANGE_AUTO, 0, &param_list[3] );
+    status |= ECC_DefineIntParameter( "xctr",             xrec, 0,    &param_list[4] );
+    return status;
+}
+
+static int s_sampleChrono( TEccParams_t* params, bool potentio, int xrec ){
+    static const float levels[2][3] = { { 0.002f, -0.001f, 0.004f }, { 1.5f, -1.0f, 2.0f } };
+    static const float durations[3] = { 0.1f, 0.2f, 0.1f };
+    int status = ERR_NOERROR;
+    params->len = 17;
+    TEccParam_t* param_list = new TEccParam_t[params->len];
+    memset( param_list, 0, params->len * sizeof(TEccParam_t) );
+    params->pParams = param_list;
+    for( int k = 0; k < 3; k++ ){
+        status |= ECC_DefineSglParameter ( potentio ? "Voltage_step" : "Current_step", levels[potentio][k], k, &param_list[3*k] );
+        status |= ECC_DefineBoolParameter( "vs_initial",    false,        k, &param_list[3*k + 1] );
+        status |= ECC_DefineSglParameter ( "Duration_step", durations[k], k, &param_list[3*k + 2] );
+    }
+    status |= ECC_DefineIntParameter( "Step_number", 2, 0, &param_list[9] );
+    status |= ECC_DefineIntParameter( "N_Cycles",    0, 0, &param_list[10] );
+    status |= ECC_DefineSglParameter( potentio ? "Record_every_dI" : "Record_every_dE", 0.1f, 0, &param_list[11] );
+    status |= ECC_DefineSglParameter( "Record_every_dT", 0.01f, 0, &param_list[12] );
+    status |= ECC_DefineIntParameter( "I_Range",   potentio ? KBIO_IRANGE_AUTO : KBIO_IRANGE_10mA, 0, &param_list[13] );
+    status |= ECC_DefineIntParameter( "E_Range",   KBIO_ERANGE_AUTO, 0, &param_list[14] );
+    status |= ECC_DefineIntParameter( "Bandwidth", KBIO_BW_5, 0, &param_list[15] );
+    status |= ECC_DefineIntParameter( "xctr",      xrec, 0, &param_list[16] );
+    return status;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// with the builder
+
+static int s_buildOcv( EccArena& arena, TEccParams_t* params, int xrec ){
+    typedef EccSchemaOCV S;
+    EccBuilder<S> ocv( arena );
+    ocv.sgl<ECC_PARAM( S, "Rest_time_T" )>    ( 10.0f )
+       .sgl<ECC_PARAM( S, "Record_every_dE" )>( 0.1f )
+       .sgl<ECC_PARAM( S, "Record_every_dT" )>( 0.01f )
+       .num<ECC_PARAM( S, "E_Range" )>        ( KBIO_ERANGE_AUTO )
+       .num<ECC_PARAM( S, "xctr" )>           ( xrec );
+    return ocv.params( params );
+}
+
+static int s_buildCa( EccArena& arena, TEccParams_t* params, int xrec ){
+    typedef EccSchemaCA S;
+    static const float levels[3]    = { 1.5f, -1.0f, 2.0f };
+    static const float durations[3] = { 0.1f, 0.2f, 0.1f };
+    EccBuilder<S> ca( arena );
+    for( int k = 0; k < 3; k++ ){
+        ca.sgl <ECC_PARAM( S, "Voltage_step" )> ( levels[k], k )
+          .flag<ECC_PARAM( S, "vs_initial" )>   ( false, k )
+          .sgl <ECC_PARAM( S, "Duration_step" )>( durations[k], k );
+    }
+    ca.num<ECC_PARAM( S, "Step_number" )>    ( 2 )
+      .num<ECC_PARAM( S, "N_Cycles" )>       ( 0 )
+      .sgl<ECC_PARAM( S, "Record_every_dI" )>( 0.1f )
+      .sgl<ECC_PARAM( S, "Record_every_dT" )>( 0.01f )
+      .num<ECC_PARAM( S, "I_Range" )>        ( KBIO_IRANGE_AUTO )
+      .num<ECC_PARAM( S, "E_Range" )>        ( KBIO_ERANGE_AUTO )
+      .num<ECC_PARAM( S, "Bandwidth" )>      ( KBIO_BW_5 )
+      .num<ECC_PARAM( S, "xctr" )>           ( xrec );
+    return ca.params( params );
+}
+
+static int s_buildCp( EccArena& arena, TEccParams_t* params, int xrec ){
+    typedef EccSchemaCP S;
+    static const float levels[3]    = { 0.002f, -0.001f, 0.004f };
+    static const float durations[3] = { 0.1f, 0.2f, 0.1f };
+    EccBuilder<S> cp( arena );
+    for( int k = 0; k < 3; k++ ){
+        cp.sgl <ECC_PARAM( S, "Current_step" )> ( levels[k], k )
+          .flag<ECC_PARAM( S, "vs_initial" )>   ( false, k )
+          .sgl <ECC_PARAM( S, "Duration_step" )>( durations[k], k );
+    }
+    cp.num<ECC_PARAM( S, "Step_number" )>    ( 2 )
+      .num<ECC_PARAM( S, "N_Cycles" )>       ( 0 )
+      .sgl<ECC_PARAM( S, "Record_every_dE" )>( 0.1f )
+      .sgl<ECC_PARAM( S, "Record_every_dT" )>( 0.01f )
+      .num<ECC_PARAM( S, "I_Range" )>        ( KBIO_IRANGE_10mA )
+      .num<ECC_PARAM( S, "E_Range" )>        ( KBIO_ERANGE_AUTO )
+      .num<ECC_PARAM( S, "Bandwidth" )>      ( KBIO_BW_5 )
+      .num<ECC_PARAM( S, "xctr" )>           ( xrec );
+    return cp.params( params );
+}
+
+static bool s_same( const TEccParams_t& a, const TEccParams_t& b ){
+    return a.len == b.len && memcmp( a.pParams, b.pParams, a.len * sizeof(TEccParam_t) ) == 0;
+}
+
+int main( int argc, char** argv )
+{
+    long iterations = ( argc > 1 ) ? atol( argv[1] ) : 1000000;
+    if( iterations <= 0 ){
+        printf( "usage: %s [iterations (default 1000000)]\n", argv[0] );
+        return 1;
+    }
+    int errors = 0;
+    int xrec = 0;
+
+    /* same tables as the sample */
+    EccArena arena;
+    TEccParams_t built[3], sample[3];
+    int status = s_buildOcv( arena, &built[0], xrec ) | s_buildCa( arena, &built[1], xrec ) | s_buildCp( arena, &built[2], xrec );
+    status |= s_sampleOcv( &sample[0], xrec ) | s_sampleChrono( &sample[1], true, xrec ) | s_sampleChrono( &sample[2], false, xrec );
+    const char* names[3] = { "OCV", "CA", "CP" };
+    for( int t = 0; t < 3; t++ ){
+        bool same = status == ERR_NOERROR && s_same( built[t], sample[t] );
+        printf( "%-3s: %2d parameters, %s\n", names[t], built[t].len, same ? "same as the sample" : "DIFFERENT" );
+        if( !same ) errors++;
+        delete[] sample[t].pParams;
+    }
+    printf( "OCV + CA + CP chain: %zu parameters in the arena\n", arena.used() );
+
+    /* a chain OCV + CA + CP, built again and again */
+    Clock::time_point start = Clock::now();
+    for( long i = 0; i < iterations; i++ ){
+        arena.reset();
+        status |= s_buildOcv( arena, &built[0], xrec ) | s_buildCa( arena, &built[1], xrec ) | s_buildCp( arena, &built[2], xrec );
+    }
+    double t_builder = s_elapsed( start );
+
+    start = Clock::now();
+    for( long i = 0; i < iterations; i++ ){
+        status |= s_sampleOcv( &sample[0], xrec ) | s_sampleChrono( &sample[1], true, xrec ) | s_sampleChrono( &sample[2], false, xrec );
+        for( int t = 0; t < 3; t++ ) delete[] sample[t].pParams;
+    }
+    double t_sample = s_elapsed( start );
+    if( status != ERR_NOERROR ) errors++;
+    printf( "chain: builder in an arena %.1f ns, new[] + ECC_DefineXXXParameter %.1f ns\n",
+            t_builder * 1e9 / iterations, t_sample * 1e9 / iterations );
+
+    /* what is checked at run time */
+    {
+        typedef EccSchemaCA S;
+        TEccParams_t params;
+        EccArena small( 4 );
+
+        arena.reset();
+        EccBuilder<S> twice( arena );
+        twice.num<ECC_PARAM( S, "N_Cycles" )>( 0 ).num<ECC_PARAM( S, "N_Cycles" )>( 1 );
+        EccBuilder<S> index( arena );
+        index.sgl<ECC_PARAM( S, "Record_every_dI" )>( 0.1f, 1 );
+        EccBuilder<S> steps( arena );
+        steps.sgl<ECC_PARAM( S, "Voltage_step" )>( 0.0f, ECC_MAX_STEPS );
+        EccBuilder<S> full( small );
+        for( int k = 0; k < 3; k++ ) full.sgl<ECC_PARAM( S, "Voltage_step" )>( 0.0f, k ).sgl<ECC_PARAM( S, "Duration_step" )>( 1.0f, k );
+
+        arena.reset();
+        EccBuilder<S> first( arena );
+        EccBuilder<S> second( arena );
+        first.num<ECC_PARAM( S, "N_Cycles" )>( 0 );
+        second.num<ECC_PARAM( S, "N_Cycles" )>( 0 );
+        first.num<ECC_PARAM( S, "Step_number" )>( 0 );
+        if( first.params( &params ) != ERR_NOERROR ) errors++;
+
+        int results[5] = { twice.params( &params ), index.params( &params ), steps.params( &params ), full.params( &params ), second.params( &params ) };
+        const char* cases[5] = { "defined twice", "index of a single value", "step out of range", "arena full", "two builders on one arena" };
+        for( int c = 0; c < 5; c++ ){
+            printf( "%-26s -> %s\n", cases[c], results[c] == ERR_GEN_INVALIDPARAMETERS ? "rejected" : "ACCEPTED" );
+            if( results[c] != ERR_GEN_INVALIDPARAMETERS ) errors++;
+        }
+    }
+    return errors ? 4 : 0;
+}
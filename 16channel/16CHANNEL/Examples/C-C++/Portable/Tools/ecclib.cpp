@@ -0,0 +1,145 @@
+// ecclib.cpp : index of the .ecc files of the development package
+//
+// usage: ecclib [ecc folder] [lookups] [work folder]
+//
+// The folder of the .ecc files is found as ECC_FindPackageDir does (the
+// ECLAB_PACKAGE_DIR variable, or an "EC-Lab Development Package" folder above the
+// current one) unless given. It is scanned into an EccLibrary; the techniques
+// which exist for one device family only are listed, and the time to get a file
+// from the library is compared with reading it from the disk as ECLib does on
+// each BL_LoadTechnique. Then, in a work folder, a few files are copied, changed,
+// removed and added, to check that the library notices it.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "EccLibrary.h"
+#include "FileUtils.h"
+#include "MappedFile.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double s_elapsed( Clock::time_point start ){
+    return std::chrono::duration<double>( Clock::now() - start ).count();
+}
+
+static bool s_write( const std::string& path, const std::vector<unsigned char>& content ){
+    FILE* f = fopen( path.c_str(), "wb" );
+    if( !f ) return false;
+    bool ok = fwrite( content.data(), 1, content.size(), f ) == content.size();
+    return fclose( f ) == 0 && ok;
+}
+
+int main( int argc, char** argv )
+{
+    std::string dir;
+    long lookups     = ( argc > 2 ) ? atol( argv[2] ) : 100000;
+    std::string work = ( argc > 3 ) ? argv[3] : "ecclib_work";
+    int status = ( argc > 1 && argv[1][0] ) ? ( dir = argv[1], ERR_NOERROR ) : ECC_FindPackageDir( 0, &dir );
+    if( status != ERR_NOERROR || lookups <= 0 ){
+        printf( "usage: %s [ecc folder (default: found from the current folder)] [lookups (default 100000)] [work folder]\n", argv[0] );
+        return 1;
+    }
+
+    EccLibrary library;
+    Clock::time_point start = Clock::now();
+    status = library.open( dir );
+    double t_scan = s_elapsed( start );
+    if( status != ERR_NOERROR ){
+        printf( "Cannot scan '%s': error %d\n", dir.c_str(), status );
+        return 2;
+    }
+    TEccLibraryStats_t st = library.stats();
+    printf( "%s: %llu .ecc files, %.1f KB, scanned in %.2f ms\n", library.dir().c_str(), st.Files, st.BytesRead / 1024.0, t_scan * 1e3 );
+
+    /* techniques of one family only */
+    std::vector<std::string> names = library.names();
+    std::string vmp3_only, vmp4_only;
+    for( size_t i = 0; i < names.size(); i++ ){
+        std::string base = names[i].substr( 0, names[i].size() - 4 );
+        bool four = base.size() > 1 && base[base.size() - 1] == '4';
+        std::string other = four ? base.substr( 0, base.size() - 1 ) : base;
+        TEccFile_t file;
+        if( !four && library.technique( other.c_str(), true, &file ) != ERR_NOERROR ) vmp3_only += " " + names[i];
+        if( four && library.technique( other.c_str(), false, &file ) != ERR_NOERROR ) vmp4_only += " " + names[i];
+    }
+    printf( "VMP3 series only:%s\nVMP4 technology only:%s\n", vmp3_only.c_str(), vmp4_only.empty() ? " -" : vmp4_only.c_str() );
+
+    /* from memory, and from the disk */
+    static const char* bases[4] = { "ocv", "ca", "cp", "cv" };
+    int errors = 0;
+    TEccFile_t file;
+    unsigned int sum = 0;
+    start = Clock::now();
+    for( long i = 0; i < lookups; i++ ){
+        if( library.technique( bases[i % 4], ( i / 4 ) % 2 != 0, &file ) != ERR_NOERROR ) errors++;
+        sum += file.Crc;
+    }
+    double t_memory = s_elapsed( start );
+    long reads = lookups < 10000 ? lookups : 10000;
+    start = Clock::now();
+    for( long i = 0; i < reads; i++ ){
+        MappedFile mapped;
+        std::string path = library.dir() + "/" + bases[i % 4] + ( ( i / 4 ) % 2 ? "4.ecc" : ".ecc" );
+        if( mapped.open( path.c_str() ) != ERR_NOERROR ) errors++;
+        else sum += CRC32_Compute( mapped.data(), mapped.size() );
+    }
+    double t_disk = s_elapsed( start );
+    st = library.stats();
+    printf( "get a file: from the library %.2f us (%llu checks on the disk), read from the disk %.2f us (checksum %08x)\n",
+            t_memory * 1e6 / lookups, st.Checks, t_disk * 1e6 / reads, sum );
+
+    /* changes on the disk */
+    std::vector<std::string> dummy;
+    if( FILE_ListDir( work.c_str(), dummy ) != ERR_NOERROR ){
+#ifdef _WIN32
+        std::string cmd = "mkdir \"" + work + "\"";
+#else
+        std::string cmd = "mkdir -p '" + work + "'";
+#endif
+        if( system( cmd.c_str() ) != 0 ){
+            printf( "Cannot create the work folder '%s'\n", work.c_str() );
+            return 2;
+        }
+    }
+    TEccFile_t ocv, ca;
+    library.technique( "ocv", false, &ocv );
+    library.technique( "ca", false, &ca );
+    std::vector<unsigned char> changed( *ocv.Content );
+    changed.push_back( 0 );
+    remove( ( work + "/cp.ecc" ).c_str() );
+    if( !s_write( work + "/ocv.ecc", *ocv.Content ) || !s_write( work + "/ca.ecc", *ca.Content ) ){
+        printf( "Cannot write in the work folder '%s'\n", work.c_str() );
+        return 2;
+    }
+
+    EccLibrary copy;
+    copy.setCheckInterval( 0 );
+    TEccFile_t before, after;
+    int changes = 0;
+    bool ok = copy.open( work ) == ERR_NOERROR && copy.file( "OCV.ECC", &before ) == ERR_NOERROR && before.Crc == ocv.Crc;
+    printf( "%-30s %s\n", "same content as the package", ok ? "ok" : "FAILED" );
+    errors += !ok;
+
+    std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+    ok = s_write( work + "/ocv.ecc", changed ) && copy.file( "ocv.ecc", &after ) == ERR_NOERROR
+      && after.Crc != before.Crc && after.Size == before.Size + 1 && copy.stats().Reloads == 1;
+    printf( "%-30s %s\n", "changed file read again", ok ? "ok" : "FAILED" );
+    errors += !ok;
+
+    ok = remove( ( work + "/ca.ecc" ).c_str() ) == 0 && copy.file( "ca.ecc", &after ) == ERR_TECH_ECCFILENOTEXISTS;
+    printf( "%-30s %s\n", "removed file not served", ok ? "ok" : "FAILED" );
+    errors += !ok;
+
+    ok = s_write( work + "/cp.ecc", *ca.Content ) && copy.refresh( &changes ) == ERR_NOERROR
+      && changes == 1 && copy.file( "cp.ecc", &after ) == ERR_NOERROR;
+    printf( "%-30s %s\n", "added file found by refresh", ok ? "ok" : "FAILED" );
+    errors += !ok;
+    return errors ? 4 : 0;
+}
@@ -0,0 +1,180 @@
+// fwstartup.cpp : firmware of the channels at startup, loaded only where needed
+//
+// usage: fwstartup [channels] [load ms]
+//
+// The startup of the MFC sample (BL_LoadFirmware on every plugged channel, forced)
+// is compared with FW_SetupChannels, which reads the firmware of all the channels
+// first and loads only the stale ones. No instrument is needed: the functions of
+// ECLib are replaced by a simulated device where a part of the channels already
+// runs the kernel, others the EC-Lab firmware, an older kernel or nothing. Loading
+// a channel takes 'load ms', a quarter of it on the link shared by the channels.
+// The time of each phase and of each channel is printed.
+//
+// The numbers of the simulated device are not those of an instrument; the point
+// is the number of channels loaded and what can overlap.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "FirmwareSetup.h"
+
+#define KERNEL_VERSION  (1105)
+#define XILINX_VERSION  (437)
+
+/////////////////////////////////////////////////////////////////////////////
+// simulated device
+
+static std::mutex       s_link;                 /* transfers on the link, one at a time */
+static std::mutex       s_lock;
+static int              s_channels  = 16;
+static double           s_load      = 0.200;
+static int              s_loaded    = 0;        /* channels loaded by the last startup */
+static TChannelInfos_t  s_infos[16];
+
+static void s_wait( double seconds ){
+    std::this_thread::sleep_for( std::chrono::duration<double>( seconds ) );
+}
+
+/* channel 0 and every third channel run the kernel, then EC-Lab, nothing, and an older kernel */
+static void s_resetDevice(){
+    std::lock_guard<std::mutex> guard( s_lock );
+    for( int ch = 0; ch < 16; ch++ ){
+        memset( &s_infos[ch], 0, sizeof(s_infos[ch]) );
+        s_infos[ch].Channel         = ch;
+        s_infos[ch].BoardVersion    = 3;
+        s_infos[ch].FirmwareCode    = KIBIO_FIRM_KERNEL;
+        s_infos[ch].FirmwareVersion = KERNEL_VERSION;
+        s_infos[ch].XilinxVersion   = XILINX_VERSION;
+        switch( ch % 6 ){
+            case 1: s_infos[ch].FirmwareCode = KIBIO_FIRM_INTERPR; break;
+            case 2: s_infos[ch].FirmwareCode = KIBIO_FIRM_NONE; s_infos[ch].FirmwareVersion = 0; s_infos[ch].XilinxVersion = 0; break;
+            case 4: s_infos[ch].FirmwareVersion = KERNEL_VERSION - 5; break;
+            default: break;
+        }
+    }
+}
+
+static int BL_STDCALL s_getChannelsPlugged( int, uint8* pChPlugged, uint8 Size ){
+    s_wait( 0.002 );
+    for( int ch = 0; ch < Size; ch++ ) pChPlugged[ch] = ( ch < s_channels ) ? 1 : 0;
+    return ERR_NOERROR;
+}
+
+static int BL_STDCALL s_getChannelInfos( int, uint8 ch, TChannelInfos_t* pInfos ){
+    if( ch >= s_channels ) return ERR_GEN_CHANNELNOTPLUGGED;
+    {
+        std::lock_guard<std::mutex> link( s_link );
+        s_wait( 0.001 );
+    }
+    s_wait( 0.002 );
+    std::lock_guard<std::mutex> guard( s_lock );
+    *pInfos = s_infos[ch];
+    return ERR_NOERROR;
+}
+
+/* the channels of a call are loaded one after the other */
+static int BL_STDCALL s_loadFirmware( int, uint8* pChannels, int* pResults, uint8 Length, bool, bool ForceReload, const char*, const char* ){
+    for( int ch = 0; ch < Length; ch++ ){
+        if( !pChannels[ch] ) continue;
+        if( ch >= s_channels ){
+            pResults[ch] = ERR_GEN_CHANNELNOTPLUGGED;
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> guard( s_lock );
+            if( !ForceReload && s_infos[ch].FirmwareCode == KIBIO_FIRM_KERNEL ){
+                pResults[ch] = ERR_NOERROR;
+                continue;
+            }
+        }
+        {
+            std::lock_guard<std::mutex> link( s_link );
+            s_wait( s_load * 0.25 );
+        }
+        s_wait( s_load * 0.75 );
+        std::lock_guard<std::mutex> guard( s_lock );
+        s_infos[ch].FirmwareCode    = KIBIO_FIRM_KERNEL;
+        s_infos[ch].FirmwareVersion = KERNEL_VERSION;
+        s_infos[ch].XilinxVersion   = XILINX_VERSION;
+        s_loaded++;
+        pResults[ch] = ERR_NOERROR;
+    }
+    return ERR_NOERROR;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+static const char* s_reasons( int stale ){
+    static char text[64];
+    text[0] = 0;
+    if( stale & FW_STALE_CODE )    strcat( text, " firmware" );
+    if( stale & FW_STALE_VERSION ) strcat( text, " version" );
+    if( stale & FW_STALE_XILINX )  strcat( text, " xilinx" );
+    if( stale & FW_STALE_INFOS )   strcat( text, " infos" );
+    if( stale & FW_STALE_FORCED )  strcat( text, " forced" );
+    return text[0] ? text + 1 : "current";
+}
+
+static int s_run( const TEClibFunctions* eclib, const char* name, const TFirmwareOptions_t& options, bool reset, TFirmwareReport_t* report ){
+    if( reset ) s_resetDevice();
+    s_loaded = 0;
+    int status = FW_SetupChannels( eclib, 1, options, report );
+    printf( "%-32s %7.1f ms  plugged %5.1f  infos %5.1f  load %7.1f  verify %5.1f  (%d/%d channels loaded, error %d)\n",
+            name, report->TotalSeconds * 1e3, report->PluggedSeconds * 1e3, report->InfosSeconds * 1e3,
+            report->LoadSeconds * 1e3, report->VerifySeconds * 1e3, s_loaded, report->Plugged, status );
+    return status;
+}
+
+int main( int argc, char** argv )
+{
+    if( argc > 1 ) s_channels = atoi( argv[1] );
+    if( argc > 2 ) s_load     = atof( argv[2] ) / 1000;
+    if( s_channels < 1 || s_channels > 16 || s_load < 0 ){
+        printf( "usage: %s [channels 1..16 (default 16)] [load ms (default 200)]\n", argv[0] );
+        return 1;
+    }
+
+    std::unique_ptr<TEClibFunctions> eclib( new TEClibFunctions() );
+    eclib->BL_GetChannelsPlugged = s_getChannelsPlugged;
+    eclib->BL_GetChannelInfos    = s_getChannelInfos;
+    eclib->BL_LoadFirmware       = s_loadFirmware;
+
+    int errors = 0;
+    TFirmwareReport_t report;
+    TFirmwareOptions_t forced = FW_DefaultOptions();
+    forced.Force = true;
+    if( s_run( eclib.get(), "forced reload (MFC sample)", forced, true, &report ) != ERR_NOERROR || s_loaded != s_channels ) errors++;
+
+    TFirmwareOptions_t options = FW_DefaultOptions();
+    options.FirmwareVersion = KERNEL_VERSION;
+    options.XilinxVersion   = XILINX_VERSION;
+    int expected = 0;
+    for( int ch = 0; ch < s_channels; ch++ ) expected += ( ch % 6 == 1 || ch % 6 == 2 || ch % 6 == 4 );
+    if( s_run( eclib.get(), "stale only, one call", options, true, &report ) != ERR_NOERROR
+        || s_loaded != expected || report.Stale != expected ) errors++;
+
+    printf( "  channel  firmware       infos ms  load ms  result\n" );
+    for( size_t i = 0; i < report.Channels.size(); i++ ){
+        const TChannelStartup_t& c = report.Channels[i];
+        printf( "  %7d  %-13s %9.1f %8.1f  %d\n", c.Channel, s_reasons( c.Stale ), c.InfoSeconds * 1e3, c.LoadSeconds * 1e3, c.Result );
+    }
+
+    options.Threads = 4;
+    if( s_run( eclib.get(), "stale only, 4 threads", options, true, &report ) != ERR_NOERROR || s_loaded != expected ) errors++;
+
+    /* everything is current now */
+    options.Threads = 0;
+    if( s_run( eclib.get(), "second startup", options, false, &report ) != ERR_NOERROR || s_loaded != 0 || report.Stale != 0 ) errors++;
+
+    /* a version which cannot be loaded is reported on each channel */
+    options.FirmwareVersion = KERNEL_VERSION + 1;
+    int status = s_run( eclib.get(), "unreachable kernel version", options, false, &report );
+    if( status != ERR_COMM_LOADFIRMWAREFAILED || report.Failed != s_channels ) errors++;
+    return errors ? 4 : 0;
+}
@@ -0,0 +1,229 @@
+// jnlbench.cpp : cost of the acquisition journal and replay after a crash
+//
+// usage: jnlbench [buffers per channel] [channels] [journal.ejnl]
+//
+// One thread per channel appends CA data buffers to a journal, as the data
+// threads of the MFC sample receive them from BL_GetData. The time spent in
+// JournalWriter::append is measured for each buffer, with the group commit
+// and with a sync as soon as possible. The journal is then cut in the middle
+// of a record, as by a crash, replayed into a capture file and checked, and
+// continued after the cut.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CaptureFile.h"
+#include "Journal.h"
+
+typedef std::chrono::steady_clock Clock;
+
+#define ROWS_PER_BUFFER (200) /* 200 rows x 5 words, a full CA buffer */
+#define TIME_BASE       (2e-5)
+
+static double s_elapsed( Clock::time_point start ){
+    return std::chrono::duration<double>( Clock::now() - start ).count();
+}
+
+static unsigned int s_word( float v ){
+    unsigned int w;
+    memcpy( &w, &v, sizeof(w) );
+    return w;
+}
+
+static float s_ewe( int ch, size_t k ) { return 0.5f + 0.001f * (float)( ( k + ch ) % 1000 ); }
+static float s_i( size_t k )           { return ( k % 2 ? 1.0f : -1.0f ) * 1e-4f * (float)( k % 97 ); }
+
+/* fills a CA data buffer with the points [first, first+n) of a channel */
+static void s_makeBuffer( int ch, size_t first, TDataBuffer_t* buf, TDataInfos_t* infos ){
+    memset( infos, 0, sizeof(*infos) );
+    infos->TechniqueID = KBIO_TECHID_CA;
+    infos->NbRows      = ROWS_PER_BUFFER;
+    infos->NbCols      = 5;
+    for( int i = 0; i < ROWS_PER_BUFFER; i++ ){
+        size_t k = first + i;
+        unsigned long long t = (unsigned long long)k * 50; /* 1 ms per point */
+        unsigned int* row = &buf->data[i * 5];
+        row[0] = (unsigned int)( t >> 32 );
+        row[1] = (unsigned int)t;
+        row[2] = s_word( s_ewe( ch, k ) );
+        row[3] = s_word( s_i( k ) );
+        row[4] = (unsigned int)( k / 1000 );
+    }
+}
+
+/* appends 'buffers' buffers per channel, one thread per channel, to 'jnl' if not null; sorted append times (s) */
+static int s_run( JournalWriter* jnl, int channels, size_t first, size_t buffers, std::vector<double>& times ){
+    std::vector< std::vector<double> > per_channel( channels );
+    std::vector<int> status( channels, ERR_NOERROR );
+    std::vector<std::thread> threads;
+    for( int ch = 0; ch < channels; ch++ ){
+        threads.push_back( std::thread( [&, ch](){
+            TDataBuffer_t    buf;
+            TDataInfos_t     infos;
+            TCurrentValues_t curr;
+            memset( &curr, 0, sizeof(curr) );
+            curr.TimeBase = (float)TIME_BASE;
+            per_channel[ch].reserve( buffers );
+            for( size_t b = 0; b < buffers && status[ch] == ERR_NOERROR; b++ ){
+                s_makeBuffer( ch, ( first + b ) * ROWS_PER_BUFFER, &buf, &infos );
+                Clock::time_point start = Clock::now();
+                status[ch] = jnl ? jnl->append( ch, buf, infos, curr, false, 0 ) : ERR_NOERROR;
+                per_channel[ch].push_back( s_elapsed( start ) );
+                /* a buffer every ~200 us per channel: faster than any technique records */
+                std::this_thread::sleep_for( std::chrono::microseconds( 200 ) );
+            }
+        } ) );
+    }
+    for( size_t i = 0; i < threads.size(); i++ ) threads[i].join();
+
+    times.clear();
+    int result = ERR_NOERROR;
+    for( int ch = 0; ch < channels; ch++ ){
+        times.insert( times.end(), per_channel[ch].begin(), per_channel[ch].end() );
+        if( status[ch] != ERR_NOERROR ) result = status[ch];
+    }
+    std::sort( times.begin(), times.end() );
+    return result;
+}
+
+static void s_report( const char* name, const std::vector<double>& times, const TJournalStats_t& st, double t ){
+    if( times.empty() ) return;
+    printf( "%-14s append p50 %.2f us, p99 %.2f us, max %.1f us; %llu syncs (%.0f/s), %.1f KB per group (max %.1f KB), %llu stalls\n",
+            name, times[times.size() / 2] * 1e6, times[times.size() * 99 / 100] * 1e6, times.back() * 1e6,
+            st.Syncs, st.Syncs / t, st.Syncs ? st.Bytes / 1024.0 / st.Syncs : 0.0, st.MaxGroup / 1024.0, st.Stalls );
+}
+
+/* checks the points of a capture file rebuilt from the journal; returns the number of points, or -1 */
+static long long s_verify( const char* path, int channels ){
+    CaptureReader r;
+    if( r.open( path ) != ERR_NOERROR ) return -1;
+    std::vector<size_t> next( channels, 0 );
+    TCapChunk_t c;
+    long long points = 0;
+    for( size_t i = 0; i < r.chunkCount(); i++ ){
+        if( r.readChunk( i, c ) != ERR_NOERROR || c.Channel >= channels ) return -1;
+        for( size_t row = 0; row < c.Time.size(); row++ ){
+            size_t k = next[c.Channel]++;
+            if( c.Time[row] != (double)(float)TIME_BASE * (double)( k * 50 ) || c.Ewe[row] != s_ewe( c.Channel, k )
+                || c.I[row] != s_i( k ) || c.Cycle[row] != k / 1000 ){
+                printf( "  channel %d, point %zu differs\n", c.Channel, k );
+                return -1;
+            }
+            points++;
+        }
+    }
+    return points;
+}
+
+int main( int argc, char** argv )
+{
+    size_t      buffers  = ( argc > 1 ) ? strtoul( argv[1], 0, 10 ) : 5000;
+    int         channels = ( argc > 2 ) ? atoi( argv[2] ) : 16;
+    const char* output   = ( argc > 3 ) ? argv[3] : "jnlbench.ejnl";
+    if( channels < 1 || channels > CAP_MAX_CHANNELS || buffers == 0 ){
+        printf( "usage: %s [buffers per channel (default 5000)] [channels (default 16)] [journal.ejnl]\n", argv[0] );
+        return 1;
+    }
+
+    int errors = 0;
+    std::vector<double> times;
+
+    /* reference: the same threads without journal, the times are those of the scheduler */
+    {
+        Clock::time_point start = Clock::now();
+        s_run( 0, channels, 0, buffers, times );
+        printf( "%d channels x %zu buffers of %d points, %.1f s of acquisition\n",
+                channels, buffers, ROWS_PER_BUFFER, s_elapsed( start ) );
+        printf( "%-14s append p50 %.2f us, p99 %.2f us, max %.1f us\n", "no journal",
+                times[times.size() / 2] * 1e6, times[times.size() * 99 / 100] * 1e6, times.back() * 1e6 );
+    }
+
+    /* sync as soon as possible, then group commit */
+    unsigned int intervals[] = { 0, JNL_GROUP_INTERVAL_MS };
+    const char*  names[]     = { "sync asap", "group commit" };
+    for( int m = 0; m < 2; m++ ){
+        JournalWriter jnl;
+        jnl.setGroupCommit( intervals[m], JNL_GROUP_BYTES );
+        Clock::time_point start = Clock::now();
+        int status = jnl.open( output );
+        if( status == ERR_NOERROR ) status = s_run( &jnl, channels, 0, buffers, times );
+        TJournalStats_t st = jnl.stats();
+        if( status == ERR_NOERROR ) status = jnl.close();
+        double t = s_elapsed( start );
+        if( status != ERR_NOERROR ){
+            printf( "Cannot write '%s' (error %d)\n", output, status );
+            return 2;
+        }
+        s_report( names[m], times, st, t );
+    }
+
+    /* crash: the journal cut in the middle of a record */
+    std::string cut_path = std::string( output ) + ".cut";
+    std::string cap_path = std::string( output ) + ".ecap";
+    size_t records = 0;
+    {
+        MappedFile whole;
+        whole.open( output );
+        std::vector<unsigned char> copy( whole.data(), whole.data() + whole.size() - 1000 );
+        whole.close();
+        FILE* f = fopen( cut_path.c_str(), "wb" );
+        if( f ){
+            fwrite( &copy[0], 1, copy.size(), f );
+            fclose( f );
+        }
+    }
+    {
+        CaptureWriter store;
+        TJournalReplay_t replay;
+        Clock::time_point start = Clock::now();
+        int status = store.open( cap_path.c_str() );
+        if( status == ERR_NOERROR ) status = JNL_Replay( cut_path.c_str(), store, &replay );
+        if( status == ERR_NOERROR ) status = store.close();
+        double t = s_elapsed( start );
+        long long points = status == ERR_NOERROR ? s_verify( cap_path.c_str(), channels ) : -1;
+        records = (size_t)replay.Records;
+        bool ok = status == ERR_NOERROR && replay.Truncated && replay.Skipped == 0 && replay.Records == (size_t)channels * buffers - 1
+                  && points == (long long)replay.Points;
+        printf( "replay of the cut journal: %llu records, %llu points in %.3f s (%.1f Mpoints/s), %s\n",
+                replay.Records, replay.Points, t, replay.Points / t / 1e6, ok ? "ok" : "FAILED" );
+        if( !ok ) errors++;
+    }
+
+    /* restart: the cut record is dropped and the sequence goes on */
+    {
+        JournalWriter jnl;
+        int status = jnl.open( cut_path.c_str(), true );
+        TDataBuffer_t    buf;
+        TDataInfos_t     infos;
+        TCurrentValues_t curr;
+        memset( &curr, 0, sizeof(curr) );
+        curr.TimeBase = (float)TIME_BASE;
+        s_makeBuffer( 0, 0, &buf, &infos );
+        unsigned long long seq = 0;
+        if( status == ERR_NOERROR ) status = jnl.append( 0, buf, infos, curr, false, 0, &seq );
+        if( status == ERR_NOERROR ) status = jnl.waitDurable( seq );
+        /* a record not appended yet is refused, instead of waited for ever */
+        if( status == ERR_NOERROR && jnl.waitDurable( seq + 1 ) != ERR_GEN_INVALIDPARAMETERS ) status = ERR_GEN_FUNCTIONFAILED;
+        if( status == ERR_NOERROR ) status = jnl.close();
+
+        JournalReader r;
+        TJournalRecord_t* rec = new TJournalRecord_t;
+        size_t n = 0;
+        if( status == ERR_NOERROR ) status = r.open( cut_path.c_str() );
+        while( status == ERR_NOERROR && r.next( *rec ) ) n++;
+        bool ok = status == ERR_NOERROR && !r.isTruncated() && n == records + 1 && seq == records + 1 && rec->Sequence == seq;
+        printf( "restart after the crash: %zu records, %s\n", n, ok ? "ok" : "FAILED" );
+        if( !ok ) errors++;
+        delete rec;
+    }
+    remove( cut_path.c_str() );
+    remove( cap_path.c_str() );
+    return errors ? 4 : 0;
+}
@@ -0,0 +1,159 @@
+// linkmon.cpp : health of the link probed with BL_TestCommSpeed
+//
+// usage: linkmon [seconds of degradation]
+//
+// Four channels of a simulated device are polled every 10 ms while a
+// LinkMonitor probes them between the polls. The round trips reported by
+// BL_TestCommSpeed are those of a link which is fine for a second, then slows
+// down to 3/4 of the time-out of ECLib (15 s) in 'seconds of degradation', then
+// fails. The monitor must report the degradation before the round trip
+// reaches the warning level, then the critical level, then the failure; no
+// probe made in a free slot may fall in a poll.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "InstrumentSim.h"
+#include "LinkMonitor.h"
+
+typedef std::chrono::steady_clock Clock;
+
+#define NB_CHANNELS  (4)
+#define POLL_MS      (10)
+#define HEALTHY_S    (1.0)
+
+static const char* s_health[] = { "OK", "DEGRADED", "CRITICAL", "DOWN" };
+static const char* s_cause[]  = { "", "link", "host" };
+
+static Clock::time_point  s_start;
+static double             s_degradation = 2.0;
+static BL_TESTCOMMSPEED_FP s_testCommSpeed = 0;
+static std::atomic<bool>  s_polling( false );
+static std::atomic<int>   s_overlaps( 0 );
+
+typedef struct {
+    double Time;
+    double RoundTrip;  /* of the link when the alert was raised */
+    TLinkChannelHealth_t Health;
+} TAlert_t;
+
+static std::mutex            s_lock;
+static std::vector<TAlert_t> s_alerts;
+
+static double s_elapsed(){
+    return std::chrono::duration<double>( Clock::now() - s_start ).count();
+}
+
+/* round trip to a channel of the simulated link at a time (ms), < 0 once it failed */
+static double s_roundTrip( double t ){
+    if( t < HEALTHY_S ) return 4.0;
+    if( t < HEALTHY_S + s_degradation ) return 4.0 + ( t - HEALTHY_S ) / s_degradation * ( LNK_FAILURE_MS * 3 / 4 );
+    return -1.0;
+}
+
+static int BL_STDCALL s_degradingCommSpeed( int ID, uint8 channel, int* spd_rcvt, int* spd_kernel ){
+    if( s_polling ) s_overlaps++;
+    int status = s_testCommSpeed( ID, channel, spd_rcvt, spd_kernel );
+    double rtt = s_roundTrip( s_elapsed() );
+    if( status != ERR_NOERROR ) return status;
+    if( rtt < 0.0 ) return ERR_COMM_COMMFAILED;
+    *spd_rcvt   = (int)( rtt / 2 );
+    *spd_kernel = (int)rtt + ( channel % 2 );
+    return ERR_NOERROR;
+}
+
+static void s_alert( void*, const TLinkChannelHealth_t& health ){
+    double t = s_elapsed();
+    TAlert_t alert = { t, s_roundTrip( t ), health };
+    std::lock_guard<std::mutex> guard( s_lock );
+    s_alerts.push_back( alert );
+}
+
+int main( int argc, char** argv )
+{
+    s_degradation = ( argc > 1 ) ? atof( argv[1] ) : 2.0;
+    if( s_degradation < 0.5 || s_degradation > 60.0 ){
+        printf( "usage: %s [seconds of degradation 0.5..60 (default 2)]\n", argv[0] );
+        return 1;
+    }
+
+    TSimConfig_t config = SIM_DefaultConfig();
+    config.Channels = NB_CHANNELS;
+    TEClibFunctions eclib;
+    int id = -1;
+    TDeviceInfos_t infos;
+    if( SIM_Configure( config ) != ERR_NOERROR || SIM_FillFunctionTable( &eclib ) != ERR_NOERROR ||
+        eclib.BL_Connect( "USB0", 5, &id, &infos ) != ERR_NOERROR ){
+        printf( "Cannot connect to the simulated device\n" );
+        return 2;
+    }
+    s_testCommSpeed       = eclib.BL_TestCommSpeed;
+    eclib.BL_TestCommSpeed = s_degradingCommSpeed;
+
+    /* every channel probed every 40 ms, the trend projected 1 s ahead */
+    TLinkMonitorConfig_t settings = LNK_DefaultConfig();
+    settings.PeriodMs       = 40;
+    settings.GuardMs        = 2;
+    settings.HorizonSeconds = 1.0;
+    std::vector<uint8> channels;
+    for( int ch = 0; ch < NB_CHANNELS; ch++ ) channels.push_back( (uint8)ch );
+    LinkMonitor monitor( &eclib );
+    s_start = Clock::now();
+    if( monitor.setup( id, channels, settings, s_alert, 0 ) != ERR_NOERROR || monitor.start() != ERR_NOERROR ){
+        printf( "Cannot start the monitor\n" );
+        return 2;
+    }
+
+    /* the acquisition: a poll of the channels every 10 ms */
+    TDataBuffer_t buf;
+    TDataInfos_t dinfos;
+    TCurrentValues_t curr;
+    int polls = 0;
+    while( s_elapsed() < HEALTHY_S + s_degradation + 0.5 ){
+        monitor.pollBegin();
+        s_polling = true;
+        for( int ch = 0; ch < NB_CHANNELS; ch++ ) eclib.BL_GetData( id, (uint8)ch, &buf, &dinfos, &curr );
+        std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+        s_polling = false;
+        monitor.pollEnd();
+        polls++;
+        std::this_thread::sleep_for( std::chrono::milliseconds( POLL_MS - 1 ) );
+    }
+    monitor.stop();
+
+    int errors = 0;
+    double warn = settings.WarnFraction * settings.FailureMs;
+    printf( "%-6s %-8s %-9s %-5s %10s %10s %10s %12s %12s\n", "time s", "channel", "health", "cause", "link ms", "p50 ms", "p99 ms", "trend ms/min", "projected ms" );
+    std::vector<int> seen( NB_CHANNELS, 0 );
+    for( size_t i = 0; i < s_alerts.size(); i++ ){
+        const TAlert_t& a = s_alerts[i];
+        const TLinkChannelHealth_t& h = a.Health;
+        printf( "%6.3f %-8d %-9s %-5s %10.0f %10.0f %10.0f %12.0f %12.0f\n", a.Time, h.Channel + 1, s_health[h.Health], s_cause[h.Cause],
+                a.RoundTrip, h.ChannelP50, h.ChannelP99, h.TrendMsPerMin, h.ProjectedMs );
+        /* the states in order, the degradation seen before the warning level */
+        if( h.Health != seen[h.Channel] + 1 || h.Cause != LNK_CAUSE_LINK ) errors++;
+        if( h.Health == LNK_HEALTH_DEGRADED && a.RoundTrip >= warn ) errors++;
+        seen[h.Channel] = h.Health;
+    }
+    std::vector<TLinkChannelHealth_t> health = monitor.health();
+    unsigned long long forced = 0;
+    for( size_t i = 0; i < health.size(); i++ ){
+        const TLinkChannelHealth_t& h = health[i];
+        printf( "channel %d: %llu probes, %llu failed, %llu without a free slot, device p99 %.0f ms\n",
+                h.Channel + 1, h.Probes, h.Failures, h.Forced, h.DeviceP99 );
+        if( h.Health != LNK_HEALTH_DOWN || seen[h.Channel] != LNK_HEALTH_DOWN ) errors++;
+        forced += h.Forced;
+    }
+    printf( "%d polls, %d probes during a poll (%llu without a free slot)\n", polls, (int)s_overlaps, forced );
+    if( (unsigned long long)s_overlaps > forced ) errors++;
+
+    eclib.BL_Disconnect( id );
+    printf( "%s\n", errors ? "ERRORS" : "OK" );
+    return errors ? 4 : 0;
+}
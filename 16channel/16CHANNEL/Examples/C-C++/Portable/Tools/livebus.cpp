@@ -0,0 +1,329 @@
+// livebus.cpp : live data published in shared memory, and what its readers cost
+//
+// usage: livebus [seconds] [readers]
+//        livebus watch [segment] [channel]
+//
+// A publisher puts the frames of four channels (1 million points/s in all) in
+// a segment (BusPublisher) while 0, 1, 2, 4, ... 'readers' threads, each with
+// its own mapping (BusReader) as a separate program would have, read them in
+// place. For each number of readers: the time a frame takes to publish, the
+// time until the readers see it, and the points they read. The readers must
+// read every point, in sequence and intact, and the cost of the publisher must
+// not depend on them (it never waits for a reader).
+//
+// A reader which does not keep up must then see the gap in the sequence numbers
+// and its views reported overwritten, and the frames of four channels of the
+// simulated instrument drained by an Acquisition must reach two readers whole.
+//
+// "watch" prints the frames published by another program (acqd with "publish"
+// in its job, for instance).
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Acquisition.h"
+#include "DeviceSession.h"
+#include "Histogram.h"
+#include "InstrumentSim.h"
+#include "LiveBus.h"
+
+#ifdef _WIN32
+#include <process.h>
+#define s_processId _getpid
+#else
+#include <unistd.h>
+#define s_processId getpid
+#endif
+
+#define NB_CHANNELS     (4)
+#define FRAME_ROWS      (50)
+#define RATE            (1000000.0)    /* points per second, all channels */
+#define RING_POINTS     (65536)
+
+typedef struct {
+    unsigned long long Points;
+    unsigned long long Frames;
+    unsigned long long Gaps;     /* points lost */
+    unsigned long long Torn;     /* views overwritten while read */
+    unsigned long long Bad;      /* values not those published */
+    LatencyHistogram   Latency;
+} TReaderResult_t;
+
+static double s_now(){
+    return std::chrono::duration<double>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+/* reads every channel until the publisher closes the segment; 'synthetic': the frames of s_fillFrame */
+static void s_read( const char* name, bool synthetic, TReaderResult_t* result ){
+    BusReader reader;
+    if( reader.attach( name ) != ERR_NOERROR ){
+        result->Bad++;
+        return;
+    }
+    unsigned long long cursor[NB_CHANNELS] = { 0 }, expected[NB_CHANNELS] = { 0 };
+    for( ;; ){
+        bool closed = reader.isClosed();
+        bool idle   = true;
+        for( int ch = 0; ch < NB_CHANNELS; ch++ ){
+            TBusView_t view;
+            if( reader.next( ch, &cursor[ch], &view ) != ERR_NOERROR || view.NbRows == 0 ) continue;
+            idle = false;
+            if( view.Sequence > expected[ch] ) result->Gaps += view.Sequence - expected[ch];
+            bool good = view.Sequence >= expected[ch];
+            if( synthetic ) result->Latency.recordSeconds( s_now() - view.Time[0] );
+            for( unsigned int k = 0; synthetic && k < view.NbRows; k++ ){
+                unsigned long long seq = view.Sequence + k;
+                good = good && view.Cycle[k] == (unsigned int)seq && view.Ewe[k] == (float)( seq & 0xFFFF ) && view.I[k] == -view.Ewe[k];
+            }
+            if( !reader.isValid( ch, view ) ) result->Torn++;
+            else if( !good ) result->Bad++;
+            expected[ch] = view.Sequence + view.NbRows;
+            result->Points += view.NbRows;
+            result->Frames++;
+        }
+        if( idle ){
+            if( closed ) break;
+            std::this_thread::yield();
+        }
+    }
+}
+
+/* frame of 'rows' points from the sequence 'seq', stamped with the time of its publication */
+static void s_fillFrame( TDecodedFrame_t* frame, unsigned long long seq, int rows ){
+    frame->NbRows = rows;
+    double now = s_now();
+    for( int k = 0; k < rows; k++ ){
+        frame->Time[k]  = now;
+        frame->Ewe[k]   = (float)( ( seq + k ) & 0xFFFF );
+        frame->I[k]     = -frame->Ewe[k];
+        frame->Cycle[k] = (unsigned int)( seq + k );
+    }
+}
+
+/* publishes for 'seconds' with 'readers' reading; false if the segment cannot be made */
+static bool s_fanOut( const char* name, double seconds, int readers, LatencyHistogram* publish,
+                      unsigned long long* published, std::vector<TReaderResult_t>* results ){
+    BusPublisher bus;
+    if( bus.create( name, RING_POINTS, NB_CHANNELS ) != ERR_NOERROR ) return false;
+    results->assign( readers, TReaderResult_t() );
+    std::vector<std::thread> threads;
+    for( int r = 0; r < readers; r++ ) threads.push_back( std::thread( s_read, name, true, &(*results)[r] ) );
+
+    std::unique_ptr<TDecodedFrame_t> frame( new TDecodedFrame_t() );
+    frame->TechniqueID = KBIO_TECHID_CA;
+    frame->Fields      = BL_FIELD_EWE | BL_FIELD_I | BL_FIELD_CYCLE;
+    unsigned long long seq[NB_CHANNELS] = { 0 };
+    double start = s_now(), period = FRAME_ROWS / RATE;
+    unsigned long long count = 0;
+    while( s_now() - start < seconds ){
+        /* the frames due, then a rest */
+        double due = start + count * period;
+        while( due <= s_now() ){
+            int ch = (int)( count % NB_CHANNELS );
+            s_fillFrame( frame.get(), seq[ch], FRAME_ROWS );
+            auto t0 = std::chrono::steady_clock::now();
+            bus.publish( ch, *frame );
+            publish->record( (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - t0 ).count() );
+            seq[ch] += FRAME_ROWS;
+            count++;
+            due = start + count * period;
+        }
+        std::this_thread::sleep_for( std::chrono::microseconds( 200 ) );
+    }
+    bus.close();
+    for( size_t r = 0; r < threads.size(); r++ ) threads[r].join();
+    *published = count * FRAME_ROWS;
+    return true;
+}
+
+/* a reader left behind: the points lost are seen, the views overwritten are reported */
+static int s_overrun( const char* name ){
+    int errors = 0;
+    BusPublisher bus;
+    BusReader reader;
+    if( bus.create( name, 1024, 1 ) != ERR_NOERROR || reader.attach( name ) != ERR_NOERROR ) return 1;
+    std::unique_ptr<TDecodedFrame_t> frame( new TDecodedFrame_t() );
+    frame->Fields = BL_FIELD_EWE | BL_FIELD_I | BL_FIELD_CYCLE;
+    unsigned long long seq = 0;
+    for( int i = 0; i < 3 * 1024 / 100; i++, seq += 100 ){
+        s_fillFrame( frame.get(), seq, 100 );
+        bus.publish( 0, *frame );
+    }
+    unsigned long long cursor = 0;
+    TBusView_t view;
+    reader.next( 0, &cursor, &view );
+    bool valid = reader.isValid( 0, view );
+    printf( "reader behind: %llu point(s) published, the oldest read is %llu (%u point(s), %s)", seq, view.Sequence, view.NbRows,
+            valid ? "intact" : "overwritten" );
+    if( view.NbRows == 0 || view.Sequence + 1024 < seq || view.Sequence == 0 || !valid || view.Cycle[0] != (unsigned int)view.Sequence ) errors++;
+    for( int i = 0; i < 1024 / 100 + 1; i++, seq += 100 ){
+        s_fillFrame( frame.get(), seq, 100 );
+        bus.publish( 0, *frame );
+    }
+    valid = reader.isValid( 0, view );
+    printf( ", then %s\n", valid ? "intact" : "overwritten" );
+    if( valid ) errors++;
+    return errors;
+}
+
+static int s_store( void* user, int channel, const TDecodedFrame_t& frame, const TCurrentValues_t& curr ){
+    return BUS_FrameFunction( user, channel, frame, curr );
+}
+
+/* the frames of an acquisition reach the readers whole */
+static int s_acquisition( const char* name ){
+    TSimConfig_t config = SIM_DefaultConfig();
+    config.Channels = NB_CHANNELS;
+    config.Speed    = 10;
+    TEClibFunctions eclib;
+    if( SIM_Configure( config ) != ERR_NOERROR || SIM_FillFunctionTable( &eclib ) != ERR_NOERROR ) return 1;
+    DeviceSession session( &eclib );
+    TDeviceInfos_t dev;
+    int status = session.connect( "USB0", 5, &dev );
+    for( int ch = 0; ch < NB_CHANNELS && status == ERR_NOERROR; ch++ ){
+        TEccParam_t p[8];
+        int n = 0;
+        eclib.BL_DefineSglParameter( "Voltage_step", 0.5f, 0, &p[n++] );
+        eclib.BL_DefineBoolParameter( "vs_initial", false, 0, &p[n++] );
+        eclib.BL_DefineSglParameter( "Duration_step", 10.0f, 0, &p[n++] );
+        eclib.BL_DefineIntParameter( "Step_number", 0, 0, &p[n++] );
+        eclib.BL_DefineIntParameter( "N_Cycles", 0, 0, &p[n++] );
+        eclib.BL_DefineSglParameter( "Record_every_dT", 1e-3f * ( ch + 1 ), 0, &p[n++] );
+        eclib.BL_DefineIntParameter( "I_Range", KBIO_IRANGE_10mA, 0, &p[n++] );
+        TEccParams_t params = { n, p };
+        status = eclib.BL_LoadTechnique( session.id(), (uint8)ch, "ca.ecc", params, true, true, false );
+    }
+    BusPublisher bus;
+    if( status == ERR_NOERROR ) status = bus.create( name, RING_POINTS, NB_CHANNELS );
+    if( status != ERR_NOERROR ) return 1;
+
+    std::vector<TReaderResult_t> results( 2 );
+    std::thread readers[2];
+    for( int r = 0; r < 2; r++ ) readers[r] = std::thread( s_read, name, false, &results[r] );
+    Acquisition acquisition( &eclib, &session );
+    acquisition.setFrameFunction( s_store, &bus );
+    for( int ch = 0; ch < NB_CHANNELS && status == ERR_NOERROR; ch++ ){
+        status = eclib.BL_StartChannel( session.id(), (uint8)ch );
+        if( status == ERR_NOERROR ) status = acquisition.addChannel( (uint8)ch );
+    }
+    if( status == ERR_NOERROR ) status = acquisition.start();
+    if( status == ERR_NOERROR ) while( !acquisition.wait( 1000 ) ){}
+    acquisition.stop();
+    bus.close();
+    for( int r = 0; r < 2; r++ ) readers[r].join();
+    session.disconnect();
+
+    TAcqStats_t s = acquisition.stats();
+    printf( "acquisition: %llu point(s) in %llu frame(s) published, read %llu and %llu\n", s.Points, s.Frames, results[0].Points, results[1].Points );
+    int errors = 0;
+    for( int r = 0; r < 2; r++ ){
+        if( results[r].Points != s.Points || results[r].Gaps || results[r].Torn || results[r].Bad ) errors++;
+    }
+    return ( status != ERR_NOERROR || s.Points == 0 ) ? errors + 1 : errors;
+}
+
+/* prints the frames published by another program */
+static int s_watch( const char* name, int channel ){
+    BusReader reader;
+    int status = reader.attach( name );
+    if( status != ERR_NOERROR ){
+        printf( "Cannot attach to %s: error %d\n", name, status );
+        return 2;
+    }
+    printf( "%s: %d channel(s), %u point(s) each\n", name, reader.channels(), reader.points() );
+    std::vector<unsigned long long> cursor( reader.channels() );
+    for( int ch = 0; ch < reader.channels(); ch++ ) cursor[ch] = reader.frameHead( ch );
+    while( !reader.isClosed() ){
+        for( int ch = 0; ch < reader.channels(); ch++ ){
+            if( channel > 0 && ch != channel - 1 ) continue;
+            TBusView_t view;
+            while( reader.next( ch, &cursor[ch], &view ) == ERR_NOERROR && view.NbRows ){
+                unsigned int last = view.NbRows - 1;
+                printf( "ch %2d  point %10llu  %4u point(s)  technique %d (%d)  t %10.3f s  Ewe %8.4f V  I %11.4e A%s\n",
+                        ch + 1, view.Sequence, view.NbRows, view.TechniqueID, view.TechniqueIndex, view.Time[last],
+                        view.Ewe[last], view.I[last], reader.isValid( ch, view ) ? "" : "  (overwritten)" );
+            }
+        }
+        fflush( stdout );
+        std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+    }
+    printf( "%s: closed by the publisher\n", name );
+    return 0;
+}
+
+int main( int argc, char** argv )
+{
+    if( argc > 1 && strcmp( argv[1], "watch" ) == 0 ){
+        return s_watch( ( argc > 2 ) ? argv[2] : BUS_DEFAULT_NAME, ( argc > 3 ) ? atoi( argv[3] ) : 0 );
+    }
+    double seconds = ( argc > 1 ) ? atof( argv[1] ) : 1.0;
+    int    readers = ( argc > 2 ) ? atoi( argv[2] ) : 8;
+    if( seconds < 0.1 || seconds > 60.0 || readers < 0 || readers > 64 ){
+        printf( "usage: %s [seconds 0.1..60 (default 1)] [readers 0..64 (default 8)]\n"
+                "       %s watch [segment (default %s)] [channel (default all)]\n", argv[0], argv[0], BUS_DEFAULT_NAME );
+        return 1;
+    }
+    char name[64];
+    snprintf( name, sizeof(name), "livebus-%d", (int)s_processId() );
+    int errors = 0;
+
+    printf( "%d channels, %.0f points/s in frames of %d points, %d points per channel in the segment\n\n",
+            NB_CHANNELS, RATE, FRAME_ROWS, RING_POINTS );
+    printf( "%7s %10s %14s %14s %10s %12s %12s %8s %6s\n", "readers", "published", "publish ns/fr", "p99 ns/frame",
+            "ns/point", "read (min)", "latency p50", "p99 us", "gaps" );
+    double baseline = 0.0, last = 0.0;
+    {
+        /* a first run, not counted, for the caches and the clock of the processor */
+        LatencyHistogram publish;
+        unsigned long long published;
+        std::vector<TReaderResult_t> results;
+        s_fanOut( name, 0.2, 0, &publish, &published, &results );
+    }
+    for( int r = 0; ; r = ( r == 0 ) ? 1 : ( 2 * r > readers && r < readers ? readers : 2 * r ) ){
+        if( r > readers ) break;
+        LatencyHistogram publish, latency;
+        unsigned long long published = 0, lowest = 0, gaps = 0;
+        std::vector<TReaderResult_t> results;
+        if( !s_fanOut( name, seconds, r, &publish, &published, &results ) ){
+            printf( "Cannot create the segment %s\n", name );
+            return 2;
+        }
+        for( size_t i = 0; i < results.size(); i++ ){
+            const TReaderResult_t& res = results[i];
+            latency.merge( res.Latency );
+            gaps += res.Gaps;
+            if( i == 0 || res.Points < lowest ) lowest = res.Points;
+            if( res.Points != published || res.Gaps || res.Torn || res.Bad ){
+                printf( "reader %zu: %llu point(s) of %llu, %llu lost, %llu overwritten, %llu wrong\n", i + 1, res.Points,
+                        published, res.Gaps, res.Torn, res.Bad );
+                errors++;
+            }
+        }
+        printf( "%7d %10llu %14.0f %14llu %10.1f %12llu %12.1f %8.1f %6llu\n", r, published, publish.mean(),
+                publish.percentile( 99.0 ), publish.mean() / FRAME_ROWS, lowest, latency.percentile( 50.0 ) * 1e-3,
+                latency.percentile( 99.0 ) * 1e-3, gaps );
+        if( r == 0 ) baseline = publish.mean();
+        last = publish.mean();
+        if( r == readers ) break;
+    }
+    /* the publisher does not wait for its readers: only the caches they share cost */
+    if( readers > 0 && last > 4.0 * baseline + 1000.0 ){
+        printf( "publishing with %d reader(s) costs %.0f ns per frame, %.0f without\n", readers, last, baseline );
+        errors++;
+    }
+    printf( "\n" );
+
+    errors += s_overrun( name );
+    errors += s_acquisition( name );
+
+    printf( "%s\n", errors ? "ERRORS" : "OK" );
+    return errors ? 4 : 0;
+}
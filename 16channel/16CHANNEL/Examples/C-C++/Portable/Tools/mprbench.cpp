@@ -0,0 +1,152 @@
+// mprbench.cpp : benchmark of the .mpr reader on a large file
+//
+// usage: mprbench <template.mpr> [points] [output.mpr]
+//
+// The template (e.g. data/test_C16.mpr) is inflated to the requested number of
+// points by repeating its data rows, keeping its settings and log modules, then
+// the large file is opened and every column is scanned through the views.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+#include "MprFile.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double s_elapsed( Clock::time_point start ){
+    return std::chrono::duration<double>( Clock::now() - start ).count();
+}
+
+static void s_writeU32( unsigned char* p, unsigned int v ){
+    p[0] = (unsigned char)v; p[1] = (unsigned char)(v >> 8); p[2] = (unsigned char)(v >> 16); p[3] = (unsigned char)(v >> 24);
+}
+
+/* writes a copy of the template with its data rows repeated up to 'points' rows */
+static int s_inflate( const MprFile& tpl, const char* output, size_t points ){
+    const unsigned char* base = tpl.file().data();
+    const TMprModule_t*  data = tpl.dataModule();
+    if( !data || tpl.rowCount() == 0 ) return ERR_GEN_INVALIDPARAMETERS;
+
+    FILE* out = fopen( output, "wb" );
+    if( !out ) return ERR_GEN_FILENOTEXISTS;
+
+    size_t rows_offset = (size_t)( tpl.rows() - base );
+    size_t header_size = data->DataOffset - data->HeaderOffset;
+    size_t length_pos  = MPR_MODULE_TAG_SIZE + 10 + 25 + ( header_size == MPR_MODULE_HEADER_V2_SIZE ? 4 : 0 );
+
+    /* everything up to the data module header (file header + settings) */
+    fwrite( base, 1, data->HeaderOffset, out );
+
+    /* data module header and data header, with the new length and point count */
+    std::vector<unsigned char> hdr( base + data->HeaderOffset, base + rows_offset );
+    s_writeU32( &hdr[length_pos], (unsigned int)( rows_offset - data->DataOffset + points * tpl.rowSize() ) );
+    s_writeU32( &hdr[header_size], (unsigned int)points );
+    fwrite( &hdr[0], 1, hdr.size(), out );
+
+    for( size_t written = 0; written < points; ){
+        size_t n = tpl.rowCount();
+        if( n > points - written ) n = points - written;
+        fwrite( tpl.rows(), tpl.rowSize(), n, out );
+        written += n;
+    }
+
+    /* whatever follows the data module (log, ...) */
+    size_t tail = data->DataOffset + data->Length;
+    fwrite( base + tail, 1, tpl.file().size() - tail, out );
+
+    int status = ferror( out ) ? ERR_GEN_FUNCTIONFAILED : ERR_NOERROR;
+    fclose( out );
+    return status;
+}
+
+template<typename T>
+static double s_sum( const MprFile& mpr, unsigned int id ){
+    MprColumnView<T> view;
+    double sum = 0.0;
+    if( mpr.view( id, view ) == ERR_NOERROR ){
+        for( size_t i = 0; i < view.size(); i++ ) sum += view[i];
+    }
+    return sum;
+}
+
+static double s_sumColumn( const MprFile& mpr, const TMprColumn_t& col ){
+    switch( col.Def->Type ){
+    case MPR_TYPE_FLAGS: {
+        MprFlagView view;
+        double sum = 0.0;
+        if( mpr.flags( col.Id, view ) == ERR_NOERROR ){
+            for( size_t i = 0; i < view.size(); i++ ) sum += view[i];
+        }
+        return sum;
+    }
+    case MPR_TYPE_U8:  return s_sum<unsigned char>( mpr, col.Id );
+    case MPR_TYPE_U16: return s_sum<unsigned short>( mpr, col.Id );
+    case MPR_TYPE_U32: return s_sum<unsigned int>( mpr, col.Id );
+    case MPR_TYPE_F32: return s_sum<float>( mpr, col.Id );
+    case MPR_TYPE_F64: return s_sum<double>( mpr, col.Id );
+    }
+    return 0.0;
+}
+
+int main( int argc, char** argv )
+{
+    if( argc < 2 ){
+        printf( "usage: %s <template.mpr> [points (default 5000000)] [output.mpr]\n", argv[0] );
+        return 1;
+    }
+    size_t      points = ( argc > 2 ) ? (size_t)strtoull( argv[2], 0, 10 ) : 5000000;
+    const char* output = ( argc > 3 ) ? argv[3] : "mprbench.mpr";
+
+    MprFile tpl;
+    int status = tpl.open( argv[1] );
+    if( status != ERR_NOERROR ){
+        printf( "Cannot read the template '%s': %s (error %d)\n", argv[1], tpl.errorMessage(), status );
+        return 2;
+    }
+
+    Clock::time_point start = Clock::now();
+    status = s_inflate( tpl, output, points );
+    if( status != ERR_NOERROR ){
+        printf( "Cannot write '%s' (error %d)\n", output, status );
+        return 2;
+    }
+    printf( "generated %s: %zu points in %.3f s\n", output, points, s_elapsed( start ) );
+
+    MprFile mpr;
+    start = Clock::now();
+    status = mpr.open( output );
+    double open_time = s_elapsed( start );
+    if( status != ERR_NOERROR || mpr.rowCount() != points ){
+        printf( "Cannot read back '%s': %s (error %d)\n", output, mpr.errorMessage(), status );
+        return 3;
+    }
+
+    double mbytes = (double)( mpr.rowCount() * mpr.rowSize() ) / ( 1024.0 * 1024.0 );
+    printf( "open (map + module walk): %.3f ms, %.1f MB of points\n", open_time * 1000.0, mbytes );
+
+    /* first pass faults the pages in, the second one measures the views on a warm mapping */
+    for( int pass = 0; pass < 2; pass++ ){
+        start = Clock::now();
+        double check = 0.0;
+        for( size_t c = 0; c < mpr.columnCount(); c++ ){
+            check += s_sumColumn( mpr, mpr.column( c ) );
+        }
+        double t = s_elapsed( start );
+        printf( "%s scan of %zu columns: %.3f s, %.1f MB/s, %.1f Mpoints/s (checksum %g)\n",
+                pass == 0 ? "first" : "second", mpr.columnCount(), t, mbytes / t, mpr.rowCount() / t / 1e6, check );
+    }
+
+    /* single column scan: the typical "plot Ewe vs time" access */
+    MprColumnView<double> time;
+    if( mpr.view( 4, time ) == ERR_NOERROR ){
+        start = Clock::now();
+        double last = 0.0;
+        for( size_t i = 0; i < time.size(); i++ ) last += time[i];
+        double t = s_elapsed( start );
+        printf( "time column scan: %.3f s, %.1f Mvalues/s (checksum %g)\n", t, time.size() / t / 1e6, last );
+    }
+    return 0;
+}
@@ -0,0 +1,62 @@
+// mprdump.cpp : prints the modules and the data of an EC-Lab .mpr file
+//
+// usage: mprdump <file.mpr> [max rows]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "MprFile.h"
+
+int main( int argc, char** argv )
+{
+    if( argc < 2 ){
+        printf( "usage: %s <file.mpr> [max rows (default 10, -1 for all)]\n", argv[0] );
+        return 1;
+    }
+
+    long max_rows = ( argc > 2 ) ? strtol( argv[2], 0, 10 ) : 10;
+
+    MprFile mpr;
+    int status = mpr.open( argv[1] );
+    if( status != ERR_NOERROR ){
+        printf( "Cannot read '%s': %s (error %d)\n", argv[1], mpr.errorMessage(), status );
+        return 2;
+    }
+
+    printf( "%s: %zu bytes, %zu modules\n", argv[1], mpr.file().size(), mpr.moduleCount() );
+    for( size_t i = 0; i < mpr.moduleCount(); i++ ){
+        const TMprModule_t& mod = mpr.module( i );
+        printf( "  [%zu] %-10s '%s' version %u, %u bytes at 0x%zx, %s\n",
+                i, mod.ShortName, mod.LongName, mod.Version, mod.Length, mod.DataOffset, mod.Date );
+    }
+
+    if( !mpr.dataModule() ){
+        printf( "No data module\n" );
+        return 0;
+    }
+
+    printf( "Data: %zu points (%zu declared), %zu bytes per point%s\n",
+            mpr.rowCount(), mpr.declaredRowCount(), mpr.rowSize(), mpr.isInterrupted() ? ", interrupted recording" : "" );
+    for( size_t c = 0; c < mpr.columnCount(); c++ ){
+        const TMprColumn_t& col = mpr.column( c );
+        printf( "  %4u  %-24s %-6s offset %zu\n", col.Id, col.Def->Name, col.Def->Unit, col.Offset );
+    }
+
+    size_t rows = mpr.rowCount();
+    if( max_rows >= 0 && (size_t)max_rows < rows ) rows = (size_t)max_rows;
+
+    for( size_t c = 0; c < mpr.columnCount(); c++ ){
+        const TMprColumnDef_t* def = mpr.column( c ).Def;
+        if( def->Unit[0] ) printf( "%s/%s\t", def->Name, def->Unit );
+        else               printf( "%s\t", def->Name );
+    }
+    printf( "\n" );
+    for( size_t r = 0; r < rows; r++ ){
+        for( size_t c = 0; c < mpr.columnCount(); c++ ){
+            printf( "%.9g\t", mpr.valueAt( c, r ) );
+        }
+        printf( "\n" );
+    }
+    return 0;
+}
@@ -0,0 +1,197 @@
+// mprwrite.cpp : round trip and benchmark of the streaming .mpr writer
+//
+// usage: mprwrite <template.mpr> [points] [output.mpr]
+//
+// Chronoamperometry data buffers (as returned by BL_GetData) are synthesized,
+// decoded with BL_DecodeData and appended to a .mpr file whose settings and log
+// modules come from the template. The file is then read back with MprFile:
+// the layout is compared with the template and every value with the source.
+// A file left open (no close, as after a crash) is also checked.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#include "BLDecode.h"
+#include "MprWriter.h"
+
+typedef std::chrono::steady_clock Clock;
+
+#define ROWS_PER_BUFFER (200) /* 200 rows x 5 words, a full CA buffer */
+#define TIME_BASE       (2e-5)
+
+static double s_elapsed( Clock::time_point start ){
+    return std::chrono::duration<double>( Clock::now() - start ).count();
+}
+
+static unsigned int s_word( float v ){
+    unsigned int w;
+    memcpy( &w, &v, sizeof(w) );
+    return w;
+}
+
+static float s_ewe( size_t k ) { return 0.5f + 0.001f * (float)( k % 1000 ); }
+static float s_i( size_t k )   { return ( k % 2 ? 1.0f : -1.0f ) * 1e-4f * (float)( k % 97 ); }
+
+/* fills a CA data buffer with the points [first, first+n) */
+static void s_makeBuffer( size_t first, int n, TDataBuffer_t* buf, TDataInfos_t* infos ){
+    memset( infos, 0, sizeof(*infos) );
+    infos->TechniqueID = KBIO_TECHID_CA;
+    infos->NbRows      = n;
+    infos->NbCols      = 5;
+    infos->StartTime   = 0.0;
+    for( int i = 0; i < n; i++ ){
+        size_t k = first + i;
+        unsigned long long t = (unsigned long long)k * 50; /* 1 ms per point */
+        unsigned int* row = &buf->data[i * 5];
+        row[0] = (unsigned int)( t >> 32 );
+        row[1] = (unsigned int)t;
+        row[2] = s_word( s_ewe( k ) );
+        row[3] = s_word( s_i( k ) );
+        row[4] = (unsigned int)( k / 1000 );
+    }
+}
+
+/* writes 'points' points, without closing the file if 'keep_open' */
+static int s_write( MprWriter& writer, const char* path, const MprFile& tpl, size_t points, bool keep_open, double* append_time ){
+    std::vector<unsigned short> ids;
+    int status = MPR_ColumnsForTechnique( KBIO_TECHID_CA, false, 0, ids );
+    if( status == ERR_NOERROR ) status = writer.open( path, &ids[0], ids.size(), &tpl );
+    if( status != ERR_NOERROR ) return status;
+
+    static TDataBuffer_t   buf;
+    static TDecodedFrame_t frame;
+    TDataInfos_t     infos;
+    TCurrentValues_t curr;
+    memset( &curr, 0, sizeof(curr) );
+    curr.TimeBase = (float)TIME_BASE;
+
+    double t = 0.0;
+    for( size_t k = 0; k < points && status == ERR_NOERROR; k += ROWS_PER_BUFFER ){
+        int n = (int)( points - k < ROWS_PER_BUFFER ? points - k : ROWS_PER_BUFFER );
+        s_makeBuffer( k, n, &buf, &infos );
+        status = BL_DecodeData( buf, infos, curr, false, 0, 0, &frame );
+        Clock::time_point start = Clock::now();
+        if( status == ERR_NOERROR ) status = writer.appendFrame( frame );
+        t += s_elapsed( start );
+    }
+    if( append_time ) *append_time = t;
+    if( status == ERR_NOERROR && !keep_open ) status = writer.close();
+    return status;
+}
+
+/* compares the layout with the template and the values with the source */
+static int s_check( const char* path, const MprFile& tpl, size_t points, bool closed ){
+    MprFile mpr;
+    int status = mpr.open( path );
+    if( status != ERR_NOERROR ){
+        printf( "  cannot read back: %s (error %d)\n", mpr.errorMessage(), status );
+        return 1;
+    }
+    int errors = 0;
+
+    if( memcmp( mpr.file().data(), tpl.file().data(), MPR_FILE_HEADER_SIZE ) != 0 ){
+        printf( "  file header differs from the template\n" ); errors++;
+    }
+    size_t nb_modules = closed ? 3 : 2; /* the log module is written on close */
+    if( mpr.moduleCount() != nb_modules ){
+        printf( "  %zu modules, %zu expected\n", mpr.moduleCount(), nb_modules ); errors++;
+    }
+    for( size_t m = 0; m < mpr.moduleCount() && m < tpl.moduleCount(); m++ ){
+        const TMprModule_t& a = mpr.module( m );
+        const TMprModule_t& b = tpl.module( m );
+        if( strcmp( a.ShortName, b.ShortName ) != 0 || a.DataOffset - a.HeaderOffset != b.DataOffset - b.HeaderOffset ){
+            printf( "  module %zu: '%s' differs from '%s'\n", m, a.ShortName, b.ShortName ); errors++;
+        }
+    }
+    const TMprModule_t* data = mpr.dataModule();
+    if( !data || data->Version != MPR_WRITER_DATA_VERSION
+        || (size_t)( mpr.rows() - mpr.file().data() ) - data->DataOffset != MPR_DATA_V2_ROWS_OFFSET ){
+        printf( "  data module layout differs from EC-Lab v2\n" ); errors++;
+    }
+    if( mpr.rowCount() != points ){
+        printf( "  %zu points read, %zu expected\n", mpr.rowCount(), points ); errors++;
+        if( mpr.rowCount() < points ) points = mpr.rowCount();
+    }
+
+    MprColumnView<double> time, cycle;
+    MprColumnView<float>  ewe, current;
+    MprFlagView           mode, oxred;
+    if( mpr.view( 4, time ) || mpr.view( 24, cycle ) || mpr.view( 6, ewe ) || mpr.view( 8, current )
+        || mpr.flags( 1, mode ) || mpr.flags( 2, oxred ) ){
+        printf( "  missing columns\n" );
+        return errors + 1;
+    }
+    size_t bad = 0;
+    for( size_t k = 0; k < points; k++ ){
+        float  i_ma = (float)( s_i( k ) * 1000.0 );
+        bool ok = time[k] == k * 50 * (double)(float)TIME_BASE
+               && ewe[k] == s_ewe( k )
+               && current[k] == i_ma
+               && cycle[k] == (double)( k / 1000 )
+               && mode[k] == 2
+               && oxred[k] == ( s_i( k ) >= 0.0f ? 1u : 0u );
+        if( !ok && bad++ == 0 ){
+            printf( "  point %zu differs: t=%g Ewe=%g I=%g cycle=%g mode=%u ox/red=%u\n",
+                    k, time[k], ewe[k], current[k], cycle[k], mode[k], oxred[k] );
+        }
+    }
+    if( bad ){
+        printf( "  %zu points differ\n", bad ); errors++;
+    }
+    return errors;
+}
+
+int main( int argc, char** argv )
+{
+    if( argc < 2 ){
+        printf( "usage: %s <template.mpr> [points (default 1000000)] [output.mpr]\n", argv[0] );
+        return 1;
+    }
+    size_t      points = ( argc > 2 ) ? (size_t)strtoull( argv[2], 0, 10 ) : 1000000;
+    const char* output = ( argc > 3 ) ? argv[3] : "mprwrite.mpr";
+
+    MprFile tpl;
+    int status = tpl.open( argv[1] );
+    if( status != ERR_NOERROR ){
+        printf( "Cannot read the template '%s': %s (error %d)\n", argv[1], tpl.errorMessage(), status );
+        return 2;
+    }
+
+    /* full capture */
+    MprWriter writer;
+    double append_time = 0.0;
+    Clock::time_point start = Clock::now();
+    status = s_write( writer, output, tpl, points, false, &append_time );
+    double t = s_elapsed( start );
+    if( status != ERR_NOERROR ){
+        printf( "Cannot write '%s' (error %d)\n", output, status );
+        return 2;
+    }
+    double mbytes = (double)( points * writer.rowSize() ) / ( 1024.0 * 1024.0 );
+    printf( "wrote %s: %zu points in %.3f s, %.1f MB/s, %.1f Mpoints/s\n", output, points, t, mbytes / t, points / t / 1e6 );
+    size_t buffers = ( points + ROWS_PER_BUFFER - 1 ) / ROWS_PER_BUFFER;
+    if( buffers ) printf( "append: %.3f us per %d points buffer\n", append_time * 1e6 / buffers, ROWS_PER_BUFFER );
+
+    int errors = s_check( output, tpl, points, true );
+    printf( "read back: %s\n", errors ? "FAILED" : "ok" );
+
+    /* capture cut before close: only the flushed rows are expected */
+    MprWriter cut;
+    size_t cut_points = points / 2 + 123;
+    cut.setFlushInterval( 1000, 1e9 );
+    status = s_write( cut, output, tpl, cut_points, true, 0 );
+    size_t flushed = cut_points - cut_points % 1000;
+    if( status == ERR_NOERROR ){
+        int cut_errors = s_check( output, tpl, flushed, false );
+        printf( "interrupted capture (%zu of %zu points flushed): %s\n", flushed, cut_points, cut_errors ? "FAILED" : "ok" );
+        errors += cut_errors;
+    } else {
+        printf( "Cannot write '%s' (error %d)\n", output, status );
+        errors++;
+    }
+    return errors ? 3 : 0;
+}
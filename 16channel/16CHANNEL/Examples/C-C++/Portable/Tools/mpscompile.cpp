@@ -0,0 +1,84 @@
+// mpscompile.cpp : compiles an EC-Lab setting file into ECLib techniques
+//
+// usage: mpscompile <settings.mps> [xctr] [channels]
+//
+// Prints the .ecc file and the parameters of each technique, in the form of the
+// BL_DefineXXXParameter calls of the MFC sample, then measures the time needed
+// to prepare the plan of every channel: parsed once, then served by the cache.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+#include "MpsFile.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double s_elapsed( Clock::time_point start ){
+    return std::chrono::duration<double>( Clock::now() - start ).count();
+}
+
+static void s_print( const TEccTechnique_t& tech ){
+    printf( "%s (technique %d), %zu parameters\n", tech.EccFile.c_str(), tech.TechniqueID, tech.Params.size() );
+    for( size_t i = 0; i < tech.Params.size(); i++ ){
+        const TEccParam_t& p = tech.Params[i];
+        switch( p.ParamType ){
+        case PARAM_SINGLE:  printf( "    BL_DefineSglParameter ( \"%s\", %g, %d )\n",  p.ParamStr, ECC_SglValue( p ), p.ParamIndex ); break;
+        case PARAM_BOOLEAN: printf( "    BL_DefineBoolParameter( \"%s\", %s, %d )\n", p.ParamStr, p.ParamVal ? "TRUE" : "FALSE", p.ParamIndex ); break;
+        default:            printf( "    BL_DefineIntParameter ( \"%s\", %d, %d )\n",  p.ParamStr, p.ParamVal, p.ParamIndex ); break;
+        }
+    }
+}
+
+int main( int argc, char** argv )
+{
+    if( argc < 2 ){
+        printf( "usage: %s <settings.mps> [xctr (default 0)] [channels (default 16)]\n", argv[0] );
+        return 1;
+    }
+    int xrec     = ( argc > 2 ) ? atoi( argv[2] ) : 0;
+    int channels = ( argc > 3 ) ? atoi( argv[3] ) : 16;
+
+    MpsFile mps;
+    Clock::time_point start = Clock::now();
+    int status = mps.open( argv[1] );
+    double parse_time = s_elapsed( start );
+    if( status != ERR_NOERROR ){
+        printf( "Cannot read '%s': %s (error %d)\n", argv[1], mps.errorMessage(), status );
+        return 2;
+    }
+
+    bool vmp4 = ECC_IsVmp4Device( mps.device() );
+    std::vector<TEccTechnique_t> plan;
+    start = Clock::now();
+    status = mps.compile( vmp4, xrec, plan );
+    double compile_time = s_elapsed( start );
+    if( status != ERR_NOERROR ){
+        printf( "Cannot compile '%s': %s (error %d)\n", argv[1], mps.errorMessage(), status );
+        return 3;
+    }
+
+    printf( "%s: device %s, %zu technique(s) in the file, %zu to load\n", argv[1], mps.device(), mps.techniqueCount(), plan.size() );
+    for( size_t t = 0; t < plan.size(); t++ ){
+        s_print( plan[t] );
+    }
+    printf( "parse: %.1f us, compile: %.1f us\n", parse_time * 1e6, compile_time * 1e6 );
+
+    /* the plan of every channel: the first load compiles, the others hit the cache */
+    MpsCache cache;
+    std::shared_ptr<const TMpsPlan_t> channel_plan;
+    start = Clock::now();
+    status = cache.load( argv[1], vmp4, xrec, channel_plan );
+    double first = s_elapsed( start );
+    start = Clock::now();
+    for( int ch = 1; ch < channels && status == ERR_NOERROR; ch++ ){
+        status = cache.load( argv[1], vmp4, xrec, channel_plan );
+    }
+    double others = s_elapsed( start );
+    if( status != ERR_NOERROR ) return 3;
+    printf( "%d channels: first %.1f us, then %.1f us per channel (%zu hits, %zu misses, hash %016llx)\n",
+            channels, first * 1e6, channels > 1 ? others * 1e6 / ( channels - 1 ) : 0.0,
+            cache.hits(), cache.misses(), channel_plan->Hash );
+    return 0;
+}
@@ -0,0 +1,247 @@
+// reconnect.cpp : draining of running channels through a loss of the link
+//
+// usage: reconnect [seconds] [down ms]
+//
+// Four channels are drained with BL_GetData through a DeviceSession, one thread
+// per channel, while the link is lost for 'down ms' in the middle of the run. No
+// instrument is needed: the device is simulated. Its channels record a point per
+// ms in their memory whether the link is up or not. Channel 2 ends during the loss
+// and channel 3 is reset during it. The session connects again, reconciles the
+// channels and the draining goes on: the points of the channels still running or
+// ended must all arrive, in order, and channel 3 must be reported lost. Then the
+// link does not come back and the reconnection is given up.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "DeviceSession.h"
+
+typedef std::chrono::steady_clock Clock;
+
+#define NB_CHANNELS   (4)
+#define ROW_BYTES     (3 * 4)
+
+static double s_elapsed( Clock::time_point start ){
+    return std::chrono::duration<double>( Clock::now() - start ).count();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// simulated device
+
+static std::mutex         s_lock;
+static Clock::time_point  s_start;
+static double             s_duration  = 1.5;
+static double             s_down_from = 0.5;
+static double             s_down_to   = 1.0;
+static int                s_id        = 100;     /* identifier of the current connection, -1 if none */
+static long long          s_sent[NB_CHANNELS];
+
+/* end of the techniques of a channel, reset time of channel 3 */
+static double s_end( int ch ){
+    return ( ch == 2 ) ? ( s_down_from + s_down_to ) / 2 : s_duration;
+}
+static double s_reset(){
+    return ( s_down_from + s_down_to ) / 2;
+}
+
+static bool s_linkDown( double now ){
+    return now >= s_down_from && now < s_down_to;
+}
+
+/* points recorded by a channel so far */
+static long long s_recorded( int ch, double now ){
+    double until = now < s_end( ch ) ? now : s_end( ch );
+    return (long long)( until * 1000.0 );
+}
+
+static int s_callStatus( int ID, double now ){
+    if( s_linkDown( now ) ){
+        s_id = -1;
+        return ERR_COMM_COMMFAILED;
+    }
+    return ( ID == s_id ) ? ERR_NOERROR : ERR_GEN_NOTCONNECTED;
+}
+
+static int BL_STDCALL s_connect( const char*, uint8, int* pID, TDeviceInfos_t* pInfos ){
+    std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+    std::lock_guard<std::mutex> guard( s_lock );
+    if( s_linkDown( s_elapsed( s_start ) ) ) return ERR_COMM_CONNECTIONFAILED;
+    static int next = 100;
+    s_id = ++next;
+    *pID = s_id;
+    memset( pInfos, 0, sizeof(*pInfos) );
+    pInfos->DeviceCode       = KBIO_DEV_VMP3;
+    pInfos->NumberOfChannels = NB_CHANNELS;
+    return ERR_NOERROR;
+}
+
+static int BL_STDCALL s_disconnect( int ID ){
+    std::lock_guard<std::mutex> guard( s_lock );
+    if( ID == s_id ) s_id = -1;
+    return ERR_NOERROR;
+}
+
+static int BL_STDCALL s_testConnection( int ID ){
+    std::lock_guard<std::mutex> guard( s_lock );
+    return s_callStatus( ID, s_elapsed( s_start ) );
+}
+
+static int BL_STDCALL s_getChannelInfos( int ID, uint8 ch, TChannelInfos_t* pInfos ){
+    std::lock_guard<std::mutex> guard( s_lock );
+    double now = s_elapsed( s_start );
+    int status = s_callStatus( ID, now );
+    if( status != ERR_NOERROR ) return status;
+    if( ch >= NB_CHANNELS ) return ERR_GEN_CHANNELNOTPLUGGED;
+    memset( pInfos, 0, sizeof(*pInfos) );
+    pInfos->Channel        = ch;
+    pInfos->FirmwareCode   = KIBIO_FIRM_KERNEL;
+    pInfos->NbOfTechniques = 1;
+    pInfos->State          = ( now < s_end( ch ) ) ? KBIO_STATE_RUN : KBIO_STATE_STOP;
+    pInfos->MemFilled      = (int)( ( s_recorded( ch, now ) - s_sent[ch] ) * ROW_BYTES );
+    if( ch == 3 && now >= s_reset() ){
+        pInfos->FirmwareCode   = KIBIO_FIRM_NONE;
+        pInfos->NbOfTechniques = 0;
+        pInfos->State          = KBIO_STATE_STOP;
+        pInfos->MemFilled      = 0;
+    }
+    return ERR_NOERROR;
+}
+
+/* column 0: number of the point */
+static int BL_STDCALL s_getData( int ID, uint8 ch, TDataBuffer_t* pBuf, TDataInfos_t* pInfos, TCurrentValues_t* pValues ){
+    std::lock_guard<std::mutex> guard( s_lock );
+    double now = s_elapsed( s_start );
+    int status = s_callStatus( ID, now );
+    if( status != ERR_NOERROR ) return status;
+    if( ch >= NB_CHANNELS ) return ERR_GEN_CHANNELNOTPLUGGED;
+    if( ch == 3 && now >= s_reset() ) return ERR_FIRM_FIRMWARENOTLOADED;
+
+    long long rows = s_recorded( ch, now ) - s_sent[ch];
+    if( rows > 200 ) rows = 200;
+    memset( pInfos, 0, sizeof(*pInfos) );
+    pInfos->TechniqueID = KBIO_TECHID_OCV;
+    pInfos->NbRows      = (int)rows;
+    pInfos->NbCols      = 3;
+    for( int i = 0; i < (int)rows; i++ ) pBuf->data[i * 3] = (unsigned int)( s_sent[ch] + i );
+    s_sent[ch] += rows;
+
+    memset( pValues, 0, sizeof(*pValues) );
+    pValues->State       = ( now < s_end( ch ) || s_sent[ch] < s_recorded( ch, now ) ) ? KBIO_STATE_RUN : KBIO_STATE_STOP;
+    pValues->ElapsedTime = (float)now;
+    pValues->MemFilled   = (int)( ( s_recorded( ch, now ) - s_sent[ch] ) * ROW_BYTES );
+    return ERR_NOERROR;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+typedef struct {
+    long long Points;
+    bool      InOrder;
+    int       Status;
+} TDrained_t;
+
+static void s_drain( DeviceSession* session, uint8 ch, TDrained_t* out ){
+    std::unique_ptr<TDataBuffer_t> buf( new TDataBuffer_t );
+    TDataInfos_t     infos;
+    TCurrentValues_t curr;
+    out->Points  = 0;
+    out->InOrder = true;
+    out->Status  = ERR_NOERROR;
+    for( ;; ){
+        int status = session->getData( ch, buf.get(), &infos, &curr );
+        if( status != ERR_NOERROR ){
+            out->Status = status;
+            return;
+        }
+        for( int i = 0; i < infos.NbRows; i++ ){
+            if( buf->data[i * 3] != (unsigned int)out->Points ) out->InOrder = false;
+            out->Points++;
+        }
+        if( curr.State != KBIO_STATE_RUN && infos.NbRows == 0 ) return;
+        std::this_thread::sleep_for( std::chrono::milliseconds( 5 ) );
+    }
+}
+
+static void s_print( const char* name, const LatencyHistogram& h ){
+    THistSummary_t s = h.summary();
+    printf( "%-12s %4llu  min %8.1f ms  p50 %8.1f ms  max %8.1f ms\n", name, s.Count, s.Min * 1e-6, s.P50 * 1e-6, s.Max * 1e-6 );
+}
+
+int main( int argc, char** argv )
+{
+    double down = 0.5;
+    if( argc > 1 ) s_duration = atof( argv[1] );
+    if( argc > 2 ) down = atof( argv[2] ) / 1000;
+    if( s_duration <= 0.2 || down <= 0 || down >= s_duration ){
+        printf( "usage: %s [seconds (default 1.5)] [down ms (default 500)]\n", argv[0] );
+        return 1;
+    }
+    s_down_from = ( s_duration - down ) / 2;
+    s_down_to   = s_down_from + down;
+
+    std::unique_ptr<TEClibFunctions> eclib( new TEClibFunctions() );
+    eclib->BL_Connect         = s_connect;
+    eclib->BL_Disconnect      = s_disconnect;
+    eclib->BL_TestConnection  = s_testConnection;
+    eclib->BL_GetChannelInfos = s_getChannelInfos;
+    eclib->BL_GetData         = s_getData;
+
+    int errors = 0;
+    s_start = Clock::now();
+    DeviceSession session( eclib.get() );
+    session.setRetry( 100, 20 );
+    int status = session.connect( "USB0" );
+    for( int ch = 0; ch < NB_CHANNELS && status == ERR_NOERROR; ch++ ) status = session.track( (uint8)ch );
+    if( status != ERR_NOERROR ){
+        printf( "Cannot connect: error %d\n", status );
+        return 2;
+    }
+
+    TDrained_t drained[NB_CHANNELS];
+    std::vector<std::thread> threads;
+    for( int ch = 0; ch < NB_CHANNELS; ch++ ) threads.push_back( std::thread( s_drain, &session, (uint8)ch, &drained[ch] ) );
+    for( size_t k = 0; k < threads.size(); k++ ) threads[k].join();
+
+    TSessionStats_t st = session.stats();
+    printf( "link down %.0f ms at %.2f s: %llu loss, %llu reconnection, %llu BL_Connect calls, %.0f ms without link (error %d)\n",
+            down * 1e3, s_down_from, st.Losses, st.Reconnects, st.Attempts, st.DownSeconds * 1e3, st.LastError );
+    static const char* outcomes[4] = { "running", "stopped", "lost", "failed" };
+    std::vector<TSessionReconcile_t> rec = session.lastReconcile();
+    printf( "  channel  after      techniques  waiting   gap ms   points drained\n" );
+    for( size_t i = 0; i < rec.size(); i++ ){
+        int ch = rec[i].Channel;
+        printf( "  %7d  %-9s %5d -> %d %7d B %8.1f   %lld%s (error %d)\n", ch, outcomes[rec[i].Outcome], rec[i].NbOfTechniques,
+                rec[i].NbOfTechniquesNow, rec[i].MemFilled, rec[i].GapSeconds * 1e3, drained[ch].Points,
+                drained[ch].InOrder ? ", in order" : ", OUT OF ORDER", drained[ch].Status );
+    }
+    s_print( "reconnection", session.metric( SES_METRIC_RECONNECT ) );
+    s_print( "data gap", session.metric( SES_METRIC_DATA_GAP ) );
+
+    int expected[NB_CHANNELS] = { SES_CHANNEL_RUNNING, SES_CHANNEL_RUNNING, SES_CHANNEL_STOPPED, SES_CHANNEL_LOST };
+    if( st.Reconnects != 1 || rec.size() != NB_CHANNELS ) errors++;
+    for( size_t i = 0; i < rec.size(); i++ ){
+        int ch = rec[i].Channel;
+        if( rec[i].Outcome != expected[ch] ) errors++;
+        if( ch < 3 && ( drained[ch].Status != ERR_NOERROR || !drained[ch].InOrder
+                        || drained[ch].Points != s_recorded( ch, s_duration ) ) ) errors++;
+        if( ch == 3 && drained[ch].Status != ERR_GEN_FUNCTIONFAILED ) errors++;
+    }
+
+    /* the link does not come back */
+    s_start       = Clock::now();
+    s_down_from   = 0.0;
+    s_down_to     = 1e9;
+    session.setRetry( 3, 10 );
+    status = session.check();
+    st = session.stats();
+    printf( "%-30s %s (error %d, %llu given up)\n", "link lost for good", status == ERR_COMM_CONNECTIONFAILED ? "ok" : "FAILED", status, st.Failures );
+    if( status != ERR_COMM_CONNECTIONFAILED || st.Failures != 1 ) errors++;
+    return errors ? 4 : 0;
+}
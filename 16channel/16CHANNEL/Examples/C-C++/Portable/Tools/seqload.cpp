@@ -0,0 +1,136 @@
+// seqload.cpp : compiles a sequence of linked techniques and loads it on channels
+//
+// usage: seqload <sequence.seq> [ecc folder] [vmp4 (0/1)] [channels]
+//
+// The sequence is parsed and checked against the schemas of its techniques, the
+// chain is printed, then loaded on the channels in one TechniqueCache::loadChannels
+// call. No instrument is needed: BL_LoadTechnique is replaced by a function which
+// records the techniques each channel receives, so that the order of the chain and
+// the first / last flags are checked. Sequences with errors are then parsed to show
+// that they are rejected before anything is sent.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "EccSequence.h"
+#include "TechniqueCache.h"
+
+typedef struct {
+    std::string File;
+    int         Params;
+    bool        First;
+    bool        Last;
+} TReceived_t;
+
+static std::mutex                s_lock;
+static std::vector<TReceived_t>  s_received[256];
+static int                       s_calls = 0;
+
+static int BL_STDCALL s_loadTechnique( int, uint8 channel, const char* pFName, TEccParams_t Params, bool First, bool Last, bool ){
+    const char* name = strrchr( pFName, '/' );
+    TReceived_t r;
+    r.File   = name ? name + 1 : pFName;
+    r.Params = Params.len;
+    r.First  = First;
+    r.Last   = Last;
+    std::lock_guard<std::mutex> guard( s_lock );
+    s_received[channel].push_back( r );
+    s_calls++;
+    return ERR_NOERROR;
+}
+
+static int BL_STDCALL s_updateParameters( int, uint8, int, TEccParams_t, const char* ){
+    return ERR_NOERROR;
+}
+
+/* the channel received the chain in order, the first flag on the first technique, the last flag on the last one */
+static bool s_checkChannel( int ch, const std::vector<TEccTechnique_t>& chain ){
+    const std::vector<TReceived_t>& got = s_received[ch];
+    if( got.size() != chain.size() ) return false;
+    for( size_t t = 0; t < chain.size(); t++ ){
+        if( got[t].File != chain[t].EccFile || got[t].Params != (int)chain[t].Params.size()
+            || got[t].First != ( t == 0 ) || got[t].Last != ( t + 1 == chain.size() ) ){
+            return false;
+        }
+    }
+    return true;
+}
+
+static const char* s_bad[] = {
+    "ocv Rest_time_T=10 Record_every_dE=0.1 Record_every_dT=1 E_Range=3\n",
+    "ocv Rest_time_T=10 Record_every_dE=0.1 Record_every_dT=1 E_Range=3 xctr=0 Current_step=1\n",
+    "ocv Rest_time_T=ten Record_every_dE=0.1 Record_every_dT=1 E_Range=3 xctr=0\n",
+    "cp Current_step[0]=0.001 vs_initial[0]=0 Duration_step[0]=60 Step_number=1 N_Cycles=0 Record_every_dE=0.01 "
+        "Record_every_dT=0.5 I_Range=8 E_Range=3 Bandwidth=5 xctr=0\n",
+    "cp Current_step[100]=0.001 vs_initial[0]=0 Duration_step[0]=60 Step_number=0 N_Cycles=0 Record_every_dE=0.01 "
+        "Record_every_dT=0.5 I_Range=8 E_Range=3 Bandwidth=5 xctr=0\n",
+    "trigger_in Trigger_Logic=1\nloop start 3\n",
+    "label start\ntrigger_in Trigger_Logic=1\nloop start 0\n",
+    "peis Ei=0\n"
+};
+
+int main( int argc, char** argv )
+{
+    if( argc < 2 ){
+        printf( "usage: %s <sequence.seq> [ecc folder (default ../../../EC-Lab Development Package/)] [vmp4 (default 0)] [channels (default 16)]\n", argv[0] );
+        return 1;
+    }
+    std::string ecc_dir = ( argc > 2 ) ? argv[2] : "../../../EC-Lab Development Package/";
+    bool vmp4    = ( argc > 3 ) && atoi( argv[3] ) != 0;
+    int channels = ( argc > 4 ) ? atoi( argv[4] ) : 16;
+    if( !ecc_dir.empty() && ecc_dir[ecc_dir.size() - 1] != '/' && ecc_dir[ecc_dir.size() - 1] != '\\' ) ecc_dir += "/";
+    if( channels < 1 || channels > 255 ){
+        printf( "the number of channels must be between 1 and 255\n" );
+        return 1;
+    }
+
+    EccSequence sequence;
+    std::vector<TEccTechnique_t> chain;
+    int status = sequence.open( argv[1] );
+    if( status == ERR_NOERROR ) status = sequence.compile( vmp4, chain );
+    if( status != ERR_NOERROR ){
+        printf( "%s: %s (error %d)\n", argv[1], sequence.errorMessage(), status );
+        return 2;
+    }
+    for( size_t t = 0; t < chain.size(); t++ ){
+        const TEccSequenceNode_t& node = sequence.technique( t );
+        printf( "%2zu  %-12s %-10s %2zu parameter(s)", t, node.Schema->Name, chain[t].EccFile.c_str(), chain[t].Params.size() );
+        if( chain[t].TechniqueID == KBIO_TECHID_LOOP ){
+            printf( ", back to %d, %d time(s)", chain[t].Params[1].ParamVal, chain[t].Params[0].ParamVal );
+        }
+        printf( "\n" );
+    }
+
+    std::unique_ptr<TEClibFunctions> eclib( new TEClibFunctions() );
+    eclib->BL_LoadTechnique    = s_loadTechnique;
+    eclib->BL_UpdateParameters = s_updateParameters;
+    TechniqueCache cache( eclib.get(), ecc_dir );
+
+    int errors = 0;
+    std::vector<uint8> mask( channels, 1 );
+    std::vector<int> results( channels, ERR_NOERROR );
+    TTechniqueBulkLoad_t report;
+    status = cache.loadChannels( 1, mask.data(), results.data(), (uint8)channels, chain, &report );
+    if( status != ERR_NOERROR ) printf( "load failed: error %d\n", status );
+    int good = 0;
+    for( int ch = 0; ch < channels; ch++ ) good += results[ch] == ERR_NOERROR && s_checkChannel( ch, chain );
+    printf( "loaded on %d channel(s) in %.1f ms (.ecc files checked in %.1f us): %d channel(s) with the whole chain in order\n",
+            report.Channels, report.Seconds * 1e3, report.CheckSeconds * 1e6, good );
+    if( status != ERR_NOERROR || good != channels ) errors++;
+
+    /* rejected before anything is sent */
+    int calls = s_calls;
+    for( size_t b = 0; b < sizeof(s_bad) / sizeof(s_bad[0]); b++ ){
+        EccSequence bad;
+        status = bad.parse( s_bad[b], strlen( s_bad[b] ) );
+        printf( "rejected: %s\n", status == ERR_NOERROR ? "NOT REJECTED" : bad.errorMessage() );
+        if( status == ERR_NOERROR ) errors++;
+    }
+    if( s_calls != calls ) errors++;
+    return errors ? 4 : 0;
+}
@@ -0,0 +1,201 @@
+// simbench.cpp : acquisition throughput against the simulated instrument
+//
+// usage: simbench [channels] [seconds per technique] [points/s per channel]
+//
+// The channels of a simulated VMP3 run OCV, CA, CP and CV in turn, each for the
+// same time and at the same rate. The clock of the simulation only moves between
+// the polls (SIM_Advance), so the points are the same from a run to the next and
+// the time measured is the one of the program: BL_GetData and the decoding of
+// the buffers. Then one channel records twice what a small memory holds, read too
+// late: the points dropped must be counted in IRQskipped.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "BLDecode.h"
+#include "Histogram.h"
+#include "InstrumentSim.h"
+
+typedef std::chrono::steady_clock Clock;
+
+#define POLL_PERIOD  (0.05)   /* s of the simulation between two polls */
+
+static const char* s_names[] = { "OCV", "CA", "CP", "CV" };
+
+static double s_elapsed( Clock::time_point start ){
+    return std::chrono::duration<double>( Clock::now() - start ).count();
+}
+
+/* a technique of 'seconds' recording 'rate' points per second, chosen by 'kind' */
+static int s_loadTechnique( const TEClibFunctions* eclib, int id, int ch, int kind, double seconds, double rate ){
+    TEccParam_t p[16];
+    int n = 0;
+    const char* file = "ocv.ecc";
+    switch( kind ){
+    case 0:
+        eclib->BL_DefineSglParameter( "Rest_time_T", (float)seconds, 0, &p[n++] );
+        eclib->BL_DefineSglParameter( "Record_every_dE", 0.0f, 0, &p[n++] );
+        eclib->BL_DefineSglParameter( "Record_every_dT", (float)( 1.0 / rate ), 0, &p[n++] );
+        eclib->BL_DefineIntParameter( "E_Range", KBIO_ERANGE_10, 0, &p[n++] );
+        break;
+    case 1:
+    case 2:
+        file = ( kind == 1 ) ? "ca.ecc" : "cp.ecc";
+        for( int k = 0; k < 2; k++ ){
+            if( kind == 1 ) eclib->BL_DefineSglParameter( "Voltage_step", k ? 0.2f : 0.5f, k, &p[n++] );
+            else            eclib->BL_DefineSglParameter( "Current_step", k ? -1e-4f : 1e-4f, k, &p[n++] );
+            eclib->BL_DefineBoolParameter( "vs_initial", false, k, &p[n++] );
+            eclib->BL_DefineSglParameter( "Duration_step", (float)( seconds / 2 ), k, &p[n++] );
+        }
+        eclib->BL_DefineIntParameter( "Step_number", 1, 0, &p[n++] );
+        eclib->BL_DefineIntParameter( "N_Cycles", 0, 0, &p[n++] );
+        eclib->BL_DefineSglParameter( "Record_every_dT", (float)( 1.0 / rate ), 0, &p[n++] );
+        eclib->BL_DefineIntParameter( "I_Range", KBIO_IRANGE_10mA, 0, &p[n++] );
+        break;
+    case 3: {
+        /* 0 V to 0.8 V, to -0.2 V and back to 0 V: 2 V scanned */
+        static const float vertices[5] = { 0.0f, 0.8f, -0.2f, 0.0f, 0.0f };
+        double scan = 2.0 / seconds;   /* V/s */
+        file = "cv.ecc";
+        for( int k = 0; k < 5; k++ ){
+            eclib->BL_DefineSglParameter( "Voltage_step", vertices[k], k, &p[n++] );
+            eclib->BL_DefineSglParameter( "Scan_Rate", (float)( scan * 1e3 ), k, &p[n++] );
+        }
+        eclib->BL_DefineSglParameter( "Record_every_dE", (float)( scan / rate ), 0, &p[n++] );
+        eclib->BL_DefineIntParameter( "N_Cycles", 0, 0, &p[n++] );
+        break;
+    }
+    }
+    TEccParams_t params = { n, p };
+    return eclib->BL_LoadTechnique( id, (uint8)ch, file, params, true, true, false );
+}
+
+/* reads the buffers of a channel until its memory is empty */
+static int s_drain( const TEClibFunctions* eclib, int id, int ch, TDecodedFrame_t* frame, LatencyHistogram* latency,
+                    unsigned long long* points, unsigned long long* buffers, unsigned long long* skipped, int* state ){
+    TDataBuffer_t buf;
+    TDataInfos_t infos;
+    TCurrentValues_t curr;
+    for( ;; ){
+        Clock::time_point start = Clock::now();
+        int status = eclib->BL_GetData( id, (uint8)ch, &buf, &infos, &curr );
+        if( status == ERR_NOERROR && infos.NbRows > 0 ) status = BL_DecodeData( buf, infos, curr, false, 0, 0, frame );
+        latency->recordSeconds( s_elapsed( start ) );
+        if( status != ERR_NOERROR ) return status;
+        *skipped += infos.IRQskipped;
+        *state = curr.State;
+        if( infos.NbRows == 0 ) return ERR_NOERROR;
+        *points += infos.NbRows;
+        (*buffers)++;
+    }
+}
+
+static void s_print( const char* name, const LatencyHistogram& h ){
+    THistSummary_t s = h.summary();
+    printf( "%-12s %8llu  p50 %7.2f us  p99 %7.2f us  max %8.2f us\n", name, s.Count, s.P50 * 1e-3, s.P99 * 1e-3, s.Max * 1e-3 );
+}
+
+int main( int argc, char** argv )
+{
+    int    channels = ( argc > 1 ) ? atoi( argv[1] ) : 16;
+    double seconds  = ( argc > 2 ) ? atof( argv[2] ) : 60.0;
+    double rate     = ( argc > 3 ) ? atof( argv[3] ) : 1000.0;
+    if( channels < 1 || channels > 16 || seconds <= 0.0 || rate <= 0.0 || rate > 50000.0 ){
+        printf( "usage: %s [channels 1..16 (default 16)] [seconds per technique (default 60)] [points/s per channel up to 50000 (default 1000)]\n", argv[0] );
+        return 1;
+    }
+
+    TSimConfig_t config = SIM_DefaultConfig();
+    config.Channels = channels;
+    config.Speed    = 0.0;
+    config.Step     = 0.0;
+    std::unique_ptr<TEClibFunctions> eclib( new TEClibFunctions() );
+    int id = -1;
+    TDeviceInfos_t infos;
+    if( SIM_Configure( config ) != ERR_NOERROR || SIM_FillFunctionTable( eclib.get() ) != ERR_NOERROR ||
+        eclib->BL_Connect( "USB0", 5, &id, &infos ) != ERR_NOERROR ){
+        printf( "Cannot connect to the simulated device\n" );
+        return 2;
+    }
+
+    uint8 mask[16] = { 0 };
+    int results[16];
+    for( int ch = 0; ch < channels; ch++ ){
+        if( s_loadTechnique( eclib.get(), id, ch, ch % 4, seconds, rate ) != ERR_NOERROR ){
+            printf( "Cannot load the technique of channel %d\n", ch + 1 );
+            return 2;
+        }
+        mask[ch] = 1;
+    }
+    if( eclib->BL_StartChannels( id, mask, results, 16 ) != ERR_NOERROR ){
+        printf( "Cannot start the channels\n" );
+        return 2;
+    }
+
+    /* the polls, until every channel is stopped */
+    std::unique_ptr<TDecodedFrame_t> frame( new TDecodedFrame_t() );
+    LatencyHistogram latency;
+    std::vector<unsigned long long> points( channels, 0 ), buffers( channels, 0 ), skipped( channels, 0 );
+    int errors = 0, running = channels, polls = 0;
+    Clock::time_point start = Clock::now();
+    while( running > 0 && errors == 0 && polls < (int)( 4 * seconds / POLL_PERIOD ) + 10 ){
+        SIM_Advance( POLL_PERIOD );
+        polls++;
+        running = 0;
+        for( int ch = 0; ch < channels; ch++ ){
+            int state = KBIO_STATE_STOP;
+            if( s_drain( eclib.get(), id, ch, frame.get(), &latency, &points[ch], &buffers[ch], &skipped[ch], &state ) != ERR_NOERROR ) errors++;
+            if( state != KBIO_STATE_STOP ) running++;
+        }
+    }
+    double wall = s_elapsed( start );
+
+    unsigned long long total = 0, total_buffers = 0;
+    printf( "%-8s %-4s %10s %8s %8s\n", "channel", "", "points", "buffers", "skipped" );
+    for( int ch = 0; ch < channels; ch++ ){
+        printf( "%-8d %-4s %10llu %8llu %8llu\n", ch + 1, s_names[ch % 4], points[ch], buffers[ch], skipped[ch] );
+        double expected = seconds * rate;
+        if( fabs( (double)points[ch] - expected ) > 1.0 + 1e-3 * expected || skipped[ch] ) errors++;
+        total += points[ch];
+        total_buffers += buffers[ch];
+    }
+    if( running ) errors++;
+    printf( "%d channels, %.0f s per technique at %.0f points/s: %llu points in %llu buffers, %d polls\n",
+            channels, seconds, rate, total, total_buffers, polls );
+    printf( "%.3f s: %.2f Mpoints/s, %.0f buffers/s (%.1f s of acquisition per s)\n",
+            wall, total / wall * 1e-6, total_buffers / wall, seconds / wall );
+    s_print( "BL_GetData", latency );
+
+    /* a memory of 64 kB read after the end of the technique: the points beyond are dropped;
+       the technique lasts long enough to record twice what the memory holds */
+    config.Channels = 1;
+    config.MemSize  = 64 * 1024;
+    SIM_Configure( config );
+    unsigned long long capacity = config.MemSize / ( 5 * sizeof(unsigned int) );
+    double overflow_seconds = ceil( 2.0 * capacity / rate );
+    if( overflow_seconds < seconds ) overflow_seconds = seconds;
+    unsigned long long read = 0, read_buffers = 0, dropped = 0;
+    int state = KBIO_STATE_RUN;
+    LatencyHistogram overflow;
+    if( eclib->BL_Connect( "USB0", 5, &id, &infos ) != ERR_NOERROR || s_loadTechnique( eclib.get(), id, 0, 1, overflow_seconds, rate ) != ERR_NOERROR ||
+        eclib->BL_StartChannel( id, 0 ) != ERR_NOERROR ){
+        printf( "Cannot start the overflow test\n" );
+        return 2;
+    }
+    SIM_Advance( 2 * overflow_seconds );
+    TCurrentValues_t curr;
+    eclib->BL_GetCurrentValues( id, 0, &curr );
+    int filled = curr.MemFilled;
+    if( s_drain( eclib.get(), id, 0, frame.get(), &overflow, &read, &read_buffers, &dropped, &state ) != ERR_NOERROR ) errors++;
+    printf( "memory of %d bytes, %d filled: %llu points read, %llu skipped, state %d\n", config.MemSize, filled, read, dropped, state );
+    double recorded = overflow_seconds * rate;
+    if( read != capacity || dropped == 0 || fabs( (double)( read + dropped ) - recorded ) > 1.0 + 1e-3 * recorded || state != KBIO_STATE_STOP ) errors++;
+
+    printf( "%s\n", errors ? "ERRORS" : "OK" );
+    return errors ? 4 : 0;
+}
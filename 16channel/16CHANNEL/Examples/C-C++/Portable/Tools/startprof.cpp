@@ -0,0 +1,164 @@
+// startprof.cpp : timeline of the startup of two devices, as a Chrome trace
+//
+// usage: startprof [trace.json] [channels per device]
+//
+// Two devices are started at the same time, each from its own thread: load of
+// the library, BL_Connect, firmware of the channels (FW_SetupChannels), a chain
+// of two techniques loaded on each channel and BL_StartChannels. Every ECLib
+// call goes through a table instrumented by PRF_InstrumentTable; the load of the
+// library is recorded by hand with a PhaseScope. No instrument is needed: the
+// functions are simulated, with fixed durations. The time of each step is
+// printed and the timeline is written as JSON, to open in chrome://tracing or
+// https://ui.perfetto.dev.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FirmwareSetup.h"
+#include "PhaseProfiler.h"
+
+static int  s_channels = 8;
+static bool s_kernel[16];  /* channels of USB0 whose firmware was loaded */
+
+static void s_wait( double ms ){
+    std::this_thread::sleep_for( std::chrono::duration<double, std::milli>( ms ) );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// simulated devices: USB0 runs the EC-Lab firmware on its odd channels, USB1 is ready
+
+static int BL_STDCALL s_connect( const char* address, uint8, int* pID, TDeviceInfos_t* pInfos ){
+    s_wait( 80 );
+    *pID = ( strcmp( address, "USB0" ) == 0 ) ? 0 : 1;
+    memset( pInfos, 0, sizeof(*pInfos) );
+    pInfos->DeviceCode       = KBIO_DEV_VMP3;
+    pInfos->NumberOfChannels = s_channels;
+    return ERR_NOERROR;
+}
+
+static int BL_STDCALL s_disconnect( int ){
+    s_wait( 2 );
+    return ERR_NOERROR;
+}
+
+static int BL_STDCALL s_getChannelsPlugged( int, uint8* pChPlugged, uint8 Size ){
+    s_wait( 3 );
+    for( int ch = 0; ch < Size; ch++ ) pChPlugged[ch] = ( ch < s_channels ) ? 1 : 0;
+    return ERR_NOERROR;
+}
+
+static int BL_STDCALL s_getChannelInfos( int ID, uint8 ch, TChannelInfos_t* pInfos ){
+    s_wait( 4 );
+    memset( pInfos, 0, sizeof(*pInfos) );
+    pInfos->Channel      = ch;
+    pInfos->FirmwareCode = ( ID == 0 && ch % 2 && !s_kernel[ch] ) ? KIBIO_FIRM_INTERPR : KIBIO_FIRM_KERNEL;
+    return ERR_NOERROR;
+}
+
+static int BL_STDCALL s_loadFirmware( int, uint8* pChannels, int* pResults, uint8 Length, bool, bool, const char*, const char* ){
+    for( int ch = 0; ch < Length; ch++ ){
+        if( !pChannels[ch] ) continue;
+        s_wait( 40 );
+        s_kernel[ch] = true;
+        pResults[ch] = ERR_NOERROR;
+    }
+    return ERR_NOERROR;
+}
+
+static int BL_STDCALL s_loadTechnique( int, uint8, const char*, TEccParams_t, bool, bool, bool ){
+    s_wait( 10 );
+    return ERR_NOERROR;
+}
+
+static int BL_STDCALL s_startChannels( int, uint8*, int* pResults, uint8 length ){
+    s_wait( 5 );
+    for( int ch = 0; ch < length; ch++ ) pResults[ch] = ERR_NOERROR;
+    return ERR_NOERROR;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+static void s_startDevice( const TEClibFunctions* eclib, const char* address, int* result ){
+    int id = -1;
+    TDeviceInfos_t infos;
+    int status = eclib->BL_Connect( address, 5, &id, &infos );
+    if( status == ERR_NOERROR ) status = FW_SetupChannels( eclib, id, FW_DefaultOptions(), 0 );
+
+    TEccParams_t params = { 0, 0 };
+    uint8 mask[16] = { 0 };
+    int results[16] = { 0 };
+    for( int ch = 0; ch < s_channels && status == ERR_NOERROR; ch++ ){
+        status = eclib->BL_LoadTechnique( id, (uint8)ch, "ocv.ecc", params, true, false, false );
+        if( status == ERR_NOERROR ) status = eclib->BL_LoadTechnique( id, (uint8)ch, "ca.ecc", params, false, true, false );
+        mask[ch] = 1;
+    }
+    if( status == ERR_NOERROR ) status = eclib->BL_StartChannels( id, mask, results, 16 );
+    *result = status;
+}
+
+int main( int argc, char** argv )
+{
+    std::string path = ( argc > 1 ) ? argv[1] : "startup_trace.json";
+    if( argc > 2 ) s_channels = atoi( argv[2] );
+    if( path.empty() || s_channels < 1 || s_channels > 16 ){
+        printf( "usage: %s [trace.json (default startup_trace.json)] [channels per device 1..16 (default 8)]\n", argv[0] );
+        return 1;
+    }
+
+    PhaseProfiler profiler;
+    std::unique_ptr<TEClibFunctions> eclib( new TEClibFunctions() );
+    {
+        PhaseScope scope( &profiler, "load ECLib" );
+        s_wait( 40 );
+        eclib->BL_Connect            = s_connect;
+        eclib->BL_Disconnect         = s_disconnect;
+        eclib->BL_GetChannelsPlugged = s_getChannelsPlugged;
+        eclib->BL_GetChannelInfos    = s_getChannelInfos;
+        eclib->BL_LoadFirmware       = s_loadFirmware;
+        eclib->BL_LoadTechnique      = s_loadTechnique;
+        eclib->BL_StartChannels      = s_startChannels;
+    }
+    std::unique_ptr<TEClibFunctions> traced( new TEClibFunctions() );
+    if( PRF_InstrumentTable( eclib.get(), &profiler, traced.get() ) != ERR_NOERROR ) return 2;
+
+    int results[2] = { -1, -1 };
+    std::thread usb1( s_startDevice, traced.get(), "USB1", &results[1] );
+    s_startDevice( traced.get(), "USB0", &results[0] );
+    usb1.join();
+    traced->BL_Disconnect( 0 );
+    traced->BL_Disconnect( 1 );
+
+    std::vector<TPhaseTotal_t> totals = profiler.totals();
+    printf( "%-22s %5s %10s %10s %10s %10s\n", "step", "count", "total ms", "max ms", "from ms", "to ms" );
+    for( size_t i = 0; i < totals.size(); i++ ){
+        const TPhaseTotal_t& t = totals[i];
+        printf( "%-22s %5d %10.1f %10.1f %10.1f %10.1f%s\n", t.Name.c_str(), t.Count, t.Seconds * 1e3, t.Max * 1e3,
+                t.First * 1e3, t.Last * 1e3, t.Errors ? "  ERRORS" : "" );
+    }
+    int status = profiler.writeChromeTrace( path );
+    std::vector<TPhaseEvent_t> events = profiler.events();
+    printf( "%zu steps written to %s (error %d)\n", events.size(), path.c_str(), status );
+
+    /* the load, then per device: connect, plugged, infos, two techniques and the start per channel, and
+       disconnect; on USB0 only, the firmware and the infos of its odd channels read again */
+    size_t expected = 1 + 2 * ( 3 + 4 * (size_t)s_channels ) + 2 * ( (size_t)s_channels / 2 );
+    int errors = 0;
+    if( status != ERR_NOERROR || results[0] != ERR_NOERROR || results[1] != ERR_NOERROR || events.size() != expected ) errors++;
+
+    /* one instrumented table: neither another one nor the instrumented table itself */
+    PhaseProfiler other;
+    TEClibFunctions again;
+    if( PRF_InstrumentTable( eclib.get(), &other, &again ) != ERR_GEN_FUNCTIONINPROGRESS ||
+        PRF_InstrumentTable( traced.get(), &profiler, &again ) != ERR_GEN_INVALIDPARAMETERS ) errors++;
+    PRF_ReleaseTable();
+    if( PRF_InstrumentTable( eclib.get(), &other, &again ) != ERR_NOERROR ) errors++;
+    PRF_ReleaseTable();
+    return errors ? 4 : 0;
+}
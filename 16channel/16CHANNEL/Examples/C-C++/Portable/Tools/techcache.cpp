@@ -0,0 +1,132 @@
+// techcache.cpp : loads and updates of technique chains through the TechniqueCache
+//
+// usage: techcache <settings.mps> [ecc folder] [channels]
+//
+// The chain compiled from a .mps file is loaded on every channel, as when Start
+// is pressed, then loaded again unchanged, with one value changed, with one
+// more step, and on a second device. The ECLib functions are replaced by functions which read the .ecc
+// file as ECLib does and count what would be sent to the instrument; the time
+// and the bytes of each pass are printed.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "MappedFile.h"
+#include "MpsFile.h"
+#include "TechniqueCache.h"
+
+static std::atomic<long long> s_loads( 0 ), s_updates( 0 ), s_bytes( 0 );
+static volatile unsigned s_sink;
+
+/* BL_LoadTechnique: the .ecc file and the parameters go to the instrument */
+static int BL_STDCALL s_loadTechnique( int, uint8, const char* pFName, TEccParams_t Params, bool, bool, bool ){
+    MappedFile ecc;
+    int status = ecc.open( pFName );
+    if( status != ERR_NOERROR ) return ERR_TECH_ECCFILENOTEXISTS;
+    unsigned sum = 0;
+    for( size_t i = 0; i < ecc.size(); i += 64 ) sum += ecc.data()[i];   /* read the file as the DLL does */
+    s_sink = sum;
+    s_loads++;
+    s_bytes += (long long)ecc.size() + Params.len * (long long)sizeof(TEccParam_t);
+    return ERR_NOERROR;
+}
+
+/* BL_UpdateParameters: only the parameters go to the instrument */
+static int BL_STDCALL s_updateParameters( int, uint8, int TechIndx, TEccParams_t Params, const char* ){
+    if( TechIndx < 0 ) return ERR_GEN_INVALIDPARAMETERS;
+    s_updates++;
+    s_bytes += Params.len * (long long)sizeof(TEccParam_t);
+    return ERR_NOERROR;
+}
+
+static const char* s_kind( int kind ){
+    switch( kind ){
+        case TECH_LOAD_FULL:   return "full load";
+        case TECH_LOAD_UPDATE: return "update";
+        default:               return "unchanged";
+    }
+}
+
+/* loads the chain on every channel and prints what was sent */
+static int s_pass( TechniqueCache& cache, const char* name, const std::vector<TEccTechnique_t>& chain, int channels ){
+    long long loads = s_loads, updates = s_updates, bytes = s_bytes;
+    TTechniqueLoad_t report;
+    double seconds = 0.0;
+    int status = ERR_NOERROR;
+    for( int ch = 0; ch < channels && status == ERR_NOERROR; ch++ ){
+        status = cache.load( 1, (uint8)ch, chain, &report );
+        seconds += report.Seconds;
+    }
+    if( status != ERR_NOERROR ){
+        printf( "%-16s error %d\n", name, status );
+        return status;
+    }
+    printf( "%-16s %-9s %7.1f us per channel, %3lld loads, %3lld updates, %8.1f KB sent\n", name, s_kind( report.Kind ),
+            seconds * 1e6 / channels, s_loads - loads, s_updates - updates, ( s_bytes - bytes ) / 1024.0 );
+    return ERR_NOERROR;
+}
+
+int main( int argc, char** argv )
+{
+    if( argc < 2 ){
+        printf( "usage: %s <settings.mps> [ecc folder (default ../../../EC-Lab Development Package/)] [channels (default 16)]\n", argv[0] );
+        return 1;
+    }
+    std::string ecc_dir = ( argc > 2 ) ? argv[2] : "../../../EC-Lab Development Package/";
+    int channels = ( argc > 3 ) ? atoi( argv[3] ) : 16;
+    if( !ecc_dir.empty() && ecc_dir[ecc_dir.size() - 1] != '/' && ecc_dir[ecc_dir.size() - 1] != '\\' ) ecc_dir += "/";
+    if( channels < 1 || channels > 256 ){
+        printf( "the number of channels must be between 1 and 256\n" );
+        return 1;
+    }
+
+    MpsFile mps;
+    std::vector<TEccTechnique_t> chain;
+    int status = mps.open( argv[1] );
+    if( status == ERR_NOERROR ) status = mps.compile( ECC_IsVmp4Device( mps.device() ), 0, chain );
+    if( status != ERR_NOERROR ){
+        printf( "Cannot compile '%s': %s (error %d)\n", argv[1], mps.errorMessage(), status );
+        return 2;
+    }
+
+    std::unique_ptr<TEClibFunctions> eclib( new TEClibFunctions() );
+    eclib->BL_LoadTechnique    = s_loadTechnique;
+    eclib->BL_UpdateParameters = s_updateParameters;
+    TechniqueCache cache( eclib.get(), ecc_dir );
+
+    printf( "%s: %zu technique(s) on %d channels\n", argv[1], chain.size(), channels );
+    int errors = 0;
+    errors += s_pass( cache, "first Start", chain, channels ) != ERR_NOERROR;
+    errors += s_pass( cache, "same settings", chain, channels ) != ERR_NOERROR;
+
+    /* one value of the last technique changed */
+    std::vector<TEccTechnique_t> changed( chain );
+    TEccParam_t& last = changed.back().Params.back();
+    last.ParamVal ^= 1;
+    errors += s_pass( cache, "one value", changed, channels ) != ERR_NOERROR;
+
+    /* one more parameter: the shape changed */
+    std::vector<TEccTechnique_t> longer( changed );
+    longer.back().Params.push_back( longer.back().Params.back() );
+    longer.back().Params.back().ParamIndex++;
+    errors += s_pass( cache, "other shape", longer, channels ) != ERR_NOERROR;
+
+    /* a second device on the same channels keeps the chains of the first one */
+    TTechniqueLoad_t report;
+    if( cache.load( 2, 0, chain, &report ) != ERR_NOERROR || report.Kind != TECH_LOAD_FULL || !cache.isLoaded( 1, 0 ) ||
+        cache.load( 1, 0, longer, &report ) != ERR_NOERROR || report.Kind != TECH_LOAD_UNCHANGED ){
+        printf( "the chains of two devices replace each other\n" );
+        errors++;
+    }
+
+    TTechniqueCacheStats_t st = cache.stats();
+    printf( "%llu full loads (%.1f us each), %llu updates (%.1f us each), %llu unchanged\n",
+            st.FullLoads, st.FullLoads ? st.LoadSeconds * 1e6 / st.FullLoads : 0.0,
+            st.Updates, st.Updates ? st.UpdateSeconds * 1e6 / st.Updates : 0.0, st.Unchanged );
+    return errors ? 4 : 0;
+}